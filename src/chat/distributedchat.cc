@@ -27,6 +27,7 @@
 
 #include "util/rsprint.h"
 #include "util/rsmemory.h"
+#include "util/rsdir.h"
 #include "distributedchat.h"
 
 #include "pqi/p3historymgr.h"
@@ -54,6 +55,7 @@ static const rstime_t 		LOBBY_LIST_AUTO_UPDATE_TIME         =  121 ; // regularl
 static const uint32_t 		MAX_ALLOWED_LOBBIES_IN_LIST_WARNING =   50 ;
 //static const uint32_t 	MAX_MESSAGES_PER_SECONDS_NUMBER     =    5 ; // max number of messages from a given peer in a window for duration below
 static const uint32_t 		MAX_MESSAGES_PER_SECONDS_PERIOD     =   10 ; // duration window for max number of messages before messages get dropped.
+static const uint32_t 		MAX_VERIFIED_SIGNATURES_CACHE_SIZE  = 4096 ; // max number of verified lobby signatures that we remember.
 
 #define        IS_PUBLIC_LOBBY(flags) (flags & RS_CHAT_LOBBY_FLAGS_PUBLIC    )
 #define    IS_PGP_SIGNED_LOBBY(flags) (flags & RS_CHAT_LOBBY_FLAGS_PGP_SIGNED)
@@ -62,8 +64,11 @@ static const uint32_t 		MAX_MESSAGES_PER_SECONDS_PERIOD     =   10 ; // duration
 #define  EXTRACT_PRIVACY_FLAGS(flags) (ChatLobbyFlags(flags.toUInt32()) * (RS_CHAT_LOBBY_FLAGS_PUBLIC | RS_CHAT_LOBBY_FLAGS_PGP_SIGNED))
 
 DistributedChatService::DistributedChatService(uint32_t serv_type,p3ServiceControl *sc,p3HistoryMgr *hm, RsGixs *is)
-    : mServType(serv_type),mDistributedChatMtx("Distributed Chat"), mServControl(sc), mHistMgr(hm),mGixs(is)
+    : _verified_lobby_signatures(MAX_VERIFIED_SIGNATURES_CACHE_SIZE,"VerifiedLobbySignatures"),
+      mServType(serv_type),mDistributedChatMtx("Distributed Chat"), mServControl(sc), mHistMgr(hm),mGixs(is)
 {
+    _duplicate_lobby_objects_dropped = 0 ;
+    _lobby_verifications_saved = 0 ;
     _time_shift_average = 0.0f ;
     _should_reset_lobby_counts = false ;
     last_visible_lobby_info_request_time = 0 ;
@@ -135,7 +140,12 @@ bool DistributedChatService::handleRecvChatLobbyMsgItem(RsChatMsgItem *ci)
         std::cerr << std::endl;
         return false ;
     }
-    
+
+	// Most lobby messages reach us from several friends. Drop the copies we already handled before checking the signature again.
+
+	if(isDuplicateLobbyObject(cli,cli->PeerId()))
+		return false ;
+
 	if( rsReputations->overallReputationLevel(cli->signature.keyId) ==
 	        RsReputationLevel::LOCALLY_NEGATIVE )
     {
@@ -224,7 +234,11 @@ bool DistributedChatService::checkSignature(RsChatLobbyBouncingObject *obj,const
 
     uint32_t size = RsChatSerialiser(RsSerializationFlags::SIGNATURE)
             .size(dynamic_cast<RsItem*>(obj));
-    RsTemporaryMemory memory(size) ;
+    uint32_t sign_size = obj->signature.signData.bin_len ;
+
+    // The signed data is followed by the signature and the signing key id, so that the whole buffer identifies the verification to do.
+
+    RsTemporaryMemory memory(size + sign_size + RsGxsId::SIZE_IN_BYTES) ;
 
 #ifdef DEBUG_CHAT_LOBBIES
     std::cerr << "Checking object signature: " << std::endl;
@@ -238,6 +252,25 @@ bool DistributedChatService::checkSignature(RsChatLobbyBouncingObject *obj,const
 	    return false ;
     }
 
+    memcpy(memory+size,obj->signature.signData.bin_data,sign_size) ;
+    memcpy(memory+size+sign_size,obj->signature.keyId.toByteArray(),RsGxsId::SIZE_IN_BYTES) ;
+
+    Sha1CheckSum verification_hash = RsDirUtil::sha1sum(memory,size+sign_size+RsGxsId::SIZE_IN_BYTES) ;
+    {
+        RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+
+        rstime_t verification_time ;
+
+        if(_verified_lobby_signatures.fetch(verification_hash,verification_time))
+        {
+#ifdef DEBUG_CHAT_LOBBIES
+            std::cerr << "  signature: already checked at time " << verification_time << std::endl;
+#endif
+            ++_lobby_verifications_saved ;
+            return true ;
+        }
+    }
+
     uint32_t error_status ;
     RsIdentityUsage use_info(RsServiceType::CHAT,
                              RsIdentityUsage::CHAT_LOBBY_MSG_VALIDATION,
@@ -271,10 +304,24 @@ bool DistributedChatService::checkSignature(RsChatLobbyBouncingObject *obj,const
 #ifdef DEBUG_CHAT_LOBBIES
     std::cerr << "  signature: CHECKS" << std::endl;
 #endif
+    {
+        RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+
+        _verified_lobby_signatures.store(verification_hash,time(NULL)) ;
+        _verified_lobby_signatures.resize() ;
+    }
 
     return true ;
 }
 
+void DistributedChatService::getLobbyBouncingStatistics(uint64_t& duplicates_dropped,uint64_t& verifications_saved)
+{
+    RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+
+    duplicates_dropped = _duplicate_lobby_objects_dropped ;
+    verifications_saved = _lobby_verifications_saved ;
+}
+
 bool DistributedChatService::getVirtualPeerId(const ChatLobbyId& id,ChatLobbyVirtualPeerId& vpid) 
 {
 	RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
@@ -301,6 +348,7 @@ bool DistributedChatService::getVirtualPeerId(const ChatLobbyId& id,ChatLobbyVir
 
 void DistributedChatService::locked_printDebugInfo() const
 {
+	std::cerr << "Duplicates dropped before signature check: " << _duplicate_lobby_objects_dropped << ", signature checks saved: " << _lobby_verifications_saved << std::endl;
 	std::cerr << "Recorded lobbies: " << std::endl;
 	rstime_t now = time(NULL) ;
 
@@ -413,7 +461,7 @@ bool DistributedChatService::locked_bouncingObjectCheck(RsChatLobbyBouncingObjec
 // This function should be used for all types of chat messages. But this requires a non backward compatible change in
 // chat protocol. To be done for version 0.6
 //
-void DistributedChatService::checkSizeAndSendLobbyMessage(RsChatItem *msg)
+void DistributedChatService::checkSizeAndSendLobbyMessage(RsChatItem *msg,const std::set<RsPeerId>& peers)
 {
     // Multiple-parts messaging has been disabled in lobbies, because of the following issues:
     //    1 - it breaks signatures because the subid of each sub-item is changed (can be fixed)
@@ -429,7 +477,10 @@ void DistributedChatService::checkSizeAndSendLobbyMessage(RsChatItem *msg)
         delete msg ;
     return ;
     }
-    sendChatItem(msg) ;
+    if(peers.empty())
+        sendChatItem(msg) ;
+    else
+        sendChatItemToPeers(msg,peers) ;
 }
 
 bool DistributedChatService::handleRecvItem(RsChatItem *item)
@@ -705,6 +756,9 @@ void DistributedChatService::handleRecvChatLobbyEventItem(RsChatLobbyEventItem *
 #endif
 	rstime_t now = time(nullptr);
 
+	if(isDuplicateLobbyObject(item,item->PeerId()))
+		return ;
+
 	if( rsReputations->overallReputationLevel(item->signature.keyId) ==
 	         RsReputationLevel::LOCALLY_NEGATIVE )
 	{
@@ -883,6 +937,45 @@ void DistributedChatService::getListOfNearbyChatLobbies(std::vector<VisibleChatL
 	}
 }
 
+// Checks the msg cache of the lobby before the object gets its signature checked. Only objects with a valid
+// signature are added to the cache (by bounceLobbyObject), so an object found there has already been checked
+// and forwarded. Like in bounceLobbyObject, the peer is still recorded as participating to the lobby.
+//
+// returns:
+// 	true: the object is a duplicate and should be destroyed
+// 	false: the object is not known yet. This includes objects for unknown lobbies, that are handled later.
+//
+bool DistributedChatService::isDuplicateLobbyObject(RsChatLobbyBouncingObject *item,const RsPeerId& peer_id)
+{
+	rstime_t now = time(NULL) ;
+	RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+
+	std::map<ChatLobbyId,ChatLobbyEntry>::iterator it(_chat_lobbys.find(item->lobby_id)) ;
+
+	if(it == _chat_lobbys.end())
+		return false ;
+
+	ChatLobbyEntry& lobby(it->second) ;
+
+	std::map<ChatLobbyMsgId,rstime_t>::iterator it2(lobby.msg_cache.find(item->msg_id)) ;
+
+	if(it2 == lobby.msg_cache.end())
+		return false ;
+
+#ifdef DEBUG_CHAT_LOBBIES
+	std::cerr << "  Msg " << std::hex << item->msg_id << std::dec << " already received at time " << it2->second << ". Dropping before signature check!" << std::endl ;
+#endif
+	it2->second = now ;	// update last msg seen time, to prevent echos.
+
+	if(peer_id != mServControl->getOwnId())
+		lobby.participating_friends.insert(peer_id) ;
+
+	++_duplicate_lobby_objects_dropped ;
+	++_lobby_verifications_saved ;
+
+	return true ;
+}
+
 // returns:
 // 	true: the object is not a duplicate and should be used
 // 	false: the object is a duplicate or there is an error, and it should be destroyed.
@@ -943,18 +1036,23 @@ bool DistributedChatService::bounceLobbyObject(RsChatLobbyBouncingObject *item,c
 
 	// Forward to allparticipating friends, except this peer.
 
+	std::set<RsPeerId> fwd_peers ;
+
 	for(std::set<RsPeerId>::const_iterator it(lobby.participating_friends.begin());it!=lobby.participating_friends.end();++it)
 		if((*it)!=peer_id && mServControl->isPeerConnected(mServType, *it)) 
-		{
-			RsChatLobbyBouncingObject *obj2 = item->duplicate() ; // makes a copy
-			RsChatItem *item2 = dynamic_cast<RsChatItem*>(obj2) ;
+			fwd_peers.insert(*it) ;
+
+	// The copy is serialised once, and the same data is sent to all these friends.
 
-			assert(item2 != NULL) ;
+	if(!fwd_peers.empty())
+	{
+		RsChatLobbyBouncingObject *obj2 = item->duplicate() ; // makes a copy
+		RsChatItem *item2 = dynamic_cast<RsChatItem*>(obj2) ;
 
-			item2->PeerId(*it) ;	// replaces the virtual peer id with the actual destination.
+		assert(item2 != NULL) ;
 
-            checkSizeAndSendLobbyMessage(item2) ;
-		}
+		checkSizeAndSendLobbyMessage(item2,fwd_peers) ;
+	}
 
 	++lobby.connexion_challenge_count ;
 
@@ -1768,18 +1866,17 @@ void DistributedChatService::unsubscribeChatLobby(const ChatLobbyId& id)
 
 		// send a lobby leaving packet to all friends
 
-		for(std::set<RsPeerId>::const_iterator it2(it->second.participating_friends.begin());it2!=it->second.participating_friends.end();++it2)
+		if(!it->second.participating_friends.empty())
 		{
 			RsChatLobbyUnsubscribeItem *item = new RsChatLobbyUnsubscribeItem ;
 
 			item->lobby_id = id ;
-			item->PeerId(*it2) ;
 
 #ifdef DEBUG_CHAT_LOBBIES
-			std::cerr << "Sending unsubscribe item to friend " << *it2 << std::endl;
+			std::cerr << "Sending unsubscribe item to " << it->second.participating_friends.size() << " friends" << std::endl;
 #endif
 
-			sendChatItem(item) ;
+			sendChatItemToPeers(item,it->second.participating_friends) ;
 		}
 
 		// remove history
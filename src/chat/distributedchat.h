@@ -25,6 +25,8 @@
 #include <retroshare/rschats.h>
 #include <retroshare/rsservicecontrol.h>
 
+#include "util/rsmemcache.h"
+
 typedef RsPeerId ChatLobbyVirtualPeerId ;
 
 struct RsItem;
@@ -79,17 +81,22 @@ class DistributedChatService
 		void getListOfNearbyChatLobbies(std::vector<VisibleChatLobbyRecord>& public_lobbies) ;
 		bool joinVisibleChatLobby(const ChatLobbyId& id, const RsGxsId &gxs_id) ;
 
+		/// Number of lobby objects dropped as duplicates before checking their signature, and number of
+		/// signature verifications that were avoided, either because of this or because the signature was already verified.
+		void getLobbyBouncingStatistics(uint64_t& duplicates_dropped,uint64_t& verifications_saved) ;
+
 	protected:
 		bool handleRecvItem(RsChatItem *) ;
 
 		virtual void sendChatItem(RsChatItem *) =0 ;
+		virtual void sendChatItemToPeers(RsChatItem *,const std::set<RsPeerId>& peers) =0 ;	// serialises the item once for all peers
 		virtual void locked_storeIncomingMsg(RsChatMsgItem *) =0 ;
 		virtual void triggerConfigSave() =0;
 
 		void addToSaveList(std::list<RsItem*>& list) const ;
 		bool processLoadListItem(const RsItem *item) ;
 
-		void checkSizeAndSendLobbyMessage(RsChatItem *) ;
+		void checkSizeAndSendLobbyMessage(RsChatItem *,const std::set<RsPeerId>& peers = std::set<RsPeerId>()) ;
 
 		bool sendLobbyChat(const ChatLobbyId &lobby_id, const std::string&) ;
 		bool handleRecvChatLobbyMsgItem(RsChatMsgItem *item) ;
@@ -117,6 +124,7 @@ class DistributedChatService
 		void sendConnectionChallenge(ChatLobbyId id) ;
 		void handleFriendUnsubscribeLobby(RsChatLobbyUnsubscribeItem*) ;
 		void cleanLobbyCaches() ;
+		bool isDuplicateLobbyObject(RsChatLobbyBouncingObject *obj, const RsPeerId& peer_id) ;
 		bool bounceLobbyObject(RsChatLobbyBouncingObject *obj, const RsPeerId& peer_id) ;
 
 		void sendLobbyStatusItem(const ChatLobbyId&, int type, const std::string& status_string) ;
@@ -159,6 +167,10 @@ class DistributedChatService
 		RsGxsId _default_identity;
 		std::map<ChatLobbyId,RsGxsId> _lobby_default_identity;
 
+		RsMemCache<Sha1CheckSum,rstime_t> _verified_lobby_signatures ;	// hash of signed data+signature, for signatures that were already checked
+		uint64_t _duplicate_lobby_objects_dropped ;
+		uint64_t _lobby_verifications_saved ;
+
 		uint32_t mServType ;
 		RsMutex mDistributedChatMtx ;
 
@@ -533,6 +533,10 @@ bool p3ChatService::getLobbyAutoSubscribe(const ChatLobbyId& lobby_id)
 {
     return DistributedChatService::getLobbyAutoSubscribe(lobby_id);
 }
+void p3ChatService::getLobbyBouncingStatistics(uint64_t& duplicatesDropped, uint64_t& verificationsSaved)
+{
+    DistributedChatService::getLobbyBouncingStatistics(duplicatesDropped, verificationsSaved);
+}
 bool p3ChatService::setDistantChatPermissionFlags(uint32_t flags)
 {
     return DistantChatService::setDistantChatPermissionFlags(flags) ;
@@ -565,6 +569,15 @@ void p3ChatService::sendChatItem(RsChatItem *item)
 	sendItem(item);
 }
 
+void p3ChatService::sendChatItemToPeers(RsChatItem *item,const std::set<RsPeerId>& peers)
+{
+	// Only used for lobby items, that are sent to friends and never go through distant chat.
+#ifdef CHAT_DEBUG
+	std::cerr << "p3ChatService::sendChatItemToPeers(): sending to " << peers.size() << " friends." << std::endl;
+#endif
+	sendItemToPeers(item,peers);
+}
+
 void p3ChatService::checkSizeAndSendMessage(RsChatMsgItem *msg)
 {
 	// We check the message item, and possibly split it into multiple messages, if the message is too big.
@@ -138,6 +138,7 @@ public:
     virtual void getDefaultIdentityForChatLobby(RsGxsId& nick_name) override;
     virtual void setLobbyAutoSubscribe(const ChatLobbyId& lobby_id, const bool autoSubscribe) override;
     virtual bool getLobbyAutoSubscribe(const ChatLobbyId& lobby_id) override;
+    virtual void getLobbyBouncingStatistics(uint64_t& duplicatesDropped, uint64_t& verificationsSaved) override;
 
     /** methods that will call the DistantChatService parent
      */
@@ -250,6 +251,7 @@ private:
     void handleIncomingItem(RsItem *)override;	// called by the former, and turtle handler for incoming encrypted items
 
     virtual void sendChatItem(RsChatItem *) override;
+    virtual void sendChatItemToPeers(RsChatItem *,const std::set<RsPeerId>& peers) override;
 
 	void initChatMessage(RsChatMsgItem *c, ChatMessage& msg);
 
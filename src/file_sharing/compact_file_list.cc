@@ -0,0 +1,948 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: compact_file_list.cc                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+#ifndef WINDOWS_SYS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "crypto/chacha20.h"
+#include "pqi/authssl.h"
+#include "util/rsdir.h"
+#include "util/rsmemory.h"
+#include "util/rsrandom.h"
+#include "file_search_index.h"
+#include "file_sharing_defaults.h"
+#include "compact_file_list.h"
+
+//#define DEBUG_COMPACT_FILE_LIST 1
+
+static const unsigned char COMPACT_FILE_LIST_MAGIC[8]   = { 'R','S','F','L','I','S','T','C' } ;
+static const uint32_t      COMPACT_FILE_LIST_VERSION_0001 = 0x00000001 ;
+
+static const uint32_t ENTRY_TYPE_SHIFT = 30 ;
+static const uint32_t ENTRY_SLOT_MASK  = (1u << ENTRY_TYPE_SHIFT) - 1 ;
+static const uint32_t NO_ENTRY         = 0xffffffff ;
+
+static const uint32_t AUTHENTICATION_TAG_SIZE = 16 ;
+
+struct CompactFileListHeader
+{
+	unsigned char magic[8] ;
+	uint32_t version ;
+	uint32_t chunk_size ;
+	uint32_t nb_entries ;
+	uint32_t nb_dirs ;
+	uint32_t nb_files ;
+	uint32_t nb_children ;
+	uint32_t nb_hashes ;
+	uint32_t string_table_size ;
+	uint64_t total_size ;
+	uint32_t total_files ;
+	uint32_t encrypted_key_size ;
+	unsigned char nonce[8] ;
+};
+
+struct CompactDirRecord
+{
+	uint32_t parent_index ;
+	uint32_t row ;
+	uint32_t name_offset ;
+	uint32_t name_size ;
+	uint32_t parent_path_offset ;
+	uint32_t parent_path_size ;
+	uint32_t first_child ;		// in the table of children. Sub-directories come first, then sub-files.
+	uint32_t nb_subdirs ;
+	uint32_t nb_subfiles ;
+	uint32_t reserved ;
+	uint64_t cumulated_size ;
+	int64_t  modtime ;
+	int64_t  most_recent_time ;
+	int64_t  update_time ;
+	unsigned char hash[20] ;
+	unsigned char padding[4] ;
+};
+
+struct CompactFileRecord
+{
+	uint32_t parent_index ;
+	uint32_t row ;
+	uint32_t name_offset ;
+	uint32_t name_size ;
+	uint64_t size ;
+	int64_t  modtime ;
+	unsigned char hash[20] ;
+	unsigned char padding[4] ;
+};
+
+struct CompactHashRecord
+{
+	unsigned char hash[20] ;
+	uint32_t index ;
+};
+
+class SslKeyEncryption: public CompactFileList::KeyEncryption
+{
+public:
+	virtual bool encrypt(const unsigned char *data,uint32_t size,std::vector<unsigned char>& out)
+	{
+		void *encrypted_data = NULL ;
+		int encrypted_size = 0 ;
+
+		if(!AuthSSL::getAuthSSL()->encrypt(encrypted_data,encrypted_size,data,size,AuthSSL::getAuthSSL()->OwnId()))
+			return false ;
+
+		out.assign((unsigned char*)encrypted_data,(unsigned char*)encrypted_data + encrypted_size) ;
+		free(encrypted_data) ;
+		return true ;
+	}
+	virtual bool decrypt(const unsigned char *data,uint32_t size,std::vector<unsigned char>& out)
+	{
+		void *decrypted_data = NULL ;
+		int decrypted_size = 0 ;
+
+		if(!AuthSSL::getAuthSSL()->decrypt(decrypted_data,decrypted_size,data,size))
+			return false ;
+
+		out.assign((unsigned char*)decrypted_data,(unsigned char*)decrypted_data + decrypted_size) ;
+		free(decrypted_data) ;
+		return true ;
+	}
+};
+
+static void makeChunkNonce(const unsigned char file_nonce[8],uint32_t chunk,unsigned char nonce[12])
+{
+	memcpy(nonce,file_nonce,8) ;
+
+	nonce[ 8] = (chunk >> 24) & 0xff ;
+	nonce[ 9] = (chunk >> 16) & 0xff ;
+	nonce[10] = (chunk >>  8) & 0xff ;
+	nonce[11] = (chunk      ) & 0xff ;
+}
+
+/******************************************************************************************************************/
+/*                                                     Writing                                                    */
+/******************************************************************************************************************/
+
+class CompactStringTable
+{
+public:
+	void add(const std::string& s,uint32_t& offset,uint32_t& size)
+	{
+		std::unordered_map<std::string,uint32_t>::const_iterator it = mOffsets.find(s) ;
+
+		size = s.size() ;
+
+		if(it != mOffsets.end())
+		{
+			offset = it->second ;
+			return ;
+		}
+		offset = mData.size() ;
+		mOffsets[s] = offset ;
+		mData.insert(mData.end(),s.begin(),s.end()) ;
+	}
+	const std::vector<unsigned char>& data() const { return mData ; }
+
+private:
+	std::unordered_map<std::string,uint32_t> mOffsets ;
+	std::vector<unsigned char> mData ;
+};
+
+bool CompactFileList::save(const InternalFileHierarchyStorage& storage,const std::string& fname,KeyEncryption *ke)
+{
+	SslKeyEncryption ssl_ke ;
+
+	if(ke == NULL)
+		ke = &ssl_ke ;
+
+	// Build the tables
+
+	std::vector<uint32_t> entries(storage.mEntries.size(),NO_ENTRY) ;
+	std::vector<CompactDirRecord> dirs ;
+	std::vector<CompactFileRecord> files ;
+	std::vector<uint32_t> children ;
+	std::vector<CompactHashRecord> hashes ;
+	CompactStringTable strings ;
+
+	for(uint32_t i=0;i<storage.mEntries.size();++i)
+		if(storage.isDir(i))
+		{
+			const InternalFileHierarchyStorage::DirRecord& de(storage.dirRecord(i)) ;
+			CompactDirRecord r ;
+			memset(&r,0,sizeof(r)) ;
+
+			r.parent_index     = de.parent_index ;
+			r.row              = de.row ;
+			r.first_child      = children.size() ;
+			r.nb_subdirs       = de.subdirs.size() ;
+			r.nb_subfiles      = de.subfiles.size() ;
+			r.cumulated_size   = de.dir_cumulated_size ;
+			r.modtime          = de.dir_modtime ;
+			r.most_recent_time = de.dir_most_recent_time ;
+			r.update_time      = de.dir_update_time ;
+			memcpy(r.hash,de.dir_hash.toByteArray(),20) ;
+
+			strings.add(storage.mNames.get(de.dir_name),r.name_offset,r.name_size) ;
+			strings.add(storage.mNames.get(de.dir_parent_path),r.parent_path_offset,r.parent_path_size) ;
+
+			children.insert(children.end(),de.subdirs.begin(),de.subdirs.end()) ;
+			children.insert(children.end(),de.subfiles.begin(),de.subfiles.end()) ;
+
+			entries[i] = (InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR << ENTRY_TYPE_SHIFT) | dirs.size() ;
+			dirs.push_back(r) ;
+		}
+		else if(storage.isFile(i))
+		{
+			const InternalFileHierarchyStorage::FileRecord& fe(storage.fileRecord(i)) ;
+			CompactFileRecord r ;
+			memset(&r,0,sizeof(r)) ;
+
+			r.parent_index = fe.parent_index ;
+			r.row          = fe.row ;
+			r.size         = fe.file_size ;
+			r.modtime      = fe.file_modtime ;
+			memcpy(r.hash,fe.file_hash.toByteArray(),20) ;
+
+			strings.add(storage.mNames.get(fe.file_name),r.name_offset,r.name_size) ;
+
+			entries[i] = (InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE << ENTRY_TYPE_SHIFT) | files.size() ;
+			files.push_back(r) ;
+		}
+
+	// The table of hashes is searched by dichotomy, so it needs to be sorted.
+
+	std::vector<std::pair<RsFileHash,DirectoryStorage::EntryIndex> > sorted_hashes ;
+	sorted_hashes.reserve(storage.mFileHashes.size()) ;
+
+	for(HashIndexTable::const_iterator it(storage.mFileHashes.begin());it!=storage.mFileHashes.end();++it)
+		sorted_hashes.push_back(std::make_pair(it->hash,it->index)) ;
+
+	std::sort(sorted_hashes.begin(),sorted_hashes.end()) ;
+
+	for(uint32_t i=0;i<sorted_hashes.size();++i)
+	{
+		CompactHashRecord r ;
+		memcpy(r.hash,sorted_hashes[i].first.toByteArray(),20) ;
+		r.index = sorted_hashes[i].second ;
+		hashes.push_back(r) ;
+	}
+
+	// Serialise the content
+
+	std::vector<unsigned char> content ;
+	content.reserve(entries.size()*sizeof(uint32_t) + dirs.size()*sizeof(CompactDirRecord) + files.size()*sizeof(CompactFileRecord)
+	                + children.size()*sizeof(uint32_t) + hashes.size()*sizeof(CompactHashRecord) + strings.data().size()) ;
+
+	content.insert(content.end(),(const unsigned char*)entries.data() ,(const unsigned char*)(entries.data()  + entries.size())) ;
+	content.insert(content.end(),(const unsigned char*)dirs.data()    ,(const unsigned char*)(dirs.data()     + dirs.size())) ;
+	content.insert(content.end(),(const unsigned char*)files.data()   ,(const unsigned char*)(files.data()    + files.size())) ;
+	content.insert(content.end(),(const unsigned char*)children.data(),(const unsigned char*)(children.data() + children.size())) ;
+	content.insert(content.end(),(const unsigned char*)hashes.data()  ,(const unsigned char*)(hashes.data()   + hashes.size())) ;
+	content.insert(content.end(),strings.data().begin(),strings.data().end()) ;
+
+	// Header and key
+
+	unsigned char key[32] ;
+	RSRandom::random_bytes(key,32) ;
+
+	std::vector<unsigned char> encrypted_key ;
+
+	if(!ke->encrypt(key,32,encrypted_key))
+	{
+		std::cerr << "(EE) Cannot encrypt file list key. Something's wrong." << std::endl;
+		return false ;
+	}
+
+	CompactFileListHeader header ;
+	memset(&header,0,sizeof(header)) ;
+
+	memcpy(header.magic,COMPACT_FILE_LIST_MAGIC,8) ;
+	header.version            = COMPACT_FILE_LIST_VERSION_0001 ;
+	header.chunk_size         = COMPACT_FILE_LIST_CHUNK_SIZE ;
+	header.nb_entries         = entries.size() ;
+	header.nb_dirs            = dirs.size() ;
+	header.nb_files           = files.size() ;
+	header.nb_children        = children.size() ;
+	header.nb_hashes          = hashes.size() ;
+	header.string_table_size  = strings.data().size() ;
+	header.total_size         = storage.mTotalSize ;
+	header.total_files        = storage.mTotalFiles ;
+	header.encrypted_key_size = encrypted_key.size() ;
+	RSRandom::random_bytes(header.nonce,8) ;
+
+	// Encrypt the content chunk by chunk, in place
+
+	FILE *F = RsDirUtil::rs_fopen( (fname+".tmp").c_str(),"wb" ) ;
+
+	if(!F)
+	{
+		std::cerr << "(EE) Cannot open file list for writing: " << fname+".tmp" << std::endl;
+		return false ;
+	}
+	bool ok = fwrite(&header,1,sizeof(header),F) == sizeof(header)
+	       && fwrite(encrypted_key.data(),1,encrypted_key.size(),F) == encrypted_key.size() ;
+
+	for(uint64_t offset=0;ok && offset < content.size();offset += COMPACT_FILE_LIST_CHUNK_SIZE)
+	{
+		uint32_t chunk = offset / COMPACT_FILE_LIST_CHUNK_SIZE ;
+		uint32_t size = std::min((uint64_t)COMPACT_FILE_LIST_CHUNK_SIZE,content.size() - offset) ;
+
+		unsigned char nonce[12] ;
+		unsigned char tag[AUTHENTICATION_TAG_SIZE] ;
+		makeChunkNonce(header.nonce,chunk,nonce) ;
+
+		librs::crypto::AEAD_chacha20_poly1305(key,nonce,&content[offset],size,(uint8_t*)&header,sizeof(header),tag,true) ;
+
+		ok = fwrite(&content[offset],1,size,F) == size && fwrite(tag,1,AUTHENTICATION_TAG_SIZE,F) == AUTHENTICATION_TAG_SIZE ;
+	}
+	memset(key,0,32) ;
+
+	if(fclose(F) != 0)
+		ok = false ;
+
+	if(!ok)
+	{
+		std::cerr << "(EE) Could not write entire file list " << fname << ". Out of disc space??" << std::endl;
+		return false ;
+	}
+
+	// An existing mapping of the previous file is not affected by the rename.
+
+	return RsDirUtil::renameFile(fname+".tmp",fname) ;
+}
+
+/******************************************************************************************************************/
+/*                                                     Reading                                                    */
+/******************************************************************************************************************/
+
+CompactFileList::CompactFileList()
+    : mData(NULL), mDataSize(0), mChunkSize(0), mNbEntries(0), mNbDirs(0), mNbFiles(0), mNbChildren(0), mNbHashes(0)
+    , mStringTableSize(0), mTotalFiles(0), mTotalSize(0), mContentOffset(0), mContentSize(0), mDirsOffset(0)
+    , mFilesOffset(0), mChildrenOffset(0), mHashesOffset(0), mStringsOffset(0), mAccessCounter(0)
+    , mNbDecryptedChunks(0), mCorrupted(false)
+{
+	memset(mNonce,0,8) ;
+	memset(mKey,0,32) ;
+}
+
+CompactFileList::~CompactFileList()
+{
+	memset(mKey,0,32) ;
+
+	if(mData != NULL)
+	{
+#ifndef WINDOWS_SYS
+		munmap(mData,mDataSize) ;
+#else
+		free(mData) ;
+#endif
+	}
+}
+
+bool CompactFileList::isCompactFile(const std::string& fname)
+{
+	FILE *F = RsDirUtil::rs_fopen(fname.c_str(),"rb") ;
+
+	if(!F)
+		return false ;
+
+	unsigned char magic[8] ;
+	bool res = fread(magic,1,8,F) == 8 && !memcmp(magic,COMPACT_FILE_LIST_MAGIC,8) ;
+
+	fclose(F) ;
+	return res ;
+}
+
+CompactFileList *CompactFileList::open(const std::string& fname,KeyEncryption *ke)
+{
+	SslKeyEncryption ssl_ke ;
+
+	if(ke == NULL)
+		ke = &ssl_ke ;
+
+	CompactFileList *list = new CompactFileList ;
+
+	// Map the file. Pages are only read from the disk when the corresponding chunks are decrypted.
+
+#ifndef WINDOWS_SYS
+	int fd = ::open(fname.c_str(),O_RDONLY) ;
+	struct stat st ;
+
+	if(fd >= 0 && fstat(fd,&st) == 0 && st.st_size > 0)
+	{
+		void *data = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0) ;
+
+		if(data != MAP_FAILED)
+		{
+			list->mData = (unsigned char*)data ;
+			list->mDataSize = st.st_size ;
+		}
+	}
+	if(fd >= 0)
+		close(fd) ;		// the mapping stays valid
+#else
+	uint64_t file_size = 0 ;
+
+	if(RsDirUtil::checkFile(fname,file_size,true))
+	{
+		FILE *F = RsDirUtil::rs_fopen(fname.c_str(),"rb") ;
+		unsigned char *data = F?(unsigned char*)rs_malloc(file_size):NULL ;
+
+		if(data != NULL && fread(data,1,file_size,F) == file_size)
+		{
+			list->mData = data ;
+			list->mDataSize = file_size ;
+		}
+		else
+			free(data) ;
+
+		if(F)
+			fclose(F) ;
+	}
+#endif
+	if(list->mData == NULL)
+	{
+		std::cerr << "(EE) Cannot map file list " << fname << std::endl;
+		delete list ;
+		return NULL ;
+	}
+
+	// Read and check the header
+
+	CompactFileListHeader header ;
+
+	if(list->mDataSize < sizeof(header))
+	{
+		delete list ;
+		return NULL ;
+	}
+	memcpy(&header,list->mData,sizeof(header)) ;
+
+	if(memcmp(header.magic,COMPACT_FILE_LIST_MAGIC,8) || header.version != COMPACT_FILE_LIST_VERSION_0001 || header.chunk_size == 0)
+	{
+		std::cerr << "(EE) File list " << fname << " has an unknown format." << std::endl;
+		delete list ;
+		return NULL ;
+	}
+
+	list->mChunkSize       = header.chunk_size ;
+	list->mNbEntries       = header.nb_entries ;
+	list->mNbDirs          = header.nb_dirs ;
+	list->mNbFiles         = header.nb_files ;
+	list->mNbChildren      = header.nb_children ;
+	list->mNbHashes        = header.nb_hashes ;
+	list->mStringTableSize = header.string_table_size ;
+	list->mTotalFiles      = header.total_files ;
+	list->mTotalSize       = header.total_size ;
+	memcpy(list->mNonce,header.nonce,8) ;
+	list->mHeader.assign(list->mData,list->mData + sizeof(header)) ;
+
+	list->mDirsOffset     = (uint64_t)header.nb_entries * sizeof(uint32_t) ;
+	list->mFilesOffset    = list->mDirsOffset     + (uint64_t)header.nb_dirs     * sizeof(CompactDirRecord) ;
+	list->mChildrenOffset = list->mFilesOffset    + (uint64_t)header.nb_files    * sizeof(CompactFileRecord) ;
+	list->mHashesOffset   = list->mChildrenOffset + (uint64_t)header.nb_children * sizeof(uint32_t) ;
+	list->mStringsOffset  = list->mHashesOffset   + (uint64_t)header.nb_hashes   * sizeof(CompactHashRecord) ;
+	list->mContentSize    = list->mStringsOffset  + header.string_table_size ;
+	list->mContentOffset  = sizeof(header) + (uint64_t)header.encrypted_key_size ;
+
+	uint64_t nb_chunks = (list->mContentSize + list->mChunkSize - 1) / list->mChunkSize ;
+
+	if(list->mContentOffset + list->mContentSize + nb_chunks * AUTHENTICATION_TAG_SIZE != list->mDataSize)
+	{
+		std::cerr << "(EE) File list " << fname << " has a wrong size. Truncated file?" << std::endl;
+		delete list ;
+		return NULL ;
+	}
+
+	std::vector<unsigned char> key ;
+
+	if(!ke->decrypt(list->mData + sizeof(header),header.encrypted_key_size,key) || key.size() != 32)
+	{
+		std::cerr << "(EE) Cannot decrypt key of file list " << fname << std::endl;
+		delete list ;
+		return NULL ;
+	}
+	memcpy(list->mKey,key.data(),32) ;
+	memset(key.data(),0,key.size()) ;
+
+#ifdef DEBUG_COMPACT_FILE_LIST
+	std::cerr << "[compact file list] mapped " << fname << ": " << list->mNbDirs << " dirs, " << list->mNbFiles << " files, " << nb_chunks << " chunks." << std::endl;
+#endif
+	return list ;
+}
+
+const unsigned char *CompactFileList::getChunk(uint32_t n) const
+{
+	std::map<uint32_t,CachedChunk>::iterator it = mCachedChunks.find(n) ;
+
+	if(it != mCachedChunks.end())
+	{
+		it->second.last_used = ++mAccessCounter ;
+		return it->second.data.data() ;
+	}
+
+	uint64_t offset = (uint64_t)n * mChunkSize ;
+
+	if(mCorrupted || offset >= mContentSize)
+		return NULL ;
+
+	uint32_t size = std::min((uint64_t)mChunkSize,mContentSize - offset) ;
+	const unsigned char *src = mData + mContentOffset + (uint64_t)n * (mChunkSize + AUTHENTICATION_TAG_SIZE) ;
+
+	// Make room first, by dropping the least recently used chunk
+
+	if(mCachedChunks.size() >= COMPACT_FILE_LIST_CACHED_CHUNKS)
+	{
+		std::map<uint32_t,CachedChunk>::iterator oldest = mCachedChunks.begin() ;
+
+		for(std::map<uint32_t,CachedChunk>::iterator it2(mCachedChunks.begin());it2!=mCachedChunks.end();++it2)
+			if(it2->second.last_used < oldest->second.last_used)
+				oldest = it2 ;
+
+		mCachedChunks.erase(oldest) ;
+	}
+
+	CachedChunk& chunk(mCachedChunks[n]) ;
+	chunk.data.assign(src,src+size) ;
+	chunk.last_used = ++mAccessCounter ;
+
+	unsigned char nonce[12] ;
+	unsigned char tag[AUTHENTICATION_TAG_SIZE] ;
+	makeChunkNonce(mNonce,n,nonce) ;
+	memcpy(tag,src+size,AUTHENTICATION_TAG_SIZE) ;
+
+	// the key and header are not modified when decrypting
+
+	if(!librs::crypto::AEAD_chacha20_poly1305(const_cast<uint8_t*>(mKey),nonce,chunk.data.data(),size,const_cast<uint8_t*>(mHeader.data()),mHeader.size(),tag,false))
+	{
+		std::cerr << "(EE) Authentication failed for chunk " << n << " of file list. The file is corrupted." << std::endl;
+		mCachedChunks.erase(n) ;
+		mCorrupted = true ;
+		return NULL ;
+	}
+	++mNbDecryptedChunks ;
+
+	return chunk.data.data() ;
+}
+
+bool CompactFileList::readBytes(uint64_t offset,uint32_t size,void *out) const
+{
+	if(offset + size > mContentSize)
+		return false ;
+
+	unsigned char *dst = (unsigned char*)out ;
+
+	while(size > 0)
+	{
+		uint32_t n = offset / mChunkSize ;
+		uint32_t chunk_offset = offset % mChunkSize ;
+		uint32_t len = std::min(size,mChunkSize - chunk_offset) ;
+
+		const unsigned char *chunk = getChunk(n) ;
+
+		if(chunk == NULL)
+			return false ;
+
+		memcpy(dst,chunk + chunk_offset,len) ;
+
+		dst += len ;
+		offset += len ;
+		size -= len ;
+	}
+	return true ;
+}
+
+bool CompactFileList::readEntry(DirectoryStorage::EntryIndex indx,uint32_t& type,uint32_t& slot) const
+{
+	uint32_t e ;
+
+	if(indx >= mNbEntries || !readBytes((uint64_t)indx * sizeof(uint32_t),sizeof(uint32_t),&e) || e == NO_ENTRY)
+		return false ;
+
+	type = e >> ENTRY_TYPE_SHIFT ;
+	slot = e & ENTRY_SLOT_MASK ;
+
+	if(type == InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR)
+		return slot < mNbDirs ;
+	if(type == InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE)
+		return slot < mNbFiles ;
+
+	return false ;
+}
+
+bool CompactFileList::readString(uint32_t offset,uint32_t size,std::string& s) const
+{
+	if((uint64_t)offset + size > mStringTableSize)
+		return false ;
+
+	s.resize(size) ;
+
+	return size == 0 || readBytes(mStringsOffset + offset,size,&s[0]) ;
+}
+
+bool CompactFileList::readHashRecord(uint32_t n,RsFileHash& hash,DirectoryStorage::EntryIndex& indx) const
+{
+	CompactHashRecord r ;
+
+	if(n >= mNbHashes || !readBytes(mHashesOffset + (uint64_t)n * sizeof(r),sizeof(r),&r))
+		return false ;
+
+	hash = RsFileHash::fromBufferUnsafe(r.hash) ;
+	indx = r.index ;
+	return true ;
+}
+
+uint32_t CompactFileList::getType(DirectoryStorage::EntryIndex indx) const
+{
+	uint32_t type,slot ;
+
+	if(!readEntry(indx,type,slot))
+		return InternalFileHierarchyStorage::FileStorageNode::TYPE_UNKNOWN ;
+
+	return type ;
+}
+
+bool CompactFileList::getDirEntry(DirectoryStorage::EntryIndex indx,InternalFileHierarchyStorage::DirEntry& de,bool with_children) const
+{
+	uint32_t type,slot ;
+	CompactDirRecord r ;
+
+	if(!readEntry(indx,type,slot) || type != InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR)
+		return false ;
+
+	if(!readBytes(mDirsOffset + (uint64_t)slot * sizeof(r),sizeof(r),&r))
+		return false ;
+
+	if(!readString(r.name_offset,r.name_size,de.dir_name) || !readString(r.parent_path_offset,r.parent_path_size,de.dir_parent_path))
+		return false ;
+
+	de.parent_index         = r.parent_index ;
+	de.row                  = r.row ;
+	de.dir_hash             = RsFileHash::fromBufferUnsafe(r.hash) ;
+	de.dir_cumulated_size   = r.cumulated_size ;
+	de.dir_modtime          = r.modtime ;
+	de.dir_most_recent_time = r.most_recent_time ;
+	de.dir_update_time      = r.update_time ;
+
+	de.subdirs.clear() ;
+	de.subfiles.clear() ;
+
+	if(!with_children)
+		return true ;
+
+	if((uint64_t)r.first_child + r.nb_subdirs + r.nb_subfiles > mNbChildren)
+		return false ;
+
+	de.subdirs.resize(r.nb_subdirs) ;
+	de.subfiles.resize(r.nb_subfiles) ;
+
+	uint64_t offset = mChildrenOffset + (uint64_t)r.first_child * sizeof(uint32_t) ;
+
+	return (r.nb_subdirs  == 0 || readBytes(offset                                        ,r.nb_subdirs  * sizeof(uint32_t),de.subdirs.data()))
+	    && (r.nb_subfiles == 0 || readBytes(offset + (uint64_t)r.nb_subdirs*sizeof(uint32_t),r.nb_subfiles * sizeof(uint32_t),de.subfiles.data())) ;
+}
+
+bool CompactFileList::getFileEntry(DirectoryStorage::EntryIndex indx,InternalFileHierarchyStorage::FileEntry& fe) const
+{
+	uint32_t type,slot ;
+	CompactFileRecord r ;
+
+	if(!readEntry(indx,type,slot) || type != InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE)
+		return false ;
+
+	if(!readBytes(mFilesOffset + (uint64_t)slot * sizeof(r),sizeof(r),&r))
+		return false ;
+
+	fe.parent_index = r.parent_index ;
+	fe.row          = r.row ;
+	fe.file_size    = r.size ;
+	fe.file_modtime = r.modtime ;
+	fe.file_hash    = RsFileHash::fromBufferUnsafe(r.hash) ;
+
+	return readString(r.name_offset,r.name_size,fe.file_name) ;
+}
+
+bool CompactFileList::getName(DirectoryStorage::EntryIndex indx,std::string& name) const
+{
+	InternalFileHierarchyStorage::FileEntry fe ;
+	InternalFileHierarchyStorage::DirEntry de("") ;
+
+	switch(getType(indx))
+	{
+	case InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE: if(!getFileEntry(indx,fe))      return false ; name = fe.file_name ; return true ;
+	case InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR:  if(!getDirEntry(indx,de,false)) return false ; name = de.dir_name ;  return true ;
+	default:
+		return false ;
+	}
+}
+
+int CompactFileList::parentRow(DirectoryStorage::EntryIndex indx) const
+{
+	InternalFileHierarchyStorage::FileEntry fe ;
+	InternalFileHierarchyStorage::DirEntry de("") ;
+
+	DirectoryStorage::EntryIndex parent ;
+
+	if(getFileEntry(indx,fe))
+		parent = fe.parent_index ;
+	else if(getDirEntry(indx,de,false) && indx != 0)
+		parent = de.parent_index ;
+	else
+		return -1 ;
+
+	InternalFileHierarchyStorage::DirEntry pe("") ;
+
+	if(!getDirEntry(parent,pe,false))
+		return -1 ;
+
+	return pe.row ;
+}
+
+bool CompactFileList::getChildIndex(DirectoryStorage::EntryIndex indx,int row,DirectoryStorage::EntryIndex& c) const
+{
+	uint32_t type,slot ;
+	CompactDirRecord r ;
+
+	if(row < 0 || !readEntry(indx,type,slot) || type != InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR)
+		return false ;
+
+	if(!readBytes(mDirsOffset + (uint64_t)slot * sizeof(r),sizeof(r),&r) || (uint32_t)row >= r.nb_subdirs + r.nb_subfiles)
+		return false ;
+
+	if((uint64_t)r.first_child + row >= mNbChildren)
+		return false ;
+
+	return readBytes(mChildrenOffset + ((uint64_t)r.first_child + row) * sizeof(uint32_t),sizeof(uint32_t),&c) ;
+}
+
+bool CompactFileList::getTS(DirectoryStorage::EntryIndex indx,rstime_t& TS,rstime_t InternalFileHierarchyStorage::DirEntry::* m) const
+{
+	InternalFileHierarchyStorage::DirEntry de("") ;
+
+	if(!getDirEntry(indx,de,false))
+		return false ;
+
+	TS = de.*m ;
+	return true ;
+}
+
+bool CompactFileList::getDirHashFromIndex(DirectoryStorage::EntryIndex indx,RsFileHash& hash) const
+{
+	InternalFileHierarchyStorage::DirEntry de("") ;
+
+	if(!getDirEntry(indx,de,false))
+		return false ;
+
+	hash = de.dir_hash ;
+	return true ;
+}
+
+void CompactFileList::getStatistics(SharedDirStats& stats) const
+{
+	stats.total_number_of_files = mTotalFiles ;
+	stats.total_shared_size = mTotalSize ;
+}
+
+bool CompactFileList::materialise(InternalFileHierarchyStorage& storage) const
+{
+	// Read everything first, so that the storage is left untouched if the file list is corrupted.
+
+	std::vector<InternalFileHierarchyStorage::DirEntry> dirs ;
+	std::vector<InternalFileHierarchyStorage::FileEntry> files ;
+	std::vector<uint32_t> types(mNbEntries,uint32_t(InternalFileHierarchyStorage::FileStorageNode::TYPE_UNKNOWN)) ;
+	std::vector<std::pair<RsFileHash,DirectoryStorage::EntryIndex> > file_hashes ;
+	bool ok = true ;
+
+	for(uint32_t i=0;ok && i<mNbEntries;++i)
+		switch(types[i] = getType(i))
+		{
+		case InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR:
+			dirs.push_back(InternalFileHierarchyStorage::DirEntry("")) ;
+			ok = getDirEntry(i,dirs.back()) ;
+			break ;
+		case InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE:
+			files.push_back(InternalFileHierarchyStorage::FileEntry()) ;
+			ok = getFileEntry(i,files.back()) ;
+			break ;
+		default:
+			break ;
+		}
+
+	RsFileHash hash ;
+	DirectoryStorage::EntryIndex indx ;
+
+	for(uint32_t i=0;ok && i<mNbHashes;++i)
+		if((ok = readHashRecord(i,hash,indx)))
+			file_hashes.push_back(std::make_pair(hash,indx)) ;
+
+	if(!ok || types.empty() || types[0] != InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR)
+	{
+		std::cerr << "(EE) Cannot load file list: corrupted or inconsistent content." << std::endl;
+		return false ;
+	}
+
+	storage.clear() ;
+	storage.mEntries.resize(mNbEntries,InternalFileHierarchyStorage::NO_ENTRY) ;
+	storage.mFiles.reserve(files.size()) ;
+	storage.mDirs.reserve(dirs.size()) ;
+
+	uint32_t nd = 0 ;
+	uint32_t nf = 0 ;
+
+	for(uint32_t i=0;i<mNbEntries;++i)
+		if(types[i] == InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR)
+		{
+			storage.createDirEntry(i,dirs[nd]) ;
+			storage.mDirHashes.insert(dirs[nd++].dir_hash,i) ;
+		}
+		else if(types[i] == InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE)
+			storage.createFileEntry(i,files[nf++]) ;
+		else
+			storage.mFreeNodes.push_back(i) ;
+
+	for(uint32_t i=0;i<file_hashes.size();++i)
+		storage.mFileHashes.insert(file_hashes[i].first,file_hashes[i].second) ;
+
+	storage.mTotalFiles = mTotalFiles ;
+	storage.mTotalSize = mTotalSize ;
+
+	return true ;
+}
+
+/******************************************************************************************************************/
+/*                                                      Search                                                    */
+/******************************************************************************************************************/
+
+bool CompactFileList::searchHash(const RsFileHash& hash,DirectoryStorage::EntryIndex& result) const
+{
+	// binary search in the sorted table of hashes
+
+	uint32_t lo = 0, hi = mNbHashes ;
+
+	while(lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo)/2 ;
+		RsFileHash h ;
+		DirectoryStorage::EntryIndex indx ;
+
+		if(!readHashRecord(mid,h,indx))
+			return false ;
+
+		if(h == hash)
+		{
+			result = indx ;
+			return true ;
+		}
+		if(h < hash)
+			lo = mid+1 ;
+		else
+			hi = mid ;
+	}
+	return false ;
+}
+
+bool CompactFileList::isSearchableFile(DirectoryStorage::EntryIndex indx,InternalFileHierarchyStorage::FileEntry& fe) const
+{
+	// Only the file referenced by its hash is searched, as when going through the table of hashes.
+
+	DirectoryStorage::EntryIndex hash_indx ;
+
+	return getFileEntry(indx,fe) && searchHash(fe.file_hash,hash_indx) && hash_indx == indx ;
+}
+
+bool CompactFileList::fileMatchesBoolExp(const InternalFileHierarchyStorage::FileEntry& fe,RsRegularExpression::Expression *exp) const
+{
+	InternalFileHierarchyStorage::DirEntry parent("") ;
+
+	if(!getDirEntry(fe.parent_index,parent,false))
+		return false ;
+
+	return InternalFileHierarchyStorage::fileMatchesBoolExp(fe,parent,exp) ;
+}
+
+int CompactFileList::searchTerms(const std::list<std::string>& terms,std::list<DirectoryStorage::EntryIndex>& results) const
+{
+	InternalFileHierarchyStorage::FileEntry fe ;
+	RsFileHash hash ;
+	DirectoryStorage::EntryIndex indx ;
+
+	for(uint32_t i=0;i<mNbHashes;++i)
+		if(readHashRecord(i,hash,indx) && getFileEntry(indx,fe) && InternalFileHierarchyStorage::fileNameMatchesTerms(fe.file_name,terms))
+			results.push_back(indx) ;
+
+	return 0 ;
+}
+
+int CompactFileList::searchBoolExp(RsRegularExpression::Expression *exp,std::list<DirectoryStorage::EntryIndex>& results) const
+{
+	InternalFileHierarchyStorage::FileEntry fe ;
+	RsFileHash hash ;
+	DirectoryStorage::EntryIndex indx ;
+
+	for(uint32_t i=0;i<mNbHashes;++i)
+		if(readHashRecord(i,hash,indx) && getFileEntry(indx,fe) && fileMatchesBoolExp(fe,exp))
+			results.push_back(indx) ;
+
+	return 0 ;
+}
+
+int CompactFileList::searchTerms(const std::list<std::string>& terms,const std::vector<DirectoryStorage::EntryIndex>& candidates,std::list<DirectoryStorage::EntryIndex>& results) const
+{
+	InternalFileHierarchyStorage::FileEntry fe ;
+
+	for(uint32_t i=0;i<candidates.size();++i)
+		if(isSearchableFile(candidates[i],fe) && InternalFileHierarchyStorage::fileNameMatchesTerms(fe.file_name,terms))
+			results.push_back(candidates[i]) ;
+
+	return 0 ;
+}
+
+int CompactFileList::searchBoolExp(RsRegularExpression::Expression *exp,const std::vector<DirectoryStorage::EntryIndex>& candidates,std::list<DirectoryStorage::EntryIndex>& results) const
+{
+	InternalFileHierarchyStorage::FileEntry fe ;
+
+	for(uint32_t i=0;i<candidates.size();++i)
+		if(isSearchableFile(candidates[i],fe) && fileMatchesBoolExp(fe,exp))
+			results.push_back(candidates[i]) ;
+
+	return 0 ;
+}
+
+void CompactFileList::indexFiles(FileSearchIndex *index,uint32_t storage_id) const
+{
+	// Entries, file records and names are all read in increasing order, so that each chunk is decrypted about once.
+
+	for(uint32_t i=0;i<mNbEntries;++i)
+	{
+		InternalFileHierarchyStorage::FileEntry fe ;
+
+		if(getFileEntry(i,fe))
+			index->addFile(storage_id,i,fe.file_name,fe.file_hash) ;
+	}
+}
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: compact_file_list.h                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "retroshare/rsexpr.h"
+#include "dir_hierarchy.h"
+
+class FileSearchIndex ;
+
+// On-disk storage of friend file lists, that can be browsed and searched without loading it in memory.
+//
+// The file starts with a plain header, followed by the file key, encrypted with the node's own SSL key, and by
+// the content. The content is cut into chunks of COMPACT_FILE_LIST_CHUNK_SIZE bytes, each of them encrypted and
+// authenticated separately with chacha20/poly1305. The file is memory mapped, and chunks are only decrypted when
+// they are needed, keeping the last COMPACT_FILE_LIST_CACHED_CHUNKS ones.
+//
+// Content (before encryption), all tables having fixed size records:
+//    entries  : one uint32_t per EntryIndex: type of the entry and position in the dir or file table
+//    dirs     : directory records
+//    files    : file records
+//    children : entry indices of the sub-directories, then of the sub-files, of each directory
+//    hashes   : (file hash, entry index), sorted by hash. This is the table of hashes of the hierarchy.
+//    strings  : names and parent paths, each of them stored once.
+//
+// Entry indices are the same as in the hierarchy that was saved, so that the file list can be loaded in memory
+// (i.e. materialised) at any time without changing the indices already given to the GUI or to the search index.
+//
+// Like the rest of the file list IO, the encoding is system-dependent and should not be exchanged between computers.
+//
+// The class is not thread safe. DirectoryStorage calls it with its own mutex locked.
+
+class CompactFileList
+{
+public:
+	// Encryption of the file key. The default one uses the node's own SSL key.
+
+	class KeyEncryption
+	{
+	public:
+		virtual ~KeyEncryption() {}
+
+		virtual bool encrypt(const unsigned char *data,uint32_t size,std::vector<unsigned char>& out) =0;
+		virtual bool decrypt(const unsigned char *data,uint32_t size,std::vector<unsigned char>& out) =0;
+	};
+
+	~CompactFileList() ;
+
+	static bool isCompactFile(const std::string& fname) ;
+
+	// Writes the given hierarchy into a compact file list.
+
+	static bool save(const InternalFileHierarchyStorage& storage,const std::string& fname,KeyEncryption *ke = NULL) ;
+
+	// Maps the given file and reads its header. Returns NULL if the file cannot be used.
+
+	static CompactFileList *open(const std::string& fname,KeyEncryption *ke = NULL) ;
+
+	// Loads the whole file list into the given (empty) hierarchy, with the same entry indices.
+
+	bool materialise(InternalFileHierarchyStorage& storage) const ;
+
+	// Entry access. Types are InternalFileHierarchyStorage::FileStorageNode::TYPE_*.
+
+	uint32_t getType(DirectoryStorage::EntryIndex indx) const ;
+	bool getDirEntry(DirectoryStorage::EntryIndex indx,InternalFileHierarchyStorage::DirEntry& de,bool with_children = true) const ;
+	bool getFileEntry(DirectoryStorage::EntryIndex indx,InternalFileHierarchyStorage::FileEntry& fe) const ;
+	bool getName(DirectoryStorage::EntryIndex indx,std::string& name) const ;
+
+	int parentRow(DirectoryStorage::EntryIndex indx) const ;
+	bool getChildIndex(DirectoryStorage::EntryIndex indx,int row,DirectoryStorage::EntryIndex& c) const ;
+
+	bool getTS(DirectoryStorage::EntryIndex indx,rstime_t& TS,rstime_t InternalFileHierarchyStorage::DirEntry::* m) const ;
+	bool getDirHashFromIndex(DirectoryStorage::EntryIndex indx,RsFileHash& hash) const ;
+
+	void getStatistics(SharedDirStats& stats) const ;
+
+	// Search. Same semantics as the searches of InternalFileHierarchyStorage.
+
+	bool searchHash(const RsFileHash& hash,DirectoryStorage::EntryIndex& result) const ;
+	int searchTerms(const std::list<std::string>& terms,std::list<DirectoryStorage::EntryIndex>& results) const ;
+	int searchBoolExp(RsRegularExpression::Expression *exp,std::list<DirectoryStorage::EntryIndex>& results) const ;
+	int searchTerms(const std::list<std::string>& terms,const std::vector<DirectoryStorage::EntryIndex>& candidates,std::list<DirectoryStorage::EntryIndex>& results) const ;
+	int searchBoolExp(RsRegularExpression::Expression *exp,const std::vector<DirectoryStorage::EntryIndex>& candidates,std::list<DirectoryStorage::EntryIndex>& results) const ;
+
+	void indexFiles(FileSearchIndex *index,uint32_t storage_id) const ;
+
+	uint32_t nbDecryptedChunks() const { return mNbDecryptedChunks ; }	// statistics, for tests
+
+private:
+	CompactFileList() ;
+
+	bool readBytes(uint64_t offset,uint32_t size,void *out) const ;
+	const unsigned char *getChunk(uint32_t n) const ;
+
+	bool readEntry(DirectoryStorage::EntryIndex indx,uint32_t& type,uint32_t& slot) const ;
+	bool readString(uint32_t offset,uint32_t size,std::string& s) const ;
+	bool readHashRecord(uint32_t n,RsFileHash& hash,DirectoryStorage::EntryIndex& indx) const ;
+	bool isSearchableFile(DirectoryStorage::EntryIndex indx,InternalFileHierarchyStorage::FileEntry& fe) const ;
+	bool fileMatchesBoolExp(const InternalFileHierarchyStorage::FileEntry& fe,RsRegularExpression::Expression *exp) const ;
+
+	// mapped file
+
+	unsigned char *mData ;
+	uint64_t mDataSize ;
+
+	// header
+
+	uint32_t mChunkSize ;
+	uint32_t mNbEntries ;
+	uint32_t mNbDirs ;
+	uint32_t mNbFiles ;
+	uint32_t mNbChildren ;
+	uint32_t mNbHashes ;
+	uint32_t mStringTableSize ;
+	uint32_t mTotalFiles ;
+	uint64_t mTotalSize ;
+
+	std::vector<unsigned char> mHeader ;	// authenticated along with each chunk
+	unsigned char mNonce[8] ;
+	unsigned char mKey[32] ;
+
+	uint64_t mContentOffset ;	// position of the first chunk in the file
+	uint64_t mContentSize ;		// size of the content, before encryption
+	uint64_t mDirsOffset ;		// positions of the tables in the content
+	uint64_t mFilesOffset ;
+	uint64_t mChildrenOffset ;
+	uint64_t mHashesOffset ;
+	uint64_t mStringsOffset ;
+
+	// decrypted chunks
+
+	struct CachedChunk
+	{
+		std::vector<unsigned char> data ;
+		uint64_t last_used ;
+	};
+	mutable std::map<uint32_t,CachedChunk> mCachedChunks ;
+	mutable uint64_t mAccessCounter ;
+	mutable uint32_t mNbDecryptedChunks ;
+	mutable bool mCorrupted ;
+};
@@ -28,6 +28,7 @@
 #include "util/rsprint.h"
 #include "retroshare/rsexpr.h"
 #include "dir_hierarchy.h"
+#include "file_search_index.h"
 #include "filelist_io.h"
 #include "file_sharing_defaults.h"
 #include "util/cxx17retrocompat.h"
@@ -58,48 +59,136 @@ template<class T> typename std::set<T>::iterator erase_from_set(typename std::se
 
 InternalFileHierarchyStorage::InternalFileHierarchyStorage() : mRoot(0)
 {
-    DirEntry *de = new DirEntry("") ;
+    mSearchIndex = NULL ;
+    mSearchIndexId = 0 ;
 
-    de->row=0;
-    de->parent_index=0;
-    de->dir_modtime=0;
-    de->dir_hash=RsFileHash() ; // null hash is root by convention.
+    clear() ;
 
-    mNodes.push_back(de) ;
-    mDirHashes[de->dir_hash] = 0 ;
+    DirEntry de("") ;
+
+    de.row=0;
+    de.parent_index=0;
+    de.dir_modtime=0;
+    de.dir_hash=RsFileHash() ; // null hash is root by convention.
+
+    mEntries.push_back(NO_ENTRY) ;
+    createDirEntry(0,de) ;
+    mDirHashes.insert(de.dir_hash,0) ;
+}
+
+void InternalFileHierarchyStorage::clear()
+{
+    std::vector<uint32_t>().swap(mEntries) ;
+    std::vector<FileRecord>().swap(mFiles) ;
+    std::vector<DirRecord>().swap(mDirs) ;
+    std::vector<uint32_t>().swap(mFreeFileSlots) ;
+    std::vector<uint32_t>().swap(mFreeDirSlots) ;
+
+    mFreeNodes.clear() ;
+    mNames.clear() ;
+    mFileHashes.clear() ;
+    mDirHashes.clear() ;
 
     mTotalSize = 0 ;
     mTotalFiles = 0 ;
 }
 
+void InternalFileHierarchyStorage::createFileEntry(DirectoryStorage::EntryIndex indx,const FileEntry& fe)
+{
+    uint32_t slot ;
+
+    if(!mFreeFileSlots.empty())
+    {
+        slot = mFreeFileSlots.back() ;
+        mFreeFileSlots.pop_back() ;
+    }
+    else
+    {
+        slot = mFiles.size() ;
+        mFiles.push_back(FileRecord()) ;
+    }
+
+    FileRecord& f(mFiles[slot]) ;
+
+    f.file_hash    = fe.file_hash ;
+    f.file_name    = mNames.intern(fe.file_name) ;
+    f.file_size    = fe.file_size ;
+    f.file_modtime = fe.file_modtime ;
+    f.parent_index = fe.parent_index ;
+    f.row          = fe.row ;
+
+    mEntries[indx] = (FileStorageNode::TYPE_FILE << ENTRY_TYPE_SHIFT) | slot ;
+}
+
+void InternalFileHierarchyStorage::createDirEntry(DirectoryStorage::EntryIndex indx,const DirEntry& de)
+{
+    uint32_t slot ;
+
+    if(!mFreeDirSlots.empty())
+    {
+        slot = mFreeDirSlots.back() ;
+        mFreeDirSlots.pop_back() ;
+    }
+    else
+    {
+        slot = mDirs.size() ;
+        mDirs.push_back(DirRecord()) ;
+    }
+
+    DirRecord& d(mDirs[slot]) ;
+
+    d.dir_hash             = de.dir_hash ;
+    d.dir_name             = mNames.intern(de.dir_name) ;
+    d.dir_parent_path      = mNames.intern(de.dir_parent_path) ;
+    d.parent_index         = de.parent_index ;
+    d.row                  = de.row ;
+    d.dir_cumulated_size   = de.dir_cumulated_size ;
+    d.dir_modtime          = de.dir_modtime ;
+    d.dir_most_recent_time = de.dir_most_recent_time ;
+    d.dir_update_time      = de.dir_update_time ;
+    d.subdirs              = de.subdirs ;
+    d.subfiles             = de.subfiles ;
+
+    mEntries[indx] = (FileStorageNode::TYPE_DIR << ENTRY_TYPE_SHIFT) | slot ;
+}
+
+void InternalFileHierarchyStorage::setSearchIndex(FileSearchIndex *index,uint32_t storage_id)
+{
+    mSearchIndex = index ;
+    mSearchIndexId = storage_id ;
+
+    if(mSearchIndex != NULL)
+        for(uint32_t i=0;i<mEntries.size();++i)
+            if(isFile(i))
+            {
+                const FileRecord& fe(fileRecord(i)) ;
+                mSearchIndex->addFile(mSearchIndexId,i,mNames.get(fe.file_name),fe.file_hash) ;
+            }
+}
+
 bool InternalFileHierarchyStorage::getDirHashFromIndex(
         const DirectoryStorage::EntryIndex& index, RsFileHash& hash ) const
 {
     if(!checkIndex(index,FileStorageNode::TYPE_DIR))
         return false ;
 
-    hash = static_cast<DirEntry*>(mNodes[index])->dir_hash ;
+    hash = dirRecord(index).dir_hash ;
 
     return true;
 }
 
 bool InternalFileHierarchyStorage::getIndexFromDirHash(const RsFileHash& hash,DirectoryStorage::EntryIndex& index)
 {
-    std::map<RsFileHash,DirectoryStorage::EntryIndex>::iterator it = mDirHashes.find(hash) ;
-
-    if(it == mDirHashes.end())
-        return false;
-
-    index = it->second;
+	if(!mDirHashes.find(hash,index)) return false;
 
 	/* make sure the hash actually points to some existing directory. If not,
 	 * remove it. This is an opportunistic update of dir hashes: when we need
 	 * them, we check them. */
 	if( !checkIndex(index, FileStorageNode::TYPE_DIR) ||
-	        static_cast<DirEntry*>(mNodes[index])->dir_hash != hash )
+	        dirRecord(index).dir_hash != hash )
 	{
 		RS_INFO("removing non existing dir hash: ", hash, " from dir hash list");
-		mDirHashes.erase(it);
+		mDirHashes.erase(hash);
 		return false;
 	}
     return true;
@@ -108,19 +197,16 @@ bool InternalFileHierarchyStorage::getIndexFromDirHash(const RsFileHash& hash,Di
 bool InternalFileHierarchyStorage::getIndexFromFileHash(
         const RsFileHash& hash, DirectoryStorage::EntryIndex& index )
 {
-	auto it = std::as_const(mFileHashes).find(hash);
-	if(it == mFileHashes.end()) return false;
-
-	index = it->second;
+	if(!mFileHashes.find(hash,index)) return false;
 
 	/* make sure the hash actually points to some existing file. If not, remove
 	 * it. This is an opportunistic update of file hashes: when we need them,
 	 * we check them. */
-	if( !checkIndex(it->second, FileStorageNode::TYPE_FILE) ||
-	        static_cast<FileEntry*>(mNodes[index])->file_hash != hash )
+	if( !checkIndex(index, FileStorageNode::TYPE_FILE) ||
+	        fileRecord(index).file_hash != hash )
 	{
 		RS_INFO("removing non existing file hash: ", hash, " from file hash list");
-		mFileHashes.erase(it);
+		mFileHashes.erase(hash);
 		return false;
 	}
 
@@ -132,7 +218,7 @@ bool InternalFileHierarchyStorage::getChildIndex(DirectoryStorage::EntryIndex e,
     if(!checkIndex(e,FileStorageNode::TYPE_DIR))
         return false ;
 
-    const DirEntry& d = *static_cast<DirEntry*>(mNodes[e]) ;
+    const DirRecord& d(dirRecord(e)) ;
 
     if((uint32_t)row < d.subdirs.size())
     {
@@ -153,14 +239,14 @@ int InternalFileHierarchyStorage::parentRow(DirectoryStorage::EntryIndex e)
     if(!checkIndex(e,FileStorageNode::TYPE_DIR | FileStorageNode::TYPE_FILE) || e==0)
         return -1 ;
 
-    return mNodes[mNodes[e]->parent_index]->row;
+    return row(parentIndex(e));
 }
 
 // high level modification routines
 
 bool InternalFileHierarchyStorage::isIndexValid(DirectoryStorage::EntryIndex e) const
 {
-    return e < mNodes.size() && mNodes[e] != NULL ;
+    return e < mEntries.size() && mEntries[e] != NO_ENTRY ;
 }
 
 bool InternalFileHierarchyStorage::updateSubDirectoryList(
@@ -171,48 +257,57 @@ bool InternalFileHierarchyStorage::updateSubDirectoryList(
 	if(!checkIndex(indx,FileStorageNode::TYPE_DIR))
 		return false;
 
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[indx])) ;
-
     std::set<std::string> should_create(subdirs);
 
-    for(uint32_t i=0;i<d.subdirs.size();)
-        if(subdirs.find(static_cast<DirEntry*>(mNodes[d.subdirs[i]])->dir_name) == subdirs.end())
+    for(uint32_t i=0;i<dirRecord(indx).subdirs.size();)
+    {
+        DirectoryStorage::EntryIndex subdir_index = dirRecord(indx).subdirs[i] ;
+        std::string subdir_name = mNames.get(dirRecord(subdir_index).dir_name) ;
+
+        if(subdirs.find(subdir_name) == subdirs.end())
         {
 #ifdef DEBUG_DIRECTORY_STORAGE
-            std::cerr << "[directory storage] Removing subdirectory " << static_cast<DirEntry*>(mNodes[d.subdirs[i]])->dir_name << " with index " << d.subdirs[i] << std::endl;
+            std::cerr << "[directory storage] Removing subdirectory " << subdir_name << " with index " << subdir_index << std::endl;
 #endif
 
-            if( !removeDirectory(d.subdirs[i]))
+            if( !removeDirectory(subdir_index))
                 i++ ;
         }
         else
         {
 #ifdef DEBUG_DIRECTORY_STORAGE
-            std::cerr << "[directory storage] Keeping existing subdirectory " << static_cast<DirEntry*>(mNodes[d.subdirs[i]])->dir_name << " with index " << d.subdirs[i] << std::endl;
+            std::cerr << "[directory storage] Keeping existing subdirectory " << subdir_name << " with index " << subdir_index << std::endl;
 #endif
 
-            should_create.erase(static_cast<DirEntry*>(mNodes[d.subdirs[i]])->dir_name) ;
+            should_create.erase(subdir_name) ;
             ++i;
         }
+    }
+
+    const DirRecord& d(dirRecord(indx)) ;
+    std::string parent_path = RsDirUtil::makePath(mNames.get(d.dir_parent_path), mNames.get(d.dir_name)) ;
+    RsFileHash parent_hash = d.dir_hash ;
 
     for(std::set<std::string>::const_iterator it(should_create.begin());it!=should_create.end();++it)
     {
 #ifdef DEBUG_DIRECTORY_STORAGE
-        std::cerr << "[directory storage] adding new subdirectory " << it->first << " at index " << mNodes.size() << std::endl;
+        std::cerr << "[directory storage] adding new subdirectory " << *it << " at index " << mEntries.size() << std::endl;
 #endif
 
-        DirEntry *de = new DirEntry(*it) ;
+        DirEntry de(*it) ;
 
-        de->row = mNodes.size();
-        de->parent_index = indx;
-        de->dir_modtime = 0;// forces parsing.it->second;
-		de->dir_parent_path = RsDirUtil::makePath(d.dir_parent_path, d.dir_name) ;
-        de->dir_hash = createDirHash(de->dir_name,d.dir_hash,random_hash_seed) ;
+        de.row = mEntries.size();
+        de.parent_index = indx;
+        de.dir_modtime = 0;// forces parsing.it->second;
+		de.dir_parent_path = parent_path ;
+        de.dir_hash = createDirHash(de.dir_name,parent_hash,random_hash_seed) ;
 
-        mDirHashes[de->dir_hash] = mNodes.size() ;
+        mDirHashes.insert(de.dir_hash,mEntries.size()) ;
 
-        d.subdirs.push_back(mNodes.size()) ;
-        mNodes.push_back(de) ;
+        mEntries.push_back(NO_ENTRY) ;
+        createDirEntry(mEntries.size()-1,de) ;		// invalidates d
+
+        dirRecord(indx).subdirs.push_back(mEntries.size()-1) ;
     }
 
     return true;
@@ -263,8 +358,7 @@ bool InternalFileHierarchyStorage::removeDirectory(DirectoryStorage::EntryIndex
 #endif
     // remove from parent
 
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[indx])) ;
-    DirEntry& parent_dir(*static_cast<DirEntry*>(mNodes[d.parent_index]));
+    DirRecord& parent_dir(dirRecord(dirRecord(indx).parent_index));
 
     for(uint32_t i=0;i<parent_dir.subdirs.size();++i)
         if(parent_dir.subdirs[i] == indx)
@@ -286,10 +380,10 @@ bool InternalFileHierarchyStorage::removeDirectory(DirectoryStorage::EntryIndex
 
 bool InternalFileHierarchyStorage::checkIndex(DirectoryStorage::EntryIndex indx,uint8_t type) const
 {
-    if(mNodes.empty() || indx==DirectoryStorage::NO_INDEX || indx >= mNodes.size() || mNodes[indx] == NULL)
+    if(mEntries.empty() || indx==DirectoryStorage::NO_INDEX || indx >= mEntries.size() || mEntries[indx] == NO_ENTRY)
         return nodeAccessError("checkIndex(): Node does not exist") ;
 
-    if(! (mNodes[indx]->type() & type))
+    if(! ((mEntries[indx] >> ENTRY_TYPE_SHIFT) & type))
         return nodeAccessError("checkIndex(): Node is of wrong type") ;
 
     return true;
@@ -307,20 +401,21 @@ bool InternalFileHierarchyStorage::updateSubFilesList(
 		return false;
 	}
 
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[indx])) ;
+    DirRecord& d(dirRecord(indx)) ;		// stays valid, since only file entries are created below
     new_files = subfiles ;
 
     // remove from new_files the ones that already exist and have a modf time that is not older.
 
     for(uint32_t i=0;i<d.subfiles.size();)
     {
-        FileEntry& f(*static_cast<FileEntry*>(mNodes[d.subfiles[i]])) ;
-        std::map<std::string,DirectoryStorage::FileTS>::const_iterator it = subfiles.find(f.file_name) ;
+        FileRecord& f(fileRecord(d.subfiles[i])) ;
+        std::string file_name = mNames.get(f.file_name) ;
+        std::map<std::string,DirectoryStorage::FileTS>::const_iterator it = subfiles.find(file_name) ;
 
         if(it == subfiles.end())				// file does not exist anymore => delete
         {
 #ifdef DEBUG_DIRECTORY_STORAGE
-            std::cerr << "[directory storage] removing non existing file " << f.file_name << " at index " << d.subfiles[i] << std::endl;
+            std::cerr << "[directory storage] removing non existing file " << file_name << " at index " << d.subfiles[i] << std::endl;
 #endif
 
             deleteFileNode(d.subfiles[i]) ;
@@ -341,7 +436,7 @@ bool InternalFileHierarchyStorage::updateSubFilesList(
             mTotalSize -= f.file_size ;
             mTotalSize += it->second.size ;
         }
-        new_files.erase(f.file_name) ;
+        new_files.erase(file_name) ;
 
         ++i;
     }
@@ -349,13 +444,19 @@ bool InternalFileHierarchyStorage::updateSubFilesList(
     for(std::map<std::string,DirectoryStorage::FileTS>::const_iterator it(new_files.begin());it!=new_files.end();++it)
     {
 #ifdef DEBUG_DIRECTORY_STORAGE
-        std::cerr << "[directory storage] adding new file " << it->first << " at index " << mNodes.size() << std::endl;
+        std::cerr << "[directory storage] adding new file " << it->first << " at index " << mEntries.size() << std::endl;
 #endif
 
-        d.subfiles.push_back(mNodes.size()) ;
-        mNodes.push_back(new FileEntry(it->first,it->second.size,it->second.modtime));
-        mNodes.back()->row = mNodes.size()-1;
-        mNodes.back()->parent_index = indx;
+        FileEntry fe(it->first,it->second.size,it->second.modtime) ;
+        fe.row = mEntries.size() ;
+        fe.parent_index = indx ;
+
+        d.subfiles.push_back(mEntries.size()) ;
+        mEntries.push_back(NO_ENTRY) ;
+        createFileEntry(mEntries.size()-1,fe) ;
+
+        if(mSearchIndex != NULL)
+            mSearchIndex->addFile(mSearchIndexId,mEntries.size()-1,it->first,RsFileHash()) ;
 
         mTotalSize  += it->second.size;
         mTotalFiles += 1;
@@ -376,8 +477,11 @@ bool InternalFileHierarchyStorage::updateHash(
     std::cerr << "[directory storage] updating hash at index " << file_index << ", hash=" << hash << std::endl;
 #endif
 
-    RsFileHash& old_hash (static_cast<FileEntry*>(mNodes[file_index])->file_hash) ;
-    mFileHashes[hash] = file_index ;
+    RsFileHash& old_hash (fileRecord(file_index).file_hash) ;
+    mFileHashes.insert(hash,file_index) ;
+
+    if(mSearchIndex != NULL && old_hash != hash)
+        mSearchIndex->addHash(mSearchIndexId,file_index,hash) ;
 
     old_hash = hash ;
 
@@ -391,57 +495,90 @@ bool InternalFileHierarchyStorage::updateFile(const DirectoryStorage::EntryIndex
         return false;
     }
 
-    FileEntry& fe(*static_cast<FileEntry*>(mNodes[file_index])) ;
+    FileRecord& fe(fileRecord(file_index)) ;
 
 #ifdef DEBUG_DIRECTORY_STORAGE
-    std::cerr << "[directory storage] updating file entry at index " << file_index << ", name=" << fe.file_name << " size=" << fe.file_size << ", hash=" << fe.file_hash << std::endl;
+    std::cerr << "[directory storage] updating file entry at index " << file_index << ", name=" << mNames.get(fe.file_name) << " size=" << fe.file_size << ", hash=" << fe.file_hash << std::endl;
 #endif
     if(mTotalSize >= fe.file_size)
 		mTotalSize -= fe.file_size;
 
 	mTotalSize += size ;
 
+    bool same_name = mNames.equals(fe.file_name,fname) ;
+
+    if(mSearchIndex != NULL)
+    {
+        if(!same_name)
+        {
+            mSearchIndex->removeFile() ;
+            mSearchIndex->addFile(mSearchIndexId,file_index,fname,hash) ;
+        }
+        else if(fe.file_hash != hash)
+            mSearchIndex->addHash(mSearchIndexId,file_index,hash) ;
+    }
+
     fe.file_hash = hash;
     fe.file_size = size;
     fe.file_modtime = modf_time;
-    fe.file_name = fname;
+
+    if(!same_name)
+    {
+        mNames.release(fe.file_name) ;
+        fe.file_name = mNames.intern(fname) ;
+    }
 
     if(!hash.isNull())
-        mFileHashes[hash] = file_index ;
+        mFileHashes.insert(hash,file_index) ;
 
     return true;
 }
 
 void InternalFileHierarchyStorage::deleteFileNode(uint32_t index)
 {
-	if(mNodes[index] != NULL)
+	if(isFile(index))
 	{
-		FileEntry& fe(*static_cast<FileEntry*>(mNodes[index])) ;
+		FileRecord& fe(fileRecord(index)) ;
 
 #ifdef RS_DEEP_FILES_INDEX
 		DeepFilesIndex tfi(DeepFilesIndex::dbDefaultPath());
 		tfi.removeFileFromIndex(fe.file_hash);
 #endif
-
         if(mTotalSize >= fe.file_size)
 			mTotalSize -= fe.file_size ;
 
         if(mTotalFiles > 0)
 			mTotalFiles -= 1;
 
-		delete mNodes[index] ;
-		mFreeNodes.push_back(index) ;
-		mNodes[index] = NULL ;
+		if(mSearchIndex != NULL)
+			mSearchIndex->removeFile() ;
+
+		deleteNode(index) ;
 	}
 }
 void InternalFileHierarchyStorage::deleteNode(uint32_t index)
 {
-    if(mNodes[index] != NULL)
+    if(isFile(index))
     {
-        delete mNodes[index] ;
-        mFreeNodes.push_back(index) ;
-        mNodes[index] = NULL ;
+        mNames.release(fileRecord(index).file_name) ;
+        mFreeFileSlots.push_back(mEntries[index] & ENTRY_SLOT_MASK) ;
     }
+    else if(isDir(index))
+    {
+        DirRecord& d(dirRecord(index)) ;
+
+        mNames.release(d.dir_name) ;
+        mNames.release(d.dir_parent_path) ;
+        std::vector<DirectoryStorage::EntryIndex>().swap(d.subdirs) ;
+        std::vector<DirectoryStorage::EntryIndex>().swap(d.subfiles) ;
+
+        mFreeDirSlots.push_back(mEntries[index] & ENTRY_SLOT_MASK) ;
+    }
+    else
+        return ;
+
+    mEntries[index] = NO_ENTRY ;
+    mFreeNodes.push_back(index) ;
 }
 
 DirectoryStorage::EntryIndex InternalFileHierarchyStorage::allocateNewIndex()
@@ -451,12 +588,12 @@ DirectoryStorage::EntryIndex InternalFileHierarchyStorage::allocateNewIndex()
         uint32_t index = mFreeNodes.front();
         mFreeNodes.pop_front();
 
-        if(mNodes[index] == NULL)
+        if(index < mEntries.size() && mEntries[index] == NO_ENTRY)
             return DirectoryStorage::EntryIndex(index) ;
     }
 
-	mNodes.push_back(NULL) ;
-	return mNodes.size()-1 ;
+	mEntries.push_back(NO_ENTRY) ;
+	return mEntries.size()-1 ;
 }
 
 bool InternalFileHierarchyStorage::updateDirEntry(
@@ -472,23 +609,31 @@ bool InternalFileHierarchyStorage::updateDirEntry(
 		return false;
 	}
 
-	DirEntry& d(*static_cast<DirEntry*>(mNodes[indx]));
-
 #ifdef DEBUG_DIRECTORY_STORAGE
     std::cerr << "Updating dir entry: name=\"" << dir_name << "\", most_recent_time=" << most_recent_time << ", modtime=" << dir_modtime << std::endl;
 #endif
 
-    d.dir_most_recent_time = most_recent_time;
-    d.dir_modtime      = dir_modtime;
-    d.dir_update_time  = time(NULL);
-    d.dir_name         = dir_name;
+    // Directory entries are created below, which invalidates references to dir records. So the record is
+    // always accessed through its index.
+
+    {
+        DirRecord& d(dirRecord(indx)) ;
+
+        d.dir_most_recent_time = most_recent_time;
+        d.dir_modtime      = dir_modtime;
+        d.dir_update_time  = time(NULL);
+
+        mNames.release(d.dir_name) ;
+        d.dir_name         = mNames.intern(dir_name) ;
+    }
 
     std::map<RsFileHash,DirectoryStorage::EntryIndex> existing_subdirs ;
+    std::vector<DirectoryStorage::EntryIndex> subdirs ;
 
-    for(uint32_t i=0;i<d.subdirs.size();++i)
-        existing_subdirs[static_cast<DirEntry*>(mNodes[d.subdirs[i]])->dir_hash] = d.subdirs[i] ;
+    for(uint32_t i=0;i<dirRecord(indx).subdirs.size();++i)
+        existing_subdirs[dirRecord(dirRecord(indx).subdirs[i]).dir_hash] = dirRecord(indx).subdirs[i] ;
 
-    d.subdirs.clear();
+    std::string subdirs_parent_path = RsDirUtil::makePath(mNames.get(dirRecord(indx).dir_parent_path), dir_name) ;
 
     // check that all subdirs already exist. If not, create.
     for(uint32_t i=0;i<subdirs_hash.size();++i)
@@ -500,7 +645,7 @@ bool InternalFileHierarchyStorage::updateDirEntry(
         std::map<RsFileHash,DirectoryStorage::EntryIndex>::iterator it = existing_subdirs.find(subdirs_hash[i]) ;
         DirectoryStorage::EntryIndex dir_index = 0;
 
-        if(it != existing_subdirs.end() && mNodes[it->second] != NULL && mNodes[it->second]->type() == FileStorageNode::TYPE_DIR)
+        if(it != existing_subdirs.end() && isDir(it->second))
         {
             dir_index = it->second ;
 
@@ -514,23 +659,25 @@ bool InternalFileHierarchyStorage::updateDirEntry(
         {
             dir_index = allocateNewIndex() ;
 
-            DirEntry *de = new DirEntry("") ;
+            DirEntry de("") ;
 
-            mNodes[dir_index] = de ;
+			de.dir_parent_path = subdirs_parent_path ;
+            de.dir_hash        = subdirs_hash[i];
 
-			de->dir_parent_path = RsDirUtil::makePath(d.dir_parent_path, dir_name) ;
-            de->dir_hash        = subdirs_hash[i];
+            createDirEntry(dir_index,de) ;
 
-            mDirHashes[subdirs_hash[i]] = dir_index ;
+            mDirHashes.insert(subdirs_hash[i],dir_index) ;
 
 #ifdef DEBUG_DIRECTORY_STORAGE
             std::cerr << " created, at new index " << dir_index << std::endl;
 #endif
         }
 
-        d.subdirs.push_back(dir_index) ;
-        mDirHashes[subdirs_hash[i]] = dir_index ;
+        subdirs.push_back(dir_index) ;
+        mDirHashes.insert(subdirs_hash[i],dir_index) ;
     }
+    dirRecord(indx).subdirs.swap(subdirs) ;
+
     // remove subdirs that do not exist anymore
 
     for(std::map<RsFileHash,DirectoryStorage::EntryIndex>::const_iterator it = existing_subdirs.begin();it!=existing_subdirs.end();++it)
@@ -547,12 +694,14 @@ bool InternalFileHierarchyStorage::updateDirEntry(
         recursRemoveDirectory(it->second) ;
     }
 
-    // now update subfiles. This is more stricky because we need to not suppress hash duplicates
+    // now update subfiles. This is more stricky because we need to not suppress hash duplicates. No dir entry is
+    // created from now on.
 
+    DirRecord& d(dirRecord(indx)) ;
     std::map<std::string,DirectoryStorage::EntryIndex> existing_subfiles ;
 
     for(uint32_t i=0;i<d.subfiles.size();++i)
-        existing_subfiles[static_cast<FileEntry*>(mNodes[d.subfiles[i]])->file_name] = d.subfiles[i] ;
+        existing_subfiles[mNames.get(fileRecord(d.subfiles[i]).file_name)] = d.subfiles[i] ;
 
     d.subfiles.clear();
 
@@ -566,7 +715,7 @@ bool InternalFileHierarchyStorage::updateDirEntry(
         std::cerr << "  subfile name = " << subfiles_array[i].file_name << ": " ;
 #endif
 
-        if(it != existing_subfiles.end() && mNodes[it->second] != NULL && mNodes[it->second]->type() == FileStorageNode::TYPE_FILE)
+        if(it != existing_subfiles.end() && isFile(it->second))
         {
             file_index = it->second ;
 
@@ -583,11 +732,14 @@ bool InternalFileHierarchyStorage::updateDirEntry(
         {
             file_index = allocateNewIndex() ;
 
-            mNodes[file_index] = new FileEntry(f.file_name,f.file_size,f.file_modtime,f.file_hash) ;
-            mFileHashes[f.file_hash] = file_index ;
+            createFileEntry(file_index,f) ;
+            mFileHashes.insert(f.file_hash,file_index) ;
             mTotalSize += f.file_size ;
             mTotalFiles++;
 
+            if(mSearchIndex != NULL)
+                mSearchIndex->addFile(mSearchIndexId,file_index,f.file_name,f.file_hash) ;
+
 #ifdef DEBUG_DIRECTORY_STORAGE
             std::cerr << " created, at new index " << file_index << std::endl;
 #endif
@@ -616,15 +768,18 @@ bool InternalFileHierarchyStorage::updateDirEntry(
     uint32_t n=0;
     for(uint32_t i=0;i<d.subdirs.size();++i)
     {
-        static_cast<DirEntry*>(mNodes[d.subdirs[i]])->dir_update_time = 0 ;	// force the update of the subdir.
+        DirRecord& sd(dirRecord(d.subdirs[i])) ;
 
-        mNodes[d.subdirs[i]]->parent_index = indx ;
-        mNodes[d.subdirs[i]]->row = n++ ;
+        sd.dir_update_time = 0 ;	// force the update of the subdir.
+        sd.parent_index = indx ;
+        sd.row = n++ ;
     }
     for(uint32_t i=0;i<d.subfiles.size();++i)
     {
-        mNodes[d.subfiles[i]]->parent_index = indx ;
-        mNodes[d.subfiles[i]]->row = n++ ;
+        FileRecord& sf(fileRecord(d.subfiles[i])) ;
+
+        sf.parent_index = indx ;
+        sf.row = n++ ;
     }
 
 
@@ -637,32 +792,41 @@ void InternalFileHierarchyStorage::getStatistics(SharedDirStats& stats) const
     stats.total_shared_size = mTotalSize ;
 }
 
+rstime_t InternalFileHierarchyStorage::DirRecord::* InternalFileHierarchyStorage::recordTS(rstime_t DirEntry::* m)
+{
+    if(m == &DirEntry::dir_modtime)          return &DirRecord::dir_modtime ;
+    if(m == &DirEntry::dir_most_recent_time) return &DirRecord::dir_most_recent_time ;
+    if(m == &DirEntry::dir_update_time)      return &DirRecord::dir_update_time ;
+
+    return NULL ;
+}
+
 bool InternalFileHierarchyStorage::getTS(const DirectoryStorage::EntryIndex& index,rstime_t& TS,rstime_t DirEntry::* m) const
 {
-    if(!checkIndex(index,FileStorageNode::TYPE_DIR))
+    if(!checkIndex(index,FileStorageNode::TYPE_DIR) || recordTS(m) == NULL)
     {
         std::cerr << "[directory storage] (EE) cannot get TS for index " << index << ". Not a valid index or not a directory." << std::endl;
         return false;
     }
 
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[index])) ;
+    const DirRecord& d(dirRecord(index)) ;
 
-    TS = d.*m ;
+    TS = d.*recordTS(m) ;
 
     return true;
 }
 
 bool InternalFileHierarchyStorage::setTS(const DirectoryStorage::EntryIndex& index,rstime_t& TS,rstime_t DirEntry::* m)
 {
-    if(!checkIndex(index,FileStorageNode::TYPE_DIR))
+    if(!checkIndex(index,FileStorageNode::TYPE_DIR) || recordTS(m) == NULL)
     {
         std::cerr << "[directory storage] (EE) cannot get TS for index " << index << ". Not a valid index or not a directory." << std::endl;
         return false;
     }
 
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[index])) ;
+    DirRecord& d(dirRecord(index)) ;
 
-    d.*m = TS;
+    d.*recordTS(m) = TS;
 
     return true;
 }
@@ -671,13 +835,13 @@ bool InternalFileHierarchyStorage::setTS(const DirectoryStorage::EntryIndex& ind
 
 uint64_t InternalFileHierarchyStorage::recursUpdateCumulatedSize(const DirectoryStorage::EntryIndex& dir_index)
 {
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[dir_index])) ;
+    DirRecord& d(dirRecord(dir_index)) ;
 
     uint64_t local_cumulative_size = 0;
 
     for(uint32_t i=0;i<d.subfiles.size();++i)
-        if(mNodes[d.subfiles[i]])		// normally not needed, but an extra-security
-            local_cumulative_size += static_cast<FileEntry*>(mNodes[d.subfiles[i]])->file_size;
+        if(isFile(d.subfiles[i]))		// normally not needed, but an extra-security
+            local_cumulative_size += fileRecord(d.subfiles[i]).file_size;
 
     for(uint32_t i=0;i<d.subdirs.size();++i)
         local_cumulative_size += recursUpdateCumulatedSize(d.subdirs[i]);
@@ -689,17 +853,20 @@ uint64_t InternalFileHierarchyStorage::recursUpdateCumulatedSize(const Directory
 
 rstime_t InternalFileHierarchyStorage::recursUpdateLastModfTime(const DirectoryStorage::EntryIndex& dir_index,bool& unfinished_files_present)
 {
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[dir_index])) ;
+    DirRecord& d(dirRecord(dir_index)) ;
 
     rstime_t largest_modf_time = d.dir_modtime ;
     unfinished_files_present = false ;
 
     for(uint32_t i=0;i<d.subfiles.size();++i)
     {
-        FileEntry *f = static_cast<FileEntry*>(mNodes[d.subfiles[i]]) ;
+        if(!isFile(d.subfiles[i]))
+            continue ;
 
-        if(!f->file_hash.isNull())
-            largest_modf_time = std::max(largest_modf_time, f->file_modtime) ;	// only account for hashed files, since we never send unhashed files to friends.
+        const FileRecord& f(fileRecord(d.subfiles[i])) ;
+
+        if(!f.file_hash.isNull())
+            largest_modf_time = std::max(largest_modf_time, f.file_modtime) ;	// only account for hashed files, since we never send unhashed files to friends.
         else
             unfinished_files_present = true ;
     }
@@ -724,32 +891,74 @@ rstime_t InternalFileHierarchyStorage::recursUpdateLastModfTime(const DirectoryS
 
 // Low level stuff. Should normally not be used externally.
 
-const InternalFileHierarchyStorage::FileStorageNode *InternalFileHierarchyStorage::getNode(DirectoryStorage::EntryIndex indx) const
+bool InternalFileHierarchyStorage::getDirEntry(DirectoryStorage::EntryIndex indx,DirEntry& de,bool with_children) const
 {
-    if(checkIndex(indx,FileStorageNode::TYPE_FILE | FileStorageNode::TYPE_DIR))
-        return mNodes[indx] ;
-    else
-        return NULL ;
+	if(!checkIndex(indx,FileStorageNode::TYPE_DIR)) return false;
+
+	const DirRecord& d(dirRecord(indx)) ;
+
+	de.parent_index         = d.parent_index ;
+	de.row                  = d.row ;
+	de.dir_name             = mNames.get(d.dir_name) ;
+	de.dir_parent_path      = mNames.get(d.dir_parent_path) ;
+	de.dir_hash             = d.dir_hash ;
+	de.dir_cumulated_size   = d.dir_cumulated_size ;
+	de.dir_modtime          = d.dir_modtime ;
+	de.dir_most_recent_time = d.dir_most_recent_time ;
+	de.dir_update_time      = d.dir_update_time ;
+
+	if(with_children)
+	{
+		de.subdirs  = d.subdirs ;
+		de.subfiles = d.subfiles ;
+	}
+	else
+	{
+		de.subdirs.clear() ;
+		de.subfiles.clear() ;
+	}
+	return true;
 }
+bool InternalFileHierarchyStorage::getFileEntry(DirectoryStorage::EntryIndex indx,FileEntry& fe,bool with_name) const
+{
+    if(!checkIndex(indx,FileStorageNode::TYPE_FILE))
+        return false ;
+
+    const FileRecord& f(fileRecord(indx)) ;
+
+    fe.parent_index = f.parent_index ;
+    fe.row          = f.row ;
+    fe.file_size    = f.file_size ;
+    fe.file_modtime = f.file_modtime ;
+    fe.file_hash    = f.file_hash ;
+
+    if(with_name)
+        fe.file_name = mNames.get(f.file_name) ;
+    else
+        fe.file_name.clear() ;
 
-const InternalFileHierarchyStorage::DirEntry*
-InternalFileHierarchyStorage::getDirEntry(DirectoryStorage::EntryIndex indx) const
+    return true ;
+}
+bool InternalFileHierarchyStorage::getName(DirectoryStorage::EntryIndex indx,std::string& name) const
 {
-	if(!checkIndex(indx,FileStorageNode::TYPE_DIR)) return nullptr;
-	return static_cast<DirEntry*>(mNodes[indx]);
+    if(!checkIndex(indx,FileStorageNode::TYPE_FILE | FileStorageNode::TYPE_DIR))
+        return false ;
+
+    name = mNames.get(isFile(indx)?fileRecord(indx).file_name:dirRecord(indx).dir_name) ;
+    return true ;
 }
-const InternalFileHierarchyStorage::FileEntry*
-InternalFileHierarchyStorage::getFileEntry(DirectoryStorage::EntryIndex indx) const
+bool InternalFileHierarchyStorage::getParentIndex(DirectoryStorage::EntryIndex indx,DirectoryStorage::EntryIndex& parent) const
 {
-    if(!checkIndex(indx,FileStorageNode::TYPE_FILE))
-        return NULL ;
+    if(!checkIndex(indx,FileStorageNode::TYPE_FILE | FileStorageNode::TYPE_DIR))
+        return false ;
 
-    return static_cast<FileEntry*>(mNodes[indx]) ;
+    parent = isFile(indx)?fileRecord(indx).parent_index:dirRecord(indx).parent_index ;
+    return true ;
 }
 uint32_t InternalFileHierarchyStorage::getType(DirectoryStorage::EntryIndex indx) const
 {
     if(checkIndex(indx,FileStorageNode::TYPE_FILE | FileStorageNode::TYPE_DIR))
-        return mNodes[indx]->type() ;
+        return mEntries[indx] >> ENTRY_TYPE_SHIFT ;
     else
         return FileStorageNode::TYPE_UNKNOWN;
 }
@@ -759,20 +968,20 @@ DirectoryStorage::EntryIndex InternalFileHierarchyStorage::getSubFileIndex(Direc
     if(!checkIndex(parent_index,FileStorageNode::TYPE_DIR))
         return DirectoryStorage::NO_INDEX;
 
-    if(static_cast<DirEntry*>(mNodes[parent_index])->subfiles.size() <= file_tab_index)
+    if(dirRecord(parent_index).subfiles.size() <= file_tab_index)
         return DirectoryStorage::NO_INDEX;
 
-    return static_cast<DirEntry*>(mNodes[parent_index])->subfiles[file_tab_index];
+    return dirRecord(parent_index).subfiles[file_tab_index];
 }
 DirectoryStorage::EntryIndex InternalFileHierarchyStorage::getSubDirIndex(DirectoryStorage::EntryIndex parent_index,uint32_t dir_tab_index)
 {
     if(!checkIndex(parent_index,FileStorageNode::TYPE_DIR))
         return DirectoryStorage::NO_INDEX;
 
-    if(static_cast<DirEntry*>(mNodes[parent_index])->subdirs.size() <= dir_tab_index)
+    if(dirRecord(parent_index).subdirs.size() <= dir_tab_index)
         return DirectoryStorage::NO_INDEX;
 
-    return static_cast<DirEntry*>(mNodes[parent_index])->subdirs[dir_tab_index];
+    return dirRecord(parent_index).subdirs[dir_tab_index];
 }
 
 bool InternalFileHierarchyStorage::searchHash(const RsFileHash& hash,DirectoryStorage::EntryIndex& result)
@@ -800,18 +1009,90 @@ private:
     const InternalFileHierarchyStorage::DirEntry& mDe ;
 };
 
+bool InternalFileHierarchyStorage::isSearchableFile(DirectoryStorage::EntryIndex indx) const
+{
+	// no error here: candidates given by the search index may be stale, or point to re-used entries.
+
+	if(!isFile(indx))
+		return false ;
+
+	// Only the file referenced by its hash is searched, as when going through the table of hashes.
+
+	DirectoryStorage::EntryIndex hash_indx ;
+
+	return mFileHashes.find(fileRecord(indx).file_hash,hash_indx) && hash_indx == indx ;
+}
+
+bool InternalFileHierarchyStorage::fileMatchesBoolExp(
+        DirectoryStorage::EntryIndex indx,
+        RsRegularExpression::Expression* exp ) const
+{
+	FileEntry fe ;
+	DirEntry parent("") ;
+
+	return getFileEntry(indx,fe) && getDirEntry(fe.parent_index,parent,false)
+	        && fileMatchesBoolExp(fe,parent,exp);
+}
+
+bool InternalFileHierarchyStorage::fileMatchesBoolExp(
+        const FileEntry& fe, const DirEntry& parent,
+        RsRegularExpression::Expression* exp )
+{
+	return exp->eval(DirectoryStorageExprFileEntry(fe,parent));
+}
+
+bool InternalFileHierarchyStorage::fileMatchesTerms(
+        DirectoryStorage::EntryIndex indx,
+        const std::list<std::string>& terms ) const
+{
+	uint32_t name = fileRecord(indx).file_name ;
+
+	return fileNameMatchesTerms(mNames.data(name), mNames.size(name), terms);
+}
+
+bool InternalFileHierarchyStorage::fileNameMatchesTerms(
+        const std::string& file_name, const std::list<std::string>& terms )
+{
+	return fileNameMatchesTerms(file_name.data(), file_name.size(), terms);
+}
+
+bool InternalFileHierarchyStorage::fileNameMatchesTerms(
+        const char* file_name, uint32_t size,
+        const std::list<std::string>& terms )
+{
+	/* Most file will just have file name stored, but single file shared
+	 * without a shared dir will contain full path instead of just the
+	 * name, so purify it to perform the search */
+	const char* tBegin = file_name;
+	const char* tEnd = file_name + size;
+
+	for(const char* c = tEnd; c != file_name; --c)
+		if(c[-1] == '/')
+		{
+			tBegin = c;
+			break;
+		}
+
+	for(auto& termIt : std::as_const(terms))
+	{
+		/* always ignore case */
+		if(tEnd != std::search(
+		            tBegin, tEnd,
+		            termIt.begin(), termIt.end(),
+		            RsRegularExpression::CompareCharIC() ))
+			return true;
+	}
+	return false;
+}
+
 int InternalFileHierarchyStorage::searchBoolExp(
         RsRegularExpression::Expression* exp,
         std::list<DirectoryStorage::EntryIndex>& results ) const
 {
 	for(auto& it: std::as_const(mFileHashes))
-		if(mNodes[it.second])
-			if(exp->eval(
-			            DirectoryStorageExprFileEntry(
-			                *static_cast<const FileEntry*>(mNodes[it.second]),
-			                *static_cast<const DirEntry*>(mNodes[mNodes[it.second]->parent_index])
-			                                      ) ))
-			results.push_back(it.second);
+		if(isFile(it.index))
+			if(fileMatchesBoolExp(it.index,exp))
+			results.push_back(it.index);
 
     return 0;
 }
@@ -826,39 +1107,36 @@ int InternalFileHierarchyStorage::searchTerms(
 	for(auto& it : std::as_const(mFileHashes))
 	{
 		// node may be null for some hash waiting to be deleted
-		if(mNodes[it.second])
-		{
-			rs_view_ptr<FileEntry> tFileEntry =
-			        static_cast<FileEntry*>(mNodes[it.second]);
-
-			/* Most file will just have file name stored, but single file shared
-			 * without a shared dir will contain full path instead of just the
-			 * name, so purify it to perform the search */
-			std::string tFilename = tFileEntry->file_name;
-			if(tFileEntry->file_name.find("/") != std::string::npos)
-			{
-				std::string _tParentDir;
-				RsDirUtil::splitDirFromFile(
-				            tFileEntry->file_name, _tParentDir, tFilename );
-			}
-
-			for(auto& termIt : std::as_const(terms))
-			{
-				/* always ignore case */
-				if(tFilename.end() != std::search(
-				            tFilename.begin(), tFilename.end(),
-				            termIt.begin(), termIt.end(),
-				            RsRegularExpression::CompareCharIC() ))
-				{
-					results.push_back(it.second);
-					break;
-				}
-			}
-		}
+		if(isFile(it.index) && fileMatchesTerms(it.index,terms))
+			results.push_back(it.index);
 	}
 	return 0;
 }
 
+int InternalFileHierarchyStorage::searchBoolExp(
+        RsRegularExpression::Expression* exp,
+        const std::vector<DirectoryStorage::EntryIndex>& candidates,
+        std::list<DirectoryStorage::EntryIndex>& results ) const
+{
+	for(uint32_t i=0;i<candidates.size();++i)
+		if(isSearchableFile(candidates[i]) && fileMatchesBoolExp(candidates[i],exp))
+			results.push_back(candidates[i]);
+
+	return 0;
+}
+
+int InternalFileHierarchyStorage::searchTerms(
+        const std::list<std::string>& terms,
+        const std::vector<DirectoryStorage::EntryIndex>& candidates,
+        std::list<DirectoryStorage::EntryIndex>& results ) const
+{
+	for(uint32_t i=0;i<candidates.size();++i)
+		if(isSearchableFile(candidates[i]) && fileMatchesTerms(candidates[i],terms))
+			results.push_back(candidates[i]);
+
+	return 0;
+}
+
 bool InternalFileHierarchyStorage::check(std::string& error_string) // checks consistency of storage.
 {
     // recurs go through all entries, check that all
@@ -870,20 +1148,20 @@ bool InternalFileHierarchyStorage::check(std::string& error_string) // checks co
     bool bFileDouble = false;
     bool bOrphean = false;
 
-    std::vector<uint32_t> hits(mNodes.size(),0) ;	// count hits of children. Should be 1 for all in the end. Otherwise there's an error.
+    std::vector<uint32_t> hits(mEntries.size(),0) ;	// count hits of children. Should be 1 for all in the end. Otherwise there's an error.
     hits[0] = 1 ;	// because 0 is never the child of anyone
 
     mFreeNodes.clear();
 
-    for(uint32_t i=0;i<mNodes.size();++i)
-        if(mNodes[i] != NULL && mNodes[i]->type() == FileStorageNode::TYPE_DIR)
+    for(uint32_t i=0;i<mEntries.size();++i)
+        if(isDir(i))
         {
             // stamp the kids
-            DirEntry& de = *static_cast<DirEntry*>(mNodes[i]) ;
+            DirRecord& de(dirRecord(i)) ;
 
             for(uint32_t j=0;j<de.subdirs.size();)
             {
-                if(de.subdirs[j] >= mNodes.size())
+                if(de.subdirs[j] >= mEntries.size())
                 {
                     if(!bDirOut){ error_string += " - Node child dir out of tab!"; bDirOut = true;}
                     de.subdirs[j] = de.subdirs.back() ;
@@ -903,7 +1181,7 @@ bool InternalFileHierarchyStorage::check(std::string& error_string) // checks co
             }
             for(uint32_t j=0;j<de.subfiles.size();)
             {
-                if(de.subfiles[j] >= mNodes.size())
+                if(de.subfiles[j] >= mEntries.size())
                 {
                     if(!bFileOut){ error_string += " - Node child file out of tab!"; bFileOut = true;}
                     de.subfiles[j] = de.subfiles.back() ;
@@ -922,11 +1200,11 @@ bool InternalFileHierarchyStorage::check(std::string& error_string) // checks co
                 }
             }
         }
-        else if( mNodes[i] == NULL )
+        else if( mEntries[i] == NO_ENTRY )
             mFreeNodes.push_back(i) ;
 
     for(uint32_t i=0;i<hits.size();++i)
-        if(hits[i] == 0 && mNodes[i] != NULL)
+        if(hits[i] == 0 && mEntries[i] != NO_ENTRY)
         {
             if(!bOrphean){ error_string += " - Orphean node!"; bOrphean = true;}
 
@@ -943,20 +1221,20 @@ void InternalFileHierarchyStorage::print() const
     int nempty = 0 ;
     int nunknown = 0;
 
-    for(uint32_t i=0;i<mNodes.size();++i)
-        if(mNodes[i] == NULL)
+    for(uint32_t i=0;i<mEntries.size();++i)
+        if(mEntries[i] == NO_ENTRY)
         {
             //std::cerr << "  Node " << i << ": empty " << std::endl;
             ++nempty ;
         }
-        else if(mNodes[i]->type() == FileStorageNode::TYPE_DIR)
+        else if(isDir(i))
         {
-            std::cerr << "  Node " << i << ": type=" << mNodes[i]->type() << std::endl;
+            std::cerr << "  Node " << i << ": type=" << FileStorageNode::TYPE_DIR << std::endl;
             ++ndirs;
         }
-        else if(mNodes[i]->type() == FileStorageNode::TYPE_FILE)
+        else if(isFile(i))
         {
-            std::cerr << "  Node " << i << ": type=" << mNodes[i]->type() << std::endl;
+            std::cerr << "  Node " << i << ": type=" << FileStorageNode::TYPE_FILE << std::endl;
             ++nfiles;
         }
         else
@@ -965,33 +1243,34 @@ void InternalFileHierarchyStorage::print() const
             std::cerr << "(EE) Error: unknown type node found!" << std::endl;
         }
 
-    std::cerr << "Total nodes: " << mNodes.size() << " (" << nfiles << " files, " << ndirs << " dirs, " << nempty << " empty slots";
+    std::cerr << "Total nodes: " << mEntries.size() << " (" << nfiles << " files, " << ndirs << " dirs, " << nempty << " empty slots";
     if (nunknown > 0) std::cerr << ", " << nunknown << " unknown";
     std::cerr << ")" << std::endl;
+    std::cerr << "Distinct names: " << mNames.nbNames() << ", " << mNames.memoryUsage() << " bytes" << std::endl;
 
 
     recursPrint(0,DirectoryStorage::EntryIndex(0));
 
     std::cerr << "Known dir hashes: " << std::endl;
-    for(std::map<RsFileHash,DirectoryStorage::EntryIndex>::const_iterator  it(mDirHashes.begin());it!=mDirHashes.end();++it)
-        std::cerr << "  " << it->first << " at index " << it->second << std::endl;
+    for(HashIndexTable::const_iterator it(mDirHashes.begin());it!=mDirHashes.end();++it)
+        std::cerr << "  " << it->hash << " at index " << it->index << std::endl;
 
     std::cerr << "Known file hashes: " << std::endl;
-    for(std::map<RsFileHash,DirectoryStorage::EntryIndex>::const_iterator  it(mFileHashes.begin());it!=mFileHashes.end();++it)
-        std::cerr << "  " << it->first << " at index " << it->second << std::endl;
+    for(HashIndexTable::const_iterator it(mFileHashes.begin());it!=mFileHashes.end();++it)
+        std::cerr << "  " << it->hash << " at index " << it->index << std::endl;
 }
 void InternalFileHierarchyStorage::recursPrint(int depth,DirectoryStorage::EntryIndex node) const
 {
     std::string indent(2*depth,' ');
 
-    if(mNodes[node] == NULL)
+    if(!isDir(node))
     {
         std::cerr << "EMPTY NODE !!" << std::endl;
         return ;
     }
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[node]));
+    const DirRecord& d(dirRecord(node));
 
-    std::cerr << indent << "dir hash=" << d.dir_hash << ". name:" << d.dir_name << ", parent_path:" << d.dir_parent_path << ", modf time: " << d.dir_modtime << ", recurs_last_modf_time: " << d.dir_most_recent_time << ", parent: " << d.parent_index << ", row: " << d.row << ", subdirs: " ;
+    std::cerr << indent << "dir hash=" << d.dir_hash << ". name:" << mNames.get(d.dir_name) << ", parent_path:" << mNames.get(d.dir_parent_path) << ", modf time: " << d.dir_modtime << ", recurs_last_modf_time: " << d.dir_most_recent_time << ", parent: " << d.parent_index << ", row: " << d.row << ", subdirs: " ;
 
     for(uint32_t i=0;i<d.subdirs.size();++i)
         std::cerr << d.subdirs[i] << " " ;
@@ -1001,10 +1280,10 @@ void InternalFileHierarchyStorage::recursPrint(int depth,DirectoryStorage::Entry
         recursPrint(depth+1,d.subdirs[i]) ;
 
     for(uint32_t i=0;i<d.subfiles.size();++i)
-        if(mNodes[d.subfiles[i]] != NULL)
+        if(isFile(d.subfiles[i]))
         {
-            FileEntry& f(*static_cast<FileEntry*>(mNodes[d.subfiles[i]]));
-            std::cerr << indent << "  hash:" << f.file_hash << " ts:" << (uint64_t)f.file_modtime << "  " << f.file_size << "  " << f.file_name << ", parent: " << f.parent_index << ", row: " << f.row << std::endl;
+            const FileRecord& f(fileRecord(d.subfiles[i]));
+            std::cerr << indent << "  hash:" << f.file_hash << " ts:" << (uint64_t)f.file_modtime << "  " << f.file_size << "  " << mNames.get(f.file_name) << ", parent: " << f.parent_index << ", row: " << f.row << std::endl;
         }
 }
 
@@ -1019,7 +1298,7 @@ bool InternalFileHierarchyStorage::nodeAccessError(const std::string& s)
 
 bool InternalFileHierarchyStorage::recursRemoveDirectory(DirectoryStorage::EntryIndex dir)
 {
-    DirEntry& d(*static_cast<DirEntry*>(mNodes[dir])) ;
+    DirRecord& d(dirRecord(dir)) ;
 
     RsFileHash hash = d.dir_hash ;
 
@@ -1054,39 +1333,39 @@ bool InternalFileHierarchyStorage::save(const std::string& fname)
         // Write some header
 
         if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_DIRECTORY_VERSION,(uint32_t) FILE_LIST_IO_LOCAL_DIRECTORY_STORAGE_VERSION_0001)) throw std::runtime_error("Write error") ;
-        if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t) mNodes.size())) throw std::runtime_error("Write error") ;
+        if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_RAW_NUMBER,(uint32_t) mEntries.size())) throw std::runtime_error("Write error") ;
 
         // Write all file/dir entries
 
-        for(uint32_t i=0;i<mNodes.size();++i)
-            if(mNodes[i] != NULL && mNodes[i]->type() == FileStorageNode::TYPE_FILE)
+        for(uint32_t i=0;i<mEntries.size();++i)
+            if(isFile(i))
             {
-                const FileEntry& fe(*static_cast<const FileEntry*>(mNodes[i])) ;
+                const FileRecord& fe(fileRecord(i)) ;
 
                 uint32_t file_section_offset = 0 ;
 
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_PARENT_INDEX  ,(uint32_t)fe.parent_index)) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_ROW           ,(uint32_t)fe.row         )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_ENTRY_INDEX   ,(uint32_t)i              )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_FILE_NAME     ,fe.file_name             )) throw std::runtime_error("Write error") ;
+                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_FILE_NAME     ,mNames.get(fe.file_name) )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_FILE_SIZE     ,fe.file_size             )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_FILE_SHA1_HASH,fe.file_hash             )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,file_section_offset,FILE_LIST_IO_TAG_MODIF_TS      ,(uint32_t)fe.file_modtime)) throw std::runtime_error("Write error") ;
 
                 if(!FileListIO::writeField(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_FILE_ENTRY,tmp_section_data,file_section_offset)) throw std::runtime_error("Write error") ;
             }
-            else if(mNodes[i] != NULL && mNodes[i]->type() == FileStorageNode::TYPE_DIR)
+            else if(isDir(i))
             {
-                const DirEntry& de(*static_cast<const DirEntry*>(mNodes[i])) ;
+                const DirRecord& de(dirRecord(i)) ;
 
                 uint32_t dir_section_offset = 0 ;
 
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_PARENT_INDEX   ,(uint32_t)de.parent_index      )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_ROW            ,(uint32_t)de.row               )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_ENTRY_INDEX    ,(uint32_t)i                    )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_FILE_NAME      ,de.dir_name                    )) throw std::runtime_error("Write error") ;
+                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_FILE_NAME      ,mNames.get(de.dir_name)        )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_DIR_HASH       ,de.dir_hash                    )) throw std::runtime_error("Write error") ;
-                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_FILE_SIZE      ,de.dir_parent_path             )) throw std::runtime_error("Write error") ;
+                if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_FILE_SIZE      ,mNames.get(de.dir_parent_path) )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_MODIF_TS       ,(uint32_t)de.dir_modtime       )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_UPDATE_TS      ,(uint32_t)de.dir_update_time   )) throw std::runtime_error("Write error") ;
                 if(!FileListIO::writeField(tmp_section_data,tmp_section_size,dir_section_offset,FILE_LIST_IO_TAG_RECURS_MODIF_TS,(uint32_t)de.dir_most_recent_time  )) throw std::runtime_error("Write error") ;
@@ -1131,9 +1410,8 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
     uint32_t buffer_size = 0 ;
     uint32_t buffer_offset = 0 ;
 
-    mFreeNodes.clear();
-    mTotalFiles = 0;
-    mTotalSize = 0;
+    if(mSearchIndex != NULL)	// all entries are about to change
+        mSearchIndex->invalidate() ;
 
     try
     {
@@ -1151,14 +1429,10 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
 
         // Write all file/dir entries
 
-        for(uint32_t i=0;i<mNodes.size();++i)
-            if(mNodes[i])
-                delete mNodes[i] ;
-
-        mNodes.clear();
-        mNodes.resize(n_nodes,NULL) ;
+        clear() ;
+        mEntries.resize(n_nodes,NO_ENTRY) ;
 
-        for(uint32_t i=0;i<mNodes.size() && buffer_offset < buffer_size;++i)	// only the 2nd condition really is needed. The first one ensures that the loop wont go forever.
+        for(uint32_t i=0;i<mEntries.size() && buffer_offset < buffer_size;++i)	// only the 2nd condition really is needed. The first one ensures that the loop wont go forever.
         {
             unsigned char *node_section_data = NULL ;
             uint32_t node_section_size = 0 ;
@@ -1185,16 +1459,17 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
                 if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_FILE_SHA1_HASH,file_hash   )) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_FILE_SHA1_HASH) ;
                 if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_MODIF_TS      ,file_modtime)) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_MODIF_TS      ) ;
 
-                if(node_index >= mNodes.size())
-                    mNodes.resize(node_index+1,NULL) ;
+                if(node_index >= mEntries.size())
+                    mEntries.resize(node_index+1,NO_ENTRY) ;
 
-                FileEntry *fe = new FileEntry(file_name,file_size,file_modtime,file_hash);
+                FileEntry fe(file_name,file_size,file_modtime,file_hash);
 
-                fe->parent_index = parent_index ;
-                fe->row = row ;
+                fe.parent_index = parent_index ;
+                fe.row = row ;
 
-                mNodes[node_index] = fe ;
-                mFileHashes[fe->file_hash] = node_index ;
+                deleteNode(node_index) ;	// in case the same index appears twice
+                createFileEntry(node_index,fe) ;
+                mFileHashes.insert(fe.file_hash,node_index) ;
 
                 mTotalFiles++ ;
                 mTotalSize += file_size ;
@@ -1221,19 +1496,19 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
                 if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_UPDATE_TS      ,dir_update_time      )) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_UPDATE_TS      ) ;
                 if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RECURS_MODIF_TS,dir_most_recent_time )) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RECURS_MODIF_TS) ;
 
-                if(node_index >= mNodes.size())
-                    mNodes.resize(node_index+1,NULL) ;
+                if(node_index >= mEntries.size())
+                    mEntries.resize(node_index+1,NO_ENTRY) ;
 
-                DirEntry *de = new DirEntry(dir_name) ;
-                de->dir_name         = dir_name ;
-                de->dir_parent_path  = dir_parent_path ;
-                de->dir_hash         = dir_hash ;
-                de->dir_modtime      = dir_modtime ;
-                de->dir_update_time  = dir_update_time ;
-                de->dir_most_recent_time = dir_most_recent_time ;
+                DirEntry de(dir_name) ;
+                de.dir_name         = dir_name ;
+                de.dir_parent_path  = dir_parent_path ;
+                de.dir_hash         = dir_hash ;
+                de.dir_modtime      = dir_modtime ;
+                de.dir_update_time  = dir_update_time ;
+                de.dir_most_recent_time = dir_most_recent_time ;
 
-                de->parent_index = parent_index ;
-                de->row = row ;
+                de.parent_index = parent_index ;
+                de.row = row ;
 
                 uint32_t n_subdirs = 0 ;
                 uint32_t n_subfiles = 0 ;
@@ -1244,7 +1519,7 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
                 {
                     uint32_t di = 0 ;
                     if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,di)) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER) ;
-                    de->subdirs.push_back(di) ;
+                    de.subdirs.push_back(di) ;
                 }
 
                 if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,n_subfiles)) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER) ;
@@ -1253,10 +1528,11 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
                 {
                     uint32_t fi = 0 ;
                     if(!FileListIO::readField(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER,fi)) throw read_error(node_section_data,node_section_size,node_section_offset,FILE_LIST_IO_TAG_RAW_NUMBER) ;
-                    de->subfiles.push_back(fi) ;
+                    de.subfiles.push_back(fi) ;
                 }
-                mNodes[node_index] = de ;
-                mDirHashes[de->dir_hash] = node_index ;
+                deleteNode(node_index) ;
+                createDirEntry(node_index,de) ;
+                mDirHashes.insert(de.dir_hash,node_index) ;
             }
             else
                 throw read_error(buffer,buffer_size,buffer_offset,FILE_LIST_IO_TAG_LOCAL_FILE_ENTRY) ;
@@ -26,6 +26,10 @@
 #include <stdlib.h>
 
 #include "directory_storage.h"
+#include "hash_index_table.h"
+#include "name_table.h"
+
+class FileSearchIndex ;
 
 class InternalFileHierarchyStorage
 {
@@ -37,12 +41,15 @@ public:
         static const uint32_t TYPE_FILE    = 0x0001 ;
         static const uint32_t TYPE_DIR     = 0x0002 ;
 
-        virtual ~FileStorageNode() {}
-        virtual uint32_t type() const =0;
+        FileStorageNode() : parent_index(0),row(0) {}
 
         DirectoryStorage::EntryIndex parent_index;
         uint32_t row ;
     };
+
+    // File and directory entries, as filled by getFileEntry() and getDirEntry(). The hierarchy does not store them that
+    // way: see FileRecord and DirRecord below.
+
     class FileEntry: public FileStorageNode
     {
     public:
@@ -50,9 +57,6 @@ public:
         FileEntry(const std::string& name,uint64_t size,rstime_t modtime) : file_name(name),file_size(size),file_modtime(modtime) {}
         FileEntry(const std::string& name,uint64_t size,rstime_t modtime,const RsFileHash& hash) : file_name(name),file_size(size),file_modtime(modtime),file_hash(hash) {}
 
-        virtual uint32_t type() const { return FileStorageNode::TYPE_FILE ; }
-        virtual ~FileEntry() {}
-
         // local stuff
         std::string file_name ;
         uint64_t    file_size ;
@@ -64,9 +68,6 @@ public:
     {
     public:
         explicit DirEntry(const std::string& name) : dir_name(name), dir_cumulated_size(0), dir_modtime(0),dir_most_recent_time(0),dir_update_time(0) {}
-        virtual ~DirEntry() {}
-
-        virtual uint32_t type() const { return FileStorageNode::TYPE_DIR ; }
 
         // local stuff
         std::string dir_name ;
@@ -124,7 +125,6 @@ public:
 
     uint32_t mRoot ;
     std::list<uint32_t > mFreeNodes ;	// keeps a list of free nodes in order to make insert effcieint
-    std::vector<FileStorageNode*> mNodes;// uses pointers to keep information about valid/invalid objects.
 
     void compress() ;					// use empty space in the vector, mostly due to deleted entries. This is a complicated operation, mostly due to
                                             // all the indirections used. Nodes need to be moved, renamed, etc. The operation discards all file entries that
@@ -132,22 +132,42 @@ public:
 
     friend class DirectoryStorage ;		// only class that can use this.
     friend class LocalDirectoryStorage ;		// only class that can use this.
+    friend class CompactFileList ;			// saves and loads remote file lists.
 
     // Low level stuff. Should normally not be used externally.
+    // Entries are copied into the given FileEntry/DirEntry. Names are only copied when asked to.
 
-    const FileStorageNode *getNode(DirectoryStorage::EntryIndex indx) const;
-    const DirEntry *getDirEntry(DirectoryStorage::EntryIndex indx) const;
-    const FileEntry *getFileEntry(DirectoryStorage::EntryIndex indx) const;
+    bool getDirEntry(DirectoryStorage::EntryIndex indx,DirEntry& de,bool with_children = true) const;
+    bool getFileEntry(DirectoryStorage::EntryIndex indx,FileEntry& fe,bool with_name = true) const;
+    bool getName(DirectoryStorage::EntryIndex indx,std::string& name) const;
+    bool getParentIndex(DirectoryStorage::EntryIndex indx,DirectoryStorage::EntryIndex& parent) const;
     uint32_t getType(DirectoryStorage::EntryIndex indx) const;
+    uint32_t nbEntries() const { return mEntries.size() ; }	// including free entries
     DirectoryStorage::EntryIndex getSubFileIndex(DirectoryStorage::EntryIndex parent_index,uint32_t file_tab_index);
     DirectoryStorage::EntryIndex getSubDirIndex(DirectoryStorage::EntryIndex parent_index,uint32_t dir_tab_index);
 
-    // search. SearchHash is logarithmic. The other two are linear.
+    // search. SearchHash is constant time. The other two are linear.
 
     bool searchHash(const RsFileHash& hash, DirectoryStorage::EntryIndex &result);
     int searchBoolExp(RsRegularExpression::Expression * exp, std::list<DirectoryStorage::EntryIndex> &results) const ;
     int searchTerms(const std::list<std::string>& terms, std::list<DirectoryStorage::EntryIndex> &results) const ;		// does a logical OR between items of the list of terms
 
+    // Same as above, but only checks the given candidate entries, as returned by a FileSearchIndex.
+
+    int searchBoolExp(RsRegularExpression::Expression * exp, const std::vector<DirectoryStorage::EntryIndex>& candidates, std::list<DirectoryStorage::EntryIndex> &results) const ;
+    int searchTerms(const std::list<std::string>& terms, const std::vector<DirectoryStorage::EntryIndex>& candidates, std::list<DirectoryStorage::EntryIndex> &results) const ;
+
+    // Keeps the given index up to date with the files of this hierarchy, which are indexed under storage_id. Existing files
+    // are indexed right away. The index is not owned.
+
+    void setSearchIndex(FileSearchIndex *index,uint32_t storage_id) ;
+
+    // Matching of a single file, also used for file lists that are not loaded in memory.
+
+    static bool fileNameMatchesTerms(const std::string& file_name,const std::list<std::string>& terms) ;
+    static bool fileNameMatchesTerms(const char *file_name,uint32_t size,const std::list<std::string>& terms) ;
+    static bool fileMatchesBoolExp(const FileEntry& fe,const DirEntry& parent,RsRegularExpression::Expression *exp) ;
+
     bool check(std::string& error_string)	;// checks consistency of storage.
 
     void print() const;
@@ -157,30 +177,102 @@ public:
     void getStatistics(SharedDirStats& stats) const ;
 
 private:
+    // Entries are stored in two tables, one for files and one for directories, with no pointer and no virtual
+    // method. mEntries gives the table and the position in that table of each EntryIndex, so that entry indices
+    // do not depend on where entries are stored. Names and parent paths are ids in mNames.
+
+    struct FileRecord
+    {
+        RsFileHash file_hash ;
+        uint32_t   file_name ;
+        uint64_t   file_size ;
+        rstime_t   file_modtime ;
+        DirectoryStorage::EntryIndex parent_index ;
+        uint32_t   row ;
+    };
+
+    struct DirRecord
+    {
+        RsFileHash dir_hash ;
+        uint32_t   dir_name ;
+        uint32_t   dir_parent_path ;
+        DirectoryStorage::EntryIndex parent_index ;
+        uint32_t   row ;
+        uint64_t   dir_cumulated_size ;
+
+        rstime_t dir_modtime ;
+        rstime_t dir_most_recent_time ;
+        rstime_t dir_update_time ;
+
+        std::vector<DirectoryStorage::EntryIndex> subdirs ;
+        std::vector<DirectoryStorage::EntryIndex> subfiles ;
+    };
+
+    static constexpr uint32_t ENTRY_TYPE_SHIFT = 30 ;
+    static constexpr uint32_t ENTRY_SLOT_MASK  = 0x3fffffff ;
+    static constexpr uint32_t NO_ENTRY         = 0xffffffff ;
+
+    bool isFile(DirectoryStorage::EntryIndex indx) const { return indx < mEntries.size() && mEntries[indx] != NO_ENTRY && (mEntries[indx] >> ENTRY_TYPE_SHIFT) == FileStorageNode::TYPE_FILE ; }
+    bool isDir (DirectoryStorage::EntryIndex indx) const { return indx < mEntries.size() && mEntries[indx] != NO_ENTRY && (mEntries[indx] >> ENTRY_TYPE_SHIFT) == FileStorageNode::TYPE_DIR ; }
+
+    // No check is done here. References are invalidated when a new entry of the same kind is created.
+
+    FileRecord&       fileRecord(DirectoryStorage::EntryIndex indx)       { return mFiles[mEntries[indx] & ENTRY_SLOT_MASK] ; }
+    const FileRecord& fileRecord(DirectoryStorage::EntryIndex indx) const { return mFiles[mEntries[indx] & ENTRY_SLOT_MASK] ; }
+    DirRecord&        dirRecord (DirectoryStorage::EntryIndex indx)       { return mDirs [mEntries[indx] & ENTRY_SLOT_MASK] ; }
+    const DirRecord&  dirRecord (DirectoryStorage::EntryIndex indx) const { return mDirs [mEntries[indx] & ENTRY_SLOT_MASK] ; }
+
+    DirectoryStorage::EntryIndex& parentIndex(DirectoryStorage::EntryIndex indx) { return isFile(indx)?fileRecord(indx).parent_index:dirRecord(indx).parent_index ; }
+    uint32_t& row(DirectoryStorage::EntryIndex indx) { return isFile(indx)?fileRecord(indx).row:dirRecord(indx).row ; }
+
+    static rstime_t DirRecord::* recordTS(rstime_t DirEntry::* m) ;
+
     void recursPrint(int depth,DirectoryStorage::EntryIndex node) const;
     static bool nodeAccessError(const std::string& s);
     static RsFileHash createDirHash(const std::string& dir_name, const RsFileHash &dir_parent_hash, const RsFileHash &random_hash_salt) ;
 
-    // Allocates a new entry in mNodes, possible re-using an empty slot and returns its index.
+    // Allocates a new entry in mEntries, possible re-using an empty slot and returns its index.
 
     DirectoryStorage::EntryIndex allocateNewIndex();
 
-    // Deletes an existing entry in mNodes, and keeps record of the indices that get freed.
+    // Creates a file or dir at the given entry index, which must be free. Names are interned. Hash tables are not updated.
+
+    void createFileEntry(DirectoryStorage::EntryIndex indx,const FileEntry& fe) ;
+    void createDirEntry(DirectoryStorage::EntryIndex indx,const DirEntry& de) ;
+
+    // Deletes an existing entry in mEntries, and keeps record of the indices that get freed.
 
     void deleteNode(DirectoryStorage::EntryIndex);
     void deleteFileNode(DirectoryStorage::EntryIndex);
 
+    // Removes everything, including the top directory.
+
+    void clear() ;
+
     // Removes the given subdirectory from the parent node and all its pendign subdirs. Files are kept, and will go during the cleaning
     // phase. That allows to keep file information when moving them around.
 
     bool recursRemoveDirectory(DirectoryStorage::EntryIndex dir);
 
+    // Search helpers. Only files referenced in mFileHashes are considered, as in the full searches.
+
+    bool fileMatchesTerms(DirectoryStorage::EntryIndex indx,const std::list<std::string>& terms) const ;
+    bool fileMatchesBoolExp(DirectoryStorage::EntryIndex indx,RsRegularExpression::Expression *exp) const ;
+    bool isSearchableFile(DirectoryStorage::EntryIndex indx) const ;
+
+    std::vector<uint32_t> mEntries ;	// (type << ENTRY_TYPE_SHIFT) | position in mFiles or mDirs. NO_ENTRY for free entries.
+    std::vector<FileRecord> mFiles ;
+    std::vector<DirRecord> mDirs ;
+    std::vector<uint32_t> mFreeFileSlots ;
+    std::vector<uint32_t> mFreeDirSlots ;
+
+    NameTable mNames ;
+
     // Map of the hash of all files. The file hashes are the sha1sum of the file data.
     // is used for fast search access for FT.
-    // Note: We should try something faster than std::map. hash_map??
     // Unlike directories, multiple files may have the same hash. So this cannot be used for anything else than FT.
 
-    std::map<RsFileHash,DirectoryStorage::EntryIndex> mFileHashes ;
+    HashIndexTable mFileHashes ;
 
     // The directory hashes are the sha1sum of the
     // full public path to the directory.
@@ -189,11 +281,13 @@ private:
     // This is kept separate from mFileHashes because the two are used
     // in very different ways.
     //
-    std::map<RsFileHash,DirectoryStorage::EntryIndex> mDirHashes ;
+    HashIndexTable mDirHashes ;
 
     // high level statistics on the full hierarchy. Should be kept up to date.
 
     uint32_t mTotalFiles ;
     uint64_t mTotalSize ;
-};
 
+    FileSearchIndex *mSearchIndex ;
+    uint32_t mSearchIndexId ;
+};
@@ -30,6 +30,7 @@
 #include "file_sharing_defaults.h"
 #include "directory_storage.h"
 #include "dir_hierarchy.h"
+#include "compact_file_list.h"
 #include "filelist_io.h"
 #include "util/cxx17retrocompat.h"
 
@@ -45,6 +46,9 @@
 
 DirectoryStorage::DirIterator::DirIterator(DirectoryStorage *s,DirectoryStorage::EntryIndex i)
 {
+    if(s->mMappedList != NULL)
+        s->materialise() ;
+
     mStorage = s->mFileHierarchy ;
     mParentIndex = i;
     mDirTabIndex = 0;
@@ -52,6 +56,9 @@ DirectoryStorage::DirIterator::DirIterator(DirectoryStorage *s,DirectoryStorage:
 
 DirectoryStorage::FileIterator::FileIterator(DirectoryStorage *s,DirectoryStorage::EntryIndex i)
 {
+    if(s->mMappedList != NULL)
+        s->materialise() ;
+
     mStorage = s->mFileHierarchy ;
     mParentIndex = i;
     mFileTabIndex = 0;
@@ -78,19 +85,19 @@ DirectoryStorage::EntryIndex DirectoryStorage::DirIterator::operator*() const
 DirectoryStorage::FileIterator::operator bool() const { return **this != DirectoryStorage::NO_INDEX; }
 DirectoryStorage::DirIterator ::operator bool() const { return **this != DirectoryStorage::NO_INDEX; }
 
-RsFileHash  DirectoryStorage::FileIterator::hash()     const { const InternalFileHierarchyStorage::FileEntry *f = mStorage->getFileEntry(**this) ; return f?(f->file_hash):RsFileHash(); }
-uint64_t    DirectoryStorage::FileIterator::size()     const { const InternalFileHierarchyStorage::FileEntry *f = mStorage->getFileEntry(**this) ; return f?(f->file_size):0; }
-std::string DirectoryStorage::FileIterator::name()     const { const InternalFileHierarchyStorage::FileEntry *f = mStorage->getFileEntry(**this) ; return f?(f->file_name):std::string(); }
-rstime_t      DirectoryStorage::FileIterator::modtime()  const { const InternalFileHierarchyStorage::FileEntry *f = mStorage->getFileEntry(**this) ; return f?(f->file_modtime):0; }
+RsFileHash  DirectoryStorage::FileIterator::hash()     const { InternalFileHierarchyStorage::FileEntry f ; return mStorage->getFileEntry(**this,f,false)?(f.file_hash):RsFileHash(); }
+uint64_t    DirectoryStorage::FileIterator::size()     const { InternalFileHierarchyStorage::FileEntry f ; return mStorage->getFileEntry(**this,f,false)?(f.file_size):0; }
+std::string DirectoryStorage::FileIterator::name()     const { std::string s ; return mStorage->getName(**this,s)?s:std::string(); }
+rstime_t      DirectoryStorage::FileIterator::modtime()  const { InternalFileHierarchyStorage::FileEntry f ; return mStorage->getFileEntry(**this,f,false)?(f.file_modtime):0; }
 
-std::string DirectoryStorage::DirIterator::name()      const { const InternalFileHierarchyStorage::DirEntry *d = mStorage->getDirEntry(**this) ; return d?(d->dir_name):std::string(); }
+std::string DirectoryStorage::DirIterator::name()      const { std::string s ; return mStorage->getName(**this,s)?s:std::string(); }
 
 /******************************************************************************************************************/
 /*                                                 Directory Storage                                              */
 /******************************************************************************************************************/
 
 DirectoryStorage::DirectoryStorage(const RsPeerId &pid,const std::string& fname)
-    : mPeerId(pid), mDirStorageMtx("Directory storage "+pid.toStdString()),mLastSavedTime(0),mChanged(false),mFileName(fname)
+    : mPeerId(pid), mDirStorageMtx("Directory storage "+pid.toStdString()),mMappedList(NULL),mLastSavedTime(0),mChanged(false),mFileName(fname)
 {
 	{
 		RS_STACK_MUTEX(mDirStorageMtx) ;
@@ -101,9 +108,32 @@ DirectoryStorage::DirectoryStorage(const RsPeerId &pid,const std::string& fname)
 
 DirectoryStorage::~DirectoryStorage()
 {
+	delete mMappedList;
 	delete mFileHierarchy;
 }
 
+void DirectoryStorage::materialise() const
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+    locked_materialise() ;
+}
+
+void DirectoryStorage::locked_materialise() const
+{
+    if(mMappedList == NULL)
+        return ;
+
+    // Entry indices do not change, so the search index and the pointers given to the GUI stay valid.
+
+    if(!mMappedList->materialise(*mFileHierarchy))
+        std::cerr << "(EE) Cannot load file list " << mFileName << ". Starting from an empty list." << std::endl;
+
+    mFileHierarchy->recursUpdateCumulatedSize(mFileHierarchy->mRoot);
+
+    delete mMappedList ;
+    mMappedList = NULL ;
+}
+
 DirectoryStorage::EntryIndex DirectoryStorage::root() const
 {
     return EntryIndex(0) ;
@@ -112,12 +142,18 @@ int DirectoryStorage::parentRow(EntryIndex e) const
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
 
+    if(mMappedList != NULL)
+        return mMappedList->parentRow(e) ;
+
     return mFileHierarchy->parentRow(e) ;
 }
 bool DirectoryStorage::getChildIndex(EntryIndex e,int row,EntryIndex& c) const
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
 
+    if(mMappedList != NULL)
+        return mMappedList->getChildIndex(e,row,c) ;
+
     return mFileHierarchy->getChildIndex(e,row,c) ;
 }
 
@@ -125,7 +161,7 @@ uint32_t DirectoryStorage::getEntryType(const EntryIndex& indx)
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
 
-    switch(mFileHierarchy->getType(indx))
+    switch(mMappedList?(mMappedList->getType(indx)):(mFileHierarchy->getType(indx)))
     {
     case InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR:  return DIR_TYPE_DIR ;
     case InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE: return DIR_TYPE_FILE ;
@@ -134,17 +170,18 @@ uint32_t DirectoryStorage::getEntryType(const EntryIndex& indx)
     }
 }
 
-bool DirectoryStorage::getDirectoryUpdateTime   (EntryIndex index,rstime_t& update_TS) const { RS_STACK_MUTEX(mDirStorageMtx) ; return mFileHierarchy->getTS(index,update_TS,&InternalFileHierarchyStorage::DirEntry::dir_update_time     ); }
-bool DirectoryStorage::getDirectoryRecursModTime(EntryIndex index,rstime_t& rec_md_TS) const { RS_STACK_MUTEX(mDirStorageMtx) ; return mFileHierarchy->getTS(index,rec_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_most_recent_time); }
-bool DirectoryStorage::getDirectoryLocalModTime (EntryIndex index,rstime_t& loc_md_TS) const { RS_STACK_MUTEX(mDirStorageMtx) ; return mFileHierarchy->getTS(index,loc_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_modtime         ); }
+bool DirectoryStorage::getDirectoryUpdateTime   (EntryIndex index,rstime_t& update_TS) const { RS_STACK_MUTEX(mDirStorageMtx) ; return mMappedList?mMappedList->getTS(index,update_TS,&InternalFileHierarchyStorage::DirEntry::dir_update_time     ):mFileHierarchy->getTS(index,update_TS,&InternalFileHierarchyStorage::DirEntry::dir_update_time     ); }
+bool DirectoryStorage::getDirectoryRecursModTime(EntryIndex index,rstime_t& rec_md_TS) const { RS_STACK_MUTEX(mDirStorageMtx) ; return mMappedList?mMappedList->getTS(index,rec_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_most_recent_time):mFileHierarchy->getTS(index,rec_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_most_recent_time); }
+bool DirectoryStorage::getDirectoryLocalModTime (EntryIndex index,rstime_t& loc_md_TS) const { RS_STACK_MUTEX(mDirStorageMtx) ; return mMappedList?mMappedList->getTS(index,loc_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_modtime         ):mFileHierarchy->getTS(index,loc_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_modtime         ); }
 
-bool DirectoryStorage::setDirectoryUpdateTime   (EntryIndex index,rstime_t  update_TS) { RS_STACK_MUTEX(mDirStorageMtx) ; return mFileHierarchy->setTS(index,update_TS,&InternalFileHierarchyStorage::DirEntry::dir_update_time     ); }
-bool DirectoryStorage::setDirectoryRecursModTime(EntryIndex index,rstime_t  rec_md_TS) { RS_STACK_MUTEX(mDirStorageMtx) ; return mFileHierarchy->setTS(index,rec_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_most_recent_time); }
-bool DirectoryStorage::setDirectoryLocalModTime (EntryIndex index,rstime_t  loc_md_TS) { RS_STACK_MUTEX(mDirStorageMtx) ; return mFileHierarchy->setTS(index,loc_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_modtime         ); }
+bool DirectoryStorage::setDirectoryUpdateTime   (EntryIndex index,rstime_t  update_TS) { RS_STACK_MUTEX(mDirStorageMtx) ; locked_materialise() ; return mFileHierarchy->setTS(index,update_TS,&InternalFileHierarchyStorage::DirEntry::dir_update_time     ); }
+bool DirectoryStorage::setDirectoryRecursModTime(EntryIndex index,rstime_t  rec_md_TS) { RS_STACK_MUTEX(mDirStorageMtx) ; locked_materialise() ; return mFileHierarchy->setTS(index,rec_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_most_recent_time); }
+bool DirectoryStorage::setDirectoryLocalModTime (EntryIndex index,rstime_t  loc_md_TS) { RS_STACK_MUTEX(mDirStorageMtx) ; locked_materialise() ; return mFileHierarchy->setTS(index,loc_md_TS,&InternalFileHierarchyStorage::DirEntry::dir_modtime         ); }
 
 bool DirectoryStorage::updateSubDirectoryList(const EntryIndex& indx, const std::set<std::string> &subdirs, const RsFileHash& hash_salt)
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+    locked_materialise() ;
     bool res = mFileHierarchy->updateSubDirectoryList(indx,subdirs,hash_salt) ;
     mChanged = true ;
     return res ;
@@ -154,6 +191,7 @@ bool DirectoryStorage::updateSubFilesList(
         std::map<std::string,FileTS>& new_files )
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+    locked_materialise() ;
     bool res = mFileHierarchy->updateSubFilesList(indx,subfiles,new_files) ;
     mChanged = true ;
     return res ;
@@ -161,6 +199,7 @@ bool DirectoryStorage::updateSubFilesList(
 bool DirectoryStorage::removeDirectory(const EntryIndex& indx)
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+    locked_materialise() ;
     bool res = mFileHierarchy->removeDirectory(indx);
     mChanged = true ;
 
@@ -177,13 +216,27 @@ void DirectoryStorage::locked_check()
 void DirectoryStorage::getStatistics(SharedDirStats& stats)
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
-    mFileHierarchy->getStatistics(stats);
+
+    if(mMappedList != NULL)
+        mMappedList->getStatistics(stats);
+    else
+        mFileHierarchy->getStatistics(stats);
 }
 
 bool DirectoryStorage::load(const std::string& local_file_name)
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
     mChanged = false ;
+
+    // Compact file lists are only mapped. The hierarchy gets loaded when it needs to change.
+
+    if(CompactFileList::isCompactFile(local_file_name))
+    {
+        delete mMappedList ;
+        mMappedList = CompactFileList::open(local_file_name) ;
+
+        return mMappedList != NULL ;
+    }
     return mFileHierarchy->load(local_file_name);
 }
 void DirectoryStorage::save(const std::string& local_file_name)
@@ -194,6 +247,7 @@ void DirectoryStorage::save(const std::string& local_file_name)
 void DirectoryStorage::print()
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+    locked_materialise() ;
     mFileHierarchy->print();
 }
 
@@ -202,18 +256,60 @@ int DirectoryStorage::searchTerms(
         std::list<EntryIndex>& results ) const
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+
+    if(mMappedList != NULL)
+        return mMappedList->searchTerms(terms,results);
+
     return mFileHierarchy->searchTerms(terms,results);
 }
 int DirectoryStorage::searchBoolExp(RsRegularExpression::Expression * exp, std::list<EntryIndex> &results) const
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+
+    if(mMappedList != NULL)
+        return mMappedList->searchBoolExp(exp,results);
+
     return mFileHierarchy->searchBoolExp(exp,results);
 }
+int DirectoryStorage::searchTerms(
+        const std::list<std::string>& terms,
+        const std::vector<EntryIndex>& candidates,
+        std::list<EntryIndex>& results ) const
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+
+    if(mMappedList != NULL)
+        return mMappedList->searchTerms(terms,candidates,results);
+
+    return mFileHierarchy->searchTerms(terms,candidates,results);
+}
+int DirectoryStorage::searchBoolExp(RsRegularExpression::Expression * exp, const std::vector<EntryIndex>& candidates, std::list<EntryIndex> &results) const
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+
+    if(mMappedList != NULL)
+        return mMappedList->searchBoolExp(exp,candidates,results);
+
+    return mFileHierarchy->searchBoolExp(exp,candidates,results);
+}
+void DirectoryStorage::setSearchIndex(FileSearchIndex *index,uint32_t storage_id)
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+    mFileHierarchy->setSearchIndex(index,storage_id);
+
+    // the hierarchy only has the root directory. It takes over the index when it gets loaded.
+
+    if(mMappedList != NULL && index != NULL)
+        mMappedList->indexFiles(index,storage_id);
+}
 
 bool DirectoryStorage::extractData(const EntryIndex& indx,DirDetails& d)
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
 
+    if(mMappedList != NULL)
+        return locked_extractMappedData(indx,d) ;
+
     d.children.clear() ;
     uint32_t type = mFileHierarchy->getType(indx) ;
 
@@ -221,7 +317,8 @@ bool DirectoryStorage::extractData(const EntryIndex& indx,DirDetails& d)
 
     if (type == InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR) /* has children --- fill */
     {
-        const InternalFileHierarchyStorage::DirEntry *dir_entry = mFileHierarchy->getDirEntry(indx) ;
+        InternalFileHierarchyStorage::DirEntry dir_entry("") ;
+        mFileHierarchy->getDirEntry(indx,dir_entry,false) ;
 
         /* extract all the entries */
 
@@ -247,12 +344,12 @@ bool DirectoryStorage::extractData(const EntryIndex& indx,DirDetails& d)
 
         d.type = DIR_TYPE_DIR;
         d.hash.clear() ;
-        d.size   = dir_entry->dir_cumulated_size;//dir_entry->subdirs.size() + dir_entry->subfiles.size();
-        d.max_mtime = dir_entry->dir_most_recent_time ;
-        d.mtime     = dir_entry->dir_modtime ;
-        d.name    = dir_entry->dir_name;
-		d.path    = RsDirUtil::makePath(dir_entry->dir_parent_path, dir_entry->dir_name) ;
-        d.parent  = (void*)(intptr_t)dir_entry->parent_index ;
+        d.size   = dir_entry.dir_cumulated_size;//dir_entry.subdirs.size() + dir_entry.subfiles.size();
+        d.max_mtime = dir_entry.dir_most_recent_time ;
+        d.mtime     = dir_entry.dir_modtime ;
+        d.name    = dir_entry.dir_name;
+		d.path    = RsDirUtil::makePath(dir_entry.dir_parent_path, dir_entry.dir_name) ;
+        d.parent  = (void*)(intptr_t)dir_entry.parent_index ;
 
         if(indx == 0)
         {
@@ -262,20 +359,91 @@ bool DirectoryStorage::extractData(const EntryIndex& indx,DirDetails& d)
     }
     else if(type == InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE)
     {
-        const InternalFileHierarchyStorage::FileEntry *file_entry = mFileHierarchy->getFileEntry(indx) ;
+        InternalFileHierarchyStorage::FileEntry file_entry ;
+        mFileHierarchy->getFileEntry(indx,file_entry) ;
 
         d.type    = DIR_TYPE_FILE;
-        d.size   = file_entry->file_size;
-        d.max_mtime = file_entry->file_modtime ;
-        d.name    = file_entry->file_name;
-        d.hash    = file_entry->file_hash;
-        d.mtime     = file_entry->file_modtime;
-        d.parent  = (void*)(intptr_t)file_entry->parent_index ;
+        d.size   = file_entry.file_size;
+        d.max_mtime = file_entry.file_modtime ;
+        d.name    = file_entry.file_name;
+        d.hash    = file_entry.file_hash;
+        d.mtime     = file_entry.file_modtime;
+        d.parent  = (void*)(intptr_t)file_entry.parent_index ;
+
+        InternalFileHierarchyStorage::DirEntry parent_dir_entry("") ;
+
+        if(mFileHierarchy->getDirEntry(file_entry.parent_index,parent_dir_entry,false))
+			d.path = RsDirUtil::makePath(parent_dir_entry.dir_parent_path, parent_dir_entry.dir_name) ;
+        else
+            d.path = "" ;
+    }
+    else
+        return false;
+
+    d.flags.clear() ;
+
+    return true;
+}
+
+bool DirectoryStorage::locked_extractMappedData(const EntryIndex& indx,DirDetails& d)
+{
+    // Same as extractData(), reading the entries from the mapped file list.
+
+    d.children.clear() ;
+    d.ref = (void*)(intptr_t)indx ;
 
-        const InternalFileHierarchyStorage::DirEntry *parent_dir_entry = mFileHierarchy->getDirEntry(file_entry->parent_index);
+    InternalFileHierarchyStorage::DirEntry dir_entry("") ;
+    InternalFileHierarchyStorage::FileEntry file_entry ;
+
+    if(mMappedList->getDirEntry(indx,dir_entry))
+    {
+        for(uint32_t i=0;i<dir_entry.subdirs.size();++i)
+        {
+            DirStub stub;
+            stub.type = DIR_TYPE_DIR;
+            stub.ref  = (void*)(intptr_t)dir_entry.subdirs[i];
+            mMappedList->getName(dir_entry.subdirs[i],stub.name) ;
+
+            d.children.push_back(stub);
+        }
+
+        for(uint32_t i=0;i<dir_entry.subfiles.size();++i)
+        {
+            DirStub stub;
+            stub.type = DIR_TYPE_FILE;
+            stub.ref  = (void*)(intptr_t)dir_entry.subfiles[i];
+            mMappedList->getName(dir_entry.subfiles[i],stub.name) ;
 
-        if(parent_dir_entry != NULL)
-			d.path = RsDirUtil::makePath(parent_dir_entry->dir_parent_path, parent_dir_entry->dir_name) ;
+            d.children.push_back(stub);
+        }
+
+        d.type = DIR_TYPE_DIR;
+        d.hash.clear() ;
+        d.size      = dir_entry.dir_cumulated_size;
+        d.max_mtime = dir_entry.dir_most_recent_time ;
+        d.mtime     = dir_entry.dir_modtime ;
+        d.name      = dir_entry.dir_name;
+        d.path      = RsDirUtil::makePath(dir_entry.dir_parent_path, dir_entry.dir_name) ;
+        d.parent    = (void*)(intptr_t)dir_entry.parent_index ;
+
+        if(indx == 0)
+        {
+            d.type = DIR_TYPE_PERSON ;
+            d.name = mPeerId.toStdString();
+        }
+    }
+    else if(mMappedList->getFileEntry(indx,file_entry))
+    {
+        d.type      = DIR_TYPE_FILE;
+        d.size      = file_entry.file_size;
+        d.max_mtime = file_entry.file_modtime ;
+        d.name      = file_entry.file_name;
+        d.hash      = file_entry.file_hash;
+        d.mtime     = file_entry.file_modtime;
+        d.parent    = (void*)(intptr_t)file_entry.parent_index ;
+
+        if(mMappedList->getDirEntry(file_entry.parent_index,dir_entry,false))
+            d.path = RsDirUtil::makePath(dir_entry.dir_parent_path, dir_entry.dir_name) ;
         else
             d.path = "" ;
     }
@@ -290,11 +458,16 @@ bool DirectoryStorage::extractData(const EntryIndex& indx,DirDetails& d)
 bool DirectoryStorage::getDirHashFromIndex(const EntryIndex& index,RsFileHash& hash) const
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+
+    if(mMappedList != NULL)
+        return mMappedList->getDirHashFromIndex(index,hash) ;
+
     return mFileHierarchy->getDirHashFromIndex(index,hash) ;
 }
 bool DirectoryStorage::getIndexFromDirHash(const RsFileHash& hash,EntryIndex& index) const
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
+    locked_materialise() ;
     return mFileHierarchy->getIndexFromDirHash(hash,index) ;
 }
 
@@ -643,11 +816,10 @@ bool LocalDirectoryStorage::locked_getFileSharingPermissions(
 	 * clearing outputs */
 	if(!indx) return true;
 
-	using FileStorageNode = InternalFileHierarchyStorage::FileStorageNode;
 	using EntryIndex = DirectoryStorage::EntryIndex;
 
-	rs_view_ptr<const FileStorageNode> n = mFileHierarchy->getNode(indx);
-	if(!n)
+	EntryIndex parent;
+	if(!mFileHierarchy->getParentIndex(indx, parent))
 	{
 		RS_ERR("Node for index: ", indx, "not found");
 		print_stacktrace();
@@ -656,26 +828,18 @@ bool LocalDirectoryStorage::locked_getFileSharingPermissions(
 
 	// Climb down node tree up to root + 1
 	EntryIndex curIndex = indx;
-	while (n->parent_index)
+	while (parent)
 	{
-		curIndex = n->parent_index;
-		n = mFileHierarchy->getNode(curIndex);
+		curIndex = parent;
+		if(!mFileHierarchy->getParentIndex(curIndex, parent)) return false;
 	}
 
-	// Retrieve base name
+	/* Retrieve base name. That is the name of the shared directory, or of the
+	 * file in case of single file shared */
 	std::string tBaseName;
-	switch (n->type())
+	if(!mFileHierarchy->getName(curIndex, tBaseName))
 	{
-	// Handle single file shared case
-	case InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE:
-		tBaseName = mFileHierarchy->getFileEntry(curIndex)->file_name;
-		break;
-	// Handle shared directory case
-	case InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR:
-		tBaseName = mFileHierarchy->getDirEntry(curIndex)->dir_name;
-		break;
-	default:
-		RS_ERR("Got unhandled node type: ", n->type());
+		RS_ERR("Got unhandled node type: ", mFileHierarchy->getType(curIndex));
 		print_stacktrace();
 		return false;
 	}
@@ -711,16 +875,17 @@ std::string LocalDirectoryStorage::locked_getVirtualDirName(EntryIndex indx) con
     if(indx == 0)
         return std::string() ;
 
-    const InternalFileHierarchyStorage::DirEntry *dir = mFileHierarchy->getDirEntry(indx);
+    InternalFileHierarchyStorage::DirEntry dir("") ;
+    mFileHierarchy->getDirEntry(indx,dir,false);
 
-    if(dir->parent_index != 0)
-        return dir->dir_name ;
+    if(dir.parent_index != 0)
+        return dir.dir_name ;
 
-   std::map<std::string,SharedDirInfo>::const_iterator it = mLocalDirs.find(dir->dir_name) ;
+   std::map<std::string,SharedDirInfo>::const_iterator it = mLocalDirs.find(dir.dir_name) ;
 
    if(it == mLocalDirs.end())
    {
-       std::cerr << "(EE) Cannot find real name " << dir->dir_name << " at level 1 among shared dirs. Bug?" << std::endl;
+       std::cerr << "(EE) Cannot find real name " << dir.dir_name << " at level 1 among shared dirs. Bug?" << std::endl;
        return std::string() ;
    }
 
@@ -732,19 +897,20 @@ std::string LocalDirectoryStorage::locked_getVirtualPath(EntryIndex indx) const
         return std::string() ;
 
     std::string res ;
-    const InternalFileHierarchyStorage::DirEntry *dir = mFileHierarchy->getDirEntry(indx);
+    InternalFileHierarchyStorage::DirEntry dir("") ;
+    mFileHierarchy->getDirEntry(indx,dir,false);
 
-    while(dir->parent_index != 0)
+    while(dir.parent_index != 0)
     {
-        dir = mFileHierarchy->getDirEntry(dir->parent_index) ;
-        res += dir->dir_name + "/"+ res ;
+        mFileHierarchy->getDirEntry(dir.parent_index,dir,false) ;
+        res += dir.dir_name + "/"+ res ;
     }
 
-   std::map<std::string,SharedDirInfo>::const_iterator it = mLocalDirs.find(dir->dir_name) ;
+   std::map<std::string,SharedDirInfo>::const_iterator it = mLocalDirs.find(dir.dir_name) ;
 
    if(it == mLocalDirs.end())
    {
-       std::cerr << "(EE) Cannot find real name " << dir->dir_name << " at level 1 among shared dirs. Bug?" << std::endl;
+       std::cerr << "(EE) Cannot find real name " << dir.dir_name << " at level 1 among shared dirs. Bug?" << std::endl;
        return std::string() ;
    }
    return it->second.virtualname + "/" + res;
@@ -756,14 +922,13 @@ bool LocalDirectoryStorage::serialiseDirEntry(
 {
 	RS_STACK_MUTEX(mDirStorageMtx);
 
-	const InternalFileHierarchyStorage::DirEntry* dir =
-	        mFileHierarchy->getDirEntry(indx);
+	InternalFileHierarchyStorage::DirEntry dir("");
 
 #ifdef DEBUG_LOCAL_DIRECTORY_STORAGE
     std::cerr << "Serialising Dir entry " << std::hex << indx << " for client id " << client_id << std::endl;
 #endif
 
-	if(!dir)
+	if(!mFileHierarchy->getDirEntry(indx, dir))
 	{
 		RS_ERR("Cannot find entry ", indx);
 		return false;
@@ -778,31 +943,31 @@ bool LocalDirectoryStorage::serialiseDirEntry(
 	 * compute the mask that result from these flags for the particular peer
 	 * supplied in parameter */
 
-	for(uint32_t i=0;i<dir->subdirs.size();++i)
+	for(uint32_t i=0;i<dir.subdirs.size();++i)
 		if(indx != 0 || (
 		            locked_getFileSharingPermissions(
-		                dir->subdirs[i], node_flags, node_groups ) &&
+		                dir.subdirs[i], node_flags, node_groups ) &&
 		            ( rsPeers->computePeerPermissionFlags(
 		                  client_id, node_flags, node_groups ) &
 		              RS_FILE_HINTS_BROWSABLE ) ))
 		{
 			RsFileHash hash;
-			if(!mFileHierarchy->getDirHashFromIndex(dir->subdirs[i],hash))
+			if(!mFileHierarchy->getDirHashFromIndex(dir.subdirs[i],hash))
 			{
 				RS_ERR( "Cannot get hash from subdir index: ",
-				        dir->subdirs[i], ". Weird bug." );
+				        dir.subdirs[i], ". Weird bug." );
 				print_stacktrace();
 				return false;
 			}
 			allowed_subdirs.push_back(hash);
 
 #ifdef DEBUG_LOCAL_DIRECTORY_STORAGE
-            std::cerr << "  pushing subdir " << hash << ", array position=" << i << " indx=" << dir->subdirs[i] << std::endl;
+            std::cerr << "  pushing subdir " << hash << ", array position=" << i << " indx=" << dir.subdirs[i] << std::endl;
 #endif
 		}
 #ifdef DEBUG_LOCAL_DIRECTORY_STORAGE
         else
-            std::cerr << "  not pushing subdir " << hash << ", array position=" << i << " indx=" << dir->subdirs[i] << ": permission denied for this peer." << std::endl;
+            std::cerr << "  not pushing subdir " << hash << ", array position=" << i << " indx=" << dir.subdirs[i] << ": permission denied for this peer." << std::endl;
 #endif
 
 	/* now count the files that do not have a null hash (meaning the hash has
@@ -810,14 +975,14 @@ bool LocalDirectoryStorage::serialiseDirEntry(
 	 * a shared directory) so they are child of root check browsability
 	 * permission */
 	uint32_t allowed_subfiles = 0;
-	for(uint32_t i=0; i<dir->subfiles.size(); ++i)
+	for(uint32_t i=0; i<dir.subfiles.size(); ++i)
 	{
-		const InternalFileHierarchyStorage::FileEntry* file =
-		        mFileHierarchy->getFileEntry(dir->subfiles[i]);
-		if(file != nullptr && !file->file_hash.isNull()
+		InternalFileHierarchyStorage::FileEntry file;
+		if(mFileHierarchy->getFileEntry(dir.subfiles[i], file, false)
+		        && !file.file_hash.isNull()
 		        && ( indx !=0 || (
 		                 locked_getFileSharingPermissions(
-		                     dir->subfiles[i], node_flags, node_groups ) &&
+		                     dir.subfiles[i], node_flags, node_groups ) &&
 		                 rsPeers->computePeerPermissionFlags(
 		                     client_id, node_flags, node_groups ) &
 		                 RS_FILE_HINTS_BROWSABLE ) ))
@@ -848,11 +1013,11 @@ bool LocalDirectoryStorage::serialiseDirEntry(
 	if(!FileListIO::writeField(
 	            section_data, section_size, section_offset,
 	            FILE_LIST_IO_TAG_RECURS_MODIF_TS,
-	            (uint32_t)dir->dir_most_recent_time ))
+	            (uint32_t)dir.dir_most_recent_time ))
 	{ free(section_data); return false; }
 	if(!FileListIO::writeField(
 	            section_data, section_size, section_offset,
-	            FILE_LIST_IO_TAG_MODIF_TS, (uint32_t)dir->dir_modtime ))
+	            FILE_LIST_IO_TAG_MODIF_TS, (uint32_t)dir.dir_modtime ))
 	{ free(section_data); return false;}
 
 	// serialise number of subdirs and number of subfiles
@@ -884,27 +1049,27 @@ bool LocalDirectoryStorage::serialiseDirEntry(
 
 	uint32_t file_section_size = FL_BASE_TMP_SECTION_SIZE;
 
-	for(uint32_t i=0; i<dir->subfiles.size(); ++i)
+	for(uint32_t i=0; i<dir.subfiles.size(); ++i)
 	{
 		uint32_t file_section_offset = 0;
 
-		const InternalFileHierarchyStorage::FileEntry* file =
-		        mFileHierarchy->getFileEntry(dir->subfiles[i]);
+		InternalFileHierarchyStorage::FileEntry file;
 
-		if(file == nullptr || file->file_hash.isNull())
+		if( !mFileHierarchy->getFileEntry(dir.subfiles[i], file)
+		        || file.file_hash.isNull() )
 		{
 			RS_INFO( "skipping unhashed or Null file entry ",
-			         dir->subfiles[i], " to get/send file info." );
+			         dir.subfiles[i], " to get/send file info." );
 			continue;
 		}
 
 		if(indx == 0)
 		{
 			if(!locked_getFileSharingPermissions(
-			            dir->subfiles[i], node_flags, node_groups ))
+			            dir.subfiles[i], node_flags, node_groups ))
 			{
 				RS_ERR( "Failure getting sharing permission for single file: ",
-				        dir->subfiles[i] );
+				        dir.subfiles[i] );
 				print_stacktrace();
 				continue;
 			}
@@ -921,19 +1086,19 @@ bool LocalDirectoryStorage::serialiseDirEntry(
 
 		if(!FileListIO::writeField(
 		            file_section_data, file_section_size, file_section_offset,
-		            FILE_LIST_IO_TAG_FILE_NAME, file->file_name ))
+		            FILE_LIST_IO_TAG_FILE_NAME, file.file_name ))
 		{ free(section_data); free(file_section_data); return false; }
 		if(!FileListIO::writeField(
 		            file_section_data, file_section_size, file_section_offset,
-		            FILE_LIST_IO_TAG_FILE_SIZE, file->file_size ))
+		            FILE_LIST_IO_TAG_FILE_SIZE, file.file_size ))
 		{ free(section_data); free(file_section_data); return false; }
 		if(!FileListIO::writeField(
 		            file_section_data, file_section_size, file_section_offset,
-		            FILE_LIST_IO_TAG_FILE_SHA1_HASH, file->file_hash ))
+		            FILE_LIST_IO_TAG_FILE_SHA1_HASH, file.file_hash ))
 		{ free(section_data); free(file_section_data); return false; }
 		if(!FileListIO::writeField(
 		            file_section_data, file_section_size, file_section_offset,
-		            FILE_LIST_IO_TAG_MODIF_TS, (uint32_t)file->file_modtime ))
+		            FILE_LIST_IO_TAG_MODIF_TS, (uint32_t)file.file_modtime ))
 		{ free(section_data); free(file_section_data); return false; }
 
 		// now write the whole string into a single section in the file
@@ -944,7 +1109,7 @@ bool LocalDirectoryStorage::serialiseDirEntry(
 		{ free(section_data); free(file_section_data); return false; }
 
 #ifdef DEBUG_LOCAL_DIRECTORY_STORAGE
-        std::cerr << "  pushing subfile " << file->hash << ", array position=" << i << " indx=" << dir->subfiles[i] << std::endl;
+        std::cerr << "  pushing subfile " << file.hash << ", array position=" << i << " indx=" << dir.subfiles[i] << std::endl;
 #endif
 	}
 	free(file_section_data);
@@ -971,6 +1136,11 @@ RemoteDirectoryStorage::RemoteDirectoryStorage(const RsPeerId& pid,const std::st
     mLastSweepTime = time(NULL) - (RSRandom::random_u32() % DELAY_BETWEEN_REMOTE_DIRECTORIES_SWEEP) ;
 
     std::cerr << "Loaded remote directory for peer " << pid << ", inited last sweep time to " << time(NULL) - mLastSweepTime << " secs ago." << std::endl;
+
+    // File lists saved in the former format are written again in the compact one.
+
+    if(mMappedList == NULL && RsDirUtil::fileExists(fname))
+        mChanged = true ;
 #ifdef DEBUG_REMOTE_DIRECTORY_STORAGE
     mFileHierarchy->print();
 #endif
@@ -1062,6 +1232,7 @@ bool RemoteDirectoryStorage::deserialiseUpdateDirEntry(const EntryIndex& indx,co
 #ifdef DEBUG_REMOTE_DIRECTORY_STORAGE
     std::cerr << "  updating dir entry..." << std::endl;
 #endif
+    locked_materialise() ;
 
     // First create the entries for each subdir and each subfile, if needed.
     if(!mFileHierarchy->updateDirEntry(indx,dir_name,most_recent_time,dir_modtime,subdirs_hashes,subfiles_array))
@@ -1079,8 +1250,21 @@ int RemoteDirectoryStorage::searchHash(const RsFileHash& hash, EntryIndex& resul
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
 
+    if(mMappedList != NULL)
+        return mMappedList->searchHash(hash,result);
+
     return mFileHierarchy->searchHash(hash,result);
 }
 
+void RemoteDirectoryStorage::save(const std::string& local_file_name)
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+
+    if(mMappedList != NULL)		// nothing changed since the file was written
+        return ;
+
+    CompactFileList::save(*mFileHierarchy,local_file_name);
+}
+
 
 
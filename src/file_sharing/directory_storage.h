@@ -24,6 +24,7 @@
 #include <string>
 #include <stdint.h>
 #include <list>
+#include <vector>
 
 #include "retroshare/rsids.h"
 #include "retroshare/rsfiles.h"
@@ -33,6 +34,8 @@
 
 class RsTlvBinaryData ;
 class InternalFileHierarchyStorage ;
+class CompactFileList ;
+class FileSearchIndex ;
 class RsTlvBinaryData ;
 
 class DirectoryStorage
@@ -51,6 +54,15 @@ class DirectoryStorage
         virtual int searchTerms(const std::list<std::string>& terms, std::list<EntryIndex> &results) const ;
         virtual int searchBoolExp(RsRegularExpression::Expression * exp, std::list<EntryIndex> &results) const ;
 
+        // Same as above, restricted to the given candidate entries, as returned by a FileSearchIndex.
+
+        int searchTerms(const std::list<std::string>& terms, const std::vector<EntryIndex>& candidates, std::list<EntryIndex> &results) const ;
+        int searchBoolExp(RsRegularExpression::Expression * exp, const std::vector<EntryIndex>& candidates, std::list<EntryIndex> &results) const ;
+
+        // Indexes all files of this storage into the given index under the given id, and keeps it up to date. NULL detaches the index.
+
+        void setSearchIndex(FileSearchIndex *index,uint32_t storage_id) ;
+
         // gets/sets the various time stamps:
         //
         bool getDirectoryRecursModTime(EntryIndex index,rstime_t& recurs_max_modf_TS) const ;		// last modification time, computed recursively over all subfiles and directories
@@ -156,12 +168,18 @@ class DirectoryStorage
 
     protected:
         bool load(const std::string& local_file_name) ;
-		void save(const std::string& local_file_name) ;
+		virtual void save(const std::string& local_file_name) ;
+
+        // Loads the mapped file list in memory, if any. Must be called before changing, or iterating over, the hierarchy.
+
+        void locked_materialise() const ;
+        void materialise() const ;
 
     private:
 
         // debug
         void locked_check();
+        bool locked_extractMappedData(const EntryIndex& indx,DirDetails& d) ;
 
         // storage of internal structure. Totally hidden from the outside. EntryIndex is simply the index of the entry in the vector.
 
@@ -172,6 +190,10 @@ class DirectoryStorage
 
         InternalFileHierarchyStorage *mFileHierarchy ;
 
+        // File list on disk, that is read directly until the hierarchy needs to be loaded in memory. Only remote file lists are stored that way.
+
+        mutable CompactFileList *mMappedList ;
+
 		rstime_t mLastSavedTime ;
 		bool mChanged ;
 		std::string mFileName;
@@ -212,6 +234,9 @@ public:
      */
     virtual int searchHash(const RsFileHash& hash, EntryIndex& results) const ;
 
+protected:
+    virtual void save(const std::string& local_file_name) ;
+
 private:
     rstime_t mLastSweepTime ;
 };
@@ -66,7 +66,7 @@ void LocalDirectoryUpdater::threadTick()
 
     if (mIsEnabled || mForceUpdate)
     {
-        if(now > mDelayBetweenDirectoryUpdates + mLastSweepTime)
+        if(now > delayBetweenSweeps() + mLastSweepTime)
         {
             bool some_files_not_ready = false ;
 
@@ -75,7 +75,7 @@ void LocalDirectoryUpdater::threadTick()
                 if(some_files_not_ready)
                 {
 					mNeedsFullRecheck = true ;
-					mLastSweepTime = now - mDelayBetweenDirectoryUpdates + 60 ; // retry 20 secs from now
+					mLastSweepTime = now - delayBetweenSweeps() + 60 ; // retry 60 secs from now
 
 					std::cerr << "(II) some files being modified. Will re-scan in 60 secs." << std::endl;
                 }
@@ -103,6 +103,9 @@ void LocalDirectoryUpdater::threadTick()
 	{
 		rstime::rs_usleep(1*1000*1000);
 
+		if(mIsEnabled)
+			checkWatchedDirectories() ;
+
 		{
 		if(mForceUpdate)
 			break ;
@@ -110,11 +113,19 @@ void LocalDirectoryUpdater::threadTick()
 	}
 }
 
+rstime_t LocalDirectoryUpdater::delayBetweenSweeps() const
+{
+    if(mDirectoryWatcher.isComplete())
+        return std::max(rstime_t(mDelayBetweenDirectoryUpdates),rstime_t(DELAY_BETWEEN_WATCHED_DIRECTORY_UPDATES)) ;
+    else
+        return mDelayBetweenDirectoryUpdates ;
+}
+
 void LocalDirectoryUpdater::forceUpdate(bool add_safe_delay)
 {
     mForceUpdate = true ;
     mNeedsFullRecheck = true;
-	mLastSweepTime = rstime_t(time(NULL)) - rstime_t(mDelayBetweenDirectoryUpdates) ;
+	mLastSweepTime = rstime_t(time(NULL)) - delayBetweenSweeps() ;
 
     if(add_safe_delay)
         mLastSweepTime += rstime_t(MIN_TIME_AFTER_LAST_MODIFICATION);
@@ -133,6 +144,7 @@ bool LocalDirectoryUpdater::sweepSharedDirectories(bool& some_files_not_ready)
 	}
 
 	mIsChecking = true;
+	mDirectoryWatcher.beginSweep();
 
     if(rsEvents)
     {
@@ -234,6 +246,10 @@ bool LocalDirectoryUpdater::sweepSharedDirectories(bool& some_files_not_ready)
 		 * dir list, because the two are not necessarily in the same order. */
 	}
 
+	/* directories that were not seen during the sweep are not shared anymore */
+	mDirectoryWatcher.endSweep();
+	mSharedRealPaths = existing_dirs;
+
     if(rsEvents)
     {
         auto ev = std::make_shared<RsSharedDirectoriesEvent>();
@@ -252,6 +268,37 @@ void LocalDirectoryUpdater::recursUpdateSharedDir(
 {
 	RS_DBG4("parsing directory \"", cumulated_path, "\" index: ", indx);
 
+	/* watch the directory before reading it, so that no change is missed */
+	mDirectoryWatcher.watch(cumulated_path);
+
+	updateDirectoryContent( cumulated_path, indx, existing_directories, current_branch_real_paths,
+	                        current_depth, mNeedsFullRecheck, some_files_not_ready );
+
+	// go through the list of sub-dirs and recursively update
+	for( DirectoryStorage::DirIterator stored_dir_it(mSharedDirectories, indx);
+	     stored_dir_it; ++stored_dir_it )
+	{
+		std::string next_path = RsDirUtil::makePath(cumulated_path, stored_dir_it.name());
+
+		// canonical cannot be empty here: directories with unresolvable paths
+		// were already filtered out during the subdirs collection phase above.
+		std::string canonical = RsDirUtil::removeSymLinks(next_path);
+
+		current_branch_real_paths.insert(canonical);
+
+		recursUpdateSharedDir( next_path,
+		                       *stored_dir_it, existing_directories, current_branch_real_paths,
+		                       current_depth+1, some_files_not_ready );
+
+		current_branch_real_paths.erase(canonical);
+	}
+}
+
+void LocalDirectoryUpdater::updateDirectoryContent(
+        const std::string& cumulated_path, DirectoryStorage::EntryIndex indx,
+        std::set<std::string>& existing_directories, std::set<std::string>& current_branch_real_paths, uint32_t current_depth,
+        bool force, bool& some_files_not_ready )
+{
 	/* make sure list of subdirs is the same
 	 * make sure list of subfiles is the same
 	 * request all hashes to the hashcache */
@@ -271,7 +318,7 @@ void LocalDirectoryUpdater::recursUpdateSharedDir(
 	/* the > is because we may have changed the virtual name, and therefore the
 	 * TS wont match. We only want to detect when the directory has changed on
 	 * the disk */
-	if(mNeedsFullRecheck || dirIt.dir_modtime() > dir_local_mod_time)
+	if(force || dirIt.dir_modtime() > dir_local_mod_time)
 	{
 		// collect subdirs and subfiles
 		std::map<std::string, DirectoryStorage::FileTS> subfiles;
@@ -383,25 +430,183 @@ void LocalDirectoryUpdater::recursUpdateSharedDir(
 				mSharedDirectories->updateHash(*dit, hash, hash != dit.hash());
 		}
 	}
+}
 
-	// go through the list of sub-dirs and recursively update
+void LocalDirectoryUpdater::checkWatchedDirectories()
+{
+	if(!mDirectoryWatcher.isAvailable() || mHashSalt.isNull())
+		return;
+
+	std::set<std::string> changed_dirs;
+	bool overflow = false;
+
+	mDirectoryWatcher.readEvents(changed_dirs, overflow);
+
+	rstime_t now = time(nullptr);
+
+	if(overflow)
+	{
+		/* events were lost. The next sweep finds the directories that changed
+		 * from their modification time. */
+		RS_WARN("File system events were lost. Shared directories will be swept.");
+		mLastSweepTime = 0;
+	}
+
+	/* wait for the directory to be left alone, as files being written are not
+	 * considered anyway. */
+	for(auto& dir: std::as_const(changed_dirs))
+		if(mPendingDirectoryUpdates.find(dir) == mPendingDirectoryUpdates.end())
+			mPendingDirectoryUpdates[dir] = now + MIN_TIME_AFTER_LAST_MODIFICATION;
+
+	bool changed = false;
+
+	for(auto it(mPendingDirectoryUpdates.begin()); it != mPendingDirectoryUpdates.end();)
+		if(it->second <= now)
+		{
+			bool files_not_ready = false;
+
+			if(updateChangedDirectory(it->first, files_not_ready))
+				changed = true;
+
+			if(files_not_ready)
+			{
+				it->second = now + MIN_TIME_AFTER_LAST_MODIFICATION;
+				++it;
+			}
+			else
+				it = mPendingDirectoryUpdates.erase(it);
+		}
+		else
+			++it;
+
+	if(changed)
+	{
+		mSharedDirectories->notifyTSChanged();
+
+		if(rsEvents)
+		{
+			auto ev = std::make_shared<RsSharedDirectoriesEvent>();
+			ev->mEventCode = RsSharedDirectoriesEventCode::OWN_DIR_LIST_UPDATED;
+			rsEvents->postEvent(ev);
+		}
+	}
+}
+
+bool LocalDirectoryUpdater::updateChangedDirectory(const std::string& path, bool& some_files_not_ready)
+{
+	DirectoryStorage::EntryIndex indx;
+	uint32_t depth = 0;
+	std::set<std::string> current_branch_real_paths;
+
+	/* not shared anymore, or the parent directory has not been updated yet,
+	 * in which case the directory gets parsed along with its parent. */
+	if(!findDirectory(path, indx, depth, current_branch_real_paths))
+	{
+		mDirectoryWatcher.unwatch(path);
+		return false;
+	}
+
+	if(!RsDirUtil::checkDirectory(path))
+	{
+		mDirectoryWatcher.unwatch(path);
+
+		/* the parent directory takes care of removed sub-directories, but
+		 * shared directories have no parent on the disk. */
+		if(depth == 1) mLastSweepTime = 0;
+
+		return false;
+	}
+
+	RS_DBG4("updating changed directory \"", path, "\" index: ", indx);
+
+	/* the sub-directories are looked at again, so they must not be taken as
+	 * duplicates of themselves. */
+	for( DirectoryStorage::DirIterator stored_dir_it(mSharedDirectories, indx);
+	     stored_dir_it; ++stored_dir_it )
+		mSharedRealPaths.erase(RsDirUtil::removeSymLinks(
+		            RsDirUtil::makePath(path, stored_dir_it.name()) ));
+
+	updateDirectoryContent( path, indx, mSharedRealPaths, current_branch_real_paths,
+	                        depth, true, some_files_not_ready );
+
+	/* new sub-directories have never been parsed, and are not watched yet */
 	for( DirectoryStorage::DirIterator stored_dir_it(mSharedDirectories, indx);
 	     stored_dir_it; ++stored_dir_it )
 	{
-		std::string next_path = RsDirUtil::makePath(cumulated_path, stored_dir_it.name());
+		rstime_t dir_local_mod_time;
 
-		// canonical cannot be empty here: directories with unresolvable paths
-		// were already filtered out during the subdirs collection phase above.
+		if( !mSharedDirectories->getDirectoryLocalModTime(*stored_dir_it, dir_local_mod_time)
+		        || dir_local_mod_time != 0 )
+			continue;
+
+		std::string next_path = RsDirUtil::makePath(path, stored_dir_it.name());
 		std::string canonical = RsDirUtil::removeSymLinks(next_path);
 
 		current_branch_real_paths.insert(canonical);
 
 		recursUpdateSharedDir( next_path,
-		                       *stored_dir_it, existing_directories, current_branch_real_paths,
-		                       current_depth+1, some_files_not_ready );
+		                       *stored_dir_it, mSharedRealPaths, current_branch_real_paths,
+		                       depth+1, some_files_not_ready );
 
 		current_branch_real_paths.erase(canonical);
 	}
+
+	return true;
+}
+
+bool LocalDirectoryUpdater::findDirectory(
+        const std::string& path, DirectoryStorage::EntryIndex& indx, uint32_t& depth,
+        std::set<std::string>& branch_real_paths ) const
+{
+	/* names of shared directories are full paths. Below them, the path is
+	 * followed one directory name at a time. */
+	for( DirectoryStorage::DirIterator root_it(mSharedDirectories, mSharedDirectories->root());
+	     root_it; ++root_it )
+	{
+		const std::string& root_path = root_it.name();
+		const std::string prefix = RsDirUtil::makePath(root_path, "");
+
+		if(path != root_path && path.compare(0, prefix.size(), prefix) != 0)
+			continue;
+
+		indx = *root_it;
+		depth = 1;
+		branch_real_paths.clear();
+		branch_real_paths.insert(RsDirUtil::removeSymLinks(root_path));
+
+		std::string current_path = root_path;
+		bool found = true;
+
+		for(size_t start = prefix.size(); found && start < path.size();)
+		{
+			size_t end = path.find('/', start);
+			if(end == std::string::npos) end = path.size();
+
+			const std::string name = path.substr(start, end - start);
+			start = end + 1;
+
+			if(name.empty()) continue;
+
+			found = false;
+
+			for( DirectoryStorage::DirIterator dir_it(mSharedDirectories, indx);
+			     dir_it; ++dir_it )
+				if(dir_it.name() == name)
+				{
+					current_path = RsDirUtil::makePath(current_path, name);
+					indx = *dir_it;
+					++depth;
+					branch_real_paths.insert(RsDirUtil::removeSymLinks(current_path));
+					found = true;
+					break;
+				}
+		}
+
+		if(found)
+			return true;
+	}
+
+	return false;
 }
 
 bool LocalDirectoryUpdater::filterFile(const std::string& fname) const
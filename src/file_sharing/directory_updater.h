@@ -27,6 +27,7 @@
 //
 #include "file_sharing/hash_cache.h"
 #include "file_sharing/directory_storage.h"
+#include "file_sharing/directory_watcher.h"
 #include "util/rstime.h"
 
 class LocalDirectoryUpdater: public HashStorageClient, public RsTickingThread
@@ -70,9 +71,25 @@ protected:
     void recursUpdateSharedDir(const std::string& cumulated_path, DirectoryStorage::EntryIndex indx, std::set<std::string>& existing_directories, std::set<std::string>& current_branch_real_paths, uint32_t current_depth,bool& files_not_ready);
     bool sweepSharedDirectories(bool &some_files_not_ready);
 
+    // Updates the files and sub-directories of a single directory, if it has changed on disk, or always when force is true.
+
+    void updateDirectoryContent(const std::string& cumulated_path, DirectoryStorage::EntryIndex indx, std::set<std::string>& existing_directories, std::set<std::string>& current_branch_real_paths, uint32_t current_depth, bool force, bool& files_not_ready);
+
+    // Reads the changes reported by the directory watcher, and updates the directories that changed, once they have
+    // been left alone for MIN_TIME_AFTER_LAST_MODIFICATION seconds.
+
+    void checkWatchedDirectories();
+    bool updateChangedDirectory(const std::string& path, bool& files_not_ready);
+
 private:
 	bool filterFile(const std::string& fname) const ;	// reponds true if the file passes the ignore lists test.
 
+	// Finds the entry of the given directory of the disk, and the real paths of the directories leading to it.
+	bool findDirectory(const std::string& path, DirectoryStorage::EntryIndex& indx, uint32_t& depth, std::set<std::string>& branch_real_paths) const ;
+
+	// Full sweeps are only consistency checks when all directories are watched for changes.
+	rstime_t delayBetweenSweeps() const ;
+
     HashStorage *mHashCache ;
     LocalDirectoryStorage *mSharedDirectories ;
 
@@ -94,5 +111,9 @@ private:
 
 	std::list<std::string> mIgnoredPrefixes ;
 	std::list<std::string> mIgnoredSuffixes ;
+
+	DirectoryWatcher mDirectoryWatcher ;
+	std::map<std::string,rstime_t> mPendingDirectoryUpdates ;	// directories reported by the watcher, and when to update them
+	std::set<std::string> mSharedRealPaths ;					// real paths of the shared directories, to detect duplicates
 };
 
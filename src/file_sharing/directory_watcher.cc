@@ -0,0 +1,253 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: directory_watcher.cc                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#include <iostream>
+#include <vector>
+
+#ifdef __linux__
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+#include "util/rsdir.h"
+#include "directory_watcher.h"
+
+//#define DEBUG_DIRECTORY_WATCHER 1
+
+#ifdef __linux__
+// Changes in the list of entries of a directory, and files that have been written or touched. IN_MODIFY is not used
+// since files being written are not considered anyway, until they have been left alone for some time.
+
+static const uint32_t WATCH_EVENT_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB
+                                       | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR ;
+
+static const uint32_t EVENT_BUFFER_SIZE = 64*1024 ;
+#endif
+
+static std::string parentDirectory(const std::string& path)
+{
+    std::string parent, file ;
+    RsDirUtil::splitDirFromFile(path,parent,file) ;
+
+    return parent ;
+}
+
+DirectoryWatcher::DirectoryWatcher()
+    : mFd(-1), mComplete(true), mGeneration(0)
+{
+#ifdef __linux__
+    mFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC) ;
+
+    if(mFd < 0)
+        std::cerr << "(WW) Cannot initialise inotify: " << strerror(errno) << ". Shared directories will be checked periodically." << std::endl;
+#endif
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+#ifdef __linux__
+    if(mFd >= 0)
+        close(mFd) ;		// also removes all watches
+#endif
+}
+
+bool DirectoryWatcher::isAvailable() const
+{
+    return mFd >= 0 ;
+}
+
+bool DirectoryWatcher::isComplete() const
+{
+    return mFd >= 0 && mComplete ;
+}
+
+void DirectoryWatcher::beginSweep()
+{
+    ++mGeneration ;
+    mComplete = true ;
+}
+
+void DirectoryWatcher::endSweep()
+{
+    std::set<std::string> to_remove ;
+
+    for(std::map<std::string,WatchInfo>::const_iterator it(mWatchDescriptors.begin());it!=mWatchDescriptors.end();++it)
+        if(it->second.generation != mGeneration)
+            to_remove.insert(it->first) ;
+
+    for(std::set<std::string>::const_iterator it(to_remove.begin());it!=to_remove.end();++it)
+        removeWatch(*it) ;
+}
+
+bool DirectoryWatcher::watch(const std::string& path)
+{
+    if(mFd < 0)
+        return false ;
+
+    std::map<std::string,WatchInfo>::iterator it = mWatchDescriptors.find(path) ;
+
+    if(it != mWatchDescriptors.end())
+    {
+        it->second.generation = mGeneration ;
+        return true ;
+    }
+
+#ifdef __linux__
+    int wd = inotify_add_watch(mFd,path.c_str(),WATCH_EVENT_MASK) ;
+
+    if(wd < 0)
+    {
+        if(errno == ENOSPC && mComplete)
+            std::cerr << "(WW) Maximum number of inotify watches reached (" << mWatchDescriptors.size() << "). Increase fs.inotify.max_user_watches to watch all shared directories." << std::endl;
+
+        mComplete = false ;
+        return false ;
+    }
+
+    // the same directory may be reached through different paths (e.g. symbolic links), which gives the same descriptor.
+    // Its events are only reported for the first path, so changes seen through this one would be missed.
+
+    std::map<int,std::string>::const_iterator it2 = mWatchedPaths.find(wd) ;
+
+    if(it2 != mWatchedPaths.end() && it2->second != path)
+    {
+        mComplete = false ;
+        return false ;
+    }
+
+    WatchInfo& info(mWatchDescriptors[path]) ;
+    info.wd = wd ;
+    info.generation = mGeneration ;
+
+    mWatchedPaths[wd] = path ;
+
+#ifdef DEBUG_DIRECTORY_WATCHER
+    std::cerr << "[directory watcher] watching " << path << " (wd=" << wd << ")" << std::endl;
+#endif
+    return true ;
+#else
+    return false ;
+#endif
+}
+
+void DirectoryWatcher::removeWatch(const std::string& path)
+{
+    std::map<std::string,WatchInfo>::iterator it = mWatchDescriptors.find(path) ;
+
+    if(it == mWatchDescriptors.end())
+        return ;
+
+#ifdef __linux__
+    inotify_rm_watch(mFd,it->second.wd) ;
+#endif
+    mWatchedPaths.erase(it->second.wd) ;
+    mWatchDescriptors.erase(it) ;
+}
+
+void DirectoryWatcher::unwatch(const std::string& path)
+{
+    removeWatch(path) ;
+
+    // sub-directories all start with path + "/", and are therefore contiguous in the map.
+
+    std::string prefix = RsDirUtil::makePath(path,"") ;
+    std::set<std::string> to_remove ;
+
+    for(std::map<std::string,WatchInfo>::const_iterator it(mWatchDescriptors.lower_bound(prefix));it!=mWatchDescriptors.end() && it->first.compare(0,prefix.size(),prefix) == 0;++it)
+        to_remove.insert(it->first) ;
+
+    for(std::set<std::string>::const_iterator it(to_remove.begin());it!=to_remove.end();++it)
+        removeWatch(*it) ;
+}
+
+void DirectoryWatcher::readEvents(std::set<std::string>& changed_dirs,bool& overflow)
+{
+    overflow = false ;
+
+#ifdef __linux__
+    if(mFd < 0)
+        return ;
+
+    std::vector<char> buf(EVENT_BUFFER_SIZE) ;
+    std::set<std::string> moved_dirs ;
+
+    for(;;)
+    {
+        ssize_t len = read(mFd,buf.data(),buf.size()) ;
+
+        if(len <= 0)
+            break ;		// EAGAIN: no more events
+
+        for(ssize_t pos = 0;pos < len;)
+        {
+            const struct inotify_event *ev = reinterpret_cast<const struct inotify_event*>(buf.data() + pos) ;
+            pos += sizeof(struct inotify_event) + ev->len ;
+
+            if(ev->mask & IN_Q_OVERFLOW)
+            {
+                overflow = true ;
+                continue ;
+            }
+
+            std::map<int,std::string>::const_iterator it = mWatchedPaths.find(ev->wd) ;
+
+            if(it == mWatchedPaths.end())
+                continue ;
+
+            const std::string path = it->second ;	// copy, since the watch may be removed below
+
+#ifdef DEBUG_DIRECTORY_WATCHER
+            std::cerr << "[directory watcher] event 0x" << std::hex << ev->mask << std::dec << " in " << path << ": " << (ev->len ? ev->name : "") << std::endl;
+#endif
+            if(ev->mask & IN_IGNORED)			// the directory was deleted or is on a file system that was unmounted
+            {
+                mWatchedPaths.erase(ev->wd) ;
+                mWatchDescriptors.erase(path) ;
+                continue ;
+            }
+
+            if(ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                moved_dirs.insert(path) ;
+                changed_dirs.insert(parentDirectory(path)) ;
+                continue ;
+            }
+
+            if((ev->mask & IN_MOVED_FROM) && (ev->mask & IN_ISDIR))	// the watches below now follow the moved directory
+                moved_dirs.insert(RsDirUtil::makePath(path,ev->name)) ;
+
+            changed_dirs.insert(path) ;
+        }
+    }
+
+    // Moved directories are still reported as changed, so that the caller finds out they do not exist anymore.
+
+    for(std::set<std::string>::const_iterator it(moved_dirs.begin());it!=moved_dirs.end();++it)
+    {
+        unwatch(*it) ;
+        changed_dirs.insert(*it) ;
+    }
+#else
+    (void)changed_dirs ;
+#endif
+}
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: directory_watcher.h                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <stdint.h>
+
+// This class tells which directories have changed on the disk, so that shared directories can be updated without
+// going through all of them. It uses inotify on Linux, and is not available on other systems.
+//
+// Directories are watched one by one (inotify is not recursive). Watches of directories that are deleted or moved
+// away are dropped. When the system cannot keep up with events, or when the maximum number of watches is reached,
+// the watcher says so and the caller should go back to sweeping directories.
+//
+// The class is not thread safe. It is only used by the directory updater thread.
+
+class DirectoryWatcher
+{
+public:
+    DirectoryWatcher() ;
+    ~DirectoryWatcher() ;
+
+    bool isAvailable() const ;		// false when the system has no file watching facility
+    bool isComplete() const ;		// false when some directories could not be watched since the last sweep
+
+    // Adds a watch for the given directory, or marks it as still in use during a sweep.
+
+    bool watch(const std::string& path) ;
+
+    // Removes the watch of the given directory and of all directories below it.
+
+    void unwatch(const std::string& path) ;
+
+    bool isWatched(const std::string& path) const { return mWatchDescriptors.find(path) != mWatchDescriptors.end() ; }
+    uint32_t size() const { return mWatchDescriptors.size() ; }
+
+    // A sweep is a full pass over shared directories, that calls watch() for all of them. Directories that were
+    // not seen during the sweep are not watched anymore.
+
+    void beginSweep() ;
+    void endSweep() ;
+
+    /*!
+     * \brief readEvents
+     * 			Reads the pending events, without blocking.
+     * \param changed_dirs	directories whose content or list of entries has changed.
+     * \param overflow		set to true when events were lost. A sweep is then needed to find all changes.
+     */
+    void readEvents(std::set<std::string>& changed_dirs,bool& overflow) ;
+
+private:
+    void removeWatch(const std::string& path) ;
+
+    int mFd ;
+    bool mComplete ;
+    uint32_t mGeneration ;
+
+    struct WatchInfo
+    {
+        int wd ;
+        uint32_t generation ;	// last sweep that saw the directory
+    };
+    std::map<std::string,WatchInfo> mWatchDescriptors ;	// sorted, so that sub-directories of a path follow it
+    std::map<int,std::string> mWatchedPaths ;
+};
@@ -0,0 +1,398 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: file_search_index.cc                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#include <ctype.h>
+#include <algorithm>
+
+#include "file_search_index.h"
+
+using namespace RsRegularExpression ;
+
+static const char     VOCABULARY_SEPARATOR = '\n' ;
+static const uint64_t MIN_STALE_FILES_BEFORE_REBUILD = 1000 ;
+
+static inline bool isTokenChar(unsigned char c)
+{
+	// non ASCII characters are kept in tokens, so that UTF8 sequences are never split.
+
+	return c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ;
+}
+
+static inline uint64_t makePosting(uint32_t storage_id,DirectoryStorage::EntryIndex indx)
+{
+	return (uint64_t(storage_id) << 32) | uint64_t(indx) ;
+}
+
+static void sortPostings(std::vector<uint64_t>& v)
+{
+	std::sort(v.begin(),v.end()) ;
+	v.erase(std::unique(v.begin(),v.end()),v.end()) ;
+}
+
+// Both lists must be sorted.
+
+static void intersectPostings(std::vector<uint64_t>& v,const std::vector<uint64_t>& w)
+{
+	std::vector<uint64_t> res ;
+	std::set_intersection(v.begin(),v.end(),w.begin(),w.end(),std::back_inserter(res)) ;
+	v.swap(res) ;
+}
+static void unitePostings(std::vector<uint64_t>& v,const std::vector<uint64_t>& w)
+{
+	std::vector<uint64_t> res ;
+	std::set_union(v.begin(),v.end(),w.begin(),w.end(),std::back_inserter(res)) ;
+	v.swap(res) ;
+}
+
+FileSearchIndex::FileSearchIndex()
+    : mIndexMtx("FileSearchIndex"), mNbFiles(0), mNbStaleFiles(0), mValid(true)
+{
+}
+
+void FileSearchIndex::tokenize(const std::string& s,std::vector<std::string>& tokens)
+{
+	tokens.clear() ;
+	std::string tok ;
+
+	for(uint32_t i=0;i<=s.size();++i)
+		if(i < s.size() && isTokenChar(s[i]))
+			tok.push_back(tolower(static_cast<unsigned char>(s[i]))) ;
+		else if(!tok.empty())
+		{
+			tokens.push_back(tok) ;
+			tok.clear() ;
+		}
+}
+
+void FileSearchIndex::addFile(uint32_t storage_id,DirectoryStorage::EntryIndex indx,const std::string& name,const RsFileHash& hash)
+{
+	std::vector<std::string> tokens ;
+	tokenize(name,tokens) ;
+
+	RS_STACK_MUTEX(mIndexMtx) ;
+
+	uint64_t posting = makePosting(storage_id,indx) ;
+
+	for(uint32_t i=0;i<tokens.size();++i)
+	{
+		auto it = mTokenIds.find(tokens[i]) ;
+		uint32_t token_id ;
+
+		if(it == mTokenIds.end())
+		{
+			token_id = mPostings.size() ;
+
+			mTokenIds[tokens[i]] = token_id ;
+			mTokenOffsets.push_back(mVocabulary.size()) ;
+			mVocabulary += tokens[i] ;
+			mVocabulary += VOCABULARY_SEPARATOR ;
+			mPostings.push_back(PostingList()) ;
+		}
+		else
+			token_id = it->second ;
+
+		// the same token may appear several times in a name
+
+		if(mPostings[token_id].empty() || mPostings[token_id].back() != posting)
+			mPostings[token_id].push_back(posting) ;
+	}
+
+	if(!hash.isNull())
+		mHashPostings[hash].push_back(posting) ;
+
+	++mNbFiles ;
+}
+
+void FileSearchIndex::addHash(uint32_t storage_id,DirectoryStorage::EntryIndex indx,const RsFileHash& hash)
+{
+	if(hash.isNull())
+		return ;
+
+	RS_STACK_MUTEX(mIndexMtx) ;
+	mHashPostings[hash].push_back(makePosting(storage_id,indx)) ;
+}
+
+void FileSearchIndex::removeFile()
+{
+	RS_STACK_MUTEX(mIndexMtx) ;
+	++mNbStaleFiles ;
+}
+
+void FileSearchIndex::invalidate()
+{
+	RS_STACK_MUTEX(mIndexMtx) ;
+	mValid = false ;
+}
+
+void FileSearchIndex::clear()
+{
+	RS_STACK_MUTEX(mIndexMtx) ;
+
+	mVocabulary.clear() ;
+	mTokenOffsets.clear() ;
+	mTokenIds.clear() ;
+	mPostings.clear() ;
+	mHashPostings.clear() ;
+
+	mNbFiles = 0 ;
+	mNbStaleFiles = 0 ;
+	mValid = true ;
+}
+
+bool FileSearchIndex::needsRebuild() const
+{
+	RS_STACK_MUTEX(mIndexMtx) ;
+	return !mValid || (mNbStaleFiles > MIN_STALE_FILES_BEFORE_REBUILD && mNbStaleFiles > mNbFiles/2) ;
+}
+
+uint64_t FileSearchIndex::size() const
+{
+	RS_STACK_MUTEX(mIndexMtx) ;
+	return mNbFiles ;
+}
+
+bool FileSearchIndex::locked_termCandidates(const std::string& term,PostingList& res) const
+{
+	std::vector<std::string> pieces ;
+	tokenize(term,pieces) ;
+
+	if(pieces.empty())	// empty terms, or terms without letters/digits may match anything.
+		return false ;
+
+	for(uint32_t i=0;i<pieces.size();++i)
+	{
+		// Look for the piece in all tokens at once. Each match belongs to a single token, since pieces have no separator.
+
+		PostingList piece_res ;
+
+		for(size_t pos = mVocabulary.find(pieces[i]);pos != std::string::npos;)
+		{
+			uint32_t token_id = std::upper_bound(mTokenOffsets.begin(),mTokenOffsets.end(),(uint32_t)pos) - mTokenOffsets.begin() - 1 ;
+
+			piece_res.insert(piece_res.end(),mPostings[token_id].begin(),mPostings[token_id].end()) ;
+
+			if(token_id+1 >= mTokenOffsets.size())
+				break ;
+
+			pos = mVocabulary.find(pieces[i],mTokenOffsets[token_id+1]) ;
+		}
+		sortPostings(piece_res) ;
+
+		if(i == 0)
+			res.swap(piece_res) ;
+		else
+			intersectPostings(res,piece_res) ;
+
+		if(res.empty())
+			break ;
+	}
+	return true ;
+}
+
+void FileSearchIndex::locked_hashCandidates(const RsFileHash& hash,PostingList& res) const
+{
+	auto it = mHashPostings.find(hash) ;
+
+	if(it != mHashPostings.end())
+		res = it->second ;
+
+	sortPostings(res) ;
+}
+
+bool FileSearchIndex::locked_expCandidates(const LinearizedExpression& e,int& n_tok,int& n_ints,int& n_strings,PostingList& res) const
+{
+	// Follows the layout of LinearizedExpression::toExpr(). Sub-expressions must be entirely read,
+	// even when they cannot restrict the search.
+
+	LinearizedExpression::token tok = static_cast<LinearizedExpression::token>(e._tokens[n_tok++]) ;
+
+	switch(tok)
+	{
+	case LinearizedExpression::EXPR_DATE:
+	case LinearizedExpression::EXPR_POP:
+	case LinearizedExpression::EXPR_SIZE:
+	case LinearizedExpression::EXPR_SIZE_MB:
+		n_ints += 3 ;
+		return false ;
+
+	case LinearizedExpression::EXPR_NAME:
+	case LinearizedExpression::EXPR_EXT:		// the extension is one of the tokens of the name
+	case LinearizedExpression::EXPR_HASH:
+	case LinearizedExpression::EXPR_PATH:
+	{
+		StringOperator op = static_cast<StringOperator>(e._ints[n_ints++]) ;
+		++n_ints ;	// ignore case
+		int n = e._ints[n_ints++] ;
+
+		std::vector<std::string> terms(e._strings.begin()+n_strings,e._strings.begin()+n_strings+n) ;
+		n_strings += n ;
+
+		if(tok == LinearizedExpression::EXPR_PATH)
+			return false ;
+
+		if(tok == LinearizedExpression::EXPR_HASH)
+		{
+			// only exact hashes can be looked for
+
+			if(op == ContainsAllStrings)
+				return false ;
+
+			for(uint32_t i=0;i<terms.size();++i)
+			{
+				if(terms[i].length() != 2*RsFileHash::SIZE_IN_BYTES)
+					return false ;
+
+				RsFileHash hash(terms[i]) ;
+
+				if(hash.isNull())
+					return false ;
+
+				PostingList r ;
+				locked_hashCandidates(hash,r) ;
+				unitePostings(res,r) ;
+			}
+			return true ;
+		}
+
+		// ContainsAll needs all terms, so that any term that restricts the search is enough.
+		// The other operators need one of the terms, so that all terms must restrict the search.
+
+		bool bounded = false ;
+
+		for(uint32_t i=0;i<terms.size();++i)
+		{
+			PostingList r ;
+
+			if(!locked_termCandidates(terms[i],r))
+			{
+				if(op == ContainsAllStrings)
+					continue ;
+				return false ;
+			}
+
+			if(op == ContainsAllStrings && bounded)
+				intersectPostings(res,r) ;
+			else
+				unitePostings(res,r) ;
+
+			bounded = true ;
+		}
+		return op != ContainsAllStrings || bounded ;
+	}
+
+	case LinearizedExpression::EXPR_COMP:
+	{
+		LogicalOperator op = static_cast<LogicalOperator>(e._ints[n_ints++]) ;
+
+		PostingList r1,r2 ;
+		bool b1 = locked_expCandidates(e,n_tok,n_ints,n_strings,r1) ;
+		bool b2 = locked_expCandidates(e,n_tok,n_ints,n_strings,r2) ;
+
+		if(op == AndOp)
+		{
+			if(b1 && b2) { intersectPostings(r1,r2) ; res.swap(r1) ; }
+			else if(b1) res.swap(r1) ;
+			else if(b2) res.swap(r2) ;
+
+			return b1 || b2 ;
+		}
+
+		// OR and XOR: the result is true only if one of the two sides is.
+
+		if(!b1 || !b2)
+			return false ;
+
+		unitePostings(r1,r2) ;
+		res.swap(r1) ;
+		return true ;
+	}
+	default:
+		return false ;
+	}
+}
+
+static void postingsToEntries(const std::vector<uint64_t>& postings,std::vector<FileSearchIndex::Entry>& candidates)
+{
+	candidates.clear() ;
+	candidates.reserve(postings.size()) ;
+
+	for(uint32_t i=0;i<postings.size();++i)
+		candidates.push_back(FileSearchIndex::Entry(postings[i] >> 32,DirectoryStorage::EntryIndex(postings[i] & 0xffffffff))) ;
+}
+
+bool FileSearchIndex::searchTerms(const std::list<std::string>& terms,std::vector<Entry>& candidates) const
+{
+	RS_STACK_MUTEX(mIndexMtx) ;
+
+	if(!mValid)
+		return false ;
+
+	PostingList res ;
+
+	for(auto it(terms.begin());it!=terms.end();++it)
+	{
+		PostingList r ;
+
+		if(!locked_termCandidates(*it,r))
+			return false ;
+
+		unitePostings(res,r) ;
+	}
+	postingsToEntries(res,candidates) ;
+	return true ;
+}
+
+bool FileSearchIndex::searchBoolExp(Expression *exp,std::vector<Entry>& candidates) const
+{
+	if(!exp)
+		return false ;
+
+	LinearizedExpression e ;
+	exp->linearize(e) ;
+
+	RS_STACK_MUTEX(mIndexMtx) ;
+
+	if(!mValid || e._tokens.empty())
+		return false ;
+
+	int n_tok=0, n_ints=0, n_strings=0 ;
+	PostingList res ;
+
+	if(!locked_expCandidates(e,n_tok,n_ints,n_strings,res))
+		return false ;
+
+	postingsToEntries(res,candidates) ;
+	return true ;
+}
+
+bool FileSearchIndex::searchHash(const RsFileHash& hash,std::vector<Entry>& candidates) const
+{
+	RS_STACK_MUTEX(mIndexMtx) ;
+
+	if(!mValid)
+		return false ;
+
+	PostingList res ;
+	locked_hashCandidates(hash,res) ;
+
+	postingsToEntries(res,candidates) ;
+	return true ;
+}
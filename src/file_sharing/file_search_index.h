@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: file_search_index.h                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <map>
+#include <list>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "retroshare/rsexpr.h"
+#include "util/rsthreads.h"
+#include "directory_storage.h"
+
+// Inverted index of the file names and hashes of several directory storages, used to search file lists
+// without going through all files.
+//
+// File names are split into tokens at ASCII characters that are not letters or digits, and tokens are
+// lower-cased. A search term can only be found in a name if each of its own tokens is a sub-string of
+// some token of the name, so the index gives a list of candidate files that contains all matching files,
+// and possibly a few more. Searches must therefore check the candidates exactly, which also takes care of
+// entries that have been removed or modified since they were indexed: the index is never updated when
+// files are removed. Instead, it counts the stale entries and asks to be rebuilt when there are too many.
+//
+// Storages are identified by a number chosen by the caller. The class is thread safe.
+
+class FileSearchIndex
+{
+public:
+	typedef std::pair<uint32_t,DirectoryStorage::EntryIndex> Entry ;	// storage id, file index in that storage
+
+	FileSearchIndex() ;
+
+	void addFile(uint32_t storage_id,DirectoryStorage::EntryIndex indx,const std::string& name,const RsFileHash& hash) ;
+	void addHash(uint32_t storage_id,DirectoryStorage::EntryIndex indx,const RsFileHash& hash) ;
+
+	// Tells that an indexed file was removed, or has changed name.
+	void removeFile() ;
+
+	// Tells that the entries of the index cannot be trusted anymore (e.g. storage ids or entry indices changed).
+	void invalidate() ;
+
+	void clear() ;
+	bool needsRebuild() const ;
+
+	// The search methods return candidates sorted by storage id and index. They return false when the index
+	// cannot restrict the search (e.g. expressions that do not use the file name), or is not valid. The search
+	// should then go through all files.
+
+	bool searchTerms(const std::list<std::string>& terms,std::vector<Entry>& candidates) const ;	// logical OR between terms
+	bool searchBoolExp(RsRegularExpression::Expression *exp,std::vector<Entry>& candidates) const ;
+	bool searchHash(const RsFileHash& hash,std::vector<Entry>& candidates) const ;
+
+	uint64_t size() const ;	// number of indexed names
+
+	static void tokenize(const std::string& s,std::vector<std::string>& tokens) ;
+
+private:
+	typedef std::vector<uint64_t> PostingList ;
+
+	bool locked_termCandidates(const std::string& term,PostingList& res) const ;
+	bool locked_expCandidates(const RsRegularExpression::LinearizedExpression& e,int& n_tok,int& n_ints,int& n_strings,PostingList& res) const ;
+	void locked_hashCandidates(const RsFileHash& hash,PostingList& res) const ;
+
+	mutable RsMutex mIndexMtx ;
+
+	// All tokens, each one followed by a separator, so that sub-strings can be looked for in all tokens at once.
+
+	std::string mVocabulary ;
+	std::vector<uint32_t> mTokenOffsets ;	// start of each token in mVocabulary
+	std::unordered_map<std::string,uint32_t> mTokenIds ;
+	std::vector<PostingList> mPostings ;	// files whose name has each token
+
+	std::map<RsFileHash,PostingList> mHashPostings ;
+
+	uint64_t mNbFiles ;
+	uint64_t mNbStaleFiles ;
+	bool mValid ;
+};
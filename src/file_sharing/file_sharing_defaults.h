@@ -22,6 +22,7 @@
 #pragma once
 
 static const uint32_t DELAY_BETWEEN_DIRECTORY_UPDATES           =  600 ; // 10 minutes
+static const uint32_t DELAY_BETWEEN_WATCHED_DIRECTORY_UPDATES   = 6*3600 ; // 6 hours. Only a consistency check when all shared directories are watched for changes.
 static const uint32_t DELAY_BETWEEN_REMOTE_DIRECTORY_SYNC_REQ   =  120 ; // 2 minutes
 static const uint32_t DELAY_BETWEEN_LOCAL_DIRECTORIES_TS_UPDATE =   20 ; // 20 sec. But we only update for real if something has changed.
 static const uint32_t DELAY_BETWEEN_REMOTE_DIRECTORIES_SWEEP    =   60 ; // 60 sec.
@@ -41,6 +42,7 @@ static const std::string IGNORED_PREFIXES_SS                    = "IGNORED_PREFI
 static const std::string IGNORED_SUFFIXES_SS                    = "IGNORED_SUFFIXES"; 	 	             // ignore file suffixes
 static const std::string IGNORE_LIST_FLAGS_SS                   = "IGNORED_FLAGS"; 	 	 	             // ignore file flags
 static const std::string MAX_SHARE_DEPTH                        = "MAX_SHARE_DEPTH"; 	 	             // maximum depth of shared directories
+static const std::string HASHING_THREADS_COUNT_SS               = "HASHING_THREADS_COUNT"; 	             // number of files hashed in parallel
 
 static const std::string FILE_SHARING_DIR_NAME       = "file_sharing" ;			 // hard-coded directory name to store friend file lists, hash cache, etc.
 static const std::string HASH_CACHE_FILE_NAME        = "hash_cache.bin" ;		 // hard-coded directory name to store encrypted hash cache.
@@ -52,6 +54,11 @@ static const uint32_t MIN_TIME_AFTER_LAST_MODIFICATION             = 10 ;    //
 
 static const uint32_t MAX_DIR_SYNC_RESPONSE_DATA_SIZE              = 20000 ; // Maximum RsItem data size in bytes for serialised directory transmission
 static const uint32_t DEFAULT_HASH_STORAGE_DURATION_DAYS           = 30 ;    // remember deleted/inaccessible files for 30 days
+static const uint32_t DEFAULT_HASHING_THREADS_COUNT                = 1 ;     // one file hashed at a time. Best for spinning disks.
+static const uint32_t MAX_HASHING_THREADS_COUNT                    = 32 ;    // upper bound for the number of files hashed in parallel
+static const uint32_t HASH_CACHE_CHUNK_SIZE                        = 1024*1024 ; // size of the chunks hashed along with files. Same as ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE
+static const uint32_t COMPACT_FILE_LIST_CHUNK_SIZE                 = 64*1024 ;   // size of the separately encrypted chunks of friend file lists on disk
+static const uint32_t COMPACT_FILE_LIST_CACHED_CHUNKS              = 16 ;        // decrypted chunks kept in memory for each friend file list
 
 static const uint32_t NB_FRIEND_INDEX_BITS_32BITS                    = 10 ;			// Do not change this!
 static const uint32_t NB_ENTRY_INDEX_BITS_32BITS                     = 22 ;			// Do not change this!
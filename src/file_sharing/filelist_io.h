@@ -44,6 +44,7 @@ static const uint8_t FILE_LIST_IO_TAG_REMOTE_FILE_ENTRY         =  0x13 ;
 static const uint8_t FILE_LIST_IO_TAG_FILE_SHA1_HASH            =  0x20 ;
 static const uint8_t FILE_LIST_IO_TAG_FILE_NAME                 =  0x21 ;
 static const uint8_t FILE_LIST_IO_TAG_FILE_SIZE                 =  0x22 ;
+static const uint8_t FILE_LIST_IO_TAG_CHUNK_SHA1_HASHES         =  0x23 ;
 
 static const uint8_t FILE_LIST_IO_TAG_MODIF_TS                  =  0x30 ;
 static const uint8_t FILE_LIST_IO_TAG_RECURS_MODIF_TS           =  0x31 ;
@@ -102,6 +103,13 @@ public:
 	};
 
 
+    // Reads the size of the next field, if it has the given tag, without moving the offset. This allows to read optional fields.
+
+    static bool peekFieldSize(const unsigned char *buff,uint32_t buff_size,uint32_t offset,uint8_t check_section_tag,uint32_t& size)
+    {
+        return readSectionHeader(buff,buff_size,offset,check_section_tag,size) ;
+    }
+
 	static bool writeField(      unsigned char*&buff,uint32_t& buff_size,uint32_t& offset,uint8_t       section_tag,const unsigned char *  val,uint32_t  size) ;
     static bool readField (const unsigned char *buff,uint32_t  buff_size,uint32_t& offset,uint8_t check_section_tag,      unsigned char *& val,uint32_t& size) ;
 
@@ -19,6 +19,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
  *                                                                             *
  ******************************************************************************/
+#include <algorithm>
+
 #include "util/rsdir.h"
 #include "util/rsprint.h"
 #include "util/rstime.h"
@@ -46,16 +48,24 @@ HashStorage::HashStorage(const std::string& save_file_name)
     mMaxStorageDurationDays = DEFAULT_HASH_STORAGE_DURATION_DAYS ;
 	mHashingProcessPaused = false;
 	mHashedBytes = 0 ;
-	mHashingTime = 0 ;
+	mHashingWindowStart = 0 ;
+    mHashingThreadsCount = DEFAULT_HASHING_THREADS_COUNT ;
+    mFilesBeingHashed = 0 ;
+    mChanged = false ;
 
     {
         RS_STACK_MUTEX(mHashMtx) ;
 
-        if(!locked_load())
+        if(!mFilePath.empty() && !locked_load())
             try_load_import_old_hash_cache();
     }
 }
 
+HashStorage::~HashStorage()
+{
+    stopWorkers() ;
+}
+
 void HashStorage::togglePauseHashingProcess()
 {
     RS_STACK_MUTEX(mHashMtx) ;
@@ -103,11 +113,6 @@ static std::string friendlyUnit(uint64_t val)
 
 void HashStorage::threadTick()
 {
-    FileHashJob job;
-    RsFileHash hash;
-    uint64_t size = 0;
-
-
     {
         bool empty ;
         uint32_t st ;
@@ -145,8 +150,15 @@ void HashStorage::threadTick()
 
                 mInactivitySleepTime = MAX_INACTIVITY_SLEEP_TIME;
 
-                if(!mChanged)	// otherwise it might prevent from saving the hash cache
+                // Workers may still be hashing the last files of the queue. Hashing is only finished when they are done.
+                // The workers are not waited for: they stop by themselves when the main thread stops, so that a new
+                // file can restart the main thread right away.
+
+                if(!mChanged && mFilesToHash.empty() && mFilesBeingHashed == 0)	// otherwise it might prevent from saving the hash cache
                 {
+                    mHashingWindowStart = 0 ;
+                    mHashedBytes = 0 ;
+
                     stopHashThread();
                 }
 
@@ -156,113 +168,244 @@ void HashStorage::threadTick()
                 RS_STACK_MUTEX(mHashMtx) ;
                 mInactivitySleepTime = 2*st ;
             }
-
-            return ;
         }
-        mInactivitySleepTime = DEFAULT_INACTIVITY_SLEEP_TIME;
-
-		bool paused = false ;
-        {
-            RS_STACK_MUTEX(mHashMtx) ;
-			paused = mHashingProcessPaused ;
-		}
-
-		if(paused)	// we need to wait off mutex!!
-		{
-			rstime::rs_usleep(MAX_INACTIVITY_SLEEP_TIME) ;
-			std::cerr << "Hashing process currently paused." << std::endl;
-			return;
-		}
-		else
+        else
         {
-            RS_STACK_MUTEX(mHashMtx) ;
+            {
+                RS_STACK_MUTEX(mHashMtx) ;
 
-            job = mFilesToHash.begin()->second ;
-            mFilesToHash.erase(mFilesToHash.begin()) ;
+                mInactivitySleepTime = DEFAULT_INACTIVITY_SLEEP_TIME;
+                locked_startWorkers() ;
+            }
+
+            // The main thread also hashes files, so that the single threaded behavior is unchanged when no workers are used.
+
+            if(!hashNextFile(this) && hashingProcessPaused())	// we need to wait off mutex!!
+            {
+                rstime::rs_usleep(MAX_INACTIVITY_SLEEP_TIME) ;
+                std::cerr << "Hashing process currently paused." << std::endl;
+            }
         }
+    }
+}
+
+void HashStorage::HashingWorker::threadTick()
+{
+    if(mStorage->shouldStop())
+    {
+        askForStop() ;
+        return ;
+    }
+
+    if(!mStorage->hashNextFile(this))
+        rstime::rs_usleep(DEFAULT_INACTIVITY_SLEEP_TIME) ;
+}
+
+void HashStorage::locked_addHashedBytes(uint64_t bytes)
+{
+    // The speed is measured over wall clock time, so that it reflects the combined throughput of all hashing threads.
+
+    double now = rstime::RsScopeTimer::currentTime() ;
+    mHashedBytes += bytes ;
+
+    if(now > mHashingWindowStart + 3)
+    {
+        mCurrentHashingSpeed = (int)(mHashedBytes / (now - mHashingWindowStart)) / (1024*1024) ;
+        mHashingWindowStart = now ;
+        mHashedBytes = 0 ;
+    }
+}
+
+bool HashStorage::hashNextFile(RsThread *thread)
+{
+    FileHashJob job;
+    RsFileHash hash;
+    uint64_t size = 0;
+
+    {
+        RS_STACK_MUTEX(mHashMtx) ;
+
+        if(mFilesToHash.empty() || mHashingProcessPaused)
+            return false ;
+
+        job = mFilesToHash.begin()->second ;
+        mFilesToHash.erase(mFilesToHash.begin()) ;
+        ++mFilesBeingHashed ;
+
+        if(mHashingWindowStart == 0)
+            mHashingWindowStart = rstime::RsScopeTimer::currentTime() ;
+    }
+
+    if(!job.client->hash_confirm(job.client_param))
+    {
+        RS_STACK_MUTEX(mHashMtx) ;
+        --mFilesBeingHashed ;
+        return true ;
+    }
 
-        if(job.client->hash_confirm(job.client_param))
-        {
 #ifdef HASHSTORAGE_DEBUG
-            std::cerr << "Hashing file " << job.full_path << "..." ; std::cerr.flush();
+    std::cerr << "Hashing file " << job.full_path << "..." ; std::cerr.flush();
 #endif
 
-            std::string tmpout;
+    if(rsEvents)
+    {
+        RS_STACK_MUTEX(mHashMtx) ;
 
-#ifdef TO_REMOVE
-			if(mCurrentHashingSpeed > 0)
-				rs_sprintf(tmpout, "%lu/%lu (%s - %d%%, %d MB/s) : %s", (unsigned long int)mHashCounter+1, (unsigned long int)mTotalFilesToHash, friendlyUnit(mTotalHashedSize).c_str(), int(mTotalHashedSize/double(mTotalSizeToHash)*100.0), mCurrentHashingSpeed,job.full_path.c_str()) ;
-			else
-				rs_sprintf(tmpout, "%lu/%lu (%s - %d%%) : %s", (unsigned long int)mHashCounter+1, (unsigned long int)mTotalFilesToHash, friendlyUnit(mTotalHashedSize).c_str(), int(mTotalHashedSize/double(mTotalSizeToHash)*100.0), job.full_path.c_str()) ;
-#endif
+        auto ev = std::make_shared<RsSharedDirectoriesEvent>();
+        ev->mEventCode = RsSharedDirectoriesEventCode::HASHING_FILE;
+        ev->mHashingSpeed = mCurrentHashingSpeed;
+        ev->mHashCounter = mHashCounter;
+        ev->mTotalFilesToHash = mTotalFilesToHash;
+        ev->mTotalHashedSize = mTotalHashedSize;
+        ev->mTotalSizeToHash = mTotalSizeToHash;
+        ev->mFilePath = job.full_path;
+        rsEvents->postEvent(ev);
+    }
 
-			{
-				auto ev = std::make_shared<RsSharedDirectoriesEvent>();
-				ev->mEventCode = RsSharedDirectoriesEventCode::HASHING_FILE;
-                ev->mHashingSpeed = mCurrentHashingSpeed;
-                ev->mHashCounter = mHashCounter;
-                ev->mTotalFilesToHash = mTotalFilesToHash;
-                ev->mTotalHashedSize = mTotalHashedSize;
-                ev->mTotalSizeToHash = mTotalSizeToHash;
-                ev->mFilePath = job.full_path;
-                rsEvents->postEvent(ev);
-			}
+    std::vector<Sha1CheckSum> chunk_hashes ;
+    // The speed is updated while hashing, so that it does not stay at its last value during large files.
 
-			double seconds_origin = rstime::RsScopeTimer::currentTime() ;
+    bool ok = RsDirUtil::getFileHash(job.full_path, hash, size, chunk_hashes, HASH_CACHE_CHUNK_SIZE, thread, [this](uint64_t bytes)
+    {
+        RS_STACK_MUTEX(mHashMtx) ;
+        locked_addHashedBytes(bytes) ;
+    }) ;
+
+    // the hash of a single chunk file is the file hash. No need to store it.
+
+    if(chunk_hashes.size() < 2)
+        chunk_hashes.clear() ;
 
-			if(RsDirUtil::getFileHash(job.full_path, hash, size, this))
-			{
-				// store the result
+    {
+        RS_STACK_MUTEX(mHashMtx) ;
+
+        if(ok)
+        {
+            // store the result
 
 #ifdef HASHSTORAGE_DEBUG
-				std::cerr << "done."<< std::endl;
+            std::cerr << "done."<< std::endl;
 #endif
+            HashStorageInfo& info(mFiles[job.real_path]);
 
-				RS_STACK_MUTEX(mHashMtx) ;
-				HashStorageInfo& info(mFiles[job.real_path]);
+            info.filename = job.real_path ;
+            info.size = size ;
+            info.modf_stamp = job.ts ;
+            info.time_stamp = time(NULL);
+            info.hash = hash;
+            info.chunk_hashes.swap(chunk_hashes) ;
 
-				info.filename = job.real_path ;
-				info.size = size ;
-				info.modf_stamp = job.ts ;
-				info.time_stamp = time(NULL);
-				info.hash = hash;
+            mChanged = true ;
+            mTotalHashedSize += size ;
+        }
+        else
+            RS_ERR("Failure hashing file: ", job.full_path);
+
+        ++mHashCounter ;
+    }
+
+    // call the client
+    if(ok)
+        job.client->hash_callback(job.client_param, job.full_path, hash, size);
+
+    RS_STACK_MUTEX(mHashMtx) ;
+    --mFilesBeingHashed ;
+
+    return true ;
+}
+
+bool HashStorage::getChunkHashes(const std::string& full_path,uint32_t chunk_size,std::vector<Sha1CheckSum>& chunk_hashes)
+{
+    if(chunk_size != HASH_CACHE_CHUNK_SIZE)
+        return false ;
+
+    // check that the file is still the one that was hashed. This does not read the file.
+
+    std::string real_path = RsDirUtil::removeSymLinks(full_path) ;
+    uint64_t size = 0 ;
+
+    if(!RsDirUtil::checkFile(real_path,size))
+        return false ;
+
+    rstime_t mod_time = RsDirUtil::lastWriteTime(real_path) ;
+
+    RS_STACK_MUTEX(mHashMtx) ;
 
-				mChanged = true ;
-				mTotalHashedSize += size ;
-			}
-			else RS_ERR("Failure hashing file: ", job.full_path);
+    std::map<std::string,HashStorageInfo>::const_iterator it = mFiles.find(real_path) ;
 
-			mHashingTime += rstime::RsScopeTimer::currentTime() - seconds_origin ;
-			mHashedBytes += size ;
+    if(it == mFiles.end() || it->second.size != size || it->second.modf_stamp != (uint64_t)mod_time)
+        return false ;
+
+    uint64_t nb_chunks = (size + chunk_size - 1) / chunk_size ;
+
+    if(nb_chunks < 2)
+        chunk_hashes.assign(nb_chunks,it->second.hash) ;
+    else if(it->second.chunk_hashes.size() == nb_chunks)
+        chunk_hashes = it->second.chunk_hashes ;
+    else
+        return false ;		// hashed before chunk hashes were kept
+
+    return true ;
+}
 
-			if(mHashingTime > 3)
-			{
-				mCurrentHashingSpeed = (int)(mHashedBytes / mHashingTime ) / (1024*1024) ;
-				mHashingTime = 0 ;
-				mHashedBytes = 0 ;
-			}
+void HashStorage::locked_startWorkers()
+{
+    // remove workers that stopped by themselves (e.g. when the main thread was asked to stop)
 
-            ++mHashCounter ;
+    for(uint32_t i=0;i<mHashingWorkers.size();)
+        if(!mHashingWorkers[i]->isRunning())
+        {
+            delete mHashingWorkers[i] ;
+            mHashingWorkers[i] = mHashingWorkers.back() ;
+            mHashingWorkers.pop_back() ;
         }
-	}
+        else
+            ++i ;
 
-	// call the client
-	if(!hash.isNull())
-		job.client->hash_callback(job.client_param, job.full_path, hash, size);
+    while(mHashingWorkers.size()+1 < mHashingThreadsCount)
+    {
+        HashingWorker *w = new HashingWorker(this) ;
+        mHashingWorkers.push_back(w) ;
 
-#ifdef TO_REMOVE
-	/* Notify we completed hashing a file */
-    auto ev = std::make_shared<RsSharedDirectoriesEvent>();
-    ev->mEventCode = RsSharedDirectoriesEventCode::FILE_HASHING_COMPLETED;
-    ev->mFilePath = job.full_path;
-	ev->mHashingSpeed = mCurrentHashingSpeed;
-	ev->mFileHash = hash;
-    ev->mHashCounter = mHashCounter+1;
-    ev->mTotalFilesToHash = mTotalFilesToHash;
-    ev->mTotalHashedSize = mTotalHashedSize;
-    ev->mTotalSizeToHash = mTotalSizeToHash;
-    rsEvents->postEvent(ev);
-#endif
+        w->start("fs hash worker") ;
+    }
+
+    // extra workers are asked to stop, and are cleaned up at next call once stopped.
+
+    for(uint32_t i=mHashingThreadsCount>0 ? mHashingThreadsCount-1 : 0;i<mHashingWorkers.size();++i)
+        mHashingWorkers[i]->askForStop() ;
+}
+
+void HashStorage::stopWorkers()
+{
+    std::vector<HashingWorker*> workers ;
+
+    {
+        RS_STACK_MUTEX(mHashMtx) ;
+        workers.swap(mHashingWorkers) ;
+    }
+
+    for(uint32_t i=0;i<workers.size();++i)
+    {
+        workers[i]->fullstop() ;
+        delete workers[i] ;
+    }
+}
+
+void HashStorage::setHashingThreadsCount(uint32_t n)
+{
+    RS_STACK_MUTEX(mHashMtx) ;
+
+    mHashingThreadsCount = std::max(1u,std::min(n,MAX_HASHING_THREADS_COUNT)) ;
+
+    if(mRunning)
+        locked_startWorkers() ;
+}
+
+uint32_t HashStorage::hashingThreadsCount()
+{
+    RS_STACK_MUTEX(mHashMtx) ;
+    return mHashingThreadsCount ;
 }
 
 bool HashStorage::requestHash(const std::string& full_path,uint64_t size,rstime_t mod_time,RsFileHash& known_hash,HashStorageClient *c,uint32_t client_param)
@@ -447,6 +590,9 @@ bool HashStorage::locked_load()
 
 void HashStorage::locked_save()
 {
+    if(mFilePath.empty())
+        return ;
+
 #ifdef HASHSTORAGE_DEBUG
     std::cerr << "Saving Hash Cache to file " << mFilePath << "..." << std::endl ;
 #endif
@@ -479,6 +625,13 @@ bool HashStorage::readHashStorageInfo(const unsigned char *data,uint32_t total_s
 
     uint32_t section_size = FL_BASE_TMP_SECTION_SIZE;
     uint32_t section_offset = 0;
+    uint32_t entry_size = 0;
+
+    if(!FileListIO::peekFieldSize(data,total_size,offset,FILE_LIST_IO_TAG_HASH_STORAGE_ENTRY,entry_size))
+    {
+        free(section_data);
+        return false;
+    }
 
     // This way, the entire section is either read or skipped. That avoids the risk of being stuck somewhere in the middle
     // of a section because of some unknown field, etc.
@@ -495,6 +648,25 @@ bool HashStorage::readHashStorageInfo(const unsigned char *data,uint32_t total_s
     if(!FileListIO::readField(section_data,section_size,section_offset,FILE_LIST_IO_TAG_MODIF_TS      ,info.modf_stamp)) { free(section_data); return false ; }
     if(!FileListIO::readField(section_data,section_size,section_offset,FILE_LIST_IO_TAG_FILE_SHA1_HASH,info.hash      )) { free(section_data); return false ; }
 
+    // Chunk hashes are optional, since older versions did not write them. They are dropped if inconsistent with the file size.
+
+    uint32_t chunk_hashes_size = 0 ;
+    info.chunk_hashes.clear() ;
+
+    if(section_offset < entry_size && FileListIO::peekFieldSize(section_data,entry_size,section_offset,FILE_LIST_IO_TAG_CHUNK_SHA1_HASHES,chunk_hashes_size))
+    {
+        unsigned char *chunk_data = NULL ;
+        uint32_t chunk_data_size = 0 ;
+
+        if(!FileListIO::readField(section_data,entry_size,section_offset,FILE_LIST_IO_TAG_CHUNK_SHA1_HASHES,chunk_data,chunk_data_size)) { free(chunk_data); free(section_data); return false ; }
+
+        if(chunk_hashes_size == Sha1CheckSum::SIZE_IN_BYTES * ((info.size + HASH_CACHE_CHUNK_SIZE - 1) / HASH_CACHE_CHUNK_SIZE))
+            for(uint32_t i=0;i<chunk_hashes_size;i+=Sha1CheckSum::SIZE_IN_BYTES)
+                info.chunk_hashes.push_back(Sha1CheckSum(chunk_data + i)) ;
+
+        free(chunk_data) ;
+    }
+
     free(section_data);
     return true;
 }
@@ -515,6 +687,16 @@ bool HashStorage::writeHashStorageInfo(unsigned char *& data,uint32_t&  total_si
     if(!FileListIO::writeField(section_data,section_size,section_offset,FILE_LIST_IO_TAG_MODIF_TS      ,info.modf_stamp)) { free(section_data); return false ; }
     if(!FileListIO::writeField(section_data,section_size,section_offset,FILE_LIST_IO_TAG_FILE_SHA1_HASH,info.hash      )) { free(section_data); return false ; }
 
+    if(!info.chunk_hashes.empty())
+    {
+        std::vector<unsigned char> chunk_data(info.chunk_hashes.size() * Sha1CheckSum::SIZE_IN_BYTES) ;
+
+        for(uint32_t i=0;i<info.chunk_hashes.size();++i)
+            memcpy(&chunk_data[i * Sha1CheckSum::SIZE_IN_BYTES],info.chunk_hashes[i].toByteArray(),Sha1CheckSum::SIZE_IN_BYTES) ;
+
+        if(!FileListIO::writeField(section_data,section_size,section_offset,FILE_LIST_IO_TAG_CHUNK_SHA1_HASHES,chunk_data.data(),chunk_data.size())) { free(section_data); return false ; }
+    }
+
     // now write the whole string into a single section in the file
 
     if(!FileListIO::writeField(data,total_size,offset,FILE_LIST_IO_TAG_HASH_STORAGE_ENTRY,section_data,section_offset)) return false ;
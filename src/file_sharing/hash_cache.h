@@ -24,6 +24,7 @@
 #pragma once
 
 #include <map>
+#include <vector>
 #include "util/rsthreads.h"
 #include "retroshare/rsfiles.h"
 #include "util/rstime.h"
@@ -52,7 +53,9 @@ public:
 class HashStorage: public RsTickingThread
 {
 public:
+    // An empty save_file_name keeps the hash cache in memory only.
     explicit HashStorage(const std::string& save_file_name) ;
+    virtual ~HashStorage() ;
 
     /*!
      * \brief requestHash  Requests the hash for the given file, assuming size and mod_time are the same.
@@ -75,8 +78,22 @@ public:
         uint32_t time_stamp ;		// last time the hash was tested/requested
         uint32_t modf_stamp ;
         RsFileHash hash ;
+        std::vector<Sha1CheckSum> chunk_hashes ;	// hashes of the HASH_CACHE_CHUNK_SIZE chunks of the file. Empty for single chunk files, or when unknown.
     } ;
 
+    /*!
+     * \brief getChunkHashes
+     *         Gives the hashes of all chunks of the given file, as computed when hashing it, provided the file has not been
+     *         modified since. This avoids reading the file again when friends ask for chunk hashes.
+     *
+     * \param full_path    Full path to reach the file
+     * \param chunk_size   Size of chunks. Only HASH_CACHE_CHUNK_SIZE is supported.
+     * \param chunk_hashes Returned chunk hashes, in the order of chunks.
+     *
+     * \return true if the chunk hashes are known and up to date.
+     */
+    bool getChunkHashes(const std::string& full_path,uint32_t chunk_size,std::vector<Sha1CheckSum>& chunk_hashes) ;
+
     // interaction with GUI, called from p3FileLists
     void setRememberHashFilesDuration(uint32_t days) { mMaxStorageDurationDays = days ; }		// duration for which the hash is kept even if the file is not shared anymore
     uint32_t rememberHashFilesDuration() const { return mMaxStorageDurationDays ; }
@@ -85,10 +102,44 @@ public:
 	void togglePauseHashingProcess() ;
 	bool hashingProcessPaused();
 
+    // number of files hashed in parallel. Each hashing thread works on a different file. Default is 1, which is
+    // the best choice for spinning disks. Fast storage (SSD/NVMe arrays) benefits from more threads.
+    void setHashingThreadsCount(uint32_t n) ;
+    uint32_t hashingThreadsCount() ;
+
 	void threadTick() override; /// @see RsTickingThread
 
     friend std::ostream& operator<<(std::ostream& o,const HashStorageInfo& info) ;
 private:
+    /*!
+     * \brief The HashingWorker class
+     * 		Additional hashing thread. The main HashStorage thread also hashes files, so that
+     * 		N hashing threads means N-1 workers. A worker stops by itself when the main thread stops.
+     */
+    class HashingWorker: public RsTickingThread
+    {
+    public:
+        explicit HashingWorker(HashStorage *storage) : mStorage(storage) {}
+        void threadTick() override;
+    private:
+        HashStorage *mStorage ;
+    };
+
+    /*!
+     * \brief hashNextFile
+     * 		Takes the next job in the queue, hashes it and sends the result to the client. Called concurrently by the
+     * 		main thread and the workers.
+     * \param thread  thread that performs the hashing, used to interrupt it when stopping.
+     * \return false if there was nothing to hash (empty queue, or hashing process paused).
+     */
+    bool hashNextFile(RsThread *thread) ;
+
+    // accounts for bytes read and hashed by any hashing thread, and updates mCurrentHashingSpeed
+    void locked_addHashedBytes(uint64_t bytes) ;
+
+    void locked_startWorkers() ;
+    void stopWorkers() ;
+
     /*!
      * \brief clean
      * 		This function is responsible for removing old hashes, etc
@@ -128,6 +179,9 @@ private:
     // current work
 
     std::map<std::string,FileHashJob> mFilesToHash ;
+    std::vector<HashingWorker*> mHashingWorkers ;
+    uint32_t mHashingThreadsCount ;
+    uint32_t mFilesBeingHashed ;					// files taken from mFilesToHash by a hashing thread, and not finished yet
 
     // thread/mutex stuff
 
@@ -142,7 +196,7 @@ private:
 
 	// The following is used to estimate hashing speed.
 
-	double mHashingTime ;
+	double mHashingWindowStart ;	// beginning of the time window over which the speed is measured. 0 means not started.
 	uint64_t mHashedBytes ;
 	uint32_t mCurrentHashingSpeed ; // in MB/s
 };
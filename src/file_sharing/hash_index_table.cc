@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: hash_index_table.cc                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#include <string.h>
+#include <algorithm>
+
+#include "hash_index_table.h"
+
+static const uint32_t HASH_INDEX_TABLE_MIN_CAPACITY = 16 ;
+
+HashIndexTable::HashIndexTable() : mSize(0) {}
+
+uint32_t HashIndexTable::slotOf(const RsFileHash& hash) const
+{
+	uint32_t h ;
+	memcpy(&h,hash.toByteArray(),sizeof(h)) ;
+
+	return h & (mSlots.size()-1) ;
+}
+
+bool HashIndexTable::find(const RsFileHash& hash,DirectoryStorage::EntryIndex& indx) const
+{
+	if(mSize == 0)
+		return false ;
+
+	for(uint32_t n = slotOf(hash);mSlots[n].index != DirectoryStorage::NO_INDEX;n = (n+1) & (mSlots.size()-1))
+		if(mSlots[n].hash == hash)
+		{
+			indx = mSlots[n].index ;
+			return true ;
+		}
+
+	return false ;
+}
+
+void HashIndexTable::insert(const RsFileHash& hash,DirectoryStorage::EntryIndex indx)
+{
+	// keep the load factor below 3/4, so that probe sequences stay short
+
+	if(4*(uint64_t)(mSize+1) > 3*(uint64_t)mSlots.size())
+		resize(std::max(HASH_INDEX_TABLE_MIN_CAPACITY,2*(uint32_t)mSlots.size())) ;
+
+	uint32_t n = slotOf(hash) ;
+
+	for(;mSlots[n].index != DirectoryStorage::NO_INDEX;n = (n+1) & (mSlots.size()-1))
+		if(mSlots[n].hash == hash)
+		{
+			mSlots[n].index = indx ;
+			return ;
+		}
+
+	mSlots[n].hash = hash ;
+	mSlots[n].index = indx ;
+	++mSize ;
+}
+
+bool HashIndexTable::erase(const RsFileHash& hash)
+{
+	if(mSize == 0)
+		return false ;
+
+	const uint32_t mask = mSlots.size()-1 ;
+	uint32_t n = slotOf(hash) ;
+
+	while(mSlots[n].index != DirectoryStorage::NO_INDEX && mSlots[n].hash != hash)
+		n = (n+1) & mask ;
+
+	if(mSlots[n].index == DirectoryStorage::NO_INDEX)
+		return false ;
+
+	// Move back the following slots of the same probe sequence, when the hole is between their
+	// ideal slot and their current slot.
+
+	for(uint32_t m = (n+1) & mask;mSlots[m].index != DirectoryStorage::NO_INDEX;m = (m+1) & mask)
+	{
+		uint32_t ideal = slotOf(mSlots[m].hash) ;
+
+		if(((m - ideal) & mask) >= ((m - n) & mask))
+		{
+			mSlots[n] = mSlots[m] ;
+			n = m ;
+		}
+	}
+
+	mSlots[n].index = DirectoryStorage::NO_INDEX ;
+	--mSize ;
+
+	return true ;
+}
+
+void HashIndexTable::clear()
+{
+	std::vector<Slot>().swap(mSlots) ;
+	mSize = 0 ;
+}
+
+void HashIndexTable::resize(uint32_t new_capacity)
+{
+	std::vector<Slot> old_slots(new_capacity) ;
+	old_slots.swap(mSlots) ;
+
+	for(uint32_t i=0;i<mSlots.size();++i)
+		mSlots[i].index = DirectoryStorage::NO_INDEX ;
+
+	for(uint32_t i=0;i<old_slots.size();++i)
+		if(old_slots[i].index != DirectoryStorage::NO_INDEX)
+		{
+			uint32_t n = slotOf(old_slots[i].hash) ;
+
+			while(mSlots[n].index != DirectoryStorage::NO_INDEX)
+				n = (n+1) & (new_capacity-1) ;
+
+			mSlots[n] = old_slots[i] ;
+		}
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: hash_index_table.h                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "directory_storage.h"
+
+// Map from file/dir hashes to entry indices, that replaces std::map in the file hierarchy.
+//
+// Open addressing with linear probing, in a single array of (hash,index) slots. Hashes are SHA1 sums, so their
+// first bytes are used as is to find the slot. Free slots are marked with DirectoryStorage::NO_INDEX, which is
+// never a valid entry index, and removals shift the following slots back so that no tombstone is needed.
+//
+// Iteration order is the order of the slots, which has nothing to do with the order of the hashes.
+
+class HashIndexTable
+{
+public:
+	HashIndexTable() ;
+
+	bool find(const RsFileHash& hash,DirectoryStorage::EntryIndex& indx) const ;
+	void insert(const RsFileHash& hash,DirectoryStorage::EntryIndex indx) ;	// replaces the index of an existing hash
+	bool erase(const RsFileHash& hash) ;
+	void clear() ;
+
+	uint32_t size() const { return mSize ; }
+	uint64_t memoryUsage() const { return mSlots.capacity()*sizeof(Slot) ; }
+
+	struct Slot
+	{
+		RsFileHash hash ;
+		DirectoryStorage::EntryIndex index ;
+	};
+
+	class const_iterator
+	{
+	public:
+		const_iterator(const HashIndexTable *t,uint32_t n) : mTable(t),mN(n) { skipFree() ; }
+
+		const Slot& operator*()  const { return mTable->mSlots[mN] ; }
+		const Slot *operator->() const { return &mTable->mSlots[mN] ; }
+		const_iterator& operator++() { ++mN ; skipFree() ; return *this ; }
+		bool operator!=(const const_iterator& it) const { return mN != it.mN ; }
+
+	private:
+		void skipFree() { while(mN < mTable->mSlots.size() && mTable->mSlots[mN].index == DirectoryStorage::NO_INDEX) ++mN ; }
+
+		const HashIndexTable *mTable ;
+		uint32_t mN ;
+	};
+
+	const_iterator begin() const { return const_iterator(this,0) ; }
+	const_iterator end()   const { return const_iterator(this,mSlots.size()) ; }
+
+private:
+	uint32_t slotOf(const RsFileHash& hash) const ;
+	void resize(uint32_t new_capacity) ;
+
+	std::vector<Slot> mSlots ;		// size is a power of 2
+	uint32_t mSize ;
+};
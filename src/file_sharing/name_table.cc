@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: name_table.cc                               *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#include <iostream>
+#include <algorithm>
+
+#include "name_table.h"
+
+static const uint32_t NO_ID = 0xffffffff ;
+static const uint32_t NAME_TABLE_MIN_CAPACITY = 16 ;
+static const uint64_t NAME_TABLE_MIN_DEAD_BYTES = 64*1024 ;	// below this, holes in the arena are not worth a compaction
+
+NameTable::NameTable()
+{
+	clear() ;
+}
+
+void NameTable::clear()
+{
+	std::vector<char>().swap(mArena) ;
+	std::vector<uint32_t>().swap(mFreeIds) ;
+	std::vector<uint32_t>().swap(mIds) ;
+
+	NameSlot empty ;
+	empty.offset = 0 ;
+	empty.size = 0 ;
+	empty.refs = 1 ;
+	empty.hash = 0 ;
+
+	std::vector<NameSlot>(1,empty).swap(mNames) ;
+
+	mNbIds = 0 ;
+	mDeadBytes = 0 ;
+}
+
+uint32_t NameTable::hashName(const char *s,uint32_t size)
+{
+	// FNV-1a
+
+	uint32_t h = 2166136261u ;
+
+	for(uint32_t i=0;i<size;++i)
+	{
+		h ^= (unsigned char)s[i] ;
+		h *= 16777619u ;
+	}
+	return h ;
+}
+
+uint32_t NameTable::findSlot(const char *s,uint32_t size,uint32_t h) const
+{
+	const uint32_t mask = mIds.size()-1 ;
+	uint32_t n = h & mask ;
+
+	for(;mIds[n] != NO_ID;n = (n+1) & mask)
+	{
+		const NameSlot& slot(mNames[mIds[n]]) ;
+
+		if(slot.hash == h && slot.size == size && !memcmp(mArena.data()+slot.offset,s,size))
+			break ;
+	}
+	return n ;
+}
+
+uint32_t NameTable::intern(const std::string& name)
+{
+	if(name.empty())
+		return EMPTY_NAME ;
+
+	if(4*(uint64_t)(mNbIds+1) > 3*(uint64_t)mIds.size())
+		resizeIds(std::max(NAME_TABLE_MIN_CAPACITY,2*(uint32_t)mIds.size())) ;
+
+	uint32_t h = hashName(name.data(),name.size()) ;
+	uint32_t n = findSlot(name.data(),name.size(),h) ;
+
+	if(mIds[n] != NO_ID)
+	{
+		++mNames[mIds[n]].refs ;
+		return mIds[n] ;
+	}
+
+	uint32_t id ;
+
+	if(!mFreeIds.empty())
+	{
+		id = mFreeIds.back() ;
+		mFreeIds.pop_back() ;
+	}
+	else
+	{
+		id = mNames.size() ;
+		mNames.push_back(NameSlot()) ;
+	}
+
+	NameSlot& slot(mNames[id]) ;
+	slot.offset = mArena.size() ;
+	slot.size = name.size() ;
+	slot.refs = 1 ;
+	slot.hash = h ;
+
+	mArena.insert(mArena.end(),name.begin(),name.end()) ;
+
+	mIds[n] = id ;
+	++mNbIds ;
+
+	return id ;
+}
+
+void NameTable::release(uint32_t id)
+{
+	if(id == EMPTY_NAME)
+		return ;
+
+	if(id >= mNames.size() || mNames[id].refs == 0)
+	{
+		std::cerr << "(EE) NameTable: releasing unknown name id " << id << std::endl;
+		return ;
+	}
+
+	if(--mNames[id].refs > 0)
+		return ;
+
+	removeFromIds(id) ;
+
+	mDeadBytes += mNames[id].size ;
+	mFreeIds.push_back(id) ;
+
+	if(mDeadBytes > NAME_TABLE_MIN_DEAD_BYTES && 2*mDeadBytes > mArena.size())
+		compactArena() ;
+}
+
+void NameTable::removeFromIds(uint32_t id)
+{
+	const uint32_t mask = mIds.size()-1 ;
+	uint32_t n = mNames[id].hash & mask ;
+
+	while(mIds[n] != id)
+		n = (n+1) & mask ;
+
+	// backward shift of the following ids of the same probe sequence
+
+	for(uint32_t m = (n+1) & mask;mIds[m] != NO_ID;m = (m+1) & mask)
+	{
+		uint32_t ideal = mNames[mIds[m]].hash & mask ;
+
+		if(((m - ideal) & mask) >= ((m - n) & mask))
+		{
+			mIds[n] = mIds[m] ;
+			n = m ;
+		}
+	}
+	mIds[n] = NO_ID ;
+	--mNbIds ;
+}
+
+void NameTable::resizeIds(uint32_t new_capacity)
+{
+	std::vector<uint32_t>(new_capacity,NO_ID).swap(mIds) ;
+
+	for(uint32_t id=1;id<mNames.size();++id)
+		if(mNames[id].refs > 0)
+		{
+			uint32_t n = mNames[id].hash & (new_capacity-1) ;
+
+			while(mIds[n] != NO_ID)
+				n = (n+1) & (new_capacity-1) ;
+
+			mIds[n] = id ;
+		}
+}
+
+void NameTable::compactArena()
+{
+	std::vector<char> arena ;
+	arena.reserve(mArena.size() - mDeadBytes) ;
+
+	for(uint32_t id=1;id<mNames.size();++id)
+		if(mNames[id].refs > 0)
+		{
+			uint32_t offset = arena.size() ;
+			arena.insert(arena.end(),mArena.begin()+mNames[id].offset,mArena.begin()+mNames[id].offset+mNames[id].size) ;
+			mNames[id].offset = offset ;
+		}
+		else
+		{
+			mNames[id].offset = 0 ;
+			mNames[id].size = 0 ;
+		}
+
+	mArena.swap(arena) ;
+	mDeadBytes = 0 ;
+}
+
+uint64_t NameTable::memoryUsage() const
+{
+	return mArena.capacity() + mNames.capacity()*sizeof(NameSlot) + mFreeIds.capacity()*sizeof(uint32_t) + mIds.capacity()*sizeof(uint32_t) ;
+}
@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: name_table.h                                *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <string.h>
+
+// Deduplicated storage of the file and directory names of a file hierarchy.
+//
+// All names are stored one after the other in a single character array (the arena), and are referred to by a
+// 32 bits id. Interning a name that is already known returns the same id, which is counted so that the name can
+// be released when no entry uses it anymore. Released names leave holes in the arena, that are removed when they
+// take more space than the names still in use. Ids do not change when this happens.
+//
+// Id 0 is the empty string, which is always there and does not need to be released.
+
+class NameTable
+{
+public:
+	static constexpr uint32_t EMPTY_NAME = 0 ;
+
+	NameTable() ;
+
+	uint32_t intern(const std::string& name) ;
+	void release(uint32_t id) ;
+	void clear() ;
+
+	std::string get(uint32_t id) const { const NameSlot& s(mNames[id]) ; return std::string(mArena.data()+s.offset,s.size) ; }
+
+	const char *data(uint32_t id) const { return mArena.data()+mNames[id].offset ; }
+	uint32_t size(uint32_t id) const { return mNames[id].size ; }
+
+	bool equals(uint32_t id,const std::string& s) const { return s.size() == size(id) && !memcmp(s.data(),data(id),s.size()) ; }
+
+	uint32_t nbNames() const { return mNames.size() - mFreeIds.size() ; }
+	uint64_t memoryUsage() const ;
+
+private:
+	struct NameSlot
+	{
+		uint32_t offset ;
+		uint32_t size ;
+		uint32_t refs ;		// 0 for free slots
+		uint32_t hash ;
+	};
+
+	static uint32_t hashName(const char *s,uint32_t size) ;
+
+	uint32_t findSlot(const char *s,uint32_t size,uint32_t h) const ;	// slot of the given name in mIds, or of the free slot to put it in
+	void resizeIds(uint32_t new_capacity) ;
+	void removeFromIds(uint32_t id) ;
+	void compactArena() ;
+
+	std::vector<char> mArena ;
+	std::vector<NameSlot> mNames ;		// indexed by id
+	std::vector<uint32_t> mFreeIds ;
+
+	std::vector<uint32_t> mIds ;		// open addressing table of ids, by hash of the name. Size is a power of 2.
+	uint32_t mNbIds ;
+
+	uint64_t mDeadBytes ;				// bytes of the arena used by released names
+};
@@ -200,6 +200,11 @@ int p3FileDatabase::tick()
         cleanup();
         cleanupUploadStats(mUploadStatsRetentionDays);
         mLastCleanupTime = now ;
+
+        RS_STACK_MUTEX(mFLSMtx) ;
+
+        if(mRemoteSearchIndex.needsRebuild())
+            locked_rebuildRemoteSearchIndex() ;
     }
 
     static rstime_t last_print_time = 0;
@@ -436,6 +441,17 @@ cleanup = true;
         kv.key = MAX_SHARE_DEPTH;
         kv.value = s ;
 
+        rskv->tlvkvs.pairs.push_back(kv);
+    }
+	{
+        std::string s ;
+        rs_sprintf(s, "%d", hashingThreadsCount()) ;
+
+        RsTlvKeyValue kv;
+
+        kv.key = HASHING_THREADS_COUNT_SS;
+        kv.value = s ;
+
         rskv->tlvkvs.pairs.push_back(kv);
     }
 	{
@@ -630,6 +646,12 @@ bool p3FileDatabase::loadList(std::list<RsItem *>& load)
                 if(sscanf(kit->value.c_str(),"%d",&t) == 1)
                     max_share_depth = (uint32_t)t ;
 			}
+			else if(kit->key == HASHING_THREADS_COUNT_SS)
+			{
+                int t=0 ;
+                if(sscanf(kit->value.c_str(),"%d",&t) == 1)
+                    mHashCache->setHashingThreadsCount(t) ;
+			}
             else if(kit->key == UPLOAD_STATS_RETENTION_DAYS_SS)
             {
                 int t=0;
@@ -770,6 +792,10 @@ void p3FileDatabase::cleanup()
                 delete mRemoteDirectories[i];
                 mRemoteDirectories[i] = NULL ;
 
+                // the files of that friend are still in the search index, and the friend moved below changes index
+
+                mRemoteSearchIndex.invalidate() ;
+
                 // now, in order to avoid empty seats, just move the last one here, and update indexes
 
                 while(i < mRemoteDirectories.size() && mRemoteDirectories[i] == NULL)
@@ -830,6 +856,28 @@ void p3FileDatabase::cleanup()
     }
 }
 
+void p3FileDatabase::locked_rebuildRemoteSearchIndex()
+{
+#ifdef DEBUG_P3FILELISTS
+    P3FILELISTS_DEBUG() << "Rebuilding remote file search index (" << mRemoteSearchIndex.size() << " files)" << std::endl;
+#endif
+    mRemoteSearchIndex.clear() ;
+
+    for(uint32_t i=0;i<mRemoteDirectories.size();++i)
+        if(mRemoteDirectories[i] != NULL)
+            mRemoteDirectories[i]->setSearchIndex(&mRemoteSearchIndex,i+1) ;
+}
+
+void p3FileDatabase::locked_splitRemoteSearchCandidates(const std::vector<FileSearchIndex::Entry>& candidates,std::vector<std::vector<EntryIndex> >& dir_candidates) const
+{
+    dir_candidates.clear() ;
+    dir_candidates.resize(mRemoteDirectories.size()) ;
+
+    for(uint32_t i=0;i<candidates.size();++i)
+        if(candidates[i].first > 0 && candidates[i].first <= mRemoteDirectories.size())
+            dir_candidates[candidates[i].first-1].push_back(candidates[i].second) ;
+}
+
 std::string p3FileDatabase::makeRemoteFileName(const RsPeerId& pid) const
 {
     return mFileSharingDir + "/" + "dirlist_"+pid.toStdString()+".bin" ;
@@ -854,6 +902,7 @@ uint32_t p3FileDatabase::locked_getFriendIndex(const RsPeerId& pid)
         {
             found = mRemoteDirectories.size();
             mRemoteDirectories.push_back(new RemoteDirectoryStorage(pid,makeRemoteFileName(pid)));
+            mRemoteDirectories.back()->setSearchIndex(&mRemoteSearchIndex,found+1) ;
 
             mUpdateFlags |= P3FILELISTS_UPDATE_FLAG_REMOTE_DIRS_CHANGED ;
             mUpdateFlags |= P3FILELISTS_UPDATE_FLAG_REMOTE_MAP_CHANGED ;
@@ -886,6 +935,7 @@ uint32_t p3FileDatabase::locked_getFriendIndex(const RsPeerId& pid)
         {
             mRemoteDirectories.resize(it->second+1,NULL) ;
             mRemoteDirectories[it->second] = new RemoteDirectoryStorage(pid,makeRemoteFileName(pid));
+            mRemoteDirectories[it->second]->setSearchIndex(&mRemoteSearchIndex,it->second+1) ;
 
             mUpdateFlags |= P3FILELISTS_UPDATE_FLAG_REMOTE_DIRS_CHANGED ;
             mUpdateFlags |= P3FILELISTS_UPDATE_FLAG_REMOTE_MAP_CHANGED ;
@@ -1536,6 +1586,17 @@ int  p3FileDatabase::maxShareDepth() const
     RS_STACK_MUTEX(mFLSMtx) ;
     return mLocalDirWatcher->maxShareDepth() ;
 }
+void p3FileDatabase::setHashingThreadsCount(int n)
+{
+    RS_STACK_MUTEX(mFLSMtx) ;
+    mHashCache->setHashingThreadsCount(n) ;
+    IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_OFTEN);
+}
+int  p3FileDatabase::hashingThreadsCount() const
+{
+    RS_STACK_MUTEX(mFLSMtx) ;
+    return mHashCache->hashingThreadsCount() ;
+}
 void p3FileDatabase::setWatchEnabled(bool b)
 {
     RS_STACK_MUTEX(mFLSMtx) ;
@@ -1592,11 +1653,24 @@ int p3FileDatabase::SearchKeywords(
         {
             RS_STACK_MUTEX(mFLSMtx) ;
 
+            // When the index can narrow the search, only the candidate files of each friend are checked.
+
+            std::vector<FileSearchIndex::Entry> candidates ;
+            std::vector<std::vector<EntryIndex> > dir_candidates ;
+            bool use_index = mRemoteSearchIndex.searchTerms(keywords,candidates) ;
+
+            if(use_index)
+                locked_splitRemoteSearchCandidates(candidates,dir_candidates) ;
+
             for(uint32_t i=0;i<mRemoteDirectories.size();++i)
                 if(mRemoteDirectories[i] != NULL)
                 {
                     std::list<EntryIndex> local_results;
-                    mRemoteDirectories[i]->searchTerms(keywords,local_results) ;
+
+                    if(!use_index)
+                        mRemoteDirectories[i]->searchTerms(keywords,local_results) ;
+                    else if(!dir_candidates[i].empty())
+                        mRemoteDirectories[i]->searchTerms(keywords,dir_candidates[i],local_results) ;
 
                     for(std::list<EntryIndex>::iterator it(local_results.begin());it!=local_results.end();++it)
                     {
@@ -1650,11 +1724,22 @@ int p3FileDatabase::SearchBoolExp(RsRegularExpression::Expression *exp, std::lis
         {
             RS_STACK_MUTEX(mFLSMtx) ;
 
+            std::vector<FileSearchIndex::Entry> candidates ;
+            std::vector<std::vector<EntryIndex> > dir_candidates ;
+            bool use_index = mRemoteSearchIndex.searchBoolExp(exp,candidates) ;
+
+            if(use_index)
+                locked_splitRemoteSearchCandidates(candidates,dir_candidates) ;
+
             for(uint32_t i=0;i<mRemoteDirectories.size();++i)
                 if(mRemoteDirectories[i] != NULL)
                 {
                     std::list<EntryIndex> local_results;
-                    mRemoteDirectories[i]->searchBoolExp(exp,local_results) ;
+
+                    if(!use_index)
+                        mRemoteDirectories[i]->searchBoolExp(exp,local_results) ;
+                    else if(!dir_candidates[i].empty())
+                        mRemoteDirectories[i]->searchBoolExp(exp,dir_candidates[i],local_results) ;
 
                     for(std::list<EntryIndex>::iterator it(local_results.begin());it!=local_results.end();++it)
                     {
@@ -1680,6 +1765,13 @@ int p3FileDatabase::SearchBoolExp(RsRegularExpression::Expression *exp, std::lis
 
 }
 
+bool p3FileDatabase::getChunkHashes(const std::string& path, uint32_t chunk_size, std::vector<Sha1CheckSum>& chunk_hashes) const
+{
+    // the hash cache has its own mutex
+
+    return mHashCache->getChunkHashes(path,chunk_size,chunk_hashes) ;
+}
+
 bool p3FileDatabase::search(
         const RsFileHash &hash, FileSearchFlags hintflags, FileInfo &info) const
 {
@@ -1712,9 +1804,18 @@ bool p3FileDatabase::search(
     {
         EntryIndex indx;
 		bool found = false ;
-		
+
+		// only ask the friends that the index knows to have the hash
+
+		std::vector<FileSearchIndex::Entry> candidates ;
+		std::vector<std::vector<EntryIndex> > dir_candidates ;
+		bool use_index = mRemoteSearchIndex.searchHash(hash,candidates) ;
+
+		if(use_index)
+			locked_splitRemoteSearchCandidates(candidates,dir_candidates) ;
+
 		for(uint32_t i=0;i<mRemoteDirectories.size();++i)
-			if(mRemoteDirectories[i] != NULL && mRemoteDirectories[i]->searchHash(hash,indx))
+			if(mRemoteDirectories[i] != NULL && (!use_index || !dir_candidates[i].empty()) && mRemoteDirectories[i]->searchHash(hash,indx))
 			{
 				TransferInfo ti ;
 				ti.peerId = mRemoteDirectories[i]->peerId();
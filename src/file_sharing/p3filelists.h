@@ -67,6 +67,7 @@
 #include "util/rstime.h"
 #include "file_sharing/hash_cache.h"
 #include "file_sharing/directory_storage.h"
+#include "file_sharing/file_search_index.h"
 
 #include "pqi/p3cfgmgr.h"
 #include "pqi/p3linkmgr.h"
@@ -123,6 +124,7 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
 
         // ftSearch
         virtual bool search(const RsFileHash &hash, FileSearchFlags hintflags, FileInfo &info) const;
+        virtual bool getChunkHashes(const std::string& path, uint32_t chunk_size, std::vector<Sha1CheckSum>& chunk_hashes) const;
         virtual int  SearchKeywords(const std::list<std::string>& keywords, std::list<DirDetails>& results,FileSearchFlags flags,const RsPeerId& peer_id) ;
         virtual int  SearchBoolExp(RsRegularExpression::Expression *exp, std::list<DirDetails>& results,FileSearchFlags flags,const RsPeerId& peer_id) const ;
 
@@ -162,6 +164,9 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
 		void setMaxShareDepth(int i) ;
 		int  maxShareDepth() const ;
 
+		void setHashingThreadsCount(int n) ;
+		int  hashingThreadsCount() const ;
+
 		bool banFile(const RsFileHash& real_file_hash, const std::string& filename, uint64_t file_size) ;
 		bool unbanFile(const RsFileHash& real_file_hash);
         bool isFileBanned(const RsFileHash& hash) ;
@@ -253,6 +258,14 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
         //     RemoteDirectories[ getFriendIndex(pid) - 1] = RemoteDirectoryStorage(pid)
 
         std::vector<RemoteDirectoryStorage *> mRemoteDirectories ;
+
+        // Index of the file names and hashes of all remote directories, each one indexed as (friend index + 1).
+        // Searches use it to only check the files that may match, instead of going through all friends' files.
+
+        FileSearchIndex mRemoteSearchIndex ;
+
+        void locked_rebuildRemoteSearchIndex() ;
+        void locked_splitRemoteSearchCandidates(const std::vector<FileSearchIndex::Entry>& candidates,std::vector<std::vector<EntryIndex> >& dir_candidates) const ;
         LocalDirectoryStorage *mLocalSharedDirs ;
         LocalDirectoryUpdater *mLocalDirWatcher ;
 		ftExtraList *mExtraFiles;
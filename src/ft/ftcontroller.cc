@@ -111,6 +111,7 @@ ftController::ftController(ftDataMultiplex *dm, p3ServiceControl *sc, uint32_t f
     mFtActive(false),
     mFtPendingDone(false),
     mDefaultChunkStrategy(FileChunksInfo::CHUNK_STRATEGY_PROGRESSIVE),
+    mDefaultRateControl(FileTransferRateControl::LEGACY),
     _max_active_downloads(5), // default queue size
     _max_uploads_per_friend(FT_FILECONTROL_MAX_UPLOAD_SLOTS_DEFAULT)
 {
@@ -1177,6 +1178,7 @@ bool ftController::FileRequest(
 	std::cerr << "Note: setting chunk strategy to " << mDefaultChunkStrategy <<std::endl ;
 #endif
 	fc->setChunkStrategy(mDefaultChunkStrategy) ;
+	tm->setRateControl(mDefaultRateControl) ;
 
 	/* add into maps */
 	ftFileControl *ftfc = new ftFileControl(fname, savepath, destination, size, hash, flags, fc, tm);
@@ -1675,6 +1677,7 @@ bool 	ftController::FileDetails(const RsFileHash &hash, FileInfo &info)
 
 			ti.tfRate = tfRate / 1024.0;
 			ti.peerId = *pit;
+			it->second->mTransfer->getPeerRateControlInfo(*pit, ti.rtt, ti.inflight);
 			info.peers.push_back(ti);
 			totalRate += tfRate / 1024.0;
 		}
@@ -1839,6 +1842,7 @@ const std::string download_dir_ss("DOWN_DIR");
 const std::string partial_dir_ss("PART_DIR");
 const std::string max_uploads_per_friend_ss("MAX_UPLOADS_PER_FRIEND");
 const std::string default_chunk_strategy_ss("DEFAULT_CHUNK_STRATEGY");
+const std::string default_rate_control_ss("DEFAULT_RATE_CONTROL");
 const std::string free_space_limit_ss("FREE_SPACE_LIMIT");
 const std::string default_encryption_policy_ss("DEFAULT_ENCRYPTION_POLICY");
 const std::string file_perm_direct_dl_ss("FILE_PERM_DIRECT_DL");
@@ -1887,6 +1891,8 @@ bool ftController::saveList(bool &cleanup, std::list<RsItem *>& saveData)
 																		break ;
 	}
 
+	configMap[default_rate_control_ss] = (mDefaultRateControl == FileTransferRateControl::LEGACY)?"LEGACY":"DELAY_BASED" ;
+
 	rs_sprintf(s,"%lu",_max_uploads_per_friend) ;
     configMap[max_uploads_per_friend_ss] = s ;
 
@@ -2179,6 +2185,16 @@ bool  ftController::loadConfigMap(std::map<std::string, std::string> &configMap)
 			std::cerr << "**** ERROR ***: Unknown value for default chunk strategy in keymap." << std::endl ;
 	}
 
+	if (configMap.end() != (mit = configMap.find(default_rate_control_ss)))
+	{
+		if(mit->second == "LEGACY")
+			setDefaultRateControl(FileTransferRateControl::LEGACY) ;
+		else if(mit->second == "DELAY_BASED")
+			setDefaultRateControl(FileTransferRateControl::DELAY_BASED) ;
+		else
+			std::cerr << "**** ERROR ***: Unknown value for default rate control in keymap." << std::endl ;
+	}
+
 	if (configMap.end() != (mit = configMap.find(free_space_limit_ss)))
 	{
 		uint32_t size ;
@@ -2287,3 +2303,22 @@ void ftController::setDefaultChunkStrategy(FileChunksInfo::ChunkStrategy S)
 	mDefaultChunkStrategy = S ;
     IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_OFTEN) ;
 }
+
+FileTransferRateControl ftController::defaultRateControl()
+{
+	RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
+	return mDefaultRateControl ;
+}
+void ftController::setDefaultRateControl(FileTransferRateControl s)
+{
+	RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
+
+	mDefaultRateControl = s ;
+
+	// also applies to the current downloads
+	for(std::map<RsFileHash,ftFileControl*>::iterator it(mDownloads.begin()); it != mDownloads.end(); ++it)
+		if(it->second->mTransfer != NULL)
+			it->second->mTransfer->setRateControl(s) ;
+
+    IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_OFTEN) ;
+}
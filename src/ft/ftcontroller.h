@@ -140,6 +140,8 @@ public:
         bool	getChunkStrategy(const RsFileHash& hash, FileChunksInfo::ChunkStrategy& s);
 		void 	setDefaultChunkStrategy(FileChunksInfo::ChunkStrategy s);
         FileChunksInfo::ChunkStrategy	defaultChunkStrategy();
+		void 	setDefaultRateControl(FileTransferRateControl s);
+		FileTransferRateControl	defaultRateControl();
 		void setFreeDiskSpaceLimit(uint32_t size_in_mb) ;
 		uint32_t freeDiskSpaceLimit() const ;
         //void 	setDefaultEncryptionPolicy(uint32_t s);
@@ -266,6 +268,7 @@ public:
         std::map<RsFileHash,RsFileTransfer*> mPendingChunkMaps ;
 
 		FileChunksInfo::ChunkStrategy mDefaultChunkStrategy ;
+		FileTransferRateControl mDefaultRateControl ;
 
 		uint32_t _max_active_downloads ;   // maximum number of simultaneous downloads
 		uint32_t _max_uploads_per_friend ; // maximum number of uploads per friend. 0 means unlimited.
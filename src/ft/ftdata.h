@@ -40,6 +40,9 @@
 
 class CompressedChunkMap ;
 
+// Max size of the file data sent in a single item. Larger requests are served by several items.
+static const uint32_t FT_MAX_DATA_SLICE_SIZE = 240 * 1024; /* 240K */
+
 class ftDataSend
 {
 	public:
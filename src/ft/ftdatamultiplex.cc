@@ -26,6 +26,8 @@
  * This multiplexes the data from PQInterface to the ftTransferModules.
  */
 
+#include <algorithm>
+
 #include "ft/ftdatamultiplex.h"
 #include "ft/fttransfermodule.h"
 #include "ft/ftfilecreator.h"
@@ -698,6 +700,31 @@ bool ftDataMultiplex::handleRecvChunkCrcRequest(const RsPeerId& peerId, const Rs
 		}
 	}
 
+	// The hash cache usually knows the hashes of all chunks, computed when hashing the file. This avoids reading the file.
+
+	std::vector<Sha1CheckSum> chunk_hashes ;
+
+	if(mSearch->getChunkHashes(filename,ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE,chunk_hashes) && chunk_number < chunk_hashes.size())
+	{
+		crc = chunk_hashes[chunk_number] ;
+
+		{
+			RsStackMutex stack(dataMtx); /******* LOCK MUTEX ******/
+
+			Sha1CacheEntry& sha1cache(_cached_sha1maps[hash]) ;
+			sha1cache._map = Sha1Map(filesize,ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE) ;
+
+			if(sha1cache._map.size() == chunk_hashes.size())
+				for(uint32_t i=0;i<chunk_hashes.size();++i)
+					sha1cache._map.set(i,chunk_hashes[i]) ;
+		}
+#ifdef MPLEX_DEBUG
+		std::cerr << "Sending CRC of chunk " << chunk_number<< " of file " << filename << " from hash cache, crc=" << crc.toStdString() << std::endl;
+#endif
+		mDataSend->sendSingleChunkCRC(peerId,hash,chunk_number,crc);
+		return true ;
+	}
+
 #ifdef MPLEX_DEBUG
 	std::cerr << "Computing Sha1 for chunk " << chunk_number<< " of file " << filename << ", hash=" << hash << ", size=" << filesize << std::endl;
 #endif
@@ -878,35 +905,45 @@ bool	ftDataMultiplex::locked_handleServerRequest(ftFileProvider *provider, const
 		std::cerr << "Warning: peer " << peerId << " is asking a large chunk (s=" << chunksize << ") for hash " << hash << ", filesize=" << size << ". This is unexpected." << std::endl ;
 		return false ;
 	}
-	void *data = rs_malloc(chunksize);
 
-	if(data == NULL)
-		return false ;
-	
 #ifdef MPLEX_DEBUG
 	std::cerr << "ftDataMultiplex::locked_handleServerRequest()";
 	std::cerr << "\t peer: " << peerId << " hash: " << hash;
 	std::cerr << " size: " << size;
 	std::cerr << std::endl;
 	std::cerr << "\t offset: " << offset;
-	std::cerr << " chunksize: " << chunksize << " data: " << data;
+	std::cerr << " chunksize: " << chunksize;
 	std::cerr << std::endl;
 #endif
 
-	if (provider->getFileData(peerId,offset, chunksize, data))
+	// The data is read slice by slice, each slice in its own buffer, that the outgoing item takes over
+	// without copying it again.
+
+	for(uint32_t done = 0; done < chunksize;)
 	{
-		/* send data out */
-		sendData(peerId, hash, size, offset, chunksize, data);
-		return true;
-	}
+		uint32_t slice_size = std::min(chunksize - done, FT_MAX_DATA_SLICE_SIZE);
+		void *data = rs_malloc(slice_size);
+
+		if(data == NULL)
+			return false ;
+
+		if(!provider->getFileData(peerId, offset + done, slice_size, data) || slice_size == 0)
+		{
 #ifdef MPLEX_DEBUG
-	std::cerr << "ftDataMultiplex::locked_handleServerRequest()";
-	std::cerr << " FAILED";
-	std::cerr << std::endl;
+			std::cerr << "ftDataMultiplex::locked_handleServerRequest()";
+			std::cerr << " FAILED";
+			std::cerr << std::endl;
 #endif
-	free(data);
+			free(data);
+			return done > 0;
+		}
 
-	return false;
+		/* send data out */
+		sendData(peerId, hash, size, offset + done, slice_size, data);
+		done += slice_size;
+	}
+
+	return true;
 }
 
 bool ftDataMultiplex::getClientChunkMap(const RsFileHash& upload_hash,const RsPeerId& peerId,CompressedChunkMap& cmap)
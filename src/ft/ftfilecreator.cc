@@ -229,6 +229,11 @@ bool ftFileCreator::addFileData(uint64_t offset, uint32_t chunk_size, void *data
 			return 0;
 		}
 
+		// ftFileProvider::getFileData() reads the file without going through the stdio buffer, so data
+		// must not stay there, since it can be sent to other peers as soon as the chunk is complete.
+
+		fflush(this->fd);
+
 #ifdef FILE_DEBUG
 		std::cerr << "ftFileCreator::addFileData() added Data...";
 		std::cerr << std::endl;
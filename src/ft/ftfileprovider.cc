@@ -22,6 +22,11 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <errno.h>
+
+#ifndef WINDOWS_SYS
+#	include <unistd.h>
+#endif
 
 #include "ftfileprovider.h"
 #include "ftchunkmap.h"
@@ -46,6 +51,31 @@
 
 static const rstime_t UPLOAD_CHUNK_MAPS_TIME = 20 ;	// time to ask for a new chunkmap from uploaders in seconds.
 
+#ifndef WINDOWS_SYS
+// Reads at the given offset without moving the file position, and without going through the stdio buffer, which
+// would cost one more copy of the data. Many peers reading different parts of the same file do not need to seek.
+//
+static bool readAt(FILE *f,uint64_t offset,uint32_t size,void *data)
+{
+	int desc = fileno(f) ;
+	uint32_t done = 0 ;
+
+	while(done < size)
+	{
+		ssize_t n = pread64(desc,(uint8_t*)data + done,size - done,offset + done) ;
+
+		if(n < 0 && errno == EINTR)
+			continue ;
+
+		if(n <= 0)
+			return false ;
+
+		done += n ;
+	}
+	return true ;
+}
+#endif
+
 ftFileProvider::ftFileProvider(const std::string& path, uint64_t size, const RsFileHash& hash)
 	: mSize(size), hash(hash), file_name(path), fd(NULL), ftcMutex("ftFileProvider")
 {
@@ -196,6 +226,16 @@ bool ftFileProvider::getFileData(const RsPeerId& peer_id,uint64_t offset, uint32
 
 	if(data_size > 0 && data != NULL)
 	{	
+#ifndef WINDOWS_SYS
+		if(!readAt(fd, base_loc, data_size, data))
+		{
+#ifdef DEBUG_FT_FILE_PROVIDER
+			std::cerr << "ftFileProvider::getFileData() Failed to read data. Data_size=" << data_size << ", base_loc=" << base_loc << ", errno=" << errno << " !" << std::endl;
+#endif
+			//free(data); No!! It's already freed upwards in ftDataMultiplex::locked_handleServerRequest()
+			return 0;
+		}
+#else
 		/*
 		 * seek for base_loc 
 		 */
@@ -223,6 +263,7 @@ bool ftFileProvider::getFileData(const RsPeerId& peer_id,uint64_t offset, uint32
 			//free(data); No!! It's already freed upwards in ftDataMultiplex::locked_handleServerRequest()
 			return 0;
 		}
+#endif
 
 		/* 
 		 * Update status of ftFileStatus to reflect last usage (for GUI display)
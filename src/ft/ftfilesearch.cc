@@ -175,3 +175,13 @@ bool	ftFileSearch::search(const RsFileHash &hash, FileSearchFlags hintflags, Fil
 	return false;
 }
 
+
+bool	ftFileSearch::getChunkHashes(const std::string& path, uint32_t chunk_size, std::vector<Sha1CheckSum>& chunk_hashes) const
+{
+	/* the same module may be registered for several flags, but it does not hurt to ask twice */
+	for(uint32_t i = 0; i < MAX_SEARCHS; i++)
+		if (mSearchs[i] && mSearchs[i]->getChunkHashes(path, chunk_size, chunk_hashes))
+			return true;
+
+	return false;
+}
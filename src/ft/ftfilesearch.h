@@ -43,6 +43,7 @@ class ftFileSearch: public ftSearch
 
 bool    addSearchMode(ftSearch *search, FileSearchFlags hintflags);
 virtual bool    search(const RsFileHash &hash, FileSearchFlags hintflags, FileInfo &info) const;
+virtual bool    getChunkHashes(const std::string& path, uint32_t chunk_size, std::vector<Sha1CheckSum>& chunk_hashes) const;
 
 	private:
 
@@ -0,0 +1,284 @@
+/*******************************************************************************
+ * libretroshare/src/ft: ftratecontrol.cc                                      *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+
+#include "ft/ftratecontrol.h"
+
+/******
+ * #define DEBUG_RATE_CONTROL 1
+ *****/
+
+const uint32_t FT_TM_MINIMUM_CHUNK         = 1024;              /* ie 1Kb / sec */
+const double   FT_RC_REQUEST_TIMEOUT       = 10.0 ;             /* requests not answered after this are lost */
+
+const double FT_TM_RATE_INCREASE_SLOWER    = 0.05 ;
+const double FT_TM_RATE_INCREASE_AVERAGE   = 0.3 ;
+const double FT_TM_RATE_INCREASE_FASTER    = 1.0 ;
+
+const double   FT_RC_TARGET_QUEUE_DELAY    = 0.25 ;             /* standing queue we accept at the source, in seconds */
+const double   FT_RC_INITIAL_WINDOW        = 64*1024 ;
+const double   FT_RC_MIN_WINDOW            = 16*1024 ;
+const uint32_t FT_RC_BASE_DELAY_HISTORY    = 10 ;               /* in minutes */
+
+const double FT_RC_WINDOW_GAIN_SLOWER      = 0.1 ;
+const double FT_RC_WINDOW_GAIN_AVERAGE     = 0.2 ;
+const double FT_RC_WINDOW_GAIN_FASTER      = 0.4 ;
+
+ftRateController *ftRateController::create(FileTransferRateControl type)
+{
+	switch(type)
+	{
+	default:
+	case FileTransferRateControl::LEGACY: return new ftLegacyRateController() ;
+	case FileTransferRateControl::DELAY_BASED: return new ftDelayRateController() ;
+	}
+}
+
+ftRateController::ftRateController()
+	: mInflight(0), mPeakInflight(0), mTickReceived(0), mSmoothedRtt(0)
+{
+}
+
+void ftRateController::requestSent(double now, uint64_t offset, uint32_t size)
+{
+	Request r ;
+	r.offset = offset ;
+	r.size = size ;
+	r.received = 0 ;
+	r.sentTS = now ;
+
+	mRequests.push_back(r) ;
+	mInflight += size ;
+	mPeakInflight = std::max(mPeakInflight,mInflight) ;
+}
+
+void ftRateController::dataReceived(double now, uint64_t offset, uint32_t size)
+{
+	mTickReceived += size ;
+
+	for(std::list<Request>::iterator it(mRequests.begin());it!=mRequests.end();++it)
+		if(offset >= it->offset && offset < it->offset + it->size)
+		{
+			if(it->received == 0)
+			{
+				double rtt = std::max(0.0, now - it->sentTS) ;
+
+				mSmoothedRtt = (mSmoothedRtt == 0) ? rtt : (0.875 * mSmoothedRtt + 0.125 * rtt) ;
+				onRttSample(now, rtt) ;
+			}
+
+			uint32_t n = std::min(size, it->size - it->received) ;
+
+			it->received += n ;
+			mInflight -= n ;
+
+			if(it->received >= it->size)
+				mRequests.erase(it) ;
+
+			return ;
+		}
+}
+
+uint32_t ftRateController::nextRequestSize(double now, double rate, double max_rate, DwlSpeed priority)
+{
+	uint64_t lost = 0 ;
+
+	for(std::list<Request>::iterator it(mRequests.begin());it!=mRequests.end();)
+		if(now > it->sentTS + FT_RC_REQUEST_TIMEOUT)
+		{
+			lost += it->size - it->received ;
+			mInflight -= it->size - it->received ;
+			it = mRequests.erase(it) ;
+		}
+		else
+			++it ;
+
+	if(lost > 0)
+		onRequestsLost(now, lost) ;
+
+	uint32_t next_req = computeNextRequestSize(now, rate, max_rate, priority) ;
+
+#ifdef DEBUG_RATE_CONTROL
+	std::cerr << "ftRateController: rate=" << rate << " rtt=" << mSmoothedRtt << " inflight=" << mInflight << " received=" << mTickReceived << " next_req=" << next_req << std::endl;
+#endif
+	mTickReceived = 0 ;
+	mPeakInflight = mInflight ;
+
+	return next_req ;
+}
+
+void ftRateController::takeStateFrom(const ftRateController& c)
+{
+	mRequests = c.mRequests ;
+	mInflight = c.mInflight ;
+	mPeakInflight = c.mPeakInflight ;
+	mTickReceived = c.mTickReceived ;
+	mSmoothedRtt = c.mSmoothedRtt ;
+}
+
+void ftRateController::reset()
+{
+	mRequests.clear() ;
+	mInflight = 0 ;
+	mPeakInflight = 0 ;
+}
+
+/*******************************************************************************
+ * Legacy controller
+ */
+
+void ftLegacyRateController::onRttSample(double /*now*/, double /*rtt*/)
+{
+	mHasRtt = true ;
+}
+
+uint32_t ftLegacyRateController::computeNextRequestSize(double /*now*/, double rate, double max_rate, DwlSpeed priority)
+{
+	/****************
+	 * NOTE: If we continually increase the request rate thus: ...
+	 * uint32_t next_req = info.actualRate * 1.25;
+	 *
+	 * then we will achieve max data rate, but we will fill up
+	 * peers out queue and/or network buffers.....
+	 */
+
+	double increase = 1.0 ;
+
+	if(mHasRtt)
+		switch(priority)
+		{
+		case SPEED_LOW  	: increase = FT_TM_RATE_INCREASE_SLOWER ; break ;
+		case SPEED_NORMAL	: increase = FT_TM_RATE_INCREASE_AVERAGE; break ;
+		case SPEED_HIGH  	: increase = FT_TM_RATE_INCREASE_FASTER ; break ;
+		}
+
+	/* request at more than current rate */
+	uint32_t next_req = rate * (1.0 + increase);
+
+	if (next_req > max_rate * 1.1)
+		next_req = max_rate * 1.1;
+
+	if (next_req > FT_TM_MAX_PEER_RATE)
+		next_req = FT_TM_MAX_PEER_RATE;
+
+	if (next_req < FT_TM_MINIMUM_CHUNK)
+		next_req = FT_TM_MINIMUM_CHUNK;
+
+	return next_req ;
+}
+
+/*******************************************************************************
+ * Delay based controller
+ */
+
+ftDelayRateController::ftDelayRateController()
+	: mWindow(FT_RC_INITIAL_WINDOW), mSlowStart(true), mTickMinRtt(-1), mBaseDelayMinute(0)
+{
+}
+
+double ftDelayRateController::baseDelay() const
+{
+	if(mBaseDelays.empty())
+		return 0 ;
+
+	return *std::min_element(mBaseDelays.begin(),mBaseDelays.end()) ;
+}
+
+void ftDelayRateController::onRttSample(double now, double rtt)
+{
+	mTickMinRtt = (mTickMinRtt < 0) ? rtt : std::min(mTickMinRtt, rtt) ;
+
+	// The base delay is kept per minute, so that it can follow a route change.
+
+	uint64_t minute = (uint64_t)(now / 60) ;
+
+	if(mBaseDelays.empty() || minute != mBaseDelayMinute)
+	{
+		mBaseDelays.push_back(rtt) ;
+		mBaseDelayMinute = minute ;
+
+		if(mBaseDelays.size() > FT_RC_BASE_DELAY_HISTORY)
+			mBaseDelays.erase(mBaseDelays.begin()) ;
+	}
+	else
+		mBaseDelays.back() = std::min(mBaseDelays.back(), rtt) ;
+}
+
+void ftDelayRateController::onRequestsLost(double /*now*/, uint64_t /*bytes*/)
+{
+	mWindow = std::max(FT_RC_MIN_WINDOW, mWindow / 2) ;
+	mSlowStart = false ;
+}
+
+uint32_t ftDelayRateController::computeNextRequestSize(double /*now*/, double /*rate*/, double max_rate, DwlSpeed priority)
+{
+	// Only adapt the window when it was used. Otherwise what limits the transfer is elsewhere (e.g. the
+	// source does not have the chunks we need) and the measured delays tell nothing about the window.
+
+	if(mTickMinRtt >= 0 && peakInflight() >= mWindow / 2)
+	{
+		double queue_delay = std::max(0.0, mTickMinRtt - baseDelay()) ;
+		double received = receivedSinceLastTick() ;
+
+		if(mSlowStart && queue_delay >= FT_RC_TARGET_QUEUE_DELAY)
+			mSlowStart = false ;
+
+		if(mSlowStart)
+			mWindow += received ;
+		else
+		{
+			double gain = FT_RC_WINDOW_GAIN_AVERAGE ;
+
+			switch(priority)
+			{
+			case SPEED_LOW  	: gain = FT_RC_WINDOW_GAIN_SLOWER ; break ;
+			case SPEED_NORMAL	: gain = FT_RC_WINDOW_GAIN_AVERAGE; break ;
+			case SPEED_HIGH  	: gain = FT_RC_WINDOW_GAIN_FASTER ; break ;
+			}
+
+			double off_target = std::max(-1.0, (FT_RC_TARGET_QUEUE_DELAY - queue_delay) / FT_RC_TARGET_QUEUE_DELAY) ;
+
+			// never less than half the window per tick, as LEDBAT does
+			mWindow = std::max(mWindow / 2, mWindow + gain * off_target * received) ;
+		}
+	}
+	mTickMinRtt = -1 ;
+
+	// The transfer module ticks every second, so that the window does not need to be larger than the
+	// data allowed in one second, plus the data still in the pipe.
+
+	mWindow = std::min(mWindow, std::min(max_rate, FT_TM_MAX_PEER_RATE) * (1.0 + baseDelay() + FT_RC_TARGET_QUEUE_DELAY)) ;
+	mWindow = std::max(mWindow, FT_RC_MIN_WINDOW) ;
+
+	double next_req = std::max(0.0, mWindow - inflight()) ;
+
+	next_req = std::min(next_req, std::min(max_rate * 1.1, FT_TM_MAX_PEER_RATE)) ;
+
+	// Avoid tiny requests, but always keep something in flight so that the RTT can be measured.
+
+	if(next_req < FT_TM_MINIMUM_CHUNK)
+		next_req = (inflight() == 0) ? FT_TM_MINIMUM_CHUNK : 0 ;
+
+	return (uint32_t)next_req ;
+}
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * libretroshare/src/ft: ftratecontrol.h                                       *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <list>
+#include <vector>
+
+#include "retroshare/rstypes.h"
+
+const double FT_TM_MAX_PEER_RATE = 100 * 1024 * 1024; /* 100MB/s */
+
+/*!
+ * \brief The ftRateController class
+ * 		Decides how much data a transfer module requests from one source at
+ * 		each tick. One controller is created per source. The base class keeps
+ * 		track of the outstanding requests, from which it measures the delay
+ * 		between a request and the first bytes received for it (the RTT, which
+ * 		grows when the peer's outgoing queues fill up) and the amount of data
+ * 		in flight.
+ *
+ * 		All times are in seconds.
+ */
+class ftRateController
+{
+public:
+	ftRateController();
+	virtual ~ftRateController() {}
+
+	static ftRateController *create(FileTransferRateControl type);
+
+	/// Called when a request for [offset, offset+size[ is sent to the source.
+	void requestSent(double now, uint64_t offset, uint32_t size);
+
+	/// Called for each slice of data received from the source.
+	void dataReceived(double now, uint64_t offset, uint32_t size);
+
+	/*!
+	 * \brief nextRequestSize
+	 * 			Called once per tick of the transfer module.
+	 * \param rate      measured receiving rate for this source, in bytes/s
+	 * \param max_rate  rate allowed for this source, in bytes/s
+	 * \return number of bytes to request now
+	 */
+	uint32_t nextRequestSize(double now, double rate, double max_rate, DwlSpeed priority);
+
+	/// Called when the source did not answer for a while. Outstanding requests are forgotten.
+	void reset();
+
+	/// Takes the outstanding requests and the RTT measured by another controller, when switching algorithm.
+	void takeStateFrom(const ftRateController& c);
+
+	double rtt() const { return mSmoothedRtt; }
+	uint64_t inflight() const { return mInflight; }
+
+protected:
+	/// A new RTT sample was measured. Samples include the time spent in the queues of the source.
+	virtual void onRttSample(double /*now*/, double /*rtt*/) {}
+
+	/// Requests were not answered in time. They do not count as in flight anymore.
+	virtual void onRequestsLost(double /*now*/, uint64_t /*bytes*/) {}
+
+	virtual uint32_t computeNextRequestSize(double now, double rate, double max_rate, DwlSpeed priority) = 0;
+
+	/// Bytes received since the last tick.
+	uint64_t receivedSinceLastTick() const { return mTickReceived; }
+
+	/// Highest amount of data in flight since the last tick.
+	uint64_t peakInflight() const { return mPeakInflight; }
+
+private:
+	struct Request
+	{
+		uint64_t offset;
+		uint32_t size;
+		uint32_t received;
+		double sentTS;
+	};
+
+	std::list<Request> mRequests;
+	uint64_t mInflight;
+	uint64_t mPeakInflight;
+	uint64_t mTickReceived;
+	double mSmoothedRtt;
+};
+
+/*!
+ * \brief The ftLegacyRateController class
+ * 		Historical algorithm: requests a fixed ratio more than the measured
+ * 		rate, the ratio depending on the download priority. It reaches the
+ * 		link capacity, but keeps filling the source's outgoing queues.
+ */
+class ftLegacyRateController: public ftRateController
+{
+public:
+	ftLegacyRateController() : mHasRtt(false) {}
+
+protected:
+	void onRttSample(double now, double rtt) override;
+	uint32_t computeNextRequestSize(double now, double rate, double max_rate, DwlSpeed priority) override;
+
+private:
+	bool mHasRtt;
+};
+
+/*!
+ * \brief The ftDelayRateController class
+ * 		Delay based algorithm in the spirit of LEDBAT. The base delay is the
+ * 		lowest RTT observed in the last minutes. The standing queue is the
+ * 		lowest RTT observed during the last tick minus the base delay. The
+ * 		window of data in flight grows while the standing queue is below the
+ * 		target, and shrinks proportionally when it is above. Starts with a
+ * 		slow start phase that doubles the window each tick, until the queue
+ * 		starts growing.
+ */
+class ftDelayRateController: public ftRateController
+{
+public:
+	ftDelayRateController();
+
+	double window() const { return mWindow; }
+	double baseDelay() const;
+
+protected:
+	void onRttSample(double now, double rtt) override;
+	void onRequestsLost(double now, uint64_t bytes) override;
+	uint32_t computeNextRequestSize(double now, double rate, double max_rate, DwlSpeed priority) override;
+
+private:
+	double mWindow;          // bytes allowed in flight
+	bool mSlowStart;
+	double mTickMinRtt;      // lowest RTT sample since last tick, negative if none
+
+	std::vector<double> mBaseDelays;	// lowest RTT of each of the last minutes
+	uint64_t mBaseDelayMinute;
+};
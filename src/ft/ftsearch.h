@@ -45,6 +45,12 @@ class ftSearch
 		}
         virtual bool	search(const RsFileHash &hash, FileSearchFlags hintflags, FileInfo &info) const = 0;
 
+		// Gives the hashes of all chunks of a local file, when they are known without reading the file.
+		virtual bool	getChunkHashes(const std::string& /*path*/, uint32_t /*chunk_size*/, std::vector<Sha1CheckSum>& /*chunk_hashes*/) const
+		{
+			return false;
+		}
+
 };
 
 #endif
@@ -427,6 +427,14 @@ FileChunksInfo::ChunkStrategy ftServer::defaultChunkStrategy()
 {
 	return mFtController->defaultChunkStrategy() ;
 }
+void ftServer::setDefaultRateControl(FileTransferRateControl s)
+{
+	mFtController->setDefaultRateControl(s) ;
+}
+FileTransferRateControl ftServer::defaultRateControl()
+{
+	return mFtController->defaultRateControl() ;
+}
 
 uint32_t ftServer::freeDiskSpaceLimit()const
 {
@@ -982,12 +990,14 @@ int  ftServer::watchPeriod() const                 { return mFileDatabase->watch
 bool ftServer::followSymLinks() const              { return mFileDatabase->followSymLinks() ; }
 bool ftServer::ignoreDuplicates()                  { return mFileDatabase->ignoreDuplicates() ; }
 int  ftServer::maxShareDepth() const               { return mFileDatabase->maxShareDepth() ; }
+int  ftServer::hashingThreadsCount() const         { return mFileDatabase->hashingThreadsCount() ; }
 
 void ftServer::setWatchEnabled(bool b)             { mFileDatabase->setWatchEnabled(b) ; }
 void ftServer::setWatchPeriod(int minutes)         { mFileDatabase->setWatchPeriod(minutes*60) ; }
 void ftServer::setFollowSymLinks(bool b)           { mFileDatabase->setFollowSymLinks(b) ; }
 void ftServer::setIgnoreDuplicates(bool ignore)    { mFileDatabase->setIgnoreDuplicates(ignore); }
 void ftServer::setMaxShareDepth(int depth)         { mFileDatabase->setMaxShareDepth(depth) ; }
+void ftServer::setHashingThreadsCount(int n)       { mFileDatabase->setHashingThreadsCount(n) ; }
 
 void ftServer::togglePauseHashingProcess()  { mFileDatabase->togglePauseHashingProcess() ; }
 bool ftServer::hashingProcessPaused() { return mFileDatabase->hashingProcessPaused() ; }
@@ -1253,17 +1263,16 @@ bool	ftServer::sendData(const RsPeerId& peerId, const RsFileHash& hash, uint64_t
 
 	while(tosend > 0)
 	{
-		//static const uint32_t	MAX_FT_CHUNK  = 32 * 1024; /* 32K */
-		//static const uint32_t	MAX_FT_CHUNK  = 16 * 1024; /* 16K */
-		static const uint32_t	MAX_FT_CHUNK  = 240 * 1024; /* 240K */
-
 		/* workout size */
-		chunk = MAX_FT_CHUNK;
+		chunk = FT_MAX_DATA_SLICE_SIZE;
 		if (chunk > tosend)
 		{
 			chunk = tosend;
 		}
 
+		// When the data fits in a single item (which is what ftDataMultiplex sends), the item takes the buffer over.
+		bool take_buffer = (offset == 0 && chunk == tosend);
+
 		/******** New Serialiser Type *******/
 
 		if(mTurtleRouter->isTurtlePeer(peerId))
@@ -1272,14 +1281,24 @@ bool	ftServer::sendData(const RsPeerId& peerId, const RsFileHash& hash, uint64_t
 
 			item->chunk_offset = offset+baseoffset ;
 			item->chunk_size = chunk;
-			item->chunk_data = rs_malloc(chunk) ;
 
-			if(item->chunk_data == NULL)
+			if(take_buffer)
 			{
-				delete item;
-				return false;
+				item->chunk_data = data ;
+				data = NULL ;
+			}
+			else
+			{
+				item->chunk_data = rs_malloc(chunk) ;
+
+				if(item->chunk_data == NULL)
+				{
+					delete item;
+					free(data);
+					return false;
+				}
+				memcpy(item->chunk_data,&(((uint8_t *) data)[offset]),chunk) ;
 			}
-			memcpy(item->chunk_data,&(((uint8_t *) data)[offset]),chunk) ;
 
 			sendTurtleItem(peerId,hash,item) ;
 		}
@@ -1301,7 +1320,14 @@ bool	ftServer::sendData(const RsPeerId& peerId, const RsFileHash& hash, uint64_t
 			rfd->fd.file_offset = baseoffset + offset;
 
 			/* file data */
-			rfd->fd.binData.setBinData( &(((uint8_t *) data)[offset]), chunk);
+			if(take_buffer)
+			{
+				rfd->fd.binData.bin_data = data;
+				rfd->fd.binData.bin_len = chunk;
+				data = NULL;
+			}
+			else
+				rfd->fd.binData.setBinData( &(((uint8_t *) data)[offset]), chunk);
 
 			sendItem(rfd);
 
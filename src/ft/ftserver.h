@@ -198,6 +198,8 @@ public:
     virtual bool getChunkStrategy(const RsFileHash& hash, FileChunksInfo::ChunkStrategy& s)  override;
     virtual void setDefaultChunkStrategy(FileChunksInfo::ChunkStrategy)  override;
     virtual FileChunksInfo::ChunkStrategy defaultChunkStrategy()  override;
+    virtual void setDefaultRateControl(FileTransferRateControl)  override;
+    virtual FileTransferRateControl defaultRateControl()  override;
     virtual uint32_t freeDiskSpaceLimit() const  override;
     virtual void setFreeDiskSpaceLimit(uint32_t size_in_mb)  override;
     //virtual void setDefaultEncryptionPolicy(uint32_t policy) ;	// RS_FILE_CTRL_ENCRYPTION_POLICY_STRICT/PERMISSIVE
@@ -344,6 +346,9 @@ public:
     virtual void setMaxShareDepth(int depth)  override;
     virtual int  maxShareDepth() const override;
 
+    virtual void setHashingThreadsCount(int n)  override;
+    virtual int  hashingThreadsCount() const override;
+
     virtual bool ignoreDuplicates()  override;
     virtual void setIgnoreDuplicates(bool ignore)  override;
 
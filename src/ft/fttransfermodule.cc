@@ -44,42 +44,27 @@
  *
  */
 
-const double   FT_TM_MAX_PEER_RATE 		       = 100 * 1024 * 1024; /* 100MB/s */
 const uint32_t FT_TM_MAX_RESETS  		       = 5;
-const uint32_t FT_TM_MINIMUM_CHUNK 		       = 1024;              /* ie 1Kb / sec */
 const uint32_t FT_TM_DEFAULT_TRANSFER_RATE     = 20*1024;           /* ie 20 Kb/sec */
 const uint32_t FT_TM_RESTART_DOWNLOAD 	       = 20;                /* 20 seconds */
 const uint32_t FT_TM_DOWNLOAD_TIMEOUT 	       = 10;                /* 10 seconds */
 
-const double FT_TM_RATE_INCREASE_SLOWER  = 0.05 ;
-const double FT_TM_RATE_INCREASE_AVERAGE = 0.3 ;
-const double FT_TM_RATE_INCREASE_FASTER  = 1.0 ;
-
 #define FT_TM_FLAG_DOWNLOADING 	0
 #define FT_TM_FLAG_CANCELED		1
 #define FT_TM_FLAG_COMPLETE 		2
 #define FT_TM_FLAG_CHECKING 		3
 #define FT_TM_FLAG_CHUNK_CRC 		4
 
-peerInfo::peerInfo(const RsPeerId& peerId_in)
+peerInfo::peerInfo(const RsPeerId& peerId_in,FileTransferRateControl rate_control)
     :peerId(peerId_in),state(PQIPEER_NOT_ONLINE),desiredRate(FT_TM_DEFAULT_TRANSFER_RATE),actualRate(FT_TM_DEFAULT_TRANSFER_RATE),
 		lastTS(0),
 		recvTS(0), lastTransfers(0), nResets(0),
-		rtt(0), rttActive(false), rttStart(0), rttOffset(0),
-		mRateIncrease(1)
+		rateControl(ftRateController::create(rate_control))
 	{
 	}
-//	peerInfo(const RsPeerId& peerId_in,uint32_t state_in,uint32_t maxRate_in):
-//		peerId(peerId_in),state(state_in),desiredRate(maxRate_in),actualRate(0),
-//		lastTS(0),
-//		recvTS(0), lastTransfers(0), nResets(0),
-//		rtt(0), rttActive(false), rttStart(0), rttOffset(0),
-//		mRateIncrease(1)
-//	{
-//		return;
-//	}
+
 ftTransferModule::ftTransferModule(ftFileCreator *fc, ftDataMultiplex *dm, ftController *c)
-	:mFileCreator(fc), mMultiplexor(dm), mFtController(c), tfMtx("ftTransferModule"), mFlag(FT_TM_FLAG_DOWNLOADING),mPriority(SPEED_NORMAL)
+	:mFileCreator(fc), mMultiplexor(dm), mFtController(c), tfMtx("ftTransferModule"), mFlag(FT_TM_FLAG_DOWNLOADING),mPriority(SPEED_NORMAL),mRateControl(FileTransferRateControl::LEGACY)
 {
   	RsStackMutex stack(tfMtx); /******* STACK LOCKED ******/
 
@@ -124,8 +109,7 @@ bool ftTransferModule::setFileSources(const std::list<RsPeerId>& peerIds)
 	std::cerr << " \t" << *it;
 #endif
 
-    peerInfo pInfo(*it);
-    mFileSources.insert(std::pair<RsPeerId,peerInfo>(*it,pInfo));
+    mFileSources.insert(std::make_pair(*it,peerInfo(*it,mRateControl)));
   }
 
 #ifdef FT_DEBUG
@@ -155,8 +139,7 @@ bool ftTransferModule::addFileSource(const RsPeerId& peerId)
 	if (mit == mFileSources.end())
 	{
 		/* add in new source */
-		peerInfo pInfo(peerId);
-		mFileSources.insert(std::pair<RsPeerId,peerInfo>(peerId,pInfo));
+		mFileSources.insert(std::make_pair(peerId,peerInfo(peerId,mRateControl)));
 		//mit = mFileSources.find(peerId);
 
 		mMultiplexor->sendChunkMapRequest(peerId, mHash,false) ;
@@ -269,6 +252,38 @@ bool ftTransferModule::getPeerState(const RsPeerId& peerId,uint32_t &state,uint3
   return true;
 }
 
+bool ftTransferModule::getPeerRateControlInfo(const RsPeerId& peerId,double& rtt,uint64_t& inflight)
+{
+	RsStackMutex stack(tfMtx); /******* STACK LOCKED ******/
+	std::map<RsPeerId,peerInfo>::iterator mit = mFileSources.find(peerId);
+
+	if (mit == mFileSources.end())
+		return false;
+
+	rtt = mit->second.rateControl->rtt();
+	inflight = mit->second.rateControl->inflight();
+	return true;
+}
+
+void ftTransferModule::setRateControl(FileTransferRateControl type)
+{
+	RsStackMutex stack(tfMtx); /******* STACK LOCKED ******/
+
+	if(type == mRateControl)
+		return ;
+
+	mRateControl = type ;
+
+	// The requests already sent to each source are still in flight, so the new controllers start from them.
+
+	for(std::map<RsPeerId,peerInfo>::iterator mit(mFileSources.begin()); mit != mFileSources.end(); ++mit)
+	{
+		ftRateController *c = ftRateController::create(type) ;
+		c->takeStateFrom(*mit->second.rateControl) ;
+		mit->second.rateControl.reset(c) ;
+	}
+}
+
 uint32_t ftTransferModule::getDataRate(const RsPeerId& peerId)
 {
   	RsStackMutex stack(tfMtx); /******* STACK LOCKED ******/
@@ -700,6 +715,7 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 {
 	/* how long has it been? */
 	rstime_t ts = time(NULL);
+	double now = rstime::RsScopeTimer::currentTime();
 
 	int ageRecv = ts - info.recvTS;
 	int ageReq = ts - info.lastTS;
@@ -726,6 +742,7 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 
 		info.state = PQIPEER_DOWNLOADING;
 		info.recvTS = ts; /* reset to activate */
+		info.rateControl->reset();
 		info.nResets = std::min(FT_TM_MAX_RESETS,info.nResets + 1);
 		ageRecv = 0;
 	}
@@ -748,75 +765,8 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 		info.lastTS = ts;
 	}
 
-	/****************
-	 * NOTE: If we continually increase the request rate thus: ...
-	 * uint32_t next_req = info.actualRate * 1.25;
-	 *
-	 * then we will achieve max data rate, but we will fill up 
-	 * peers out queue and/or network buffers.....
-	 *
-	 * we must therefore monitor the RTT to tell us if this is happening.
-	 */
-
-	/* emergency shutdown if we are stuck in x 1.25 mode
-	 * probably not needed
-	 */
-
-// csoler: I commented this out because that tends to make some sources 
-//  get stuck into minimal 128 B/s rate, when multiple sources are competiting into  the 
-//  same limited bandwidth. I don't think this emergency shutdown is necessary anyway.
-//
-//  	if ((info.rttActive) && (ts - info.rttStart > FT_TM_SLOW_RTT))
-//	{
-//		if (info.mRateIncrease > 0)
-//		{
-//#ifdef FT_DEBUG
-//			std::cerr << "!!! - Emergency shutdown because rttActive is true, and age is " << ts - info.rttStart << std::endl ;
-//#endif
-//			info.mRateIncrease = 0;
-//			info.rttActive = false ; // I've added this to avoid being stuck when rttActive is true
-//		}
-//	}
-
-	/* request at more than current rate */
-	uint32_t next_req = info.actualRate * (1.0 + info.mRateIncrease);
-#ifdef FT_DEBUG
-	std::cerr << "locked_tickPeerTransfer() actual rate (after): " << actualRate 
-				<< " info.desiredRate=" << info.desiredRate 
-				<< " info.actualRate=" << info.actualRate 
-				<< ", next_req=" << next_req ;
-
-	std::cerr << std::endl;
-#endif
-
-	if (next_req > info.desiredRate * 1.1)
-	{
-		next_req = info.desiredRate * 1.1;
-#ifdef FT_DEBUG
-		std::cerr << "locked_tickPeerTransfer() Reached MaxRate: next_req: " << next_req;
-		std::cerr << std::endl;
-#endif
-	}
-
-
-	if (next_req > FT_TM_MAX_PEER_RATE)
-	{
-		next_req = FT_TM_MAX_PEER_RATE;
-#ifdef FT_DEBUG
-		std::cerr << "locked_tickPeerTransfer() Reached AbsMaxRate: next_req: " << next_req;
-		std::cerr << std::endl;
-#endif
-	}
-
-
-	if (next_req < FT_TM_MINIMUM_CHUNK)
-	{
-		next_req = FT_TM_MINIMUM_CHUNK;
-#ifdef FT_DEBUG
-		std::cerr << "locked_tickPeerTransfer() small chunk: next_req: " << next_req;
-		std::cerr << std::endl;
-#endif
-	}
+	/* the rate controller decides how much more to ask */
+	uint32_t next_req = info.rateControl->nextRequestSize(now, info.actualRate, info.desiredRate, mPriority);
 
 #ifdef FT_DEBUG
 	std::cerr << "locked_tickPeerTransfer() desired  next_req: " << next_req;
@@ -836,14 +786,8 @@ bool ftTransferModule::locked_tickPeerTransfer(peerInfo &info)
 		{
 			info.state = PQIPEER_DOWNLOADING;
 			locked_requestData(info.peerId,req_offset,req_size);
+			info.rateControl->requestSent(now,req_offset,req_size);
 
-			/* start next rtt measurement */
-			if (!info.rttActive)
-			{
-				info.rttStart = ts;
-				info.rttActive = true;
-				info.rttOffset = req_offset + req_size;
-			}
 			next_req -= std::min(req_size,next_req) ;
 		}
 		else
@@ -864,7 +808,7 @@ bool ftTransferModule::locked_recvPeerData(peerInfo &info, uint64_t offset, uint
 #ifdef FT_DEBUG
 	std::cerr << "ftTransferModule::locked_recvPeerData()";
 	std::cerr << " peerId: " << info.peerId;
-	std::cerr << " rttOffset: " << info.rttOffset;
+	std::cerr << " inflight: " << info.rateControl->inflight();
 	std::cerr << " lastTransfers: " << info.lastTransfers;
 	std::cerr << " offset: " << offset;
 	std::cerr << " chunksize: " << chunk_size;
@@ -877,47 +821,9 @@ bool ftTransferModule::locked_recvPeerData(peerInfo &info, uint64_t offset, uint
   info.state = PQIPEER_DOWNLOADING;
   info.lastTransfers += chunk_size;
 
-   if ((info.rttActive) && (info.rttOffset == offset + chunk_size))
-   {
- 	  /* update tip */
- 	  int32_t rtt = time(NULL) - info.rttStart;
- 
- 	  /* 
- 		* FT_TM_FAST_RTT = 1 sec. mRateIncrease =  1.00
- 		* FT_TM_SLOW_RTT =20 sec. mRateIncrease =  0
- 		* 		   11 sec. mRateIncrease = -0.25
- 		* if it is slower than this allow fast data increase.
- 		* initial guess - linear with rtt.
- 		* change if this leads to wild oscillations 
- 		*
- 		*/
- 
-// 	  info.mRateIncrease = (FT_TM_SLOW_RTT - rtt) * 
-// 		  (FT_TM_MAX_INCREASE / (FT_TM_SLOW_RTT - FT_TM_FAST_RTT));
-// 
-// 	  if (info.mRateIncrease > FT_TM_MAX_INCREASE)
-// 		  info.mRateIncrease = FT_TM_MAX_INCREASE;
-// 
-// 	  if (info.mRateIncrease < FT_TM_MIN_INCREASE)
-// 		  info.mRateIncrease = FT_TM_MIN_INCREASE;
- 
-	  switch(mPriority)
-	  {
-		  case SPEED_LOW  	: info.mRateIncrease = FT_TM_RATE_INCREASE_SLOWER ; break ;
-		  case SPEED_NORMAL	: info.mRateIncrease = FT_TM_RATE_INCREASE_AVERAGE; break ;
-		  case SPEED_HIGH  	: info.mRateIncrease = FT_TM_RATE_INCREASE_FASTER ; break ;
-	  }
- 	  info.rtt = rtt;
- 	  info.rttActive = false;
-
-#ifdef FT_DEBUG
-	  std::cerr << "ftTransferModule::locked_recvPeerData()";
-	  std::cerr << "Updated Rate based on RTT: " << rtt;
-	  std::cerr << " Rate increase: " << 1.0+info.mRateIncrease;
-	  std::cerr << std::endl;
-#endif
+  /* rtt and data in flight */
+  info.rateControl->dataReceived(rstime::RsScopeTimer::currentTime(), offset, chunk_size);
 
-  }
   return true;
 }
 
@@ -35,11 +35,13 @@
 
 #include <map>
 #include <list>
+#include <memory>
 #include <string>
 
 #include "ft/ftfilecreator.h"
 #include "ft/ftdatamultiplex.h"
 #include "ft/ftcontroller.h"
+#include "ft/ftratecontrol.h"
 
 #include "util/rsthreads.h"
 
@@ -54,17 +56,8 @@ class HashThread ;
 class peerInfo
 {
 public:
-	explicit peerInfo(const RsPeerId& peerId_in);
-
-//	peerInfo(const RsPeerId& peerId_in,uint32_t state_in,uint32_t maxRate_in):
-//		peerId(peerId_in),state(state_in),desiredRate(maxRate_in),actualRate(0),
-//		lastTS(0),
-//		recvTS(0), lastTransfers(0), nResets(0),
-//		rtt(0), rttActive(false), rttStart(0), rttOffset(0),
-//		mRateIncrease(1)
-//	{
-//		return;
-//	}
+	peerInfo(const RsPeerId& peerId_in, FileTransferRateControl rate_control);
+
   	RsPeerId peerId;
   	uint32_t state;
   	double desiredRate;        /* speed at which the data should be requested */
@@ -75,11 +68,7 @@ public:
 	uint32_t lastTransfers;    /* data recvd in last second */
 	uint32_t nResets;          /* count to disable non-existant files */
 
-	uint32_t rtt;              /* last rtt */
-	bool     rttActive;        /* have we initialised an rtt measurement */
-	rstime_t	 rttStart;     /* ts of request */
-	uint64_t rttOffset;        /* end of request */
-	float    mRateIncrease;    /* current rate increase factor */
+	std::unique_ptr<ftRateController> rateControl; /* decides how much to request at each tick */
 };
 
 class ftFileStatus
@@ -121,6 +110,7 @@ public:
   bool setPeerState(const RsPeerId& peerId,uint32_t state,uint32_t maxRate);  //state = ONLINE/OFFLINE
   bool getFileSources(std::list<RsPeerId> &peerIds);
   bool getPeerState(const RsPeerId& peerId,uint32_t &state,uint32_t &tfRate);
+  bool getPeerRateControlInfo(const RsPeerId& peerId,double& rtt,uint64_t& inflight);
   uint32_t getDataRate(const RsPeerId& peerId);
   bool cancelTransfer();
   bool cancelFileTransferUpward();
@@ -148,6 +138,9 @@ public:
   DwlSpeed downloadPriority() const { return mPriority ; }
   void setDownloadPriority(DwlSpeed p) { mPriority =p ; }
 
+  // Changes the algorithm that decides how much data is requested from each source. Applies to all sources.
+  void setRateControl(FileTransferRateControl type) ;
+
   // read/reset the last time the transfer module was active (either wrote data, or was solicitaded by clients)
   rstime_t lastActvTimeStamp() ;
   void resetActvTimeStamp() ;
@@ -184,6 +177,7 @@ private:
 
   HashThread *_hash_thread ;
   DwlSpeed mPriority ;	// transfer speed priority
+  FileTransferRateControl mRateControl ;
 };
 
 #endif  //FT_TRANSFER_MODULE_HEADER
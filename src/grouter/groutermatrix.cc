@@ -20,15 +20,20 @@
  *                                                                             *
  *******************************************************************************/
 
+#include <math.h>
+
 #include "groutertypes.h"
 #include "groutermatrix.h"
 #include "grouteritems.h"
 
 //#define ROUTING_MATRIX_DEBUG
 
+static const uint32_t GROUTER_MATRIX_MIN_WIDTH = 8 ;	// initial number of friends per key in the matrix
+
 GRouterMatrix::GRouterMatrix()
 {
-	_proba_need_updating = true ;
+	_matrix_width = GROUTER_MATRIX_MIN_WIDTH ;
+	_reference_TS = time(NULL) ;
 }
 
 bool GRouterMatrix::addTrackingInfo(const RsGxsMessageId& mid,const RsPeerId& source_friend)
@@ -79,51 +84,94 @@ bool GRouterMatrix::addRoutingClue(const GRouterKeyId& key_id,const RsPeerId& so
 	//
 	uint32_t fid = getFriendId(source_friend) ;
 
-	// 2 - get the Key map, and add the routing clue.
+	// 2 - get the Key row, and add the routing clue to the friend's cell.
 	//
 	rstime_t now = time(NULL) ;
 
-	RoutingMatrixHitEntry rc ;
-	rc.weight = weight ;
-	rc.time_stamp = now ;
-	rc.friend_id = fid ;
-
-	std::list<RoutingMatrixHitEntry>& lst( _routing_clues[key_id] ) ;
+	RoutingCell& cell(_routing_weights[getKeyIndex(key_id)*_matrix_width + fid]) ;
 
 	// Prevent flooding. Happens in two scenarii:
 	//  1 - a user restarts RS very often => keys get republished for some reason
 	//  2 - a user intentionnaly floods a key 
     //
-    // Solution is to look for all recorded events, and not add any new event if an event came from the same friend
-    // too close in the past. Going through the list is not costly since it is bounded to RS_GROUTER_MATRIX_MAX_HIT_ENTRIES elemts.
+    // Solution is to not add any new event if an event came from the same friend too close in the past. In addition,
+    // the weight of a friend saturates (see addWeight()), so that frequent clues cannot take over the routes of a key.
 
-    for(std::list<RoutingMatrixHitEntry>::const_iterator mit(lst.begin());mit!=lst.end();++mit)
-        if((*mit).friend_id == fid && (*mit).time_stamp + RS_GROUTER_MATRIX_MIN_TIME_BETWEEN_HITS > now)
-        {
+    if(cell.last_hit_TS + RS_GROUTER_MATRIX_MIN_TIME_BETWEEN_HITS > now)
+    {
 #ifdef ROUTING_MATRIX_DEBUG
-            std::cerr << "GRouterMatrix::addRoutingClue(): too many clues for key " << key_id.toStdString() << " from friend " << source_friend << " in a small interval of " << now - lst.front().time_stamp << " seconds. Flooding?" << std::endl;
+        std::cerr << "GRouterMatrix::addRoutingClue(): too many clues for key " << key_id.toStdString() << " from friend " << source_friend << " in a small interval of " << now - cell.last_hit_TS << " seconds. Flooding?" << std::endl;
 #endif
-            return false ;
-        }
+        return false ;
+    }
 
-	lst.push_front(rc) ;								// create it if necessary
+	addWeight(cell,weight,now) ;
 
-	// Remove older elements
-	//
-	uint32_t sz = lst.size() ; // O(n)!
+	return true ;
+}
 
-	for(uint32_t i=RS_GROUTER_MATRIX_MAX_HIT_ENTRIES;i<sz;++i)
-	{
-		lst.pop_back() ;
-#ifdef ROUTING_MATRIX_DEBUG
-        std::cerr << "Poped one entry" << std::endl;
-#endif
-	}
+void GRouterMatrix::addWeight(RoutingCell& cell,float weight,rstime_t time_stamp)
+{
+	rstime_t now = time(NULL) ;
 
-	_proba_need_updating = true ; 				// always, since we added new clues.
+	if(time_stamp > now)
+		time_stamp = now ;
 
-	return true ;
+	float scale = decayFactor(now) ;
+	float current = cell.weight * scale ;
+	float added = weight * exp2f(-(float)(now - time_stamp) / RS_GROUTER_MATRIX_HALF_LIFE) ;	// the weight of the clue today
+
+	// A friend never weighs more than RS_GROUTER_MATRIX_MAX_HIT_ENTRIES recent clues of the same weight.
+
+	float updated = std::min(current + added, std::max(current, RS_GROUTER_MATRIX_MAX_HIT_ENTRIES*weight)) ;
+
+	if(scale > 0.0f)
+		cell.weight = updated / scale ;
+
+	cell.last_hit_TS = std::max((rstime_t)cell.last_hit_TS,time_stamp) ;
+}
+
+float GRouterMatrix::decayFactor(rstime_t now) const
+{
+	return exp2f(-(float)(now - _reference_TS) / RS_GROUTER_MATRIX_HALF_LIFE) ;
 }
+
+uint32_t GRouterMatrix::getKeyIndex(const GRouterKeyId& key_id)
+{
+	std::map<GRouterKeyId,uint32_t>::const_iterator it = _key_indices.find(key_id) ;
+
+	if(it != _key_indices.end())
+		return it->second ;
+
+	uint32_t new_index = _reverse_key_indices.size() ;
+
+	RoutingCell empty_cell ;
+	empty_cell.weight = 0.0f ;
+	empty_cell.last_hit_TS = 0 ;
+
+	_reverse_key_indices.push_back(key_id) ;
+	_key_indices[key_id] = new_index ;
+	_routing_weights.resize(_routing_weights.size() + _matrix_width,empty_cell) ;
+
+	return new_index ;
+}
+
+void GRouterMatrix::setMatrixWidth(uint32_t width)
+{
+	RoutingCell empty_cell ;
+	empty_cell.weight = 0.0f ;
+	empty_cell.last_hit_TS = 0 ;
+
+	std::vector<RoutingCell> weights(_reverse_key_indices.size()*width,empty_cell) ;
+
+	for(uint32_t k=0;k<_reverse_key_indices.size();++k)
+		for(uint32_t f=0;f<std::min(width,_matrix_width);++f)
+			weights[k*width + f] = _routing_weights[k*_matrix_width + f] ;
+
+	_routing_weights.swap(weights) ;
+	_matrix_width = width ;
+}
+
 uint32_t GRouterMatrix::getFriendId_const(const RsPeerId& source_friend) const
 {
 	std::map<RsPeerId,uint32_t>::const_iterator it = _friend_indices.find(source_friend) ;
@@ -145,6 +193,9 @@ uint32_t GRouterMatrix::getFriendId(const RsPeerId& source_friend)
 		_reverse_friend_indices.push_back(source_friend) ;
 		_friend_indices[source_friend] = new_id ;
 
+		if(new_id >= _matrix_width)
+			setMatrixWidth(2*_matrix_width) ;
+
 		return new_id ;
 	}
 	else
@@ -153,10 +204,7 @@ uint32_t GRouterMatrix::getFriendId(const RsPeerId& source_friend)
 
 void GRouterMatrix::getListOfKnownKeys(std::vector<GRouterKeyId>& key_ids) const
 {
-	key_ids.clear() ;
-
-	for(std::map<GRouterKeyId,std::vector<float> >::const_iterator it(_time_combined_hits.begin());it!=_time_combined_hits.end();++it)
-        key_ids.push_back(it->first) ;
+	key_ids = _reverse_key_indices ;
 }
 
 bool GRouterMatrix::getTrackingInfo(const RsGxsMessageId& mid, RsPeerId &source_friend)
@@ -173,27 +221,25 @@ bool GRouterMatrix::getTrackingInfo(const RsGxsMessageId& mid, RsPeerId &source_
 
 void GRouterMatrix::debugDump() const
 {
-	std::cerr << "    Proba needs up: " << _proba_need_updating << std::endl;
-	std::cerr << "    Known keys:     " << _time_combined_hits.size() << std::endl;
-	std::cerr << "    Routing events: " << std::endl;
+	std::cerr << "    Known keys:     " << _reverse_key_indices.size() << std::endl;
+	std::cerr << "    Matrix width:   " << _matrix_width << std::endl;
+	std::cerr << "    Routing values (last clue age, weight): " << std::endl;
 	rstime_t now = time(NULL) ;
+	float scale = decayFactor(now) ;
 
-	for(std::map<GRouterKeyId, std::list<RoutingMatrixHitEntry> >::const_iterator it(_routing_clues.begin());it!=_routing_clues.end();++it)
+	for(uint32_t k=0;k<_reverse_key_indices.size();++k)
 	{
-		std::cerr << "      " << it->first.toStdString() << " : " ;
-		for(std::list<RoutingMatrixHitEntry>::const_iterator it2(it->second.begin());it2!=it->second.end();++it2)
-			std::cerr << now - (*it2).time_stamp << " (" << (*it2).friend_id << "," << (*it2).weight << ") " ;
-
-		std::cerr << std::endl;
-	}
-	std::cerr << "    Routing values: " << std::endl;
+		std::cerr << "      " << _reverse_key_indices[k].toStdString() << "  :  " ;
 
-	for(std::map<GRouterKeyId, std::vector<float> >::const_iterator it(_time_combined_hits.begin());it!=_time_combined_hits.end();++it)
-	{
-		std::cerr << "      " << it->first.toStdString() << "  :  " ;
+		for(uint32_t f=0;f<_reverse_friend_indices.size();++f)
+		{
+			const RoutingCell& cell(_routing_weights[k*_matrix_width + f]) ;
 
-		for(uint32_t i=0;i<it->second.size();++i)
-			std::cerr << it->second[i] << "   " ;
+			if(cell.last_hit_TS > 0)
+				std::cerr << "(" << now - cell.last_hit_TS << "," << cell.weight*scale << ")   " ;
+			else
+				std::cerr << "-   " ;
+		}
 		std::cerr << std::endl;
 	}
 	std::cerr << "    Tracking clues: " << std::endl;
@@ -206,24 +252,19 @@ bool GRouterMatrix::computeRoutingProbabilities(const GRouterKeyId& key_id, cons
 {
 	// Routing probabilities are computed according to routing clues
 	//
-	// For a given key, each friend has a known set of routing clues (rstime_t, weight)
-	//	We combine these to compute a static weight for each friend/key pair. 
-	//	This is performed in updateRoutingProbabilities()
+	// For a given key, each friend has a weight that sums up the weights of its routing clues, each decayed
+	// with a half life of RS_GROUTER_MATRIX_HALF_LIFE. The sum is updated when clues are received, so that
+	// nothing needs to be recomputed here.
 	//
 	//	Then for a given list of online friends, the weights are computed into probabilities, 
 	//	that always sum up to 1.
 	//
-#ifdef ROUTING_MATRIX_DEBUG
-    if(_proba_need_updating)
-        std::cerr << "GRouterMatrix::computeRoutingProbabilities(): matrix is not up to date. Not a real problem, but still..." << std::endl;
-#endif
-
 	probas.resize(friends.size(),0.0f) ;
 	float total = 0.0f ;
 
-	std::map<GRouterKeyId,std::vector<float> >::const_iterator it2 = _time_combined_hits.find(key_id) ;
+	std::map<GRouterKeyId,uint32_t>::const_iterator it2 = _key_indices.find(key_id) ;
 
-	if(it2 == _time_combined_hits.end())
+	if(it2 == _key_indices.end())
 	{
         // The key is not known. In this case, we return a zero probability for all peers.
         //
@@ -237,22 +278,23 @@ bool GRouterMatrix::computeRoutingProbabilities(const GRouterKeyId& key_id, cons
 #endif
 		return  false ;
 	}
-	const std::vector<float>& w(it2->second) ;
+	const RoutingCell *w = &_routing_weights[it2->second*_matrix_width] ;
+	float scale = decayFactor(time(NULL)) ;
     	maximum = 0.0f ;
 	
 	for(uint32_t i=0;i<friends.size();++i)
 	{
 		uint32_t findex = getFriendId_const(friends[i]) ;
 
-		if(findex >= w.size())
+		if(findex >= _reverse_friend_indices.size())
 			probas[i] = 0.0f ;
 		else
 		{
-			probas[i] = w[findex] ;
-			total += w[findex] ;
+			probas[i] = w[findex].weight * scale ;
+			total += probas[i] ;
             
-            		if(maximum < w[findex])
-                        	maximum = w[findex] ;
+            		if(maximum < probas[i])
+                        	maximum = probas[i] ;
 		}
 	}
 
@@ -265,34 +307,52 @@ bool GRouterMatrix::computeRoutingProbabilities(const GRouterKeyId& key_id, cons
 
 bool GRouterMatrix::updateRoutingProbabilities()
 {
-	if(!_proba_need_updating)
-		return false ;
+	// Move the reference time to now, so that the decay factor stays close to 1 and weights of new clues
+	// do not grow out of the range of floats. At the same time, remove the keys for which no friend has
+	// a significant weight anymore, moving the last row of the matrix in their place.
 
 	rstime_t now = time(NULL) ;
+	float scale = decayFactor(now) ;
 
-	for(std::map<GRouterKeyId, std::list<RoutingMatrixHitEntry> >::const_iterator it(_routing_clues.begin());it!=_routing_clues.end();++it)
+	for(uint32_t k=0;k<_reverse_key_indices.size();)
 	{
+		RoutingCell *w = &_routing_weights[k*_matrix_width] ;
+		bool significant = false ;
+
+		for(uint32_t f=0;f<_matrix_width;++f)
+		{
+			w[f].weight *= scale ;
+
+			if(w[f].weight >= RS_GROUTER_MATRIX_MIN_WEIGHT || w[f].last_hit_TS + RS_GROUTER_MATRIX_MIN_TIME_BETWEEN_HITS > now)
+				significant = true ;
+		}
+
+		if(significant)
+		{
+			++k ;
+			continue ;
+		}
 #ifdef ROUTING_MATRIX_DEBUG
-        std::cerr << "      " << it->first.toStdString() << " : " ;
+		std::cerr << "  removing key " << _reverse_key_indices[k] << " which has no significant routing weight anymore." << std::endl;
 #endif
+		uint32_t last = _reverse_key_indices.size()-1 ;
 
-		std::vector<float>& v(_time_combined_hits[it->first]) ;
-		v.clear() ;
-		v.resize(_friend_indices.size(),0.0f) ;
-
-		for(std::list<RoutingMatrixHitEntry>::const_iterator it2(it->second.begin());it2!=it->second.end();++it2)
-        {
-            // Half life period is 7 days.
+		_key_indices.erase(_reverse_key_indices[k]) ;
 
-            float time_difference_in_days = 1 + (now - (*it2).time_stamp ) / (7*86400.0f) ;
-			v[(*it2).friend_id] += (*it2).weight / (time_difference_in_days*time_difference_in_days) ;
+		if(k < last)
+		{
+			std::copy(_routing_weights.begin() + last*_matrix_width,_routing_weights.begin() + (last+1)*_matrix_width,_routing_weights.begin() + k*_matrix_width) ;
+			_reverse_key_indices[k] = _reverse_key_indices[last] ;
+			_key_indices[_reverse_key_indices[k]] = k ;
 		}
-    }
+		_reverse_key_indices.pop_back() ;
+		_routing_weights.resize(last*_matrix_width) ;	// the moved row is not scaled yet, since it is visited at index k.
+	}
+	_reference_TS = now ;
+
 #ifdef ROUTING_MATRIX_DEBUG
     std::cerr << "  done." << std::endl;
 #endif
-
-	_proba_need_updating = false ;
 	return true ;
 }
 
@@ -307,12 +367,32 @@ bool GRouterMatrix::saveList(std::list<RsItem*>& items)
     item->reverse_friend_indices = _reverse_friend_indices ;
     items.push_back(item) ;
 
-    for(std::map<GRouterKeyId,std::list<RoutingMatrixHitEntry> >::const_iterator it(_routing_clues.begin());it!=_routing_clues.end();++it)
+    // Each non zero cell of the matrix is saved as a single clue, which weight is the current weight
+    // of the friend. This is compatible with lists of clues saved by previous versions.
+
+    rstime_t now = time(NULL) ;
+    float scale = decayFactor(now) ;
+
+    for(uint32_t k=0;k<_reverse_key_indices.size();++k)
     {
 	    RsGRouterMatrixCluesItem *item = new RsGRouterMatrixCluesItem ;
 
-	    item->destination_key = it->first ;
-	    item->clues = it->second ;
+	    item->destination_key = _reverse_key_indices[k] ;
+
+	    for(uint32_t f=0;f<_reverse_friend_indices.size();++f)
+	    {
+		    const RoutingCell& cell(_routing_weights[k*_matrix_width + f]) ;
+
+		    if(cell.weight <= 0.0f)
+			    continue ;
+
+		    RoutingMatrixHitEntry rc ;
+		    rc.friend_id = f ;
+		    rc.weight = cell.weight * scale ;
+		    rc.time_stamp = now ;
+
+		    item->clues.push_back(rc) ;
+	    }
 
 	    items.push_back(item) ;
     }
@@ -340,6 +420,27 @@ bool GRouterMatrix::loadList(std::list<RsItem*>& items)
     std::cerr << "  GRoutingMatrix::loadList()" << std::endl;
 #endif
 
+    // The friend list is needed first, since clues refer to friend indices.
+
+    for(std::list<RsItem*>::const_iterator it(items.begin());it!=items.end();++it)
+	    if(NULL != (itm1 = dynamic_cast<RsGRouterMatrixFriendListItem*>(*it)))
+	    {
+		    _reverse_friend_indices = itm1->reverse_friend_indices ;
+		    _friend_indices.clear() ;
+
+		    for(uint32_t i=0;i<_reverse_friend_indices.size();++i)
+			    _friend_indices[_reverse_friend_indices[i]] = i ;
+
+		    uint32_t width = GROUTER_MATRIX_MIN_WIDTH ;
+
+		    while(width < _reverse_friend_indices.size())
+			    width *= 2 ;
+
+		    setMatrixWidth(width) ;
+	    }
+
+    _reference_TS = time(NULL) ;
+
     for(std::list<RsItem*>::const_iterator it(items.begin());it!=items.end();++it)
     {
 	    if(NULL != (itm3 = dynamic_cast<RsGRouterMatrixTrackItem*>(*it)))
@@ -358,22 +459,15 @@ bool GRouterMatrix::loadList(std::list<RsItem*>& items)
 #ifdef ROUTING_MATRIX_DEBUG
 		    std::cerr << "    initing routing clues." << std::endl;
 #endif
+		    uint32_t k = getKeyIndex(itm2->destination_key) ;
 
-		    _routing_clues[itm2->destination_key] = itm2->clues ;
-		    _proba_need_updating = true ;	// notifies to re-compute all the info.
-	    }
-	    if(NULL != (itm1 = dynamic_cast<RsGRouterMatrixFriendListItem*>(*it)))
-	    {
-		    _reverse_friend_indices = itm1->reverse_friend_indices ;
-		    _friend_indices.clear() ;
-
-		    for(uint32_t i=0;i<_reverse_friend_indices.size();++i)
-			    _friend_indices[_reverse_friend_indices[i]] = i ;
-
-		    _proba_need_updating = true ;	// notifies to re-compute all the info.
+		    for(std::list<RoutingMatrixHitEntry>::const_iterator it2(itm2->clues.begin());it2!=itm2->clues.end();++it2)
+			    if((*it2).friend_id < _reverse_friend_indices.size())
+				    addWeight(_routing_weights[k*_matrix_width + (*it2).friend_id],(*it2).weight,(*it2).time_stamp) ;
+			    else
+				    std::cerr << "(WW) GRouterMatrix::loadList(): clue for unknown friend index " << (*it2).friend_id << ". Dropping it." << std::endl;
 	    }
     }
 
     return true ;
 }
-
@@ -56,8 +56,9 @@ class GRouterMatrix
 		//
 		bool computeRoutingProbabilities(const GRouterKeyId& id, const std::vector<RsPeerId>& friends, std::vector<float>& probas, float &maximum) const ;
 
-		// Update routing probabilities for each key, accounting for all received events, but without
-		// activity information 
+		// Applies the time decay to all routing weights, and forgets the keys for which all weights
+		// have become negligible. Routing probabilities are always up to date, so calling this is only
+		// needed to keep the weights in range and the matrix small.
 		//
 		bool updateRoutingProbabilities() ;
 
@@ -78,6 +79,14 @@ class GRouterMatrix
 
         	bool getTrackingInfo(const RsGxsMessageId& id,RsPeerId& source_friend);
 	private:
+		// One cell of the routing matrix, for a given key and friend.
+		//
+		struct RoutingCell
+		{
+			float weight ;			// sum of the clue weights, decayed to _reference_TS (see decayFactor())
+			uint32_t last_hit_TS ;	// time of the last clue, used to prevent flooding
+		};
+
 		// returns the friend id, possibly creating a new id.
 		//
 		uint32_t getFriendId(const RsPeerId& id) ;
@@ -86,20 +95,34 @@ class GRouterMatrix
 		//
 		uint32_t getFriendId_const(const RsPeerId& id) const;
 
-		// List of events received and computed routing probabilities
+		// returns the row of the key in the matrix, possibly creating a new row.
 		//
-		std::map<GRouterKeyId, std::list<RoutingMatrixHitEntry> > _routing_clues ;       // received routing clues. Should be saved.
-		std::map<GRouterKeyId, std::vector<float> >               _time_combined_hits ;  // hit matrix after time-convolution filter
-		std::map<RsGxsMessageId,RoutingTrackEntry>                _tracking_clues ;      // who provided the most recent messages
+		uint32_t getKeyIndex(const GRouterKeyId& id) ;
 
-		// This is used to avoid re-computing probas when new events have been received.
+		// Changes the number of cells per key, keeping the existing weights.
 		//
-		bool _proba_need_updating ;
+		void setMatrixWidth(uint32_t width) ;
 
-		// Routing weights. These are the result of a time convolution of the routing clues and weights
-		// recorded in _routing_clues.
+		// Adds the weight of a clue received at the given time to a cell.
 		//
+		void addWeight(RoutingCell& cell,float weight,rstime_t time_stamp) ;
+
+		// Factor that turns the weights stored in the matrix into their value at time now. Weights decay
+		// exponentially, so instead of decaying all weights as time passes, they are stored as their value at
+		// _reference_TS, and only multiplied by this factor when read.
+		//
+		float decayFactor(rstime_t now) const ;
+
+		// Routing weights. One row of _matrix_width cells per key, indexed by the friend index.
+		//
+		std::map<GRouterKeyId,uint32_t> _key_indices ;		// row of each key in the routing matrix. Not saved.
+		std::vector<GRouterKeyId> _reverse_key_indices ;	// key of each row.
+		std::vector<RoutingCell> _routing_weights ;			// the routing matrix. Saved as one clue per non zero cell.
+		uint32_t _matrix_width ;
+		rstime_t _reference_TS ;
+
+		std::map<RsGxsMessageId,RoutingTrackEntry>                _tracking_clues ;      // who provided the most recent messages
+
 		std::map<RsPeerId,uint32_t> _friend_indices ;	// index for each friend to lookup in the routing matrix Not saved.
 		std::vector<RsPeerId> _reverse_friend_indices ;// SSLid corresponding to each friend index. Saved.
 };
-
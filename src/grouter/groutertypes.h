@@ -33,7 +33,8 @@ class RsGRouterSignedReceiptItem ;
 
 static const uint16_t GROUTER_CLIENT_ID_MESSAGES     = 0x1001 ;
 
-static const uint32_t RS_GROUTER_MATRIX_MAX_HIT_ENTRIES       =        10 ; // max number of clues to store
+static const uint32_t RS_GROUTER_MATRIX_MAX_HIT_ENTRIES       =        10 ; // a friend weighs at most as much as this number of recent clues for a key
+static const uint32_t RS_GROUTER_MATRIX_HALF_LIFE             =  7*86400 ; // half life of routing clues: 7 days.
 static const uint32_t RS_GROUTER_MATRIX_MIN_TIME_BETWEEN_HITS =        60 ; // can be set to up to half the publish time interval. Prevents flooding routes.
 static const uint32_t RS_GROUTER_MIN_CONFIG_SAVE_PERIOD       =        61 ; // at most save config every 10 seconds
 static const uint32_t RS_GROUTER_MAX_KEEP_TRACKING_CLUES      =  86400*10 ; // max time for which we keep record of tracking info: 10 days.
@@ -42,6 +43,7 @@ static const float RS_GROUTER_BASE_WEIGHT_ROUTED_MSG          = 1.0f ;	// base c
 static const float RS_GROUTER_BASE_WEIGHT_GXS_PACKET          = 0.1f ;	// base contribution of GXS message to routing matrix
 static const float RS_GROUTER_PROBABILITY_THRESHOLD_FOR_RANDOM_ROUTING = 0.01f ;	// routing probability under which the routage is performed randomly
 static const float RS_GROUTER_PROBABILITY_THRESHOLD_BEST_PEERS_SELECT  = 0.5f ;	// min ratio of forward proba with respect to best peer.
+static const float RS_GROUTER_MATRIX_MIN_WEIGHT                         = 0.001f ;	// keys for which all weights are below this are removed from the routing matrix.
 
 static const uint32_t MAX_TUNNEL_WAIT_TIME                 = 60          ; // wait for 60 seconds at most for a tunnel response.
 static const uint32_t MAX_TUNNEL_UNMANAGED_TIME            = 600         ; // min time before retry tunnels for that msg.
@@ -20,10 +20,15 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
  *                                                                             *
  *******************************************************************************/
+#include <list>
+#include <map>
+
 #include "gxssecurity.h"
 #include "pqi/authgpg.h"
 #include "util/rsdir.h"
 #include "util/rsmemory.h"
+#include "util/rsthreads.h"
+#include "util/rstime.h"
 //#include "retroshare/rspeers.h"
 
 /****
@@ -141,6 +146,132 @@ static void setRSAPrivateKeyData(RsTlvPrivateRSAKey& key, RSA *rsa_priv)
 
 	free(data) ;
 }
+static void upRefKey(EVP_PKEY *key)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
+	CRYPTO_add(&key->references,1,CRYPTO_LOCK_EVP_PKEY) ;
+#else
+	EVP_PKEY_up_ref(key) ;
+#endif
+}
+
+// Cache of parsed public keys. Decoding the DER data and building the EVP_PKEY
+// costs more than the signature check itself, and when syncing forums or
+// channels the same author keys are used for thousands of messages.
+// Keys are indexed by the SHA1 of their data, which is also compared on hit,
+// so that a key sent with the id of another key cannot take its place.
+
+static const uint32_t MAX_CACHED_PUBLIC_KEYS = 1024 ;
+
+struct CachedPublicKey
+{
+	EVP_PKEY *key ;
+	std::string keyData ;
+	std::list<Sha1CheckSum>::iterator lruIt ;
+};
+
+static RsMutex gxsKeyCacheMtx("GxsSecurity key cache") ;
+static std::map<Sha1CheckSum,CachedPublicKey> gxsKeyCache ;
+static std::list<Sha1CheckSum> gxsKeyCacheLru ;	// most recently used first
+
+static uint64_t gxsKeyCacheHits = 0 ;
+static uint64_t gxsKeyCacheMisses = 0 ;
+static uint64_t gxsVerifications = 0 ;
+static uint64_t gxsVerificationsAtLastStats = 0 ;
+static double   gxsLastStatsTime = 0 ;
+static float    gxsVerificationsPerSecond = 0 ;
+
+EVP_PKEY *GxsSecurity::getPublicKey(const RsTlvPublicRSAKey& key)
+{
+	const unsigned char *keyptr = (const unsigned char *) key.keyData.bin_data;
+	long keylen = key.keyData.bin_len;
+
+	if(keyptr == NULL || keylen == 0)
+		return NULL ;
+
+	Sha1CheckSum digest = RsDirUtil::sha1sum(keyptr,keylen) ;
+
+	{
+		RS_STACK_MUTEX(gxsKeyCacheMtx) ;
+
+		std::map<Sha1CheckSum,CachedPublicKey>::iterator it = gxsKeyCache.find(digest) ;
+
+		if(it != gxsKeyCache.end() && it->second.keyData.size() == (size_t)keylen && !memcmp(it->second.keyData.data(),keyptr,keylen))
+		{
+			++gxsKeyCacheHits ;
+			gxsKeyCacheLru.splice(gxsKeyCacheLru.begin(),gxsKeyCacheLru,it->second.lruIt) ;
+
+			upRefKey(it->second.key) ;
+			return it->second.key ;
+		}
+		++gxsKeyCacheMisses ;
+	}
+
+	// Parse the key outside of the lock.
+
+	RSA *rsakey = d2i_RSAPublicKey(NULL, &(keyptr), keylen);
+
+	if(!rsakey)
+		return NULL ;
+
+	EVP_PKEY *pkey = EVP_PKEY_new();
+	EVP_PKEY_assign_RSA(pkey, rsakey);
+
+	RS_STACK_MUTEX(gxsKeyCacheMtx) ;
+
+	std::map<Sha1CheckSum,CachedPublicKey>::iterator it = gxsKeyCache.find(digest) ;
+
+	if(it != gxsKeyCache.end())	// added by another thread in the mean time, or same digest but different data.
+		return pkey ;
+
+	if(gxsKeyCache.size() >= MAX_CACHED_PUBLIC_KEYS)
+	{
+		std::map<Sha1CheckSum,CachedPublicKey>::iterator oldest = gxsKeyCache.find(gxsKeyCacheLru.back()) ;
+
+		EVP_PKEY_free(oldest->second.key) ;	// still valid for threads that hold a reference
+		gxsKeyCache.erase(oldest) ;
+		gxsKeyCacheLru.pop_back() ;
+	}
+
+	CachedPublicKey& entry(gxsKeyCache[digest]) ;
+
+	entry.key = pkey ;
+	entry.keyData.assign((const char*)key.keyData.bin_data,key.keyData.bin_len) ;
+	entry.lruIt = gxsKeyCacheLru.insert(gxsKeyCacheLru.begin(),digest) ;
+
+	upRefKey(pkey) ;	// one reference for the cache, one for the caller
+	return pkey ;
+}
+
+void GxsSecurity::countVerification()
+{
+	RS_STACK_MUTEX(gxsKeyCacheMtx) ;
+	++gxsVerifications ;
+}
+
+void GxsSecurity::getKeyCacheStatistics(KeyCacheStatistics& stats)
+{
+	RS_STACK_MUTEX(gxsKeyCacheMtx) ;
+
+	double now = rstime::RsScopeTimer::currentTime() ;
+
+	if(gxsLastStatsTime == 0)
+		gxsLastStatsTime = now ;
+	else if(now >= gxsLastStatsTime + 1.0)
+	{
+		gxsVerificationsPerSecond = (gxsVerifications - gxsVerificationsAtLastStats) / (now - gxsLastStatsTime) ;
+		gxsVerificationsAtLastStats = gxsVerifications ;
+		gxsLastStatsTime = now ;
+	}
+
+	stats.cachedKeys = gxsKeyCache.size() ;
+	stats.hits = gxsKeyCacheHits ;
+	stats.misses = gxsKeyCacheMisses ;
+	stats.hitRate = (gxsKeyCacheHits + gxsKeyCacheMisses > 0) ? gxsKeyCacheHits / (float)(gxsKeyCacheHits + gxsKeyCacheMisses) : 0.0f ;
+	stats.verifications = gxsVerifications ;
+	stats.verificationsPerSecond = gxsVerificationsPerSecond ;
+}
+
 bool GxsSecurity::checkFingerprint(const RsTlvPublicRSAKey& key)
 {
     RSA *rsa_pub = ::extractPublicKey(key) ;
@@ -375,16 +506,15 @@ bool GxsSecurity::validateSignature(const char *data, uint32_t data_len, const R
 {
     assert(!(key.keyFlags & RSTLV_KEY_TYPE_FULL)) ;
         
-	RSA *rsakey = ::extractPublicKey(key) ;
+	EVP_PKEY *signKey = getPublicKey(key) ;
 
-	if(!rsakey)
+	if(!signKey)
 	{
 		std::cerr << "GxsSecurity::validateSignature(): Cannot validate signature. Keydata is incomplete." << std::endl;
 		key.print(std::cerr,0) ;
 		return false ;
 	}
-	EVP_PKEY *signKey = EVP_PKEY_new();
-	EVP_PKEY_assign_RSA(signKey, rsakey);
+	countVerification() ;
 
 	/* calc and check signature */
 	EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
@@ -450,11 +580,24 @@ bool GxsSecurity::validateNxsMsg(const RsNxsMsg& msg, const RsTlvKeySignature& s
             std::cerr << std::endl;
     #endif
 
-            /* extract admin key */
+            /* extract admin key. Public keys come from the cache. */
+
+            EVP_PKEY *signKey = NULL ;
+
+            if(key.keyFlags & RSTLV_KEY_TYPE_FULL)
+            {
+                RSA *rsakey = d2i_RSAPrivateKey(NULL, &(keyptr), keylen) ;
 
-            RSA *rsakey = (key.keyFlags & RSTLV_KEY_TYPE_FULL)?  (d2i_RSAPrivateKey(NULL, &(keyptr), keylen)) : (d2i_RSAPublicKey(NULL, &(keyptr), keylen));
+                if(rsakey)
+                {
+                    signKey = EVP_PKEY_new();
+                    EVP_PKEY_assign_RSA(signKey, rsakey);
+                }
+            }
+            else
+                signKey = getPublicKey(key) ;
 
-            if (!rsakey)
+            if (!signKey)
             {
     #ifdef GXS_SECURITY_DEBUG
                     std::cerr << "GxsSecurity::validateNxsMsg()";
@@ -463,7 +606,9 @@ bool GxsSecurity::validateNxsMsg(const RsNxsMsg& msg, const RsTlvKeySignature& s
 
                     key.print(std::cerr, 10);
     #endif
+                    return false ;
             }
+            countVerification() ;
 
 
             RsTlvKeySignatureSet signSet = msgMeta.signSet;
@@ -479,8 +624,6 @@ bool GxsSecurity::validateNxsMsg(const RsNxsMsg& msg, const RsTlvKeySignature& s
 	    int signOk = 0 ;
 
 	{
-		EVP_PKEY *signKey = EVP_PKEY_new();
-		EVP_PKEY_assign_RSA(signKey, rsakey);
 		EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
 
 		uint32_t metaDataLen = msgMeta.serial_size();
@@ -490,7 +633,11 @@ bool GxsSecurity::validateNxsMsg(const RsNxsMsg& msg, const RsTlvKeySignature& s
 		RsTemporaryMemory allMsgData(allMsgDataLen) ;
 
 		if(!metaData || !allMsgData)
+		{
+			EVP_PKEY_free(signKey);
+			EVP_MD_CTX_destroy(mdctx);
 			return false ;
+		}
 		
 		msgMeta.serialise(metaData, &metaDataLen);
 
@@ -544,22 +691,9 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 
     	out = NULL ;
     
-	RSA *tmpkey = ::extractPublicKey(key) ;
-	RSA *rsa_publish_pub = RSAPublicKey_dup(tmpkey) ;
-	RSA_free(tmpkey) ;
-
-	EVP_PKEY *public_key = NULL;
-
-	//RSA* rsa_publish = EVP_PKEY_get1_RSA(privateKey);
-	//rsa_publish_pub = RSAPublicKey_dup(rsa_publish);
-
+	EVP_PKEY *public_key = getPublicKey(key) ;
 
-	if(rsa_publish_pub  != NULL)
-	{
-		public_key = EVP_PKEY_new();
-		EVP_PKEY_assign_RSA(public_key, rsa_publish_pub);
-	}
-	else
+	if(public_key == NULL)
 	{
 #ifdef DISTRIB_DEBUG
 		std::cerr << "GxsSecurity(): Could not generate publish key " << grpId
@@ -670,16 +804,9 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 
 		for(uint32_t i=0;i<keys.size();++i)
 		{
-			RSA *tmpkey = ::extractPublicKey(keys[i]) ;
-			RSA *rsa_publish_pub = RSAPublicKey_dup(tmpkey) ;
-			RSA_free(tmpkey) ;
+			public_keys[i] = getPublicKey(keys[i]) ;
 
-			if(rsa_publish_pub  != NULL)
-			{
-				public_keys[i] = EVP_PKEY_new();
-				EVP_PKEY_assign_RSA(public_keys[i], rsa_publish_pub);
-			}
-			else
+			if(public_keys[i] == NULL)
 			{
 				std::cerr << "GxsSecurity(): Could not generate public key for key id " << keys[i].keyId << std::endl;
 				throw std::runtime_error("Cannot extract public key") ;
@@ -1085,21 +1212,19 @@ bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& s
     }
 
 	/* decode key */
-	const unsigned char *keyptr = (const unsigned char *) key.keyData.bin_data;
-	long keylen = key.keyData.bin_len;
 	unsigned int siglen = sign.signData.bin_len;
 	unsigned char *sigbuf = (unsigned char *) sign.signData.bin_data;
 
 #ifdef DISTRIB_DEBUG
 	std::cerr << "GxsSecurity::validateNxsMsg() Decode Key";
-	std::cerr << " keylen: " << keylen << " siglen: " << siglen;
+	std::cerr << " keylen: " << key.keyData.bin_len << " siglen: " << siglen;
 	std::cerr << std::endl;
 #endif
 
 	/* extract admin key */
-	RSA *rsakey = d2i_RSAPublicKey(NULL, &(keyptr), keylen);
+	EVP_PKEY *signKey = getPublicKey(key) ;
 
-	if (!rsakey)
+	if (!signKey)
 	{
 #ifdef GXS_SECURITY_DEBUG
 		std::cerr << "GxsSecurity::validateNxsGrp()";
@@ -1108,7 +1233,9 @@ bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& s
 
 		key.print(std::cerr, 10);
 #endif
+		return false ;
 	}
+	countVerification() ;
 
 	std::vector<uint32_t> api_versions_to_check ;
 	api_versions_to_check.push_back(RS_GXS_GRP_META_DATA_VERSION_ID_0002) ;	// put newest first, for debug info purpose
@@ -1118,8 +1245,6 @@ bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& s
 	grpMeta.signSet.TlvClear();
     
 	int signOk =0;
-	EVP_PKEY *signKey = EVP_PKEY_new();
-	EVP_PKEY_assign_RSA(signKey, rsakey);
 
 
 	for(uint32_t i=0;i<api_versions_to_check.size() && 0==signOk;++i)
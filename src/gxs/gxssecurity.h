@@ -133,6 +133,31 @@ class GxsSecurity
          * \return 
          */
         static void createPublicKeysFromPrivateKeys(RsTlvSecurityKeySet& set) ;
+
+        /*!
+         * Statistics of the cache of parsed public keys, used by the signature
+         * validation and encryption methods above.
+         */
+        struct KeyCacheStatistics
+        {
+            uint32_t cachedKeys ;
+            uint64_t hits ;
+            uint64_t misses ;
+            float    hitRate ;                  // in [0,1]
+            uint64_t verifications ;            // total number of signature verifications
+            float    verificationsPerSecond ;   // averaged since the previous call (over at least 1 second)
+        };
+        static void getKeyCacheStatistics(KeyCacheStatistics& stats) ;
+
+    private:
+        /*!
+         * \brief getPublicKey
+         *      Returns the parsed public key, from the cache if possible.
+         * \return a new reference on the key, to release with EVP_PKEY_free(), or NULL if the key data is invalid.
+         */
+        static EVP_PKEY *getPublicKey(const RsTlvPublicRSAKey& key) ;
+
+        static void countVerification() ;
 };
 
 #endif // GXSSECURITY_H
@@ -40,11 +40,16 @@
 
 #define MSG_TABLE_NAME std::string("MESSAGES")
 #define GRP_TABLE_NAME std::string("GROUPS")
+#define THREAD_TABLE_NAME std::string("THREADS")
 #define DATABASE_RELEASE_TABLE_NAME std::string("DATABASE_RELEASE")
 
 #define GRP_LAST_POST_UPDATE_TRIGGER std::string("LAST_POST_UPDATE")
 
 #define MSG_INDEX_GRPID std::string("INDEX_MESSAGES_GRPID")
+#define MSG_INDEX_PARENTID std::string("INDEX_MESSAGES_PARENTID")
+#define MSG_INDEX_ORIG_MSGID std::string("INDEX_MESSAGES_ORIG_MSGID")
+#define MSG_INDEX_THREAD_ROOT std::string("INDEX_MESSAGES_THREAD_ROOT")
+#define THREAD_INDEX_ACTIVITY std::string("INDEX_THREADS_ACTIVITY")
 
 // generic
 #define KEY_NXS_DATA        std::string("nxsData")
@@ -90,11 +95,15 @@
 #define KEY_MSG_PARENT_ID std::string("parentId")
 #define KEY_MSG_THREAD_ID std::string("threadId")
 #define KEY_MSG_NAME std::string("msgName")
+#define KEY_MSG_THREAD_ROOT std::string("threadRoot")
 
 // msg local
 #define KEY_MSG_STATUS      std::string("msgStatus")
 #define KEY_CHILD_TS        std::string("childTs")
 
+// thread table columns
+#define KEY_THREAD_LAST_ACTIVITY std::string("lastActivity")
+
 // database release columns
 #define KEY_DATABASE_RELEASE_ID std::string("id")
 #define KEY_DATABASE_RELEASE_ID_VALUE 1
@@ -291,7 +300,7 @@ static bool moveDataFromFileToDatabase(RetroDb *db, const std::string serviceDir
 
 void RsDataService::initialise(bool isNewDatabase)
 {
-    const int databaseRelease = 1;
+    const int databaseRelease = 2;
     int currentDatabaseRelease = 0;
     bool ok = true;
 
@@ -326,7 +335,8 @@ void RsDataService::initialise(bool isNewDatabase)
                      KEY_MSG_NAME + " TEXT," +
                      KEY_NXS_SERV_STRING + " TEXT," +
                      KEY_NXS_HASH + " TEXT," +
-                     KEY_RECV_TS + " INT);");
+                     KEY_RECV_TS + " INT," +
+                     KEY_MSG_THREAD_ROOT + " TEXT);");
 
         // create table for grp data
         mDb->execSQL("CREATE TABLE " + GRP_TABLE_NAME + "(" +
@@ -367,6 +377,8 @@ void RsDataService::initialise(bool isNewDatabase)
 
         mDb->execSQL("CREATE INDEX " + MSG_INDEX_GRPID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID +  ");");
 
+        locked_createThreadIndex();
+
         // Insert release, no need to upgrade
         ContentValue cv;
         cv.put(KEY_DATABASE_RELEASE_ID, KEY_DATABASE_RELEASE_ID_VALUE);
@@ -441,6 +453,21 @@ void RsDataService::initialise(bool isNewDatabase)
                 currentDatabaseRelease = newRelease;
             }
         }
+
+        // Release 2: thread index
+        newRelease = 2;
+        if (ok && currentDatabaseRelease < newRelease) {
+            ok = startReleaseUpdate(newRelease);
+
+            ok = ok && mDb->execSQL("ALTER TABLE " + MSG_TABLE_NAME + " ADD COLUMN " + KEY_MSG_THREAD_ROOT + " TEXT;");
+            ok = ok && locked_createThreadIndex();
+            ok = ok && locked_rebuildThreadIndex();
+
+            ok = finishReleaseUpdate(newRelease, ok);
+            if (ok) {
+                currentDatabaseRelease = newRelease;
+            }
+        }
     }
 
     if (ok) {
@@ -824,7 +851,12 @@ int RsDataService::storeMessage(const std::list<RsNxsMsg*>& msg)
         cv.put(KEY_MSG_STATUS, (int32_t)msgMetaPtr->mMsgStatus);
         cv.put(KEY_CHILD_TS, (int32_t)msgMetaPtr->mChildTs);
 
-        if (!mDb->sqlInsert(MSG_TABLE_NAME, "", cv))
+        std::string threadRoot = locked_computeThreadRoot(*msgMetaPtr);
+        cv.put(KEY_MSG_THREAD_ROOT, threadRoot);
+
+        if (mDb->sqlInsert(MSG_TABLE_NAME, "", cv))
+            locked_addToThreadIndex(msgMetaPtr->mGroupId.toStdString(), msgMetaPtr->mMsgId.toStdString(), threadRoot, msgMetaPtr->mPublishTs);
+        else
         {
             std::cerr << "RsDataService::storeMessage() sqlInsert Failed";
             std::cerr << std::endl;
@@ -1167,6 +1199,53 @@ void RsDataService::locked_retrieveGroups(RetroCursor* c, std::vector<RsNxsGrp*>
     }
 }
 
+// Requested message ids are fetched by chunks with "msgId IN (?,...)" queries.
+// Only a few chunk sizes are used, so that the prepared statements can be
+// cached. The last chunk is padded by repeating its last id.
+static const uint32_t MSG_REQ_CHUNK_SIZES[] = { 1, 8, 64, 256 };
+static const uint32_t MSG_REQ_NB_CHUNK_SIZES = sizeof(MSG_REQ_CHUNK_SIZES)/sizeof(uint32_t);
+
+RetroCursor* RsDataService::locked_queryGroupMsgs(const RsGxsGroupId& grpId, const std::list<std::string>& columns)
+{
+    std::list<RetroBind*> args;
+    args.push_back(new RsStringBind(grpId.toStdString(), 1));
+
+    return mDb->sqlQuery(MSG_TABLE_NAME, columns, KEY_GRP_ID + "=?", args, "");
+}
+
+RetroCursor* RsDataService::locked_queryMsgChunk(const RsGxsGroupId& grpId, const std::vector<RsGxsMessageId>& msgIds, uint32_t& start, const std::list<std::string>& columns)
+{
+    uint32_t remaining = msgIds.size() - start;
+    uint32_t chunk_size = MSG_REQ_CHUNK_SIZES[MSG_REQ_NB_CHUNK_SIZES-1];
+
+    for(uint32_t i=0;i<MSG_REQ_NB_CHUNK_SIZES;++i)
+        if(MSG_REQ_CHUNK_SIZES[i] >= remaining)
+        {
+            chunk_size = MSG_REQ_CHUNK_SIZES[i];
+            break;
+        }
+
+    uint32_t nb_ids = std::min(chunk_size, remaining);
+
+    std::list<RetroBind*> args;
+    args.push_back(new RsStringBind(grpId.toStdString(), 1));
+
+    // The unary '+' prevents SQLite from using the grpId index instead of the
+    // msgId primary key, which it would otherwise do for large IN lists.
+    std::string selection = "+" + KEY_GRP_ID + "=? AND " + KEY_MSG_ID + " IN (";
+
+    for(uint32_t i=0;i<chunk_size;++i)
+    {
+        selection += (i == 0) ? "?" : ",?";
+        args.push_back(new RsStringBind(msgIds[start + std::min(i, nb_ids-1)].toStdString(), i+2));
+    }
+    selection += ")";
+
+    start += nb_ids;
+
+    return mDb->sqlQuery(MSG_TABLE_NAME, columns, selection, args, "");
+}
+
 int RsDataService::retrieveNxsMsgs(const GxsMsgReq &reqIds, GxsMsgResult &msg,  bool withMeta)
 {
 #ifdef RS_DATA_SERVICE_DEBUG_TIME
@@ -1187,7 +1266,7 @@ int RsDataService::retrieveNxsMsgs(const GxsMsgReq &reqIds, GxsMsgResult &msg,
 		{
 			RS_STACK_MUTEX(mDbMutex);
 
-            RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, withMeta ? mMsgColumnsWithMeta : mMsgColumns, KEY_GRP_ID+ "='" + grpId.toStdString() + "'", "");
+            RetroCursor* c = locked_queryGroupMsgs(grpId, withMeta ? mMsgColumnsWithMeta : mMsgColumns);
 
             if(c)
                 locked_retrieveMessages(c, msgSet, withMeta ? mColMsg_WithMetaOffset : 0);
@@ -1196,16 +1275,14 @@ int RsDataService::retrieveNxsMsgs(const GxsMsgReq &reqIds, GxsMsgResult &msg,
 		}
 		else
 		{
+            std::vector<RsGxsMessageId> msgIds(msgIdV.begin(), msgIdV.end());
+
 			RS_STACK_MUTEX(mDbMutex);
 
-            // request each grp
-			for( std::set<RsGxsMessageId>::const_iterator sit = msgIdV.begin();
-			     sit!=msgIdV.end();++sit )
+            // request msgs by chunks
+            for(uint32_t i=0;i<msgIds.size();)
 			{
-                const RsGxsMessageId& msgId = *sit;
-
-                RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, withMeta ? mMsgColumnsWithMeta : mMsgColumns, KEY_GRP_ID+ "='" + grpId.toStdString()
-                                               + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", "");
+                RetroCursor* c = locked_queryMsgChunk(grpId, msgIds, i, withMeta ? mMsgColumnsWithMeta : mMsgColumns);
 
                 if(c)
                 {
@@ -1278,7 +1355,7 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
                 cache->getFullMetaList(msgMeta[grpId]);
             else
 			{
-				RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID+ "='" + grpId.toStdString() + "'", "");
+				RetroCursor* c = locked_queryGroupMsgs(grpId, mMsgMetaColumns);
 
 				if (c)
 				{
@@ -1295,8 +1372,9 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
         }
         else
         {
-            // request each msg meta
+            // request each msg meta, from the cache when possible
 			auto& metaSet(msgMeta[grpId]);
+            std::vector<RsGxsMessageId> missingIds;
 
             for(auto sit(msgIdV.begin()); sit!=msgIdV.end(); ++sit)
 			{
@@ -1307,10 +1385,21 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
                 if(meta)
                     metaSet.push_back(meta);
                 else
-				{
-					RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID+ "='" + grpId.toStdString() + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", "");
+                    missingIds.push_back(msgId);
+			}
+
+            // then request the missing ones by chunks
+            for(uint32_t i=0;i<missingIds.size();)
+            {
+                RetroCursor* c = locked_queryMsgChunk(grpId, missingIds, i, mMsgMetaColumns);
 
-                    c->moveToFirst();
+                if(!c)
+                    continue;
+
+                bool valid = c->moveToFirst();
+
+                while(valid)
+                {
                     auto meta = locked_getMsgMeta(*c, 0);
 
                     if(meta)
@@ -1318,12 +1407,14 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
                         metaSet.push_back(meta);
 
                         if(mUseCache)
-                            mMsgMetaDataCache[grpId].updateMeta(msgId,meta);
+                            cache->updateMeta(meta->mMsgId,meta);
                     }
 
-                    delete c;
-				}
-			}
+                    valid = c->moveToNext();
+                }
+
+                delete c;
+            }
 #ifdef RS_DATA_SERVICE_DEBUG_CACHE
 			std::cerr << mDbName << ": Retrieving Msg metadata grpId=" << grpId << ", " << std::dec << metaSet.size() << " messages" << std::endl;
 #endif
@@ -1494,6 +1585,11 @@ int RsDataService::resetDataStore()
         RsStackMutex stack(mDbMutex);
 
         mDb->execSQL("DROP INDEX " + MSG_INDEX_GRPID);
+        mDb->execSQL("DROP INDEX " + MSG_INDEX_PARENTID);
+        mDb->execSQL("DROP INDEX " + MSG_INDEX_ORIG_MSGID);
+        mDb->execSQL("DROP INDEX " + MSG_INDEX_THREAD_ROOT);
+        mDb->execSQL("DROP INDEX " + THREAD_INDEX_ACTIVITY);
+        mDb->execSQL("DROP TABLE " + THREAD_TABLE_NAME);
         mDb->execSQL("DROP TABLE " + DATABASE_RELEASE_TABLE_NAME);
         mDb->execSQL("DROP TABLE " + MSG_TABLE_NAME);
         mDb->execSQL("DROP TABLE " + GRP_TABLE_NAME);
@@ -1692,6 +1788,164 @@ int RsDataService::retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std
 
 }
 
+int RsDataService::retrieveThreads(const RsGxsGroupId& grpId, uint32_t offset, uint32_t limit, std::vector<RsGxsThreadInfo>& threads)
+{
+    RsStackMutex stack(mDbMutex);
+
+    std::list<std::string> columns;
+    columns.push_back(KEY_MSG_THREAD_ROOT);
+    columns.push_back(KEY_THREAD_LAST_ACTIVITY);
+    columns.push_back(KEY_MSG_COUNT);
+
+    std::list<RetroBind*> args;
+    args.push_back(new RsStringBind(grpId.toStdString(), 1));
+    args.push_back(new RsInt64bind(limit, 2));
+    args.push_back(new RsInt64bind(offset, 3));
+
+    RetroCursor* c = mDb->sqlQuery(THREAD_TABLE_NAME, columns, KEY_GRP_ID + "=?1", args,
+                                   KEY_THREAD_LAST_ACTIVITY + " DESC," + KEY_MSG_THREAD_ROOT + " LIMIT ?2 OFFSET ?3");
+    if(!c)
+        return 0;
+
+    size_t first = threads.size();
+    bool valid = c->moveToFirst();
+
+    while(valid)
+    {
+        std::string threadRoot;
+        c->getString(0, threadRoot);
+
+        RsGxsThreadInfo info;
+        info.mThreadId = RsGxsMessageId(threadRoot);
+        info.mLastActivity = c->getInt64(1);
+        info.mMsgCount = c->getInt32(2);
+        threads.push_back(info);
+
+        valid = c->moveToNext();
+    }
+    delete c;
+
+    // Messages without parent are the first message of the thread and its new versions.
+
+    const std::string nullId = RsGxsMessageId().toStdString();
+
+    for(size_t i=first;i<threads.size();++i)
+    {
+        args.push_back(new RsStringBind(grpId.toStdString(), 1));
+        args.push_back(new RsStringBind(threads[i].mThreadId.toStdString(), 2));
+        args.push_back(new RsStringBind(nullId, 3));
+
+        c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?2 AND " + KEY_MSG_PARENT_ID + "=?3", args, "");
+
+        if(c)
+        {
+            locked_retrieveMsgMetaList(c, threads[i].mTopMsgs);
+            delete c;
+        }
+    }
+
+    return 1;
+}
+
+int RsDataService::retrieveMsgVersions(const RsGxsGroupId& grpId, const RsGxsMessageId& msgId, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& versions)
+{
+    RsStackMutex stack(mDbMutex);
+
+    // Versions are chained by their orig msg id, which is the id of a previous version. Follow the chain both ways.
+
+    std::set<RsGxsMessageId> visited;
+    std::list<RsGxsMessageId> toVisit(1, msgId);
+
+    while(!toVisit.empty())
+    {
+        RsGxsMessageId id = toVisit.front();
+        toVisit.pop_front();
+
+        if(id.isNull() || !visited.insert(id).second)
+            continue;
+
+        std::list<RetroBind*> args;
+        args.push_back(new RsStringBind(grpId.toStdString(), 1));
+        args.push_back(new RsStringBind(id.toStdString(), 2));
+
+        RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID + "=?1 AND (" + KEY_MSG_ID + "=?2 OR " + KEY_ORIG_MSG_ID + "=?2)", args, "");
+
+        if(!c)
+            return 0;
+
+        std::vector<std::shared_ptr<RsGxsMsgMetaData> > metas;
+        locked_retrieveMsgMetaList(c, metas);
+        delete c;
+
+        for(auto& meta:metas)
+            if(meta->mMsgId == id)
+            {
+                versions.push_back(meta);
+                toVisit.push_back(meta->mOrigMsgId);
+            }
+            else
+                toVisit.push_back(meta->mMsgId);
+    }
+
+    return 1;
+}
+
+int RsDataService::retrieveChildMsgMetaData(const RsGxsGroupId& grpId, const std::set<RsGxsMessageId>& parentIds, uint32_t offset, uint32_t limit, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& children)
+{
+    if(parentIds.empty())
+        return 1;
+
+    RsStackMutex stack(mDbMutex);
+
+    // Use one of the chunk sizes, so that the statement can be cached.
+
+    uint32_t nb_ids = MSG_REQ_CHUNK_SIZES[MSG_REQ_NB_CHUNK_SIZES-1];
+
+    for(uint32_t i=0;i<MSG_REQ_NB_CHUNK_SIZES;++i)
+        if(MSG_REQ_CHUNK_SIZES[i] >= parentIds.size())
+        {
+            nb_ids = MSG_REQ_CHUNK_SIZES[i];
+            break;
+        }
+
+    if(parentIds.size() > nb_ids)
+        std::cerr << "(WW) RsDataService::retrieveChildMsgMetaData(): too many parent ids (" << parentIds.size() << "). Only the first " << nb_ids << " are used." << std::endl;
+
+    std::list<RetroBind*> args;
+    args.push_back(new RsStringBind(grpId.toStdString(), 1));
+    args.push_back(new RsInt64bind(limit, 2));
+    args.push_back(new RsInt64bind(offset, 3));
+
+    std::string selection = KEY_GRP_ID + "=?1 AND " + KEY_MSG_PARENT_ID + " IN (";
+    auto it = parentIds.begin();
+
+    for(uint32_t i=0;i<nb_ids;++i)
+    {
+        selection += ((i == 0) ? "?" : ",?") + std::to_string(4+i);
+        args.push_back(new RsStringBind(it->toStdString(), 4+i));
+
+        if(std::next(it) != parentIds.end())
+            ++it;
+    }
+
+    // Skip messages that have been replaced by a new version from the same author.
+
+    selection += ") AND NOT EXISTS (SELECT 1 FROM " + MSG_TABLE_NAME + " n WHERE n." + KEY_GRP_ID + "=" + MSG_TABLE_NAME + "." + KEY_GRP_ID
+            + " AND n." + KEY_ORIG_MSG_ID + "=" + MSG_TABLE_NAME + "." + KEY_MSG_ID
+            + " AND n." + KEY_MSG_ID + "!=" + MSG_TABLE_NAME + "." + KEY_MSG_ID
+            + " AND n." + KEY_NXS_IDENTITY + "=" + MSG_TABLE_NAME + "." + KEY_NXS_IDENTITY + ")";
+
+    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, selection, args, KEY_TIME_STAMP + "," + KEY_MSG_ID + " LIMIT ?2 OFFSET ?3");
+
+    if(!c)
+        return 0;
+
+    locked_retrieveMsgMetaList(c, children);
+    delete c;
+
+    return 1;
+}
+
 bool RsDataService::locked_removeMessageEntries(const GxsMsgReq& msgIds)
 {
     // start a transaction
@@ -1705,12 +1959,19 @@ bool RsDataService::locked_removeMessageEntries(const GxsMsgReq& msgIds)
         const std::set<RsGxsMessageId>& msgsV = mit->second;
         auto& cache(mMsgMetaDataCache[grpId]);
 
+        std::set<std::string> threadRoots;
+
         for(auto& msgId:msgsV)
         {
+            locked_removeFromThreadIndex(grpId.toStdString(), msgId.toStdString(), threadRoots);
+
             mDb->sqlDelete(MSG_TABLE_NAME, KEY_GRP_ID+ "='" + grpId.toStdString() + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", "");
 
             cache.clear(msgId);
         }
+
+        for(auto& threadRoot:threadRoots)
+            locked_updateThreadActivity(grpId.toStdString(), threadRoot);
     }
 
     ret &= mDb->commitTransaction();
@@ -1735,6 +1996,236 @@ bool RsDataService::locked_removeGroupEntries(const std::vector<RsGxsGroupId>& g
     return ret;
 }
 
+static std::list<RetroBind*> stringBinds(const std::vector<std::string>& values)
+{
+    std::list<RetroBind*> binds;
+
+    for(uint32_t i=0;i<values.size();++i)
+        binds.push_back(new RsStringBind(values[i], i+1));
+
+    return binds;
+}
+
+bool RsDataService::locked_createThreadIndex()
+{
+    bool ok = mDb->execSQL("CREATE INDEX " + MSG_INDEX_PARENTID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_MSG_PARENT_ID + ");");
+    ok = ok && mDb->execSQL("CREATE INDEX " + MSG_INDEX_ORIG_MSGID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_ORIG_MSG_ID + ");");
+    ok = ok && mDb->execSQL("CREATE INDEX " + MSG_INDEX_THREAD_ROOT + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_MSG_THREAD_ROOT + ");");
+
+    ok = ok && mDb->execSQL("CREATE TABLE " + THREAD_TABLE_NAME + "(" +
+                            KEY_GRP_ID + " TEXT," +
+                            KEY_MSG_THREAD_ROOT + " TEXT," +
+                            KEY_THREAD_LAST_ACTIVITY + " INT," +
+                            KEY_MSG_COUNT + " INT," +
+                            "PRIMARY KEY(" + KEY_GRP_ID + "," + KEY_MSG_THREAD_ROOT + "));");
+
+    ok = ok && mDb->execSQL("CREATE INDEX " + THREAD_INDEX_ACTIVITY + " ON " + THREAD_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_THREAD_LAST_ACTIVITY + ");");
+
+    return ok;
+}
+
+bool RsDataService::locked_rebuildThreadIndex()
+{
+    // Load the links of all messages, and follow them up to the first message of each thread.
+
+    std::list<std::string> columns;
+    columns.push_back(KEY_MSG_ID);
+    columns.push_back(KEY_MSG_PARENT_ID);
+    columns.push_back(KEY_ORIG_MSG_ID);
+
+    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, columns, "", "");
+
+    if(!c)
+        return false;
+
+    const std::string nullId = RsGxsMessageId().toStdString();
+    std::map<std::string, std::string> anchors;     // msg id -> id of the message it is attached to, empty if none
+
+    bool valid = c->moveToFirst();
+
+    while(valid)
+    {
+        std::string msgId, parentId, origMsgId;
+        c->getString(0, msgId);
+        c->getString(1, parentId);
+        c->getString(2, origMsgId);
+
+        std::string& anchor(anchors[msgId]);
+
+        if(!parentId.empty() && parentId != nullId)
+            anchor = parentId;
+        else if(!origMsgId.empty() && origMsgId != nullId && origMsgId != msgId)
+            anchor = origMsgId;
+
+        valid = c->moveToNext();
+    }
+    delete c;
+
+    std::map<std::string, std::string> roots;
+
+    for(auto& it:anchors)
+    {
+        std::vector<std::string> path;
+        std::set<std::string> visited;
+        std::string root = it.first;
+
+        while(true)
+        {
+            auto rit = roots.find(root);
+
+            if(rit != roots.end())
+            {
+                root = rit->second;
+                break;
+            }
+
+            auto ait = anchors.find(root);
+
+            if(ait == anchors.end() || ait->second.empty() || !visited.insert(root).second)
+                break;
+
+            path.push_back(root);
+            root = ait->second;
+        }
+
+        for(auto& id:path)
+            roots[id] = root;
+
+        roots[it.first] = root;
+    }
+
+    bool ok = mDb->execSQL("UPDATE " + MSG_TABLE_NAME + " SET " + KEY_MSG_THREAD_ROOT + "=" + KEY_MSG_ID + ";");
+
+    for(auto& it:roots)
+        if(ok && it.first != it.second)
+        {
+            std::list<RetroBind*> binds = stringBinds({ it.second, it.first });
+            ok = mDb->execSQL_bind("UPDATE " + MSG_TABLE_NAME + " SET " + KEY_MSG_THREAD_ROOT + "=?1 WHERE " + KEY_MSG_ID + "=?2;", binds);
+        }
+
+    ok = ok && mDb->execSQL("INSERT INTO " + THREAD_TABLE_NAME + " SELECT " + KEY_GRP_ID + "," + KEY_MSG_THREAD_ROOT + ",MAX(" + KEY_TIME_STAMP + "),COUNT(*) FROM "
+                            + MSG_TABLE_NAME + " GROUP BY " + KEY_GRP_ID + "," + KEY_MSG_THREAD_ROOT + ";");
+
+    return ok;
+}
+
+bool RsDataService::locked_getThreadRoot(const std::string& msgId, std::string& threadRoot)
+{
+    std::list<std::string> columns;
+    columns.push_back(KEY_MSG_THREAD_ROOT);
+
+    std::list<RetroBind*> args;
+    args.push_back(new RsStringBind(msgId, 1));
+
+    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, columns, KEY_MSG_ID + "=?1", args, "");
+
+    if(!c)
+        return false;
+
+    bool found = c->moveToFirst();
+
+    if(found)
+        c->getString(0, threadRoot);
+
+    delete c;
+    return found;
+}
+
+std::string RsDataService::locked_computeThreadRoot(const RsGxsMsgMetaData& meta)
+{
+    // Replies belong to the thread of their parent, and new versions of a message without parent to the thread of the previous version.
+
+    RsGxsMessageId anchor = meta.mParentId;
+
+    if(anchor.isNull() && meta.mOrigMsgId != meta.mMsgId)
+        anchor = meta.mOrigMsgId;
+
+    if(anchor.isNull())
+        return meta.mMsgId.toStdString();
+
+    // Until the parent is received, the thread is rooted at it.
+
+    std::string threadRoot;
+
+    if(!locked_getThreadRoot(anchor.toStdString(), threadRoot) || threadRoot.empty())
+        threadRoot = anchor.toStdString();
+
+    return threadRoot;
+}
+
+void RsDataService::locked_addToThreadIndex(const std::string& grpId, const std::string& msgId, const std::string& threadRoot, rstime_t ts)
+{
+    std::list<RetroBind*> binds = stringBinds({ grpId, threadRoot });
+    mDb->execSQL_bind("INSERT OR IGNORE INTO " + THREAD_TABLE_NAME + " VALUES(?1,?2,0,0);", binds);
+
+    if(threadRoot != msgId)
+    {
+        // The message may be the missing parent of messages already stored. Their thread, rooted at
+        // this message, is merged into the thread of the message.
+
+        auto oldThread = [](const std::string& column)
+        {
+            return "IFNULL((SELECT t." + column + " FROM " + THREAD_TABLE_NAME + " t WHERE t." + KEY_GRP_ID + "=?1 AND t." + KEY_MSG_THREAD_ROOT + "=?3),0)";
+        };
+
+        binds = stringBinds({ grpId, threadRoot, msgId });
+        mDb->execSQL_bind("UPDATE " + MSG_TABLE_NAME + " SET " + KEY_MSG_THREAD_ROOT + "=?2 WHERE " + KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?3;", binds);
+
+        binds = stringBinds({ grpId, threadRoot, msgId });
+        mDb->execSQL_bind("UPDATE " + THREAD_TABLE_NAME + " SET "
+                          + KEY_THREAD_LAST_ACTIVITY + "=MAX(" + KEY_THREAD_LAST_ACTIVITY + "," + oldThread(KEY_THREAD_LAST_ACTIVITY) + "),"
+                          + KEY_MSG_COUNT + "=" + KEY_MSG_COUNT + "+" + oldThread(KEY_MSG_COUNT)
+                          + " WHERE " + KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?2;", binds);
+
+        binds = stringBinds({ grpId, msgId });
+        mDb->execSQL_bind("DELETE FROM " + THREAD_TABLE_NAME + " WHERE " + KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?2;", binds);
+    }
+
+    binds = stringBinds({ grpId, threadRoot });
+    binds.push_back(new RsInt64bind(ts, 3));
+    mDb->execSQL_bind("UPDATE " + THREAD_TABLE_NAME + " SET " + KEY_THREAD_LAST_ACTIVITY + "=MAX(" + KEY_THREAD_LAST_ACTIVITY + ",?3),"
+                      + KEY_MSG_COUNT + "=" + KEY_MSG_COUNT + "+1 WHERE " + KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?2;", binds);
+}
+
+void RsDataService::locked_removeFromThreadIndex(const std::string& grpId, const std::string& msgId, std::set<std::string>& threadRoots)
+{
+    std::string threadRoot;
+
+    if(!locked_getThreadRoot(msgId, threadRoot))
+        return;
+
+    threadRoots.insert(threadRoot);
+
+    if(threadRoot.empty() || threadRoot == msgId)
+        return;
+
+    // The replies of the message are now rooted at the missing message, as they were before it was received.
+
+    threadRoots.insert(msgId);
+
+    std::list<RetroBind*> binds = stringBinds({ grpId, msgId, RsGxsMessageId().toStdString() });
+    mDb->execSQL_bind("UPDATE " + MSG_TABLE_NAME + " SET " + KEY_MSG_THREAD_ROOT + "=?2 WHERE " + KEY_MSG_ID + "!=?2 AND " + KEY_MSG_ID + " IN ("
+                      + "WITH RECURSIVE replies(id) AS (SELECT ?2 UNION SELECT m." + KEY_MSG_ID + " FROM " + MSG_TABLE_NAME + " m JOIN replies ON m." + KEY_MSG_PARENT_ID + "=replies.id"
+                      + " OR (m." + KEY_MSG_PARENT_ID + "=?3 AND m." + KEY_ORIG_MSG_ID + "=replies.id) WHERE m." + KEY_GRP_ID + "=?1) SELECT id FROM replies);", binds);
+}
+
+void RsDataService::locked_updateThreadActivity(const std::string& grpId, const std::string& threadRoot)
+{
+    const std::string threadMsgs = " FROM " + MSG_TABLE_NAME + " WHERE " + KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?2)";
+
+    std::list<RetroBind*> binds = stringBinds({ grpId, threadRoot });
+    mDb->execSQL_bind("INSERT OR IGNORE INTO " + THREAD_TABLE_NAME + " VALUES(?1,?2,0,0);", binds);
+
+    binds = stringBinds({ grpId, threadRoot });
+    mDb->execSQL_bind("UPDATE " + THREAD_TABLE_NAME + " SET "
+                      + KEY_THREAD_LAST_ACTIVITY + "=IFNULL((SELECT MAX(" + KEY_TIME_STAMP + ")" + threadMsgs + ",0),"
+                      + KEY_MSG_COUNT + "=(SELECT COUNT(*)" + threadMsgs
+                      + " WHERE " + KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?2;", binds);
+
+    binds = stringBinds({ grpId, threadRoot });
+    mDb->execSQL_bind("DELETE FROM " + THREAD_TABLE_NAME + " WHERE " + KEY_GRP_ID + "=?1 AND " + KEY_MSG_THREAD_ROOT + "=?2 AND " + KEY_MSG_COUNT + "=0;", binds);
+}
+
 uint32_t RsDataService::cacheSize() const {
     return 0;
 }
@@ -198,6 +198,36 @@ public:
      */
     int retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std_set& msgId) override;
 
+    /*!
+     * Retrieves a page of the threads of a group, most recently active first
+     * @param grpId group of the threads
+     * @param offset number of threads to skip
+     * @param limit max number of threads to retrieve
+     * @param threads retrieved threads
+     * @return error code
+     */
+    int retrieveThreads(const RsGxsGroupId& grpId, uint32_t offset, uint32_t limit, std::vector<RsGxsThreadInfo>& threads) override;
+
+    /*!
+     * Retrieves meta data of all versions of a message
+     * @param grpId group of the message
+     * @param msgId id of any version of the message
+     * @param versions meta data of the versions present in store
+     * @return error code
+     */
+    int retrieveMsgVersions(const RsGxsGroupId& grpId, const RsGxsMessageId& msgId, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& versions) override;
+
+    /*!
+     * Retrieves a page of the meta data of the replies to the given messages, oldest first
+     * @param grpId group of the messages
+     * @param parentIds ids of the parent messages
+     * @param offset number of replies to skip
+     * @param limit max number of replies to retrieve
+     * @param children retrieved meta data
+     * @return error code
+     */
+    int retrieveChildMsgMetaData(const RsGxsGroupId& grpId, const std::set<RsGxsMessageId>& parentIds, uint32_t offset, uint32_t limit, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& children) override;
+
     /*!
      * @return the cache size set for this RsGeneralDataService in bytes
      */
@@ -324,6 +354,17 @@ private:
      */
     RsNxsGrp* locked_getGroup(RetroCursor& c);
 
+    /*!
+     * Queries all messages of a group
+     */
+    RetroCursor* locked_queryGroupMsgs(const RsGxsGroupId& grpId, const std::list<std::string>& columns);
+
+    /*!
+     * Queries the next chunk of messages of msgIds, starting at index start
+     * @param start index of the first message id to query, advanced past the queried ids
+     */
+    RetroCursor* locked_queryMsgChunk(const RsGxsGroupId& grpId, const std::vector<RsGxsMessageId>& msgIds, uint32_t& start, const std::list<std::string>& columns);
+
     /*!
      * Creates an sql database and its associated file
      * also creates the message and groups table
@@ -338,6 +379,26 @@ private:
     bool locked_removeMessageEntries(const GxsMsgReq& msgIds);
     bool locked_removeGroupEntries(const std::vector<RsGxsGroupId>& grpIds);
 
+    /*!
+     * Thread index. Each message stores the id of the first message of its
+     * thread, and the THREADS table keeps the activity of each thread. Both are
+     * updated when messages are stored or removed, whatever the order in which
+     * messages arrive.
+     */
+    bool locked_createThreadIndex();
+    bool locked_rebuildThreadIndex();
+
+    /*!
+     * @return the thread root of a message to be stored, from the thread root
+     * of its parent (or of the message it is a new version of)
+     */
+    std::string locked_computeThreadRoot(const RsGxsMsgMetaData& meta);
+    bool locked_getThreadRoot(const std::string& msgId, std::string& threadRoot);
+
+    void locked_addToThreadIndex(const std::string& grpId, const std::string& msgId, const std::string& threadRoot, rstime_t ts);
+    void locked_removeFromThreadIndex(const std::string& grpId, const std::string& msgId, std::set<std::string>& threadRoots);
+    void locked_updateThreadActivity(const std::string& grpId, const std::string& threadRoot);
+
 private:
     /*!
      * Start release update
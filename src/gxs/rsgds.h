@@ -68,6 +68,26 @@ struct GrpLocMetaData {
     ContentValue val;
 };
 
+/*!
+ * Progress of the message sync of a group with one peer, and the measured
+ * performance of the link for it.
+ */
+struct RsGroupPeerSyncStats
+{
+	RsGroupPeerSyncStats() :
+	    mPendingMsgs(0), mRequestedMsgs(0), mReceivedMsgs(0), mReceivedBytes(0),
+	    mInFlightRequests(0), mWindowSize(0), mRtt(0), mThroughput(0) {}
+
+	uint32_t mPendingMsgs;		// missing messages that are not requested yet
+	uint32_t mRequestedMsgs;	// requested messages that did not arrive yet
+	uint32_t mReceivedMsgs;
+	uint64_t mReceivedBytes;
+	uint32_t mInFlightRequests;	// request transactions waiting for an answer
+	uint32_t mWindowSize;		// max number of request transactions in flight
+	double   mRtt;				// smallest time between a request and its answer, in seconds
+	double   mThroughput;		// in bytes per second
+};
+
 /*!
  * This is used to query network statistics for a given group. This is useful
  * to e.g. show group popularity, or number of visible messages for unsubscribed
@@ -84,6 +104,24 @@ struct RsGroupNetworkStats
 	bool     mGrpAutoSync;
 	bool     mAllowMsgSync;
 	rstime_t   mLastGroupModificationTS;
+
+	std::map<RsPeerId,RsGroupPeerSyncStats> mPeerSyncStats;	// peers we recently requested messages of this group to
+};
+
+/*!
+ * A thread of messages in a group. A thread gathers a message without parent,
+ * its new versions and all their replies. Replies which parent is missing are
+ * gathered into a thread which id is the id of the oldest missing message.
+ */
+struct RsGxsThreadInfo
+{
+	RsGxsThreadInfo() : mLastActivity(0), mMsgCount(0) {}
+
+	RsGxsMessageId mThreadId;		// id of the first message of the thread, which may be missing
+	rstime_t       mLastActivity;	// most recent publish time of the messages in the thread
+	uint32_t       mMsgCount;
+
+	std::vector<std::shared_ptr<RsGxsMsgMetaData> > mTopMsgs;	// messages of the thread that have no parent: the first message and its versions
 };
 
 typedef std::map<RsGxsGroupId,      std::vector<RsNxsMsg*> > NxsMsgDataResult;
@@ -204,6 +242,37 @@ public:
      */
     virtual int retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std_set& msgId) = 0;
 
+    /*!
+     * Retrieves a page of the threads of a group, most recently active first
+     * @param grpId group of the threads
+     * @param offset number of threads to skip
+     * @param limit max number of threads to retrieve
+     * @param threads retrieved threads
+     * @return error code
+     */
+    virtual int retrieveThreads(const RsGxsGroupId& grpId, uint32_t offset, uint32_t limit, std::vector<RsGxsThreadInfo>& threads) = 0;
+
+    /*!
+     * Retrieves meta data of all versions of a message, i.e. the messages linked to it by their orig msg id
+     * @param grpId group of the message
+     * @param msgId id of any version of the message
+     * @param versions meta data of the versions present in store
+     * @return error code
+     */
+    virtual int retrieveMsgVersions(const RsGxsGroupId& grpId, const RsGxsMessageId& msgId, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& versions) = 0;
+
+    /*!
+     * Retrieves a page of the meta data of the replies to the given messages, oldest first.
+     * Messages for which the store has a new version from the same author are skipped.
+     * @param grpId group of the messages
+     * @param parentIds ids of the parent messages, usually the versions of a message
+     * @param offset number of replies to skip
+     * @param limit max number of replies to retrieve
+     * @param children retrieved meta data
+     * @return error code
+     */
+    virtual int retrieveChildMsgMetaData(const RsGxsGroupId& grpId, const std::set<RsGxsMessageId>& parentIds, uint32_t offset, uint32_t limit, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& children) = 0;
+
     /*!
      * @return the cache size set for this RsGeneralDataService in bytes
      */
@@ -22,6 +22,7 @@
  *******************************************************************************/
 #include <unistd.h>
 #include <algorithm>
+#include <functional>
 
 #include "pqi/pqihash.h"
 #include "rsgenexchange.h"
@@ -29,6 +30,7 @@
 #include "util/contentvalue.h"
 #include "util/rsprint.h"
 #include "util/rstime.h"
+#include "util/rsthreadpool.h"
 #include "retroshare/rsgxsflags.h"
 #include "retroshare/rsgxscircles.h"
 #include "retroshare/rsgrouter.h"
@@ -66,6 +68,9 @@ static const uint32_t INDEX_AUTHEN_ADMIN        = 0x00000040; // admin key
 static const uint32_t MSG_CLEANUP_PERIOD     = 60*59; // 59 minutes
 static const uint32_t INTEGRITY_CHECK_PERIOD = 60*31; // 31 minutes
 
+static const uint32_t GXS_MAX_VALIDATION_THREADS         = 4;  // max number of threads checking the signatures of received messages
+static const uint32_t GXS_MIN_ITEMS_PER_VALIDATION_THREAD = 16; // below that, waking up a thread costs more than it saves
+
 #define GXS_MASK "GXS_MASK_HACK"
 
 /*
@@ -3090,23 +3095,70 @@ void RsGenExchange::computeHash(const RsTlvBinaryData& data, RsFileHash& hash)
 	pHash.Complete(hash);
 }
 
+// Runs job(0..nb_items-1) on a few threads of the shared pool, or on the calling thread for small batches, where
+// waking up threads would cost more than it saves. Returns when all items have been processed.
+
+static void processInParallel(uint32_t nb_items,const std::function<void(uint32_t)>& job)
+{
+    RsThreadPool::shared().parallelFor(nb_items,job,GXS_MAX_VALIDATION_THREADS,GXS_MIN_ITEMS_PER_VALIDATION_THREAD) ;
+}
+
 void RsGenExchange::processRecvdMessages()
 {
     std::list<RsGxsMessageId> messages_to_reject ;
     std::set<RsGxsGroupId> grps_with_new_msgs ;	// groups that received new messages, to stamp their server update TS off-mutex below
 
+    // Messages are validated in three steps, so that the expensive part (deserialising metadata and checking
+    // RSA signatures) runs on several threads and without holding mGenMtx:
+    //   - items to deserialise/validate are collected while holding the mutex,
+    //   - the work is done off-mutex by processInParallel(),
+    //   - the results are merged while holding the mutex again, and all validated messages are stored at once.
+    // Pending items stay in mMsgPendingValidate all along. This is safe since only the present method removes
+    // them, and receiveNewMessages() only inserts items that are not already there.
+
+    std::vector<RsNxsMsg*> msgs_to_deserialise ;
+    {
+        RS_STACK_MUTEX(mGenMtx) ;
+
+        if(mMsgPendingValidate.empty())
+            return ;
+#ifdef GEN_EXCH_DEBUG
+        else
+            std::cerr << "processing received messages" << std::endl;
+#endif
+        for(NxsMsgPendingVect::iterator pend_it = mMsgPendingValidate.begin();pend_it != mMsgPendingValidate.end();++pend_it)
+            if(pend_it->second.mItem->metaData == NULL)
+                msgs_to_deserialise.push_back(pend_it->second.mItem) ;
+    }
+
+    // 1 - Make sure items metadata is deserialised.
+
+    processInParallel(msgs_to_deserialise.size(),[&msgs_to_deserialise](uint32_t i)
+    {
+        RsNxsMsg *msg = msgs_to_deserialise[i] ;
+        RsGxsMsgMetaData* meta = new RsGxsMsgMetaData();
+
+        if(msg->meta.bin_len != 0 && meta->deserialise(msg->meta.bin_data, &(msg->meta.bin_len)))
+            msg->metaData = meta;
+        else
+            delete meta;
+    });
+
+    struct MsgValidationItem
+    {
+        RsNxsMsg *msg ;
+        std::shared_ptr<RsGxsGrpMetaData> grpMeta ;
+        RsTlvSecurityKeySet keys ;
+        int result ;
+    };
+    std::vector<MsgValidationItem> msgs_to_validate ;
+
     {
 	    RS_STACK_MUTEX(mGenMtx) ;
 
         rstime_t now = time(NULL);
 
-	    if(mMsgPendingValidate.empty())
-			return ;
-#ifdef GEN_EXCH_DEBUG
-		else
-		    std::cerr << "processing received messages" << std::endl;
-#endif
-		// 1 - First, make sure items metadata is deserialised, clean old failed items, and collect the groups Ids we have to check
+		// 2 - Clean old failed items, and collect the groups Ids we have to check
 
 		RsGxsGrpMetaTemporaryMap grpMetas;
 
@@ -3115,11 +3167,13 @@ void RsGenExchange::processRecvdMessages()
 		    GxsPendingItem<RsNxsMsg*, RsGxsGrpMsgIdPair>& gpsi = pend_it->second;
 			RsNxsMsg *msg = gpsi.mItem ;
 
-			if(msg->metaData == NULL)
+			// Items received while the metadata was deserialised off-mutex. There are usually very few of them.
+
+			if(msg->metaData == NULL && msg->meta.bin_len != 0)
 			{
 				RsGxsMsgMetaData* meta = new RsGxsMsgMetaData();
 
-				if(msg->meta.bin_len != 0 && meta->deserialise(msg->meta.bin_data, &(msg->meta.bin_len)))
+				if(meta->deserialise(msg->meta.bin_data, &(msg->meta.bin_len)))
 					msg->metaData = meta;
 				else
 					delete meta;
@@ -3128,7 +3182,7 @@ void RsGenExchange::processRecvdMessages()
 			bool accept_new_msg = msg->metaData != NULL && acceptNewMessage(msg->metaData,msg->msg.bin_len);
 
 			if(!accept_new_msg)
-				messages_to_reject.push_back(msg->metaData->mMsgId); // This prevents reloading the message again at next sync.
+				messages_to_reject.push_back(msg->msgId); // This prevents reloading the message again at next sync.
 
 		    if(!accept_new_msg || gpsi.mFirstTryTS + VALIDATE_MAX_WAITING_TIME < now)
 		    {
@@ -3146,12 +3200,51 @@ void RsGenExchange::processRecvdMessages()
 		    }
 	    }
 
-		// 2 - Retrieve the metadata for the associated groups. The test is here to avoid the default behavior to
+		// 3 - Retrieve the metadata for the associated groups. The test is here to avoid the default behavior to
 		//     retrieve all groups when the list is empty
 
 		if(!grpMetas.empty())
 			mDataStore->retrieveGxsGrpMetaData(grpMetas);
 
+	    for(NxsMsgPendingVect::iterator pend_it = mMsgPendingValidate.begin();pend_it != mMsgPendingValidate.end();++pend_it)
+	    {
+		    RsNxsMsg* msg = pend_it->second.mItem;
+
+			if(msg->metaData == NULL)
+				continue ;
+
+            auto mit = grpMetas.find(msg->grpId);
+
+			if(mit == grpMetas.end())
+			{
+				std::cerr << "RsGenExchange::processRecvdMessages(): impossible situation: grp meta " << msg->grpId << " not available." << std::endl;
+				continue ;
+			}
+
+			MsgValidationItem v ;
+			v.msg = msg ;
+			v.grpMeta = mit->second ;
+			v.keys = mit->second->keys ;
+			v.result = VALIDATE_FAIL_TRY_LATER ;
+
+			GxsSecurity::createPublicKeysFromPrivateKeys(v.keys);	// make sure we have the public keys that correspond to the private ones, as it happens. Most of the time this call does nothing.
+
+			msgs_to_validate.push_back(v) ;
+	    }
+    }
+
+    // 4 - Validate each message. validateMsg() only relies on GxsSecurity and on the identity service, which are
+    //     both thread safe.
+
+    processInParallel(msgs_to_validate.size(),[this,&msgs_to_validate](uint32_t i)
+    {
+        MsgValidationItem& v(msgs_to_validate[i]) ;
+        v.result = validateMsg(v.msg, v.grpMeta->mGroupFlags, v.grpMeta->mSignFlags, v.keys);
+    });
+
+    {
+	    RS_STACK_MUTEX(mGenMtx) ;
+
 	    GxsMsgReq msgIds;
         std::list<RsNxsMsg*> msgs_to_store;
         std::map<RsGxsGroupId,time_t> groups_last_post_update;
@@ -3160,11 +3253,13 @@ void RsGenExchange::processRecvdMessages()
 	    std::cerr << "  updating received messages:" << std::endl;
 #endif
 
-		// 3 - Validate each message
+		// 5 - Merge the validation results
 
-	    for(NxsMsgPendingVect::iterator pend_it = mMsgPendingValidate.begin();pend_it != mMsgPendingValidate.end();)
+	    for(uint32_t i=0;i<msgs_to_validate.size();++i)
 	    {
-		    RsNxsMsg* msg = pend_it->second.mItem;
+		    RsNxsMsg* msg = msgs_to_validate[i].msg;
+            const auto& grpMeta = msgs_to_validate[i].grpMeta;
+			int validateReturn = msgs_to_validate[i].result;
 
             // (cyril) Normally we should discard posts that are older than the sync request. But that causes a problem because
             // 	RsGxsNetService requests posts to sync by chunks of 20. So if the 20 are discarded, they will be re-synced next time, and the sync process
@@ -3179,35 +3274,19 @@ void RsGenExchange::processRecvdMessages()
 			//      }
 
 #ifdef GEN_EXCH_DEBUG
-		    std::cerr << "    deserialised info: grp id=" << msg->grpId << ", msg id=" << msg->msgId ;
-#endif
-            auto mit = grpMetas.find(msg->grpId);
-
-#ifdef GEN_EXCH_DEBUG
-			    std::cerr << "    msg info         : grp id=" << msg->grpId << ", msg id=" << msg->msgId << std::endl;
-#endif
-			// validate msg
-
-			if(mit == grpMetas.end())
-			{
-				std::cerr << "RsGenExchange::processRecvdMessages(): impossible situation: grp meta " << msg->grpId << " not available." << std::endl;
-				++pend_it ;
-				continue ;
-			}
-
-            const auto& grpMeta = mit->second;
-			RsTlvSecurityKeySet keys = grpMeta->keys ;
-
-			GxsSecurity::createPublicKeysFromPrivateKeys(keys);	// make sure we have the public keys that correspond to the private ones, as it happens. Most of the time this call does nothing.
-
-			int validateReturn = validateMsg(msg, grpMeta->mGroupFlags, grpMeta->mSignFlags, keys);
-
-#ifdef GEN_EXCH_DEBUG
+			std::cerr << "    msg info         : grp id=" << msg->grpId << ", msg id=" << msg->msgId << std::endl;
 			std::cerr << "    grpMeta.mSignFlags: " << std::hex << grpMeta->mSignFlags << std::dec << std::endl;
 			std::cerr << "    grpMeta.mAuthFlags: " << std::hex << grpMeta->mAuthenFlags << std::dec << std::endl;
 			std::cerr << "    message validation result: " << (int)validateReturn << std::endl;
 #endif
 
+			if(validateReturn == VALIDATE_FAIL_TRY_LATER)
+				continue;
+
+			// Remove the entry from mMsgPendingValidate, but do not delete msg since it's either pushed into msg_to_store or deleted in the FAIL case!
+
+			mMsgPendingValidate.erase(msg->msgId) ;
+
 			if(validateReturn == VALIDATE_SUCCESS)
 			{
 				msg->metaData->mMsgStatus = GXS_SERV::GXS_MSG_STATUS_UNPROCESSED | GXS_SERV::GXS_MSG_STATUS_GUI_NEW | GXS_SERV::GXS_MSG_STATUS_GUI_UNREAD;
@@ -3235,7 +3314,7 @@ void RsGenExchange::processRecvdMessages()
 				if(!msg->metaData->mAuthorId.isNull())
 					mRoutingClues[msg->metaData->mAuthorId].insert(msg->PeerId()) ;
 			}
-			else if(validateReturn == VALIDATE_FAIL)
+			else
 			{
 				// In this case, we notify the network exchange service not to DL the message again, at least not yet.
 
@@ -3246,18 +3325,6 @@ void RsGenExchange::processRecvdMessages()
 				messages_to_reject.push_back(msg->msgId) ;
 				delete msg ;
 			}
-			else if(validateReturn == VALIDATE_FAIL_TRY_LATER)
-			{
-				++pend_it ;
-				continue;
-			}
-
-			// Remove the entry from mMsgPendingValidate, but do not delete msg since it's either pushed into msg_to_store or deleted in the FAIL case!
-
-			NxsMsgPendingVect::iterator tmp = pend_it ;
-			++tmp ;
-			mMsgPendingValidate.erase(pend_it) ;
-			pend_it = tmp ;
 	    }
 
 	    if(!msgIds.empty())
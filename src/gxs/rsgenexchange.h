@@ -892,6 +892,7 @@ private:
      * @param grpKeySet the key set user has for the message's group
      * @return VALIDATE_SUCCESS for success, VALIDATE_FAIL for fail,
      * 		   VALIDATE_ID_SIGN_NOT_AVAIL for Id sign key not avail (but requested)
+     * Called from several threads at once, without holding mGenMtx.
      */
     int validateMsg(RsNxsMsg* msg, const uint32_t& grpFlag, const uint32_t &signFlag, RsTlvSecurityKeySet& grpKeySet);
 
@@ -0,0 +1,211 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxsiblt.cc                                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <string.h>
+#include <algorithm>
+
+#include "gxs/rsgxsiblt.h"
+#include "serialiser/rsbaseserial.h"
+
+static const uint32_t IBLT_EXTRA_CELLS = 32;	// small differences need proportionally more cells
+
+RsGxsMsgIdIblt::RsGxsMsgIdIblt(uint32_t nb_cells, uint32_t salt)
+	: mSalt(salt)
+{
+	// one part of the table per hash function
+
+	nb_cells = std::max(nb_cells, NB_HASHES);
+	mCells.resize(nb_cells - nb_cells % NB_HASHES);
+}
+
+uint32_t RsGxsMsgIdIblt::cellsForDifference(uint32_t nb_differences)
+{
+	return nb_differences + nb_differences/2 + IBLT_EXTRA_CELLS;
+}
+
+uint64_t RsGxsMsgIdIblt::hashId(const RsGxsMessageId& id, uint64_t seed)
+{
+	// Message ids are already hashes, so that mixing them with the seed is enough.
+
+	uint64_t h = seed;
+
+	for(uint32_t i=0;i<RsGxsMessageId::SIZE_IN_BYTES;++i)
+		h = (h ^ id.toByteArray()[i]) * 0x100000001b3ull;
+
+	h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ull;
+	h ^= h >> 27; h *= 0x94d049bb133111ebull;
+	h ^= h >> 31;
+
+	return h;
+}
+
+uint32_t RsGxsMsgIdIblt::cellIndex(const RsGxsMessageId& id, uint32_t n) const
+{
+	uint32_t part = mCells.size() / NB_HASHES;
+
+	return n*part + hashId(id, (uint64_t(mSalt) << 8) + n) % part;
+}
+
+uint32_t RsGxsMsgIdIblt::checkHash(const RsGxsMessageId& id) const
+{
+	return (uint32_t)hashId(id, (uint64_t(mSalt) << 8) + NB_HASHES);
+}
+
+void RsGxsMsgIdIblt::update(const RsGxsMessageId& id, int32_t delta)
+{
+	uint32_t h = checkHash(id);
+
+	for(uint32_t n=0;n<NB_HASHES;++n)
+	{
+		Cell& c(mCells[cellIndex(id,n)]);
+
+		c.count += delta;
+		c.keySum = c.keySum ^ id;
+		c.hashSum ^= h;
+	}
+}
+
+void RsGxsMsgIdIblt::insert(const RsGxsMessageId& id) { update(id, 1); }
+void RsGxsMsgIdIblt::remove(const RsGxsMessageId& id) { update(id,-1); }
+
+bool RsGxsMsgIdIblt::subtract(const RsGxsMsgIdIblt& other)
+{
+	if(other.mCells.size() != mCells.size() || other.mSalt != mSalt)
+		return false;
+
+	for(uint32_t i=0;i<mCells.size();++i)
+	{
+		mCells[i].count -= other.mCells[i].count;
+		mCells[i].keySum = mCells[i].keySum ^ other.mCells[i].keySum;
+		mCells[i].hashSum ^= other.mCells[i].hashSum;
+	}
+	return true;
+}
+
+bool RsGxsMsgIdIblt::isPure(const Cell& c) const
+{
+	return (c.count == 1 || c.count == -1) && c.hashSum == checkHash(c.keySum);
+}
+
+bool RsGxsMsgIdIblt::decode(std::set<RsGxsMessageId>& only_here, std::set<RsGxsMessageId>& only_there) const
+{
+	RsGxsMsgIdIblt tmp(*this);
+	std::vector<uint32_t> pure;
+
+	for(uint32_t i=0;i<tmp.mCells.size();++i)
+		if(tmp.isPure(tmp.mCells[i]))
+			pure.push_back(i);
+
+	// Peel pure cells one by one. Removing an id from the table may make other cells pure.
+	// The table may come from a remote peer, which can craft cells that would be peeled forever. An id
+	// is only peeled from one of its own cells, and only once. There cannot be more ids than cells.
+
+	uint32_t part = tmp.mCells.size() / NB_HASHES;
+	uint32_t nb_peeled = 0;
+
+	while(!pure.empty())
+	{
+		uint32_t i = pure.back();
+		pure.pop_back();
+
+		if(!tmp.isPure(tmp.mCells[i]))	// already peeled through another cell
+			continue;
+
+		RsGxsMessageId id = tmp.mCells[i].keySum;
+		int32_t count = tmp.mCells[i].count;
+
+		if(tmp.cellIndex(id, i / part) != i)	// not a cell of that id, so not really pure
+			continue;
+
+		if(only_here.find(id) != only_here.end() || only_there.find(id) != only_there.end() || ++nb_peeled > tmp.mCells.size())
+			return false;
+
+		if(count > 0)
+			only_here.insert(id);
+		else
+			only_there.insert(id);
+
+		tmp.update(id, -count);
+
+		for(uint32_t n=0;n<NB_HASHES;++n)
+		{
+			uint32_t j = tmp.cellIndex(id,n);
+
+			if(tmp.isPure(tmp.mCells[j]))
+				pure.push_back(j);
+		}
+	}
+
+	for(uint32_t i=0;i<tmp.mCells.size();++i)
+		if(tmp.mCells[i].count != 0 || tmp.mCells[i].hashSum != 0 || !tmp.mCells[i].keySum.isNull())
+			return false;
+
+	return true;
+}
+
+bool RsGxsMsgIdIblt::serialise(RsTlvBinaryData& data) const
+{
+	uint32_t size = mCells.size() * CELL_SIZE;
+	std::vector<uint8_t> mem(size);
+	uint32_t offset = 0;
+
+	for(uint32_t i=0;i<mCells.size();++i)
+	{
+		bool ok = setRawUInt32(mem.data(), size, &offset, (uint32_t)mCells[i].count);
+
+		memcpy(mem.data() + offset, mCells[i].keySum.toByteArray(), RsGxsMessageId::SIZE_IN_BYTES);
+		offset += RsGxsMessageId::SIZE_IN_BYTES;
+
+		ok = ok && setRawUInt32(mem.data(), size, &offset, mCells[i].hashSum);
+
+		if(!ok)
+			return false;
+	}
+	return data.setBinData(mem.data(), size);
+}
+
+bool RsGxsMsgIdIblt::deserialise(const RsTlvBinaryData& data, uint32_t salt, RsGxsMsgIdIblt& iblt)
+{
+	if(data.bin_len == 0 || data.bin_len % CELL_SIZE != 0 || (data.bin_len / CELL_SIZE) % NB_HASHES != 0)
+		return false;
+
+	iblt = RsGxsMsgIdIblt(data.bin_len / CELL_SIZE, salt);
+
+	const uint8_t *mem = static_cast<const uint8_t*>(data.bin_data);
+	uint32_t offset = 0;
+
+	for(uint32_t i=0;i<iblt.mCells.size();++i)
+	{
+		uint32_t count = 0;
+		bool ok = getRawUInt32(mem, data.bin_len, &offset, &count);
+
+		iblt.mCells[i].count = (int32_t)count;
+		iblt.mCells[i].keySum = RsGxsMessageId::fromBufferUnsafe(mem + offset);
+		offset += RsGxsMessageId::SIZE_IN_BYTES;
+
+		ok = ok && getRawUInt32(mem, data.bin_len, &offset, &iblt.mCells[i].hashSum);
+
+		if(!ok)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxsiblt.h                                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <set>
+#include <vector>
+#include <stdint.h>
+
+#include "retroshare/rsids.h"
+#include "serialiser/rstlvbinary.h"
+
+/*!
+ * \brief The RsGxsMsgIdIblt class
+ * 		Invertible Bloom lookup table over message ids, used to reconcile the
+ * 		message lists of two peers while only exchanging a table whose size
+ * 		depends on the number of differences, not on the size of the lists.
+ *
+ * 		Each id is added to NB_HASHES cells, one in each of the NB_HASHES parts of the table.
+ * 		Subtracting the table of the other side leaves the symmetric difference,
+ * 		which decode() lists as long as the table is large enough, i.e. roughly
+ * 		1.5 times the number of differences, plus a few cells.
+ *
+ * 		Both tables must have the same size and salt to be subtracted. The salt
+ * 		is chosen by the side that builds the first table, so that the cells
+ * 		used by an id cannot be predicted in advance.
+ */
+class RsGxsMsgIdIblt
+{
+public:
+	static const uint32_t NB_HASHES = 4;
+
+	/// Size of a serialised cell, in bytes.
+	static const uint32_t CELL_SIZE = 4 + RsGxsMessageId::SIZE_IN_BYTES + 4;
+
+	RsGxsMsgIdIblt(uint32_t nb_cells, uint32_t salt);
+
+	void insert(const RsGxsMessageId& id);
+	void remove(const RsGxsMessageId& id);
+
+	/// Removes the content of other from this table. Returns false if the tables are not compatible.
+	bool subtract(const RsGxsMsgIdIblt& other);
+
+	/*!
+	 * \brief decode
+	 * 			Lists the ids left in the table, which is not modified.
+	 * \param only_here  ids that were inserted (or are left after subtract) here
+	 * \param only_there ids that were removed (or were in the subtracted table only)
+	 * \return false if the table is too small for the number of ids it contains. The sets are then incomplete.
+	 */
+	bool decode(std::set<RsGxsMessageId>& only_here, std::set<RsGxsMessageId>& only_there) const;
+
+	uint32_t nbCells() const { return mCells.size(); }
+	uint32_t salt() const { return mSalt; }
+
+	bool serialise(RsTlvBinaryData& data) const;
+	static bool deserialise(const RsTlvBinaryData& data, uint32_t salt, RsGxsMsgIdIblt& iblt);
+
+	/// Number of cells needed to decode nb_differences ids with a high probability.
+	static uint32_t cellsForDifference(uint32_t nb_differences);
+
+private:
+	struct Cell
+	{
+		Cell() : count(0), hashSum(0) {}
+
+		int32_t count;
+		RsGxsMessageId keySum;
+		uint32_t hashSum;
+	};
+
+	void update(const RsGxsMessageId& id, int32_t delta);
+	uint32_t cellIndex(const RsGxsMessageId& id, uint32_t n) const;
+	uint32_t checkHash(const RsGxsMessageId& id) const;
+	bool isPure(const Cell& c) const;
+
+	static uint64_t hashId(const RsGxsMessageId& id, uint64_t seed);
+
+	std::vector<Cell> mCells;
+	uint32_t mSalt;
+};
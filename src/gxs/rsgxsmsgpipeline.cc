@@ -0,0 +1,219 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxsmsgpipeline.cc                                  *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <math.h>
+#include <set>
+#include <algorithm>
+
+#include "gxs/rsgxsmsgpipeline.h"
+#include "gxs/rsgds.h"
+
+static const double MIN_REQUEST_TIMEOUT = 120.0;	// seconds before a received request without answer is dropped
+static const double MIN_MEASURE_TIME    = 0.001;	// shortest time used to measure the throughput
+static const double EWMA_FACTOR         = 0.25;		// weight of new samples in the throughput and request size averages
+
+const uint32_t RsGxsMsgRequestPipeline::INITIAL_WINDOW;
+const uint32_t RsGxsMsgRequestPipeline::MAX_WINDOW;
+const uint32_t RsGxsMsgRequestPipeline::MAX_LOST_REQUESTS;
+
+RsGxsMsgRequestPipeline::RsGxsMsgRequestPipeline()
+	: mWindow(INITIAL_WINDOW), mMinRtt(0), mThroughput(0), mAvgRequestBytes(0),
+	  mLastAnswerTime(0), mLastActivity(0), mLostRequests(0), mIncomplete(false),
+	  mListTS(0), mListSize(0), mReceivedMsgs(0), mReceivedBytes(0)
+{
+}
+
+void RsGxsMsgRequestPipeline::setMissingMsgs(const std::list<RsGxsMessageId>& ids, rstime_t list_ts, uint32_t list_size)
+{
+	std::set<RsGxsMessageId> requested;
+
+	for(std::list<Request>::const_iterator it(mInFlight.begin());it!=mInFlight.end();++it)
+		requested.insert(it->ids.begin(), it->ids.end());
+
+	mPending.clear();
+	mLostRequests = 0;
+	mIncomplete = false;
+	mListTS = list_ts;
+	mListSize = list_size;
+
+	for(std::list<RsGxsMessageId>::const_iterator it(ids.begin());it!=ids.end();++it)
+		if(requested.find(*it) == requested.end())
+			mPending.push_back(*it);
+}
+
+bool RsGxsMsgRequestPipeline::nextRequest(uint32_t transN, double now, uint32_t max_size, std::vector<RsGxsMessageId>& ids)
+{
+	ids.clear();
+
+	if(!canRequest())
+		return false;
+
+	mInFlight.push_back(Request());
+	Request& req(mInFlight.back());
+
+	req.transN = transN;
+	req.sendTime = now;
+	req.delivered = false;
+
+	while(!mPending.empty() && req.ids.size() < max_size)
+	{
+		req.ids.push_back(mPending.front());
+		mPending.pop_front();
+	}
+
+	ids = req.ids;
+	mLastActivity = now;
+
+	return true;
+}
+
+bool RsGxsMsgRequestPipeline::requestAnswered(const std::vector<RsGxsMessageId>& ids, uint64_t bytes, double now)
+{
+	if(ids.empty())
+		return false;
+
+	// The peer answers each request with one transaction, that holds the messages it has among the ones requested.
+
+	std::list<Request>::iterator it;
+
+	for(it = mInFlight.begin(); it != mInFlight.end(); ++it)
+		if(std::find(it->ids.begin(), it->ids.end(), ids.front()) != it->ids.end())
+			break;
+
+	if(it == mInFlight.end())
+		return false;
+
+	double rtt = std::max(now - it->sendTime, MIN_MEASURE_TIME);
+
+	// Only count the time the link was busy with this request: the time since the previous answer, if it came after the request was sent.
+
+	double busy_time = std::max(now - std::max(it->sendTime, mLastAnswerTime), MIN_MEASURE_TIME);
+	double rate = bytes / busy_time;
+
+	mMinRtt          = (mMinRtt > 0)          ? std::min(mMinRtt, rtt) : rtt;
+	mThroughput      = (mThroughput > 0)      ? (1-EWMA_FACTOR)*mThroughput + EWMA_FACTOR*rate : rate;
+	mAvgRequestBytes = (mAvgRequestBytes > 0) ? (1-EWMA_FACTOR)*mAvgRequestBytes + EWMA_FACTOR*bytes : bytes;
+
+	if(mAvgRequestBytes > 0)
+	{
+		double bdp = mThroughput * mMinRtt / mAvgRequestBytes;
+
+		mWindow = std::min((double)MAX_WINDOW, ceil(bdp) + 1);
+	}
+
+	mReceivedMsgs += ids.size();
+	mReceivedBytes += bytes;
+	mLastAnswerTime = now;
+	mLastActivity = now;
+	mLostRequests = 0;
+
+	mInFlight.erase(it);
+	return true;
+}
+
+void RsGxsMsgRequestPipeline::requestLost(std::list<Request>::iterator it)
+{
+	// Request the messages again first, with a smaller window, as the link is probably slower than expected.
+	// When the request transactions keep failing, give up: the peer's time stamp is not updated, so the next sync will list the messages again.
+
+	if(++mLostRequests < MAX_LOST_REQUESTS)
+		mPending.insert(mPending.begin(), it->ids.begin(), it->ids.end());
+	else
+	{
+		mPending.clear();
+		mIncomplete = true;
+	}
+
+	mInFlight.erase(it);
+
+	mWindow = std::max(1u, mWindow/2);
+}
+
+bool RsGxsMsgRequestPipeline::requestFailed(uint32_t transN)
+{
+	for(std::list<Request>::iterator it(mInFlight.begin());it!=mInFlight.end();++it)
+		if(it->transN == transN)
+		{
+			requestLost(it);
+			return true;
+		}
+
+	return false;
+}
+
+bool RsGxsMsgRequestPipeline::requestDelivered(uint32_t transN)
+{
+	for(std::list<Request>::iterator it(mInFlight.begin());it!=mInFlight.end();++it)
+		if(it->transN == transN)
+		{
+			it->delivered = true;
+			return true;
+		}
+
+	return false;
+}
+
+double RsGxsMsgRequestPipeline::requestTimeout() const
+{
+	if(mThroughput <= 0)
+		return MIN_REQUEST_TIMEOUT;
+
+	// A request waits for the ones before it to be answered.
+
+	return std::max(MIN_REQUEST_TIMEOUT, 4 * (mMinRtt + mWindow * mAvgRequestBytes / mThroughput));
+}
+
+uint32_t RsGxsMsgRequestPipeline::expireRequests(double now)
+{
+	double timeout = requestTimeout();
+	uint32_t n = 0;
+
+	// This is not a sign of a slow link, so that the window is kept.
+
+	for(std::list<Request>::iterator it(mInFlight.begin());it!=mInFlight.end();)
+		if(it->delivered && it->sendTime + timeout < now)
+		{
+			it = mInFlight.erase(it);
+			mLastActivity = now;
+			++n;
+		}
+		else
+			++it;
+
+	return n;
+}
+
+void RsGxsMsgRequestPipeline::getStats(RsGroupPeerSyncStats& stats) const
+{
+	stats.mPendingMsgs = mPending.size();
+	stats.mRequestedMsgs = 0;
+
+	for(std::list<Request>::const_iterator it(mInFlight.begin());it!=mInFlight.end();++it)
+		stats.mRequestedMsgs += it->ids.size();
+
+	stats.mReceivedMsgs = mReceivedMsgs;
+	stats.mReceivedBytes = mReceivedBytes;
+	stats.mInFlightRequests = mInFlight.size();
+	stats.mWindowSize = mWindow;
+	stats.mRtt = mMinRtt;
+	stats.mThroughput = mThroughput;
+}
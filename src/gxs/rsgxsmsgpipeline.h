@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * libretroshare/src/gxs: rsgxsmsgpipeline.h                                   *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#include "retroshare/rsids.h"
+#include "util/rstime.h"
+
+struct RsGroupPeerSyncStats;
+
+/*!
+ * \brief The RsGxsMsgRequestPipeline class
+ * 		Message requests sent to one peer for one group. The missing messages are
+ * 		requested by transactions of a limited size, several of which are kept in
+ * 		flight, so that a group with many new messages does not need one sync
+ * 		period, or one round trip, per transaction.
+ *
+ * 		The number of transactions in flight (the window) follows the bandwidth-delay
+ * 		product of the link: the measured throughput times the smallest measured
+ * 		round trip time, in units of the average request size, plus one so that the
+ * 		link stays busy while the next request travels. When the link is not saturated,
+ * 		each answer makes the measured throughput, and so the window, grow.
+ *
+ * 		The peer answers a request with the messages it has among the requested ones,
+ * 		and does not answer at all when it has none of them. A request is therefore
+ * 		only considered lost when its transaction fails. A request the peer received
+ * 		but did not answer is dropped, and its messages are not requested again.
+ *
+ * 		Times are in seconds, and given by the caller.
+ */
+class RsGxsMsgRequestPipeline
+{
+public:
+	static const uint32_t INITIAL_WINDOW = 2;
+	static const uint32_t MAX_WINDOW = 16;
+	static const uint32_t MAX_LOST_REQUESTS = 4;	// consecutive lost requests before the remaining messages are left to the next sync
+
+	RsGxsMsgRequestPipeline();
+
+	/*!
+	 * \brief setMissingMsgs
+	 * 			Sets the messages that still need to be requested. Messages that are already requested are skipped.
+	 * \param list_ts  time stamp of the msg list of the peer the messages come from
+	 * \param list_size number of messages in that list
+	 */
+	void setMissingMsgs(const std::list<RsGxsMessageId>& ids, rstime_t list_ts = 0, uint32_t list_size = 0);
+
+	/// True if the window allows another request, and there are messages to request.
+	bool canRequest() const { return !mPending.empty() && mInFlight.size() < mWindow; }
+
+	/*!
+	 * \brief nextRequest
+	 * 			Takes the next messages to request, if the window allows another request.
+	 * \param transN   transaction number of the request, used to report failures
+	 * \param max_size max number of messages in the request
+	 * \return false if nothing should be requested now
+	 */
+	bool nextRequest(uint32_t transN, double now, uint32_t max_size, std::vector<RsGxsMessageId>& ids);
+
+	/// Records the answer to one of the requests. Returns false if the messages do not answer any request.
+	bool requestAnswered(const std::vector<RsGxsMessageId>& ids, uint64_t bytes, double now);
+
+	/// Called when a request transaction failed. Its messages will be requested again. Returns false if it is not one of ours.
+	bool requestFailed(uint32_t transN);
+
+	/// Called when the peer received a request transaction. Returns false if it is not one of ours.
+	bool requestDelivered(uint32_t transN);
+
+	/*!
+	 * \brief expireRequests
+	 * 			Drops the requests the peer received but did not answer in time, since it has none of their messages.
+	 * 			Requests the peer did not receive are left to their transaction, which either completes or fails.
+	 * \return the number of requests dropped
+	 */
+	uint32_t expireRequests(double now);
+
+	bool finished() const { return mPending.empty() && mInFlight.empty(); }
+
+	/// True when some of the missing messages were given up on, and need to be listed again by the next sync.
+	bool incomplete() const { return mIncomplete; }
+
+	uint32_t window() const { return mWindow; }
+	double rtt() const { return mMinRtt; }
+	double throughput() const { return mThroughput; }
+	double lastActivity() const { return mLastActivity; }
+	rstime_t listTimeStamp() const { return mListTS; }
+	uint32_t listSize() const { return mListSize; }
+
+	/// Time after which a request is considered lost.
+	double requestTimeout() const;
+
+	void getStats(RsGroupPeerSyncStats& stats) const;
+
+private:
+	struct Request
+	{
+		uint32_t transN;
+		double sendTime;
+		bool delivered;
+		std::vector<RsGxsMessageId> ids;
+	};
+
+	void requestLost(std::list<Request>::iterator it);
+
+	std::list<RsGxsMessageId> mPending;
+	std::list<Request> mInFlight;
+
+	uint32_t mWindow;
+	double mMinRtt;				// 0 until measured
+	double mThroughput;			// bytes per second, 0 until measured
+	double mAvgRequestBytes;
+	double mLastAnswerTime;
+	double mLastActivity;
+	uint32_t mLostRequests;
+	bool mIncomplete;
+	rstime_t mListTS;
+	uint32_t mListSize;
+
+	uint32_t mReceivedMsgs;
+	uint64_t mReceivedBytes;
+};
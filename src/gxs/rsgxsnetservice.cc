@@ -247,6 +247,7 @@
 
 #include "rsgxsnetservice.h"
 #include "gxssecurity.h"
+#include "rsgxsiblt.h"
 #include "retroshare/rsconfig.h"
 #include "retroshare/rsgxsflags.h"
 #include "retroshare/rsgxscircles.h"
@@ -289,7 +290,8 @@
 
 // The constant below have a direct influence on how fast forums/channels/posted/identity groups propagate and on the overloading of queues:
 //
-// Channels/forums will update at a rate of SYNC_PERIOD*MAX_REQLIST_SIZE/60 messages per minute.
+// Missing messages are requested by lists of MAX_REQLIST_SIZE messages, several of which are kept in flight (see RsGxsMsgRequestPipeline),
+// so channels/forums update at the rate the link allows rather than MAX_REQLIST_SIZE messages per SYNC_PERIOD.
 // A large TRANSAC_TIMEOUT helps large transactions to finish before anything happens (e.g. disconnexion) or when the server has low upload bandwidth,
 // but also uses more memory.
 // A small value for MAX_REQLIST_SIZE is likely to help messages to propagate in a chaotic network, but will also slow them down.
@@ -298,6 +300,9 @@
 //static const uint32_t GIXS_CUT_OFF                            =            0;
 static const uint32_t SYNC_PERIOD                             =           60;
 static const uint32_t MAX_REQLIST_SIZE                        =           20; // No more than 20 items per msg request list => creates smaller transactions that are less likely to be cancelled.
+static const uint32_t MSG_REQUEST_CHECK_PERIOD                =           10; // look for timed out msg requests every 10 secs
+static const double   MSG_REQUEST_STATS_KEEP_DELAY            =         3600; // keep the request statistics of a peer and group for 1 hour after the last request
+static const uint32_t MAX_MSG_ID_IBLT_CELLS                   =         4096; // largest table of msg ids sent instead of a msg list (about 115KB)
 static const uint32_t TRANSAC_TIMEOUT                         =         2000; // In seconds. Has been increased to avoid epidemic transaction cancelling due to overloaded outqueues.
 #ifdef TO_REMOVE
 static const uint32_t SECURITY_DELAY_TO_FORCE_CLIENT_REUPDATE =         3600; // force re-update if there happens to be a large delay between our server side TS and the client side TS of friends
@@ -373,7 +378,7 @@ RsGxsNetService::RsGxsNetService(uint16_t servType, RsGeneralDataService *gds,
                                    mObserver(nxsObs), mDataStore(gds),
                                    mServType(servType), mTransactionTimeOut(TRANSAC_TIMEOUT),
                                    mNetMgr(netMgr), mNxsMutex("RsGxsNetService"),
-                                   mSyncTs(0), mLastKeyPublishTs(0),
+                                   mSyncTs(0), mLastKeyPublishTs(0), mLastMsgRequestCheckTs(0),
                                    mLastCleanRejectedMessages(0), mSYNC_PERIOD(SYNC_PERIOD),
                                    mCircles(circles), mGixs(gixs),
                                    mReputations(reputations), mPgpUtils(pgpUtils), mGxsNetTunnel(mGxsNT),
@@ -408,6 +413,7 @@ void RsGxsNetService::getItemNames(std::map<uint8_t,std::string>& names) const
 	names[RS_PKT_SUBTYPE_NXS_SESSION_KEY_ITEM     ] = "Session Key" ;
 	names[RS_PKT_SUBTYPE_NXS_SYNC_MSG_ITEM        ] = "Message Sync" ;
 	names[RS_PKT_SUBTYPE_NXS_SYNC_MSG_REQ_ITEM    ] = "Message Sync Request" ;
+	names[RS_PKT_SUBTYPE_NXS_SYNC_MSG_IBLT_ITEM   ] = "Message Sync Table" ;
 	names[RS_PKT_SUBTYPE_NXS_MSG_ITEM             ] = "Message Data" ;
 	names[RS_PKT_SUBTYPE_NXS_TRANSAC_ITEM         ] = "Transaction" ;
 	names[RS_PKT_SUBTYPE_NXS_GRP_PUBLISH_KEY_ITEM ] = "Publish key" ;
@@ -471,6 +477,13 @@ int RsGxsNetService::tick()
         mLastKeyPublishTs = now ;
     }
 
+    if(now > MSG_REQUEST_CHECK_PERIOD + mLastMsgRequestCheckTs)
+    {
+        checkMsgRequestPipelines() ;
+
+        mLastMsgRequestCheckTs = now ;
+    }
+
     if(now > 3600 + mLastCleanRejectedMessages)
     {
         mLastCleanRejectedMessages = now ;
@@ -725,8 +738,13 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
 			else
 				msg->createdSinceTS = 0 ;
 
+            // Msg ids of circle-restricted groups are always sent encrypted, so that only plain lists are used for these.
+
             if(encrypt_to_this_circle_id.isNull())
+            {
                 msg->grpId = grpId;
+                msg->flag |= RsNxsSyncMsgReqItem::FLAG_USE_MSG_ID_RECONCILIATION ;
+            }
             else
             {
                 msg->grpId = hashGrpId(grpId,mNetMgr->getOwnId()) ;
@@ -1794,6 +1812,7 @@ void RsGxsNetService::recvNxsItemQueue()
             case RS_PKT_SUBTYPE_NXS_SYNC_GRP_STATS_ITEM:    handleRecvSyncGrpStatistics   (dynamic_cast<RsNxsSyncGrpStatsItem*>(ni)) ; break ;
             case RS_PKT_SUBTYPE_NXS_SYNC_GRP_REQ_ITEM:      handleRecvSyncGroup           (dynamic_cast<RsNxsSyncGrpReqItem*>(ni)) ; break ;
             case RS_PKT_SUBTYPE_NXS_SYNC_MSG_REQ_ITEM:      handleRecvSyncMessage         (dynamic_cast<RsNxsSyncMsgReqItem*>(ni),item_was_encrypted) ; break ;
+            case RS_PKT_SUBTYPE_NXS_SYNC_MSG_IBLT_ITEM:     handleRecvSyncMsgIblt         (dynamic_cast<RsNxsSyncMsgIbltItem*>(ni)) ; break ;
             case RS_PKT_SUBTYPE_NXS_GRP_PUBLISH_KEY_ITEM:   handleRecvPublishKeys         (dynamic_cast<RsNxsGroupPublishKeyItem*>(ni)) ; break ;
             case RS_PKT_SUBTYPE_NXS_SYNC_PULL_REQUEST_ITEM: handlePullRequest             (dynamic_cast<RsNxsPullRequestItem*>(ni)) ; break ;
 
@@ -2545,6 +2564,16 @@ bool RsGxsNetService::getGroupNetworkStats(const RsGxsGroupId& gid,RsGroupNetwor
     stats.mGrpAutoSync = !!(mSyncFlags & RsGxsNetServiceSyncFlags::DISCOVER_NEW_GROUPS) ;
     stats.mLastGroupModificationTS = it->second.last_group_modification_TS ;
 
+    stats.mPeerSyncStats.clear();
+
+    for(std::map<RsPeerId, std::map<RsGxsGroupId,RsGxsMsgRequestPipeline> >::const_iterator it2(mMsgRequestPipelines.begin());it2!=mMsgRequestPipelines.end();++it2)
+    {
+        std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>::const_iterator it3 = it2->second.find(gid);
+
+        if(it3 != it2->second.end())
+            it3->second.getStats(stats.mPeerSyncStats[it2->first]);
+    }
+
     return true ;
 }
 
@@ -2740,6 +2769,10 @@ void RsGxsNetService::locked_processCompletedIncomingTrans(NxsTransaction* tr)
             for(uint32_t i=0;i<msgs.size();++i)
                 mNewMessagesToNotify.push_back(msgs[i]) ;
 
+            // request more msgs from this peer if some are still missing. This must be done before updating the time stamp,
+            // which only happens once all missing msgs have been received.
+            locked_msgRequestAnswered(tr->mTransaction->PeerId(), grpId, msgs);
+
             // now note that this is the latest you've received from this peer
             // for the grp id
             locked_doMsgUpdateWork(tr->mTransaction, grpId);
@@ -2816,14 +2849,15 @@ void RsGxsNetService::locked_processCompletedOutgoingTrans(NxsTransaction* tr)
 		    GXSNETDEBUG_P_(nxsTrans->PeerId())<< "  complete Sending Grp Response, transN: " << tr->mTransaction->transactionNumber << std::endl;
 #endif
 	    }
-	    // you've finished sending a request so don't do anything
+	    // you've finished sending a request so don't do anything, but remember that the peer got msg requests
 	    else if( (flag & RsNxsTransacItem::FLAG_TYPE_MSG_LIST_REQ) ||
 	             (flag & RsNxsTransacItem::FLAG_TYPE_GRP_LIST_REQ) )
 	    {
 #ifdef NXS_NET_DEBUG_0
 		    GXSNETDEBUG_P_(nxsTrans->PeerId())<< "  complete Sending Msg/Grp Request, transN: " << tr->mTransaction->transactionNumber << std::endl;
 #endif
-
+		    if(flag & RsNxsTransacItem::FLAG_TYPE_MSG_LIST_REQ)
+			    locked_msgRequestDelivered(tr->mTransaction->transactionNumber);
 	    }else if(flag & RsNxsTransacItem::FLAG_TYPE_GRPS)
 	    {
 
@@ -2841,6 +2875,9 @@ void RsGxsNetService::locked_processCompletedOutgoingTrans(NxsTransaction* tr)
 #ifdef NXS_NET_DEBUG_0
 	    GXSNETDEBUG_P_(nxsTrans->PeerId())<< "  Failed transaction! transN: " << tr->mTransaction->transactionNumber << std::endl;
 #endif
+
+	    if(flag & RsNxsTransacItem::FLAG_TYPE_MSG_LIST_REQ)
+		    locked_msgRequestFailed(tr->mTransaction->transactionNumber);
     }else{
 
 #ifdef NXS_NET_DEBUG_0
@@ -3002,22 +3039,9 @@ void RsGxsNetService::locked_genReqMsgTransaction(NxsTransaction* tr)
 #ifdef NXS_NET_DEBUG_1
     GXSNETDEBUG_PG(item->PeerId(),grpId) << "  grp locally contains " << msgIdSet.size() << " unique messsages." << std::endl;
 #endif
-    // get unique id for this transaction
-    uint32_t transN = locked_getTransactionId();
-
-#ifdef NXS_NET_DEBUG_1
-    GXSNETDEBUG_PG(item->PeerId(),grpId) << "  new transaction ID: " << transN << std::endl;
-#endif
-    // add msgs that you don't have to request list
+    // add msgs that you don't have to request list. They are requested by the request pipeline of this peer and group.
     std::list<RsNxsSyncMsgItem*>::iterator llit = msgItemL.begin();
-    std::list<RsNxsItem*> reqList;
-    int reqListSize = 0 ;
-
-    const RsPeerId peerFrom = tr->mTransaction->PeerId();
-
-    std::list<RsPeerId> peers;
-    peers.push_back(tr->mTransaction->PeerId());
-    bool reqListSizeExceeded = false ;
+    std::list<RsGxsMessageId> missingIds;
 
 #ifdef NXS_NET_DEBUG_1
     GXSNETDEBUG_PG(item->PeerId(),grpId) << "  sorting items..." << std::endl;
@@ -3030,22 +3054,13 @@ void RsGxsNetService::locked_genReqMsgTransaction(NxsTransaction* tr)
 #ifdef NXS_NET_DEBUG_1
         GXSNETDEBUG_PG(item->PeerId(),grpId) << "  msg ID = " << msgId ;
 #endif
-        if(reqListSize >= (int)MAX_REQLIST_SIZE)
-        {
-#ifdef NXS_NET_DEBUG_1
-            GXSNETDEBUG_PG(item->PeerId(),grpId) << ". reqlist too big. Pruning out this item for now." << std::endl;
-#endif
-            reqListSizeExceeded = true ;
-            continue ;	// we should actually break, but we need to print some debug info.
-        }
-
-        if(reqListSize < (int)MAX_REQLIST_SIZE && msgIdSet.find(msgId) == msgIdSet.end())
+        if(msgIdSet.find(msgId) == msgIdSet.end())
         {
 
             bool noAuthor = syncItem->authorId.isNull();
 
 #ifdef NXS_NET_DEBUG_1
-            GXSNETDEBUG_PG(item->PeerId(),grpId) << ", reqlist size=" << reqListSize << ", message not present." ;
+            GXSNETDEBUG_PG(item->PeerId(),grpId) << ", missing list size=" << missingIds.size() << ", message not present." ;
 #endif
             // grp meta must be present if author present
 
@@ -3081,16 +3096,9 @@ void RsGxsNetService::locked_genReqMsgTransaction(NxsTransaction* tr)
             }
 
 #ifdef NXS_NET_DEBUG_1
-			GXSNETDEBUG_PG(item->PeerId(),grpId) << ", passed! Adding message to req list." << std::endl;
+			GXSNETDEBUG_PG(item->PeerId(),grpId) << ", passed! Adding message to missing list." << std::endl;
 #endif
-			RsNxsSyncMsgItem* msgItem = new RsNxsSyncMsgItem(mServType);
-			msgItem->grpId = grpId;
-			msgItem->msgId = msgId;
-			msgItem->flag = RsNxsSyncMsgItem::FLAG_REQUEST;
-			msgItem->transactionNumber = transN;
-			msgItem->PeerId(peerFrom);
-			reqList.push_back(msgItem);
-			++reqListSize ;
+			missingIds.push_back(msgId);
         }
 #ifdef NXS_NET_DEBUG_1
         else
@@ -3098,29 +3106,7 @@ void RsGxsNetService::locked_genReqMsgTransaction(NxsTransaction* tr)
 #endif
     }
 
-    if(!reqList.empty())
-    {
-#ifdef NXS_NET_DEBUG_1
-        GXSNETDEBUG_PG(item->PeerId(),grpId) << "  Request list: " << reqList.size() << " elements." << std::endl;
-#endif
-        locked_pushMsgTransactionFromList(reqList, tr->mTransaction->PeerId(), transN);
-
-        if(reqListSizeExceeded)
-        {
-#ifdef NXS_NET_DEBUG_1
-            GXSNETDEBUG_PG(item->PeerId(),grpId) << "  Marking update operation as unfinished." << std::endl;
-#endif
-            mPartialMsgUpdates[tr->mTransaction->PeerId()].insert(item->grpId) ;
-        }
-        else
-        {
-#ifdef NXS_NET_DEBUG_1
-            GXSNETDEBUG_PG(item->PeerId(),grpId) << "  Marking update operation as terminal." << std::endl;
-#endif
-            mPartialMsgUpdates[tr->mTransaction->PeerId()].erase(item->grpId) ;
-        }
-    }
-    else
+    if(!locked_requestMissingMsgs(tr->mTransaction->PeerId(), grpId, missingIds, tr->mTransaction->updateTS, msgItemL.size()))
     {
 #ifdef NXS_NET_DEBUG_1
 	    GXSNETDEBUG_PG(item->PeerId(),grpId) << "  Request list is empty. Not doing anything. " << std::endl;
@@ -3146,6 +3132,162 @@ void RsGxsNetService::locked_stampPeerGroupUpdateTime(const RsPeerId& pid,const
     IndicateConfigChanged();
 }
 
+bool RsGxsNetService::locked_requestMissingMsgs(const RsPeerId& peer,const RsGxsGroupId& grpId,const std::list<RsGxsMessageId>& msgIds,rstime_t update_ts,uint32_t n_messages)
+{
+    std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>& pipelines(mMsgRequestPipelines[peer]);
+    std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>::iterator it = pipelines.find(grpId);
+
+    if(msgIds.empty() && (it == pipelines.end() || it->second.finished()))
+    {
+        mPartialMsgUpdates[peer].erase(grpId) ;
+        return false;
+    }
+
+    RsGxsMsgRequestPipeline& pipeline(pipelines[grpId]);
+
+#ifdef NXS_NET_DEBUG_1
+    GXSNETDEBUG_PG(peer,grpId) << "  " << msgIds.size() << " msgs missing. Request window: " << pipeline.window() << std::endl;
+#endif
+    pipeline.setMissingMsgs(msgIds, update_ts, n_messages);
+    locked_sendMsgRequests(peer, grpId, pipeline);
+
+    return true;
+}
+
+void RsGxsNetService::locked_sendMsgRequests(const RsPeerId& peer,const RsGxsGroupId& grpId,RsGxsMsgRequestPipeline& pipeline)
+{
+    double now = rstime::RsScopeTimer::currentTime();
+    std::vector<RsGxsMessageId> ids;
+
+    while(pipeline.canRequest())
+    {
+        uint32_t transN = locked_getTransactionId();
+        pipeline.nextRequest(transN, now, MAX_REQLIST_SIZE, ids);
+
+        std::list<RsNxsItem*> reqList;
+
+        for(uint32_t i=0;i<ids.size();++i)
+        {
+            RsNxsSyncMsgItem* msgItem = new RsNxsSyncMsgItem(mServType);
+            msgItem->grpId = grpId;
+            msgItem->msgId = ids[i];
+            msgItem->flag = RsNxsSyncMsgItem::FLAG_REQUEST;
+            msgItem->transactionNumber = transN;
+            msgItem->PeerId(peer);
+            reqList.push_back(msgItem);
+        }
+
+#ifdef NXS_NET_DEBUG_1
+        GXSNETDEBUG_PG(peer,grpId) << "  Request list: " << reqList.size() << " elements, transN=" << transN << std::endl;
+#endif
+        locked_pushMsgTransactionFromList(reqList, peer, transN);
+    }
+
+    // The time stamp of the peer for this group is only updated once all the msgs it told about have been received.
+
+    if(pipeline.finished() && !pipeline.incomplete())
+        mPartialMsgUpdates[peer].erase(grpId) ;
+    else
+        mPartialMsgUpdates[peer].insert(grpId) ;
+}
+
+void RsGxsNetService::locked_msgRequestAnswered(const RsPeerId& peer,const RsGxsGroupId& grpId,const std::vector<RsNxsMsg*>& msgs)
+{
+    std::map<RsPeerId, std::map<RsGxsGroupId,RsGxsMsgRequestPipeline> >::iterator it = mMsgRequestPipelines.find(peer);
+
+    if(it == mMsgRequestPipelines.end())
+        return;
+
+    std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>::iterator it2 = it->second.find(grpId);
+
+    if(it2 == it->second.end())
+        return;
+
+    std::vector<RsGxsMessageId> ids;
+    uint64_t bytes = 0;
+
+    for(uint32_t i=0;i<msgs.size();++i)
+    {
+        ids.push_back(msgs[i]->msgId);
+        bytes += msgs[i]->msg.bin_len + msgs[i]->meta.bin_len;
+    }
+
+    if(it2->second.requestAnswered(ids, bytes, rstime::RsScopeTimer::currentTime()))
+    {
+#ifdef NXS_NET_DEBUG_1
+        GXSNETDEBUG_PG(peer,grpId) << "  request answered. rtt=" << it2->second.rtt() << " s, throughput=" << it2->second.throughput() << " B/s, window=" << it2->second.window() << std::endl;
+#endif
+        locked_sendMsgRequests(peer, grpId, it2->second);
+    }
+}
+
+void RsGxsNetService::locked_msgRequestDelivered(uint32_t transN)
+{
+    for(std::map<RsPeerId, std::map<RsGxsGroupId,RsGxsMsgRequestPipeline> >::iterator it(mMsgRequestPipelines.begin());it!=mMsgRequestPipelines.end();++it)
+        for(std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>::iterator it2(it->second.begin());it2!=it->second.end();++it2)
+            if(it2->second.requestDelivered(transN))
+                return;
+}
+
+void RsGxsNetService::locked_msgRequestFailed(uint32_t transN)
+{
+    for(std::map<RsPeerId, std::map<RsGxsGroupId,RsGxsMsgRequestPipeline> >::iterator it(mMsgRequestPipelines.begin());it!=mMsgRequestPipelines.end();++it)
+        for(std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>::iterator it2(it->second.begin());it2!=it->second.end();++it2)
+            if(it2->second.requestFailed(transN))
+            {
+                locked_sendMsgRequests(it->first, it2->first, it2->second);
+                return;
+            }
+}
+
+void RsGxsNetService::checkMsgRequestPipelines()
+{
+    RS_STACK_MUTEX(mNxsMutex) ;
+
+    double now = rstime::RsScopeTimer::currentTime();
+
+    for(std::map<RsPeerId, std::map<RsGxsGroupId,RsGxsMsgRequestPipeline> >::iterator it(mMsgRequestPipelines.begin());it!=mMsgRequestPipelines.end();)
+    {
+        for(std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>::iterator it2(it->second.begin());it2!=it->second.end();)
+        {
+            if(it2->second.expireRequests(now) > 0)
+            {
+#ifdef NXS_NET_DEBUG_1
+                GXSNETDEBUG_PG(it->first,it2->first) << "  msg requests not answered. The peer does not have these msgs." << std::endl;
+#endif
+                locked_sendMsgRequests(it->first, it2->first, it2->second);
+
+                // No msg transaction will update the time stamp of the peer when the last requests are not answered.
+
+                if(it2->second.finished() && !it2->second.incomplete())
+                    locked_stampPeerGroupUpdateTime(it->first, it2->first, it2->second.listTimeStamp(), it2->second.listSize());
+            }
+
+            // Keep the statistics of finished pipelines for a while, so that they can be displayed.
+
+            if(it2->second.finished() && it2->second.lastActivity() + MSG_REQUEST_STATS_KEEP_DELAY < now)
+            {
+                std::map<RsGxsGroupId,RsGxsMsgRequestPipeline>::iterator tmp(it2);
+                ++tmp;
+                it->second.erase(it2);
+                it2 = tmp;
+            }
+            else
+                ++it2;
+        }
+
+        if(it->second.empty())
+        {
+            std::map<RsPeerId, std::map<RsGxsGroupId,RsGxsMsgRequestPipeline> >::iterator tmp(it);
+            ++tmp;
+            mMsgRequestPipelines.erase(it);
+            it = tmp;
+        }
+        else
+            ++it;
+    }
+}
+
 void RsGxsNetService::locked_pushGrpTransactionFromList( std::list<RsNxsItem*>& reqList, const RsPeerId& peerId, const uint32_t& transN)
 {
 #ifdef NXS_NET_DEBUG_1
@@ -4469,6 +4611,11 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
     uint32_t max_send_delay = locked_getGrpConfig(item->grpId).msg_req_delay;	// we should use "sync" but there's only one variable used in the GUI: the req one.
 #endif
 
+    // Msgs received after the last update the peer knows about are likely to be missing at the peer. This is
+    // used to guess the size of the table of msg ids when the peer can reconcile lists.
+
+    uint32_t nb_recently_received = 0 ;
+
     // First, filter out some messages we may not want to send.
 
     if(canSendMsgIds(msgMetas, *grpMeta, peer, should_encrypt_to_this_circle_id))
@@ -4479,25 +4626,12 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
 
             // Check reputation
 
-            if(!m->mAuthorId.isNull())
+            if(!m->mAuthorId.isNull() && !canForwardMsgsOfAuthor(m->mAuthorId, *grpMeta))
 			{
-				RsIdentityDetails details ;
-
-				if(!rsIdentity->getIdDetails(m->mAuthorId,details))
-				{
-#ifdef NXS_NET_DEBUG_0
-					GXSNETDEBUG_PG(item->PeerId(),item->grpId) << " not sending grp message ID " << (*vit)->mMsgId << ", because the identity of the author (" << m->mAuthorId << ") is not accessible (unknown/not cached)" << std::endl;
-#endif
-					continue ;
-				}
-
-				if(details.mReputation.mOverallReputationLevel < minReputationForForwardingMessages(grpMeta->mSignFlags, details.mFlags))
-				{
 #ifdef NXS_NET_DEBUG_0
-					GXSNETDEBUG_PG(item->PeerId(),item->grpId) << " not sending item ID " << (*vit)->mMsgId << ", because the author is flags " << std::hex << details.mFlags << std::dec << " and reputation level " << (int) details.mReputation.mOverallReputationLevel << std::endl;
+				GXSNETDEBUG_PG(item->PeerId(),item->grpId) << " not sending item ID " << (*vit)->mMsgId << ", because the author (" << m->mAuthorId << ") is unknown or has a too low reputation." << std::endl;
 #endif
-					continue ;
-				}
+				continue ;
 			}
 			// Check publish TS
 #ifndef RS_GXS_SEND_ALL
@@ -4512,6 +4646,9 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
 				continue ;
 			}
 
+			if(m->recvTS > item->updateTS)
+				++nb_recently_received ;
+
 			RsNxsSyncMsgItem* mItem = new RsNxsSyncMsgItem(mServType);
 			mItem->flag = RsNxsSyncGrpItem::FLAG_RESPONSE;
 			mItem->grpId = m->mGroupId;
@@ -4561,6 +4698,20 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
 	    GXSNETDEBUG_PG(item->PeerId(),item->grpId) << "  vetting forbids sending. Nothing will be sent." << itemL.size() << " items." << std::endl;
 #endif
 
+    // Peers that can reconcile msg lists get a table of the msg ids instead, when it is smaller. We also guess that
+    // the peer has as many msgs that we don't have, since these take room in the table as well.
+
+    if(!itemL.empty() && should_encrypt_to_this_circle_id.isNull() && (item->flag & RsNxsSyncMsgReqItem::FLAG_USE_MSG_ID_RECONCILIATION))
+    {
+	    uint32_t created_since = item->createdSinceTS ;
+#ifndef RS_GXS_SEND_ALL
+	    if(max_send_delay > 0 && now > (rstime_t)max_send_delay)
+		    created_since = std::max(created_since, (uint32_t)(now - max_send_delay)) ;
+#endif
+	    if(locked_pushMsgIbltFromList(itemL, peer, item->grpId, created_since, 2*nb_recently_received))
+		    return ;
+    }
+
     if(!itemL.empty())
     {
 #ifdef NXS_NET_DEBUG_0
@@ -4620,6 +4771,196 @@ void RsGxsNetService::locked_pushMsgRespFromList(std::list<RsNxsItem*>& itemL, c
 	}
 }
 
+bool RsGxsNetService::locked_pushMsgIbltFromList(std::list<RsNxsItem*>& itemL, const RsPeerId& sslId, const RsGxsGroupId& grp_id, uint32_t created_since, uint32_t nb_differences)
+{
+	uint32_t nb_cells = RsGxsMsgIdIblt::cellsForDifference(nb_differences) ;
+	uint32_t list_size = itemL.size() * RsNxsSerialiser(mServType).size(itemL.front()) ;
+
+	if(nb_cells > MAX_MSG_ID_IBLT_CELLS || nb_cells * RsGxsMsgIdIblt::CELL_SIZE >= list_size / 2)
+		return false ;
+
+	RsGxsMsgIdIblt iblt(nb_cells, RSRandom::random_u32()) ;
+
+	for(std::list<RsNxsItem*>::const_iterator it(itemL.begin());it!=itemL.end();++it)
+	{
+		RsNxsSyncMsgItem *mItem = dynamic_cast<RsNxsSyncMsgItem*>(*it) ;
+
+		if(!mItem)
+			return false ;
+
+		iblt.insert(mItem->msgId) ;
+	}
+
+	RsNxsSyncMsgIbltItem *ibltItem = new RsNxsSyncMsgIbltItem(mServType) ;
+
+	if(!iblt.serialise(ibltItem->cells))
+	{
+		delete ibltItem ;
+		return false ;
+	}
+	ibltItem->grpId = grp_id ;
+	ibltItem->updateTS = mServerMsgUpdateMap[grp_id].msgUpdateTS ;
+	ibltItem->createdSinceTS = created_since ;
+	ibltItem->nbMsgs = itemL.size() ;
+	ibltItem->salt = iblt.salt() ;
+	ibltItem->PeerId(sslId) ;
+
+#ifdef NXS_NET_DEBUG_0
+	GXSNETDEBUG_PG(sslId,grp_id) << "  sending table of " << iblt.nbCells() << " cells instead of a msg info list of " << itemL.size() << " items." << std::endl;
+#endif
+	for(std::list<RsNxsItem*>::const_iterator it(itemL.begin());it!=itemL.end();++it)
+		delete *it ;
+
+	itemL.clear() ;
+
+	generic_sendItem(ibltItem) ;
+	return true ;
+}
+
+void RsGxsNetService::handleRecvSyncMsgIblt(RsNxsSyncMsgIbltItem *item)
+{
+    if (!item)
+	    return;
+
+    RS_STACK_MUTEX(mNxsMutex) ;
+
+    const RsPeerId& peer = item->PeerId();
+    const RsGxsGroupId& grpId = item->grpId;
+
+    RsGxsGrpMetaTemporaryMap grpMetas;
+    grpMetas[grpId] = NULL;
+
+    mDataStore->retrieveGxsGrpMetaData(grpMetas);
+    const auto& grpMeta = grpMetas[grpId];
+
+    // We only ask for tables for subscribed groups that are not restricted to a circle.
+
+    if(grpMeta == NULL || !(grpMeta->mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED) || grpMeta->mCircleType == GXS_CIRCLE_TYPE_EXTERNAL)
+    {
+        std::cerr << "(WW) received an unexpected msg id table for group " << grpId << " from peer " << peer << ". Dropping it." << std::endl;
+        return ;
+    }
+
+    RsGxsGrpConfig& gnsr(locked_getGrpConfig(grpId));
+
+    std::set<RsPeerId>::size_type oldSuppliersCount = gnsr.suppliers.ids.size();
+    uint32_t oldVisibleCount = gnsr.max_visible_count;
+
+    gnsr.suppliers.ids.insert(peer) ;
+    gnsr.max_visible_count = std::max(gnsr.max_visible_count, item->nbMsgs) ;
+
+    if (oldVisibleCount != gnsr.max_visible_count || oldSuppliersCount != gnsr.suppliers.ids.size())
+        mNewStatsToNotify.insert(grpId) ;
+
+    RsGxsMsgIdIblt iblt(1,0) ;
+
+    if(!RsGxsMsgIdIblt::deserialise(item->cells, item->salt, iblt))
+    {
+        std::cerr << "(EE) cannot read msg id table for group " << grpId << " from peer " << peer << std::endl;
+        return ;
+    }
+
+    // Remove our own msgs from the table, with the same filters as the peer: the time limit, which includes the
+    // storage time of the peer, old versions and reputation of authors. Msgs the peer filtered out would otherwise
+    // take room in the table. Reputations are not the same on both sides though. The remaining differences only
+    // show in own_ids, which are not used, but may be too many for the table. The plain msg list is then asked for.
+
+    GxsMsgReq reqIds;
+    reqIds[grpId] = std::set<RsGxsMessageId>();
+    GxsMsgMetaResult result;
+    mDataStore->retrieveGxsMsgMetaData(reqIds, result);
+
+    auto& own_msgs(result[grpId]);
+    std::set<RsGxsMessageId> msgIdSet;
+
+    for(auto vit=own_msgs.begin(); vit != own_msgs.end(); ++vit)
+        msgIdSet.insert((*vit)->mMsgId);
+
+    if(!(mSyncFlags & RsGxsNetServiceSyncFlags::SYNC_OLD_MSG_VERSIONS))
+        removeOldMsgVersions(own_msgs);
+
+    RsGxsMsgIdIblt own_iblt(iblt.nbCells(), item->salt) ;
+
+    for(auto vit=own_msgs.begin(); vit != own_msgs.end(); ++vit)
+        if((*vit)->mPublishTs >= item->createdSinceTS && ((*vit)->mAuthorId.isNull() || canForwardMsgsOfAuthor((*vit)->mAuthorId, *grpMeta)))
+            own_iblt.insert((*vit)->mMsgId) ;
+
+    std::set<RsGxsMessageId> missing_ids, own_ids ;
+
+    if(!iblt.subtract(own_iblt) || !iblt.decode(missing_ids, own_ids))
+    {
+        // Too many differences for the table. Ask again for the plain list of msgs.
+
+#ifdef NXS_NET_DEBUG_0
+        GXSNETDEBUG_PG(peer,grpId) << "  cannot decode msg id table of " << iblt.nbCells() << " cells. Asking for the msg list." << std::endl;
+#endif
+        RsNxsSyncMsgReqItem* msg = new RsNxsSyncMsgReqItem(mServType);
+
+        msg->PeerId(peer);
+        msg->grpId = grpId;
+        msg->createdSinceTS = item->createdSinceTS;
+
+        ClientMsgMap::const_iterator cit = mClientMsgUpdateMap.find(peer);
+
+        if(cit != mClientMsgUpdateMap.end())
+        {
+            std::map<RsGxsGroupId, RsGxsMsgUpdateItem::MsgUpdateInfo>::const_iterator cit2 = cit->second.msgUpdateInfos.find(grpId);
+
+            if(cit2 != cit->second.msgUpdateInfos.end())
+                msg->updateTS = cit2->second.time_stamp;
+        }
+
+        generic_sendItem(msg);
+        return ;
+    }
+
+#ifdef NXS_NET_DEBUG_0
+    GXSNETDEBUG_PG(peer,grpId) << "  decoded msg id table: " << missing_ids.size() << " msgs missing here, " << own_ids.size() << " missing at the peer." << std::endl;
+#endif
+
+    // The table does not tell the authors of the msgs, so that msgs from banned authors will only be rejected once received.
+
+    std::list<RsGxsMessageId> missingIds;
+
+    for(std::set<RsGxsMessageId>::const_iterator it(missing_ids.begin());it!=missing_ids.end();++it)
+        if(msgIdSet.find(*it) == msgIdSet.end() && mRejectedMessages.find(*it) == mRejectedMessages.end())
+            missingIds.push_back(*it);
+
+    if(!locked_requestMissingMsgs(peer, grpId, missingIds, item->updateTS, item->nbMsgs))
+        locked_stampPeerGroupUpdateTime(peer,grpId,item->updateTS,item->nbMsgs) ;
+}
+
+void RsGxsNetService::removeOldMsgVersions(std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMetas)
+{
+    std::set<RsGxsMessageId> messages_old_versions;
+
+    for(const auto& pmsg:msgMetas)
+        if(!pmsg->mOrigMsgId.isNull() && pmsg->mOrigMsgId != pmsg->mMsgId)
+            messages_old_versions.insert(pmsg->mOrigMsgId);
+
+    for(uint32_t i=0;i<msgMetas.size();)
+        if(messages_old_versions.find(msgMetas[i]->mMsgId) != messages_old_versions.end())
+        {
+#ifdef NXS_NET_DEBUG_0
+            GXSNETDEBUG__G(msgMetas[i]->mGroupId) << "  skipping msg id " << msgMetas[i]->mMsgId << " because it is an old version." << std::endl;
+#endif
+            msgMetas[i] = msgMetas[msgMetas.size()-1];
+            msgMetas.pop_back();
+        }
+        else
+            ++i;
+}
+
+bool RsGxsNetService::canForwardMsgsOfAuthor(const RsGxsId& author_id, const RsGxsGrpMetaData& grpMeta)
+{
+    RsIdentityDetails details ;
+
+    if(!rsIdentity->getIdDetails(author_id,details))
+        return false ;
+
+    return details.mReputation.mOverallReputationLevel >= minReputationForForwardingMessages(grpMeta.mSignFlags, details.mFlags) ;
+}
+
 bool RsGxsNetService::canSendMsgIds(std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMetas, const RsGxsGrpMetaData& grpMeta, const RsPeerId& sslId,RsGxsCircleId& should_encrypt_id)
 {
 #ifdef NXS_NET_DEBUG_4
@@ -4637,107 +4978,91 @@ bool RsGxsNetService::canSendMsgIds(std::vector<std::shared_ptr<RsGxsMsgMetaData
 	}
 
     // If the service prevents sending old versions of messages, remove them from the list
-    std::set<RsGxsMessageId> messages_old_versions;
 
     if(!(mSyncFlags & RsGxsNetServiceSyncFlags::SYNC_OLD_MSG_VERSIONS))
-    {
-        for(const auto& pmsg:msgMetas)
-            if(!pmsg->mOrigMsgId.isNull() && pmsg->mOrigMsgId != pmsg->mMsgId)
-                messages_old_versions.insert(pmsg->mOrigMsgId);
-
-        for(uint32_t i=0;i<msgMetas.size();)
-            if(messages_old_versions.find(msgMetas[i]->mMsgId) != messages_old_versions.end())
-            {
-                std::cerr << " Not sending msg id " << msgMetas[i]->mMsgId << " because it is an old version." << std::endl;
-                msgMetas[i] = msgMetas[msgMetas.size()-1];
-                msgMetas.pop_back();
-            }
-            else
-                ++i;
-    }
+        removeOldMsgVersions(msgMetas);
 
+    // first do the simple checks
+    uint8_t circleType = grpMeta.mCircleType;
 
-        // first do the simple checks
-        uint8_t circleType = grpMeta.mCircleType;
-
-        if(circleType == GXS_CIRCLE_TYPE_LOCAL)
-        {
+    if(circleType == GXS_CIRCLE_TYPE_LOCAL)
+    {
 #ifdef NXS_NET_DEBUG_4
-            GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle type: LOCAL => returning false" << std::endl;
+        GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle type: LOCAL => returning false" << std::endl;
 #endif
-            return false;
-        }
-        else if(circleType == GXS_CIRCLE_TYPE_PUBLIC || circleType == GXS_CIRCLE_TYPE_UNKNOWN) // this complies with the fact that p3IdService does not initialise the circle type.
-        {
+        return false;
+    }
+    else if(circleType == GXS_CIRCLE_TYPE_PUBLIC || circleType == GXS_CIRCLE_TYPE_UNKNOWN) // this complies with the fact that p3IdService does not initialise the circle type.
+    {
 #ifdef NXS_NET_DEBUG_4
-            GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle type: PUBLIC => returning true" << std::endl;
+        GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle type: PUBLIC => returning true" << std::endl;
 #endif
-            return true;
-        }
-        else if(circleType == GXS_CIRCLE_TYPE_EXTERNAL)
-        {
-            const RsGxsCircleId& circleId = grpMeta.mCircleId;
+        return true;
+    }
+    else if(circleType == GXS_CIRCLE_TYPE_EXTERNAL)
+    {
+        const RsGxsCircleId& circleId = grpMeta.mCircleId;
 #ifdef NXS_NET_DEBUG_4
-            GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle type: EXTERNAL => returning true. Msgs ids list will be encrypted." << std::endl;
+        GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle type: EXTERNAL => returning true. Msgs ids list will be encrypted." << std::endl;
 #endif
-            should_encrypt_id = circleId ;
+        should_encrypt_id = circleId ;
 
-            // For each message ID, check that the author is in the circle. If not, do not send the message, which means, remove it from the list.
-            // Unsigned messages are still transmitted. This is because in some groups (channels) the posts are not signed. Whether an unsigned post
-            // is allowed at this point is anyway already vetted by the RsGxsGenExchange service.
+        // For each message ID, check that the author is in the circle. If not, do not send the message, which means, remove it from the list.
+        // Unsigned messages are still transmitted. This is because in some groups (channels) the posts are not signed. Whether an unsigned post
+        // is allowed at this point is anyway already vetted by the RsGxsGenExchange service.
 
-            // Messages that stay in the list will be sent. As a consequence true is always returned.
-            // Messages put in vetting list will be dealt with later
+        // Messages that stay in the list will be sent. As a consequence true is always returned.
+        // Messages put in vetting list will be dealt with later
 
-            std::vector<MsgIdCircleVet> toVet;
+        std::vector<MsgIdCircleVet> toVet;
 
-            for(uint32_t i=0;i<msgMetas.size();)
-                if( msgMetas[i]->mAuthorId.isNull() )		// keep the message in this case
-                    ++i ;
-                else
+        for(uint32_t i=0;i<msgMetas.size();)
+            if( msgMetas[i]->mAuthorId.isNull() )		// keep the message in this case
+                ++i ;
+            else
+            {
+                if(mCircles->isLoaded(circleId) && mCircles->isRecipient(circleId, grpMeta.mGroupId, msgMetas[i]->mAuthorId))
                 {
-                    if(mCircles->isLoaded(circleId) && mCircles->isRecipient(circleId, grpMeta.mGroupId, msgMetas[i]->mAuthorId))
-                    {
-                        ++i ;
-                        continue ;
-                    }
+                    ++i ;
+                    continue ;
+                }
 
-                    MsgIdCircleVet mic(msgMetas[i]->mMsgId, msgMetas[i]->mAuthorId);
-                    toVet.push_back(mic);
+                MsgIdCircleVet mic(msgMetas[i]->mMsgId, msgMetas[i]->mAuthorId);
+                toVet.push_back(mic);
 #ifdef NXS_NET_DEBUG_4
-                    GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   deleting MsgMeta entry for msg ID " << msgMetas[i]->mMsgId << " signed by " << msgMetas[i]->mAuthorId << " who is not in group circle " << circleId << std::endl;
+                GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   deleting MsgMeta entry for msg ID " << msgMetas[i]->mMsgId << " signed by " << msgMetas[i]->mAuthorId << " who is not in group circle " << circleId << std::endl;
 #endif
 
-                    //delete msgMetas[i] ;
-                    msgMetas[i] = msgMetas[msgMetas.size()-1] ;
-                    msgMetas.pop_back() ;
-                }
+                //delete msgMetas[i] ;
+                msgMetas[i] = msgMetas[msgMetas.size()-1] ;
+                msgMetas.pop_back() ;
+            }
 
 #ifdef NXS_NET_DEBUG_4
-            GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle info not loaded. Putting in vetting list and returning false." << std::endl;
+        GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "   Circle info not loaded. Putting in vetting list and returning false." << std::endl;
 #endif
-            if(!toVet.empty())
-                mPendingCircleVets.push_back(new MsgCircleIdsRequestVetting(mCircles, mPgpUtils, toVet, grpMeta.mGroupId, sslId, grpMeta.mCircleId));
+        if(!toVet.empty())
+            mPendingCircleVets.push_back(new MsgCircleIdsRequestVetting(mCircles, mPgpUtils, toVet, grpMeta.mGroupId, sslId, grpMeta.mCircleId));
 
-            return true ;
-        }
-        else if(circleType == GXS_CIRCLE_TYPE_YOUR_FRIENDS_ONLY)
-        {
+        return true ;
+    }
+    else if(circleType == GXS_CIRCLE_TYPE_YOUR_FRIENDS_ONLY)
+    {
 #ifdef NXS_NET_DEBUG_4
-            GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "  YOUREYESONLY, checking further" << std::endl;
+        GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "  YOUREYESONLY, checking further" << std::endl;
 #endif
-            bool res = checkPermissionsForFriendGroup(sslId,grpMeta) ;
+        bool res = checkPermissionsForFriendGroup(sslId,grpMeta) ;
 #ifdef NXS_NET_DEBUG_4
-            GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "  Final answer: " << res << std::endl;
+        GXSNETDEBUG_PG(sslId,grpMeta.mGroupId) << "  Final answer: " << res << std::endl;
 #endif
-            return res ;
-        }
-        else
-        {
-            std::cerr << "(EE) unknown value found in circle type for group " << grpMeta.mGroupId << ": " << (int)circleType << ": this is probably a bug in the design of the group creation." << std::endl;
-            return false;
-        }
+        return res ;
     }
+    else
+    {
+        std::cerr << "(EE) unknown value found in circle type for group " << grpMeta.mGroupId << ": " << (int)circleType << ": this is probably a bug in the design of the group creation." << std::endl;
+        return false;
+    }
+}
 
 /** inherited methods **/
 
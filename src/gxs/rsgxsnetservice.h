@@ -33,6 +33,7 @@
 #include "rsitems/rsgxsupdateitems.h"
 #include "rsgxsnettunnel.h"
 #include "rsgxsnetutils.h"
+#include "rsgxsmsgpipeline.h"
 #include "pqi/p3cfgmgr.h"
 #include "rsgixs.h"
 
@@ -439,6 +440,13 @@ private:
      */
     void handleRecvSyncMessage(RsNxsSyncMsgReqItem* item,bool item_was_encrypted);
 
+    /*!
+     * Handles the table of msg ids sent by a peer instead of its list of msgs,
+     * and requests the msgs we miss, or the full list when the table cannot be decoded.
+     * @param item contains the msg id table of a group
+     */
+    void handleRecvSyncMsgIblt(RsNxsSyncMsgIbltItem* item);
+
     /*!
      * Handles an nxs item for group publish key
      * @param item contaims keys/grp info
@@ -465,6 +473,13 @@ private:
     bool canSendGrpId(const RsPeerId& sslId, const RsGxsGrpMetaData& grpMeta, std::vector<GrpIdCircleVet>& toVet, bool &should_encrypt);
     bool canSendMsgIds(std::vector<std::shared_ptr<RsGxsMsgMetaData> > &msgMetas, const RsGxsGrpMetaData&, const RsPeerId& sslId, RsGxsCircleId &should_encrypt_id);
 
+    /*!
+     * Filters applied to the msgs listed to a peer, besides their publish time. They are also applied when comparing
+     * a table of msg ids sent by a peer to our own msgs.
+     */
+    void removeOldMsgVersions(std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMetas);
+    bool canForwardMsgsOfAuthor(const RsGxsId& author_id, const RsGxsGrpMetaData& grpMeta);
+
     /*!
      * \brief checkPermissionsForFriendGroup
      * 			Checks that we can send/recv from that node, given that the grpMeta has a distribution limited to a local circle.
@@ -485,6 +500,14 @@ private:
     void locked_pushMsgTransactionFromList(std::list<RsNxsItem*>& reqList, const RsPeerId& peerId, const uint32_t& transN);	// forms a msg list request
     void locked_pushGrpRespFromList(std::list<RsNxsItem*>& respList, const RsPeerId& peer, const uint32_t& transN);
     void locked_pushMsgRespFromList(std::list<RsNxsItem*>& itemL, const RsPeerId& sslId, const RsGxsGroupId &grp_id, const uint32_t& transN);
+
+    /*!
+     * \brief locked_pushMsgIbltFromList
+     * 			Sends a table of the msg ids in itemL instead of the list itself, if the table is smaller.
+     * \param nb_differences expected number of msgs the peer does not have
+     * \return true if the table was sent. The items of itemL are then deleted.
+     */
+    bool locked_pushMsgIbltFromList(std::list<RsNxsItem*>& itemL, const RsPeerId& sslId, const RsGxsGroupId& grp_id, uint32_t created_since, uint32_t nb_differences);
     
 	void checkDistantSyncState();
 
@@ -577,6 +600,22 @@ private:
 
     void locked_stampPeerGroupUpdateTime(const RsPeerId& pid,const RsGxsGroupId& grpId,rstime_t tm,uint32_t n_messages) ;
 
+    /*!
+     * \brief locked_requestMissingMsgs
+     * 			Queues the msgs missing here in the request pipeline of this peer and group, and sends the requests that the window allows.
+     * \param update_ts  time stamp of the msg list of the peer, used once all requests are answered or dropped.
+     * \param n_messages number of msgs in that list
+     * \return false if there is nothing to request from this peer for this group, including msgs already requested.
+     */
+    bool locked_requestMissingMsgs(const RsPeerId& peer,const RsGxsGroupId& grpId,const std::list<RsGxsMessageId>& msgIds,rstime_t update_ts,uint32_t n_messages) ;
+    void locked_sendMsgRequests(const RsPeerId& peer,const RsGxsGroupId& grpId,RsGxsMsgRequestPipeline& pipeline) ;
+    void locked_msgRequestAnswered(const RsPeerId& peer,const RsGxsGroupId& grpId,const std::vector<RsNxsMsg*>& msgs) ;
+    void locked_msgRequestDelivered(uint32_t transN) ;
+    void locked_msgRequestFailed(uint32_t transN) ;
+
+    /// Drops the requests the peer received but did not answer, and forgets the pipelines that have been idle for a while.
+    void checkMsgRequestPipelines() ;
+
     /*!
     * encrypts/decrypts the transaction for the destination circle id.
     */
@@ -629,6 +668,7 @@ private:
 
     uint32_t mSyncTs;
     uint32_t mLastKeyPublishTs;
+    uint32_t mLastMsgRequestCheckTs;
     uint32_t mLastCleanRejectedMessages;
 
     const uint32_t mSYNC_PERIOD;
@@ -648,6 +688,7 @@ private:
     std::map<RsGxsGroupId,std::set<RsPeerId> > mPendingPublishKeyRecipients ;
 	std::map<RsPeerId, std::set<RsGxsGroupId> > mExplicitRequest;
     std::map<RsPeerId, std::set<RsGxsGroupId> > mPartialMsgUpdates ;
+    std::map<RsPeerId, std::map<RsGxsGroupId,RsGxsMsgRequestPipeline> > mMsgRequestPipelines ;
 
     // nxs sync optimisation
     // can pull dynamically the latest timestamp for each message
@@ -48,8 +48,13 @@ file_lists {
 			file_sharing/filelist_io.h \
 			file_sharing/directory_storage.h \
 			file_sharing/directory_updater.h \
+			file_sharing/directory_watcher.h \
 			file_sharing/rsfilelistitems.h \
 			file_sharing/dir_hierarchy.h \
+			file_sharing/file_search_index.h \
+			file_sharing/compact_file_list.h \
+			file_sharing/name_table.h \
+			file_sharing/hash_index_table.h \
 			file_sharing/file_sharing_defaults.h
 
 	SOURCES *= file_sharing/p3filelists.cc \
@@ -57,7 +62,12 @@ file_lists {
 			file_sharing/filelist_io.cc \
 			file_sharing/directory_storage.cc \
 			file_sharing/directory_updater.cc \
+			file_sharing/directory_watcher.cc \
 			file_sharing/dir_hierarchy.cc \
+			file_sharing/file_search_index.cc \
+			file_sharing/compact_file_list.cc \
+			file_sharing/name_table.cc \
+			file_sharing/hash_index_table.cc \
 			file_sharing/file_tree.cc \
 			file_sharing/rsfilelistitems.cc
 }
@@ -376,6 +386,7 @@ HEADERS +=	ft/ftchunkmap.h \
 			ft/ftfilecreator.h \
 			ft/ftfileprovider.h \
 			ft/ftfilesearch.h \
+			ft/ftratecontrol.h \
 			ft/ftsearch.h \
 			ft/ftserver.h \
 			ft/fttransfermodule.h \
@@ -434,6 +445,7 @@ HEADERS +=	pqi/authssl.h \
 			pqi/pqistore.h \
 			pqi/pqistreamer.h \
 			pqi/pqithreadstreamer.h \
+			pqi/pqireactor.h \
 			pqi/pqiqosstreamer.h \
 			pqi/sslfns.h \
 			pqi/pqinetstatebox.h \
@@ -525,6 +537,8 @@ HEADERS +=	util/folderiterator.h \
 			util/argstream.h \
 			util/rsdiscspace.h \
 			util/rsnet.h \
+			util/rsiptrie.h \
+			util/rspgphashmatcher.h \
 			util/extaddrfinder.h \
 			util/dnsresolver.h \
                         util/radix32.h \
@@ -535,7 +549,9 @@ HEADERS +=	util/folderiterator.h \
 			util/rsprint.h \
 			util/rsstring.h \
 			util/rsstd.h \
+			util/rsthreadpool.h \
 			util/rsthreads.h \
+			util/rswakeupsignal.h \
 			util/rswin.h \
 			util/rsrandom.h \
 			util/rsmemcache.h \
@@ -559,6 +575,7 @@ SOURCES +=	ft/ftchunkmap.cc \
 			ft/ftfilecreator.cc \
 			ft/ftfileprovider.cc \
 			ft/ftfilesearch.cc \
+			ft/ftratecontrol.cc \
 			ft/ftserver.cc \
 			ft/fttransfermodule.cc \
             ft/ftturtlefiletransferitem.cc \
@@ -605,6 +622,7 @@ SOURCES +=	pqi/authgpg.cc \
 			pqi/pqistore.cc \
 			pqi/pqistreamer.cc \
 			pqi/pqithreadstreamer.cc \
+			pqi/pqireactor.cc \
 			pqi/pqiqosstreamer.cc \
 			pqi/sslfns.cc \
 			pqi/pqinetstatebox.cc \
@@ -681,12 +699,16 @@ SOURCES +=	util/folderiterator.cc \
 			util/rsdiscspace.cc \
 			util/rsnet.cc \
 			util/rsnet_ss.cc \
+			util/rsiptrie.cc \
+			util/rspgphashmatcher.cc \
 			util/rsdnsutils.cc \
 			util/extaddrfinder.cc \
 			util/dnsresolver.cc \
 			util/rsprint.cc \
 			util/rsstring.cc \
+			util/rsthreadpool.cc \
 			util/rsthreads.cc \
+			util/rswakeupsignal.cc \
 			util/rsrandom.cc \
 			util/rstickevent.cc \
 			util/rsrecogn.cc \
@@ -739,6 +761,8 @@ HEADERS += rsitems/rsnxsitems.h \
 	gxs/rsgxsdataaccess.h \
 	gxs/gxstokenqueue.h \
 	gxs/rsgxsnetutils.h \
+	gxs/rsgxsiblt.h \
+	gxs/rsgxsmsgpipeline.h \
 	gxs/rsgxsrequesttypes.h
 
 
@@ -756,6 +780,8 @@ SOURCES += rsitems/rsnxsitems.cc \
 	gxs/rsgxsdata.cc \
 	gxs/gxstokenqueue.cc \
 	gxs/rsgxsnetutils.cc \
+	gxs/rsgxsiblt.cc \
+	gxs/rsgxsmsgpipeline.cc \
 	gxs/rsgxsutil.cc \
         gxs/rsgxsrequesttypes.cc \
         gxs/rsnxsobserver.cpp
@@ -54,7 +54,8 @@ class RsBwRates
 	RsBwRates()
         : mRateIn(0), mRateOut(0), mMaxRateIn(0), mMaxRateOut(0), 
           mQueueIn(0), mQueueOut(0), mQueueOutBytes(0),
-          mTotalIn(0), mTotalOut(0) { return; }
+          mTotalIn(0), mTotalOut(0),
+          mOutWrites(0), mOutWriteBytes(0), mOutAllocs(0) { return; }
 	float mRateIn;
 	float mRateOut;
 	float mMaxRateIn;
@@ -64,6 +65,9 @@ class RsBwRates
 	uint32_t mQueueOutBytes;
 	uint64_t mTotalIn;
 	uint64_t mTotalOut;
+	uint64_t mOutWrites;		// number of write calls to the network layer
+	uint64_t mOutWriteBytes;	// bytes sent through these calls
+	uint64_t mOutAllocs;		// memory allocations on the outgoing path
 };
 
 
@@ -332,6 +336,13 @@ public:
 	 *  used by pqistreamer to limit transfers
 	 **/
 	virtual bool bandwidthLimited() { return true; }
+
+	/**
+	 * Operating system socket descriptor used for the transfers, which can
+	 * be watched by an event loop (@see pqiReactor).
+	 * @return -1 if there is no such descriptor.
+	 **/
+	virtual int socketDescriptor() { return -1; }
 };
 
 
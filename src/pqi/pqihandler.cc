@@ -300,6 +300,9 @@ int pqihandler::ExtractRates(std::map<RsPeerId, RsBwRates> &ratemap, RsBwRates &
 	total.mQueueOutBytes = 0;
 	total.mTotalIn = 0;
 	total.mTotalOut = 0;
+	total.mOutWrites = 0;
+	total.mOutWriteBytes = 0;
+	total.mOutAllocs = 0;
 
 	/* Lock once rates have been retrieved */
 	RS_STACK_MUTEX(coreMtx); /**************** LOCKED MUTEX ****************/
@@ -325,6 +328,9 @@ int pqihandler::ExtractRates(std::map<RsPeerId, RsBwRates> &ratemap, RsBwRates &
 		/* Accumulate cumulative statistics into global totals */
 		total.mTotalIn += peerRates.mTotalIn;
 		total.mTotalOut += peerRates.mTotalOut;
+		total.mOutWrites += peerRates.mOutWrites;
+		total.mOutWriteBytes += peerRates.mOutWriteBytes;
+		total.mOutAllocs += peerRates.mOutAllocs;
 
 		/* Store individual peer rates in the result map */
 		ratemap[it->first] = peerRates;
@@ -109,12 +109,12 @@ void pqiQoS::in_rsItem(void *ptr,int size,int priority)
 // }
 
 
-void *pqiQoS::out_rsItem(uint32_t max_slice_size, uint32_t& size, bool& starts, bool& ends, uint32_t& packet_id) 
+int pqiQoS::selectQueue()
 {
 	// Go through the queues. Increment counters.
 
 	if(_nb_items == 0)
-		return NULL ;
+		return -1 ;
 
 	float inc = 1.0f ;
 	int i = _item_queues.size()-1 ;
@@ -131,12 +131,19 @@ void *pqiQoS::out_rsItem(uint32_t max_slice_size, uint32_t& size, bool& starts,
 			_item_queues[j]._counter -= _item_queues[j]._threshold ;
 		}
 
-	if(last >= 0)
-	{
 #ifdef DEBUG
+	if(last >= 0)
 		assert(_nb_items > 0) ;
 #endif
-        
+	return last ;
+}
+
+void *pqiQoS::out_rsItem(uint32_t max_slice_size, uint32_t& size, bool& starts, bool& ends, uint32_t& packet_id) 
+{
+	int last = selectQueue() ;
+
+	if(last >= 0)
+	{
         	// now chop a slice of this item
         
         	void *res = _item_queues[last].slice(max_slice_size,size,starts,ends,packet_id) ;
@@ -150,6 +157,19 @@ void *pqiQoS::out_rsItem(uint32_t max_slice_size, uint32_t& size, bool& starts,
 		return NULL ;
 }
 
+bool pqiQoS::out_rsItem(std::vector<uint8_t>& buf, uint32_t max_slice_size, uint32_t& size, bool& starts, bool& ends, uint32_t& packet_id)
+{
+	int last = selectQueue() ;
+
+	if(last < 0 || !_item_queues[last].slice(buf,max_slice_size,size,starts,ends,packet_id))
+		return false ;
+
+	if(ends)
+		--_nb_items ;
+
+	return true ;
+}
+
 
 
     
@@ -123,6 +123,37 @@ public:
 			return mem ;
 		}
 
+		// Same as above, but appends the slice to buf instead of allocating it.
+
+		bool slice(std::vector<uint8_t>& buf,uint32_t max_size,uint32_t& size,bool& starts,bool& ends,uint32_t& packet_id)
+		{
+			if(_items.empty())
+				return false ;
+
+			ItemRecord& rec(_items.front()) ;
+			packet_id = rec.id ;
+
+			if(rec.size <= rec.current_offset)
+			{
+				std::cerr << "(EE) severe error in slicing in QoS." << std::endl;
+				free(pop()) ;
+				return false ;
+			}
+			starts = (rec.current_offset == 0) ;
+			ends   = (rec.current_offset == 0 && rec.size < max_size) || (rec.current_offset + max_size >= rec.size) ;
+			size   = (rec.current_offset == 0 && rec.size < max_size) ? rec.size : std::min(max_size, rec.size - rec.current_offset) ;
+
+			const unsigned char *data = &((unsigned char*)rec.data)[rec.current_offset] ;
+			buf.insert(buf.end(),data,data+size) ;
+
+			if(ends)
+				free(pop()) ;
+			else
+				rec.current_offset += size ;
+
+			return true ;
+		}
+
 		void push(void *item,uint32_t size,uint32_t id) 
 		{
 			ItemRecord rec ;
@@ -148,6 +179,10 @@ public:
 	//
 	void *out_rsItem(uint32_t max_slice_size,uint32_t& size,bool& starts,bool& ends,uint32_t& packet_id) ;
 
+	// Same, but appends the slice to buf. Returns false if there is nothing to send.
+	//
+	bool out_rsItem(std::vector<uint8_t>& buf,uint32_t max_slice_size,uint32_t& size,bool& starts,bool& ends,uint32_t& packet_id) ;
+
 	// This function is used to queue items.
 	//
 	void in_rsItem(void *item, int size, int priority) ;
@@ -166,6 +201,10 @@ public:
 	void computeTotalItemSize() const ;
 	int debug_computeTotalItemSize() const ;
 private:
+	// Picks the queue to take the next slice from, or returns -1.
+	//
+	int selectQueue() ;
+
 	// This vector stores the lists of items with equal priorities.
 	//
 	std::vector<ItemQueue> _item_queues ;
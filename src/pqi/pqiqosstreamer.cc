@@ -83,3 +83,17 @@ void *pqiQoSstreamer::locked_pop_out_data(uint32_t max_slice_size, uint32_t& siz
 	return out ;
 }
 
+bool pqiQoSstreamer::locked_append_out_data(std::vector<uint8_t>& buf, uint32_t max_slice_size, uint32_t& size, bool& starts, bool& ends, uint32_t& packet_id)
+{
+	if(!pqiQoS::out_rsItem(buf,max_slice_size,size,starts,ends,packet_id))
+		return false ;
+
+	_total_item_size -= size ;
+
+	if(ends)
+	{
+		--_total_item_count ;
+		++mOutAllocCount ;	// the item has been freed
+	}
+	return true ;
+}
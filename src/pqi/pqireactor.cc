@@ -0,0 +1,487 @@
+/*******************************************************************************
+ * libretroshare/src/pqi: pqireactor.cc                                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include "util/rsdebug.h"
+#include "pqi/pqireactor.h"
+#include "pqi/pqithreadstreamer.h"
+
+//#define DEBUG_PQIREACTOR 1
+
+static const uint32_t REACTOR_FLAG_READ            = 0x01 ;	// socket became readable, or there is still data to read
+static const uint32_t REACTOR_FLAG_WRITE           = 0x02 ;	// socket became writable, or new data was queued
+
+static const int      REACTOR_MAX_EVENTS           = 256 ;
+static const int      REACTOR_IDLE_WAIT_MS         = 500 ;	// max time spent in epoll_wait when nothing is pending
+static const int      REACTOR_BUSY_WAIT_MS         = 1 ;	// wait when streamers have pending work but made no progress (e.g. bandwidth limited)
+static const rstime_t REACTOR_MAINTENANCE_PERIOD   = 1 ;	// all streamers are ticked every second, to update rates and catch up missed events
+
+pqiReactor *pqiReactor::mInstance = nullptr ;
+
+/*********************************************************************************************/
+/*                                       pqiReactorLoop                                      */
+/*********************************************************************************************/
+
+pqiReactorLoop::pqiReactorLoop()
+    : mEpollFd(-1), mWakeupFd(-1), mLoopMtx("pqiReactorLoop"), mLastPassActive(false), mLastMaintenanceTS(0) {}
+
+pqiReactorLoop::~pqiReactorLoop()
+{
+	if(mWakeupFd >= 0) ::close(mWakeupFd);
+	if(mEpollFd >= 0) ::close(mEpollFd);
+}
+
+bool pqiReactorLoop::init()
+{
+#ifdef __linux__
+	mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+
+	if(mEpollFd < 0)
+	{
+		RS_ERR("epoll_create1 failed: ", strerror(errno));
+		return false;
+	}
+
+	mWakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if(mWakeupFd < 0)
+	{
+		RS_ERR("eventfd failed: ", strerror(errno));
+		return false;
+	}
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = mWakeupFd;
+
+	if(epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeupFd, &ev) < 0)
+	{
+		RS_ERR("cannot watch wakeup descriptor: ", strerror(errno));
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+void pqiReactorLoop::signalWakeup()
+{
+#ifdef __linux__
+	uint64_t one = 1;
+	if(write(mWakeupFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		RS_ERR("cannot wake up event loop: ", strerror(errno));
+#endif
+}
+
+void pqiReactorLoop::onStopRequested()
+{
+	signalWakeup();
+}
+
+bool pqiReactorLoop::registerStreamer(pqithreadstreamer *s, int fd)
+{
+#ifdef __linux__
+	RS_STACK_MUTEX(mLoopMtx);
+
+	// The streamer may be restarted before its previous removal was processed,
+	// possibly with a new socket.
+
+	for(uint32_t i=0;i<mToRemove.size();)
+		if(mToRemove[i] == s)
+		{
+			mToRemove[i] = mToRemove.back();
+			mToRemove.pop_back();
+		}
+		else
+			++i;
+
+	std::map<pqithreadstreamer*,int>::iterator it = mStreamers.find(s);
+
+	if(it != mStreamers.end())
+	{
+		if(it->second == fd)
+			return true;
+
+		locked_removeStreamer(s);
+	}
+
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	ev.data.fd = fd;
+
+	int op = (mFds.find(fd) != mFds.end()) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+	if(epoll_ctl(mEpollFd, op, fd, &ev) < 0)
+	{
+		RS_ERR("cannot watch socket ", fd, ": ", strerror(errno));
+		return false;
+	}
+
+	mFds[fd] = s;
+	mStreamers[s] = fd;
+	mPending[s] = REACTOR_FLAG_READ | REACTOR_FLAG_WRITE;
+
+	signalWakeup();
+	return true;
+#else
+	(void)s; (void)fd;
+	return false;
+#endif
+}
+
+void pqiReactorLoop::locked_removeStreamer(pqithreadstreamer *s)
+{
+	std::map<pqithreadstreamer*,int>::iterator it = mStreamers.find(s);
+
+	if(it == mStreamers.end())
+		return;
+
+	int fd = it->second;
+	std::map<int,pqithreadstreamer*>::iterator fit = mFds.find(fd);
+
+	// The socket may have been closed and its descriptor re-used by another
+	// streamer in the meantime. In this case the descriptor is not ours anymore.
+
+	if(fit != mFds.end() && fit->second == s)
+	{
+#ifdef __linux__
+		// closed descriptors are automatically removed from the epoll set,
+		// so that failure is not an error here.
+		epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+		mFds.erase(fit);
+	}
+
+	mStreamers.erase(it);
+	mPending.erase(s);
+}
+
+void pqiReactorLoop::unregisterStreamer(pqithreadstreamer *s, bool wait)
+{
+	{
+		RS_STACK_MUTEX(mLoopMtx);
+
+		if(mStreamers.find(s) == mStreamers.end())
+			return;
+
+		mToRemove.push_back(s);
+	}
+	signalWakeup();
+
+	// The event loop removes the streamer at the end of its current pass.
+	// Streamers stopped from the event loop itself (e.g. on connection reset)
+	// never wait, since they are not deleted before a full stop.
+
+	if(!wait || !isRunning())
+	{
+		if(!isRunning())
+		{
+			RS_STACK_MUTEX(mLoopMtx);
+			locked_removeStreamer(s);
+		}
+		return;
+	}
+
+	while(isRegistered(s))
+		rstime::rs_usleep(1000);
+}
+
+bool pqiReactorLoop::isRegistered(pqithreadstreamer *s)
+{
+	RS_STACK_MUTEX(mLoopMtx);
+	return mStreamers.find(s) != mStreamers.end();
+}
+
+void pqiReactorLoop::wakeup(pqithreadstreamer *s)
+{
+	bool signal;
+	{
+		RS_STACK_MUTEX(mLoopMtx);
+
+		if(mStreamers.find(s) == mStreamers.end())
+			return;
+
+		signal = mPending.empty();
+		mPending[s] |= REACTOR_FLAG_WRITE;
+	}
+
+	// When some streamers are already pending, the loop does not sleep.
+	if(signal)
+		signalWakeup();
+}
+
+uint32_t pqiReactorLoop::nbStreamers()
+{
+	RS_STACK_MUTEX(mLoopMtx);
+	return mStreamers.size();
+}
+
+void pqiReactorLoop::threadTick()
+{
+#ifdef __linux__
+	int timeout_ms;
+	{
+		RS_STACK_MUTEX(mLoopMtx);
+
+		if(mPending.empty())
+			timeout_ms = REACTOR_IDLE_WAIT_MS;
+		else
+			timeout_ms = mLastPassActive ? 0 : REACTOR_BUSY_WAIT_MS;
+	}
+
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+	int nb_events = epoll_wait(mEpollFd, events, REACTOR_MAX_EVENTS, timeout_ms);
+
+	if(nb_events < 0)
+	{
+		if(errno != EINTR)
+		{
+			RS_ERR("epoll_wait failed: ", strerror(errno));
+			rstime::rs_usleep(REACTOR_IDLE_WAIT_MS*1000);
+		}
+		return;
+	}
+
+	std::map<pqithreadstreamer*,uint32_t> ready;
+	{
+		RS_STACK_MUTEX(mLoopMtx);
+
+		for(int i=0;i<nb_events;++i)
+		{
+			if(events[i].data.fd == mWakeupFd)
+			{
+				uint64_t count;
+				while(read(mWakeupFd, &count, sizeof(count)) > 0) ;
+				continue;
+			}
+
+			std::map<int,pqithreadstreamer*>::const_iterator it = mFds.find(events[i].data.fd);
+
+			if(it == mFds.end())
+				continue;
+
+			uint32_t& flags(ready[it->second]);
+
+			// errors and hang-ups are handled by reading, which reports them to pqissl
+
+			if(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) flags |= REACTOR_FLAG_READ;
+			if(events[i].events & EPOLLOUT) flags |= REACTOR_FLAG_WRITE;
+		}
+
+		for(std::map<pqithreadstreamer*,uint32_t>::const_iterator it(mPending.begin());it!=mPending.end();++it)
+			ready[it->first] |= it->second;
+
+		mPending.clear();
+
+		rstime_t now = time(NULL);
+
+		if(now >= mLastMaintenanceTS + REACTOR_MAINTENANCE_PERIOD)
+		{
+			for(std::map<pqithreadstreamer*,int>::const_iterator it(mStreamers.begin());it!=mStreamers.end();++it)
+				ready[it->first] |= REACTOR_FLAG_READ | REACTOR_FLAG_WRITE;
+
+			mLastMaintenanceTS = now;
+		}
+
+		for(uint32_t i=0;i<mToRemove.size();++i)
+			ready.erase(mToRemove[i]);
+	}
+
+	// Streamers are ticked off mutex, since ticking them calls services which
+	// may queue new items, hence call wakeup().
+
+	bool active = false;
+	std::vector<std::pair<pqithreadstreamer*,uint32_t> > more_work;
+
+	for(std::map<pqithreadstreamer*,uint32_t>::const_iterator it(ready.begin());it!=ready.end();++it)
+	{
+		uint32_t processed_bytes = 0;
+		bool still_readable = false;
+		bool read_limited = false;
+
+		// Sockets that still have data to read are kept pending, since in edge
+		// triggered mode no new event comes until more data arrives.
+
+		if(it->first->reactorTick(it->second & REACTOR_FLAG_READ, processed_bytes, still_readable, read_limited))
+			more_work.push_back(std::make_pair(it->first, REACTOR_FLAG_WRITE | (still_readable?REACTOR_FLAG_READ:0)));
+		else if(still_readable)
+			more_work.push_back(std::make_pair(it->first, REACTOR_FLAG_READ));
+
+		// Bandwidth limited reads are retried after REACTOR_BUSY_WAIT_MS, rather
+		// than right away, as the per peer threads sleep between two reads.
+
+		if(processed_bytes > 0 && !read_limited)
+			active = true;
+	}
+
+	{
+		RS_STACK_MUTEX(mLoopMtx);
+
+		for(uint32_t i=0;i<more_work.size();++i)
+			if(mStreamers.find(more_work[i].first) != mStreamers.end())
+				mPending[more_work[i].first] |= more_work[i].second;
+
+		for(uint32_t i=0;i<mToRemove.size();++i)
+			locked_removeStreamer(mToRemove[i]);
+
+		mToRemove.clear();
+		mLastPassActive = active;
+
+#ifdef DEBUG_PQIREACTOR
+		RsDbg() << "pqiReactorLoop: " << nb_events << " events, " << ready.size() << " streamers ticked, " << mPending.size() << " still pending";
+#endif
+	}
+#endif
+}
+
+/*********************************************************************************************/
+/*                                         pqiReactor                                        */
+/*********************************************************************************************/
+
+pqiReactor::pqiReactor(const std::vector<pqiReactorLoop*>& loops)
+    : mReactorMtx("pqiReactor"), mLoops(loops) {}
+
+bool pqiReactor::init(uint32_t nb_loops)
+{
+	if(mInstance != nullptr || nb_loops == 0)
+		return false;
+
+	std::vector<pqiReactorLoop*> loops;
+
+	for(uint32_t i=0;i<nb_loops;++i)
+	{
+		pqiReactorLoop *loop = new pqiReactorLoop;
+
+		if(!loop->init())
+		{
+			RS_WARN("Event loops are not available. Using one thread per peer connection.");
+
+			delete loop;
+			for(uint32_t j=0;j<loops.size();++j)
+				delete loops[j];
+
+			return false;
+		}
+		loops.push_back(loop);
+	}
+
+	for(uint32_t i=0;i<loops.size();++i)
+		loops[i]->start("pqi reactor " + std::to_string(i));
+
+	RS_INFO("Peer connections are handled by ", nb_loops, " event loop(s).");
+
+	mInstance = new pqiReactor(loops);
+	return true;
+}
+
+void pqiReactor::shutdown()
+{
+	// The reactor is not deleted, since services may still be sending items
+	// to peers while shutting down. Stopped loops simply ignore them.
+
+	if(!mInstance)
+		return;
+
+	for(uint32_t i=0;i<mInstance->mLoops.size();++i)
+		mInstance->mLoops[i]->fullstop();
+}
+
+pqiReactorLoop *pqiReactor::locked_findLoop(pqithreadstreamer *s)
+{
+	std::map<pqithreadstreamer*,pqiReactorLoop*>::const_iterator it = mAssignedLoops.find(s);
+
+	if(it != mAssignedLoops.end())
+		return it->second;
+
+	return nullptr;
+}
+
+bool pqiReactor::registerStreamer(pqithreadstreamer *s, int fd)
+{
+	pqiReactorLoop *loop;
+	{
+		RS_STACK_MUTEX(mReactorMtx);
+
+		loop = locked_findLoop(s);
+
+		// New streamers go to the least loaded loop, and keep it afterwards so
+		// that a restarted streamer is never ticked from two loops at once.
+
+		if(!loop)
+		{
+			loop = mLoops[0];
+			uint32_t min_load = loop->nbStreamers();
+
+			for(uint32_t i=1;i<mLoops.size();++i)
+			{
+				uint32_t load = mLoops[i]->nbStreamers();
+
+				if(load < min_load)
+				{
+					min_load = load;
+					loop = mLoops[i];
+				}
+			}
+			mAssignedLoops[s] = loop;
+		}
+	}
+
+	return loop->registerStreamer(s, fd);
+}
+
+void pqiReactor::unregisterStreamer(pqithreadstreamer *s, bool wait)
+{
+	pqiReactorLoop *loop;
+	{
+		RS_STACK_MUTEX(mReactorMtx);
+		loop = locked_findLoop(s);
+
+		// Once fully stopped, the streamer is about to be deleted.
+		if(wait)
+			mAssignedLoops.erase(s);
+	}
+
+	if(loop)
+		loop->unregisterStreamer(s, wait);
+}
+
+void pqiReactor::wakeup(pqithreadstreamer *s)
+{
+	pqiReactorLoop *loop;
+	{
+		RS_STACK_MUTEX(mReactorMtx);
+		loop = locked_findLoop(s);
+	}
+
+	if(loop)
+		loop->wakeup(s);
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * libretroshare/src/pqi: pqireactor.h                                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "util/rsthreads.h"
+#include "util/rstime.h"
+
+class pqithreadstreamer;
+
+/*!
+ * \brief The pqiReactorLoop class
+ * 		Event loop thread that multiplexes the sockets of many streamers with
+ * 		epoll in edge triggered mode. A streamer is ticked only when its socket
+ * 		becomes readable/writable, when it queues new outgoing data, or when it
+ * 		still has pending work from the previous pass (e.g. bandwidth limited).
+ */
+class pqiReactorLoop: public RsTickingThread
+{
+public:
+	pqiReactorLoop();
+	virtual ~pqiReactorLoop();
+
+	bool init();
+
+	bool registerStreamer(pqithreadstreamer *s, int fd);
+	void unregisterStreamer(pqithreadstreamer *s, bool wait);
+	void wakeup(pqithreadstreamer *s);
+
+	uint32_t nbStreamers();
+
+	void threadTick() override; /// @see RsTickingThread
+
+protected:
+	void onStopRequested() override;
+
+private:
+	void locked_removeStreamer(pqithreadstreamer *s);
+	void signalWakeup();
+	bool isRegistered(pqithreadstreamer *s);
+
+	int mEpollFd;
+	int mWakeupFd;
+
+	RsMutex mLoopMtx;
+
+	std::map<int,pqithreadstreamer*> mFds;        // socket descriptor -> streamer
+	std::map<pqithreadstreamer*,int> mStreamers;  // streamer -> socket descriptor
+	std::map<pqithreadstreamer*,uint32_t> mPending; // streamers to tick at next pass, with REACTOR_FLAG_*
+	std::vector<pqithreadstreamer*> mToRemove;
+
+	bool mLastPassActive;
+	rstime_t mLastMaintenanceTS;
+};
+
+/*!
+ * \brief The pqiReactor class
+ * 		Fixed pool of event loops that replaces the one thread per peer model
+ * 		of pqithreadstreamer. Disabled by default. When disabled, or when a
+ * 		connection has no OS socket descriptor (e.g. UDP connections that rely
+ * 		on the ToU stack), streamers run their own thread as before.
+ */
+class pqiReactor
+{
+public:
+	/*!
+	 * \brief init  Starts the event loops. Only available where epoll is supported.
+	 * \param nb_loops number of event loop threads
+	 * \return false if the reactor cannot be used, in which case the per peer threads are used.
+	 */
+	static bool init(uint32_t nb_loops);
+	static void shutdown();
+
+	/// @return the reactor, or nullptr when streamers should run their own thread
+	static pqiReactor *instance() { return mInstance; }
+
+	/*!
+	 * \brief registerStreamer Starts ticking the streamer from one of the event loops.
+	 * \return false if the socket cannot be watched
+	 */
+	bool registerStreamer(pqithreadstreamer *s, int fd);
+
+	/*!
+	 * \brief unregisterStreamer Stops ticking the streamer.
+	 * \param wait  if true, returns only when the event loop does not reference the streamer anymore, so that it can be deleted.
+	 */
+	void unregisterStreamer(pqithreadstreamer *s, bool wait);
+
+	/// Called when new outgoing data is queued, so that the streamer gets ticked right away.
+	void wakeup(pqithreadstreamer *s);
+
+private:
+	explicit pqiReactor(const std::vector<pqiReactorLoop*>& loops);
+
+	pqiReactorLoop *locked_findLoop(pqithreadstreamer *s);
+
+	RsMutex mReactorMtx;
+	std::vector<pqiReactorLoop*> mLoops;
+	std::map<pqithreadstreamer*,pqiReactorLoop*> mAssignedLoops;
+
+	static pqiReactor *mInstance;
+};
@@ -41,6 +41,34 @@ bool pqiService::send(RsRawItem *item)
 	return mServiceServer->sendItem(item);
 }
 
+bool pqiService::sendToPeers(RsRawItem *item,const std::set<RsPeerId>& peers)
+{
+	return mServiceServer->sendItemToPeers(item,peers);
+}
+
+bool p3ServiceServerIface::sendItemToPeers(RsRawItem *item,const std::set<RsPeerId>& peers)
+{
+	if (!item)
+	{
+		std::cerr << "p3ServiceServerIface::sendItemToPeers() Caught Null item";
+		std::cerr << std::endl;
+		return false;
+	}
+
+	bool res = !peers.empty();
+
+	for(std::set<RsPeerId>::const_iterator it(peers.begin());it!=peers.end();++it)
+	{
+		RsRawItem *peer_item = item->shareData();
+		peer_item->PeerId(*it);
+
+		res = sendItem(peer_item) && res;
+	}
+
+	delete item;
+	return res;
+}
+
 
 p3ServiceServer::p3ServiceServer(pqiPublisher *pub, p3ServiceControl *ctrl) : mPublisher(pub), mServiceControl(ctrl), srvMtx("p3ServiceServer") 
 {
@@ -67,6 +67,7 @@ public:
 	//
 	virtual bool	recv(RsRawItem *) = 0;
 	virtual bool	send(RsRawItem *item);
+	virtual bool	sendToPeers(RsRawItem *item,const std::set<RsPeerId>& peers);
 
 	virtual RsServiceInfo getServiceInfo() = 0;
 
@@ -97,6 +98,10 @@ public:
 	virtual bool	recvItem(RsRawItem *) = 0;
 	virtual bool	sendItem(RsRawItem *) = 0;
 
+	// Sends the same item to all the given peers. The serialised data is shared
+	// between the items that are queued, and not copied. The item is deleted.
+	virtual bool	sendItemToPeers(RsRawItem *item,const std::set<RsPeerId>& peers);
+
 	virtual bool    getServiceItemNames(uint32_t service_type,std::map<uint8_t,std::string>& names) =0;
 };
 
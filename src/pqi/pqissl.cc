@@ -1707,6 +1707,12 @@ int 	pqissl::isactive()
     return active;	// no need to mutex this. It's atomic.
 }
 
+int	pqissl::socketDescriptor()
+{
+	RsStackMutex stack(mSslMtx); /**** LOCKED MUTEX ****/
+	return sockfd;
+}
+
 bool 	pqissl::moretoread(uint32_t usec)
 {
 	RsStackMutex stack(mSslMtx); /**** LOCKED MUTEX ****/
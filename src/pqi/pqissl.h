@@ -174,6 +174,7 @@ virtual bool cansend(uint32_t usec);
 virtual int close(); /* BinInterface version of reset() */
 virtual RsFileHash gethash(); /* not used here */
 virtual bool bandwidthLimited() { return true ; }
+virtual int socketDescriptor();
 
 public:
 
@@ -55,6 +55,9 @@ public:
 	virtual bool cansend(uint32_t usec);
 	/* UDP always through firewalls -> always bandwidth Limited */
 	virtual bool bandwidthLimited() { return true; }
+	/* ToU sockets are not OS descriptors, so that they cannot be watched by
+	 * the pqiReactor event loops. */
+	virtual int socketDescriptor() { return -1; }
 
 protected:
 
@@ -52,6 +52,8 @@ static const float PQISTREAM_AVG_DT_FRAC                        = 0.99;
 
 static const int   PQISTREAM_OPTIMAL_PACKET_SIZE  		= 1400;		// It is believed that this value should be lower than TCP slices and large enough as compare to encryption padding.
 										// most importantly, it should be constant, so as to allow correct QoS.
+static const int   PQISTREAM_MAX_WRITE_SIZE  			= 16384;	// Largest TLS record. Slices are grouped up to this size when sending bulk data.
+static const int   PQISTREAM_MAX_KEPT_WRITE_BUFFER_SIZE	= 65536;	// Write buffers larger than this (for unsliced packets) are released after use.
 static const int   PQISTREAM_SLICE_FLAG_STARTS			= 0x01;		// 
 static const int   PQISTREAM_SLICE_FLAG_ENDS 			= 0x02;		// these flags should be kept in the range 0x01-0x08
 static const int   PQISTREAM_SLICE_PROTOCOL_VERSION_ID_01     = 0x10;		// Protocol version ID. Should hold on the 4 lower bits.
@@ -96,8 +98,9 @@ static double getCurrentTS()
 
 pqistreamer::pqistreamer(RsSerialiser *rss, const RsPeerId& id, BinInterface *bio_in, int bio_flags_in)
 	:PQInterface(id), mStreamerMtx("pqistreamer"),
-	mBio(bio_in), mBio_flags(bio_flags_in), mRsSerialiser(rss), 
-	mPkt_wpending(NULL), mPkt_wpending_size(0),
+	mBio(bio_in), mBio_flags(bio_flags_in),
+	mOutWriteCount(0), mOutWriteBytes(0), mOutAllocCount(0),
+	mRsSerialiser(rss),
 	mTotalRead(0), mTotalSent(0),
 	mCurrRead(0), mCurrSent(0),
 	mAvgReadCount(0), mAvgSentCount(0),
@@ -117,6 +120,9 @@ pqistreamer::pqistreamer(RsSerialiser *rss, const RsPeerId& id, BinInterface *bi
 
 	mAvgLastUpdate = mCurrSentTS = mCurrReadTS = getCurrentTS();
 
+	mPkt_wpending.reserve(PQISTREAM_MAX_WRITE_SIZE) ;
+	++mOutAllocCount ;
+
 	mIncomingSize = 0 ;
 	mIncomingSize_bytes = 0;
 
@@ -125,6 +131,7 @@ pqistreamer::pqistreamer(RsSerialiser *rss, const RsPeerId& id, BinInterface *bi
 	mPkt_rpend_size = 0;
 	mPkt_rpending = 0;
 	mReading_state = reading_state_initial ;
+	mIncomingLimited = false ;
 
 	pqioutput(PQL_DEBUG_ALL, pqistreamerzone, "pqistreamer::pqistreamer() Initialisation!");
 
@@ -362,6 +369,13 @@ int 	pqistreamer::tick_send(uint32_t timeout)
 	return sentbytes;
 }
 
+bool	pqistreamer::hasPendingOutgoingData()
+{
+	RsStackMutex stack(mStreamerMtx); /**** LOCKED MUTEX ****/
+
+	return !mPkt_wpending.empty() || locked_out_queue_size() > 0;
+}
+
 int	pqistreamer::status()
 {
 	RsStackMutex stack(mStreamerMtx); /**** LOCKED MUTEX ****/
@@ -555,12 +569,7 @@ int	pqistreamer::handleoutgoing_locked()
         	mAcceptsPacketSlicing = false ;
 
 	    /* also remove the pending packets */
-	    if (mPkt_wpending)
-	    {
-		    free(mPkt_wpending);
-		    mPkt_wpending = NULL;
-		    	mPkt_wpending_size = 0 ;
-	    }
+	    mPkt_wpending.clear() ;
 
 //	    RsDbg() << "PQISTREAMER pqistreamer::handleoutgoing_locked() stopped mBio->isactive() false";
 	    return 0;
@@ -588,11 +597,10 @@ int	pqistreamer::handleoutgoing_locked()
             //	- grab as many packets as possible while below the optimal packet size, so as to allow some packing and decrease encryption padding overhead (suposeddly)
             //	- limit packets size to OPTIMAL_PACKET_SIZE when sending big packets so as to keep as much QoS as possible.
         
-	    if (!mPkt_wpending)
+	    if (mPkt_wpending.empty())
 	{
-		void *dta;
-		mPkt_wpending_size = 0 ;
 		int k=0;
+		size_t capacity = mPkt_wpending.capacity() ;
 
         	// Checks for inserting a packet slicing probe. We do that to send the other peer the information that packet slicing can be used.
         	// if so, we enable it for the session. This should be removed (because it's unnecessary) when all users have switched to the new version.
@@ -603,14 +611,17 @@ int	pqistreamer::handleoutgoing_locked()
 #ifdef DEBUG_PACKET_SLICING
                 	std::cerr << "(II) Inserting packet slicing probe in traffic" << std::endl;
 #endif
-                    
-                    	mPkt_wpending_size = 8 ;
-                    	mPkt_wpending = rs_malloc(8) ;
-                        memcpy(mPkt_wpending,PACKET_SLICING_PROBE_BYTES,8) ;
+                        mPkt_wpending.insert(mPkt_wpending.end(),PACKET_SLICING_PROBE_BYTES,PACKET_SLICING_PROBE_BYTES+8) ;
                         
                 	mLastSentPacketSlicingProbe = now ;
         	}
             
+		// When the queue holds enough data (i.e. bulk data such as file transfer is being sent) slices are grouped up to a full TLS
+		// record, which saves write calls and record overhead. Slices keep the same size, so that high priority items still get in
+		// between at the same rate. Otherwise, we only group up to the optimal packet size, as before.
+
+		bool bulk = !DISABLE_PACKET_GROUPING && mAcceptsPacketSlicing && locked_compute_out_pkt_size() >= PQISTREAM_MAX_WRITE_SIZE ;
+
         	uint32_t slice_size=0;
 		bool slice_starts=true ;
 		bool slice_ends=true ;
@@ -619,10 +630,9 @@ int	pqistreamer::handleoutgoing_locked()
 		do
 		{
             		int desired_packet_size = mAcceptsPacketSlicing?PQISTREAM_OPTIMAL_PACKET_SIZE:(getRsPktMaxSize());
-                    
-			dta = locked_pop_out_data(desired_packet_size,slice_size,slice_starts,slice_ends,slice_packet_id) ;
+			uint32_t offset = mPkt_wpending.size() ;
 
-			if(!dta)
+			if(!locked_append_out_data(mPkt_wpending,desired_packet_size,slice_size,slice_starts,slice_ends,slice_packet_id))
 				break ;
 
 			if(slice_starts && slice_ends)	// good old method. Send the packet as is, since it's a full packet.
@@ -630,10 +640,6 @@ int	pqistreamer::handleoutgoing_locked()
 #ifdef DEBUG_PACKET_SLICING
 				std::cerr << "sending full slice, old style. Size=" << slice_size << std::endl;
 #endif
-				mPkt_wpending = realloc(mPkt_wpending,slice_size+mPkt_wpending_size) ;
-				memcpy( &((char*)mPkt_wpending)[mPkt_wpending_size],dta,slice_size) ;
-				free(dta);
-				mPkt_wpending_size += slice_size ;
 				++k ;
 			}
 			else	// partial packet. We make a special header for it and insert it in the stream
@@ -641,8 +647,7 @@ int	pqistreamer::handleoutgoing_locked()
 				if(slice_size > 0xffff || !mAcceptsPacketSlicing)
 				{
 					std::cerr << "(EE) protocol error in pqistreamer: slice size is too large and cannot be encoded." ;
-					free(mPkt_wpending) ;
-					mPkt_wpending_size = 0;
+					mPkt_wpending.clear() ;
 //					RsDbg() << "PQISTREAMER pqistreamer::handleoutgoing_locked() stopped error slice size is too large";
 					return sentbytes ;
 				}
@@ -650,58 +655,64 @@ int	pqistreamer::handleoutgoing_locked()
 				std::cerr << "sending partial slice, packet ID=" << std::hex << slice_packet_id << std::dec << ", size=" << slice_size << std::endl;
 #endif
 
-				mPkt_wpending = realloc(mPkt_wpending,slice_size+mPkt_wpending_size+PQISTREAM_PARTIAL_PACKET_HEADER_SIZE) ;
-				memcpy( &((char*)mPkt_wpending)[mPkt_wpending_size+PQISTREAM_PARTIAL_PACKET_HEADER_SIZE],dta,slice_size) ;
-				free(dta);
-
 				// New2: pp ff xxxxxxxx ssss  [data, sss bytes] => [flags 1B] [protocol version 1B] [2^32 packet count] [2^16 size]
 
 				uint8_t partial_flags = 0 ;
 				if(slice_starts) partial_flags |= PQISTREAM_SLICE_FLAG_STARTS  ;
 				if(slice_ends  ) partial_flags |= PQISTREAM_SLICE_FLAG_ENDS  ;
 
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x00] = PQISTREAM_SLICE_PROTOCOL_VERSION_ID_01 ;
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x01] = partial_flags ;
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x02] = uint8_t(slice_packet_id >> 24) & 0xff ;
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x03] = uint8_t(slice_packet_id >> 16) & 0xff ;
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x04] = uint8_t(slice_packet_id >>  8) & 0xff ;
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x05] = uint8_t(slice_packet_id >>  0) & 0xff ;	
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x06] = uint8_t(slice_size      >>  8) & 0xff ;
-				((char*)mPkt_wpending)[mPkt_wpending_size+0x07] = uint8_t(slice_size      >>  0) & 0xff ;
+				uint8_t header[PQISTREAM_PARTIAL_PACKET_HEADER_SIZE] ;
+
+				header[0x00] = PQISTREAM_SLICE_PROTOCOL_VERSION_ID_01 ;
+				header[0x01] = partial_flags ;
+				header[0x02] = uint8_t(slice_packet_id >> 24) & 0xff ;
+				header[0x03] = uint8_t(slice_packet_id >> 16) & 0xff ;
+				header[0x04] = uint8_t(slice_packet_id >>  8) & 0xff ;
+				header[0x05] = uint8_t(slice_packet_id >>  0) & 0xff ;
+				header[0x06] = uint8_t(slice_size      >>  8) & 0xff ;
+				header[0x07] = uint8_t(slice_size      >>  0) & 0xff ;
 
-				mPkt_wpending_size += slice_size + PQISTREAM_PARTIAL_PACKET_HEADER_SIZE;
+				mPkt_wpending.insert(mPkt_wpending.begin()+offset,header,header+PQISTREAM_PARTIAL_PACKET_HEADER_SIZE) ;
 				++k ;
 			}
 		} 
-                 while(mPkt_wpending_size < (uint32_t)maxbytes && mPkt_wpending_size < PQISTREAM_OPTIMAL_PACKET_SIZE && !DISABLE_PACKET_GROUPING) ;
+                 while(mPkt_wpending.size() < (uint32_t)maxbytes && !DISABLE_PACKET_GROUPING
+		       && (bulk ? mPkt_wpending.size() + PQISTREAM_OPTIMAL_PACKET_SIZE + PQISTREAM_PARTIAL_PACKET_HEADER_SIZE <= (uint32_t)PQISTREAM_MAX_WRITE_SIZE
+		                : mPkt_wpending.size() < (uint32_t)PQISTREAM_OPTIMAL_PACKET_SIZE)) ;
+
+		if(mPkt_wpending.capacity() != capacity)
+			++mOutAllocCount ;
              
 #ifdef DEBUG_PQISTREAMER
 		if(k > 1)
-			std::cerr << "Packed " << k << " packets into " << mPkt_wpending_size << " bytes." << std::endl;
+			std::cerr << "Packed " << k << " packets into " << mPkt_wpending.size() << " bytes." << std::endl;
 #endif
 	}
         
-	    if (mPkt_wpending)
+	    if (!mPkt_wpending.empty())
 	    {
 		    // write packet.
 #ifdef DEBUG_PQISTREAMER
-		std::cout << "Sending Out Pkt of size " << mPkt_wpending_size << " !" << std::endl;
+		std::cout << "Sending Out Pkt of size " << mPkt_wpending.size() << " !" << std::endl;
 #endif
             		int ss=0;
+		    uint32_t wpending_size = mPkt_wpending.size() ;
+
+		    ++mOutWriteCount ;
 
-		    if (mPkt_wpending_size != (uint32_t)(ss = mBio->senddata(mPkt_wpending, mPkt_wpending_size)))
+		    if (wpending_size != (uint32_t)(ss = mBio->senddata(mPkt_wpending.data(), wpending_size)))
 		    {
 #ifdef DEBUG_PQISTREAMER
 			    std::string out;
-			    rs_sprintf(out, "Problems with Send Data! (only %d bytes sent, total pkt size=%d)", ss, mPkt_wpending_size);
+			    rs_sprintf(out, "Problems with Send Data! (only %d bytes sent, total pkt size=%d)", ss, wpending_size);
 			    //				std::cerr << out << std::endl ;
 			    pqioutput(PQL_DEBUG_BASIC, pqistreamerzone, out);
 #endif
-                		std::cerr << PeerId() << ": sending failed. Only " << ss << " bytes sent over " << mPkt_wpending_size << std::endl;
+                		std::cerr << PeerId() << ": sending failed. Only " << ss << " bytes sent over " << wpending_size << std::endl;
 
 			    // pkt_wpending will kept til next time.
 			    // ensuring exactly the same data is written (openSSL requirement).
-//			    RsDbg() << "PQISTREAMER pqistreamer::handleoutgoing_locked() stopped sending failed only " << std::dec << ss << " bytes out of " << mPkt_wpending_size;
+//			    RsDbg() << "PQISTREAMER pqistreamer::handleoutgoing_locked() stopped sending failed only " << std::dec << ss << " bytes out of " << wpending_size;
 			    return sentbytes;
 		    }
 #ifdef DEBUG_PQISTREAMER
@@ -710,19 +721,26 @@ int	pqistreamer::handleoutgoing_locked()
 #endif
             
 		    ++nsent;
+		    mOutWriteBytes += wpending_size ;
             
-            outSentBytes_locked(mPkt_wpending_size);	// this is the only time where we know exactly what was sent.
+            outSentBytes_locked(wpending_size);	// this is the only time where we know exactly what was sent.
 
 #ifdef DEBUG_TRANSFERS
-            std::cerr << "pqistreamer::handleoutgoing_locked() Sent Packet len: " << mPkt_wpending_size << " @ " << getCurrentTS();
+            std::cerr << "pqistreamer::handleoutgoing_locked() Sent Packet len: " << wpending_size << " @ " << getCurrentTS();
 		    std::cerr << std::endl;
 #endif
 
-		    sentbytes += mPkt_wpending_size;
+		    sentbytes += wpending_size;
             
-		    free(mPkt_wpending);
-		    mPkt_wpending = NULL;
-		    mPkt_wpending_size = 0 ;
+		    mPkt_wpending.clear() ;
+
+		    // Unsliced packets may be very large. Don't keep that memory.
+
+		    if(mPkt_wpending.capacity() > (size_t)PQISTREAM_MAX_KEPT_WRITE_BUFFER_SIZE)
+		    {
+			    std::vector<uint8_t>().swap(mPkt_wpending) ;
+			    ++mOutAllocCount ;
+		    }
 
             sent = true;
 	    }
@@ -744,6 +762,8 @@ int pqistreamer::handleincoming()
     int readbytes = 0;
     static const int max_failed_read_attempts = 2000 ;
 
+    mIncomingLimited = false ;
+
 #ifdef DEBUG_PQISTREAMER
     pqioutput(PQL_DEBUG_ALL, pqistreamerzone, "pqistreamer::handleincoming()");
 #endif
@@ -1069,6 +1089,8 @@ continue_packet:
     if(maxin > readbytes && mBio->moretoread(0))
 	    goto start_packet_read ;
 
+    mIncomingLimited = (readbytes >= maxin) ;	// there may be more to read, but not before the next round
+
 #ifdef DEBUG_PQISTREAMER
 	if (readbytes > maxin)
 		RsDbg() << "PQISTREAMER pqistreamer::handleincoming() stopped reading max reached, readbytes " << std::dec << readbytes << " maxin " << maxin;
@@ -1371,15 +1393,13 @@ void pqistreamer::free_pend()
 	}
 	mPkt_rpend_size = 0;
 
-	if (mPkt_wpending)
+	if (!mPkt_wpending.empty())
 	{
 #ifdef DEBUG_PQISTREAMER
         		std::cerr << "pqistreamer::free_pend(): pending output packet buffer" << std::endl;
 #endif
-		free(mPkt_wpending);
-		mPkt_wpending = NULL;
+		mPkt_wpending.clear();
 	}
-	mPkt_wpending_size = 0 ;
 
 #ifdef DEBUG_PQISTREAMER
     if(!mPartialPackets.empty())
@@ -1450,6 +1470,10 @@ void pqistreamer::getRates(RsBwRates &rates)
      		rates.mTotalIn = (uint64_t)mTotalRead;
 		rates.mTotalOut = (uint64_t)mTotalSent;
 
+		rates.mOutWrites = mOutWriteCount;
+		rates.mOutWriteBytes = mOutWriteBytes;
+		rates.mOutAllocs = mOutAllocCount;
+
 		/* Debug message */
 		//RsDbg() << "BWSUM Source [Streamer] Peer: " << PeerId() << " | In: " << rates.mTotalIn << " | Out: " << rates.mTotalOut;
 
@@ -1483,6 +1507,22 @@ void pqistreamer::locked_clear_out_queue()
 	}
 }
 
+// this method is overloaded by pqiqosstreamer
+bool pqistreamer::locked_append_out_data(std::vector<uint8_t>& buf, uint32_t max_slice_size, uint32_t& size, bool& starts, bool& ends, uint32_t& packet_id)
+{
+	void *dta = locked_pop_out_data(max_slice_size,size,starts,ends,packet_id) ;
+
+	if(!dta)
+		return false ;
+
+	buf.insert(buf.end(),(uint8_t*)dta,(uint8_t*)dta+size) ;
+
+	free(dta) ;
+	++mOutAllocCount ;
+
+	return true ;
+}
+
 // this method is overloaded by pqiqosstreamer
 int pqistreamer::locked_compute_out_pkt_size() const
 {
@@ -27,6 +27,7 @@
 #include <iostream>               // for operator<<, basic_ostream, cerr, endl
 #include <list>                   // for list
 #include <map>                    // for map
+#include <vector>                 // for vector
 
 #include "pqi/pqi_base.h"         // for BinInterface (ptr only), PQInterface
 #include "retroshare/rsconfig.h"  // for RSTrafficClue
@@ -91,6 +92,9 @@ class pqistreamer: public PQInterface
 		int tick_send(uint32_t timeout);
 		int tick_recv(uint32_t timeout);
 
+		bool hasPendingOutgoingData(); // items in the out queue, or packet partially written.
+		bool incomingLimited() const { return mIncomingLimited; } // last read stopped by the bandwidth limit. Only valid in the reading thread.
+
 		/* Implementation */
 
 		// These methods are redefined in pqiQoSstreamer
@@ -100,6 +104,7 @@ class pqistreamer: public PQInterface
 		virtual void locked_clear_out_queue() ;
 		virtual int locked_compute_out_pkt_size() const ;
 		virtual void *locked_pop_out_data(uint32_t max_slice_size,uint32_t& size,bool& starts,bool& ends,uint32_t& packet_id);
+		virtual bool  locked_append_out_data(std::vector<uint8_t>& buf,uint32_t max_slice_size,uint32_t& size,bool& starts,bool& ends,uint32_t& packet_id);	// same, but appends the data to buf
 		virtual int   locked_gatherStatistics(std::list<RSTrafficClue>& outqueue_stats,std::list<RSTrafficClue>& inqueue_stats); // extracting data.
 
         	void updateRates() ;
@@ -111,6 +116,11 @@ class pqistreamer: public PQInterface
 		BinInterface *mBio;
 		unsigned int  mBio_flags; // BIN_FLAGS_NO_CLOSE | BIN_FLAGS_NO_DELETE
 
+		// output statistics
+		uint64_t mOutWriteCount;	// calls to BinInterface::senddata()
+		uint64_t mOutWriteBytes;	// bytes written by these calls
+		uint64_t mOutAllocCount;	// allocations/frees of memory while preparing writes
+
 	private:
 		int queue_outpqi_locked(RsItem *i,uint32_t& serialized_size);
 		int handleincomingitem(RsItem *i, int len);
@@ -135,8 +145,9 @@ class pqistreamer: public PQInterface
 		// RsSerialiser - determines which packets can be serialised.
 		RsSerialiser *mRsSerialiser;
 
-		void *mPkt_wpending; // storage for pending packet to write.
-        	uint32_t mPkt_wpending_size; // ... and its size.
+		// Storage for the pending data to write. Its memory is kept between writes, and it is only
+		// modified once completely written (openSSL requirement).
+		std::vector<uint8_t> mPkt_wpending;
 
 		void allocate_rpend(); // use these two functions to allocate/free the buffer below
         
@@ -147,6 +158,7 @@ class pqistreamer: public PQInterface
 
 		int   mReading_state ;
 		int   mFailed_read_attempts ;
+		bool  mIncomingLimited ;
 
 		// Temp Storage for transient data.....
 		std::list<void *> mOutPkts; // Cntrl / Search / Results queue
@@ -21,6 +21,7 @@
  *******************************************************************************/
 #include "util/rstime.h"
 #include "pqi/pqithreadstreamer.h"
+#include "pqi/pqireactor.h"
 #include <unistd.h>
 
 // for timeBeginPeriod
@@ -39,10 +40,12 @@
 
 #define DEFAULT_STREAMER_IDLE_SLEEP	1000000 //  1 sec
 
+#define REACTOR_MAX_READS_PER_TICK           16 // read loops before giving other streamers a chance
+
 // #define PQISTREAMER_DEBUG
 
 pqithreadstreamer::pqithreadstreamer(PQInterface *parent, RsSerialiser *rss, const RsPeerId& id, BinInterface *bio_in, int bio_flags_in)
-:pqistreamer(rss, id, bio_in, bio_flags_in), mParent(parent), mTimeout(0), mThreadMutex("pqithreadstreamer")
+:pqistreamer(rss, id, bio_in, bio_flags_in), mParent(parent), mTimeout(0), mThreadMutex("pqithreadstreamer"), mInReactor(false)
 {
 #ifdef WINDOWS_SYS
         // On Windows, the default system timer resolution is around 15 ms.
@@ -59,6 +62,118 @@ bool pqithreadstreamer::RecvItem(RsItem *item)
 	return mParent->RecvItem(item);
 }
 
+int pqithreadstreamer::SendItem(RsItem *item,uint32_t& serialized_size)
+{
+	int ret = pqistreamer::SendItem(item,serialized_size);
+
+	// In reactor mode nobody polls the outgoing queue, so the event loop must be told.
+	if(mInReactor)
+	{
+		pqiReactor *reactor = pqiReactor::instance();
+		if(reactor) reactor->wakeup(this);
+	}
+
+	return ret;
+}
+
+void pqithreadstreamer::startStreaming(const std::string& threadName)
+{
+	pqiReactor *reactor = pqiReactor::instance();
+
+	if(reactor)
+	{
+		int fd;
+		{
+			RsStackMutex stack(mStreamerMtx);
+			fd = mBio->socketDescriptor();
+		}
+
+		if(fd >= 0 && reactor->registerStreamer(this, fd))
+		{
+			mInReactor = true;
+			return;
+		}
+	}
+
+	mInReactor = false;
+	start(threadName);
+}
+
+void pqithreadstreamer::stopStreaming()
+{
+	pqiReactor *reactor = pqiReactor::instance();
+
+	if(reactor && mInReactor.exchange(false))
+		reactor->unregisterStreamer(this, false);
+
+	askForStop();
+}
+
+void pqithreadstreamer::fullstopStreaming()
+{
+	pqiReactor *reactor = pqiReactor::instance();
+
+	mInReactor = false;
+
+	// also called on streamers that never ran in the reactor, which is harmless
+	if(reactor)
+		reactor->unregisterStreamer(this, true);
+
+	fullstop();
+}
+
+bool pqithreadstreamer::reactorTick(bool readable, uint32_t& processed_bytes, bool& still_readable, bool& read_limited)
+{
+	processed_bytes = 0;
+	still_readable = false;
+	read_limited = false;
+
+	{
+		RsStackMutex stack(mStreamerMtx);
+		if(!mBio->isactive())
+			return false;
+	}
+
+	updateRates();
+
+	// Sockets are watched in edge triggered mode, so they must be drained.
+	// The loop is bounded to keep other streamers of the event loop responsive.
+	// When the bandwidth limit stops it, the socket still has data but no new
+	// event will come for it, so that it must be read again at next pass.
+
+	if(readable)
+	{
+		RsStackMutex stack(mThreadMutex);
+
+		uint32_t n = 0;
+		int readbytes = 0;
+
+		while((readbytes = tick_recv(0)) > 0)
+		{
+			processed_bytes += readbytes;
+
+			read_limited = incomingLimited();
+
+			if(++n >= REACTOR_MAX_READS_PER_TICK || read_limited)
+			{
+				still_readable = true;
+				break;
+			}
+		}
+	}
+
+	RsItem *incoming = NULL;
+	while((incoming = GetItem()))
+		RecvItem(incoming);
+
+	{
+		RsStackMutex stack(mThreadMutex);
+		processed_bytes += tick_send(0);
+	}
+
+	return hasPendingOutgoingData();
+}
+
 int	pqithreadstreamer::tick()
 {
 	// pqithreadstreamer mutex lock is not needed here
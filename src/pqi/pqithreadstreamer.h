@@ -22,6 +22,8 @@
 #ifndef MRK_PQI_THREAD_STREAMER_HEADER
 #define MRK_PQI_THREAD_STREAMER_HEADER
 
+#include <atomic>
+
 #include "pqi/pqistreamer.h"
 #include "util/rsthreads.h"
 
@@ -34,6 +36,29 @@ public:
     virtual bool RecvItem(RsItem *item) override;
     virtual int  tick() override;
 
+    using pqistreamer::SendItem;
+    virtual int  SendItem(RsItem *item,uint32_t& serialized_size) override;
+
+    /*!
+     * \brief startStreaming
+     * 		Starts sending/receiving data. The streamer is ticked by the pqiReactor event loops when
+     * 		available, and by its own thread otherwise.
+     */
+    void startStreaming(const std::string& threadName);
+    void stopStreaming();		// asynchronous
+    void fullstopStreaming();	// waits until the streamer is not ticked anymore
+
+    /*!
+     * \brief reactorTick
+     * 		Called by the pqiReactor event loop when the socket is ready or new data has been queued.
+     * \param readable        socket has data to read
+     * \param processed_bytes bytes read and sent
+     * \param still_readable  the read loop stopped before the socket was drained
+     * \param read_limited    the read loop was stopped by the bandwidth limit
+     * \return true if outgoing data is still waiting to be sent
+     */
+    bool reactorTick(bool readable, uint32_t& processed_bytes, bool& still_readable, bool& read_limited);
+
 protected:
 	void threadTick() override; /// @see RsTickingThread
 
@@ -44,6 +69,8 @@ protected:
 private:
     /* thread variables */
     RsMutex mThreadMutex;
+
+    std::atomic<bool> mInReactor;
 };
 
 #endif //MRK_PQI_THREAD_STREAMER_HEADER
@@ -124,9 +124,34 @@ public:
 	        const sockaddr_storage& addr, int masked_bytes, uint32_t list_type
 	        ) = 0;
 
+	/**
+	 * @brief Import a list of IP ranges from a file, such as a public
+	 *	blocklist. Each line holds either a CIDR prefix or a single address
+	 *	(IPv4 or IPv6), an address range "first - last", a P2P range
+	 *	"name:first-last" or an ipfilter.dat entry "first - last , level ,
+	 *	name". Empty lines and lines starting with '#' are ignored. Importing
+	 *	the same file again replaces its previous content. Imported files are
+	 *	imported again at each start.
+	 * @jsonapi{development}
+	 * @param[in] path path of the file
+	 * @param[in] list_type RSBANLIST_TYPE_WHITELIST or RSBANLIST_TYPE_BLACKLIST
+	 * @param[out] nb_ranges number of prefixes the ranges were split into
+	 * @return false if the file cannot be read or contains no range
+	 */
+	virtual bool importIpList(
+	        const std::string& path, uint32_t list_type,
+	        uint32_t& nb_ranges = RS_DEFAULT_STORAGE_PARAM(uint32_t) ) = 0;
+
+	/**
+	 * @brief Forget all the imported lists of the given type
+	 * @jsonapi{development}
+	 * @param[in] list_type RSBANLIST_TYPE_WHITELIST or RSBANLIST_TYPE_BLACKLIST
+	 */
+	virtual void clearImportedIpLists(uint32_t list_type) = 0;
+
 	/**
 	 * @brief isAddressAccepted
-	 * @param addr full IPv4 address. Port is ignored.
+	 * @param addr full IPv4 or IPv6 address. Port is ignored.
 	 * @param checking_flags any combination of
 	 * 	RSBANLIST_CHECKING_FLAGS_BLACKLIST and
 	 * 	RSBANLIST_CHECKING_FLAGS_WHITELIST
@@ -593,6 +593,14 @@ public:
      */
     virtual bool getLobbyAutoSubscribe(const ChatLobbyId &lobby_id) = 0 ;
 
+    /**
+     * @brief getLobbyBouncingStatistics get statistics about lobby messages and events received from several friends
+     * @jsonapi{development}
+     * @param[out] duplicatesDropped number of lobby messages and events dropped because they were already received
+     * @param[out] verificationsSaved number of signature checks avoided by dropping them
+     */
+    virtual void getLobbyBouncingStatistics(uint64_t& duplicatesDropped, uint64_t& verificationsSaved) = 0 ;
+
     /**
      * @brief createChatLobby create a new chat lobby
      * @jsonapi{development}
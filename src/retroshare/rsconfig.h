@@ -151,7 +151,8 @@ struct RsConfigDataRates : RsSerializable
 	    mAllowedTs(0),
 	    mQueueIn(0), mQueueOut(0),
 	    mQueueOutBytes(0),
-	    mTotalIn(0), mTotalOut(0)
+	    mTotalIn(0), mTotalOut(0),
+	    mOutWrites(0), mOutWriteBytes(0), mOutAllocs(0)
 	{}
 
 	/* all in kB/s */
@@ -174,6 +175,10 @@ struct RsConfigDataRates : RsSerializable
 	uint64_t mTotalIn;  // Total bytes received (cumulative)
 	uint64_t mTotalOut; // Total bytes sent (cumulative)
 
+	uint64_t mOutWrites;     // Write calls to the network layer (cumulative)
+	uint64_t mOutWriteBytes; // Bytes sent through these calls (cumulative). mOutWriteBytes/mOutWrites is the average write size.
+	uint64_t mOutAllocs;     // Memory allocations on the outgoing path (cumulative)
+
 	// RsSerializable interface
 	void serial_process(RsGenericSerializer::SerializeJob j, RsGenericSerializer::SerializeContext &ctx) {
 		RS_SERIAL_PROCESS(mRateIn);
@@ -194,6 +199,10 @@ struct RsConfigDataRates : RsSerializable
 
 		RS_SERIAL_PROCESS(mTotalIn);
 		RS_SERIAL_PROCESS(mTotalOut);
+
+		RS_SERIAL_PROCESS(mOutWrites);
+		RS_SERIAL_PROCESS(mOutWriteBytes);
+		RS_SERIAL_PROCESS(mOutAllocs);
 	}
 };
 
@@ -264,6 +273,40 @@ struct RsCumulativeTrafficStats : RsSerializable
     }
 };
 
+/*!
+ * \brief Time spent by received items before the service handles them, from
+ * the reception of the packet to the moment the service takes the item from
+ * its incoming queue. Services that handle items upon reception are not counted.
+ */
+struct RsServiceItemLatencyStats : RsSerializable
+{
+    uint64_t nbItems;         //< Number of items handled
+    float    averageLatency;  //< in milliseconds
+    float    maxLatency;      //< in milliseconds
+
+    uint64_t below1ms;        //< Number of items handled within 1 ms
+    uint64_t below10ms;       //< Number of items handled within 1 to 10 ms
+    uint64_t below50ms;       //< Number of items handled within 10 to 50 ms
+    uint64_t below200ms;      //< Number of items handled within 50 to 200 ms
+    uint64_t above200ms;      //< Number of items handled after more than 200 ms
+
+    RsServiceItemLatencyStats() :
+        nbItems(0), averageLatency(0), maxLatency(0),
+        below1ms(0), below10ms(0), below50ms(0), below200ms(0), above200ms(0) {}
+
+    // RsSerializable interface
+    void serial_process(RsGenericSerializer::SerializeJob j, RsGenericSerializer::SerializeContext &ctx) {
+        RS_SERIAL_PROCESS(nbItems);
+        RS_SERIAL_PROCESS(averageLatency);
+        RS_SERIAL_PROCESS(maxLatency);
+        RS_SERIAL_PROCESS(below1ms);
+        RS_SERIAL_PROCESS(below10ms);
+        RS_SERIAL_PROCESS(below50ms);
+        RS_SERIAL_PROCESS(below200ms);
+        RS_SERIAL_PROCESS(above200ms);
+    }
+};
+
 struct RsConfigNetStatus : RsSerializable
 {
 	RsConfigNetStatus() : netLocalOk(true)
@@ -423,6 +466,21 @@ public:
 	 */
     virtual bool getTotalCumulativeTraffic(RsCumulativeTrafficStats& stats) = 0;
 
+	/**
+	 * @brief getServiceItemLatency returns the time received items waited before their service handled them
+	 * @jsonapi{development}
+	 * @param[out] stats latency statistics since startup or since the last call to clearServiceItemLatency()
+	 * @return returns true on success
+	 */
+    virtual bool getServiceItemLatency(RsServiceItemLatencyStats& stats) = 0;
+
+	/**
+	 * @brief clearServiceItemLatency clears the statistics returned by getServiceItemLatency()
+	 * @jsonapi{development}
+	 * @return returns true on success
+	 */
+    virtual bool clearServiceItemLatency() = 0;
+
     /* From RsInit */
 
     // NOT IMPLEMENTED YET!
@@ -723,6 +723,22 @@ public:
 	 */
 	virtual FileChunksInfo::ChunkStrategy defaultChunkStrategy() = 0;
 
+	/**
+	 * @brief Set the algorithm used by downloads to decide how much data to
+	 *	request from each source. Also applies to the current downloads.
+	 * @jsonapi{development}
+	 * @param[in] rateControl
+	 */
+	virtual void setDefaultRateControl(FileTransferRateControl rateControl) = 0;
+
+	/**
+	 * @brief Get the algorithm used by downloads to decide how much data to
+	 *	request from each source
+	 * @jsonapi{development}
+	 * @return current rate control algorithm
+	 */
+	virtual FileTransferRateControl defaultRateControl() = 0;
+
 	/**
 	 * @brief Get free disk space limit
 	 * @jsonapi{development}
@@ -1220,6 +1236,9 @@ public:
         virtual void setMaxShareDepth(int depth) =0;
         virtual int  maxShareDepth() const=0;
 
+        virtual void setHashingThreadsCount(int n) =0;		// number of files hashed in parallel
+        virtual int  hashingThreadsCount() const=0;
+
 		virtual bool	ignoreDuplicates() = 0;
 		virtual void 	setIgnoreDuplicates(bool ignore) = 0;
 
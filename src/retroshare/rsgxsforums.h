@@ -147,6 +147,35 @@ struct ForumPostEntry: RsSerializable
     uint32_t mParent;
 };
 
+/// A thread of posts in a forum, as returned by RsGxsForums::getForumThreads()
+struct RsGxsForumThread: RsSerializable
+{
+	RsGxsForumThread() : mLastActivity(0), mPostCount(0) {}
+
+	/** @brief Id of the first post of the thread. The post may be missing,
+	 * in which case mRootPost has a null id, or is a new version of it */
+	RsGxsMessageId mThreadId;
+
+	/** @brief Publish time of the most recent post of the thread */
+	rstime_t mLastActivity;
+
+	/** @brief Number of posts in the thread, old versions of posts included */
+	uint32_t mPostCount;
+
+	/** @brief Metadata of the most recent version of the first post */
+	RsMsgMetaData mRootPost;
+
+	/// @see RsSerializable
+	virtual void serial_process(
+	        RsGenericSerializer::SerializeJob j,
+	        RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RS_SERIAL_PROCESS(mThreadId);
+		RS_SERIAL_PROCESS(mLastActivity);
+		RS_SERIAL_PROCESS(mPostCount);
+		RS_SERIAL_PROCESS(mRootPost);
+	}
+};
 
 struct RsGxsForumStatistics: RsSerializable
 {
@@ -486,6 +515,39 @@ public:
 	        const RsGxsGroupId& forumId, const RsGxsMessageId& parentId,
 	        std::vector<RsGxsForumMsg>& childPosts ) = 0;
 
+	/**
+	 * @brief Get a page of the threads of a forum, most recently active
+	 *	first. Unlike getForumPostsHierarchy, only the requested threads are
+	 *	loaded.
+	 * @jsonapi{development}
+	 * @param[in] forumId id of the forum of which the threads are requested
+	 * @param[in] offset number of threads to skip
+	 * @param[in] limit maximum number of threads to return
+	 * @param[out] threads storage for the threads
+	 * @return Success or error details
+	 */
+	virtual std::error_condition getForumThreads(
+	        const RsGxsGroupId& forumId, uint32_t offset, uint32_t limit,
+	        std::vector<RsGxsForumThread>& threads ) = 0;
+
+	/**
+	 * @brief Get a page of the metadata of the replies to a post, oldest
+	 *	first. Replies to older versions of the post are included, and only
+	 *	the most recent version of each reply is returned.
+	 * @jsonapi{development}
+	 * @param[in] forumId id of the forum of which the content is requested
+	 * @param[in] parentId id of any version of the post of which replies are
+	 *	requested
+	 * @param[in] offset number of replies to skip
+	 * @param[in] limit maximum number of replies to return
+	 * @param[out] childPosts storage for the metadata of the replies
+	 * @return Success or error details
+	 */
+	virtual std::error_condition getChildPostsMetaData(
+	        const RsGxsGroupId& forumId, const RsGxsMessageId& parentId,
+	        uint32_t offset, uint32_t limit,
+	        std::vector<RsMsgMetaData>& childPosts ) = 0;
+
 	/**
 	 * @brief Set keep forever flag on a post so it is not deleted even if older
 	 * then group maximum storage time
@@ -149,6 +149,9 @@ struct RsConfigOptions
 
     bool        enableWebUI;		/* enable web interface */
     std::string webUIPasswd;        /* passwd to start the webui with */
+
+    uint32_t    networkEventLoops;  /* number of event loop threads handling peer connections. 0 means one thread per peer */
+    bool        eventDrivenCoreLoop; /* wake up the core loop when items arrive, instead of ticking it every 50 to 200 ms. Off by default */
 };
 
 
@@ -59,12 +59,16 @@ const uint32_t RS_DIRECTORY_COUNT    = 0x0004 ;
 
 struct TransferInfo : RsSerializable
 {
+	TransferInfo() : tfRate(0), status(0), transfered(0), rtt(0), inflight(0) {}
+
 	/**** Need Some of these Fields ****/
 	RsPeerId peerId;
 	std::string name; /* if has alternative name? */
 	double tfRate; /* kbytes */
 	int status; /* FT_STATE_... */
 	uint64_t transfered ; // used when no chunkmap data is available
+	double rtt; /// delay between a data request and the first bytes received, in seconds. 0 if unknown.
+	uint64_t inflight; /// bytes requested from this source and not received yet
 
 	/// @see RsSerializable
 	void serial_process(RsGenericSerializer::SerializeJob j,
@@ -75,6 +79,8 @@ struct TransferInfo : RsSerializable
 		RS_SERIAL_PROCESS(tfRate);
 		RS_SERIAL_PROCESS(status);
 		RS_SERIAL_PROCESS(transfered);
+		RS_SERIAL_PROCESS(rtt);
+		RS_SERIAL_PROCESS(inflight);
 	}
 };
 
@@ -91,6 +97,13 @@ enum DwlSpeed : uint8_t
 	SPEED_HIGH   = 0x02
 };
 
+/// Algorithm used by downloads to decide how much data to request from each source
+enum class FileTransferRateControl : uint8_t
+{
+	LEGACY      = 0x00, /// request a fixed ratio above the measured rate
+	DELAY_BASED = 0x01  /// keep the request delay close to the lowest one observed
+};
+
 
 
 
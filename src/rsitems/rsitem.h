@@ -22,6 +22,7 @@
 #pragma once
 
 #include <typeinfo> // for typeid
+#include <memory>
 
 #include "util/smallobject.h"
 #include "retroshare/rstypes.h"
@@ -119,11 +120,24 @@ class RsRawItem: public RsItem
 public:
 	RsRawItem(uint32_t t, uint32_t size) : RsItem(t), len(size)
 	{ data = rs_malloc(len); }
-	virtual ~RsRawItem() { free(data); }
+	virtual ~RsRawItem() { if(!sharedData) free(data); }
 
 	uint32_t getRawLength() { return len; }
 	void * getRawData() { return data; }
 
+	/// Returns a new raw item with the same packet id, priority and data, that does not copy the data but shares it
+	/// with this item. This allows to send the same serialised data to several peers. The data of items that share
+	/// it must not be modified anymore. The data is freed when the last item that uses it is deleted.
+	RsRawItem *shareData()
+	{
+		if(!sharedData)
+			sharedData = std::shared_ptr<void>(data,free) ;
+
+		RsRawItem *item = new RsRawItem(PacketId(),sharedData,len) ;
+		item->setPriorityLevel(priority_level()) ;
+		return item ;
+	}
+
 //	virtual void clear() override {}
 	virtual std::ostream &print(std::ostream &out, uint16_t indent = 0);
 
@@ -136,6 +150,10 @@ public:
 	}
 
 private:
+	RsRawItem(uint32_t t, const std::shared_ptr<void>& shared_data, uint32_t size)
+	    : RsItem(t), sharedData(shared_data), data(shared_data.get()), len(size) {}
+
+	std::shared_ptr<void> sharedData;	// only set when the data is shared with other items
 	void *data;
 	uint32_t len;
 };
@@ -39,6 +39,7 @@ const uint8_t RsNxsSyncGrpItem::FLAG_USE_SYNC_HASH       = 0x0001;
 const uint8_t RsNxsSyncMsgItem::FLAG_USE_SYNC_HASH       = 0x0001;
 
 const uint8_t RsNxsSyncMsgReqItem::FLAG_USE_HASHED_GROUP_ID = 0x02;
+const uint8_t RsNxsSyncMsgReqItem::FLAG_USE_MSG_ID_RECONCILIATION = 0x04;
 
 /** transaction state **/
 const uint16_t RsNxsTransacItem::FLAG_BEGIN_P1         = 0x0001;
@@ -70,6 +71,7 @@ RsItem *RsNxsSerialiser::create_item(uint16_t service_id,uint8_t item_subtype) c
         case RS_PKT_SUBTYPE_NXS_SYNC_GRP_ITEM:       return new RsNxsSyncGrpItem(SERVICE_TYPE) ;
         case RS_PKT_SUBTYPE_NXS_SYNC_MSG_REQ_ITEM:   return new RsNxsSyncMsgReqItem(SERVICE_TYPE) ;
         case RS_PKT_SUBTYPE_NXS_SYNC_MSG_ITEM:       return new RsNxsSyncMsgItem(SERVICE_TYPE) ;
+        case RS_PKT_SUBTYPE_NXS_SYNC_MSG_IBLT_ITEM:  return new RsNxsSyncMsgIbltItem(SERVICE_TYPE) ;
         case RS_PKT_SUBTYPE_NXS_GRP_ITEM:            return new RsNxsGrp(SERVICE_TYPE) ;
         case RS_PKT_SUBTYPE_NXS_MSG_ITEM:            return new RsNxsMsg(SERVICE_TYPE) ;
         case RS_PKT_SUBTYPE_NXS_TRANSAC_ITEM:        return new RsNxsTransacItem(SERVICE_TYPE) ;
@@ -92,6 +94,17 @@ void RsNxsSyncMsgItem::serial_process(RsGenericSerializer::SerializeJob j,RsGene
     RsTypeSerializer::serial_process          (j,ctx,authorId         ,"authorId") ;
 }
 
+void RsNxsSyncMsgIbltItem::serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx)
+{
+    RsTypeSerializer::serial_process<uint32_t> (j,ctx,transactionNumber,"transactionNumber") ;
+    RsTypeSerializer::serial_process           (j,ctx,grpId            ,"grpId") ;
+    RsTypeSerializer::serial_process<uint32_t> (j,ctx,updateTS         ,"updateTS") ;
+    RsTypeSerializer::serial_process<uint32_t> (j,ctx,createdSinceTS   ,"createdSinceTS") ;
+    RsTypeSerializer::serial_process<uint32_t> (j,ctx,nbMsgs           ,"nbMsgs") ;
+    RsTypeSerializer::serial_process<uint32_t> (j,ctx,salt             ,"salt") ;
+    RsTypeSerializer::serial_process<RsTlvItem>(j,ctx,cells            ,"cells") ;
+}
+
 void RsNxsMsg::serial_process( RsGenericSerializer::SerializeJob j,
                                RsGenericSerializer::SerializeContext& ctx )
 {
@@ -230,6 +243,16 @@ void RsNxsSyncMsgItem::clear()
     authorId.clear();
 }
 
+void RsNxsSyncMsgIbltItem::clear()
+{
+    grpId.clear();
+    updateTS = 0;
+    createdSinceTS = 0;
+    nbMsgs = 0;
+    salt = 0;
+    cells.TlvClear();
+}
+
 void RsNxsTransacItem::clear(){
     transactFlag = 0;
     nItems = 0;
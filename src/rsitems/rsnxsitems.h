@@ -43,6 +43,7 @@ const uint8_t RS_PKT_SUBTYPE_NXS_GRP_ITEM             = 0x04;
 const uint8_t RS_PKT_SUBTYPE_NXS_ENCRYPTED_DATA_ITEM  = 0x05;
 const uint8_t RS_PKT_SUBTYPE_NXS_SESSION_KEY_ITEM     = 0x06;
 const uint8_t RS_PKT_SUBTYPE_NXS_SYNC_MSG_ITEM        = 0x08;
+const uint8_t RS_PKT_SUBTYPE_NXS_SYNC_MSG_IBLT_ITEM   = 0x09;
 const uint8_t RS_PKT_SUBTYPE_NXS_SYNC_MSG_REQ_ITEM    = 0x10;
 const uint8_t RS_PKT_SUBTYPE_NXS_MSG_ITEM             = 0x20;
 const uint8_t RS_PKT_SUBTYPE_NXS_TRANSAC_ITEM         = 0x40;
@@ -303,6 +304,7 @@ public:
     static const uint8_t FLAG_USE_SYNC_HASH;
 #endif
     static const uint8_t FLAG_USE_HASHED_GROUP_ID;
+    static const uint8_t FLAG_USE_MSG_ID_RECONCILIATION; // the list of msgs may be answered with a RsNxsSyncMsgIbltItem
 
     explicit RsNxsSyncMsgReqItem(uint16_t servtype) : RsNxsItem(servtype, RS_PKT_SUBTYPE_NXS_SYNC_MSG_REQ_ITEM) { RsNxsSyncMsgReqItem::clear(); }
 
@@ -341,6 +343,29 @@ public:
 
 };
 
+/*!
+ * Sent instead of the list of msgs of a group, to peers that asked for it
+ * with RsNxsSyncMsgReqItem::FLAG_USE_MSG_ID_RECONCILIATION. Contains an
+ * invertible Bloom lookup table of the msg ids that would have been in the list,
+ * from which the peer can find the ids it misses by subtracting its own table.
+ */
+class RsNxsSyncMsgIbltItem : public RsNxsItem
+{
+public:
+    explicit RsNxsSyncMsgIbltItem(uint16_t servtype) : RsNxsItem(servtype, RS_PKT_SUBTYPE_NXS_SYNC_MSG_IBLT_ITEM), cells(TLV_TYPE_BIN_GENERIC) { RsNxsSyncMsgIbltItem::clear(); }
+
+    virtual void clear() override;
+
+	virtual void serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx) override;
+
+    RsGxsGroupId grpId;
+    uint32_t updateTS;       // time of last update, as in the transaction of a msg list
+    uint32_t createdSinceTS; // msgs published before this are not in the table
+    uint32_t nbMsgs;         // number of msgs in the table
+    uint32_t salt;
+    RsTlvBinaryData cells;
+};
+
 /*!
  * Used to request to a peer pull updates from us ASAP without waiting GXS sync
  * timer */
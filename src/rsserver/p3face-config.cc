@@ -38,6 +38,7 @@
 
 #include "pqi/p3peermgr.h"
 #include "pqi/p3netmgr.h"
+#include "pqi/pqireactor.h"
 
 
 // TO SHUTDOWN THREADS.
@@ -103,6 +104,8 @@ void RsServer::rsGlobalShutDown()
 
 	fullstop();
 
+	pqiReactor::shutdown();
+
 #ifdef RS_JSONAPI
 	rsJsonApi->fullstop();
 #endif
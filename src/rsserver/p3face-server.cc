@@ -26,6 +26,7 @@
 
 #include "tcponudp/tou.h"
 #include <unistd.h>
+#include <algorithm>
 
 #include "pqi/authssl.h"
 #include <sys/time.h>
@@ -36,9 +37,12 @@
 #include "pqi/p3netmgr.h"
 
 #include "util/rsdebug.h"
+#include "util/rswakeupsignal.h"
 
 #include "retroshare/rsevents.h"
 #include "services/rseventsservice.h"
+#include "services/p3service.h"
+#include "retroshare/rsconfig.h"
 
 /*******************
 #define TICK_DEBUG 1
@@ -76,6 +80,10 @@ static double getCurrentTS()
 const double RsServer::minTickInterval = 0.05;
 const double RsServer::maxTickInterval = 0.2;
 
+// In event driven mode, the core loop is woken up as soon as there is something to do, but never runs more often
+// than this, so that a burst of incoming items is handled in a few passes.
+const double RsServer::minEventTickInterval = 0.005;
+
 
 RsServer::RsServer() :
 	coreMutex("RsServer"), mShutdownCallback([](int){}),
@@ -118,6 +126,7 @@ RsServer::RsServer() :
 	mCycle2 = mLastts;
 	mCycle3 = mLastts;
 	mCycle4 = mLastts;
+	mEventDrivenTicking = true;
 
 	/* caches (that need ticking) */
 
@@ -134,8 +143,33 @@ RsServer::~RsServer()
 
 // General Internal Helper Functions  ----> MUST BE LOCKED! 
 
+void RsServer::onStopRequested()
+{
+	RsWakeupSignal::coreLoop().notify();
+}
+
 void RsServer::threadTick()
 {
+	if(mEventDrivenTicking)
+	{
+		// Wait until items are queued for the services, or until the next deadline. Managers and services
+		// still get ticked at least every maxTickInterval, since they rely on it for timeouts.
+
+		double ts = getCurrentTS();
+
+		if(ts < mLastts + minEventTickInterval)
+			rstime::rs_usleep((mLastts + minEventTickInterval - ts) * 1000000);
+
+		double deadline = std::min(mLastts + maxTickInterval, mCycle1 + 1);
+		double timeToWait = deadline - getCurrentTS();
+
+#ifdef TICK_DEBUG
+		RsDbg() << "TICK_DEBUG will wait at most " << std::dec << (int) (1000 * timeToWait) << " ms";
+#endif
+		RsWakeupSignal::coreLoop().wait(timeToWait);
+	}
+	else
+	{
 #ifdef TICK_DEBUG
 	RsDbg() << "TICK_DEBUG ticking interval " << std::dec << (int) (1000 * mTickInterval) << " ms";
 #endif
@@ -152,6 +186,7 @@ void RsServer::threadTick()
 	RsDbg() << "TICK_DEBUG will sleep " << std::dec << (int) (1000 * timeToSleep) << " ms";
 #endif
 	rstime::rs_usleep(timeToSleep * 1000000);
+	}
 
 	double ts = getCurrentTS();
 	mLastts = ts;
@@ -216,6 +251,10 @@ void RsServer::threadTick()
 	{
 #ifdef TICK_DEBUG
 		RsDbg() << "TICK_DEBUG every 60 seconds";
+
+		RsServiceItemLatencyStats latency;
+		p3Service::getItemLatencyStatistics(latency);
+		RsDbg() << "TICK_DEBUG service item latency: " << latency.nbItems << " items, avg " << latency.averageLatency << " ms, max " << latency.maxLatency << " ms";
 #endif
 		// force saving FileTransferStatus TODO
 		// ftserver->saveFileTransferStatus();
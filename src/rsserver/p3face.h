@@ -89,6 +89,11 @@ public:
 
 	void threadTick() override; /// @see RsTickingThread
 
+protected:
+	void onStopRequested() override; /// @see RsTickingThread
+
+public:
+
 		/* locking stuff */
 		void    lockRsCore() 
 		{ 
@@ -197,8 +202,12 @@ public:
 	double mAvgRunDuration;
 	double mCycle1, mCycle2, mCycle3, mCycle4;
 
+	/// When true, the core loop is woken up by RsWakeupSignal::coreLoop() instead of sleeping a fixed tick interval.
+	bool mEventDrivenTicking;
+
 	static const double minTickInterval;
 	static const double maxTickInterval;
+	static const double minEventTickInterval;
 
 	/// @see RsControl::setShutdownCallback
 	std::function<void(int)> mShutdownCallback;
@@ -22,6 +22,7 @@
 #include <retroshare/rsturtle.h>
 #include "rsserver/p3serverconfig.h"
 #include "services/p3bwctrl.h"
+#include "services/p3service.h"
 #include "rsitems/rstrafficstatsitems.h"
 
 #include "pqi/authgpg.h"
@@ -287,6 +288,18 @@ bool p3ServerConfig::getTotalCumulativeTraffic(RsCumulativeTrafficStats& stats)
     return true;
 }
 
+bool p3ServerConfig::getServiceItemLatency(RsServiceItemLatencyStats& stats)
+{
+    p3Service::getItemLatencyStatistics(stats);
+    return true;
+}
+
+bool p3ServerConfig::clearServiceItemLatency()
+{
+    p3Service::clearItemLatencyStatistics();
+    return true;
+}
+
 int 	p3ServerConfig::getTotalBandwidthRates(RsConfigDataRates &rates)
 {
 	if (rsBandwidthControl)
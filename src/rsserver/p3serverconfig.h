@@ -58,6 +58,9 @@ public:
 	virtual bool clearCumulativeTraffic(bool clearPeerStats, bool clearServiceStats) override;
 	virtual bool getTotalCumulativeTraffic(RsCumulativeTrafficStats& stats) override;
 
+	virtual bool getServiceItemLatency(RsServiceItemLatencyStats& stats) override;
+	virtual bool clearServiceItemLatency() override;
+
 	/* From RsInit */
 
 	virtual std::string      RsConfigDirectory();
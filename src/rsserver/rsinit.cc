@@ -139,6 +139,8 @@ RsConfigOptions::RsConfigOptions()
           ,jsonApiBindAddress("127.0.0.1")
           ,enableWebUI(false)
 #endif
+          ,networkEventLoops(0)
+          ,eventDrivenCoreLoop(false)
 {
 }
 
@@ -196,6 +198,9 @@ struct RsInitConfig
 
 		uint16_t jsonApiPort;
 		std::string jsonApiBindAddress;
+
+		uint32_t networkEventLoops;
+		bool eventDrivenCoreLoop;
 };
 
 static RsInitConfig* rsInitConfig = nullptr;
@@ -242,6 +247,8 @@ void RsInit::InitRsConfig()
 	rsInitConfig->passwd         = "";
 	rsInitConfig->debugLevel	= PQL_WARNING;
 	rsInitConfig->udpListenerOnly = false;
+	rsInitConfig->networkEventLoops = 0;
+	rsInitConfig->eventDrivenCoreLoop = false;
 	rsInitConfig->opModeStr = std::string("");
 
 #ifdef WINDOWS_SYS
@@ -328,6 +335,8 @@ int RsInit::InitRetroShare(const RsConfigOptions& conf)
     rsInitConfig->jsonApiPort        = conf.jsonApiPort;
     rsInitConfig->jsonApiBindAddress = conf.jsonApiBindAddress;
     rsInitConfig->mainExecutablePath = conf.main_executable_path;
+    rsInitConfig->networkEventLoops  = conf.networkEventLoops;
+    rsInitConfig->eventDrivenCoreLoop = conf.eventDrivenCoreLoop;
 
 #ifdef PTW32_STATIC_LIB
 	// for static PThreads under windows... we need to init the library...
@@ -816,6 +825,7 @@ RsGRouter *rsGRouter = NULL ;
 
 #include "pqi/pqipersongrp.h"
 #include "pqi/pqisslpersongrp.h"
+#include "pqi/pqireactor.h"
 #include "pqi/pqiloopback.h"
 #include "pqi/p3cfgmgr.h"
 #include "pqi/p3historymgr.h"
@@ -1267,6 +1277,9 @@ int RsServer::StartupRetroShare()
 	p3ServiceControl *serviceCtrl = new p3ServiceControl(mLinkMgr);
 	rsServiceControl = serviceCtrl;
 
+	if(rsInitConfig->networkEventLoops > 0)
+		pqiReactor::init(rsInitConfig->networkEventLoops);
+
     pqih = new pqisslpersongrp(serviceCtrl, flags, mPeerMgr);
 	//pqih = new pqipersongrpDummy(none, flags);
 
@@ -2058,6 +2071,7 @@ int RsServer::StartupRetroShare()
 	}
 
 	/* Startup this thread! */
+	mEventDrivenTicking = rsInitConfig->eventDrivenCoreLoop;
 	start("rs main") ;
 
     std::cerr << "========================================================================" << std::endl;
@@ -33,6 +33,7 @@
 #include "rsitems/rsconfigitems.h"
 
 #include <sys/time.h>
+#include <fstream>
 #include <sstream>
 
 /****
@@ -50,6 +51,10 @@
 
 #define RSBANLIST_DELAY_BETWEEN_TALK_TO_DHT 		240	// every 4 mins.
 
+// Values of the prefixes in mBlackListFilter, telling where the entry comes from.
+#define RSBANLIST_FILTER_BAN_RANGE			0
+#define RSBANLIST_FILTER_BAN_SET			1
+
 /************ IMPLEMENTATION NOTES *********************************
  *
  * Get Bad Peers passed to us (from DHT mainly).
@@ -86,12 +91,23 @@ RsServiceInfo p3BanList::getServiceInfo()
 
 bool p3BanList::ipFilteringEnabled() { return mIPFilteringEnabled ; }
 void p3BanList::enableIPFiltering(bool b) { mIPFilteringEnabled = b ; }
-void p3BanList::enableIPsFromFriends(bool b) { mIPFriendGatheringEnabled = b; mLastDhtInfoRequest=0;}
+void p3BanList::enableIPsFromFriends(bool b)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    mIPFriendGatheringEnabled = b;
+    mLastDhtInfoRequest=0;
+
+    updateBlackListFilter_locked();
+}
 void p3BanList::enableIPsFromDHT(bool b)
 {
+    RS_STACK_MUTEX(mBanMtx) ;
+
     mIPDHTGatheringEnabled = b;
     mLastDhtInfoRequest=0;
 
+    updateBlackListFilter_locked();
     IndicateConfigChanged();
 }
 void p3BanList::enableAutoRange(bool b)
@@ -193,6 +209,123 @@ static sockaddr_storage makeBitsRange(const sockaddr_storage& addr,int masked_by
     return s ;
 }
 
+static std::string trimSpaces(const std::string& s)
+{
+    static const char *spaces = " \t\r\n" ;
+
+    size_t b = s.find_first_not_of(spaces) ;
+
+    if(b == std::string::npos)
+        return std::string() ;
+
+    return s.substr(b, s.find_last_not_of(spaces) + 1 - b) ;
+}
+
+int p3BanList::parseIpListLine(const std::string& input, RsIpPrefixTrie& filter, bool& ipv6)
+{
+    ipv6 = false ;
+
+    std::string line = trimSpaces(input) ;
+
+    if(line.empty() || line[0] == '#')
+        return 0 ;
+
+    std::string range = line ;
+
+    // ipfilter.dat: "first - last , level , name". Levels above 127 are not blocked.
+
+    size_t comma = line.find(',') ;
+
+    if(comma != std::string::npos)
+    {
+        range = line.substr(0,comma) ;
+
+        int level ;
+        if(sscanf(line.c_str() + comma + 1, "%d", &level) == 1 && level > 127)
+            return 0 ;
+    }
+
+    size_t dash = range.rfind('-') ;
+
+    if(dash != std::string::npos)
+    {
+        std::string first = trimSpaces(range.substr(0,dash)) ;
+        std::string last  = trimSpaces(range.substr(dash+1)) ;
+
+        sockaddr_storage first_addr, last_addr ;
+
+        if(!RsIpPrefixTrie::parseAddress(last, last_addr))
+            return -1 ;
+
+        // P2P format: "name:first-last". The name may contain ':', but not an IPv4 address.
+
+        if(!RsIpPrefixTrie::parseAddress(first, first_addr))
+        {
+            size_t colon = first.rfind(':') ;
+
+            if(colon == std::string::npos || !RsIpPrefixTrie::parseAddress(first.substr(colon+1), first_addr))
+                return -1 ;
+        }
+
+        uint32_t n = filter.insertRange(first_addr, last_addr, 0) ;
+        ipv6 = (first_addr.ss_family == AF_INET6) ;
+        return (n > 0) ? (int)n : -1 ;
+    }
+
+    // CIDR prefix or single address, possibly followed by a comment
+
+    std::string prefix = line.substr(0, line.find_first_of(" \t;#")) ;
+    sockaddr_storage addr ;
+    uint32_t prefix_len ;
+
+    if(!RsIpPrefixTrie::parsePrefix(prefix, addr, prefix_len))
+        return -1 ;
+
+    filter.insert(addr, prefix_len, 0) ;
+    ipv6 = (addr.ss_family == AF_INET6) ;
+    return 1 ;
+}
+
+bool p3BanList::parseIpListFile(const std::string& path, ImportedIpList& list)
+{
+    std::ifstream in(path.c_str()) ;
+
+    if(!in)
+    {
+        std::cerr << "(EE) Cannot open IP list file " << path << std::endl;
+        return false ;
+    }
+
+    std::string line ;
+    uint32_t nb_errors = 0 ;
+
+    list.mNbRanges = 0 ;
+    list.mNbIpv6Ranges = 0 ;
+
+    while(std::getline(in, line))
+    {
+        bool ipv6 ;
+        int n = parseIpListLine(line, list.mFilter, ipv6) ;
+
+        if(n < 0)
+            ++nb_errors ;
+        else
+        {
+            list.mNbRanges += n ;
+
+            if(ipv6)
+                list.mNbIpv6Ranges += n ;
+        }
+    }
+
+    if(nb_errors > 0)
+        std::cerr << "(WW) IP list file " << path << ": " << nb_errors << " lines could not be parsed." << std::endl;
+
+    std::cerr << "Read IP list " << path << ": " << list.mNbRanges << " prefixes, " << list.mFilter.memoryUsage()/1024 << " KB" << std::endl;
+
+    return list.mNbRanges > 0 ;
+}
+
 void p3BanList::autoFigureOutBanRanges()
 {
     RS_STACK_MUTEX(mBanMtx) ;
@@ -214,7 +347,11 @@ void p3BanList::autoFigureOutBanRanges()
 
     IndicateConfigChanged();
 
-	if(!mAutoRangeIps) return;
+	if(!mAutoRangeIps)
+	{
+		updateBlackListFilter_locked();
+		return;
+	}
 
 #ifdef DEBUG_BANLIST
     std::cerr << "Automatically figuring out IP ranges from banned IPs." << std::endl;
@@ -315,7 +452,8 @@ bool p3BanList::isAddressAccepted(
 
 	sockaddr_storage addr; sockaddr_storage_copy(dAddr, addr);
 
-	if(!sockaddr_storage_ipv6_to_ipv4(addr)) return true;
+	// IPv4-mapped addresses are checked as IPv4. Other IPv6 addresses can only be in imported lists.
+	bool native_ipv6 = !sockaddr_storage_ipv6_to_ipv4(addr);
 	if(sockaddr_storage_isLoopbackNet(addr)) return true;
 
 
@@ -327,19 +465,7 @@ bool p3BanList::isAddressAccepted(
     std::cerr << "isAddressAccepted(): tested addr=" << sockaddr_storage_iptostring(addr) << ", checking flags=" << checking_flags ;
 #endif
 
-    // we should normally work this including entire ranges of IPs. For now, just check the exact IPs.
-
-    sockaddr_storage addr_32 = makeBitsRange(addr,0) ;	// this is necessay because it cleans the address
-    sockaddr_storage addr_24 = makeBitsRange(addr,1) ;
-    sockaddr_storage addr_16 = makeBitsRange(addr,2) ;
-
-    bool white_list_found = false ;
-
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_16) != mWhiteListedRanges.end()) ;
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_24) != mWhiteListedRanges.end()) ;
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_32) != mWhiteListedRanges.end()) ;
-
-    if(white_list_found)
+    if(isWhiteListed_locked(addr))
 	{
 		check_result = RSBANLIST_CHECK_RESULT_ACCEPTED;
 #ifdef DEBUG_BANLIST
@@ -348,7 +474,10 @@ bool p3BanList::isAddressAccepted(
         return true ;
     }
 
-    if(checking_flags & RSBANLIST_CHECKING_FLAGS_WHITELIST)
+    // IPv6 addresses cannot be whitelisted by hand, so they are only required
+    // to be whitelisted when an imported whitelist holds IPv6 ranges.
+
+    if((checking_flags & RSBANLIST_CHECKING_FLAGS_WHITELIST) && (!native_ipv6 || hasIpv6WhiteList_locked()))
 	{
 		check_result = RSBANLIST_CHECK_RESULT_NOT_WHITELISTED;
 #ifdef DEBUG_BANLIST
@@ -366,47 +495,35 @@ bool p3BanList::isAddressAccepted(
         return true;
     }
 
-    std::map<sockaddr_storage,BanListPeer>::iterator it ;
+    uint32_t kind, prefix_len ;
 
-    if(((it=mBanRanges.find(addr_16)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
+    if(mBlackListFilter.lookup(addr, kind, &prefix_len))
     {
-        ++it->second.connect_attempts;
-#ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/16. returning false. attempts=" << it->second.connect_attempts << std::endl;
-#endif
-	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
+        // The filter only holds accepted entries. Find the entry, to count the attempt.
 
-  if(((it=mBanRanges.find(addr_24)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
-  {
-      ++it->second.connect_attempts;
-#ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/24.  returning false. attempts=" << it->second.connect_attempts << std::endl;
-#endif
-	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
+        bool range = (kind == RSBANLIST_FILTER_BAN_RANGE) ;
+        std::map<sockaddr_storage,BanListPeer>& entries(range ? mBanRanges : mBanSet) ;
+        std::map<sockaddr_storage,BanListPeer>::iterator it = entries.find(makeBitsRange(addr, range ? (32 - prefix_len)/8 : 0)) ;
+
+        if(it != entries.end())
+            ++it->second.connect_attempts;
 
-  if(((it=mBanRanges.find(addr_32)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
-  {
-      ++it->second.connect_attempts;
 #ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/32.  returning false. attempts=" << it->second.connect_attempts << std::endl;
+      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(addr) << "/" << prefix_len << ". returning false." << std::endl;
 #endif
 	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-        return false ;
+      return false ;
     }
 
-    if((it=mBanSet.find(addr_32)) != mBanSet.end() && acceptedBanSet_locked(it->second))
-    {
-        ++it->second.connect_attempts;
+    for(std::list<ImportedIpList>::const_iterator it(mImportedIpLists.begin());it!=mImportedIpLists.end();++it)
+        if(it->mListType == RSBANLIST_TYPE_BLACKLIST && it->mFilter.lookup(addr, kind))
+        {
 #ifdef DEBUG_BANLIST
-      std::cerr << "found as blacklisted address " << sockaddr_storage_iptostring(it->first) << ".  returning false. attempts=" << it->second.connect_attempts << std::endl;
+      std::cerr << " found in imported list " << it->mPath << ". returning false." << std::endl;
 #endif
 	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
+            return false ;
+        }
 
 #ifdef DEBUG_BANLIST
   std::cerr << " not blacklisted. Accepting." << std::endl;
@@ -813,6 +930,13 @@ bool p3BanList::saveList(bool &cleanup, std::list<RsItem*>& itemlist)
     kv.value = os.str() ;
     vitem->tlvkvs.pairs.push_back(kv) ;
 
+    for(std::list<ImportedIpList>::const_iterator it(mImportedIpLists.begin());it!=mImportedIpLists.end();++it)
+    {
+        kv.key = (it->mListType == RSBANLIST_TYPE_WHITELIST) ? "IP_FILTERING_IMPORTED_WHITELIST" : "IP_FILTERING_IMPORTED_BLACKLIST" ;
+        kv.value = it->mPath ;
+        vitem->tlvkvs.pairs.push_back(kv) ;
+    }
+
     itemlist.push_back(vitem) ;
 
     return true ;
@@ -822,6 +946,8 @@ bool p3BanList::loadList(std::list<RsItem*>& load)
 {
     RsStackMutex stack(mBanMtx); /****** LOCKED MUTEX *******/
 
+    std::list<ImportedIpList> imported_lists ;
+
     for(std::list<RsItem*>::const_iterator it(load.begin());it!=load.end();++it)
     {
         RsConfigKeyValueSet *vitem = dynamic_cast<RsConfigKeyValueSet*>( *it ) ;
@@ -834,6 +960,15 @@ bool p3BanList::loadList(std::list<RsItem*>& load)
                 if(it2->key == "IP_FILTERING_FRIEND_GATHERING_ENABLED") mIPFriendGatheringEnabled = (it2->value=="TRUE") ;
                 if(it2->key == "IP_FILTERING_DHT_GATHERING_ENABLED") mIPDHTGatheringEnabled = (it2->value=="TRUE") ;
 
+                if(it2->key == "IP_FILTERING_IMPORTED_BLACKLIST" || it2->key == "IP_FILTERING_IMPORTED_WHITELIST")
+                {
+                    ImportedIpList list ;
+                    list.mPath = it2->value ;
+                    list.mListType = (it2->key == "IP_FILTERING_IMPORTED_WHITELIST") ? RSBANLIST_TYPE_WHITELIST : RSBANLIST_TYPE_BLACKLIST ;
+
+                    imported_lists.push_back(list) ;
+                }
+
                 if(it2->key == "IP_FILTERING_AUTORANGE_IPS_LIMIT")
         {
             int val ;
@@ -906,6 +1041,20 @@ bool p3BanList::loadList(std::list<RsItem*>& load)
     }
 
     load.clear() ;
+
+    // Imported files are read again, so that updates of the files are taken into account.
+
+    for(std::list<ImportedIpList>::iterator it(imported_lists.begin());it!=imported_lists.end();)
+        if(parseIpListFile(it->mPath, *it))
+            ++it ;
+        else
+            it = imported_lists.erase(it) ;
+
+    addImportedIpLists_locked(imported_lists) ;
+
+    updateWhiteListFilter_locked() ;
+    updateBlackListFilter_locked() ;
+
     return true ;
 }
 
@@ -1008,17 +1157,104 @@ bool p3BanList::addBanEntry( const RsPeerId &peerId,
 
 bool p3BanList::isWhiteListed_locked(const sockaddr_storage& addr)
 {
-    if(mWhiteListedRanges.find(makeBitsRange(addr,0)) != mWhiteListedRanges.end())
-        return true ;
+    uint32_t value ;
 
-    if(mWhiteListedRanges.find(makeBitsRange(addr,1)) != mWhiteListedRanges.end())
+    if(mWhiteListFilter.lookup(addr,value))
         return true ;
 
-    if(mWhiteListedRanges.find(makeBitsRange(addr,2)) != mWhiteListedRanges.end())
-        return true ;
+    for(std::list<ImportedIpList>::const_iterator it(mImportedIpLists.begin());it!=mImportedIpLists.end();++it)
+        if(it->mListType == RSBANLIST_TYPE_WHITELIST && it->mFilter.lookup(addr,value))
+            return true ;
+
+    return false ;
+}
+
+bool p3BanList::hasIpv6WhiteList_locked() const
+{
+    for(std::list<ImportedIpList>::const_iterator it(mImportedIpLists.begin());it!=mImportedIpLists.end();++it)
+        if(it->mListType == RSBANLIST_TYPE_WHITELIST && it->mNbIpv6Ranges > 0)
+            return true ;
 
     return false ;
+}
+
+void p3BanList::updateWhiteListFilter_locked()
+{
+    mWhiteListFilter.clear() ;
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mWhiteListedRanges.begin());it!=mWhiteListedRanges.end();++it)
+        mWhiteListFilter.insert(it->first, 32 - 8*it->second.masked_bytes, 0) ;
+}
+
+void p3BanList::updateBlackListFilter_locked()
+{
+    mBlackListFilter.clear() ;
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mBanSet.begin());it!=mBanSet.end();++it)
+        if(acceptedBanSet_locked(it->second))
+            mBlackListFilter.insert(it->first, 32, RSBANLIST_FILTER_BAN_SET) ;
+
+    // Inserted after the ban set, so that a /32 range replaces the same address of the ban set.
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mBanRanges.begin());it!=mBanRanges.end();++it)
+        if(acceptedBanRanges_locked(it->second))
+            mBlackListFilter.insert(it->first, 32 - 8*it->second.masked_bytes, RSBANLIST_FILTER_BAN_RANGE) ;
+}
+
+void p3BanList::addImportedIpLists_locked(std::list<ImportedIpList>& lists)
+{
+    for(std::list<ImportedIpList>::const_iterator it(lists.begin());it!=lists.end();++it)
+        for(std::list<ImportedIpList>::iterator it2(mImportedIpLists.begin());it2!=mImportedIpLists.end();)
+            if(it2->mPath == it->mPath)
+                it2 = mImportedIpLists.erase(it2) ;
+            else
+                ++it2 ;
 
+    mImportedIpLists.splice(mImportedIpLists.end(), lists) ;
+}
+
+bool p3BanList::importIpList(const std::string& path, uint32_t list_type, uint32_t& nb_ranges)
+{
+    nb_ranges = 0 ;
+
+    if(list_type != RSBANLIST_TYPE_BLACKLIST && list_type != RSBANLIST_TYPE_WHITELIST)
+    {
+        std::cerr << "(EE) Cannot import IP list. Bad list_type. Should be eiter RSBANLIST_TYPE_BLACKLIST or RSBANLIST_TYPE_WHITELIST" << std::endl;
+        return false ;
+    }
+
+    // The file is parsed without holding the mutex, since it can be large.
+
+    std::list<ImportedIpList> lists(1) ;
+    ImportedIpList& list(lists.front()) ;
+
+    list.mPath = path ;
+    list.mListType = list_type ;
+
+    if(!parseIpListFile(path, list))
+        return false ;
+
+    nb_ranges = list.mNbRanges ;
+
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    addImportedIpLists_locked(lists) ;
+    IndicateConfigChanged() ;
+
+    return true ;
+}
+
+void p3BanList::clearImportedIpLists(uint32_t list_type)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    for(std::list<ImportedIpList>::iterator it(mImportedIpLists.begin());it!=mImportedIpLists.end();)
+        if(it->mListType == list_type)
+            it = mImportedIpLists.erase(it) ;
+        else
+            ++it ;
+
+    IndicateConfigChanged() ;
 }
 
 /***
@@ -1029,6 +1265,7 @@ bool p3BanList::isWhiteListed_locked(const sockaddr_storage& addr)
 int p3BanList::condenseBanSources_locked()
 {
         mBanSet.clear();
+        updateWhiteListFilter_locked();
 
     rstime_t now = time(NULL);
 	RsPeerId ownId = mServiceCtrl->getOwnId();
@@ -1139,6 +1376,8 @@ int p3BanList::condenseBanSources_locked()
 	printBanSet_locked(std::cerr);
 #endif
 
+	updateBlackListFilter_locked();
+
 	return true ;
 }
 
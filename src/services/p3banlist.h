@@ -29,6 +29,7 @@
 #include "rsitems/rsbanlistitems.h"
 #include "services/p3service.h"
 #include "retroshare/rsbanlist.h"
+#include "util/rsiptrie.h"
 
 class p3ServiceControl;
 class p3NetMgr;
@@ -42,11 +43,28 @@ class BanList
 	std::map<struct sockaddr_storage, BanListPeer> mBanPeers;
 };
 
+/**
+ * An IP list imported from a file, e.g. a public blocklist.
+ */
+class ImportedIpList
+{
+	public:
+
+	std::string mPath;
+	uint32_t mListType; /* RSBANLIST_TYPE_BLACKLIST or RSBANLIST_TYPE_WHITELIST */
+	uint32_t mNbRanges;
+	uint32_t mNbIpv6Ranges; /* IPv6 prefixes among mNbRanges */
+	RsIpPrefixTrie mFilter;
+};
+
 /**
  * The RS BanList service.
  * Exchange list of Banned IPv4 addresses with peers.
  *
- * @warning IPv4 only, IPv6 not supported yet!
+ * Addresses are checked against tries of prefixes, rebuilt from the lists
+ * below when they change. Imported lists may contain IPv6 ranges.
+ *
+ * @warning IPv4 only for exchanged and user entries, IPv6 not supported yet!
  */
 class p3BanList: public RsBanList, public p3Service, public pqiNetAssistPeerShare, public p3Config /*, public pqiMonitor */
 {
@@ -70,6 +88,31 @@ public:
 	virtual bool removeIpRange( const sockaddr_storage &addr, int masked_bytes,
 	                            uint32_t list_type );
 
+	/// @see RsBanList
+	virtual bool importIpList(
+	        const std::string& path, uint32_t list_type,
+	        uint32_t& nb_ranges = RS_DEFAULT_STORAGE_PARAM(uint32_t)
+	        ) override;
+
+	/// @see RsBanList
+	virtual void clearImportedIpLists(uint32_t list_type) override;
+
+	/**
+	 * Parses one line of an IP list: CIDR prefix, single address, ipfilter.dat
+	 * or P2P range. Comments and ipfilter.dat levels above 127 are ignored.
+	 * @param[out] ipv6 true if the added prefixes are IPv6 ones
+	 * @return number of prefixes added to filter, 0 if the line is ignored,
+	 *	-1 if it cannot be parsed
+	 */
+	static int parseIpListLine(
+	        const std::string& line, RsIpPrefixTrie& filter, bool& ipv6 );
+
+	/**
+	 * Reads the IP list file at path into list, skipping bad lines.
+	 * @return false if the file cannot be read or holds no prefix
+	 */
+	static bool parseIpListFile(const std::string& path, ImportedIpList& list);
+
     virtual void enableIPFiltering(bool b) ;
     virtual bool ipFilteringEnabled() ;
 
@@ -143,6 +186,10 @@ private:
     int printBanSources_locked(std::ostream &out);
     int printBanSet_locked(std::ostream &out);
     bool isWhiteListed_locked(const sockaddr_storage &addr);
+    bool hasIpv6WhiteList_locked() const;
+    void updateWhiteListFilter_locked();
+    void updateBlackListFilter_locked();
+    void addImportedIpLists_locked(std::list<ImportedIpList>& lists);
 
     p3ServiceControl *mServiceCtrl;
     //p3NetMgr *mNetMgr;
@@ -152,6 +199,10 @@ private:
     std::map<struct sockaddr_storage, BanListPeer> mBanRanges;
     std::map<struct sockaddr_storage, BanListPeer> mWhiteListedRanges;
 
+    RsIpPrefixTrie mBlackListFilter;	// accepted entries of mBanSet and mBanRanges
+    RsIpPrefixTrie mWhiteListFilter;	// mWhiteListedRanges
+    std::list<ImportedIpList> mImportedIpLists;
+
     rstime_t mLastDhtInfoRequest ;
 
     uint32_t mAutoRangeLimit ;
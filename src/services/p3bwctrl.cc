@@ -257,6 +257,9 @@ int  p3BandwidthControl::getTotalBandwidthRates(RsConfigDataRates &rates)
 	/* Copy global cumulative totals to the output structure */
 	rates.mTotalIn = mTotalRates.mTotalIn;
 	rates.mTotalOut = mTotalRates.mTotalOut;
+	rates.mOutWrites = mTotalRates.mOutWrites;
+	rates.mOutWriteBytes = mTotalRates.mOutWriteBytes;
+	rates.mOutAllocs = mTotalRates.mOutAllocs;
 
 	/* DEBUG OPTIONNEL pour vérifier le total global */
 	//RsDbg() << "OUTQUEUEBYTES [p3bwctrl] GLOBAL TOTAL Bridge: " << rates.mQueueOutBytes;
@@ -295,6 +298,9 @@ int p3BandwidthControl::getAllBandwidthRates(std::map<RsPeerId, RsConfigDataRate
 		/* Copy individual cumulative totals to the API structure */
 		rates.mTotalIn = bit->second.mRates.mTotalIn;
 		rates.mTotalOut = bit->second.mRates.mTotalOut;
+		rates.mOutWrites = bit->second.mRates.mOutWrites;
+		rates.mOutWriteBytes = bit->second.mRates.mOutWriteBytes;
+		rates.mOutAllocs = bit->second.mRates.mOutAllocs;
 
 		/* Debug message */
 		//RsDbg() << "OUTQUEUEBYTES [p3bwctrl] Final API Exit for Peer: " << bit->first << " | Bytes: " << rates.mQueueOutBytes;
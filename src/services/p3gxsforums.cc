@@ -1026,6 +1026,128 @@ std::error_condition p3GxsForums::getChildPosts(
 	return std::error_condition();
 }
 
+std::error_condition p3GxsForums::getForumThreads(
+        const RsGxsGroupId& forumId, uint32_t offset, uint32_t limit,
+        std::vector<RsGxsForumThread>& threads )
+{
+	if(forumId.isNull())
+		return std::errc::invalid_argument;
+
+	std::vector<RsGxsThreadInfo> infos;
+	if(!getDataStore()->retrieveThreads(forumId, offset, limit, infos))
+		return std::errc::no_message_available;
+
+	for(auto& info: infos)
+	{
+		RsGxsForumThread thread;
+		thread.mThreadId = info.mThreadId;
+		thread.mLastActivity = info.mLastActivity;
+		thread.mPostCount = info.mMsgCount;
+
+		// Several posts may be left if a version was not accepted. Show the most recent one.
+
+		removeOldPostVersions(forumId, info.mTopMsgs);
+
+		std::shared_ptr<RsGxsMsgMetaData> rootPost;
+		for(auto& meta: info.mTopMsgs)
+			if(!rootPost || rootPost->mPublishTs < meta->mPublishTs)
+				rootPost = meta;
+
+		if(rootPost)
+			thread.mRootPost = *rootPost;
+
+		threads.push_back(thread);
+	}
+
+	return std::error_condition();
+}
+
+std::error_condition p3GxsForums::getChildPostsMetaData(
+        const RsGxsGroupId& forumId, const RsGxsMessageId& parentId,
+        uint32_t offset, uint32_t limit,
+        std::vector<RsMsgMetaData>& childPosts )
+{
+	if(forumId.isNull() || parentId.isNull())
+		return std::errc::invalid_argument;
+
+	// Replies may be attached to any version of the parent post.
+
+	std::vector<std::shared_ptr<RsGxsMsgMetaData> > versions;
+	if(!getDataStore()->retrieveMsgVersions(forumId, parentId, versions))
+		return std::errc::no_message_available;
+
+	std::set<RsGxsMessageId> parentIds;
+	parentIds.insert(parentId);
+
+	for(auto& meta: versions)
+		parentIds.insert(meta->mMsgId);
+
+	// Versions from the same author are already filtered by the data store. Versions from moderators
+	// are only filtered within the page.
+
+	std::vector<std::shared_ptr<RsGxsMsgMetaData> > metas;
+	if(!getDataStore()->retrieveChildMsgMetaData(forumId, parentIds, offset, limit, metas))
+		return std::errc::no_message_available;
+
+	removeOldPostVersions(forumId, metas);
+
+	for(auto& meta: metas)
+		childPosts.push_back(RsMsgMetaData(*meta));
+
+	return std::error_condition();
+}
+
+void p3GxsForums::removeOldPostVersions(const RsGxsGroupId& forumId, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& metas)
+{
+	std::map<RsGxsMessageId,std::shared_ptr<RsGxsMsgMetaData> > msgs;
+
+	for(auto& meta: metas)
+		msgs[meta->mMsgId] = meta;
+
+	std::set<RsGxsMessageId> old_versions;
+	std::unique_ptr<RsGxsForumGroup> forum_group;
+
+	for(auto& meta: metas)
+	{
+		if(meta->mOrigMsgId.isNull() || meta->mOrigMsgId == meta->mMsgId)
+			continue;
+
+		auto it = msgs.find(meta->mOrigMsgId);
+
+		if(it == msgs.end())
+			continue;
+
+		// Same check than in computeMessagesHierarchy(): a new version from another author must be flagged as moderation, by a moderator.
+
+		if(it->second->mAuthorId != meta->mAuthorId)
+		{
+			if(!IS_FORUM_MSG_MODERATION(meta->mMsgFlags))
+				continue;
+
+			if(!forum_group)
+			{
+				std::vector<RsGxsForumGroup> groups;
+
+				if(!getForumsInfo(std::list<RsGxsGroupId>{ forumId }, groups) || groups.size() != 1)
+				{
+					RsErr() << __PRETTY_FUNCTION__ << " failed to retrieve forum group info for forum " << forumId;
+					return;
+				}
+				forum_group.reset(new RsGxsForumGroup(groups[0]));
+			}
+
+			if(!forum_group->canEditPosts(meta->mAuthorId))
+				continue;
+		}
+
+		old_versions.insert(meta->mOrigMsgId);
+	}
+
+	metas.erase(std::remove_if(metas.begin(), metas.end(),
+	                           [&old_versions](const std::shared_ptr<RsGxsMsgMetaData>& meta) { return old_versions.count(meta->mMsgId) > 0; }),
+	            metas.end());
+}
+
 bool p3GxsForums::createGroup(uint32_t &token, RsGxsForumGroup &group)
 {
 	std::cerr << "p3GxsForums::createGroup()" << std::endl;
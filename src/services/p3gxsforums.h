@@ -151,6 +151,17 @@ public:
 	        const RsGxsGroupId& forumId, const RsGxsMessageId& parentId,
 	        std::vector<RsGxsForumMsg>& childPosts ) override;
 
+	/// @see RsGxsForums
+	std::error_condition getForumThreads(
+	        const RsGxsGroupId& forumId, uint32_t offset, uint32_t limit,
+	        std::vector<RsGxsForumThread>& threads ) override;
+
+	/// @see RsGxsForums
+	std::error_condition getChildPostsMetaData(
+	        const RsGxsGroupId& forumId, const RsGxsMessageId& parentId,
+	        uint32_t offset, uint32_t limit,
+	        std::vector<RsMsgMetaData>& childPosts ) override;
+
 	/// @see RsGxsForums
 	std::error_condition setPostKeepForever(
 	        const RsGxsGroupId& forumId, const RsGxsMessageId& postId,
@@ -216,6 +227,9 @@ private:
                                   std::vector<ForumPostEntry>& posts,
                                   std::map<RsGxsMessageId,std::vector<std::pair<rstime_t,RsGxsMessageId> > >& mPostVersions );
 
+    /// Removes from metas the posts that have a new version in metas, with the same rules than computeMessagesHierarchy()
+    void removeOldPostVersions(const RsGxsGroupId& forumId, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& metas);
+
     virtual bool generateDummyData();
 
     std::string genRandomId();
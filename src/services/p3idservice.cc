@@ -37,6 +37,7 @@
 #include "util/radix64.h"
 #include "util/rsdir.h"
 #include "util/rstime.h"
+#include "util/rspgphashmatcher.h"
 #include "crypto/hashstream.h"
 #include "gxs/gxssecurity.h"
 #include "rsserver/rsloginhandler.h"
@@ -140,6 +141,8 @@ RsIdentity* rsIdentity = nullptr;
 #define PGPHASH_PERIOD			60
 #define PGPHASH_RETRY_PERIOD		11
 #define PGPHASH_PROC_PERIOD		1
+#define PGPHASH_PROC_BATCH_SIZE		200	// max number of Ids processed by each call to pgphash_process()
+#define PGPHASH_MAX_THREADS		4	// max number of threads matching PGP hashes
 
 #define RECOGN_PERIOD			90
 #define RECOGN_RETRY_PERIOD		17
@@ -3484,10 +3487,6 @@ void	p3IdService::CacheArbitrationDone(uint32_t mode)
  * then big GroupRequest, and iterate through these.
  **/
 
-//const int SHA_DIGEST_LENGTH = 20;
-
-static void calcPGPHash(const RsGxsId &id, const PGPFingerprintType &pgp, Sha1CheckSum &hash);
-
 
 // Must Use meta.
 RsGenExchange::ServiceCreate_Return p3IdService::service_CreateGroup(
@@ -3595,7 +3594,7 @@ RsGenExchange::ServiceCreate_Return p3IdService::service_CreateGroup(
 #endif
 
         RsGxsId gxsId(item->meta.mGroupId.toStdString());
-        calcPGPHash(gxsId, ownFinger, hash);
+        RsPgpHashMatcher::computeHash(gxsId, ownFinger, hash);
         item->mPgpIdHash = hash;
 
 #ifdef DEBUG_IDS
@@ -3874,26 +3873,19 @@ bool p3IdService::pgphash_load_group_data(uint32_t token)
 
 bool p3IdService::pgphash_process()
 {
-    /* each time this is called - process one Id from mGroupsToProcess */
-	RsGxsIdGroup pg;
-	bool isDone = false;
-	{
-		RsStackMutex stack(mIdMtx); /********** STACK LOCKED MTX ******/
-		if (!mGroupsToProcess.empty())
-		{
-            pg = mGroupsToProcess.begin()->second;
-            mGroupsToProcess.erase(mGroupsToProcess.begin());
+    /* each time this is called - process a batch of Ids from mGroupsToProcess */
+    std::vector<RsGxsIdGroup> groups;
+    {
+        RsStackMutex stack(mIdMtx); /********** STACK LOCKED MTX ******/
 
-#ifdef DEBUG_IDS
-			std::cerr << "p3IdService::pgphash_process() Popped Group: " << pg.mMeta.mGroupId;
-			std::cerr << std::endl;
-#endif // DEBUG_IDS
-		}
-		else
-			isDone = true;
-	}
+        while(!mGroupsToProcess.empty() && groups.size() < PGPHASH_PROC_BATCH_SIZE)
+        {
+            groups.push_back(mGroupsToProcess.begin()->second);
+            mGroupsToProcess.erase(mGroupsToProcess.begin());
+        }
+    }
 
-	if (isDone)
+	if (groups.empty())
 	{
 #ifdef DEBUG_IDS
 		std::cerr << "p3IdService::pgphash_process() List Empty... Done";
@@ -3904,14 +3896,58 @@ bool p3IdService::pgphash_process()
 		return true;
 	}
 
+#ifdef DEBUG_IDS
+    std::cerr << "p3IdService::pgphash_process() Popped " << groups.size() << " Groups" << std::endl;
+#endif // DEBUG_IDS
+
+    // Ids whose signature names the issuer are checked right away. The key of the other ones must be found by
+    // hashing them with all known keys, which is done for the whole batch at once on several threads. Ids are
+    // updated as soon as their key is found, so that they get linked progressively.
+
+    std::vector<RsPgpHashMatcher::Request> requests;
+    std::vector<uint32_t> requested_groups;
+
+    for(uint32_t i=0;i<groups.size();++i)
+    {
+        RsPgpId issuer_id;
+
+        if(mPgpUtils->parseSignature((unsigned char *) groups[i].mPgpIdSign.c_str(), groups[i].mPgpIdSign.length(),issuer_id) && !issuer_id.isNull())
+            pgphash_processId(groups[i], NULL);
+        else
+        {
+            RsPgpHashMatcher::Request req;
+            req.id = RsGxsId(groups[i].mMeta.mGroupId);
+            req.pgpHash = groups[i].mPgpIdHash;
+
+            requests.push_back(req);
+            requested_groups.push_back(i);
+        }
+    }
+
+    if(!requests.empty())
+    {
+        std::shared_ptr<const RsPgpHashMatcher> matcher;
+        {
+            RsStackMutex stack(mIdMtx); /********** STACK LOCKED MTX ******/
+            matcher = mPgpHashMatcher;
+        }
+        if(!matcher)
+            matcher = std::make_shared<const RsPgpHashMatcher>(std::map<RsPgpId, RsPgpFingerprint>());
 
+        matcher->match(requests, [&](uint32_t i, const RsPgpId& pgp_id) { pgphash_processId(groups[requested_groups[i]], &pgp_id); }, PGPHASH_MAX_THREADS);
+    }
+    return true;
+}
+
+void p3IdService::pgphash_processId(RsGxsIdGroup& pg, const RsPgpId *matched_pgp_id)
+{
 	SSGxsIdGroup ssdata;
 	ssdata.load(pg.mMeta.mServiceString); // attempt load - okay if fails.
 
     RsPgpId pgpId;
     bool error = false ;
 
-    if (checkId(pg, pgpId,error))
+    if (checkId(pg, pgpId,error,matched_pgp_id))
 	{
 		/* found a match - update everything */
 		/* Consistency issues here - what if Reputation was recently updated? */
@@ -3959,7 +3995,6 @@ bool p3IdService::pgphash_process()
 
         cache_update_if_cached(RsGxsId(pg.mMeta.mGroupId), serviceString);
     }
-    return true;
 }
 
 // This method allows to have a null issuer ID in the signature, in which case the signature is anonymous.
@@ -3970,8 +4005,10 @@ bool p3IdService::pgphash_process()
 // For now, this is probably never used because signed IDs use a clear signature. The advntage of hiding the
 // ID has not been clearly demonstrated anyway, which allows to directly look for the ID in the list of
 // known keys instead of computing tons of hashes.
+//
+// When the caller already looked for the key (see pgphash_process()), the result is given in matched_pgp_id.
 
-bool p3IdService::checkId(const RsGxsIdGroup &grp, RsPgpId &pgpId,bool& error)
+bool p3IdService::checkId(const RsGxsIdGroup &grp, RsPgpId &pgpId,bool& error,const RsPgpId *matched_pgp_id)
 {
 #ifdef DEBUG_IDS
 	std::cerr << "p3IdService::checkId() Starting Match Check for RsGxsId: ";
@@ -4015,7 +4052,7 @@ bool p3IdService::checkId(const RsGxsIdGroup &grp, RsPgpId &pgpId,bool& error)
             error = false;
             return false;
         }
-        calcPGPHash(RsGxsId(grp.mMeta.mGroupId), mit->second, hash);
+        RsPgpHashMatcher::computeHash(RsGxsId(grp.mMeta.mGroupId), mit->second, hash);
 #ifdef DEBUG_IDS
         std::cerr << "Issuer from PGP signature: " << issuer_id << " is known. Computed corresponding hash: " << hash << std::endl;
 #endif
@@ -4034,25 +4071,30 @@ bool p3IdService::checkId(const RsGxsIdGroup &grp, RsPgpId &pgpId,bool& error)
 #ifdef DEBUG_IDS
         std::cerr << "Bruteforcing PGP hash from GxsId mPgpHash: " << grp.mPgpIdHash << std::endl;
 #endif
-        for(auto mit = mPgpFingerprintMap.begin(); mit != mPgpFingerprintMap.end(); ++mit)
+        RsPgpId matched ;
+
+        if(matched_pgp_id)
+            matched = *matched_pgp_id ;
+        else
         {
-            calcPGPHash(RsGxsId(grp.mMeta.mGroupId), mit->second, hash);
+            RsPgpHashMatcher::Request req ;
+            req.id = RsGxsId(grp.mMeta.mGroupId) ;
+            req.pgpHash = grp.mPgpIdHash ;
 
-            std::cerr << "   profile key " << mit->first << " (" << mit->second << ") : ";
+            if(mPgpHashMatcher)
+                matched = mPgpHashMatcher->match(req) ;
+        }
 
-            if (grp.mPgpIdHash == hash)
-            {
-#ifdef DEBUG_IDS
-                std::cerr << "MATCH!" << std::endl;
-#endif
-                pgpId = mit->first;
-                pgp_fingerprint = mit->second;
-                break;
-            }
+        auto mit = matched.isNull() ? mPgpFingerprintMap.end() : mPgpFingerprintMap.find(matched);
+
+        if(mit != mPgpFingerprintMap.end())
+        {
 #ifdef DEBUG_IDS
-            else
-                std::cerr << "fails" << std::endl;
+            std::cerr << "MATCH! profile key " << mit->first << " (" << mit->second << ")" << std::endl;
 #endif
+            pgpId = mit->first;
+            pgp_fingerprint = mit->second;
+            hash = grp.mPgpIdHash;
         }
     }
 
@@ -4110,6 +4152,9 @@ void p3IdService::getPgpIdList()
 		mPgpFingerprintMap[pgpId] = fp;
 	}
 
+	// Ids being matched in pgphash_process() keep the previous matcher until they are done.
+	mPgpHashMatcher = std::make_shared<const RsPgpHashMatcher>(mPgpFingerprintMap);
+
 #ifdef DEBUG_IDS
 	std::cerr << "p3IdService::getPgpIdList() Items: " << mPgpFingerprintMap.size();
 	std::cerr << std::endl;
@@ -4117,32 +4162,6 @@ void p3IdService::getPgpIdList()
 }
 
 
-void calcPGPHash(const RsGxsId &id, const PGPFingerprintType &pgp, Sha1CheckSum &hash)
-{
-	unsigned char signature[SHA_DIGEST_LENGTH];
-	/* hash id + pubkey => pgphash */
-	SHA_CTX *sha_ctx = new SHA_CTX;
-	SHA1_Init(sha_ctx);
-
-	SHA1_Update(sha_ctx, id.toStdString().c_str(), id.toStdString().length()); // TO FIX ONE DAY.
-	SHA1_Update(sha_ctx, pgp.toByteArray(), pgp.SIZE_IN_BYTES);
-	SHA1_Final(signature, sha_ctx);
-	hash = Sha1CheckSum(signature);
-
-#ifdef DEBUG_IDS
-	std::cerr << "calcPGPHash():";
-	std::cerr << std::endl;
-	std::cerr << "\tRsGxsId: " << id;
-	std::cerr << std::endl;
-	std::cerr << "\tFingerprint: " << pgp.toStdString();
-	std::cerr << std::endl;
-	std::cerr << "\tFinal Hash: " << hash.toStdString();
-	std::cerr << std::endl;
-#endif // DEBUG_IDS
-
-	delete sha_ctx;
-}
-
 /************************************************************************************/
 /************************************************************************************/
 /************************************************************************************/
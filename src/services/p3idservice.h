@@ -24,6 +24,7 @@
 
 
 #include <map>
+#include <memory>
 #include <string>
 
 #include "retroshare/rsidentity.h"	// External Interfaces.
@@ -38,6 +39,8 @@
 #include "pqi/authgpg.h"
 #include "rsitems/rsgxsrecognitems.h"
 
+class RsPgpHashMatcher;
+
 class PgpAuxUtils;
 
 class OpinionRequest
@@ -491,13 +494,15 @@ private:
     bool pgphash_load_group_data(uint32_t token);
     bool pgphash_handlerequest(uint32_t token);
 	bool pgphash_process();
+	void pgphash_processId(RsGxsIdGroup &grp, const RsPgpId *matched_pgp_id);
 
-	bool checkId(const RsGxsIdGroup &grp, RsPgpId &pgp_id, bool &error);
+	bool checkId(const RsGxsIdGroup &grp, RsPgpId &pgp_id, bool &error, const RsPgpId *matched_pgp_id = NULL);
 	void getPgpIdList();
 
 	/* MUTEX PROTECTED DATA (mIdMtx - maybe should use a 2nd?) */
 
 	std::map<RsPgpId, RsPgpFingerprint> mPgpFingerprintMap;
+	std::shared_ptr<const RsPgpHashMatcher> mPgpHashMatcher;	// built from mPgpFingerprintMap, each time it changes
     std::map<RsGxsGroupId,RsGxsIdGroup> mGroupsToProcess;
 
 	/************************************************************************
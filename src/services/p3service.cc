@@ -24,7 +24,12 @@
 #include "pqi/pqi.h"
 #include "util/rsstring.h"
 #include "services/p3service.h"
+#include "retroshare/rsconfig.h"
+#include "util/rstime.h"
+#include "util/rswakeupsignal.h"
+#include <algorithm>
 #include <iomanip>
+#include <mutex>
 
 #ifdef WINDOWS_SYS
 #include "util/rstime.h"
@@ -36,20 +41,64 @@
 
 
 
-RsItem *p3Service::recvItem()
+// Latency of the items going through the receive queues, shared by all services.
+
+static std::mutex latencyMtx;
+static RsServiceItemLatencyStats latencyStats;
+static double latencySum = 0.0;
+
+static void recordItemLatency(double latency)
 {
-	RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+	float ms = latency * 1000.0;
 
-	if (recv_queue.empty())
+	std::lock_guard<std::mutex> lock(latencyMtx);
+
+	++latencyStats.nbItems;
+	latencySum += ms;
+	latencyStats.maxLatency = std::max(latencyStats.maxLatency, ms);
+
+	if(ms < 1)        ++latencyStats.below1ms;
+	else if(ms < 10)  ++latencyStats.below10ms;
+	else if(ms < 50)  ++latencyStats.below50ms;
+	else if(ms < 200) ++latencyStats.below200ms;
+	else              ++latencyStats.above200ms;
+}
+
+void p3Service::getItemLatencyStatistics(RsServiceItemLatencyStats& stats)
+{
+	std::lock_guard<std::mutex> lock(latencyMtx);
+
+	stats = latencyStats;
+	stats.averageLatency = (stats.nbItems > 0) ? latencySum / stats.nbItems : 0.0;
+}
+
+void p3Service::clearItemLatencyStatistics()
+{
+	std::lock_guard<std::mutex> lock(latencyMtx);
+
+	latencyStats = RsServiceItemLatencyStats();
+	latencySum = 0.0;
+}
+
+RsItem *p3Service::recvItem()
+{
+	QueuedItem qi;
 	{
-		return NULL; /* nothing there! */
+		RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+
+		if (recv_queue.empty())
+		{
+			return NULL; /* nothing there! */
+		}
+
+		/* get something off front */
+		qi = recv_queue.front();
+		recv_queue.pop_front();
 	}
 
-	/* get something off front */
-	RsItem *item = recv_queue.front();
-	recv_queue.pop_front();
+	recordItemLatency(rstime::RsScopeTimer::currentTime() - qi.recvTS);
 
-	return item;
+	return qi.item;
 }
 
 
@@ -65,9 +114,27 @@ bool p3Service::recvItem(RsItem *item)
 {
 	if (item)
 	{
-		RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+		bool tickedByCoreLoop;
+		{
+			RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+
+			QueuedItem qi;
+			qi.item = item;
+			qi.recvTS = rstime::RsScopeTimer::currentTime();
+
+			recv_queue.push_back(qi);
+
+			// Services that run their own thread poll their queue themselves. The others are
+			// ticked by the core loop, which must handle the item right away.
 
-		recv_queue.push_back(item);
+			if(mTickedByCoreLoop < 0)
+				mTickedByCoreLoop = (dynamic_cast<RsTickingThread*>(this) == NULL) ? 1 : 0;
+
+			tickedByCoreLoop = (mTickedByCoreLoop == 1);
+		}
+
+		if(tickedByCoreLoop)
+			RsWakeupSignal::coreLoop().notify();
 	}
 	return true;
 }
@@ -153,6 +220,47 @@ int p3FastService::sendItem(RsItem *si)
 	std::cerr << std::endl;
 #endif
 
+	RsRawItem *raw = locked_serialiseItem(si);
+
+	if (!raw)
+		return 0;
+
+	/* ensure PeerId is transferred */
+	raw->PeerId(si->PeerId());
+
+#ifdef SERV_DEBUG
+	std::cerr << "p3Service::send() returning RawItem.";
+	std::cerr << std::endl;
+#endif
+	delete si;
+
+	return pqiService::send(raw);	
+}
+
+int p3FastService::sendItemToPeers(RsItem *si, const std::set<RsPeerId>& peers)
+{
+	RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+
+#ifdef SERV_DEBUG 
+	std::cerr << "p3Service::sendItemToPeers() Sending item to " << peers.size() << " peers:";
+	std::cerr << std::endl;
+	si->print(std::cerr, 0);
+	std::cerr << std::endl;
+#endif
+
+	/* serialise once, and share the data between all peers */
+	RsRawItem *raw = locked_serialiseItem(si);
+
+	if (!raw)
+		return 0;
+
+	delete si;
+
+	return pqiService::sendToPeers(raw, peers);
+}
+
+RsRawItem *p3FastService::locked_serialiseItem(RsItem *si)
+{
 	/* try to convert */
 	uint32_t size = rsSerialiser->size(si);
 	if (!size)
@@ -162,7 +270,7 @@ int p3FastService::sendItem(RsItem *si)
 
 		/* can't convert! */
 		delete si;
-		return 0;
+		return NULL;
 	}
 
 	RsRawItem *raw = new RsRawItem(si->PacketId(), size);
@@ -184,31 +292,7 @@ int p3FastService::sendItem(RsItem *si)
 		raw = NULL;
 	}
 
-	/* ensure PeerId is transferred */
-	if (raw)
-	{
-		raw->PeerId(si->PeerId());
-
-		if(si->priority_level() == QOS_PRIORITY_UNKNOWN)
-		{
-			std::cerr << "************************************************************" << std::endl;
-			std::cerr << "********** Warning: p3Service::send()              ********" << std::endl;
-			std::cerr << "********** Warning: caught a RsItem with undefined  ********" << std::endl;
-			std::cerr << "**********          priority level. That should not ********" << std::endl;
-			std::cerr << "**********          happen. Please fix your items!  ********" << std::endl;
-			std::cerr << "************************************************************" << std::endl;
-		}
-		raw->setPriorityLevel(si->priority_level()) ;
-
-#ifdef SERV_DEBUG
-		std::cerr << "p3Service::send() returning RawItem.";
-		std::cerr << std::endl;
-#endif
-		delete si;
-
-		return pqiService::send(raw);	
-	}
-	else
+	if (!raw)
 	{
 		std::cerr << "p3service: item could not be properly serialised. Will be wasted.  Item is: "<< std::endl;
 		si->print(std::cerr,0) ;
@@ -216,8 +300,19 @@ int p3FastService::sendItem(RsItem *si)
 		/* cleanup */
 		delete si;
 
-		return 0 ;
+		return NULL;
 	}
-}
 
+	if(si->priority_level() == QOS_PRIORITY_UNKNOWN)
+	{
+		std::cerr << "************************************************************" << std::endl;
+		std::cerr << "********** Warning: p3Service::send()              ********" << std::endl;
+		std::cerr << "********** Warning: caught a RsItem with undefined  ********" << std::endl;
+		std::cerr << "**********          priority level. That should not ********" << std::endl;
+		std::cerr << "**********          happen. Please fix your items!  ********" << std::endl;
+		std::cerr << "************************************************************" << std::endl;
+	}
+	raw->setPriorityLevel(si->priority_level()) ;
 
+	return raw;
+}
@@ -26,6 +26,8 @@
 #include "pqi/pqiservice.h"
 #include "util/rsthreads.h"
 
+struct RsServiceItemLatencyStats;
+
 /* This provides easy to use extensions to the pqiservice class provided in src/pqi.
  * 
  * We will have a number of different strains.
@@ -71,6 +73,8 @@ virtual ~p3FastService() { delete rsSerialiser; return; }
 
 /*************** INTERFACE ******************************/
 int             sendItem(RsItem *);
+	// Sends the same item to several peers. The item is serialised only once. The item is deleted.
+int             sendItemToPeers(RsItem *, const std::set<RsPeerId>& peers);
 virtual int	tick() { return 0; }
 /*************** INTERFACE ******************************/
 
@@ -85,6 +89,12 @@ virtual bool	recvItem(RsItem *item) = 0;
 	protected:
 void 	addSerialType(RsSerialType *);
 
+	private:
+	// Serialises the item into a raw item. The item is deleted if this fails.
+RsRawItem *	locked_serialiseItem(RsItem *si);
+
+	protected:
+
 	RsMutex srvMtx; /* below locked by Mutex */
 
 	RsSerialiser *rsSerialiser;
@@ -96,7 +106,7 @@ class p3Service: public p3FastService
 	protected:
 
 	p3Service() 
-	:p3FastService()
+	:p3FastService(), mTickedByCoreLoop(-1)
 	{
 		return; 
 	}
@@ -116,10 +126,24 @@ bool		receivedItems();
 	// overloaded p3FastService interface.
 virtual bool	recvItem(RsItem *item);
 
+	// Time spent by items in the receive queue of all services, until recvItem() returns them.
+static void	getItemLatencyStatistics(RsServiceItemLatencyStats& stats);
+static void	clearItemLatencyStatistics();
+
 	private:
 
+	struct QueuedItem
+	{
+		RsItem *item;
+		double recvTS;
+	};
+
 	/* below locked by srvMtx Mutex */
-	std::list<RsItem *> recv_queue;
+	std::list<QueuedItem> recv_queue;
+
+	// 1 when the service is ticked by the core loop, 0 when it runs its own thread,
+	// -1 until the first item is received. The derived type is not known in the constructor.
+	int mTickedByCoreLoop;
 };
 
 
@@ -979,6 +979,8 @@ void p3turtle::handleSearchRequest(RsTurtleSearchRequestItem *item)
 		std::cerr << "  Looking for online peers" << std::endl ;
 #endif
 
+		std::set<RsPeerId> fwd_peers ;
+
 		for(std::set<RsPeerId>::const_iterator it(onlineIds.begin());it!=onlineIds.end();++it)
 		{
 //			if(!mServiceControl->isPeerConnected(RS_SERVICE_TYPE_TURTLE,*it))
@@ -994,22 +996,25 @@ void p3turtle::handleSearchRequest(RsTurtleSearchRequestItem *item)
 #ifdef P3TURTLE_DEBUG
 				std::cerr << "  Forwarding request to peer = " << *it << std::endl ;
 #endif
-				// Copy current item and modify it.
-				RsTurtleSearchRequestItem *fwd_item = item->clone() ;
-
-				// increase search depth, except in some rare cases, to prevent correlation between
-				// TR sniffing and friend names. The strategy is to not increase depth if the depth
-				// is 1:
-				// 	If B receives a TR of depth 1 from A, B cannot deduice that A is downloading the
-				// 	file, since A might have shifted the depth.
-				//
-				if(!random_dshift)
-					++(fwd_item->depth) ;
+				fwd_peers.insert(*it) ;
+			}
+		}
 
-				fwd_item->PeerId(*it) ;
+		if(!fwd_peers.empty())
+		{
+			// Copy current item and modify it. The same item is sent to all peers, so it is only serialised once.
+			RsTurtleSearchRequestItem *fwd_item = item->clone() ;
+
+			// increase search depth, except in some rare cases, to prevent correlation between
+			// TR sniffing and friend names. The strategy is to not increase depth if the depth
+			// is 1:
+			// 	If B receives a TR of depth 1 from A, B cannot deduice that A is downloading the
+			// 	file, since A might have shifted the depth.
+			//
+			if(!random_dshift)
+				++(fwd_item->depth) ;
 
-				sendItem(fwd_item) ;
-			}
+			sendItemToPeers(fwd_item,fwd_peers) ;
 		}
 	}
 #ifdef P3TURTLE_DEBUG
@@ -1269,6 +1274,95 @@ void p3turtle::handleSearchResult(RsTurtleSearchResultItem *item)
 // ---------------------------------  File Transfer. -------------------------------- //
 // -----------------------------------------------------------------------------------//
 
+// All generic tunnel items start with the tunnel id, right after the item header. For each of them, this gives
+// the priority they are sent with and whether they stamp the tunnel they travel through, as the items themselves
+// would (see RsTurtleGenericTunnelItem::shouldStampTunnel()).
+//
+static bool getRawTunnelItemInfo(uint8_t subtype,uint8_t& priority,bool& stamps_tunnel)
+{
+	switch(subtype)
+	{
+	case RS_TURTLE_SUBTYPE_GENERIC_DATA:      priority = QOS_PRIORITY_RS_TURTLE_GENERIC_DATA ;      stamps_tunnel = true ;  return true ;
+	case RS_TURTLE_SUBTYPE_GENERIC_FAST_DATA: priority = QOS_PRIORITY_RS_TURTLE_GENERIC_FAST_DATA ; stamps_tunnel = true ;  return true ;
+	case RS_TURTLE_SUBTYPE_FILE_DATA:         priority = QOS_PRIORITY_RS_TURTLE_FILE_DATA ;         stamps_tunnel = true ;  return true ;
+	case RS_TURTLE_SUBTYPE_CHUNK_CRC:         priority = QOS_PRIORITY_RS_CHUNK_CRC ;                stamps_tunnel = true ;  return true ;
+	case RS_TURTLE_SUBTYPE_FILE_REQUEST:      priority = QOS_PRIORITY_RS_TURTLE_FILE_REQUEST ;      stamps_tunnel = false ; return true ;
+	case RS_TURTLE_SUBTYPE_FILE_MAP:          priority = QOS_PRIORITY_RS_TURTLE_FILE_MAP ;          stamps_tunnel = false ; return true ;
+	case RS_TURTLE_SUBTYPE_FILE_MAP_REQUEST:  priority = QOS_PRIORITY_RS_TURTLE_FILE_MAP_REQUEST ;  stamps_tunnel = false ; return true ;
+	case RS_TURTLE_SUBTYPE_CHUNK_CRC_REQUEST: priority = QOS_PRIORITY_RS_CHUNK_CRC_REQUEST ;        stamps_tunnel = false ; return true ;
+	default:
+		return false ;
+	}
+}
+
+bool p3turtle::recv(RsRawItem *item)
+{
+	if(forwardRawTunnelItem(item))
+		return true ;
+
+	return p3Service::recv(item) ;
+}
+
+// Forwarding of the tunnel items we only relay. These are never looked at, so instead of going through the
+// receive queue, deserialisation, routeGenericTunnelItem() and serialisation again, the raw bytes are sent as they
+// came to the next peer of the tunnel, directly from the thread that received them.
+//
+// Returns false when the item must take the normal path: items that do not travel through tunnels, items of
+// unknown tunnels, and items whose tunnel ends here.
+//
+bool p3turtle::forwardRawTunnelItem(RsRawItem *item)
+{
+	uint8_t priority ;
+	bool stamps_tunnel ;
+
+	if(!getRawTunnelItemInfo(getRsItemSubType(item->PacketId()),priority,stamps_tunnel))
+		return false ;
+
+	uint32_t offset = getRsPktBaseSize() ;
+	TurtleTunnelId tunnel_id ;
+
+	if(!getRawUInt32(item->getRawData(),item->getRawLength(),&offset,&tunnel_id))
+		return false ;
+
+	{
+		RsStackMutex stack(mTurtleMtx); /********** STACK LOCKED MTX ******/
+
+		if(!(_turtle_routing_enabled && _turtle_routing_session_enabled))
+			return false ;
+
+		std::map<TurtleTunnelId,TurtleTunnel>::iterator it(_local_tunnels.find(tunnel_id)) ;
+
+		if(it == _local_tunnels.end())
+			return false ;
+
+		TurtleTunnel& tunnel(it->second) ;
+		RsPeerId next_peer ;
+
+		if(item->PeerId() == tunnel.local_dst && tunnel.local_src != _own_id)
+			next_peer = tunnel.local_src ;
+		else if(item->PeerId() == tunnel.local_src && tunnel.local_dst != _own_id)
+			next_peer = tunnel.local_dst ;
+		else
+			return false ;
+
+#ifdef P3TURTLE_DEBUG
+		std::cerr << "  Forwarding raw tunnel item of tunnel " << HEX_PRINT(tunnel_id) << " to peer " << next_peer << std::endl ;
+#endif
+		if(stamps_tunnel)
+			tunnel.time_stamp = time(NULL) ;
+
+		tunnel.transfered_bytes += item->getRawLength() ;
+		_traffic_info_buffer.unknown_updn_Bps += item->getRawLength() ;
+
+		item->PeerId(next_peer) ;
+	}
+
+	item->setPriorityLevel(priority) ;
+	pqiService::send(item) ;
+
+	return true ;
+}
+
 // Routing of turtle tunnel items in a generic manner. Most tunnel packets will
 // use this function, except packets designed for contructing the tunnels and
 // searching, namely TurtleSearchRequests/Results and OpenTunnel/TunnelOkItems
@@ -1599,7 +1693,7 @@ void p3turtle::handleTunnelRequest(RsTurtleOpenTunnelItem *item)
 
  	// check first if the hash is in the ban list. If so, drop the request.
 
- 	if(rsFiles->isHashBanned(item->file_hash))
+ 	if(rsFiles && rsFiles->isHashBanned(item->file_hash))
     {
         std::cerr << "(II) Rejecting tunnel request to ban hash " << item->file_hash << std::endl;
         return ;
@@ -1797,6 +1891,8 @@ void p3turtle::handleTunnelRequest(RsTurtleOpenTunnelItem *item)
 		std::cerr << "  Forwarding tunnel request: Looking for online peers" << std::endl ;
 #endif
 
+		std::set<RsPeerId> fwd_peers ;
+
 		for(std::set<RsPeerId>::const_iterator it(onlineIds.begin());it!=onlineIds.end();++it)
 		{
 			uint32_t linkType = mLinkMgr->getLinkType(*it);
@@ -1809,27 +1905,30 @@ void p3turtle::handleTunnelRequest(RsTurtleOpenTunnelItem *item)
 #ifdef P3TURTLE_DEBUG
  			std::cerr << "  Forwarding request to peer = " << *it << std::endl ;
 #endif
-				// Copy current item and modify it.
-				RsTurtleOpenTunnelItem *fwd_item = new RsTurtleOpenTunnelItem(*item) ;
-
-				// increase search depth, except in some rare cases, to prevent correlation between
-				// TR sniffing and friend names. The strategy is to not increase depth if the depth
-				// is 1:
-				// 	If B receives a TR of depth 1 from A, B cannot deduice that A is downloading the
-				// 	file, since A might have shifted the depth.
-				//
-				if(!random_dshift)
-					++(fwd_item->depth) ;		// increase tunnel depth
-
-				fwd_item->PeerId(*it) ;
+				fwd_peers.insert(*it) ;
+			}
+		}
 
-				{
-					RsStackMutex stack(mTurtleMtx); /********** STACK LOCKED MTX ******/
-					_traffic_info_buffer.tr_up_Bps += RsTurtleSerialiser().size(fwd_item);
-				}
+		if(!fwd_peers.empty())
+		{
+			// Copy current item and modify it. The same item is sent to all peers, so it is only serialised once.
+			RsTurtleOpenTunnelItem *fwd_item = new RsTurtleOpenTunnelItem(*item) ;
+
+			// increase search depth, except in some rare cases, to prevent correlation between
+			// TR sniffing and friend names. The strategy is to not increase depth if the depth
+			// is 1:
+			// 	If B receives a TR of depth 1 from A, B cannot deduice that A is downloading the
+			// 	file, since A might have shifted the depth.
+			//
+			if(!random_dshift)
+				++(fwd_item->depth) ;		// increase tunnel depth
 
-				sendItem(fwd_item) ;
+			{
+				RsStackMutex stack(mTurtleMtx); /********** STACK LOCKED MTX ******/
+				_traffic_info_buffer.tr_up_Bps += fwd_peers.size() * RsTurtleSerialiser().size(fwd_item);
 			}
+
+			sendItemToPeers(fwd_item,fwd_peers) ;
 		}
 	}
 #ifdef P3TURTLE_DEBUG
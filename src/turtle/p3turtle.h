@@ -305,6 +305,11 @@ class p3turtle: public p3Service, public RsTurtle, public p3Config
 		///
 		virtual int tick();
 
+		/// Tunnel items that we only relay are forwarded from here, without being deserialised. All
+		/// other items are queued for tick() as usual.
+		///
+		virtual bool recv(RsRawItem *item);
+
 		virtual void getItemNames(std::map<uint8_t,std::string>& names) const;
 
 		/************* from p3Config *******************/
@@ -377,6 +382,9 @@ class p3turtle: public p3Service, public RsTurtle, public p3Config
 		/// Main routing function
 		int handleIncoming(); 									
 
+		/// Forwards a relayed tunnel item as is, if the item travels through a tunnel that does not end here.
+		bool forwardRawTunnelItem(RsRawItem *item) ;
+
 		/// Generic routing function for all tunnel packets that derive from RsTurtleGenericTunnelItem
 		void routeGenericTunnelItem(RsTurtleGenericTunnelItem *item) ;
 
@@ -44,5 +44,6 @@
 #	define fopen64 fopen
 #	define fseeko64 fseeko
 #	define ftello64 ftello
+#	define pread64 pread
 #	define stat64 stat
 #endif // def __APPLE__
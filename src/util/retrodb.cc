@@ -39,6 +39,10 @@ const int RetroDb::OPEN_READONLY = SQLITE_OPEN_READONLY;
 const int RetroDb::OPEN_READWRITE = SQLITE_OPEN_READWRITE;
 const int RetroDb::OPEN_READWRITE_CREATE = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
 
+// Statements are keyed by their SQL, so that callers should use a bounded set
+// of queries with place holders rather than building one query per argument.
+const uint32_t RetroDb::MAX_CACHED_STATEMENTS = 64;
+
 RetroDb::RetroDb(const std::string& dbPath, int flags, const std::string& key):
     mDb(nullptr), mKey(key),mDbNeedsCleaning(false),mPath(dbPath)
 {
@@ -157,6 +161,8 @@ void RetroDb::closeDb()
     if(!mDb)
         return;
 
+    clearStatementCache();
+
     if(mDbNeedsCleaning)
     {
         RsDbg() << "Cleaning the Db \"" << mPath << "\" using the VACUUM command." ;
@@ -282,6 +288,126 @@ RetroCursor* RetroDb::sqlQuery(const std::string& tableName, const std::list<std
     return (new RetroCursor(stmt));
 }
 
+RetroCursor* RetroDb::sqlQuery(const std::string& tableName, const std::list<std::string>& columns,
+                               const std::string& selection, std::list<RetroBind*>& selectionArgs,
+                               const std::string& orderBy){
+
+    if(tableName.empty() || columns.empty()){
+        std::cerr << "RetroDb::sqlQuery(): No table or columns given" << std::endl;
+
+        for(std::list<RetroBind*>::iterator lit = selectionArgs.begin(); lit != selectionArgs.end(); ++lit)
+            delete *lit;
+
+        selectionArgs.clear();
+        return NULL;
+    }
+
+    std::string sqlQuery = "SELECT ";
+
+    for(std::list<std::string>::const_iterator it = columns.begin(); it != columns.end(); ++it){
+        if (it != columns.begin())
+            sqlQuery += ",";
+
+        sqlQuery += *it;
+    }
+
+    sqlQuery += " FROM " + tableName;
+
+    if(!selection.empty())
+        sqlQuery += " WHERE " + selection;
+
+    if(!orderBy.empty())
+        sqlQuery += " ORDER BY " + orderBy;
+
+    sqlQuery += ";";
+
+#ifdef RETRODB_DEBUG
+    std::cerr << "RetroDb::sqlQuery(): " << sqlQuery << std::endl;
+#endif
+
+    sqlite3_stmt* stmt = getCachedStatement(sqlQuery);
+
+    for(std::list<RetroBind*>::iterator lit = selectionArgs.begin(); lit != selectionArgs.end(); ++lit){
+        RetroBind* rb = *lit;
+
+        if(stmt && !rb->bind(stmt))
+            std::cerr << "RetroDb::sqlQuery(): Bind failed for index: " << rb->getIndex() << std::endl;
+
+        delete rb;
+    }
+    selectionArgs.clear();
+
+    if(!stmt)
+        return NULL;
+
+    if(mStatementsInUse.find(stmt) != mStatementsInUse.end())
+        return new RetroCursor(stmt, this);
+
+    // not cached (cache full), the cursor owns the statement
+    return new RetroCursor(stmt);
+}
+
+sqlite3_stmt* RetroDb::getCachedStatement(const std::string& query)
+{
+    sqlite3_stmt* stmt = NULL;
+    std::map<std::string, sqlite3_stmt*>::iterator mit = mStatementCache.find(query);
+
+    if(mit != mStatementCache.end())
+    {
+        // A cursor on the same query is still alive: do not share its statement.
+        if(mStatementsInUse.find(mit->second) == mStatementsInUse.end())
+        {
+            mStatementsInUse.insert(mit->second);
+            return mit->second;
+        }
+    }
+
+    int rc = sqlite3_prepare_v2(mDb, query.c_str(), query.length(), &stmt, NULL);
+
+    if(rc != SQLITE_OK){
+        std::cerr << "RetroDb::getCachedStatement(): Error preparing statement\n";
+        std::cerr << "Error code: " <<  sqlite3_errmsg(mDb) << std::endl;
+        std::cerr << "Query: " << query << std::endl;
+
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+
+    if(mit == mStatementCache.end() && mStatementCache.size() < MAX_CACHED_STATEMENTS)
+    {
+        mStatementCache[query] = stmt;
+        mStatementsInUse.insert(stmt);
+    }
+
+    return stmt;
+}
+
+void RetroDb::releaseStatement(sqlite3_stmt* stmt)
+{
+    std::set<sqlite3_stmt*>::iterator sit = mStatementsInUse.find(stmt);
+
+    // The cache was cleared while the cursor was alive, and the statement finalized.
+    if(sit == mStatementsInUse.end())
+        return;
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    mStatementsInUse.erase(sit);
+}
+
+void RetroDb::clearStatementCache()
+{
+    if(!mStatementsInUse.empty())
+        std::cerr << "RetroDb::clearStatementCache(): Warning: " << mStatementsInUse.size() << " cached statements still in use." << std::endl;
+
+    for(std::map<std::string, sqlite3_stmt*>::iterator mit = mStatementCache.begin(); mit != mStatementCache.end(); ++mit)
+        sqlite3_finalize(mit->second);
+
+    mStatementCache.clear();
+    mStatementsInUse.clear();
+}
+
 bool RetroDb::isOpen() const {
     return (mDb==NULL ? false : true);
 }
@@ -674,16 +800,22 @@ bool RetroDb::tableExists(const std::string &tableName)
 /********************** RetroCursor ************************/
 
 RetroCursor::RetroCursor(sqlite3_stmt *stmt)
-    : mStmt(NULL) {
+    : mStmt(NULL), mCacheOwner(NULL) {
+
+     open(stmt);
+}
+
+RetroCursor::RetroCursor(sqlite3_stmt *stmt, RetroDb *db)
+    : mStmt(NULL), mCacheOwner(db) {
 
      open(stmt);
 }
 
 RetroCursor::~RetroCursor(){
 
-    // finalise statement
+    // finalise statement, or give it back to the cache
     if(mStmt){
-        sqlite3_finalize(mStmt);
+        close();
     }
 }
 
@@ -769,6 +901,13 @@ bool RetroCursor::close(){
     if(!isOpen())
         return false;
 
+    if(mCacheOwner){
+        mCacheOwner->releaseStatement(mStmt);
+        mCacheOwner = NULL;
+        mStmt = NULL;
+
+        return true;
+    }
 
     int rc = sqlite3_finalize(mStmt);
     mStmt = NULL;
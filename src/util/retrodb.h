@@ -118,6 +118,14 @@ public:
      */
     bool execSQL(const std::string& query);
 
+    /*!
+     * Same as above, but the query may contain '?' place holders which are
+     * bound to paramBindings
+     * @param paramBindings values for the place holders, deleted by this method
+     * @return false if there was an sqlite error, true otherwise
+     */
+    bool execSQL_bind(const std::string &query, std::list<RetroBind*>& paramBindings);
+
     /*!
      * inserts a row in a database table
      * @param table table you want to insert content values into
@@ -151,6 +159,20 @@ public:
     RetroCursor* sqlQuery(const std::string& tableName, const std::list<std::string>& columns,
                           const std::string& selection, const std::string& orderBy);
 
+    /*!
+     * Same as above, but the selection may contain '?' place holders which are
+     * bound to selectionArgs. The prepared statement is cached and reused by
+     * later queries with the same SQL, so that a query issued many times with
+     * different arguments is only prepared once.
+     * The returned cursor must be deleted before the next query using the same
+     * SQL for the statement to be reused, and before the database is closed.
+     * @param selectionArgs values for the place holders, deleted by this method
+     * @return cursor over result set, this allocated resource should be free'd after use
+     */
+    RetroCursor* sqlQuery(const std::string& tableName, const std::list<std::string>& columns,
+                          const std::string& selection, std::list<RetroBind*>& selectionArgs,
+                          const std::string& orderBy);
+
     /*!
      * delete row in an sql table
      * @param tableName the table on which to apply the DELETE
@@ -172,6 +194,11 @@ public:
      */
     bool tableExists(const std::string& tableName);
 
+    /*!
+     * Finalizes all cached statements
+     */
+    void clearStatementCache();
+
 public:
 
     static const int OPEN_READONLY;
@@ -180,8 +207,6 @@ public:
 
 private:
 
-    bool execSQL_bind(const std::string &query, std::list<RetroBind*>& blobs);
-
     /*!
      * Build the "VALUE" part of an insertiong sql query
      * @param parameter contains place holder query
@@ -198,6 +223,19 @@ private:
     void buildUpdateQueryValue(const std::map<std::string, uint8_t> keyMap, const ContentValue& cv,
             std::string& parameter, std::list<RetroBind*>& paramBindings);
 
+    /*!
+     * @return a prepared statement for query, from the cache if possible
+     */
+    sqlite3_stmt* getCachedStatement(const std::string& query);
+
+    /*!
+     * Called by RetroCursor when done with a statement returned by
+     * getCachedStatement(). The statement is reset and can be reused.
+     */
+    void releaseStatement(sqlite3_stmt* stmt);
+
+    friend class RetroCursor;
+
 private:
 
     sqlite3* mDb;
@@ -205,6 +243,11 @@ private:
     bool mDbNeedsCleaning;
     std::string mPath;
 
+    std::map<std::string, sqlite3_stmt*> mStatementCache;
+    std::set<sqlite3_stmt*> mStatementsInUse;
+
+    static const uint32_t MAX_CACHED_STATEMENTS;
+
 	RS_SET_CONTEXT_DEBUG_LEVEL(3)
 };
 
@@ -221,6 +264,11 @@ public:
      */
     RetroCursor(sqlite3_stmt*);
 
+    /*!
+     * Initialises a cursor on a statement owned by the statement cache of db
+     */
+    RetroCursor(sqlite3_stmt*, RetroDb* db);
+
     ~RetroCursor();
 
     /*!
@@ -321,4 +369,5 @@ public:
     }
 private:
     sqlite3_stmt* mStmt;
+    RetroDb* mCacheOwner;
 };
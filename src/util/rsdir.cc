@@ -35,6 +35,9 @@
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "util/rsdebug.h"
 #include "util/rsdir.h"
@@ -661,41 +664,247 @@ bool RsDirUtil::hashFile(const std::string& filepath,
 #include <openssl/sha.h>
 #include <iomanip>
 
+// Reads files ahead into a ring of buffers, for getFileHash(). Each hashing thread keeps its own reader thread,
+// which waits for the next file between two files, instead of starting a new thread for every large file.
+
+class FileReadAheadThread
+{
+public:
+	FileReadAheadThread() : mFd(NULL), mBuffers(NULL), mBufferSize(0), mBufferCount(0), mNbFilled(0), mHasJob(false), mStopReading(false), mQuit(false) {}
+
+	~FileReadAheadThread()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMtx);
+			mQuit = true;
+			mCond.notify_all();
+		}
+		if(mThread.joinable())
+			mThread.join();
+	}
+
+	// Starts reading the file into buffer_count buffers of buffer_size bytes. End of file is signaled by an empty buffer.
+	void start(FILE *fd, unsigned char *buffers, uint32_t buffer_size, uint32_t buffer_count)
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+
+		mFd = fd;
+		mBuffers = buffers;
+		mBufferSize = buffer_size;
+		mBufferCount = buffer_count;
+		mLengths.assign(buffer_count, 0);
+		mNbFilled = 0;
+		mStopReading = false;
+		mHasJob = true;
+
+		if(!mThread.joinable())
+			mThread = std::thread(&FileReadAheadThread::run, this);
+
+		mCond.notify_all();
+	}
+
+	// Waits for buffer n to be filled and returns the number of bytes read into it.
+	uint32_t waitBuffer(uint32_t n)
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		mCond.wait(lock, [&]() { return mNbFilled > 0; });
+		return mLengths[n];
+	}
+
+	// Gives back the oldest filled buffer to the reader.
+	void releaseBuffer()
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		--mNbFilled;
+		mCond.notify_all();
+	}
+
+	// Stops reading, and waits until the reader does not use the file nor the buffers anymore.
+	void finish()
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		mStopReading = true;
+		mCond.notify_all();
+		mCond.wait(lock, [&]() { return !mHasJob; });
+	}
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+
+		for(;;)
+		{
+			mCond.wait(lock, [&]() { return mHasJob || mQuit; });
+
+			if(mQuit)
+				return;
+
+			for(uint32_t n=0;;n = (n+1) % mBufferCount)
+			{
+				mCond.wait(lock, [&]() { return mNbFilled < mBufferCount || mStopReading; });
+
+				if(mStopReading)
+					break;
+
+				lock.unlock();
+				uint32_t len = fread(mBuffers + n*mBufferSize, 1, mBufferSize, mFd);
+				lock.lock();
+
+				mLengths[n] = len;
+				++mNbFilled;
+				mCond.notify_all();
+
+				if(len == 0)
+					break;
+			}
+
+			mCond.wait(lock, [&]() { return mStopReading; });
+
+			mHasJob = false;
+			mCond.notify_all();
+		}
+	}
+
+	std::thread mThread;
+	std::mutex mMtx;
+	std::condition_variable mCond;
+
+	/* below locked by mMtx */
+	FILE *mFd;
+	unsigned char *mBuffers;
+	uint32_t mBufferSize;
+	uint32_t mBufferCount;
+	std::vector<uint32_t> mLengths;
+	uint32_t mNbFilled;
+	bool mHasJob;
+	bool mStopReading;
+	bool mQuit;
+};
+
 /* Function to hash, and get details of a file */
 bool RsDirUtil::getFileHash(const std::string& filepath, RsFileHash &hash, uint64_t &size, RsThread *thread /*= NULL*/)
+{
+	std::vector<Sha1CheckSum> chunk_hashes ;
+
+	return getFileHash(filepath, hash, size, chunk_hashes, 0, thread) ;
+}
+
+/* Function to hash, and get details of a file. chunk_size=0 means no chunk hashes. */
+bool RsDirUtil::getFileHash(const std::string& filepath, RsFileHash &hash, uint64_t &size, std::vector<Sha1CheckSum>& chunk_hashes, uint32_t chunk_size, RsThread *thread /*= NULL*/, const std::function<void(uint64_t)>& on_progress /*= nullptr*/)
 {
 	FILE *fd;
 
 	if (NULL == (fd = RsDirUtil::rs_fopen(filepath.c_str(), "rb")))
 		return false;
 
-	int  len;
 	SHA_CTX *sha_ctx = new SHA_CTX;
 	unsigned char sha_buf[SHA_DIGEST_LENGTH];
 
-	static const uint32_t HASH_BUFFER_SIZE = 1024*1024*10 ;// allocate a 10MB buffer. Too small a buffer will cause multiple HD hits and slow down the hashing process.
-	RsTemporaryMemory gblBuf(HASH_BUFFER_SIZE) ;
-	//unsigned char gblBuf[512];
+	// The file is read into a ring of buffers by a separate thread, while the calling thread hashes the buffers
+	// already read, so that the disk does not wait for the CPU and the other way round. Buffers must stay large,
+	// since too small reads cause multiple HD hits and slow down the hashing process.
+
+	static const uint32_t HASH_BUFFER_SIZE  = 1024*1024*4 ;
+	static const uint32_t HASH_BUFFER_COUNT = 3 ;
 
 	/* determine size */
  	fseeko64(fd, 0, SEEK_END);
 	size = ftello64(fd);
 	fseeko64(fd, 0, SEEK_SET);
 
+#ifdef __linux__
+	/* The whole file is read once from start to end: let the kernel use a
+	 * larger readahead window, so that several hashing threads reading
+	 * different files keep the device busy. */
+	posix_fadvise(fileno(fd), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	// Files that fit in a single buffer are read at once, since there is nothing to overlap.
+
+	uint32_t nb_buffers = (size > HASH_BUFFER_SIZE) ? HASH_BUFFER_COUNT : 1 ;
+	RsTemporaryMemory gblBuf(nb_buffers*HASH_BUFFER_SIZE) ;
+
+	if(!gblBuf)
+	{
+		delete sha_ctx;
+		fclose(fd);
+		return false;
+	}
+
 	/* check if thread is running */
 	bool isRunning = thread ? thread->isRunning() : true;
-	int runningCheckCount = 0;
+
+	/* chunk hashes are computed from the same buffer, splitting it at chunk boundaries */
+	SHA_CTX chunk_ctx;
+	uint32_t chunk_len = 0;
+
+	chunk_hashes.clear();
+
+	if(chunk_size > 0)
+	{
+		chunk_hashes.reserve((size + chunk_size - 1) / chunk_size);
+		SHA1_Init(&chunk_ctx);
+	}
 
 	SHA1_Init(sha_ctx);
-	while(isRunning && (len = fread(gblBuf,1, HASH_BUFFER_SIZE, fd)) > 0)
+
+	auto hashBuffer = [&](const unsigned char *buf, uint32_t len)
 	{
-		SHA1_Update(sha_ctx, gblBuf, len);
+		SHA1_Update(sha_ctx, buf, len);
+
+		for(uint32_t pos = 0; chunk_size > 0 && pos < len;)
+		{
+			uint32_t n = std::min(len - pos, chunk_size - chunk_len);
 
-		if (thread && ++runningCheckCount > (10 * 1024)) {
-			/* check all 50MB if thread is running */
+			SHA1_Update(&chunk_ctx, buf + pos, n);
+			pos += n;
+			chunk_len += n;
+
+			if(chunk_len == chunk_size)
+			{
+				SHA1_Final(&sha_buf[0], &chunk_ctx);
+				chunk_hashes.push_back(Sha1CheckSum(sha_buf));
+
+				SHA1_Init(&chunk_ctx);
+				chunk_len = 0;
+			}
+		}
+
+		if(on_progress)
+			on_progress(len);
+
+		if(thread)
 			isRunning = thread->isRunning();
-			runningCheckCount = 0;
+	};
+
+	if(nb_buffers == 1)
+	{
+		for(uint32_t len; isRunning && (len = fread(gblBuf, 1, HASH_BUFFER_SIZE, fd)) > 0;)
+			hashBuffer(gblBuf, len);
+	}
+	else
+	{
+		// Buffers are filled and hashed in turn. The reader stops at the end of the file, or when the hashing side
+		// asks it to because the thread is stopping.
+
+		static thread_local FileReadAheadThread reader;
+
+		unsigned char *buffers = gblBuf;
+		reader.start(fd, buffers, HASH_BUFFER_SIZE, HASH_BUFFER_COUNT);
+
+		for(uint32_t n=0;isRunning;n = (n+1) % HASH_BUFFER_COUNT)
+		{
+			uint32_t len = reader.waitBuffer(n);
+
+			if(len == 0)
+				break;
+
+			hashBuffer(buffers + n*HASH_BUFFER_SIZE, len);
+			reader.releaseBuffer();
 		}
+
+		reader.finish();
 	}
 
 	/* Thread has ended */
@@ -714,6 +923,12 @@ bool RsDirUtil::getFileHash(const std::string& filepath, RsFileHash &hash, uint6
 		return false;
 	}
 
+	if(chunk_len > 0)
+	{
+		SHA1_Final(&sha_buf[0], &chunk_ctx);
+		chunk_hashes.push_back(Sha1CheckSum(sha_buf));
+	}
+
 	SHA1_Final(&sha_buf[0], sha_ctx);
 
 	hash = Sha1CheckSum(sha_buf);
@@ -25,9 +25,11 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <set>
 #include <cstdint>
 #include <system_error>
+#include <functional>
 
 class RsThread;
 
@@ -132,6 +134,15 @@ bool    	cleanupDirectoryFaster(const std::string& dir, const std::set<std::stri
 bool 		hashFile(const std::string& filepath,   std::string &name, RsFileHash &hash, uint64_t &size);
 bool 		getFileHash(const std::string& filepath,RsFileHash &hash, uint64_t &size, RsThread *thread = NULL);
 
+/**
+ * @brief Same as above, but also computes the SHA1 of each chunk of chunk_size bytes (the last one may be smaller)
+ * while reading the file, so that the file only needs to be read once.
+ * The file is read by a separate thread while the calling thread hashes what was already read.
+ * @param on_progress if set, called from the calling thread with the number of bytes hashed since the previous call,
+ *        every few MB. Lets the caller measure the hashing speed while hashing large files.
+ */
+bool 		getFileHash(const std::string& filepath,RsFileHash &hash, uint64_t &size, std::vector<Sha1CheckSum>& chunk_hashes, uint32_t chunk_size, RsThread *thread = NULL, const std::function<void(uint64_t)>& on_progress = nullptr);
+
 Sha1CheckSum   sha1sum(const uint8_t *data,uint32_t size) ;
 Sha256CheckSum sha256sum(const uint8_t *data,uint32_t size) ;
 
@@ -0,0 +1,486 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsiptrie.cc                                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/rsiptrie.h"
+
+// IPv4 addresses are stored as ::ffff:a.b.c.d
+
+static const uint32_t IPV4_MAPPED_PREFIX_LEN = 96 ;
+static const uint64_t IPV4_MAPPED_LO         = 0x0000ffff00000000ull ;
+
+// Below this number of prefixes, lookups are fast enough without the IPv4 index.
+
+static const uint32_t IPV4_INDEX_MIN_SIZE    = 4096 ;
+
+RsIpPrefixTrie::RsIpPrefixTrie() : mSize(0), mIndexDirty(false)
+{
+	clear() ;
+}
+
+void RsIpPrefixTrie::clear()
+{
+	mNodes.clear() ;
+	mFreeNodes.clear() ;
+	mIpv4Index.clear() ;
+	mSize = 0 ;
+	mIndexDirty = false ;
+
+	Key k = { 0, 0 } ;
+	newNode(k,0) ;
+}
+
+size_t RsIpPrefixTrie::memoryUsage() const
+{
+	return mNodes.capacity()*sizeof(Node) + mFreeNodes.capacity()*sizeof(uint32_t) + mIpv4Index.capacity()*sizeof(IndexEntry) ;
+}
+
+bool RsIpPrefixTrie::toKey(const sockaddr_storage& addr, Key& key, bool& is_ipv4)
+{
+	if(addr.ss_family == AF_INET)
+	{
+		const sockaddr_in *a = (const sockaddr_in*)&addr ;
+
+		key.hi = 0 ;
+		key.lo = IPV4_MAPPED_LO | ntohl(a->sin_addr.s_addr) ;
+		is_ipv4 = true ;
+		return true ;
+	}
+	if(addr.ss_family == AF_INET6)
+	{
+		const uint8_t *b = ((const sockaddr_in6*)&addr)->sin6_addr.s6_addr ;
+
+		key.hi = 0 ;
+		key.lo = 0 ;
+
+		for(int i=0;i<8;++i)
+		{
+			key.hi = (key.hi << 8) | b[i] ;
+			key.lo = (key.lo << 8) | b[i+8] ;
+		}
+		is_ipv4 = false ;
+		return true ;
+	}
+	return false ;
+}
+
+RsIpPrefixTrie::Key RsIpPrefixTrie::maskKey(const Key& key, uint32_t len)
+{
+	Key k ;
+
+	if(len == 0)
+		k.hi = 0, k.lo = 0 ;
+	else if(len < 64)
+		k.hi = key.hi & (~0ull << (64 - len)), k.lo = 0 ;
+	else if(len == 64)
+		k.hi = key.hi, k.lo = 0 ;
+	else if(len < 128)
+		k.hi = key.hi, k.lo = key.lo & (~0ull << (128 - len)) ;
+	else
+		k = key ;
+
+	return k ;
+}
+
+bool RsIpPrefixTrie::keyBit(const Key& key, uint32_t bit)
+{
+	if(bit < 64)
+		return (key.hi >> (63 - bit)) & 1 ;
+	else
+		return (key.lo >> (127 - bit)) & 1 ;
+}
+
+uint32_t RsIpPrefixTrie::commonPrefix(const Key& a, const Key& b)
+{
+	uint64_t x = a.hi ^ b.hi ;
+
+	if(x != 0)
+		return __builtin_clzll(x) ;
+
+	x = a.lo ^ b.lo ;
+
+	if(x != 0)
+		return 64 + __builtin_clzll(x) ;
+
+	return 128 ;
+}
+
+bool RsIpPrefixTrie::keyLess(const Key& a, const Key& b)
+{
+	return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo) ;
+}
+
+uint32_t RsIpPrefixTrie::newNode(const Key& key, uint32_t len)
+{
+	Node n ;
+	n.key = key ;
+	n.len = len ;
+	n.hasValue = false ;
+	n.value = 0 ;
+	n.child[0] = NO_NODE ;
+	n.child[1] = NO_NODE ;
+
+	if(!mFreeNodes.empty())
+	{
+		uint32_t i = mFreeNodes.back() ;
+		mFreeNodes.pop_back() ;
+		mNodes[i] = n ;
+		return i ;
+	}
+
+	mNodes.push_back(n) ;
+	return mNodes.size() - 1 ;
+}
+
+void RsIpPrefixTrie::freeNode(uint32_t n)
+{
+	mNodes[n].hasValue = false ;
+	mNodes[n].child[0] = NO_NODE ;
+	mNodes[n].child[1] = NO_NODE ;
+	mFreeNodes.push_back(n) ;
+}
+
+bool RsIpPrefixTrie::insert(const sockaddr_storage& addr, uint32_t prefix_len, uint32_t value)
+{
+	Key key ;
+	bool is_ipv4 ;
+
+	if(!toKey(addr,key,is_ipv4))
+		return false ;
+
+	if(prefix_len > (is_ipv4 ? 32u : 128u))
+		return false ;
+
+	return insertKey(key, prefix_len + (is_ipv4 ? IPV4_MAPPED_PREFIX_LEN : 0), value) ;
+}
+
+bool RsIpPrefixTrie::insertKey(const Key& k, uint32_t len, uint32_t value)
+{
+	Key key = maskKey(k,len) ;
+	uint32_t n = 0 ;
+
+	mIndexDirty = true ;
+
+	// Invariant: the prefix of node n is a prefix of key, and is not longer.
+
+	for(;;)
+	{
+		if(mNodes[n].len == len)
+		{
+			if(!mNodes[n].hasValue)
+				++mSize ;
+
+			mNodes[n].hasValue = true ;
+			mNodes[n].value = value ;
+			return true ;
+		}
+
+		bool b = keyBit(key, mNodes[n].len) ;
+		uint32_t c = mNodes[n].child[b] ;
+
+		if(c == NO_NODE)
+		{
+			uint32_t leaf = newNode(key,len) ;
+			mNodes[leaf].hasValue = true ;
+			mNodes[leaf].value = value ;
+			mNodes[n].child[b] = leaf ;
+			++mSize ;
+			return true ;
+		}
+
+		uint32_t cp = std::min(commonPrefix(key, mNodes[c].key), std::min(len, (uint32_t)mNodes[c].len)) ;
+
+		if(cp == mNodes[c].len)
+		{
+			n = c ;
+			continue ;
+		}
+
+		// The child diverges from key, or is longer than key: a new node goes in between.
+
+		uint32_t leaf = newNode(key,len) ;
+		mNodes[leaf].hasValue = true ;
+		mNodes[leaf].value = value ;
+		++mSize ;
+
+		if(cp == len)
+		{
+			mNodes[leaf].child[keyBit(mNodes[c].key,len)] = c ;
+			mNodes[n].child[b] = leaf ;
+			return true ;
+		}
+
+		uint32_t glue = newNode(maskKey(key,cp),cp) ;
+
+		mNodes[glue].child[keyBit(key,cp)] = leaf ;
+		mNodes[glue].child[keyBit(mNodes[c].key,cp)] = c ;
+		mNodes[n].child[b] = glue ;
+		return true ;
+	}
+}
+
+uint32_t RsIpPrefixTrie::insertRange(const sockaddr_storage& first, const sockaddr_storage& last, uint32_t value)
+{
+	Key a, b ;
+	bool a_ipv4, b_ipv4 ;
+
+	if(!toKey(first,a,a_ipv4) || !toKey(last,b,b_ipv4) || a_ipv4 != b_ipv4 || keyLess(b,a))
+		return 0 ;
+
+	uint32_t n = 0 ;
+
+	for(;;)
+	{
+		// largest aligned block starting at a, that does not go past b. Its size is 2^k.
+
+		uint32_t k = (a.lo != 0) ? __builtin_ctzll(a.lo) : ((a.hi != 0) ? 64 + __builtin_ctzll(a.hi) : 128) ;
+		Key end ;
+
+		for(;;--k)
+		{
+			end.hi = a.hi | ((k <= 64) ? 0 : ((k == 128) ? ~0ull : ((1ull << (k - 64)) - 1))) ;
+			end.lo = a.lo | ((k >= 64) ? ~0ull : ((1ull << k) - 1)) ;
+
+			if(!keyLess(b,end))
+				break ;
+		}
+
+		insertKey(a, 128 - k, value) ;
+		++n ;
+
+		if(!keyLess(end,b))
+			return n ;
+
+		// a = end + 1
+
+		a.lo = end.lo + 1 ;
+		a.hi = end.hi + (a.lo == 0) ;
+	}
+}
+
+bool RsIpPrefixTrie::remove(const sockaddr_storage& addr, uint32_t prefix_len)
+{
+	Key key ;
+	bool is_ipv4 ;
+
+	if(!toKey(addr,key,is_ipv4))
+		return false ;
+
+	if(prefix_len > (is_ipv4 ? 32u : 128u))
+		return false ;
+
+	uint32_t len = prefix_len + (is_ipv4 ? IPV4_MAPPED_PREFIX_LEN : 0) ;
+	key = maskKey(key,len) ;
+
+	uint32_t parent = NO_NODE ;
+	uint32_t n = 0 ;
+
+	while(mNodes[n].len < len)
+	{
+		uint32_t c = mNodes[n].child[keyBit(key, mNodes[n].len)] ;
+
+		if(c == NO_NODE || mNodes[c].len > len || commonPrefix(key, mNodes[c].key) < mNodes[c].len)
+			return false ;
+
+		parent = n ;
+		n = c ;
+	}
+
+	if(!mNodes[n].hasValue)
+		return false ;
+
+	mNodes[n].hasValue = false ;
+	--mSize ;
+	mIndexDirty = true ;
+
+	// Remove the node if it does not branch anymore. The root always stays.
+
+	while(n != 0 && !mNodes[n].hasValue)
+	{
+		Node& node(mNodes[n]) ;
+		uint32_t nb_children = (node.child[0] != NO_NODE) + (node.child[1] != NO_NODE) ;
+
+		if(nb_children == 2)
+			break ;
+
+		uint32_t replacement = (node.child[0] != NO_NODE) ? node.child[0] : node.child[1] ;
+		Node& p(mNodes[parent]) ;
+
+		p.child[p.child[1] == n] = replacement ;
+		freeNode(n) ;
+
+		if(replacement != NO_NODE)
+			break ;
+
+		// the parent lost a child, and may now be a useless glue node. Find its own parent.
+
+		n = parent ;
+		parent = NO_NODE ;
+
+		if(n == 0)
+			break ;
+
+		for(uint32_t m=0;m!=n;)
+		{
+			parent = m ;
+			m = mNodes[m].child[keyBit(mNodes[n].key, mNodes[m].len)] ;
+		}
+	}
+
+	return true ;
+}
+
+void RsIpPrefixTrie::descend(const Key& key, uint32_t max_len, uint32_t& n, uint32_t& best) const
+{
+	for(;;)
+	{
+		const Node& node(mNodes[n]) ;
+
+		if(node.len == 128)
+			return ;
+
+		uint32_t c = node.child[keyBit(key, node.len)] ;
+
+		if(c == NO_NODE || mNodes[c].len > max_len || commonPrefix(key, mNodes[c].key) < mNodes[c].len)
+			return ;
+
+		n = c ;
+
+		if(mNodes[n].hasValue)
+			best = n ;
+	}
+}
+
+void RsIpPrefixTrie::updateIpv4Index() const
+{
+	mIndexDirty = false ;
+
+	if(mSize < IPV4_INDEX_MIN_SIZE)
+	{
+		std::vector<IndexEntry>().swap(mIpv4Index) ;
+		return ;
+	}
+
+	mIpv4Index.resize(1 << 16) ;
+
+	for(uint32_t i=0;i<(1u << 16);++i)
+	{
+		Key key = { 0, IPV4_MAPPED_LO | (i << 16) } ;
+
+		IndexEntry& e(mIpv4Index[i]) ;
+		e.node = 0 ;
+		e.best = mNodes[0].hasValue ? 0 : NO_NODE ;
+
+		descend(key, IPV4_MAPPED_PREFIX_LEN + 16, e.node, e.best) ;
+	}
+}
+
+bool RsIpPrefixTrie::lookup(const sockaddr_storage& addr, uint32_t& value, uint32_t *prefix_len) const
+{
+	Key key ;
+	bool is_ipv4 ;
+
+	if(!toKey(addr,key,is_ipv4))
+		return false ;
+
+	if(mIndexDirty)
+		updateIpv4Index() ;
+
+	uint32_t n = 0 ;
+	uint32_t best = mNodes[0].hasValue ? 0 : NO_NODE ;
+
+	// IPv4 (and IPv4-mapped) addresses start below the node of their /16
+
+	if(!mIpv4Index.empty() && key.hi == 0 && (key.lo >> 32) == (IPV4_MAPPED_LO >> 32))
+	{
+		const IndexEntry& e(mIpv4Index[(key.lo >> 16) & 0xffff]) ;
+		n = e.node ;
+		best = e.best ;
+	}
+
+	descend(key, 128, n, best) ;
+
+	if(best == NO_NODE)
+		return false ;
+
+	uint32_t found_len = mNodes[best].len ;
+	value = mNodes[best].value ;
+
+	if(prefix_len)
+		*prefix_len = (is_ipv4 && found_len >= IPV4_MAPPED_PREFIX_LEN) ? found_len - IPV4_MAPPED_PREFIX_LEN : found_len ;
+
+	return true ;
+}
+
+bool RsIpPrefixTrie::parseAddress(const std::string& str, sockaddr_storage& addr)
+{
+	if(str.find(':') != std::string::npos)
+		return sockaddr_storage_inet_pton(addr,str) && addr.ss_family == AF_INET6 ;
+
+	// IPv4. Parsed by hand because blocklists often pad the bytes with zeros, which inet_pton refuses.
+
+	unsigned int b[4] ;
+	char c ;
+
+	if(sscanf(str.c_str(), "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &c) != 4)
+		return false ;
+
+	if(b[0] > 255 || b[1] > 255 || b[2] > 255 || b[3] > 255)
+		return false ;
+
+	sockaddr_storage_clear(addr) ;
+
+	sockaddr_in *a = (sockaddr_in*)&addr ;
+	a->sin_family = AF_INET ;
+	a->sin_addr.s_addr = htonl((b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3]) ;
+
+	return true ;
+}
+
+bool RsIpPrefixTrie::parsePrefix(const std::string& str, sockaddr_storage& addr, uint32_t& prefix_len)
+{
+	size_t slash = str.find('/') ;
+
+	if(!parseAddress(str.substr(0,slash), addr))
+		return false ;
+
+	uint32_t max_len = (addr.ss_family == AF_INET) ? 32 : 128 ;
+
+	if(slash == std::string::npos)
+	{
+		prefix_len = max_len ;
+		return true ;
+	}
+
+	const char *s = str.c_str() + slash + 1 ;
+	char *end = NULL ;
+	unsigned long l = strtoul(s, &end, 10) ;
+
+	if(end == s || *end != 0 || l > max_len)
+		return false ;
+
+	prefix_len = l ;
+	return true ;
+}
@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsiptrie.h                                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "util/rsnet.h"
+
+/*!
+ * \brief The RsIpPrefixTrie class
+ * 		Maps IP prefixes (CIDR ranges) of any length to a value, and finds the
+ * 		longest prefix that contains a given address. IPv4 and IPv6 share the
+ * 		same tree: IPv4 addresses are stored as IPv4-mapped IPv6 addresses
+ * 		(::ffff:a.b.c.d), so that an IPv4-mapped IPv6 address matches the IPv4
+ * 		prefixes.
+ *
+ * 		The tree is a path compressed binary trie, so that lookups cost at most
+ * 		one node per distinct prefix length on the path to the address, and
+ * 		nodes only exist for the stored prefixes and for the branching points
+ * 		between them. Nodes are kept in a single vector and refer to each other
+ * 		by index.
+ *
+ * 		Prefix lengths are expressed in the family of the address: 0 to 32 for
+ * 		IPv4, 0 to 128 for IPv6. The class is not thread safe, lookups
+ * 		included.
+ */
+class RsIpPrefixTrie
+{
+public:
+	RsIpPrefixTrie();
+
+	/// Adds or replaces the value of a prefix. Bits of addr after prefix_len are ignored.
+	bool insert(const sockaddr_storage& addr, uint32_t prefix_len, uint32_t value);
+
+	/*!
+	 * \brief insertRange
+	 * 			Adds all addresses between first and last (included), decomposed in the smallest
+	 * 			set of prefixes. Both addresses must be of the same family.
+	 * \return number of prefixes added, 0 if the range is invalid.
+	 */
+	uint32_t insertRange(const sockaddr_storage& first, const sockaddr_storage& last, uint32_t value);
+
+	/// Removes a prefix previously added. Returns false if the exact prefix is not in the trie.
+	bool remove(const sockaddr_storage& addr, uint32_t prefix_len);
+
+	/*!
+	 * \brief lookup
+	 * 			Finds the longest prefix containing addr. The port is ignored.
+	 * \param value      value of the prefix
+	 * \param prefix_len if not null, length of the prefix, in the family of addr when possible
+	 * \return true if a prefix was found.
+	 */
+	bool lookup(const sockaddr_storage& addr, uint32_t& value, uint32_t *prefix_len = nullptr) const;
+
+	void clear();
+
+	/// Number of prefixes stored.
+	uint32_t size() const { return mSize; }
+
+	/// Memory used by the nodes, in bytes.
+	size_t memoryUsage() const;
+
+	/*!
+	 * \brief parsePrefix
+	 * 			Parses "a.b.c.d/n", "x:x::x/n", or a single address (which means the full prefix length).
+	 */
+	static bool parsePrefix(const std::string& str, sockaddr_storage& addr, uint32_t& prefix_len);
+
+	/// Parses a single IPv4 or IPv6 address.
+	static bool parseAddress(const std::string& str, sockaddr_storage& addr);
+
+private:
+	struct Key
+	{
+		uint64_t hi;
+		uint64_t lo;
+	};
+
+	struct Node
+	{
+		Key key;			// bits after len are zero
+		uint8_t len;
+		bool hasValue;
+		uint32_t value;
+		uint32_t child[2];
+	};
+
+	static const uint32_t NO_NODE = 0xffffffff;
+
+	static bool toKey(const sockaddr_storage& addr, Key& key, bool& is_ipv4);
+	static Key maskKey(const Key& key, uint32_t len);
+	static bool keyBit(const Key& key, uint32_t bit);
+	static uint32_t commonPrefix(const Key& a, const Key& b);
+	static bool keyLess(const Key& a, const Key& b);
+
+	/// Follows key from node n, down to prefixes of at most max_len bits. best is the last node with a value.
+	void descend(const Key& key, uint32_t max_len, uint32_t& n, uint32_t& best) const;
+	void updateIpv4Index() const;
+
+	bool insertKey(const Key& key, uint32_t len, uint32_t value);
+	uint32_t newNode(const Key& key, uint32_t len);
+	void freeNode(uint32_t n);
+
+	std::vector<Node> mNodes;	// mNodes[0] is the root, i.e. the empty prefix
+	std::vector<uint32_t> mFreeNodes;
+	uint32_t mSize;
+
+	// For each /16 of the IPv4 space, the deepest node that contains it and
+	// the last node with a value above it, so that IPv4 lookups skip the top
+	// of the tree. Only built for large tries, and updated at the first lookup
+	// after a change.
+
+	struct IndexEntry
+	{
+		uint32_t node;
+		uint32_t best;
+	};
+
+	mutable std::vector<IndexEntry> mIpv4Index;
+	mutable bool mIndexDirty;
+};
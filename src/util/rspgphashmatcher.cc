@@ -0,0 +1,211 @@
+/*******************************************************************************
+ * libretroshare/src/util: rspgphashmatcher.cc                                 *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+#include <openssl/sha.h>
+
+#include "util/rspgphashmatcher.h"
+#include "util/rsthreadpool.h"
+
+// The hashed data is the hex string of the id followed by the fingerprint, which fits in a single SHA1 block
+// with its padding. Words 0-7 are the id, 8-12 the fingerprint, 13 holds the 0x80 padding byte, 15 the size in bits.
+
+static const uint32_t ID_WORDS = 2*RsGxsId::SIZE_IN_BYTES / 4;
+static const uint32_t FP_WORDS = RsPgpFingerprint::SIZE_IN_BYTES / 4;
+static const uint32_t DATA_SIZE = 2*RsGxsId::SIZE_IN_BYTES + RsPgpFingerprint::SIZE_IN_BYTES;
+
+static_assert(ID_WORDS + FP_WORDS == 13, "PGP hash data is expected to fill words 0-12 of a single SHA1 block");
+
+static const uint32_t MIN_REQUESTS_PER_THREAD = 4;	// below that, waking up a thread costs more than it saves
+
+static inline uint32_t rol(uint32_t x, uint32_t n) { return (x << n) | (x >> (32 - n)); }
+
+static inline uint32_t bigEndianWord(const unsigned char *p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// SHA1 rounds t0 to t0+19, on all lanes.
+
+template<uint32_t F> static inline void sha1Rounds(uint32_t t0, uint32_t w[16][RsPgpHashMatcher::LANES], uint32_t s[5][RsPgpHashMatcher::LANES])
+{
+	static const uint32_t K[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+	const uint32_t L = RsPgpHashMatcher::LANES;
+
+	for(uint32_t t=t0;t<t0+20;++t)
+	{
+		uint32_t *wt = w[t & 15];
+
+		if(t >= 16)
+			for(uint32_t l=0;l<L;++l)
+				wt[l] = rol(w[(t-3) & 15][l] ^ w[(t-8) & 15][l] ^ w[(t-14) & 15][l] ^ wt[l], 1);
+
+		for(uint32_t l=0;l<L;++l)
+		{
+			uint32_t a = s[0][l], b = s[1][l], c = s[2][l], d = s[3][l], e = s[4][l];
+			uint32_t f;
+
+			if(F == 0)      f = (b & c) | (~b & d);
+			else if(F == 2) f = (b & c) | (b & d) | (c & d);
+			else            f = b ^ c ^ d;
+
+			s[4][l] = d;
+			s[3][l] = c;
+			s[2][l] = rol(b, 30);
+			s[1][l] = a;
+			s[0][l] = rol(a, 5) + f + e + K[F] + wt[l];
+		}
+	}
+}
+
+RsPgpHashMatcher::RsPgpHashMatcher(const std::map<RsPgpId,RsPgpFingerprint>& fingerprints)
+{
+	for(auto it(fingerprints.begin());it!=fingerprints.end();++it)
+	{
+		mPgpIds.push_back(it->first);
+		mFingerprints.push_back(it->second);
+	}
+
+	uint32_t nb_groups = (mFingerprints.size() + LANES - 1) / LANES;
+	mFingerprintWords.resize(nb_groups * FP_WORDS * LANES, 0);
+
+	for(uint32_t i=0;i<mFingerprints.size();++i)
+		for(uint32_t k=0;k<FP_WORDS;++k)
+			mFingerprintWords[((i / LANES) * FP_WORDS + k) * LANES + i % LANES] = bigEndianWord(mFingerprints[i].toByteArray() + 4*k);
+}
+
+void RsPgpHashMatcher::computeHash(const RsGxsId& id, const RsPgpFingerprint& fingerprint, Sha1CheckSum& hash)
+{
+	unsigned char signature[SHA_DIGEST_LENGTH];
+	std::string id_str = id.toStdString();
+
+	SHA_CTX sha_ctx;
+	SHA1_Init(&sha_ctx);
+	SHA1_Update(&sha_ctx, id_str.c_str(), id_str.length());
+	SHA1_Update(&sha_ctx, fingerprint.toByteArray(), fingerprint.SIZE_IN_BYTES);
+	SHA1_Final(signature, &sha_ctx);
+
+	hash = Sha1CheckSum(signature);
+}
+
+RsPgpId RsPgpHashMatcher::match(const Request& request) const
+{
+	static const uint32_t H[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+	std::string id_str = request.id.toStdString();
+
+	if(id_str.length() != 4*ID_WORDS)
+		return RsPgpId();
+
+	uint32_t id_words[ID_WORDS];
+
+	for(uint32_t k=0;k<ID_WORDS;++k)
+		id_words[k] = bigEndianWord((const unsigned char *)id_str.c_str() + 4*k);
+
+	// Only the first word of the digest is compared in the lanes. Candidates are checked with a full hash.
+
+	uint32_t target = bigEndianWord(request.pgpHash.toByteArray()) - H[0];
+
+	uint32_t w[16][LANES];
+	uint32_t s[5][LANES];
+
+	for(uint32_t g=0;g*LANES<mFingerprints.size();++g)
+	{
+		const uint32_t *fp_words = &mFingerprintWords[g * FP_WORDS * LANES];
+
+		for(uint32_t l=0;l<LANES;++l)
+		{
+			for(uint32_t k=0;k<ID_WORDS;++k)
+				w[k][l] = id_words[k];
+
+			for(uint32_t k=0;k<FP_WORDS;++k)
+				w[ID_WORDS + k][l] = fp_words[k*LANES + l];
+
+			w[13][l] = 0x80000000;
+			w[14][l] = 0;
+			w[15][l] = 8*DATA_SIZE;
+
+			for(uint32_t k=0;k<5;++k)
+				s[k][l] = H[k];
+		}
+
+		sha1Rounds<0>( 0, w, s);
+		sha1Rounds<1>(20, w, s);
+		sha1Rounds<2>(40, w, s);
+		sha1Rounds<3>(60, w, s);
+
+		for(uint32_t l=0;l<LANES && g*LANES+l<mFingerprints.size();++l)
+			if(s[0][l] == target)
+			{
+				uint32_t i = g*LANES + l;
+				Sha1CheckSum hash;
+				computeHash(request.id, mFingerprints[i], hash);
+
+				if(hash == request.pgpHash)
+					return mPgpIds[i];
+			}
+	}
+	return RsPgpId();
+}
+
+void RsPgpHashMatcher::match(const std::vector<Request>& requests, const std::function<void(uint32_t,const RsPgpId&)>& on_result, uint32_t max_threads) const
+{
+	// Workers of the shared pool push their results, which the calling thread hands to on_result between two
+	// of its own requests, so that the expensive part of processing the results runs at the same time.
+
+	std::thread::id caller = std::this_thread::get_id();
+	std::mutex mtx;
+	std::vector<std::pair<uint32_t,RsPgpId> > results;
+	std::vector<std::pair<uint32_t,RsPgpId> > done;
+
+	auto flushResults = [&]()
+	{
+		done.clear();
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			done.swap(results);
+		}
+		for(uint32_t i=0;i<done.size();++i)
+			on_result(done[i].first, done[i].second);
+	};
+
+	RsThreadPool::shared().parallelFor(requests.size(), [&](uint32_t i)
+	{
+		RsPgpId pgp_id = match(requests[i]);
+
+		if(std::this_thread::get_id() == caller)
+		{
+			on_result(i, pgp_id);
+			flushResults();
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			results.push_back(std::make_pair(i, pgp_id));
+		}
+	}, std::max(1u,max_threads), MIN_REQUESTS_PER_THREAD);
+
+	flushResults();
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * libretroshare/src/util: rspgphashmatcher.h                                  *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <map>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+#include "retroshare/rsids.h"
+
+/*!
+ * \brief The RsPgpHashMatcher class
+ * 		Finds the PGP keys that signed GXS identities, knowing only the PGP hash
+ * 		of each identity, i.e. SHA1( hex(GxsId) | PgpFingerprint ).
+ *
+ * 		This needs one hash per identity and per known key. Since the hashed data
+ * 		is always a single SHA1 block in which only the fingerprint changes for a
+ * 		given identity, the block schedule of the identity part is computed once,
+ * 		and the fingerprints are hashed LANES at a time, in independent lanes the
+ * 		compiler can turn into SIMD code. Identities are spread over the threads of
+ * 		the shared RsThreadPool. Candidate matches are confirmed with a regular
+ * 		SHA1.
+ */
+class RsPgpHashMatcher
+{
+public:
+	struct Request
+	{
+		RsGxsId id;
+		Sha1CheckSum pgpHash;
+	};
+
+	/// Number of fingerprints hashed together.
+	static const uint32_t LANES = 8;
+
+	explicit RsPgpHashMatcher(const std::map<RsPgpId,RsPgpFingerprint>& fingerprints);
+
+	/*!
+	 * \brief match
+	 * 			Looks for the key of each request, on at most max_threads threads.
+	 * \param on_result called on the calling thread for each request, with the index of the request
+	 *                  and the matching key, or a null key. Results of the other threads are handed
+	 *                  over between two requests of the calling thread.
+	 *                  Results come in no particular order.
+	 */
+	void match(const std::vector<Request>& requests, const std::function<void(uint32_t,const RsPgpId&)>& on_result, uint32_t max_threads = 4) const;
+
+	/// Matches a single request on the calling thread. Returns a null id if no key matches.
+	RsPgpId match(const Request& request) const;
+
+	/// Regular computation of the PGP hash of an identity.
+	static void computeHash(const RsGxsId& id, const RsPgpFingerprint& fingerprint, Sha1CheckSum& hash);
+
+	uint32_t size() const { return mPgpIds.size(); }
+
+private:
+	std::vector<RsPgpId> mPgpIds;
+	std::vector<RsPgpFingerprint> mFingerprints;
+
+	// Big endian words of the fingerprints, grouped by LANES: [group][word][lane]. The last group is padded with zeros.
+	std::vector<uint32_t> mFingerprintWords;
+};
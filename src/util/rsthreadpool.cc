@@ -0,0 +1,137 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsthreadpool.cc                                     *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <atomic>
+#include <algorithm>
+
+#include "util/rsthreadpool.h"
+
+// A loop being run. Items are handed out one at a time, to whichever thread asks first. The job is only
+// reachable while items remain, so that a worker picking the loop up after it is over never calls it.
+
+struct RsThreadPool::Loop
+{
+	Loop(uint32_t n, const std::function<void(uint32_t)>& j) : next(0), nb_items(n), job(&j), running(0) {}
+
+	void work()
+	{
+		for(uint32_t i = next++; i < nb_items; i = next++)
+			(*job)(i);
+	}
+
+	std::atomic<uint32_t> next;
+	const uint32_t nb_items;
+	const std::function<void(uint32_t)> *job;
+
+	std::mutex mtx;
+	std::condition_variable cond;
+	uint32_t running;	// workers currently in work()
+};
+
+RsThreadPool::RsThreadPool(uint32_t nb_threads) : mStopping(false)
+{
+	for(uint32_t t=0;t<nb_threads;++t)
+		mThreads.push_back(std::thread([this]() { run(); }));
+}
+
+RsThreadPool::~RsThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		mStopping = true;
+	}
+	mCond.notify_all();
+
+	for(uint32_t t=0;t<mThreads.size();++t)
+		mThreads[t].join();
+}
+
+RsThreadPool& RsThreadPool::shared()
+{
+	static RsThreadPool pool(std::max(1u,std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+void RsThreadPool::run()
+{
+	for(;;)
+	{
+		std::shared_ptr<Loop> loop;
+		{
+			std::unique_lock<std::mutex> lock(mMtx);
+			mCond.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+
+			if(mStopping)
+				return;
+
+			loop = mQueue.front();
+			mQueue.pop_front();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(loop->mtx);
+			++loop->running;
+		}
+
+		loop->work();
+
+		{
+			std::lock_guard<std::mutex> lock(loop->mtx);
+			--loop->running;
+		}
+		loop->cond.notify_all();
+	}
+}
+
+void RsThreadPool::parallelFor(uint32_t nb_items, const std::function<void(uint32_t)>& job, uint32_t max_threads, uint32_t min_items_per_thread)
+{
+	uint32_t nb_threads = size() + 1;
+
+	if(max_threads > 0)
+		nb_threads = std::min(nb_threads, max_threads);
+
+	nb_threads = std::max(1u, std::min(nb_threads, nb_items / std::max(1u, min_items_per_thread)));
+
+	if(nb_threads == 1)
+	{
+		for(uint32_t i=0;i<nb_items;++i)
+			job(i);
+		return;
+	}
+
+	std::shared_ptr<Loop> loop = std::make_shared<Loop>(nb_items, job);
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+
+		for(uint32_t t=1;t<nb_threads;++t)
+			mQueue.push_back(loop);
+	}
+	mCond.notify_all();
+
+	loop->work();	// the calling thread takes its share of the work
+
+	// All items are handed out at this point. Only wait for the workers still running one of them. Workers
+	// that did not pick the loop up yet will find nothing left to do.
+
+	std::unique_lock<std::mutex> lock(loop->mtx);
+	loop->cond.wait(lock, [&loop]() { return loop->running == 0; });
+}
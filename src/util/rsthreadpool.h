@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsthreadpool.h                                      *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include <stdint.h>
+
+/*!
+ * \brief The RsThreadPool class
+ * 		A fixed set of worker threads, started once, that help running loops
+ * 		which iterations are independent of each other.
+ *
+ * 		The calling thread always takes its share of the loop, and never waits
+ * 		for a worker to become available: workers that are busy elsewhere simply
+ * 		do not take part. It is therefore safe to call parallelFor() from several
+ * 		threads at once, or from inside a job.
+ */
+class RsThreadPool
+{
+public:
+	explicit RsThreadPool(uint32_t nb_threads);
+	~RsThreadPool();
+
+	/// Pool shared by the whole library, with one thread less than the number of cores.
+	static RsThreadPool& shared();
+
+	/*!
+	 * \brief parallelFor
+	 * 			Runs job(0) to job(nb_items-1) and returns when all of them are done.
+	 * \param max_threads max number of threads running the job, including the calling thread. 0 means no limit.
+	 * \param min_items_per_thread below that number of items per thread, fewer threads are used, since
+	 *                             waking up a thread costs more than it saves. Small loops run on the calling thread only.
+	 */
+	void parallelFor(uint32_t nb_items, const std::function<void(uint32_t)>& job, uint32_t max_threads = 0, uint32_t min_items_per_thread = 1);
+
+	uint32_t size() const { return mThreads.size(); }
+
+private:
+	struct Loop;
+
+	void run();
+
+	std::vector<std::thread> mThreads;
+
+	std::mutex mMtx;
+	std::condition_variable mCond;
+	std::deque<std::shared_ptr<Loop> > mQueue;	// one entry per worker asked to help
+	bool mStopping;
+};
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * libretroshare/src/util: rswakeupsignal.cc                                   *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#include <chrono>
+
+#include "util/rswakeupsignal.h"
+
+void RsWakeupSignal::notify()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+
+		if(mSignaled)
+			return;
+
+		mSignaled = true;
+	}
+	mCond.notify_one();
+}
+
+bool RsWakeupSignal::wait(double timeout_seconds)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	if(!mSignaled && timeout_seconds > 0)
+		mCond.wait_for(lock, std::chrono::microseconds((int64_t)(timeout_seconds*1e6)), [this]() { return mSignaled; });
+
+	bool signaled = mSignaled;
+	mSignaled = false;
+
+	return signaled;
+}
+
+RsWakeupSignal& RsWakeupSignal::coreLoop()
+{
+	static RsWakeupSignal signal;
+	return signal;
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * libretroshare/src/util: rswakeupsignal.h                                    *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <retroshare.project@gmail.com>            *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+
+/*!
+ * \brief The RsWakeupSignal class
+ * 		Lets any thread wake up a thread that waits for work, so that this
+ * 		thread does not need to poll at a fixed interval. Notifications are
+ * 		not counted: several notifications before the next wait only wake
+ * 		the waiting thread once.
+ */
+class RsWakeupSignal
+{
+public:
+	RsWakeupSignal() : mSignaled(false) {}
+
+	/// Wakes up the waiting thread, or makes its next wait return right away.
+	void notify();
+
+	/*!
+	 * \brief wait  Waits until notify() is called, or the timeout expires.
+	 * \param timeout_seconds max time to wait. Returns immediately when <= 0.
+	 * \return true if the signal was notified
+	 */
+	bool wait(double timeout_seconds);
+
+	/// Signal that wakes up the core loop of RsServer, which ticks pqihandler, the connection managers and the services.
+	static RsWakeupSignal& coreLoop();
+
+private:
+	std::mutex mMtx;
+	std::condition_variable mCond;
+	bool mSignaled;
+};
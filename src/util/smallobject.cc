@@ -21,327 +21,456 @@
  *******************************************************************************/
 
 #include <iostream>
+#include <mutex>
+#include <new>
+
+#ifdef WINDOWS_SYS
+#include <malloc.h>
+#endif
+
 #include "smallobject.h"
-#include "util/rsthreads.h"
 #include "util/rsmemory.h"
 
-#include "util/rsdebug.h"
-#include "util/rsdebuglevel1.h"
-
 using namespace RsMemoryManagement ;
 
-RsMutex SmallObject::_mtx("SmallObject") ;
-SmallObjectAllocator SmallObject::_allocator(RsMemoryManagement::MAX_SMALL_OBJECT_SIZE) ;
+// std::mutex rather than RsMutex because they are constant-initialized. They
+// can be used while static objects are built or destroyed, which can happen
+// when RsItems are static members or are deleted at exit.
 
-void Chunk::init(size_t blockSize,unsigned char blocks)
-{
-	_data = new unsigned char[blockSize*blocks] ;
-	_firstAvailableBlock = 0 ;
-	_blocksAvailable = blocks ;
+static std::mutex sOrphansMtx ;
+static Slab *sOrphans[NB_SIZE_CLASSES] ;			// slabs of exited threads, per size class
+
+static std::mutex sCachesMtx ;
+static ThreadCache *sCaches = NULL ;
+static uint32_t sNextCacheId = 0 ;
+static uint32_t sExitedThreads = 0 ;
+static uint64_t sExitedAllocations = 0 ;
+static uint64_t sExitedFrees = 0 ;
+
+static std::mutex sSharedMtx ;
+static ThreadCache *sSharedCache = NULL ;			// used by threads whose cache is destroyed. Never deleted.
+
+static thread_local ThreadCache *tCache = NULL ;
+static thread_local bool tCacheDestroyed = false ;
+
+static const uint32_t SLAB_HEADER_SIZE = (sizeof(Slab) + 63) & ~63 ;
 
-	// Inits the first byte of each block to point to the next available block
-	//
-	unsigned char *p = _data ;
+static inline void increment(std::atomic<uint64_t>& counter,int64_t n = 1)
+{
+	// single writer, so there is no need for an atomic read-modify-write
+	counter.store(counter.load(std::memory_order_relaxed) + n,std::memory_order_relaxed) ;
+}
 
-	for(unsigned char i=0;i<blocks;p += blockSize)
-		*p = ++i ;
+static inline uint32_t sizeClass(size_t bytes)
+{
+	return (bytes == 0) ? 0 : (bytes-1)/SIZE_CLASS_GRANULARITY ;
 }
 
-void Chunk::free()
+static inline Slab *slabOf(void *p)
 {
-	delete[] _data ;
-	_data = NULL ;
+	return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(SLAB_SIZE-1)) ;
 }
 
-void *Chunk::allocate(size_t blockSize)
+/********************************* Slab ************************************/
+
+Slab *Slab::create(uint32_t sizeClass)
 {
-	if(!_blocksAvailable)
-		return NULL ;
+	void *mem = NULL ;
 
-	assert(blockSize >= 2) ;
+#ifdef WINDOWS_SYS
+	mem = _aligned_malloc(SLAB_SIZE,SLAB_SIZE) ;
+#else
+	if(posix_memalign(&mem,SLAB_SIZE,SLAB_SIZE) != 0)
+		mem = NULL ;
+#endif
 
-	unsigned char *result = _data + _firstAvailableBlock*blockSize ;
+	if(mem == NULL)
+	{
+		std::cerr << "RsMemoryManagement: ran out of memory !" << std::endl;
+		exit(-1) ;
+	}
 
-	// Grab id of next available block from the block being allocated.
+	Slab *s = new(mem) Slab ;
 
-	// Always the case because the first available block is the first, so the next
-	// available block is given by *result.
-	//
-	_firstAvailableBlock = *result ; 
-	--_blocksAvailable ;
+	s->_owner.store(NULL,std::memory_order_relaxed) ;
+	s->_remoteFreeList.store(NULL,std::memory_order_relaxed) ;
+	s->_freeList = NULL ;
+	s->_used = 0 ;
+	s->_sizeClass = sizeClass ;
+	s->_nbBlocks = (SLAB_SIZE - SLAB_HEADER_SIZE) / s->blockSize() ;
+	s->_nextUnused = 0 ;
+	s->_prev = NULL ;
+	s->_next = NULL ;
 
-	return result ;
+	return s ;
 }
 
-void Chunk::deallocate(void *p,size_t blockSize)
+void Slab::destroy(Slab *s)
 {
-	assert(p >= _data) ;
+	s->~Slab() ;
 
-	unsigned char *toRelease = static_cast<unsigned char *>(p) ;
+#ifdef WINDOWS_SYS
+	_aligned_free(s) ;
+#else
+	free(s) ;
+#endif
+}
 
-	// alignment check
-	
-	assert( (toRelease - _data) % blockSize == 0 ) ;
+void *Slab::allocate()
+{
+	void *p = _freeList ;
 
-	*toRelease = _firstAvailableBlock ;
-	_firstAvailableBlock = static_cast<unsigned char>( (toRelease - _data)/blockSize) ;
+	if(p != NULL)
+		_freeList = *static_cast<void**>(p) ;
+	else if(_nextUnused < _nbBlocks)
+		p = reinterpret_cast<unsigned char*>(this) + SLAB_HEADER_SIZE + (_nextUnused++) * blockSize() ;
+	else
+		return NULL ;
 
-	// truncation check
-	
-	assert(_firstAvailableBlock == (toRelease - _data)/blockSize);
+	++_used ;
+	return p ;
+}
 
-	++_blocksAvailable ;
+void Slab::deallocate(void *p)
+{
+	assert(slabOf(p) == this) ;
+	assert(_used > 0) ;
+
+	*static_cast<void**>(p) = _freeList ;
+	_freeList = p ;
+	--_used ;
 }
 
-void Chunk::printStatistics(int blockSize) const
+void Slab::deallocateRemote(void *p)
 {
-	std::cerr << "      blocksAvailable    : " << (int)_blocksAvailable << std::endl;
-	std::cerr << "      firstBlockAvailable: " << (int)_firstAvailableBlock << std::endl;
-	std::cerr << "      blocks             : " << (void*)_data << " to " << (void*)(_data+BLOCKS_PER_CHUNK*blockSize) << std::endl;
+	void *head = _remoteFreeList.load(std::memory_order_relaxed) ;
+
+	do
+		*static_cast<void**>(p) = head ;
+	while(!_remoteFreeList.compare_exchange_weak(head,p,std::memory_order_release,std::memory_order_relaxed)) ;
 }
 
-FixedAllocator::FixedAllocator(size_t bytes)
+uint32_t Slab::collectRemoteFrees()
 {
-	_blockSize = bytes ;
-	_numBlocks = BLOCKS_PER_CHUNK ;
-	_allocChunk = -1 ;
-	_deallocChunk = -1 ;
+	if(_remoteFreeList.load(std::memory_order_relaxed) == NULL)
+		return 0 ;
+
+	// Taking the whole list at once avoids the ABA problem of popping single elements.
+
+	void *p = _remoteFreeList.exchange(NULL,std::memory_order_acquire) ;
+	uint32_t n = 0 ;
+
+	while(p != NULL)
+	{
+		void *next = *static_cast<void**>(p) ;
+
+		*static_cast<void**>(p) = _freeList ;
+		_freeList = p ;
+		p = next ;
+		++n ;
+	}
+
+	assert(_used >= n) ;
+	_used -= n ;
+
+	return n ;
 }
-FixedAllocator::~FixedAllocator()
+
+/****************************** ThreadCache ********************************/
+
+ThreadCache::ThreadCache(bool shared)
+	: _shared(shared)
 {
-	for(uint32_t i=0;i<_chunks.size();++i)
+	for(uint32_t i=0;i<NB_SIZE_CLASSES;++i)
 	{
-		_chunks[i]->free() ;
-		delete _chunks[i] ;
+		_current[i] = NULL ;
+		_slabs[i] = NULL ;
 	}
+
+	std::lock_guard<std::mutex> lock(sCachesMtx) ;
+
+	_id = sNextCacheId++ ;
+	_nextCache = sCaches ;
+	sCaches = this ;
 }
 
-void *FixedAllocator::allocate()
+ThreadCache::~ThreadCache()
 {
-	if(_allocChunk < 0 || _chunks[_allocChunk]->_blocksAvailable == 0)
 	{
-		// find availabel memory in this chunk
-		//
-		uint32_t i ;
-		_allocChunk = -1 ;
-		for(i=0;i<_chunks.size();++i)
-			if(_chunks[i]->_blocksAvailable > 0)	// found a chunk
+		std::lock_guard<std::mutex> lock(sCachesMtx) ;
+
+		for(ThreadCache **c = &sCaches; *c != NULL; c = &(*c)->_nextCache)
+			if(*c == this)
 			{
-				_allocChunk = i ;
+				*c = _nextCache ;
 				break ;
 			}
-		if( _allocChunk < 0 )
+
+		++sExitedThreads ;
+		sExitedAllocations += _stats.allocations.load() ;
+		sExitedFrees += _stats.localFrees.load() + _stats.remoteFrees.load() ;
+	}
+
+	// Give away the slabs that still have blocks in use. Other threads may still
+	// free these blocks, which ends up in the remote free list of the slab.
+
+	for(uint32_t i=0;i<NB_SIZE_CLASSES;++i)
+	{
+		Slab *next = NULL ;
+
+		for(Slab *s = _slabs[i]; s != NULL; s = next)
 		{
-			_chunks.reserve(_chunks.size()+1) ;
-			Chunk *newChunk = new Chunk;
+			next = s->_next ;
+
+			s->_owner.store(NULL,std::memory_order_release) ;
+			s->collectRemoteFrees() ;
 
-			if(newChunk == NULL)
+			if(s->_used == 0)
+				Slab::destroy(s) ;
+			else
 			{
-				std::cerr << "RsMemoryManagement: ran out of memory !" << std::endl;
-				exit(-1) ;
-			}
-			newChunk->init(_blockSize,_numBlocks) ;
-			_chunks.push_back(newChunk) ;
+				std::lock_guard<std::mutex> lock(sOrphansMtx) ;
 
-			_allocChunk = _chunks.size()-1 ;
-			_deallocChunk = _chunks.size()-1 ;
+				s->_prev = NULL ;
+				s->_next = sOrphans[i] ;
+				sOrphans[i] = s ;
+			}
 		}
-
 	}
-	assert(_chunks[_allocChunk] != NULL) ;
-	assert(_chunks[_allocChunk]->_blocksAvailable > 0) ;
-
-	return _chunks[_allocChunk]->allocate(_blockSize) ;
 }
-void FixedAllocator::deallocate(void *p)
+
+ThreadCache *ThreadCache::current()
 {
-	if(_deallocChunk < 0 || !chunkOwnsPointer(*_chunks[_deallocChunk],p))
-	{
-		// find the chunk that contains this pointer. Perform a linear search.
+	return tCache ;
+}
 
-		_deallocChunk = -1 ;
+ThreadCache *ThreadCache::local()
+{
+	if(tCache != NULL)
+		return tCache ;
 
-		for(uint32_t i=0;i<_chunks.size();++i)
-			if(chunkOwnsPointer(*_chunks[i],p))
-			{
-				_deallocChunk = i ;
-				break ;
-			}
-	}
-	assert(_chunks[_deallocChunk] != NULL) ;
+	if(tCacheDestroyed)
+		return NULL ;
 
-	_chunks[_deallocChunk]->deallocate(p,_blockSize) ;
+	// Destroys the cache when the thread exits.
 
-	if(_chunks[_deallocChunk]->_blocksAvailable == BLOCKS_PER_CHUNK)
+	struct Reaper
 	{
-		_chunks[_deallocChunk]->free() ;
-		delete _chunks[_deallocChunk] ;
-
-		_chunks[_deallocChunk] = _chunks.back() ;
-		if(_allocChunk == _deallocChunk) _allocChunk = -1 ;
-		if(_allocChunk == ((int)_chunks.size())-1) _allocChunk = _deallocChunk ;
-		_deallocChunk = -1 ;
-		_chunks.pop_back();
-	}
+		~Reaper()
+		{
+			delete tCache ;
+			tCache = NULL ;
+			tCacheDestroyed = true ;
+		}
+	};
+	static thread_local Reaper reaper ;
+	(void)reaper ;
+
+	tCache = new ThreadCache ;
+	return tCache ;
 }
-uint32_t FixedAllocator::currentSize() const
+
+void *ThreadCache::allocate(uint32_t size_class)
 {
-    uint32_t res = 0 ;
+	Slab *s = _current[size_class] ;
+	void *p = (s != NULL) ? s->allocate() : NULL ;
 
-    for(uint32_t i=0;i<_chunks.size();++i)
-        res += (_numBlocks - _chunks[i]->_blocksAvailable) * _blockSize ;
+	if(p == NULL)
+		p = refill(size_class)->allocate() ;
 
-    return res ;
-}
-void FixedAllocator::printStatistics() const
-{
-	std::cerr << "    numBLocks=" << (int)_numBlocks << std::endl;
-	std::cerr << "    blockSize=" << (int)_blockSize << std::endl;
-	std::cerr << "    Number of chunks: " << _chunks.size() << std::endl;
-	for(uint32_t i=0;i<_chunks.size();++i)
-		_chunks[i]->printStatistics(_blockSize) ;
+	increment(_stats.allocations) ;
+	return p ;
 }
 
-SmallObjectAllocator::SmallObjectAllocator(size_t maxObjectSize)
-	: _maxObjectSize(maxObjectSize)
+void ThreadCache::deallocate(Slab *s,void *p)
 {
-	RsStackMutex m(SmallObject::_mtx) ;
+	s->deallocate(p) ;
+	increment(_stats.localFrees) ;
 
-	_lastAlloc = NULL ;
-	_lastDealloc = NULL ;
-	_active = true ;
-}
+	// Keep the current slab even if empty, so that alternating allocations and frees do not create slabs all the time.
 
-SmallObjectAllocator::~SmallObjectAllocator()
-{
-	RsStackMutex m(SmallObject::_mtx) ;
-
-	_active = false ;
-
-	uint32_t still_allocated = 0 ;
-        
-	for(std::map<int,FixedAllocator*>::const_iterator it(_pool.begin());it!=_pool.end();++it)
-        	still_allocated += it->second->currentSize() ;
-		//delete it->second ;
-    
-	RS_DBG2( "Memory still in use at end of program: ",
-	         still_allocated, " bytes." );
+	if(s->_used == 0 && s != _current[s->_sizeClass])
+		releaseSlab(s) ;
 }
 
-void *SmallObjectAllocator::allocate(size_t bytes)
+Slab *ThreadCache::refill(uint32_t size_class)
 {
-	if(bytes > _maxObjectSize)
-		return rs_malloc(bytes) ;
-	else if(_lastAlloc != NULL && _lastAlloc->blockSize() == bytes)
-		return _lastAlloc->allocate() ;
-	else
+	// First look for blocks freed by other threads in our own slabs
+
+	for(Slab *s = _slabs[size_class]; s != NULL; s = s->_next)
 	{
-		std::map<int,FixedAllocator*>::iterator it(_pool.find(bytes)) ;
+		increment(_stats.collectedFrees,s->collectRemoteFrees()) ;
+
+		if(s->hasFreeBlocks())
+			return _current[size_class] = s ;
+	}
 
-		if(it == _pool.end())
+	// Then adopt the slabs of exited threads. They can be full, in which case
+	// we keep them anyway, so that the blocks they contain can be collected later.
+
+	for(;;)
+	{
+		Slab *s = NULL ;
 		{
-			_pool[bytes] = new FixedAllocator(bytes) ;
-			it = _pool.find(bytes) ;
+			std::lock_guard<std::mutex> lock(sOrphansMtx) ;
+
+			s = sOrphans[size_class] ;
+
+			if(s != NULL)
+				sOrphans[size_class] = s->_next ;
 		}
-		_lastAlloc = it->second ;
 
-		return it->second->allocate() ;
+		if(s == NULL)
+			break ;
+
+		adoptSlab(s) ;
+		increment(_stats.collectedFrees,s->collectRemoteFrees()) ;
+
+		if(s->hasFreeBlocks())
+			return _current[size_class] = s ;
 	}
+
+	Slab *s = Slab::create(size_class) ;
+	adoptSlab(s) ;
+
+	return _current[size_class] = s ;
 }
 
-void SmallObjectAllocator::deallocate(void *p,size_t bytes)
+void ThreadCache::adoptSlab(Slab *s)
 {
-	if(bytes > _maxObjectSize)
-		free(p) ;
-	else if(_lastDealloc != NULL && _lastDealloc->blockSize() == bytes)
-		_lastDealloc->deallocate(p) ;
+	s->_owner.store(this,std::memory_order_relaxed) ;
+
+	s->_prev = NULL ;
+	s->_next = _slabs[s->_sizeClass] ;
+
+	if(s->_next != NULL)
+		s->_next->_prev = s ;
+
+	_slabs[s->_sizeClass] = s ;
+
+	increment(_stats.slabs) ;
+}
+
+void ThreadCache::releaseSlab(Slab *s)
+{
+	if(s->_prev != NULL)
+		s->_prev->_next = s->_next ;
 	else
-	{
-		std::map<int,FixedAllocator*>::iterator it(_pool.find(bytes)) ;
+		_slabs[s->_sizeClass] = s->_next ;
 
-		if(it == _pool.end())
-		{
-			_pool[bytes] = new FixedAllocator(bytes) ;
-			it = _pool.find(bytes) ;
-		}
-		it->second->deallocate(p) ;
-		_lastDealloc = it->second ;
-	}
+	if(s->_next != NULL)
+		s->_next->_prev = s->_prev ;
+
+	if(_current[s->_sizeClass] == s)
+		_current[s->_sizeClass] = NULL ;
+
+	increment(_stats.slabs,-1) ;
+
+	Slab::destroy(s) ;
 }
 
-void SmallObjectAllocator::printStatistics() const
+void *ThreadCache::sharedAllocate(uint32_t size_class)
 {
-	std::cerr << "RsMemoryManagement Statistics:" << std::endl;
-	std::cerr << "  Total Fixed-size allocators: " << _pool.size() << std::endl;
-	std::cerr << "Pool" << std::endl;
+	std::lock_guard<std::mutex> lock(sSharedMtx) ;
 
-	for(std::map<int,FixedAllocator*>::const_iterator it(_pool.begin());it!=_pool.end();++it)
-	{
-		std::cerr << "  Allocator for size " << it->first << " : " << std::endl;
-		std::cerr << "  Last Alloc: " << _lastAlloc << std::endl;
-		std::cerr << "  Last Dealloc: " << _lastDealloc << std::endl;
-		it->second->printStatistics() ;
-	}
+	if(sSharedCache == NULL)
+		sSharedCache = new ThreadCache(true) ;
+
+	return sSharedCache->allocate(size_class) ;
 }
 
-void *SmallObject::operator new(size_t size)
+void ThreadCache::printStatistics()
 {
-#ifdef DEBUG_MEMORY
-	bool print=false ;
+	std::cerr << "RsMemoryManagement Statistics:" << std::endl;
+	std::cerr << "  Slab size: " << SLAB_SIZE << " bytes, " << NB_SIZE_CLASSES << " size classes up to " << MAX_SMALL_OBJECT_SIZE << " bytes." << std::endl;
+
+	uint64_t total_slabs = 0 ;
 	{
-		RsStackMutex m(_mtx) ;
-		static rstime_t last_time = 0 ;
-		rstime_t now = time(NULL) ;
-		if(now > last_time + 20)
+		std::lock_guard<std::mutex> lock(sCachesMtx) ;
+
+		for(ThreadCache *c = sCaches; c != NULL; c = c->_nextCache)
 		{
-			last_time = now ;
-			print=true ;
+			const Statistics& st(c->_stats) ;
+			uint64_t slabs = st.slabs.load(std::memory_order_relaxed) ;
+
+			std::cerr << "  Thread cache #" << c->_id << (c->_shared ? " (shared)" : "") << ":"
+			          << " allocs=" << st.allocations.load(std::memory_order_relaxed)
+			          << " local frees=" << st.localFrees.load(std::memory_order_relaxed)
+			          << " remote frees=" << st.remoteFrees.load(std::memory_order_relaxed)
+			          << " collected frees=" << st.collectedFrees.load(std::memory_order_relaxed)
+			          << " slabs=" << slabs << " (" << slabs*SLAB_SIZE/1024 << " KB)" << std::endl;
+
+			total_slabs += slabs ;
 		}
+
+		std::cerr << "  Exited threads: " << sExitedThreads << ", allocs=" << sExitedAllocations << " frees=" << sExitedFrees << std::endl;
 	}
-	if(print)
-		printStatistics() ;
-#endif
 
-	RsStackMutex m(_mtx) ;
-    
-    	// This should normally not happen. But that prevents a crash when quitting, since we cannot prevent the constructor
-    	// of an object to call operator new(), nor to handle the case where it returns NULL.
-    	// The memory will therefore not be deleted if that happens. We thus print a warning.
-    
-    	if(_allocator._active)
-		return _allocator.allocate(size) ;
-	else
-        {
-            std::cerr << "(EE) allocating " << size << " bytes of memory that cannot be deleted. This is a bug, except if it happens when closing Retroshare" << std::endl;
-	    return malloc(size) ;	
-        }
-        
+	uint32_t orphans = 0 ;
+	{
+		std::lock_guard<std::mutex> lock(sOrphansMtx) ;
+
+		for(uint32_t i=0;i<NB_SIZE_CLASSES;++i)
+			for(Slab *s = sOrphans[i]; s != NULL; s = s->_next)
+				++orphans ;
+	}
+
+	std::cerr << "  Orphan slabs: " << orphans << std::endl;
+	std::cerr << "  Total: " << (total_slabs + orphans)*SLAB_SIZE/1024 << " KB" << std::endl;
+}
+
+/****************************** SmallObject ********************************/
+
+void *SmallObject::operator new(size_t size)
+{
+	if(size > (size_t)MAX_SMALL_OBJECT_SIZE)
+		return rs_malloc(size) ;
+
+	ThreadCache *cache = ThreadCache::local() ;
+
+	// The cache of the thread is already destroyed. This can only happen when
+	// the thread (or the program) is exiting.
+
+	void *p = (cache != NULL) ? cache->allocate(sizeClass(size)) : ThreadCache::sharedAllocate(sizeClass(size)) ;
+
 #ifdef DEBUG_MEMORY
 	std::cerr << "new RsItem: " << p << ", size=" << size << std::endl;
 #endif
+	return p ;
 }
 
 void SmallObject::operator delete(void *p,size_t size)
 {
-	RsStackMutex m(_mtx) ;
-
-	if(!_allocator._active)
+	if(p == NULL)
 		return ;
 
-	_allocator.deallocate(p,size) ;
 #ifdef DEBUG_MEMORY
 	std::cerr << "del RsItem: " << p << ", size=" << size << std::endl;
 #endif
+
+	if(size > (size_t)MAX_SMALL_OBJECT_SIZE)
+	{
+		free(p) ;
+		return ;
+	}
+
+	Slab *s = slabOf(p) ;
+	ThreadCache *cache = ThreadCache::current() ;
+
+	if(cache != NULL && s->_owner.load(std::memory_order_relaxed) == cache)
+		cache->deallocate(s,p) ;
+	else
+	{
+		s->deallocateRemote(p) ;
+
+		if(cache != NULL)
+			increment(cache->_stats.remoteFrees) ;
+	}
 }
 
 void SmallObject::printStatistics() 
 {
-	RsStackMutex m(_mtx) ;
-
-	if(!_allocator._active)
-		return ;
-
-	_allocator.printStatistics() ;
+	ThreadCache::printStatistics() ;
 }
 
 void RsMemoryManagement::printStatistics()
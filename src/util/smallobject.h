@@ -23,75 +23,112 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 
-#include <vector>
-#include <map>
+#include <atomic>
 
-#include <util/rsthreads.h>
+// Small objects (mostly RsItems) are allocated from per-thread caches of slabs,
+// so that allocating and freeing does not need any lock. Each slab is a
+// SLAB_SIZE aligned block of memory, cut into blocks of a single size class,
+// and owned by the thread cache that allocates from it. The slab that a block
+// belongs to is found by masking the block address.
+//
+// Blocks freed by the owner thread go back to the slab's free list. Blocks freed
+// by other threads are pushed on a lock-free list of the slab, which the owner
+// collects when it runs out of blocks. When a thread exits, the slabs that are
+// still in use become orphans, and are adopted by the next thread that needs a
+// slab of the same size class.
 
 namespace RsMemoryManagement
 {
 	static const int MAX_SMALL_OBJECT_SIZE = 128 ;
-	static const unsigned char BLOCKS_PER_CHUNK = 255 ;
+	static const uint32_t SIZE_CLASS_GRANULARITY = 16 ;
+	static const uint32_t NB_SIZE_CLASSES = MAX_SMALL_OBJECT_SIZE / SIZE_CLASS_GRANULARITY ;
+	static const uint32_t SLAB_SIZE = 16384 ;	// must be a power of 2
 
-	struct Chunk
+	class ThreadCache ;
+
+	struct Slab
 	{
-		void init(size_t blockSize,unsigned char blocks);
-		void free() ;
+		static Slab *create(uint32_t sizeClass) ;
+		static void destroy(Slab *s) ;
 
-		void *allocate(size_t);
-		void deallocate(void *p,size_t blockSize);
+		void *allocate() ;
+		void deallocate(void *p) ;
 
-		unsigned char *_data ;
-		unsigned char _firstAvailableBlock ;
-		unsigned char _blocksAvailable ;
+		// Called by non owner threads. Lock free.
+		void deallocateRemote(void *p) ;
 
-		void printStatistics(int blockSize) const ;
-	};
+		// Moves blocks freed by other threads to the free list. Owner only.
+		uint32_t collectRemoteFrees() ;
 
-	class FixedAllocator
-	{
-		public:
-			FixedAllocator(size_t bytes) ;
-			virtual ~FixedAllocator() ;
-
-			void *allocate();
-			void deallocate(void *p) ;
-			inline size_t blockSize() const { return _blockSize ; }
-			
-			inline bool chunkOwnsPointer(const Chunk& c,void *p) const 
-			{ 
-				return intptr_t(p) >= intptr_t(c._data) && (intptr_t(static_cast<unsigned char *>(p))-intptr_t(c._data))/intptr_t(_blockSize)< intptr_t( _numBlocks );
-			}
-
-            void printStatistics() const ;
-            uint32_t currentSize() const;
-    private:
-			size_t _blockSize ;
-			unsigned char _numBlocks ;
-			std::vector<Chunk*> _chunks ;
-			int _allocChunk ;				// last chunk that provided allocation. -1 if not inited
-			int _deallocChunk ;			// last chunk that provided de-allocation. -1 if not inited
+		inline bool hasFreeBlocks() const { return _freeList != NULL || _nextUnused < _nbBlocks ; }
+		inline uint32_t blockSize() const { return (_sizeClass+1)*SIZE_CLASS_GRANULARITY ; }
+
+		std::atomic<ThreadCache*> _owner ;	// NULL when the owner thread is gone
+		std::atomic<void*> _remoteFreeList ;
+
+		void *_freeList ;
+		uint32_t _used ;			// blocks that are not in _freeList, including the remotely freed ones
+		uint32_t _nbBlocks ;
+		uint32_t _nextUnused ;			// blocks from this one on have never been allocated
+		uint32_t _sizeClass ;
+
+		Slab *_prev ;
+		Slab *_next ;
 	};
 
-	class SmallObjectAllocator
+	class ThreadCache
 	{
 		public:
-			SmallObjectAllocator(size_t maxObjectSize) ;
-			virtual ~SmallObjectAllocator() ;
+			// Per thread counters. Only the owner thread writes them, so that they
+			// can be read without lock by printStatistics().
+			struct Statistics
+			{
+				Statistics() : allocations(0),localFrees(0),remoteFrees(0),collectedFrees(0),slabs(0) {}
+
+				std::atomic<uint64_t> allocations ;
+				std::atomic<uint64_t> localFrees ;		// blocks of our slabs freed by this thread
+				std::atomic<uint64_t> remoteFrees ;		// blocks of other threads' slabs freed by this thread
+				std::atomic<uint64_t> collectedFrees ;	// blocks of our slabs freed by other threads
+				std::atomic<uint64_t> slabs ;			// slabs currently owned
+			};
+
+			explicit ThreadCache(bool shared = false) ;
+			~ThreadCache() ;
+
+			/*!
+			 * \brief local
+			 * \return the cache of the calling thread, created if needed. NULL if the
+			 * 			thread is exiting and its cache was already destroyed.
+			 */
+			static ThreadCache *local() ;
+
+			/// @return the cache of the calling thread if it has one, without creating it
+			static ThreadCache *current() ;
+
+			void *allocate(uint32_t sizeClass) ;
+			void deallocate(Slab *s,void *p) ;		// s must be owned by this cache
+
+			// Allocation for threads without cache. Uses a global lock.
+			static void *sharedAllocate(uint32_t sizeClass) ;
 
-			void *allocate(size_t numBytes) ;
-			void deallocate(void *p,size_t size) ;
+			static void printStatistics() ;
 
-			void printStatistics() const ;
+			Statistics _stats ;
 
-			bool _active ;
 		private:
-			std::map<int,FixedAllocator*> _pool ;
-			FixedAllocator *_lastAlloc ;
-			FixedAllocator *_lastDealloc ;
-			size_t _maxObjectSize ;
+			Slab *refill(uint32_t sizeClass) ;
+			void adoptSlab(Slab *s) ;
+			void releaseSlab(Slab *s) ;
+
+			Slab *_current[NB_SIZE_CLASSES] ;	// slab currently used for allocation
+			Slab *_slabs[NB_SIZE_CLASSES] ;		// all owned slabs, including _current
+
+			uint32_t _id ;
+			bool _shared ;
+			ThreadCache *_nextCache ;		// list of all caches, for statistics
 	};
 
 	class SmallObject
@@ -103,12 +140,6 @@ namespace RsMemoryManagement
 			static void printStatistics() ;
 
 			virtual ~SmallObject() {}
-
-		private:
-			static SmallObjectAllocator _allocator ;
-			static RsMutex _mtx;
-
-			friend class SmallObjectAllocator ;
 	};
 
 	extern void printStatistics() ;
@@ -46,6 +46,14 @@ class FakeServiceControl: public p3ServiceControl
                 peerSet.insert(*it) ;
         }
 
+	virtual bool isPeerConnected(uint32_t serviceId, const RsPeerId &peerId)
+        {
+	    std::set<RsPeerId> peerSet ;
+	    getPeersConnected(serviceId, peerSet) ;
+
+	    return peerSet.find(peerId) != peerSet.end() ;
+        }
+
     virtual bool checkFilter(uint32_t,const RsPeerId& id)
     {
 	(void) id;
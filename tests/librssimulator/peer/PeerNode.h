@@ -29,6 +29,9 @@ class RsRawItem ;
 class p3ServiceServer ;
 class FakePublisher;
 class p3ServiceControl;
+class p3LinkMgr;
+class p3PeerMgr;
+class p3NetMgr;
 class FakeLinkMgr;
 class FakePeerMgr;
 class FakeNetMgr;
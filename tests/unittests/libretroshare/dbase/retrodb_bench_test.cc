@@ -0,0 +1,196 @@
+/*******************************************************************************
+ * unittests/libretroshare/dbase/retrodb_bench_test.cc                         *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+// from libretroshare
+
+#include "util/retrodb.h"
+#include "util/rsdir.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+#include "retroshare/rsids.h"
+#include "retroshare/rsgxsifacetypes.h"
+
+// Compares the two ways RsDataService fetches a set of messages: one query
+// built and prepared for each message id (old), and cached prepared statements
+// with bound "msgId IN (...)" chunks (new). The table mimics the MESSAGES table
+// of RsDataService.
+
+static const uint32_t BENCH_DATA_SIZE   = 512 ;
+static const uint32_t BENCH_CHUNK_SIZES[] = { 1, 8, 64, 256 };
+
+static const std::string TABLE("MESSAGES") ;
+
+static uint32_t fetchOneByOne(RetroDb& db, const std::list<std::string>& columns, const std::string& grpId, const std::vector<RsGxsMessageId>& ids)
+{
+	uint32_t n = 0 ;
+
+	for(uint32_t i=0;i<ids.size();++i)
+	{
+		RetroCursor *c = db.sqlQuery(TABLE, columns, "grpId='" + grpId + "' AND msgId='" + ids[i].toStdString() + "'", "") ;
+
+		for(bool valid = c && c->moveToFirst(); valid; valid = c->moveToNext())
+		{
+			uint32_t size = 0 ;
+			c->getData(1,size) ;
+			n += (size == BENCH_DATA_SIZE) ;
+		}
+		delete c ;
+	}
+	return n ;
+}
+
+static uint32_t fetchByChunks(RetroDb& db, const std::list<std::string>& columns, const std::string& grpId, const std::vector<RsGxsMessageId>& ids)
+{
+	uint32_t n = 0 ;
+
+	for(uint32_t start=0;start<ids.size();)
+	{
+		uint32_t remaining = ids.size() - start ;
+		uint32_t chunk_size = BENCH_CHUNK_SIZES[3] ;
+
+		for(uint32_t i=0;i<4;++i)
+			if(BENCH_CHUNK_SIZES[i] >= remaining)
+			{
+				chunk_size = BENCH_CHUNK_SIZES[i] ;
+				break ;
+			}
+
+		uint32_t nb_ids = std::min(chunk_size,remaining) ;
+
+		std::list<RetroBind*> args ;
+		args.push_back(new RsStringBind(grpId,1)) ;
+
+		std::string selection = "+grpId=? AND msgId IN (" ;
+
+		for(uint32_t i=0;i<chunk_size;++i)
+		{
+			selection += (i == 0) ? "?" : ",?" ;
+			args.push_back(new RsStringBind(ids[start + std::min(i,nb_ids-1)].toStdString(),i+2)) ;
+		}
+		selection += ")" ;
+		start += nb_ids ;
+
+		RetroCursor *c = db.sqlQuery(TABLE, columns, selection, args, "") ;
+
+		for(bool valid = c && c->moveToFirst(); valid; valid = c->moveToNext())
+		{
+			uint32_t size = 0 ;
+			c->getData(1,size) ;
+			n += (size == BENCH_DATA_SIZE) ;
+		}
+		delete c ;
+	}
+	return n ;
+}
+
+// Fetches nb_requests random msgs out of nb_msgs, both ways. The fetch times are returned in t_old and t_new.
+
+static void fetchMsgs(uint32_t nb_msgs,uint32_t nb_requests,double& t_old,double& t_new)
+{
+	t_old = t_new = 0 ;
+
+	char tmpl[] = "/tmp/rs_retrodb_bench_XXXXXX" ;
+	ASSERT_TRUE(mkdtemp(tmpl) != NULL) ;
+
+	std::string dbPath = std::string(tmpl) + "/bench_db" ;
+	RetroDb db(dbPath, RetroDb::OPEN_READWRITE_CREATE) ;
+	ASSERT_TRUE(db.isOpen()) ;
+
+	ASSERT_TRUE(db.execSQL("CREATE TABLE " + TABLE + "(msgId TEXT PRIMARY KEY, grpId TEXT, nxsData BLOB, timeStamp INT);")) ;
+	ASSERT_TRUE(db.execSQL("CREATE INDEX INDEX_MESSAGES_GRPID ON " + TABLE + "(grpId);")) ;
+
+	std::string grpId = RsGxsGroupId::random().toStdString() ;
+	std::vector<RsGxsMessageId> msgIds ;
+	std::vector<char> data(BENCH_DATA_SIZE) ;
+
+	db.beginTransaction() ;
+
+	for(uint32_t i=0;i<nb_msgs;++i)
+	{
+		RsGxsMessageId id = RsGxsMessageId::random() ;
+		msgIds.push_back(id) ;
+
+		RsRandom::random_bytes((unsigned char*)data.data(),data.size()) ;
+
+		ContentValue cv ;
+		cv.put("msgId", id.toStdString()) ;
+		cv.put("grpId", grpId) ;
+		cv.put("nxsData", (uint32_t)data.size(), data.data()) ;
+		cv.put("timeStamp", (int32_t)i) ;
+
+		ASSERT_TRUE(db.sqlInsert(TABLE, "", cv)) ;
+	}
+
+	db.commitTransaction() ;
+
+	// request a random subset of the messages, as during a sync
+	for(uint32_t i=msgIds.size()-1;i>0;--i)
+		std::swap(msgIds[i], msgIds[RsRandom::random_u32() % (i+1)]) ;
+
+	msgIds.resize(nb_requests) ;
+
+	std::list<std::string> columns ;
+	columns.push_back("msgId") ;
+	columns.push_back("nxsData") ;
+	columns.push_back("timeStamp") ;
+
+	double start = rstime::RsScopeTimer::currentTime() ;
+	uint32_t n_old = fetchOneByOne(db, columns, grpId, msgIds) ;
+	t_old = rstime::RsScopeTimer::currentTime() - start ;
+
+	start = rstime::RsScopeTimer::currentTime() ;
+	uint32_t n_new = fetchByChunks(db, columns, grpId, msgIds) ;
+	t_new = rstime::RsScopeTimer::currentTime() - start ;
+
+	EXPECT_EQ(n_old, nb_requests) ;
+	EXPECT_EQ(n_new, nb_requests) ;
+
+	// the cached statements must be reusable
+	EXPECT_EQ(fetchByChunks(db, columns, grpId, msgIds), nb_requests) ;
+
+	db.closeDb() ;
+	remove(dbPath.c_str()) ;
+	rmdir(tmpl) ;
+}
+
+TEST(libretroshare_dbase, RetroDbMsgFetch)
+{
+	double t_old, t_new ;
+	fetchMsgs(2000,517,t_old,t_new) ;	// not a multiple of the chunk sizes
+}
+
+// 5000 msgs fetched out of 20000: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_dbase, DISABLED_RetroDbMsgFetchThroughput)
+{
+	const uint32_t NB_REQUESTS = 5000 ;
+
+	double t_old, t_new ;
+	fetchMsgs(20000,NB_REQUESTS,t_old,t_new) ;
+
+	std::cerr << "  one query per msg       : " << NB_REQUESTS / t_old << " msgs/s" << std::endl;
+	std::cerr << "  cached chunked queries  : " << NB_REQUESTS / t_new << " msgs/s" << std::endl;
+}
@@ -0,0 +1,337 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/compactfilelist_test.cc                *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+// from libretroshare
+
+#include "file_sharing/compact_file_list.h"
+#include "file_sharing/dir_hierarchy.h"
+#include "file_sharing/file_sharing_defaults.h"
+#include "util/rsdir.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+
+// The file key is normally encrypted with the node's SSL key, which is not available here.
+
+class XorKeyEncryption: public CompactFileList::KeyEncryption
+{
+public:
+	virtual bool encrypt(const unsigned char *data,uint32_t size,std::vector<unsigned char>& out)
+	{
+		out.resize(size) ;
+		for(uint32_t i=0;i<size;++i) out[i] = data[i] ^ 0x5a ;
+		return true ;
+	}
+	virtual bool decrypt(const unsigned char *data,uint32_t size,std::vector<unsigned char>& out) { return encrypt(data,size,out) ; }
+};
+
+static const char *WORDS[] = { "holiday", "concert", "mozart", "linux", "debian", "episode", "photo", "album", "remix", "live" } ;
+
+static std::string randomName(uint32_t i)
+{
+	return std::string(WORDS[RSRandom::random_u32()%10]) + "_" + WORDS[RSRandom::random_u32()%10] + "_" + std::to_string(i) + ".mp3" ;
+}
+
+// Builds a friend file list with the given number of directories and files per directory.
+
+static void buildHierarchy(InternalFileHierarchyStorage& storage,uint32_t nb_dirs,uint32_t files_per_dir)
+{
+	RsFileHash salt = RsFileHash::random() ;
+	std::set<std::string> top_dirs ;
+
+	for(uint32_t i=0;i<nb_dirs;++i)
+		top_dirs.insert("dir_" + std::to_string(i)) ;
+
+	storage.updateSubDirectoryList(0,top_dirs,salt) ;
+
+	InternalFileHierarchyStorage::DirEntry root("") ;
+	storage.getDirEntry(0,root) ;
+	std::vector<DirectoryStorage::EntryIndex> dirs(root.subdirs) ;
+	uint32_t n = 0 ;
+
+	for(uint32_t d=0;d<dirs.size();++d)
+	{
+		std::map<std::string,DirectoryStorage::FileTS> subfiles,new_files ;
+
+		for(uint32_t f=0;f<files_per_dir;++f,++n)
+		{
+			DirectoryStorage::FileTS ts ;
+			ts.size = 1000 + RSRandom::random_u32() % 1000000 ;
+			ts.modtime = 1600000000 + n ;
+			subfiles[randomName(n)] = ts ;
+		}
+		storage.updateSubFilesList(dirs[d],subfiles,new_files) ;
+
+		InternalFileHierarchyStorage::DirEntry de("") ;
+		storage.getDirEntry(dirs[d],de) ;
+		std::vector<DirectoryStorage::EntryIndex> files(de.subfiles) ;
+
+		for(uint32_t f=0;f<files.size();++f)
+			storage.updateHash(files[f],RsFileHash::random()) ;
+	}
+	storage.recursUpdateCumulatedSize(0) ;
+}
+
+static std::string tmpFileName()
+{
+	char tmpl[] = "/tmp/rs_compact_file_list_XXXXXX" ;
+	int fd = mkstemp(tmpl) ;
+	close(fd) ;
+	return std::string(tmpl) ;
+}
+
+TEST(libretroshare_file_sharing, CompactFileList_SaveAndBrowse)
+{
+	XorKeyEncryption ke ;
+	InternalFileHierarchyStorage storage ;
+	buildHierarchy(storage,20,50) ;
+
+	std::string fname = tmpFileName() ;
+
+	ASSERT_TRUE(CompactFileList::save(storage,fname,&ke)) ;
+	ASSERT_TRUE(CompactFileList::isCompactFile(fname)) ;
+
+	CompactFileList *list = CompactFileList::open(fname,&ke) ;
+	ASSERT_TRUE(list != NULL) ;
+
+	// nothing is decrypted until entries are read
+
+	EXPECT_EQ(list->nbDecryptedChunks(),0u) ;
+
+	InternalFileHierarchyStorage::DirEntry root("") ;
+	InternalFileHierarchyStorage::DirEntry storage_root("") ;
+	ASSERT_TRUE(list->getDirEntry(0,root)) ;
+	ASSERT_TRUE(storage.getDirEntry(0,storage_root)) ;
+	EXPECT_EQ(root.subdirs,storage_root.subdirs) ;
+
+	for(uint32_t i=0;i<storage.nbEntries();++i)
+	{
+		ASSERT_EQ(list->getType(i),storage.getType(i)) ;
+
+		if(storage.getType(i) == InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE)
+		{
+			InternalFileHierarchyStorage::FileEntry fe ;
+			InternalFileHierarchyStorage::FileEntry ref ;
+
+			ASSERT_TRUE(storage.getFileEntry(i,ref)) ;
+			ASSERT_TRUE(list->getFileEntry(i,fe)) ;
+			EXPECT_EQ(fe.file_name,ref.file_name) ;
+			EXPECT_EQ(fe.file_size,ref.file_size) ;
+			EXPECT_EQ(fe.file_hash,ref.file_hash) ;
+			EXPECT_EQ(fe.parent_index,ref.parent_index) ;
+			EXPECT_EQ(list->parentRow(i),storage.parentRow(i)) ;
+
+			DirectoryStorage::EntryIndex found ;
+			EXPECT_TRUE(list->searchHash(ref.file_hash,found)) ;
+			EXPECT_EQ(found,i) ;
+		}
+		else if(storage.getType(i) == InternalFileHierarchyStorage::FileStorageNode::TYPE_DIR)
+		{
+			InternalFileHierarchyStorage::DirEntry de("") ;
+			InternalFileHierarchyStorage::DirEntry ref("") ;
+
+			ASSERT_TRUE(storage.getDirEntry(i,ref)) ;
+			ASSERT_TRUE(list->getDirEntry(i,de)) ;
+			EXPECT_EQ(de.dir_name,ref.dir_name) ;
+			EXPECT_EQ(de.dir_parent_path,ref.dir_parent_path) ;
+			EXPECT_EQ(de.dir_hash,ref.dir_hash) ;
+			EXPECT_EQ(de.dir_cumulated_size,ref.dir_cumulated_size) ;
+			EXPECT_EQ(de.subfiles,ref.subfiles) ;
+
+			for(uint32_t r=0;r<ref.subdirs.size()+ref.subfiles.size();++r)
+			{
+				DirectoryStorage::EntryIndex c1,c2 ;
+				EXPECT_TRUE(list->getChildIndex(i,r,c1)) ;
+				EXPECT_TRUE(storage.getChildIndex(i,r,c2)) ;
+				EXPECT_EQ(c1,c2) ;
+			}
+		}
+	}
+
+	// searches give the same results as the hierarchy in memory. The order of the results depends on how hashes are stored.
+
+	std::list<std::string> terms = { "Mozart", "linux_" } ;
+	std::list<DirectoryStorage::EntryIndex> res1,res2 ;
+
+	list->searchTerms(terms,res1) ;
+	storage.searchTerms(terms,res2) ;
+	res1.sort() ;
+	res2.sort() ;
+
+	EXPECT_FALSE(res1.empty()) ;
+	EXPECT_EQ(res1,res2) ;
+
+	// the loaded hierarchy has the same entry indices
+
+	InternalFileHierarchyStorage loaded ;
+	ASSERT_TRUE(list->materialise(loaded)) ;
+
+	std::string err ;
+	EXPECT_TRUE(loaded.check(err)) << err ;
+	ASSERT_EQ(loaded.nbEntries(),storage.nbEntries()) ;
+
+	for(uint32_t i=0;i<storage.nbEntries();++i)
+		if(storage.getType(i) == InternalFileHierarchyStorage::FileStorageNode::TYPE_FILE)
+		{
+			std::string n1,n2 ;
+			EXPECT_TRUE(loaded.getName(i,n1)) ;
+			EXPECT_TRUE(storage.getName(i,n2)) ;
+			EXPECT_EQ(n1,n2) ;
+		}
+
+	SharedDirStats s1,s2 ;
+	list->getStatistics(s1) ;
+	storage.getStatistics(s2) ;
+	EXPECT_EQ(s1.total_number_of_files,s2.total_number_of_files) ;
+	EXPECT_EQ(s1.total_shared_size,s2.total_shared_size) ;
+
+	delete list ;
+	remove(fname.c_str()) ;
+}
+
+TEST(libretroshare_file_sharing, CompactFileList_Corruption)
+{
+	XorKeyEncryption ke ;
+	InternalFileHierarchyStorage storage ;
+	buildHierarchy(storage,5,20) ;
+
+	std::string fname = tmpFileName() ;
+	ASSERT_TRUE(CompactFileList::save(storage,fname,&ke)) ;
+
+	// flip a byte of the last chunk
+
+	FILE *f = fopen(fname.c_str(),"r+b") ;
+	fseek(f,-20,SEEK_END) ;
+	int c = fgetc(f) ;
+	fseek(f,-20,SEEK_END) ;
+	fputc(c ^ 1,f) ;
+	fclose(f) ;
+
+	CompactFileList *list = CompactFileList::open(fname,&ke) ;
+	ASSERT_TRUE(list != NULL) ;
+
+	InternalFileHierarchyStorage loaded ;
+	EXPECT_FALSE(list->materialise(loaded)) ;
+
+	delete list ;
+
+	// truncated files are refused
+
+	ASSERT_TRUE(CompactFileList::save(storage,fname,&ke)) ;
+	EXPECT_EQ(truncate(fname.c_str(),100),0) ;
+	EXPECT_TRUE(CompactFileList::open(fname,&ke) == NULL) ;
+
+	remove(fname.c_str()) ;
+}
+
+TEST(libretroshare_file_sharing, CompactFileList_BrowseDecryptsFewChunks)
+{
+	XorKeyEncryption ke ;
+	InternalFileHierarchyStorage storage ;
+	buildHierarchy(storage,200,100) ;	// 20k files
+
+	std::string fname = tmpFileName() ;
+
+	ASSERT_TRUE(CompactFileList::save(storage,fname,&ke)) ;
+
+	CompactFileList *list = CompactFileList::open(fname,&ke) ;
+	ASSERT_TRUE(list != NULL) ;
+
+	// browsing a sub-directory only decrypts the chunks that hold its entries
+
+	InternalFileHierarchyStorage::DirEntry root("") ;
+	InternalFileHierarchyStorage::DirEntry sub("") ;
+	std::string name ;
+
+	ASSERT_TRUE(list->getDirEntry(0,root)) ;
+	ASSERT_TRUE(list->getDirEntry(root.subdirs[root.subdirs.size()/2],sub)) ;
+
+	for(uint32_t i=0;i<sub.subfiles.size();++i)
+		EXPECT_TRUE(list->getName(sub.subfiles[i],name)) ;
+
+	uint32_t browse_chunks = list->nbDecryptedChunks() ;
+
+	InternalFileHierarchyStorage loaded ;
+	ASSERT_TRUE(list->materialise(loaded)) ;
+
+	EXPECT_LT(browse_chunks,COMPACT_FILE_LIST_CACHED_CHUNKS) ;
+	EXPECT_GT(list->nbDecryptedChunks(),COMPACT_FILE_LIST_CACHED_CHUNKS) ;
+	EXPECT_EQ(loaded.nbEntries(),storage.nbEntries()) ;
+
+	delete list ;
+	remove(fname.c_str()) ;
+}
+
+// 200k files: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_file_sharing, DISABLED_CompactFileList_Bench)
+{
+	XorKeyEncryption ke ;
+	InternalFileHierarchyStorage storage ;
+	buildHierarchy(storage,1000,200) ;	// 200k files
+
+	std::string fname = tmpFileName() ;
+
+	rstime::RsScopeTimer timer("") ;
+	double t0 = timer.duration() ;
+
+	ASSERT_TRUE(CompactFileList::save(storage,fname,&ke)) ;
+	double t1 = timer.duration() ;
+
+	CompactFileList *list = CompactFileList::open(fname,&ke) ;
+	ASSERT_TRUE(list != NULL) ;
+	double t2 = timer.duration() ;
+
+	// browse the top directory and one of its sub-directories
+
+	InternalFileHierarchyStorage::DirEntry root("") ;
+	InternalFileHierarchyStorage::DirEntry sub("") ;
+	std::string name ;
+
+	ASSERT_TRUE(list->getDirEntry(0,root)) ;
+	ASSERT_TRUE(list->getDirEntry(root.subdirs[root.subdirs.size()/2],sub)) ;
+
+	for(uint32_t i=0;i<sub.subfiles.size();++i)
+		list->getName(sub.subfiles[i],name) ;
+
+	double t3 = timer.duration() ;
+	uint32_t browse_chunks = list->nbDecryptedChunks() ;
+
+	InternalFileHierarchyStorage loaded ;
+	ASSERT_TRUE(list->materialise(loaded)) ;
+	double t4 = timer.duration() ;
+
+	uint64_t file_size = 0 ;
+	RsDirUtil::checkFile(fname,file_size) ;
+
+	std::cerr << "  200000 files. File size: " << file_size/1024 << " KB" << std::endl;
+	std::cerr << "  save       : " << 1000*(t1-t0) << " ms" << std::endl;
+	std::cerr << "  open       : " << 1000*(t2-t1) << " ms" << std::endl;
+	std::cerr << "  browse     : " << 1000*(t3-t2) << " ms, " << browse_chunks << " chunks decrypted" << std::endl;
+	std::cerr << "  materialise: " << 1000*(t4-t3) << " ms, " << list->nbDecryptedChunks() << " chunks decrypted" << std::endl;
+
+	EXPECT_LT(browse_chunks,COMPACT_FILE_LIST_CACHED_CHUNKS) ;
+
+	delete list ;
+	remove(fname.c_str()) ;
+}
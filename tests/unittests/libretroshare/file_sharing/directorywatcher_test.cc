@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/directorywatcher_test.cc               *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// from libretroshare
+
+#include "file_sharing/directory_watcher.h"
+#include "util/rsdir.h"
+
+static std::string makeTmpDir()
+{
+	char tmpl[] = "/tmp/rs_dirwatcher_XXXXXX" ;
+	return std::string(mkdtemp(tmpl)) ;
+}
+
+static void touchFile(const std::string& path)
+{
+	FILE *f = fopen(path.c_str(),"w") ;
+	fprintf(f,"some content") ;
+	fclose(f) ;
+}
+
+TEST(libretroshare_file_sharing, DirectoryWatcherReportsChangedDirectories)
+{
+	DirectoryWatcher watcher ;
+
+	if(!watcher.isAvailable())
+		return ;	// no inotify on this system
+
+	std::string root = makeTmpDir() ;
+	std::string sub1 = RsDirUtil::makePath(root,"sub1") ;
+	std::string sub2 = RsDirUtil::makePath(root,"sub2") ;
+
+	ASSERT_TRUE(RsDirUtil::checkCreateDirectory(sub1)) ;
+	ASSERT_TRUE(RsDirUtil::checkCreateDirectory(sub2)) ;
+
+	watcher.beginSweep() ;
+	EXPECT_TRUE(watcher.watch(root)) ;
+	EXPECT_TRUE(watcher.watch(sub1)) ;
+	EXPECT_TRUE(watcher.watch(sub2)) ;
+	watcher.endSweep() ;
+
+	EXPECT_TRUE(watcher.isComplete()) ;
+	EXPECT_EQ(watcher.size(),3u) ;
+
+	std::set<std::string> changed_dirs ;
+	bool overflow = true ;
+
+	watcher.readEvents(changed_dirs,overflow) ;
+	EXPECT_TRUE(changed_dirs.empty()) ;
+	EXPECT_FALSE(overflow) ;
+
+	// only the directory that holds the new file is reported
+
+	touchFile(RsDirUtil::makePath(sub1,"file.txt")) ;
+
+	watcher.readEvents(changed_dirs,overflow) ;
+	EXPECT_EQ(changed_dirs,std::set<std::string>({ sub1 })) ;
+
+	// removing a directory reports its parent, and drops the watch
+
+	changed_dirs.clear() ;
+	rmdir(sub2.c_str()) ;
+
+	watcher.readEvents(changed_dirs,overflow) ;
+	EXPECT_TRUE(changed_dirs.find(root) != changed_dirs.end()) ;
+	EXPECT_FALSE(watcher.isWatched(sub2)) ;
+
+	remove(RsDirUtil::makePath(sub1,"file.txt").c_str()) ;
+	rmdir(sub1.c_str()) ;
+	rmdir(root.c_str()) ;
+}
+
+TEST(libretroshare_file_sharing, DirectoryWatcherSweepsAndSubTrees)
+{
+	DirectoryWatcher watcher ;
+
+	if(!watcher.isAvailable())
+		return ;
+
+	std::string root = makeTmpDir() ;
+	std::string sub  = RsDirUtil::makePath(root,"sub") ;
+	std::string subsub = RsDirUtil::makePath(sub,"subsub") ;
+	std::string other = root + "_other" ;
+
+	ASSERT_TRUE(RsDirUtil::checkCreateDirectory(sub)) ;
+	ASSERT_TRUE(RsDirUtil::checkCreateDirectory(subsub)) ;
+	ASSERT_TRUE(RsDirUtil::checkCreateDirectory(other)) ;
+
+	watcher.beginSweep() ;
+	watcher.watch(root) ;
+	watcher.watch(sub) ;
+	watcher.watch(subsub) ;
+	watcher.watch(other) ;
+	watcher.endSweep() ;
+
+	EXPECT_EQ(watcher.size(),4u) ;
+
+	// unwatching a directory also unwatches its sub-directories, but not directories that only share a prefix
+
+	watcher.unwatch(root) ;
+
+	EXPECT_FALSE(watcher.isWatched(root)) ;
+	EXPECT_FALSE(watcher.isWatched(sub)) ;
+	EXPECT_FALSE(watcher.isWatched(subsub)) ;
+	EXPECT_TRUE(watcher.isWatched(other)) ;
+
+	// directories not seen during a sweep are dropped
+
+	watcher.beginSweep() ;
+	watcher.watch(root) ;
+	watcher.endSweep() ;
+
+	EXPECT_TRUE(watcher.isWatched(root)) ;
+	EXPECT_FALSE(watcher.isWatched(other)) ;
+	EXPECT_EQ(watcher.size(),1u) ;
+
+	rmdir(subsub.c_str()) ;
+	rmdir(sub.c_str()) ;
+	rmdir(root.c_str()) ;
+	rmdir(other.c_str()) ;
+}
+
+TEST(libretroshare_file_sharing, DirectoryWatcherSameDirectoryTwice)
+{
+	DirectoryWatcher watcher ;
+
+	if(!watcher.isAvailable())
+		return ;
+
+	std::string root = makeTmpDir() ;
+	std::string sub  = RsDirUtil::makePath(root,"sub") ;
+	std::string link = RsDirUtil::makePath(root,"link") ;
+
+	ASSERT_TRUE(RsDirUtil::checkCreateDirectory(sub)) ;
+	ASSERT_EQ(symlink(sub.c_str(),link.c_str()),0) ;
+
+	// the link gives the same watch descriptor as the directory it points to. Changes seen through it would
+	// not be reported, so the watcher is not complete anymore.
+
+	watcher.beginSweep() ;
+	EXPECT_TRUE(watcher.watch(root)) ;
+	EXPECT_TRUE(watcher.watch(sub)) ;
+	EXPECT_FALSE(watcher.watch(link)) ;
+	watcher.endSweep() ;
+
+	EXPECT_FALSE(watcher.isWatched(link)) ;
+	EXPECT_FALSE(watcher.isComplete()) ;
+
+	// the next sweep without the link is complete again
+
+	watcher.beginSweep() ;
+	watcher.watch(root) ;
+	watcher.watch(sub) ;
+	watcher.endSweep() ;
+
+	EXPECT_TRUE(watcher.isComplete()) ;
+
+	remove(link.c_str()) ;
+	rmdir(sub.c_str()) ;
+	rmdir(root.c_str()) ;
+}
@@ -0,0 +1,300 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/dirhierarchy_test.cc                   *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <malloc.h>
+
+// from libretroshare
+
+#include "file_sharing/dir_hierarchy.h"
+#include "file_sharing/hash_index_table.h"
+#include "file_sharing/name_table.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+
+TEST(libretroshare_file_sharing, HashIndexTable)
+{
+	HashIndexTable table ;
+	std::map<RsFileHash,DirectoryStorage::EntryIndex> ref ;
+	std::vector<RsFileHash> hashes ;
+
+	for(uint32_t i=0;i<5000;++i)
+		hashes.push_back(RsFileHash::random()) ;
+
+	hashes.push_back(RsFileHash()) ;	// the null hash is a valid key (top directory, files not hashed yet)
+
+	// random inserts, replacements and removals, compared with std::map
+
+	for(uint32_t i=0;i<50000;++i)
+	{
+		const RsFileHash& h(hashes[RSRandom::random_u32() % hashes.size()]) ;
+
+		if(RSRandom::random_u32() % 3 == 0)
+			EXPECT_EQ(table.erase(h),ref.erase(h) > 0) ;
+		else
+		{
+			table.insert(h,i) ;
+			ref[h] = i ;
+		}
+	}
+
+	EXPECT_EQ(table.size(),ref.size()) ;
+
+	for(uint32_t i=0;i<hashes.size();++i)
+	{
+		DirectoryStorage::EntryIndex indx = 0 ;
+		std::map<RsFileHash,DirectoryStorage::EntryIndex>::const_iterator it = ref.find(hashes[i]) ;
+
+		ASSERT_EQ(table.find(hashes[i],indx),it != ref.end()) ;
+
+		if(it != ref.end())
+			EXPECT_EQ(indx,it->second) ;
+	}
+
+	uint32_t n = 0 ;
+	for(HashIndexTable::const_iterator it(table.begin());it!=table.end();++it,++n)
+		EXPECT_EQ(ref[it->hash],it->index) ;
+
+	EXPECT_EQ(n,ref.size()) ;
+}
+
+TEST(libretroshare_file_sharing, NameTable)
+{
+	NameTable names ;
+
+	EXPECT_EQ(names.intern(""),NameTable::EMPTY_NAME) ;
+
+	uint32_t a = names.intern("cover.jpg") ;
+	uint32_t b = names.intern("track01.mp3") ;
+
+	EXPECT_NE(a,b) ;
+	EXPECT_EQ(names.intern("cover.jpg"),a) ;
+	EXPECT_EQ(names.get(a),"cover.jpg") ;
+	EXPECT_TRUE(names.equals(b,"track01.mp3")) ;
+	EXPECT_EQ(names.nbNames(),3u) ;
+
+	// names go away with their last reference
+
+	names.release(a) ;
+	EXPECT_EQ(names.get(a),"cover.jpg") ;
+	names.release(a) ;
+	EXPECT_EQ(names.nbNames(),2u) ;
+
+	// Release many names, so that the arena gets compacted. Ids of the remaining names do not change.
+
+	std::vector<uint32_t> ids ;
+
+	for(uint32_t i=0;i<20000;++i)
+		ids.push_back(names.intern("some rather long file name, number " + std::to_string(i) + ".avi")) ;
+
+	uint64_t mem = names.memoryUsage() ;
+
+	for(uint32_t i=0;i<ids.size();++i)
+		if(i % 10 != 0)
+			names.release(ids[i]) ;
+
+	EXPECT_LT(names.memoryUsage(),mem) ;
+
+	EXPECT_EQ(names.get(b),"track01.mp3") ;
+
+	for(uint32_t i=0;i<ids.size();i+=10)
+		EXPECT_EQ(names.get(ids[i]),"some rather long file name, number " + std::to_string(i) + ".avi") ;
+}
+
+TEST(libretroshare_file_sharing, DirHierarchyUpdates)
+{
+	InternalFileHierarchyStorage storage ;
+	RsFileHash salt = RsFileHash::random() ;
+
+	storage.updateSubDirectoryList(0,{ "music", "videos" },salt) ;
+
+	InternalFileHierarchyStorage::DirEntry root("") ;
+	ASSERT_TRUE(storage.getDirEntry(0,root)) ;
+	ASSERT_EQ(root.subdirs.size(),2u) ;
+
+	DirectoryStorage::EntryIndex music = root.subdirs[0] ;
+	DirectoryStorage::EntryIndex videos = root.subdirs[1] ;
+
+	std::map<std::string,DirectoryStorage::FileTS> subfiles,new_files ;
+	subfiles["a.mp3"].size = 1000 ;
+	subfiles["b.mp3"].size = 2000 ;
+
+	storage.updateSubFilesList(music,subfiles,new_files) ;
+	storage.updateSubFilesList(videos,subfiles,new_files) ;	// same names in different directories
+
+	InternalFileHierarchyStorage::DirEntry de("") ;
+	ASSERT_TRUE(storage.getDirEntry(music,de)) ;
+	ASSERT_EQ(de.subfiles.size(),2u) ;
+	EXPECT_EQ(de.dir_name,"music") ;
+
+	RsFileHash h = RsFileHash::random() ;
+	EXPECT_TRUE(storage.updateHash(de.subfiles[0],h)) ;
+
+	DirectoryStorage::EntryIndex found ;
+	EXPECT_TRUE(storage.searchHash(h,found)) ;
+	EXPECT_EQ(found,de.subfiles[0]) ;
+
+	InternalFileHierarchyStorage::FileEntry fe ;
+	ASSERT_TRUE(storage.getFileEntry(found,fe)) ;
+	EXPECT_EQ(fe.file_name,"a.mp3") ;
+	EXPECT_EQ(fe.parent_index,music) ;
+
+	// renaming a file through a directory update
+
+	storage.updateDirEntry(music,"music",0,0,{},{ InternalFileHierarchyStorage::FileEntry("c.mp3",3000,0,h) }) ;
+
+	ASSERT_TRUE(storage.getDirEntry(music,de)) ;
+	ASSERT_EQ(de.subfiles.size(),1u) ;
+	ASSERT_TRUE(storage.getFileEntry(de.subfiles[0],fe)) ;
+	EXPECT_EQ(fe.file_name,"c.mp3") ;
+
+	// removing a directory frees its entries, which are used again
+
+	uint32_t nb_entries = storage.nbEntries() ;
+	EXPECT_TRUE(storage.removeDirectory(videos)) ;
+	EXPECT_TRUE(storage.getType(videos) == InternalFileHierarchyStorage::FileStorageNode::TYPE_UNKNOWN) ;
+
+	storage.updateDirEntry(music,"music",0,0,{ RsFileHash::random() },{ InternalFileHierarchyStorage::FileEntry("c.mp3",3000,0,h) }) ;
+	EXPECT_EQ(storage.nbEntries(),nb_entries) ;
+
+	std::string err ;
+	EXPECT_TRUE(storage.check(err)) << err ;
+
+	SharedDirStats stats ;
+	storage.getStatistics(stats) ;
+	EXPECT_EQ(stats.total_number_of_files,1u) ;
+}
+
+// Heap currently in use, or 0 when the C library cannot tell.
+
+static uint64_t heapUsage()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 mi = mallinfo2() ;
+	return mi.uordblks + mi.hblkhd ;	// large vectors are allocated with mmap()
+#else
+	return 0 ;
+#endif
+}
+
+static const char *COMMON_NAMES[] = { "cover.jpg", "folder.jpg", "Thumbs.db", "README.txt", "desktop.ini" } ;
+static const char *WORDS[] = { "holiday", "concert", "mozart", "linux", "debian", "episode", "photo", "album", "remix", "live" } ;
+
+// 5M files: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_file_sharing, DISABLED_DirHierarchy_Bench)
+{
+	const uint32_t NB_DIRS = 50000 ;
+	const uint32_t FILES_PER_DIR = 100 ;	// 5M files
+	const uint32_t NB_LOOKUPS = 1000000 ;
+
+	std::vector<RsFileHash> file_hashes ;
+	std::vector<RsFileHash> dir_hashes ;
+	file_hashes.reserve(NB_DIRS*FILES_PER_DIR) ;
+	dir_hashes.reserve(NB_DIRS) ;
+
+	uint64_t heap_before = heapUsage() ;
+
+	rstime::RsScopeTimer timer("") ;
+	double t0 = timer.duration() ;
+
+	InternalFileHierarchyStorage *storage = new InternalFileHierarchyStorage ;
+	RsFileHash salt = RsFileHash::random() ;
+	std::set<std::string> top_dirs ;
+
+	for(uint32_t i=0;i<NB_DIRS;++i)
+		top_dirs.insert("dir_" + std::to_string(i)) ;
+
+	storage->updateSubDirectoryList(0,top_dirs,salt) ;
+
+	InternalFileHierarchyStorage::DirEntry root("") ;
+	storage->getDirEntry(0,root) ;
+
+	uint32_t n = 0 ;
+
+	for(uint32_t d=0;d<root.subdirs.size();++d)
+	{
+		std::map<std::string,DirectoryStorage::FileTS> subfiles,new_files ;
+
+		for(uint32_t f=0;f<FILES_PER_DIR;++f,++n)
+		{
+			DirectoryStorage::FileTS& ts(subfiles[f < 5 ? std::string(COMMON_NAMES[f]) : std::string(WORDS[n%10]) + " - " + WORDS[(n/10)%10] + " " + std::to_string(n) + ".mp3"]) ;
+			ts.size = 1000 + n ;
+			ts.modtime = 1600000000 + n ;
+		}
+		storage->updateSubFilesList(root.subdirs[d],subfiles,new_files) ;
+
+		InternalFileHierarchyStorage::DirEntry de("") ;
+		storage->getDirEntry(root.subdirs[d],de) ;
+		dir_hashes.push_back(de.dir_hash) ;
+
+		for(uint32_t f=0;f<de.subfiles.size();++f)
+		{
+			file_hashes.push_back(RsFileHash::random()) ;
+			storage->updateHash(de.subfiles[f],file_hashes.back()) ;
+		}
+	}
+	storage->recursUpdateCumulatedSize(0) ;
+
+	double t1 = timer.duration() ;
+	uint64_t heap_after = heapUsage() ;
+
+	// Lookups of random hashes, as done by file transfer and by friends synchronising their file lists.
+	// Hashes are picked before starting the timer.
+
+	std::vector<uint32_t> picks(NB_LOOKUPS) ;
+	for(uint32_t i=0;i<NB_LOOKUPS;++i)
+		picks[i] = RSRandom::random_u32() ;
+
+	double t2 = timer.duration() ;
+	uint32_t nb_found = 0 ;
+	DirectoryStorage::EntryIndex indx ;
+
+	for(uint32_t i=0;i<NB_LOOKUPS;++i)
+		if(storage->searchHash(file_hashes[picks[i] % file_hashes.size()],indx))
+			++nb_found ;
+
+	double t3 = timer.duration() ;
+
+	for(uint32_t i=0;i<NB_LOOKUPS;++i)
+		if(storage->getIndexFromDirHash(dir_hashes[picks[i] % dir_hashes.size()],indx))
+			++nb_found ;
+
+	double t4 = timer.duration() ;
+
+	std::list<DirectoryStorage::EntryIndex> results ;
+	storage->searchTerms({ "Mozart - Debian 4242.mp3" },results) ;
+
+	double t5 = timer.duration() ;
+
+	delete storage ;
+
+	std::cerr << "  " << n << " files in " << NB_DIRS << " directories" << std::endl;
+	std::cerr << "  build          : " << 1000*(t1-t0) << " ms" << std::endl;
+	if(heap_after > 0)
+		std::cerr << "  memory         : " << (heap_after-heap_before)/(1024*1024) << " MB (" << (heap_after-heap_before)/n << " bytes per file)" << std::endl;
+	std::cerr << "  file hash find : " << 1e9*(t3-t2)/NB_LOOKUPS << " ns" << std::endl;
+	std::cerr << "  dir hash find  : " << 1e9*(t4-t3)/NB_LOOKUPS << " ns" << std::endl;
+	std::cerr << "  name search    : " << 1000*(t5-t4) << " ms" << std::endl;
+
+	EXPECT_EQ(nb_found,2*NB_LOOKUPS) ;
+	EXPECT_EQ(results.size(),1u) ;
+}
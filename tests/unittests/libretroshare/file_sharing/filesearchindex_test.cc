@@ -0,0 +1,319 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/filesearchindex_test.cc                *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+// from libretroshare
+
+#include "file_sharing/file_search_index.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+
+using namespace RsRegularExpression ;
+
+// Synthetic file lists of several friends, made of words taken from a small vocabulary, with various separators.
+
+static const char *WORDS[] = { "Holiday", "concert", "live", "2019", "Mozart", "symphony", "Beatles", "linux", "iso", "x86_64",
+                               "debian", "documentary", "episode", "s01e02", "HD", "1080p", "été", "photo", "album", "remix" } ;
+static const char *EXTS[]  = { "mp3", "avi", "mkv", "jpg", "iso", "pdf", "ogg", "tar.gz" } ;
+static const char  SEPS[]  = { ' ', '.', '_', '-', '(', ')' } ;
+
+struct TestFile: public ExpFileEntry
+{
+	std::string name ;
+	RsFileHash hash ;
+	uint64_t size ;
+
+	virtual const std::string& file_name()        const { return name ; }
+	virtual uint64_t           file_size()        const { return size ; }
+	virtual rstime_t           file_modtime()     const { return 0 ; }
+	virtual uint32_t           file_popularity()  const { return 0 ; }
+	virtual std::string        file_parent_path() const { return std::string() ; }
+	virtual const RsFileHash&  file_hash()        const { return hash ; }
+};
+
+static const uint32_t NB_WORDS = sizeof(WORDS)/sizeof(WORDS[0]) ;
+static const uint32_t NB_EXTS  = sizeof(EXTS)/sizeof(EXTS[0]) ;
+static const uint32_t NB_SEPS  = sizeof(SEPS)/sizeof(SEPS[0]) ;
+
+static void makeFiles(uint32_t nb_friends,uint32_t nb_files,std::vector<std::vector<TestFile> >& files)
+{
+	files.clear() ;
+	files.resize(nb_friends) ;
+
+	for(uint32_t f=0;f<nb_friends;++f)
+		for(uint32_t i=0;i<nb_files;++i)
+		{
+			TestFile tf ;
+			uint32_t nb = 1 + RSRandom::random_u32() % 4 ;
+
+			for(uint32_t k=0;k<nb;++k)
+			{
+				if(k > 0)
+					tf.name += SEPS[RSRandom::random_u32() % NB_SEPS] ;
+
+				tf.name += WORDS[RSRandom::random_u32() % NB_WORDS] ;
+			}
+			tf.name += "." ;
+			tf.name += EXTS[RSRandom::random_u32() % NB_EXTS] ;
+			tf.hash = RsFileHash::random() ;
+			tf.size = RSRandom::random_u32() % 1000000 ;
+
+			files[f].push_back(tf) ;
+		}
+}
+
+static void indexFiles(const std::vector<std::vector<TestFile> >& files,FileSearchIndex& index)
+{
+	for(uint32_t f=0;f<files.size();++f)
+		for(uint32_t i=0;i<files[f].size();++i)
+			index.addFile(f+1,i,files[f][i].name,files[f][i].hash) ;
+}
+
+// This is what directory storages do when they search without an index.
+
+static void linearSearch(const std::vector<std::vector<TestFile> >& files,Expression *exp,std::vector<FileSearchIndex::Entry>& results)
+{
+	results.clear() ;
+
+	for(uint32_t f=0;f<files.size();++f)
+		for(uint32_t i=0;i<files[f].size();++i)
+			if(exp->eval(files[f][i]))
+				results.push_back(std::make_pair(f+1,i)) ;
+}
+
+static void checkedSearch(const std::vector<std::vector<TestFile> >& files,const std::vector<FileSearchIndex::Entry>& candidates,Expression *exp,std::vector<FileSearchIndex::Entry>& results)
+{
+	results.clear() ;
+
+	for(uint32_t i=0;i<candidates.size();++i)
+		if(exp->eval(files[candidates[i].first-1][candidates[i].second]))
+			results.push_back(candidates[i]) ;
+}
+
+// Checks that searching through the index gives the same results as going through all files.
+
+static void checkSameResults(const std::vector<std::vector<TestFile> >& files,const FileSearchIndex& index,Expression *exp,bool expect_bounded)
+{
+	std::vector<FileSearchIndex::Entry> candidates, results, ref_results ;
+
+	EXPECT_EQ(expect_bounded, index.searchBoolExp(exp,candidates)) << exp->toStdString() ;
+
+	if(!expect_bounded)
+		return ;
+
+	EXPECT_TRUE(std::is_sorted(candidates.begin(),candidates.end())) ;
+
+	linearSearch(files,exp,ref_results) ;
+	checkedSearch(files,candidates,exp,results) ;
+
+	EXPECT_EQ(ref_results,results) << exp->toStdString() ;
+}
+
+TEST(libretroshare_file_sharing, FileSearchIndex_Tokenize)
+{
+	std::vector<std::string> tokens ;
+
+	FileSearchIndex::tokenize("The_Beatles - Abbey Road (1969).FLAC",tokens) ;
+
+	std::vector<std::string> expected = { "the", "beatles", "abbey", "road", "1969", "flac" } ;
+	EXPECT_EQ(expected,tokens) ;
+
+	// non ASCII characters are part of tokens
+
+	FileSearchIndex::tokenize("Photos d'été",tokens) ;
+
+	expected = { "photos", "d", "été" } ;
+	EXPECT_EQ(expected,tokens) ;
+
+	FileSearchIndex::tokenize("--..__",tokens) ;
+	EXPECT_TRUE(tokens.empty()) ;
+}
+
+TEST(libretroshare_file_sharing, FileSearchIndex_Terms)
+{
+	std::vector<std::vector<TestFile> > files ;
+	makeFiles(5,2000,files) ;
+
+	FileSearchIndex index ;
+	indexFiles(files,index) ;
+
+	EXPECT_EQ(10000u,index.size()) ;
+
+	std::vector<std::list<std::string> > queries = { { "mozart" }, { "SYMPH" }, { "ozar" }, { "mozart", "beatles" },
+	                                                 { "live.iso" }, { "1080" }, { "été" }, { "tar.gz" }, { "unknown" } } ;
+
+	for(uint32_t q=0;q<queries.size();++q)
+	{
+		std::vector<FileSearchIndex::Entry> candidates ;
+		EXPECT_TRUE(index.searchTerms(queries[q],candidates)) ;
+
+		// all files that contain one of the terms, ignoring case, must be candidates
+
+		for(uint32_t f=0;f<files.size();++f)
+			for(uint32_t i=0;i<files[f].size();++i)
+				for(auto& term: queries[q])
+					if(files[f][i].name.end() != std::search(files[f][i].name.begin(),files[f][i].name.end(),term.begin(),term.end(),CompareCharIC()))
+						EXPECT_TRUE(std::binary_search(candidates.begin(),candidates.end(),std::make_pair(f+1,i))) << files[f][i].name ;
+
+		if(queries[q].front() == "unknown")
+			EXPECT_TRUE(candidates.empty()) ;
+	}
+
+	// terms without letters or digits may match anything
+
+	std::vector<FileSearchIndex::Entry> candidates ;
+	EXPECT_FALSE(index.searchTerms({ "." },candidates)) ;
+	EXPECT_FALSE(index.searchTerms({ "mozart", "" },candidates)) ;
+}
+
+TEST(libretroshare_file_sharing, FileSearchIndex_BoolExp)
+{
+	std::vector<std::vector<TestFile> > files ;
+	makeFiles(3,3000,files) ;
+
+	FileSearchIndex index ;
+	indexFiles(files,index) ;
+
+	std::list<std::string> t1 = { "mozart" } ;
+	std::list<std::string> t2 = { "beatles", "remix" } ;
+	std::list<std::string> t3 = { "mp3" } ;
+	std::list<std::string> t4 = { "Holiday.2019" } ;
+
+	{
+		NameExpression exp(ContainsAnyStrings,t2,true) ;
+		checkSameResults(files,index,&exp,true) ;
+	}
+	{
+		NameExpression exp(ContainsAllStrings,t2,true) ;
+		checkSameResults(files,index,&exp,true) ;
+	}
+	{
+		NameExpression exp(ContainsAnyStrings,t4,false) ;
+		checkSameResults(files,index,&exp,true) ;
+	}
+	{
+		ExtExpression exp(EqualsString,t3,true) ;
+		checkSameResults(files,index,&exp,true) ;
+	}
+	{
+		// only one side needs to restrict the search in an AND
+
+		CompoundExpression exp(AndOp,new NameExpression(ContainsAnyStrings,t1,true),new SizeExpression(Greater,500000)) ;
+		checkSameResults(files,index,&exp,true) ;
+	}
+	{
+		CompoundExpression exp(OrOp,new NameExpression(ContainsAnyStrings,t1,true),new ExtExpression(ContainsAnyStrings,t3,true)) ;
+		checkSameResults(files,index,&exp,true) ;
+	}
+	{
+		CompoundExpression exp(OrOp,new NameExpression(ContainsAnyStrings,t1,true),new SizeExpression(Greater,500000)) ;
+		checkSameResults(files,index,&exp,false) ;
+	}
+	{
+		SizeExpression exp(Smaller,1000) ;
+		checkSameResults(files,index,&exp,false) ;
+	}
+	{
+		std::list<std::string> h = { files[1][42].hash.toStdString() } ;
+		HashExpression exp(EqualsString,h) ;
+		checkSameResults(files,index,&exp,true) ;
+
+		std::vector<FileSearchIndex::Entry> candidates ;
+		EXPECT_TRUE(index.searchHash(files[1][42].hash,candidates)) ;
+		ASSERT_EQ(1u,candidates.size()) ;
+		EXPECT_EQ(std::make_pair(2u,42u),candidates[0]) ;
+	}
+}
+
+TEST(libretroshare_file_sharing, FileSearchIndex_Rebuild)
+{
+	std::vector<std::vector<TestFile> > files ;
+	makeFiles(1,3000,files) ;
+
+	FileSearchIndex index ;
+	indexFiles(files,index) ;
+
+	EXPECT_FALSE(index.needsRebuild()) ;
+
+	for(uint32_t i=0;i<2000;++i)
+		index.removeFile() ;
+
+	EXPECT_TRUE(index.needsRebuild()) ;
+
+	index.clear() ;
+	indexFiles(files,index) ;
+	EXPECT_FALSE(index.needsRebuild()) ;
+
+	// an invalid index cannot be used until it is rebuilt
+
+	index.invalidate() ;
+
+	std::vector<FileSearchIndex::Entry> candidates ;
+	EXPECT_TRUE(index.needsRebuild()) ;
+	EXPECT_FALSE(index.searchTerms({ "mozart" },candidates)) ;
+	EXPECT_FALSE(index.searchHash(files[0][0].hash,candidates)) ;
+}
+
+// Compares the time needed to search a large number of files with and without the index.
+// 1M files: run with --gtest_also_run_disabled_tests
+
+TEST(libretroshare_file_sharing, DISABLED_FileSearchIndex_Bench)
+{
+	static const uint32_t NB_FRIENDS = 20 ;
+	static const uint32_t NB_FILES_PER_FRIEND = 50000 ;
+
+	std::vector<std::vector<TestFile> > files ;
+	makeFiles(NB_FRIENDS,NB_FILES_PER_FRIEND,files) ;
+
+	// a few rare names, so that the searches look for something specific
+
+	for(uint32_t f=0;f<NB_FRIENDS;++f)
+		files[f][RSRandom::random_u32() % NB_FILES_PER_FRIEND].name = "The Rare Recording (Bootleg).flac" ;
+
+	FileSearchIndex index ;
+
+	double start = rstime::RsScopeTimer::currentTime() ;
+	indexFiles(files,index) ;
+	double index_time = rstime::RsScopeTimer::currentTime() - start ;
+
+	std::list<std::string> terms = { "bootleg" } ;
+	NameExpression exp(ContainsAnyStrings,terms,true) ;
+
+	std::vector<FileSearchIndex::Entry> candidates, results, ref_results ;
+
+	start = rstime::RsScopeTimer::currentTime() ;
+	linearSearch(files,&exp,ref_results) ;
+	double linear_time = rstime::RsScopeTimer::currentTime() - start ;
+
+	start = rstime::RsScopeTimer::currentTime() ;
+	EXPECT_TRUE(index.searchBoolExp(&exp,candidates)) ;
+	checkedSearch(files,candidates,&exp,results) ;
+	double index_search_time = rstime::RsScopeTimer::currentTime() - start ;
+
+	EXPECT_EQ(ref_results,results) ;
+	EXPECT_EQ(NB_FRIENDS,results.size()) ;
+
+	std::cerr << "  " << NB_FRIENDS*NB_FILES_PER_FRIEND << " files indexed in " << index_time << " s" << std::endl;
+	std::cerr << "  linear search: " << 1000*linear_time << " ms, indexed search: " << 1000*index_search_time << " ms (" << candidates.size() << " candidates)" << std::endl;
+}
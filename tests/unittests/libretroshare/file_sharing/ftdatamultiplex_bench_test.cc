@@ -0,0 +1,172 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/ftdatamultiplex_bench_test.cc          *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// from libretroshare
+
+#include "ft/ftdatamultiplex.h"
+#include "ft/ftsearch.h"
+#include "util/rsdir.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+
+// Serves a local file to several peers through ftDataMultiplex, as a seeding
+// node does. The data is checked against the file content on the "network"
+// side, where items are simply dropped after that.
+
+static const uint32_t BENCH_CHUNK_SIZE = 1024*1024 ;	// size of the requests sent by ftTransferModule
+
+class BenchFileSearch: public ftSearch
+{
+public:
+	BenchFileSearch(const std::string& path, const RsFileHash& hash, uint64_t size) : mPath(path), mHash(hash), mSize(size) {}
+
+	virtual bool search(const RsFileHash& hash, FileSearchFlags /*hintflags*/, FileInfo& info) const
+	{
+		if(hash != mHash)
+			return false ;
+
+		info.path = mPath ;
+		info.size = mSize ;
+		info.hash = mHash ;
+		return true ;
+	}
+
+private:
+	std::string mPath ;
+	RsFileHash mHash ;
+	uint64_t mSize ;
+};
+
+class LoopbackDataSend: public ftDataSend
+{
+public:
+	LoopbackDataSend(const std::vector<uint8_t>& ref) : mRef(ref), mBytes(0), mItems(0), mErrors(0) {}
+
+	virtual bool sendDataRequest(const RsPeerId&, const RsFileHash&, uint64_t, uint64_t, uint32_t) { return true ; }
+
+	virtual bool sendData(const RsPeerId&, const RsFileHash&, uint64_t, uint64_t offset, uint32_t chunksize, void *data)
+	{
+		if(chunksize > FT_MAX_DATA_SLICE_SIZE || memcmp(data, &mRef[offset], chunksize))
+			++mErrors ;
+
+		mBytes += chunksize ;
+		++mItems ;
+		free(data) ;
+		return true ;
+	}
+
+	virtual bool sendChunkMapRequest(const RsPeerId&, const RsFileHash&, bool) { return true ; }
+	virtual bool sendChunkMap(const RsPeerId&, const RsFileHash&, const CompressedChunkMap&, bool) { return true ; }
+	virtual bool sendSingleChunkCRCRequest(const RsPeerId&, const RsFileHash&, uint32_t) { return true ; }
+	virtual bool sendSingleChunkCRC(const RsPeerId&, const RsFileHash&, uint32_t, const Sha1CheckSum&) { return true ; }
+
+	const std::vector<uint8_t>& mRef ;
+	std::atomic<uint64_t> mBytes ;
+	std::atomic<uint32_t> mItems ;
+	std::atomic<uint32_t> mErrors ;
+};
+
+// Each peer downloads the whole file, starting at a different place. The serving time is returned in t.
+
+static void serveFile(uint32_t file_size,uint32_t nb_peers,double& t)
+{
+	t = 0 ;
+
+	char tmpl[] = "/tmp/rs_ftserve_bench_XXXXXX" ;
+	ASSERT_TRUE(mkdtemp(tmpl) != NULL) ;
+
+	std::string fname = std::string(tmpl) + "/served_file" ;
+	std::vector<uint8_t> content(file_size) ;
+	RsRandom::random_bytes(content.data(),content.size()) ;
+
+	FILE *f = fopen(fname.c_str(),"wb") ;
+	ASSERT_TRUE(f != NULL) ;
+	ASSERT_EQ(fwrite(content.data(),1,content.size(),f), content.size()) ;
+	fclose(f) ;
+
+	RsFileHash hash = RsFileHash::random() ;
+	BenchFileSearch search(fname, hash, file_size) ;
+	LoopbackDataSend send(content) ;
+
+	ftDataMultiplex mplex(RsPeerId::random(), &send, &search) ;
+
+	// Sets up the file provider, the same way a local read does.
+	uint8_t first_bytes[16] ;
+	uint32_t first_size = sizeof(first_bytes) ;
+	ASSERT_TRUE(mplex.getFileData(hash, 0, first_size, first_bytes)) ;
+	EXPECT_EQ(0, memcmp(first_bytes, content.data(), first_size)) ;
+
+	std::vector<RsPeerId> peers ;
+	for(uint32_t i=0;i<nb_peers;++i)
+		peers.push_back(RsPeerId::random()) ;
+
+	mplex.start("ft mplex bench") ;
+
+	double start = rstime::RsScopeTimer::currentTime() ;
+
+	for(uint32_t n=0;n<file_size/BENCH_CHUNK_SIZE;++n)
+		for(uint32_t p=0;p<peers.size();++p)
+		{
+			uint64_t offset = (uint64_t)((n + p*7) % (file_size/BENCH_CHUNK_SIZE)) * BENCH_CHUNK_SIZE ;
+			mplex.recvDataRequest(peers[p], hash, file_size, offset, BENCH_CHUNK_SIZE) ;
+		}
+
+	uint64_t total = (uint64_t)file_size * nb_peers ;
+
+	while(send.mBytes < total && rstime::RsScopeTimer::currentTime() < start + 120)
+		rstime::rs_usleep(1000) ;
+
+	t = rstime::RsScopeTimer::currentTime() - start ;
+
+	mplex.fullstop() ;
+
+	EXPECT_EQ(send.mBytes.load(), total) ;
+	EXPECT_EQ(send.mErrors.load(), 0u) ;
+
+	remove(fname.c_str()) ;
+	rmdir(tmpl) ;
+}
+
+TEST(libretroshare_file_sharing, FtDataMultiplexServing)
+{
+	double t ;
+	serveFile(4*1024*1024,4,t) ;
+}
+
+// 64 MB file served to 8 peers: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_file_sharing, DISABLED_FtDataMultiplexServingThroughput)
+{
+	const uint32_t FILE_SIZE = 64*1024*1024 ;
+	const uint32_t NB_PEERS  = 8 ;
+
+	double t ;
+	serveFile(FILE_SIZE,NB_PEERS,t) ;
+
+	std::cerr << "  served " << FILE_SIZE/(1024*1024) << " MB to " << NB_PEERS << " peers: " << FILE_SIZE/(1024.0*1024.0)*NB_PEERS/t << " MB/s" << std::endl;
+}
@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/ftratecontrol_test.cc                  *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+// from libretroshare
+
+#include "ft/ftratecontrol.h"
+
+// Simulates a source behind a bottleneck link, with an unbounded FIFO queue
+// in front of it (the outgoing queues of the source), and a transfer module
+// ticking every second.
+
+static const double SIM_LINK_RATE     = 1024*1024 ;	// bytes/s
+static const double SIM_ONE_WAY_DELAY = 0.1 ;
+static const double SIM_MAX_RATE      = 10*SIM_LINK_RATE ;
+static const uint32_t SIM_CHUNK_SIZE  = 256*1024 ;	// largest request sent at once
+static const uint32_t SIM_SLICE_SIZE  = 16*1024 ;	// size of the data items sent by the source
+static const uint32_t SIM_DURATION    = 300 ;		// in seconds (ie. ticks)
+static const uint32_t SIM_WARMUP      = 120 ;
+
+struct SimResult
+{
+	double rate ;			// average receiving rate after warm up
+	double maxQueueDelay ;	// longest time spent by the first request of a tick in the queue of the source, after warm up
+	double rtt ;
+};
+
+static SimResult simulate(FileTransferRateControl type)
+{
+	std::unique_ptr<ftRateController> ctrl(ftRateController::create(type)) ;
+
+	std::multimap<double,std::pair<uint64_t,uint32_t> > deliveries ;	// reception time -> slice
+	double link_free = 0 ;
+	double rate = 20*1024 ;	// initial rate of ftTransferModule
+	uint64_t offset = 0 ;
+	uint64_t received_after_warmup = 0 ;
+
+	SimResult res ;
+	res.maxQueueDelay = 0 ;
+
+	for(uint32_t tick=0;tick<SIM_DURATION;++tick)
+	{
+		double now = tick ;
+		uint64_t received = 0 ;
+
+		// receive everything that arrived during the last second
+
+		while(!deliveries.empty() && deliveries.begin()->first <= now)
+		{
+			ctrl->dataReceived(deliveries.begin()->first, deliveries.begin()->second.first, deliveries.begin()->second.second) ;
+			received += deliveries.begin()->second.second ;
+			deliveries.erase(deliveries.begin()) ;
+		}
+		rate = 0.75*rate + 0.25*received ;
+
+		if(tick > SIM_WARMUP)
+			received_after_warmup += received ;
+
+		// send requests, which the source answers in order
+
+		uint32_t next_req = ctrl->nextRequestSize(now, rate, SIM_MAX_RATE, SPEED_NORMAL) ;
+
+		// Requests are sent in bursts, so that the last ones of a burst always wait for about one second. What
+		// matters is the queue left when the next burst arrives.
+
+		if(tick > SIM_WARMUP)
+			res.maxQueueDelay = std::max(res.maxQueueDelay, link_free - (now + SIM_ONE_WAY_DELAY)) ;
+
+		while(next_req > 0)
+		{
+			uint32_t size = std::min(next_req, SIM_CHUNK_SIZE) ;
+			ctrl->requestSent(now, offset, size) ;
+
+			double arrival = now + SIM_ONE_WAY_DELAY ;
+
+			link_free = std::max(link_free, arrival) ;
+
+			for(uint32_t done=0;done<size;done+=SIM_SLICE_SIZE)
+			{
+				uint32_t slice = std::min(SIM_SLICE_SIZE, size - done) ;
+				link_free += slice / SIM_LINK_RATE ;
+				deliveries.insert(std::make_pair(link_free + SIM_ONE_WAY_DELAY, std::make_pair(offset + done, slice))) ;
+			}
+			offset += size ;
+			next_req -= size ;
+		}
+	}
+
+	res.rate = received_after_warmup / (double)(SIM_DURATION - SIM_WARMUP - 1) ;
+	res.rtt = ctrl->rtt() ;
+
+	std::cerr << "  " << (type == FileTransferRateControl::LEGACY ? "legacy     " : "delay based") << ": rate = " << res.rate / SIM_LINK_RATE * 100 << "% of link, max queue delay = " << res.maxQueueDelay << " s, rtt = " << res.rtt << " s, in flight = " << ctrl->inflight() << std::endl;
+
+	return res ;
+}
+
+TEST(libretroshare_file_sharing, RateControlBottleneck)
+{
+	SimResult legacy = simulate(FileTransferRateControl::LEGACY) ;
+	SimResult delay  = simulate(FileTransferRateControl::DELAY_BASED) ;
+
+	// both use the link
+
+	EXPECT_GT(legacy.rate, 0.8 * SIM_LINK_RATE) ;
+	EXPECT_GT(delay.rate, 0.8 * SIM_LINK_RATE) ;
+
+	// but only the delay based controller keeps the queue of the source short
+
+	EXPECT_LT(delay.maxQueueDelay, 0.5) ;
+	EXPECT_LT(delay.maxQueueDelay, legacy.maxQueueDelay) ;
+	EXPECT_LT(delay.rtt, 1.0 + 2*SIM_ONE_WAY_DELAY) ;
+}
+
+TEST(libretroshare_file_sharing, RateControlLostRequests)
+{
+	ftDelayRateController ctrl ;
+
+	ctrl.requestSent(0, 0, 10000) ;
+	ctrl.requestSent(0, 10000, 10000) ;
+	EXPECT_EQ(ctrl.inflight(), 20000u) ;
+
+	ctrl.dataReceived(0.5, 0, 5000) ;
+	ctrl.dataReceived(0.6, 5000, 5000) ;
+	EXPECT_EQ(ctrl.inflight(), 10000u) ;
+	EXPECT_DOUBLE_EQ(ctrl.rtt(), 0.5) ;
+
+	// the second request is never answered
+
+	double window = ctrl.window() ;
+	ctrl.nextRequestSize(100, 10000, SIM_MAX_RATE, SPEED_NORMAL) ;
+
+	EXPECT_EQ(ctrl.inflight(), 0u) ;
+	EXPECT_LT(ctrl.window(), window) ;
+}
+
+TEST(libretroshare_file_sharing, RateControlSwitchKeepsRequests)
+{
+	ftDelayRateController delay ;
+
+	delay.requestSent(0, 0, 10000) ;
+	delay.requestSent(0, 10000, 10000) ;
+	delay.dataReceived(0.5, 0, 10000) ;
+
+	// the requests still in flight are answered after switching to another algorithm
+
+	std::unique_ptr<ftRateController> legacy(ftRateController::create(FileTransferRateControl::LEGACY)) ;
+	legacy->takeStateFrom(delay) ;
+
+	EXPECT_EQ(legacy->inflight(), 10000u) ;
+	EXPECT_DOUBLE_EQ(legacy->rtt(), 0.5) ;
+
+	legacy->dataReceived(0.7, 10000, 10000) ;
+	EXPECT_EQ(legacy->inflight(), 0u) ;
+}
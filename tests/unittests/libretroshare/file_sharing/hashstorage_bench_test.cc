@@ -0,0 +1,342 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/hashstorage_bench_test.cc              *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <openssl/sha.h>
+
+// from libretroshare
+
+#include "file_sharing/hash_cache.h"
+#include "util/rsdir.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+#include "util/rsthreadpool.h"
+
+static const uint32_t BENCH_NB_FILES  = 16 ;
+static const uint32_t BENCH_FILE_SIZE = 16*1024*1024 ;
+
+static void createRandomFiles(const std::string& dir, uint32_t nb_files, uint32_t file_size, std::vector<std::string>& files)
+{
+	std::vector<unsigned char> buf(file_size) ;
+
+	for(uint32_t i=0;i<nb_files;++i)
+	{
+		RsRandom::random_bytes(buf.data(),buf.size()) ;
+
+		std::string fname = dir + "/file_" + std::to_string(i) ;
+		FILE *f = fopen(fname.c_str(),"wb") ;
+		ASSERT_TRUE(f != NULL) ;
+		ASSERT_EQ(fwrite(buf.data(),1,buf.size(),f), buf.size()) ;
+		fclose(f) ;
+
+		files.push_back(fname) ;
+	}
+}
+
+static void removeFiles(const std::string& dir, const std::vector<std::string>& files)
+{
+	for(uint32_t i=0;i<files.size();++i)
+		remove(files[i].c_str()) ;
+
+	rmdir(dir.c_str()) ;
+}
+
+// Collects the hashes sent by HashStorage. The callback is called by all hashing threads.
+
+class TestHashStorageClient: public HashStorageClient
+{
+public:
+	TestHashStorageClient() : mMtx("TestHashStorageClient") {}
+
+	virtual void hash_callback(uint32_t client_param, const std::string& name, const RsFileHash& hash, uint64_t size) override
+	{
+		RS_STACK_MUTEX(mMtx) ;
+
+		++mNbCallbacks[client_param] ;
+		mHashes[client_param] = hash ;
+		mNames[client_param] = name ;
+		mSizes[client_param] = size ;
+	}
+	virtual bool hash_confirm(uint32_t) override { return true ; }
+
+	uint32_t nbHashedFiles()
+	{
+		RS_STACK_MUTEX(mMtx) ;
+		return mNbCallbacks.size() ;
+	}
+
+	RsMutex mMtx ;
+	std::map<uint32_t,uint32_t> mNbCallbacks ;
+	std::map<uint32_t,RsFileHash> mHashes ;
+	std::map<uint32_t,std::string> mNames ;
+	std::map<uint32_t,uint64_t> mSizes ;
+};
+
+// Files are hashed by HashStorage on several threads. Each file must be sent to the client once, with its own hash.
+
+TEST(libretroshare_file_sharing, HashStorageWorkers)
+{
+	static const uint32_t NB_FILES = 12 ;
+	static const uint32_t NB_THREADS = 4 ;
+
+	char tmpl[] = "/tmp/rs_hash_storage_XXXXXX" ;
+	ASSERT_TRUE(mkdtemp(tmpl) != NULL) ;
+
+	std::string dir(tmpl) ;
+	std::vector<std::string> files ;
+	createRandomFiles(dir,NB_FILES,256*1024 + 333,files) ;
+
+	TestHashStorageClient client ;
+	HashStorage storage("") ;	// hash cache kept in memory only
+	storage.setHashingThreadsCount(NB_THREADS) ;
+
+	EXPECT_EQ(NB_THREADS, storage.hashingThreadsCount()) ;
+
+	for(uint32_t i=0;i<files.size();++i)
+	{
+		RsFileHash known_hash ;
+		EXPECT_FALSE(storage.requestHash(files[i],256*1024 + 333,RsDirUtil::lastWriteTime(files[i]),known_hash,&client,i)) ;
+	}
+
+	for(uint32_t n=0;n<300 && client.nbHashedFiles() < NB_FILES;++n)
+		rstime::rs_usleep(100*1000) ;
+
+	ASSERT_EQ(NB_FILES, client.nbHashedFiles()) ;
+
+	for(uint32_t i=0;i<files.size();++i)
+	{
+		RsFileHash hash ;
+		uint64_t size = 0 ;
+		ASSERT_TRUE(RsDirUtil::getFileHash(files[i],hash,size)) ;
+
+		RsStackMutex stack(client.mMtx) ;
+
+		EXPECT_EQ(1u, client.mNbCallbacks[i]) ;
+		EXPECT_EQ(hash, client.mHashes[i]) ;
+		EXPECT_EQ(files[i], client.mNames[i]) ;
+		EXPECT_EQ(size, client.mSizes[i]) ;
+	}
+
+	// Hashed files are now known to the cache, so that they are not hashed again.
+
+	for(uint32_t i=0;i<files.size();++i)
+	{
+		RsFileHash known_hash ;
+		EXPECT_TRUE(storage.requestHash(files[i],256*1024 + 333,RsDirUtil::lastWriteTime(files[i]),known_hash,&client,i)) ;
+		EXPECT_EQ(client.mHashes[i], known_hash) ;
+	}
+
+	storage.fullstop() ;
+	removeFiles(dir,files) ;
+}
+
+// Measures the hashing throughput when each hashing thread works on a
+// different file, which is what HashStorage does when configured with
+// several hashing threads. Note that after the first pass the files are in
+// the page cache, so that the numbers reflect CPU bound hashing.
+
+static double hashFiles(const std::vector<std::string>& files, uint32_t nb_threads, std::vector<RsFileHash>& hashes)
+{
+	RsThreadPool pool(nb_threads - 1) ;	// the calling thread hashes too
+
+	hashes.clear() ;
+	hashes.resize(files.size()) ;
+
+	double start = rstime::RsScopeTimer::currentTime() ;
+
+	pool.parallelFor(files.size(),[&](uint32_t i)
+	{
+		uint64_t size = 0 ;
+		RsDirUtil::getFileHash(files[i],hashes[i],size) ;
+	});
+
+	return rstime::RsScopeTimer::currentTime() - start ;
+}
+
+TEST(libretroshare_file_sharing, DISABLED_HashingThroughputPerWorkerCount)
+{
+	char tmpl[] = "/tmp/rs_hash_bench_XXXXXX" ;
+	ASSERT_TRUE(mkdtemp(tmpl) != NULL) ;
+
+	std::string dir(tmpl) ;
+	std::vector<std::string> files ;
+	createRandomFiles(dir,BENCH_NB_FILES,BENCH_FILE_SIZE,files) ;
+
+	std::vector<RsFileHash> reference ;
+	hashFiles(files,1,reference) ;	// also warms up the page cache
+
+	uint32_t nb_cores = std::max(1u,std::thread::hardware_concurrency()) ;
+
+	for(uint32_t n=1;n<=std::min(8u,nb_cores);n*=2)
+	{
+		std::vector<RsFileHash> hashes ;
+		double t = hashFiles(files,n,hashes) ;
+
+		std::cerr << "  " << n << " hashing thread(s): " << (BENCH_NB_FILES*(double)BENCH_FILE_SIZE/(1024*1024))/t << " MB/s" << std::endl;
+
+		EXPECT_TRUE(hashes == reference) ;
+	}
+
+	removeFiles(dir,files) ;
+}
+
+// Chunk hashes are computed in the same pass as the file hash. They must be the same as
+// hashing each chunk separately, which is what is done when a friend asks for chunk hashes.
+
+TEST(libretroshare_file_sharing, ChunkHashesComputedWhileHashing)
+{
+	static const uint32_t CHUNK_SIZE = 1024*1024 ;
+	static const uint32_t FILE_SIZE = 9*CHUNK_SIZE + 12345 ;	// larger than the hashing buffers, and not a multiple of the chunk size
+
+	std::vector<unsigned char> buf(FILE_SIZE) ;
+	RsRandom::random_bytes(buf.data(),buf.size()) ;
+
+	char fname[] = "/tmp/rs_chunk_hash_XXXXXX" ;
+	int fd = mkstemp(fname) ;
+	ASSERT_TRUE(fd >= 0) ;
+	ASSERT_EQ(write(fd,buf.data(),buf.size()), (ssize_t)buf.size()) ;
+	close(fd) ;
+
+	RsFileHash hash, ref_hash ;
+	uint64_t size = 0 ;
+	std::vector<Sha1CheckSum> chunk_hashes ;
+
+	ASSERT_TRUE(RsDirUtil::getFileHash(fname,hash,size,chunk_hashes,CHUNK_SIZE)) ;
+
+	ASSERT_TRUE(RsDirUtil::getFileHash(fname,ref_hash,size)) ;
+
+	EXPECT_EQ(ref_hash, hash) ;
+	EXPECT_EQ(ref_hash, RsDirUtil::sha1sum(buf.data(),buf.size())) ;
+	ASSERT_EQ(10u, chunk_hashes.size()) ;
+
+	for(uint32_t i=0;i<chunk_hashes.size();++i)
+		EXPECT_EQ(RsDirUtil::sha1sum(buf.data() + i*CHUNK_SIZE,std::min(CHUNK_SIZE,FILE_SIZE - i*CHUNK_SIZE)), chunk_hashes[i]) ;
+
+	remove(fname) ;
+}
+
+// Reads the file and hashes it in turn, in a single thread, the way getFileHash() used to. Used as a reference
+// for the throughput of overlapped reading and hashing.
+
+static bool serialFileHash(const std::string& fname,RsFileHash& hash)
+{
+	FILE *f = fopen(fname.c_str(),"rb") ;
+
+	if(!f)
+		return false ;
+
+	std::vector<unsigned char> buf(10*1024*1024) ;
+	SHA_CTX ctx ;
+	SHA1_Init(&ctx) ;
+
+	for(size_t len;(len = fread(buf.data(),1,buf.size(),f)) > 0;)
+		SHA1_Update(&ctx,buf.data(),len) ;
+
+	unsigned char sha_buf[SHA_DIGEST_LENGTH] ;
+	SHA1_Final(sha_buf,&ctx) ;
+	hash = Sha1CheckSum(sha_buf) ;
+
+	fclose(f) ;
+	return true ;
+}
+
+// Asks the kernel to drop the file from the page cache, so that it is read from the disk again. This has
+// no effect on tmpfs, where both methods below are CPU bound and give the same throughput.
+
+static void dropFromPageCache(const std::string& fname)
+{
+	int fd = open(fname.c_str(),O_RDONLY) ;
+
+	if(fd < 0)
+		return ;
+
+	fdatasync(fd) ;
+#ifdef __linux__
+	posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED) ;
+#endif
+	close(fd) ;
+}
+
+// Hashes a random file of the given size both ways. The hashing times are returned in t_serial and t_overlapped.
+
+static void hashBothWays(uint32_t file_size,double& t_serial,double& t_overlapped)
+{
+	t_serial = t_overlapped = 0 ;
+
+	std::vector<unsigned char> buf(file_size) ;
+	RsRandom::random_bytes(buf.data(),buf.size()) ;
+
+	char fname[] = "/tmp/rs_overlapped_hash_XXXXXX" ;
+	int fd = mkstemp(fname) ;
+	ASSERT_TRUE(fd >= 0) ;
+	ASSERT_EQ(write(fd,buf.data(),buf.size()), (ssize_t)buf.size()) ;
+	close(fd) ;
+
+	RsFileHash hash, serial_hash ;
+	uint64_t size = 0 ;
+	uint64_t progress = 0 ;
+	uint32_t nb_progress_calls = 0 ;
+	std::vector<Sha1CheckSum> chunk_hashes ;
+
+	dropFromPageCache(fname) ;
+	double start = rstime::RsScopeTimer::currentTime() ;
+	ASSERT_TRUE(serialFileHash(fname,serial_hash)) ;
+	t_serial = rstime::RsScopeTimer::currentTime() - start ;
+
+	dropFromPageCache(fname) ;
+	start = rstime::RsScopeTimer::currentTime() ;
+	ASSERT_TRUE(RsDirUtil::getFileHash(fname,hash,size,chunk_hashes,0,NULL,[&](uint64_t bytes) { progress += bytes ; ++nb_progress_calls ; })) ;
+	t_overlapped = rstime::RsScopeTimer::currentTime() - start ;
+
+	EXPECT_EQ(RsDirUtil::sha1sum(buf.data(),buf.size()), hash) ;
+	EXPECT_EQ(serial_hash, hash) ;
+	EXPECT_EQ(uint64_t(file_size), size) ;
+	EXPECT_EQ(uint64_t(file_size), progress) ;	// all bytes are reported, in several steps
+	EXPECT_LT(1u, nb_progress_calls) ;
+
+	remove(fname) ;
+}
+
+TEST(libretroshare_file_sharing, OverlappedReadAndHash)
+{
+	double t_serial, t_overlapped ;
+	hashBothWays(13*1024*1024 + 777,t_serial,t_overlapped) ;	// more than the hashing buffers, so that they are reused
+}
+
+// 96 MB file: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_file_sharing, DISABLED_OverlappedReadAndHashThroughput)
+{
+	static const uint32_t FILE_SIZE = 96*1024*1024 + 777 ;
+
+	double t_serial, t_overlapped ;
+	hashBothWays(FILE_SIZE,t_serial,t_overlapped) ;
+
+	std::cerr << "  read then hash      : " << (FILE_SIZE/(1024.0*1024))/t_serial << " MB/s" << std::endl;
+	std::cerr << "  overlapped read/hash: " << (FILE_SIZE/(1024.0*1024))/t_overlapped << " MB/s" << std::endl;
+}
@@ -0,0 +1,197 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/data_service/rsthreadindex_test.cc              *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include "libretroshare/gxs/common/data_support.h"
+
+// from libretroshare
+
+#include "gxs/rsdataservice.h"
+
+#define THREAD_INDEX_DB_NAME "thread_index_store"
+
+static RsGxsGroupId grpId = RsGxsGroupId::random() ;
+static RsGxsId author = RsGxsId::random() ;
+
+static void storeMsg(RsGeneralDataService& store,const RsGxsMessageId& msgId,const RsGxsMessageId& parentId,const RsGxsMessageId& origMsgId,rstime_t ts,const RsGxsId& authorId = author)
+{
+	RsNxsMsg *msg = new RsNxsMsg(RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM) ;
+	RsGxsMsgMetaData *meta = new RsGxsMsgMetaData ;
+
+	msg->grpId = grpId ;
+	msg->msgId = msgId ;
+
+	meta->mGroupId = grpId ;
+	meta->mMsgId = msgId ;
+	meta->mParentId = parentId ;
+	meta->mOrigMsgId = origMsgId.isNull() ? msgId : origMsgId ;
+	meta->mAuthorId = authorId ;
+	meta->mPublishTs = ts ;
+	msg->metaData = meta ;
+
+	store.storeMessage(std::list<RsNxsMsg*>(1,msg)) ;
+}
+
+static std::vector<RsGxsThreadInfo> threads(RsGeneralDataService& store,uint32_t offset = 0,uint32_t limit = 100)
+{
+	std::vector<RsGxsThreadInfo> t ;
+	EXPECT_EQ(store.retrieveThreads(grpId,offset,limit,t),1) ;
+	return t ;
+}
+
+static std::vector<RsGxsMessageId> children(RsGeneralDataService& store,const std::set<RsGxsMessageId>& parents,uint32_t offset = 0,uint32_t limit = 100)
+{
+	std::vector<std::shared_ptr<RsGxsMsgMetaData> > metas ;
+	EXPECT_EQ(store.retrieveChildMsgMetaData(grpId,parents,offset,limit,metas),1) ;
+
+	std::vector<RsGxsMessageId> ids ;
+	for(auto& m:metas)
+		ids.push_back(m->mMsgId) ;
+
+	return ids ;
+}
+
+static void test_threadIndex() ;
+
+TEST(libretroshare_gxs, RsDataService_ThreadIndex)
+{
+	remove(THREAD_INDEX_DB_NAME) ;
+	test_threadIndex() ;
+	remove(THREAD_INDEX_DB_NAME) ;
+}
+
+static void test_threadIndex()
+{
+	RsDataService store(".",THREAD_INDEX_DB_NAME,RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM) ;
+
+	const RsGxsMessageId none ;
+	RsGxsMessageId r(RsGxsMessageId::random()), c1(RsGxsMessageId::random()), c2(RsGxsMessageId::random()) ;
+	RsGxsMessageId s(RsGxsMessageId::random()) ;
+	RsGxsMessageId d(RsGxsMessageId::random()), d1(RsGxsMessageId::random()), d2(RsGxsMessageId::random()) ;
+
+	// A thread r <- c1 <- c2, and a thread with a single message
+
+	storeMsg(store,r,none,none,10) ;
+	storeMsg(store,c1,r,none,20) ;
+	storeMsg(store,c2,c1,none,30) ;
+	storeMsg(store,s,none,none,15) ;
+
+	// A thread d <- d1 <- d2 received in reverse order. Until d is received, the messages are in a thread rooted at the missing one.
+
+	storeMsg(store,d2,d1,none,50) ;
+
+	std::vector<RsGxsThreadInfo> t = threads(store) ;
+	ASSERT_EQ(t.size(),3u) ;
+	EXPECT_TRUE(t[0].mThreadId == d1) ;
+	EXPECT_TRUE(t[0].mTopMsgs.empty()) ;
+
+	storeMsg(store,d1,d,none,40) ;
+	storeMsg(store,d,none,none,5) ;
+
+	t = threads(store) ;
+	ASSERT_EQ(t.size(),3u) ;
+
+	EXPECT_TRUE(t[0].mThreadId == d) ;
+	EXPECT_EQ(t[0].mLastActivity,50) ;
+	EXPECT_EQ(t[0].mMsgCount,3u) ;
+	ASSERT_EQ(t[0].mTopMsgs.size(),1u) ;
+	EXPECT_TRUE(t[0].mTopMsgs[0]->mMsgId == d) ;
+
+	EXPECT_TRUE(t[1].mThreadId == r) ;
+	EXPECT_EQ(t[1].mLastActivity,30) ;
+	EXPECT_EQ(t[1].mMsgCount,3u) ;
+
+	EXPECT_TRUE(t[2].mThreadId == s) ;
+	EXPECT_EQ(t[2].mMsgCount,1u) ;
+
+	// Pagination
+
+	t = threads(store,1,1) ;
+	ASSERT_EQ(t.size(),1u) ;
+	EXPECT_TRUE(t[0].mThreadId == r) ;
+	EXPECT_TRUE(threads(store,3,10).empty()) ;
+
+	// A new version of the first message stays in the same thread, and so do the replies to it.
+
+	RsGxsMessageId r2(RsGxsMessageId::random()), c1b(RsGxsMessageId::random()), e(RsGxsMessageId::random()) ;
+
+	storeMsg(store,r2,none,r,60) ;
+	storeMsg(store,c1b,r,c1,70) ;
+	storeMsg(store,e,r2,none,80) ;
+
+	t = threads(store) ;
+	ASSERT_EQ(t.size(),3u) ;
+	EXPECT_TRUE(t[0].mThreadId == r) ;
+	EXPECT_EQ(t[0].mLastActivity,80) ;
+	EXPECT_EQ(t[0].mMsgCount,6u) ;
+	EXPECT_EQ(t[0].mTopMsgs.size(),2u) ;
+
+	std::vector<std::shared_ptr<RsGxsMsgMetaData> > versions ;
+	EXPECT_EQ(store.retrieveMsgVersions(grpId,r2,versions),1) ;
+	EXPECT_EQ(versions.size(),2u) ;
+
+	// Children of all versions of r, without the replaced version of c1, oldest first.
+
+	std::set<RsGxsMessageId> parents ;
+	parents.insert(r) ;
+	parents.insert(r2) ;
+
+	std::vector<RsGxsMessageId> ids = children(store,parents) ;
+	ASSERT_EQ(ids.size(),2u) ;
+	EXPECT_TRUE(ids[0] == c1b) ;
+	EXPECT_TRUE(ids[1] == e) ;
+
+	ids = children(store,parents,1,1) ;
+	ASSERT_EQ(ids.size(),1u) ;
+	EXPECT_TRUE(ids[0] == e) ;
+
+	// A new version from another author does not replace the message.
+
+	storeMsg(store,RsGxsMessageId::random(),r,c1b,90,RsGxsId::random()) ;
+	EXPECT_EQ(children(store,parents).size(),3u) ;
+
+	// Removing a reply moves its own replies to a thread rooted at it. Removing the last message of a thread removes the thread.
+
+	GxsMsgReq req ;
+	req[grpId].insert(c1) ;
+	req[grpId].insert(s) ;
+	store.removeMsgs(req) ;
+
+	t = threads(store) ;
+	ASSERT_EQ(t.size(),3u) ;
+
+	EXPECT_TRUE(t[0].mThreadId == r) ;
+	EXPECT_EQ(t[0].mMsgCount,5u) ;
+	EXPECT_TRUE(t[1].mThreadId == d) ;
+	EXPECT_TRUE(t[2].mThreadId == c1) ;
+	EXPECT_EQ(t[2].mMsgCount,1u) ;
+	EXPECT_EQ(t[2].mLastActivity,30) ;
+
+	// When it comes back, it goes back to its thread.
+
+	storeMsg(store,c1,r,none,20) ;
+
+	t = threads(store) ;
+	ASSERT_EQ(t.size(),2u) ;
+	EXPECT_EQ(t[0].mMsgCount,7u) ;
+}
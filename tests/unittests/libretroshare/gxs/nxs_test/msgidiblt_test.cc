@@ -0,0 +1,158 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/nxs_test/msgidiblt_test.cc                      *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <vector>
+
+// from libretroshare
+
+#include "gxs/rsgxsiblt.h"
+
+static RsGxsMessageId randomId()
+{
+	return RsGxsMessageId::random();
+}
+
+TEST(libretroshare_gxs, MsgIdIbltSymmetricDifference)
+{
+	// Two peers sharing 5000 messages, each having a few the other one lacks.
+
+	std::vector<RsGxsMessageId> common, mine, theirs;
+
+	for(uint32_t i=0;i<5000;++i) common.push_back(randomId());
+	for(uint32_t i=0;i<30;++i) mine.push_back(randomId());
+	for(uint32_t i=0;i<10;++i) theirs.push_back(randomId());
+
+	uint32_t cells = RsGxsMsgIdIblt::cellsForDifference(mine.size() + theirs.size());
+
+	RsGxsMsgIdIblt a(cells, 1234), b(cells, 1234);
+
+	for(auto& id: common) { a.insert(id); b.insert(id); }
+	for(auto& id: mine) a.insert(id);
+	for(auto& id: theirs) b.insert(id);
+
+	// The table goes through the network.
+
+	RsTlvBinaryData data;
+	RsGxsMsgIdIblt received(1, 0);
+
+	EXPECT_TRUE(b.serialise(data));
+	EXPECT_EQ(data.bin_len, b.nbCells() * RsGxsMsgIdIblt::CELL_SIZE);
+	EXPECT_TRUE(RsGxsMsgIdIblt::deserialise(data, b.salt(), received));
+
+	EXPECT_TRUE(a.subtract(received));
+
+	std::set<RsGxsMessageId> only_here, only_there;
+
+	EXPECT_TRUE(a.decode(only_here, only_there));
+	EXPECT_EQ(only_here, std::set<RsGxsMessageId>(mine.begin(), mine.end()));
+	EXPECT_EQ(only_there, std::set<RsGxsMessageId>(theirs.begin(), theirs.end()));
+
+	// tables of different salts cannot be compared
+
+	RsGxsMsgIdIblt c(cells, 4321);
+	EXPECT_FALSE(a.subtract(c));
+}
+
+TEST(libretroshare_gxs, MsgIdIbltDecodingFailure)
+{
+	RsGxsMsgIdIblt a(RsGxsMsgIdIblt::cellsForDifference(10), 1);
+
+	for(uint32_t i=0;i<1000;++i)
+		a.insert(randomId());
+
+	std::set<RsGxsMessageId> only_here, only_there;
+
+	EXPECT_FALSE(a.decode(only_here, only_there));
+}
+
+TEST(libretroshare_gxs, MsgIdIbltDecodingRate)
+{
+	// The size given by cellsForDifference() must be enough almost every time.
+
+	for(uint32_t d : { 1, 5, 10, 20, 30, 50, 100, 500 })
+	{
+		uint32_t failures = 0;
+
+		for(uint32_t n=0;n<100;++n)
+		{
+			RsGxsMsgIdIblt a(RsGxsMsgIdIblt::cellsForDifference(d), n);
+
+			for(uint32_t i=0;i<d;++i)
+				if(i & 1)
+					a.insert(randomId());
+				else
+					a.remove(randomId());
+
+			std::set<RsGxsMessageId> only_here, only_there;
+
+			if(!a.decode(only_here, only_there) || only_here.size() + only_there.size() != d)
+				++failures;
+		}
+		std::cerr << "  " << d << " differences: " << failures << "% decoding failures with " << RsGxsMsgIdIblt::cellsForDifference(d) << " cells" << std::endl;
+
+		EXPECT_LE(failures, 3u);
+	}
+}
+
+// Tables come from remote peers. Crafted tables must not make decoding loop forever.
+
+TEST(libretroshare_gxs, MsgIdIbltCraftedTable)
+{
+	RsGxsMsgIdIblt a(RsGxsMsgIdIblt::cellsForDifference(10), 1);
+	a.insert(randomId());
+
+	RsTlvBinaryData data;
+	EXPECT_TRUE(a.serialise(data));
+
+	// Keep a single one of the cells of the id, which is pure. Peeling it makes the other cells of the
+	// id pure with the opposite sign, and peeling one of them makes the first cell pure again.
+
+	uint8_t *mem = static_cast<uint8_t*>(data.bin_data);
+	uint32_t cell = 0;
+
+	while(mem[cell*RsGxsMsgIdIblt::CELL_SIZE + 3] == 0)
+		++cell;
+
+	std::vector<uint8_t> pure_cell(mem + cell*RsGxsMsgIdIblt::CELL_SIZE, mem + (cell+1)*RsGxsMsgIdIblt::CELL_SIZE);
+	memset(mem, 0, data.bin_len);
+	memcpy(mem + cell*RsGxsMsgIdIblt::CELL_SIZE, pure_cell.data(), RsGxsMsgIdIblt::CELL_SIZE);
+
+	RsGxsMsgIdIblt received(1, 0);
+	EXPECT_TRUE(RsGxsMsgIdIblt::deserialise(data, a.salt(), received));
+
+	std::set<RsGxsMessageId> only_here, only_there;
+	EXPECT_FALSE(received.decode(only_here, only_there));
+
+	// Same cell, moved to a place the id does not use.
+
+	uint32_t other_cell = (cell + received.nbCells()/RsGxsMsgIdIblt::NB_HASHES/2) % received.nbCells();
+
+	memset(mem, 0, data.bin_len);
+	memcpy(mem + other_cell*RsGxsMsgIdIblt::CELL_SIZE, pure_cell.data(), RsGxsMsgIdIblt::CELL_SIZE);
+	EXPECT_TRUE(RsGxsMsgIdIblt::deserialise(data, a.salt(), received));
+
+	only_here.clear();
+	only_there.clear();
+	EXPECT_FALSE(received.decode(only_here, only_there));
+	EXPECT_TRUE(only_here.empty());
+}
@@ -0,0 +1,287 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/nxs_test/msgrequestpipeline_test.cc             *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <list>
+#include <vector>
+#include <algorithm>
+
+// from libretroshare
+
+#include "gxs/rsgxsmsgpipeline.h"
+#include "gxs/rsgds.h"
+
+static const uint32_t REQUEST_SIZE = 20 ;
+
+static std::list<RsGxsMessageId> randomIds(uint32_t n)
+{
+	std::list<RsGxsMessageId> ids ;
+
+	for(uint32_t i=0;i<n;++i)
+		ids.push_back(RsGxsMessageId::random()) ;
+
+	return ids ;
+}
+
+// A link with a fixed one way latency and a limited bandwidth from the peer that answers. The peer answers
+// the requests in the order they arrive, and the answers are serialised on the link.
+
+class SimulatedLink
+{
+public:
+	SimulatedLink(double latency,double bandwidth,uint32_t msg_size)
+		: mLatency(latency), mBandwidth(bandwidth), mMsgSize(msg_size), mLinkFree(0) {}
+
+	void send(const std::vector<RsGxsMessageId>& ids,double now)
+	{
+		double start = std::max(now + mLatency,mLinkFree) ;
+
+		mLinkFree = start + ids.size()*mMsgSize/mBandwidth ;
+		mAnswers.insert(std::make_pair(mLinkFree + mLatency,ids)) ;
+	}
+
+	bool empty() const { return mAnswers.empty() ; }
+	double nextAnswerTime() const { return mAnswers.begin()->first ; }
+
+	std::vector<RsGxsMessageId> popAnswer()
+	{
+		std::vector<RsGxsMessageId> ids(mAnswers.begin()->second) ;
+		mAnswers.erase(mAnswers.begin()) ;
+		return ids ;
+	}
+
+	uint32_t msgSize() const { return mMsgSize ; }
+
+private:
+	double mLatency ;
+	double mBandwidth ;
+	uint32_t mMsgSize ;
+	double mLinkFree ;
+
+	std::multimap<double,std::vector<RsGxsMessageId> > mAnswers ;
+};
+
+static uint32_t sendRequests(RsGxsMsgRequestPipeline& pipeline,SimulatedLink& link,double now,uint32_t& transN)
+{
+	std::vector<RsGxsMessageId> ids ;
+	uint32_t n = 0 ;
+
+	while(pipeline.nextRequest(++transN,now,REQUEST_SIZE,ids))
+	{
+		link.send(ids,now) ;
+		++n ;
+	}
+	return n ;
+}
+
+// Runs the pipeline until all messages are received. Returns the time it took.
+
+static double transfer(RsGxsMsgRequestPipeline& pipeline,SimulatedLink& link,uint32_t nb_msgs,uint32_t& max_in_flight)
+{
+	double now = 0 ;
+	uint32_t transN = 0 ;
+
+	pipeline.setMissingMsgs(randomIds(nb_msgs)) ;
+	max_in_flight = sendRequests(pipeline,link,now,transN) ;
+
+	while(!link.empty())
+	{
+		now = link.nextAnswerTime() ;
+		std::vector<RsGxsMessageId> ids(link.popAnswer()) ;
+
+		EXPECT_TRUE(pipeline.requestAnswered(ids,ids.size()*link.msgSize(),now)) ;
+		sendRequests(pipeline,link,now,transN) ;
+
+		RsGroupPeerSyncStats stats ;
+		pipeline.getStats(stats) ;
+		max_in_flight = std::max(max_in_flight,stats.mInFlightRequests) ;
+	}
+	return now ;
+}
+
+TEST(libretroshare_gxs, MsgRequestPipeline_WindowFollowsBandwidthDelayProduct)
+{
+	// 1000 messages of 1KB, through a link with 0.5 s latency and 100KB/s. Each request of 20 messages takes 0.2 s
+	// to transfer, so that 6 requests fit in the 1.2 s round trip.
+
+	const uint32_t NB_MSGS = 1000 ;
+	const double LATENCY = 0.5 ;
+	const double BANDWIDTH = 100*1024 ;
+	const uint32_t MSG_SIZE = 1024 ;
+
+	SimulatedLink link(LATENCY,BANDWIDTH,MSG_SIZE) ;
+	RsGxsMsgRequestPipeline pipeline ;
+	uint32_t max_in_flight = 0 ;
+
+	double duration = transfer(pipeline,link,NB_MSGS,max_in_flight) ;
+
+	EXPECT_TRUE(pipeline.finished()) ;
+	EXPECT_FALSE(pipeline.incomplete()) ;
+
+	RsGroupPeerSyncStats stats ;
+	pipeline.getStats(stats) ;
+
+	EXPECT_EQ(stats.mReceivedMsgs,NB_MSGS) ;
+	EXPECT_EQ(stats.mReceivedBytes,NB_MSGS*(uint64_t)MSG_SIZE) ;
+	EXPECT_EQ(stats.mPendingMsgs,0u) ;
+	EXPECT_EQ(stats.mRequestedMsgs,0u) ;
+	EXPECT_NEAR(stats.mRtt,2*LATENCY + REQUEST_SIZE*MSG_SIZE/BANDWIDTH,0.01) ;
+	EXPECT_NEAR(stats.mThroughput,BANDWIDTH,0.05*BANDWIDTH) ;
+	EXPECT_EQ(stats.mWindowSize,7u) ;
+	EXPECT_GT(max_in_flight,RsGxsMsgRequestPipeline::INITIAL_WINDOW) ;
+
+	// One request per round trip would take 50 round trips. The pipeline keeps the link busy.
+
+	double min_duration = NB_MSGS*MSG_SIZE/BANDWIDTH ;
+	double one_at_a_time = NB_MSGS/REQUEST_SIZE * stats.mRtt ;
+
+	std::cerr << "  transferred " << NB_MSGS << " msgs in " << duration << " s (link limit: " << min_duration
+	          << " s, one request per round trip: " << one_at_a_time << " s)" << std::endl;
+
+	EXPECT_LT(duration,1.2*min_duration + 2*stats.mRtt) ;
+
+	// A link with a small latency needs fewer requests in flight.
+
+	SimulatedLink fast_link(0.001,10*1024*1024,MSG_SIZE) ;
+	RsGxsMsgRequestPipeline fast_pipeline ;
+
+	transfer(fast_pipeline,fast_link,NB_MSGS,max_in_flight) ;
+
+	EXPECT_TRUE(fast_pipeline.finished()) ;
+	EXPECT_LT(fast_pipeline.window(),stats.mWindowSize) ;
+}
+
+TEST(libretroshare_gxs, MsgRequestPipeline_LostRequests)
+{
+	RsGxsMsgRequestPipeline pipeline ;
+	std::vector<RsGxsMessageId> req1,req2,ids ;
+
+	std::list<RsGxsMessageId> missing(randomIds(3*REQUEST_SIZE)) ;
+	pipeline.setMissingMsgs(missing) ;
+
+	EXPECT_TRUE(pipeline.nextRequest(1,0,REQUEST_SIZE,req1)) ;
+	EXPECT_TRUE(pipeline.nextRequest(2,0,REQUEST_SIZE,req2)) ;
+	EXPECT_FALSE(pipeline.nextRequest(3,0,REQUEST_SIZE,ids)) ;	// window is full
+
+	EXPECT_EQ(req1.size(),REQUEST_SIZE) ;
+	EXPECT_TRUE(req1.front() == missing.front()) ;
+
+	// Messages that were not requested, or a transaction that is not ours, are ignored.
+
+	EXPECT_FALSE(pipeline.requestAnswered(std::vector<RsGxsMessageId>(1,RsGxsMessageId::random()),1000,1)) ;
+	EXPECT_FALSE(pipeline.requestFailed(12)) ;
+
+	// A new msg list from the peer does not request the messages in flight again.
+
+	pipeline.setMissingMsgs(missing) ;
+
+	RsGroupPeerSyncStats stats ;
+	pipeline.getStats(stats) ;
+	EXPECT_EQ(stats.mPendingMsgs,REQUEST_SIZE) ;
+	EXPECT_EQ(stats.mRequestedMsgs,2*REQUEST_SIZE) ;
+
+	// A failed request is sent again first, with a smaller window.
+
+	EXPECT_TRUE(pipeline.requestFailed(1)) ;
+	EXPECT_EQ(pipeline.window(),1u) ;
+	EXPECT_FALSE(pipeline.nextRequest(3,1,REQUEST_SIZE,ids)) ;
+
+	EXPECT_TRUE(pipeline.requestAnswered(req2,REQUEST_SIZE*1000,2)) ;
+	EXPECT_TRUE(pipeline.nextRequest(3,2,REQUEST_SIZE,ids)) ;
+	EXPECT_TRUE(ids == req1) ;
+
+	// A request that is not answered is left to its transaction, as long as the peer did not receive it.
+
+	EXPECT_EQ(pipeline.expireRequests(3 + pipeline.requestTimeout()),0u) ;
+	EXPECT_TRUE(pipeline.requestFailed(3)) ;
+	EXPECT_FALSE(pipeline.finished()) ;
+
+	// When the request transactions keep failing, the remaining messages are left to the next sync.
+
+	double now = 10 + pipeline.requestTimeout() ;
+	uint32_t transN = 10 ;
+
+	for(uint32_t i=2;i<RsGxsMsgRequestPipeline::MAX_LOST_REQUESTS;++i)
+	{
+		EXPECT_TRUE(pipeline.nextRequest(++transN,now,REQUEST_SIZE,ids)) ;
+		EXPECT_TRUE(pipeline.requestFailed(transN)) ;
+		EXPECT_FALSE(pipeline.incomplete()) ;
+	}
+	EXPECT_TRUE(pipeline.nextRequest(++transN,now,REQUEST_SIZE,ids)) ;
+	EXPECT_TRUE(pipeline.requestFailed(transN)) ;
+
+	EXPECT_TRUE(pipeline.finished()) ;
+	EXPECT_TRUE(pipeline.incomplete()) ;
+
+	// The next msg list starts again.
+
+	pipeline.setMissingMsgs(missing) ;
+
+	EXPECT_FALSE(pipeline.incomplete()) ;
+	EXPECT_TRUE(pipeline.nextRequest(++transN,now,REQUEST_SIZE,ids)) ;
+}
+
+TEST(libretroshare_gxs, MsgRequestPipeline_UnansweredRequests)
+{
+	// The peer received the requests but has none of the messages, so that it does not answer.
+
+	RsGxsMsgRequestPipeline pipeline ;
+	std::vector<RsGxsMessageId> req1,req2,req3,ids ;
+
+	pipeline.setMissingMsgs(randomIds(3*REQUEST_SIZE),1234,3*REQUEST_SIZE) ;
+
+	EXPECT_TRUE(pipeline.nextRequest(1,0,REQUEST_SIZE,req1)) ;
+	EXPECT_TRUE(pipeline.nextRequest(2,0,REQUEST_SIZE,req2)) ;
+	EXPECT_FALSE(pipeline.canRequest()) ;
+
+	EXPECT_TRUE(pipeline.requestDelivered(1)) ;
+	EXPECT_TRUE(pipeline.requestDelivered(2)) ;
+	EXPECT_FALSE(pipeline.requestDelivered(3)) ;
+
+	EXPECT_EQ(pipeline.expireRequests(pipeline.requestTimeout()/2),0u) ;
+
+	// The requests are dropped, without making the window smaller, and their messages are not requested again.
+
+	double now = 1 + pipeline.requestTimeout() ;
+
+	EXPECT_EQ(pipeline.expireRequests(now),2u) ;
+	EXPECT_EQ(pipeline.window(),RsGxsMsgRequestPipeline::INITIAL_WINDOW) ;
+
+	EXPECT_TRUE(pipeline.nextRequest(3,now,REQUEST_SIZE,req3)) ;
+	EXPECT_FALSE(pipeline.canRequest()) ;
+	EXPECT_TRUE(std::find(req3.begin(),req3.end(),req1.front()) == req3.end()) ;
+	EXPECT_TRUE(std::find(req3.begin(),req3.end(),req2.front()) == req3.end()) ;
+
+	EXPECT_TRUE(pipeline.requestDelivered(3)) ;
+	EXPECT_EQ(pipeline.expireRequests(2*now),1u) ;
+
+	// The msg list of the peer is fully handled, so that its time stamp can be used.
+
+	EXPECT_TRUE(pipeline.finished()) ;
+	EXPECT_FALSE(pipeline.incomplete()) ;
+	EXPECT_EQ(pipeline.listTimeStamp(),1234) ;
+	EXPECT_EQ(pipeline.listSize(),3*REQUEST_SIZE) ;
+
+	RsGroupPeerSyncStats stats ;
+	pipeline.getStats(stats) ;
+	EXPECT_EQ(stats.mReceivedMsgs,0u) ;
+}
@@ -20,10 +20,12 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <iostream>
 #include <sstream>
 #include "gxs/gxssecurity.h"
 #include "util/rsdir.h"
+#include "util/rsthreadpool.h"
 
 TEST(libretroshare_gxs, GxsSecurity)
 {
@@ -92,4 +94,139 @@ TEST(libretroshare_gxs, GxsSecurity)
 	free(out) ;
 }
 
+TEST(libretroshare_gxs, GxsSecurityKeyCache)
+{
+	RsTlvPublicRSAKey pub_key, other_pub_key ;
+	RsTlvPrivateRSAKey priv_key, other_priv_key ;
+
+	EXPECT_TRUE(GxsSecurity::generateKeyPair(pub_key,priv_key)) ;
+	EXPECT_TRUE(GxsSecurity::generateKeyPair(other_pub_key,other_priv_key)) ;
+
+	uint32_t data_len = 1000 ;
+	RsTemporaryMemory data(data_len) ;
+	RSRandom::random_bytes((unsigned char *)data,data_len) ;
+
+	RsTlvKeySignature signature ;
+	EXPECT_TRUE(GxsSecurity::getSignature((char*)(unsigned char*)data,data_len,priv_key,signature) );
+
+	GxsSecurity::KeyCacheStatistics stats1, stats2 ;
+	GxsSecurity::getKeyCacheStatistics(stats1) ;
+
+	for(int i=0;i<10;++i)
+		EXPECT_TRUE(GxsSecurity::validateSignature((char*)(unsigned char*)data,data_len,pub_key,signature) );
+
+	GxsSecurity::getKeyCacheStatistics(stats2) ;
+
+	EXPECT_TRUE(stats2.verifications == stats1.verifications + 10) ;
+	EXPECT_TRUE(stats2.misses <= stats1.misses + 1) ;
+	EXPECT_TRUE(stats2.hits >= stats1.hits + 9) ;
+
+	// A different key claiming the same id must not be served from the cache.
+
+	other_pub_key.keyId = pub_key.keyId ;
+	EXPECT_FALSE(GxsSecurity::validateSignature((char*)(unsigned char*)data,data_len,other_pub_key,signature) );
+	EXPECT_TRUE(GxsSecurity::validateSignature((char*)(unsigned char*)data,data_len,pub_key,signature) );
+}
+
+// Received messages are validated on the threads of RsThreadPool. The results must be the same as when
+// validating them one after another.
+
+TEST(libretroshare_gxs, GxsSecurityParallelValidation)
+{
+	static const uint32_t NB_MSGS = 64 ;
+
+	RsTlvPublicRSAKey pub_key, other_pub_key ;
+	RsTlvPrivateRSAKey priv_key, other_priv_key ;
+
+	EXPECT_TRUE(GxsSecurity::generateKeyPair(pub_key,priv_key)) ;
+	EXPECT_TRUE(GxsSecurity::generateKeyPair(other_pub_key,other_priv_key)) ;
+
+	std::vector<RsNxsMsg*> msgs ;
+	std::vector<RsTlvKeySignature> signatures(NB_MSGS) ;
+	std::vector<bool> expected(NB_MSGS) ;
+
+	for(uint32_t i=0;i<NB_MSGS;++i)
+	{
+		RsNxsMsg *msg = new RsNxsMsg(0) ;
+		msg->metaData = new RsGxsMsgMetaData() ;
+		msg->metaData->mGroupId = RsGxsGroupId::random() ;
+		msg->metaData->mAuthorId = RsGxsId::random() ;
+		msg->metaData->mMsgName = "message " + std::to_string(i) ;
+		msg->metaData->mPublishTs = time(NULL) ;
 
+		uint32_t data_len = 100 + RSRandom::random_u32()%100 ;
+		RsTemporaryMemory data(data_len) ;
+		RSRandom::random_bytes((unsigned char *)data,data_len) ;
+		msg->msg.setBinData(data,data_len) ;
+
+		// Same signed data as RsGenExchange::createMessage()
+
+		uint32_t meta_len = msg->metaData->serial_size() ;
+		RsTemporaryMemory signed_data(data_len + meta_len) ;
+		memcpy(signed_data,data,data_len) ;
+		EXPECT_TRUE(msg->metaData->serialise(signed_data + data_len,&meta_len)) ;
+
+		// Some messages are signed with another key, and some are modified after being signed.
+
+		expected[i] = (i%3 != 0 && i%5 != 0) ;
+
+		EXPECT_TRUE(GxsSecurity::getSignature((char*)(unsigned char*)signed_data,data_len + meta_len,(i%5 == 0)?other_priv_key:priv_key,signatures[i]) );
+
+		if(i%3 == 0)
+			((unsigned char *)msg->msg.bin_data)[0] ^= 0x01 ;
+
+		msgs.push_back(msg) ;
+	}
+
+	std::vector<bool> serial_results(NB_MSGS) ;
+
+	for(uint32_t i=0;i<NB_MSGS;++i)
+		serial_results[i] = GxsSecurity::validateNxsMsg(*msgs[i],signatures[i],pub_key) ;
+
+	RsThreadPool pool(3) ;
+	std::vector<char> parallel_results(NB_MSGS,0) ;
+
+	pool.parallelFor(NB_MSGS,[&](uint32_t i)
+	{
+		parallel_results[i] = GxsSecurity::validateNxsMsg(*msgs[i],signatures[i],pub_key) ;
+	});
+
+	for(uint32_t i=0;i<NB_MSGS;++i)
+	{
+		EXPECT_EQ(serial_results[i],expected[i]) ;
+		EXPECT_EQ((bool)parallel_results[i],serial_results[i]) ;
+	}
+
+	for(uint32_t i=0;i<NB_MSGS;++i)
+		delete msgs[i] ;
+}
+
+// Every item is processed exactly once, including when loops are started from inside a loop, or while the
+// workers are busy with another one.
+
+TEST(libretroshare_gxs, ThreadPoolParallelFor)
+{
+	static const uint32_t NB_ITEMS = 1000 ;
+
+	RsThreadPool pool(3) ;
+	std::vector<std::atomic<uint32_t> > counts(NB_ITEMS) ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+		counts[i] = 0 ;
+
+	pool.parallelFor(10,[&](uint32_t j)
+	{
+		pool.parallelFor(NB_ITEMS/10,[&](uint32_t k) { ++counts[j*(NB_ITEMS/10) + k] ; }) ;
+	}) ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+		EXPECT_EQ(counts[i],1u) ;
+
+	// Small loops run on the calling thread only.
+
+	std::thread::id caller = std::this_thread::get_id() ;
+	bool only_caller = true ;
+
+	pool.parallelFor(15,[&](uint32_t) { only_caller = only_caller && std::this_thread::get_id() == caller ; },0,16) ;
+	EXPECT_TRUE(only_caller) ;
+}
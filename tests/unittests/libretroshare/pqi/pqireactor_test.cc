@@ -0,0 +1,242 @@
+/*******************************************************************************
+ * unittests/libretroshare/pqi/pqireactor_test.cc                              *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+// from libretroshare
+
+#include "pqi/pqireactor.h"
+#include "pqi/pqithreadstreamer.h"
+#include "rsitems/rsitem.h"
+#include "serialiser/rsserializer.h"
+#include "util/rstime.h"
+
+#ifdef __linux__
+
+static const uint32_t TEST_ITEM_TYPE = 0x02123400 ;	// service packet, so that RsRawSerialiser handles it
+static const double   MAX_WAIT       = 5.0 ;
+
+// BinInterface over one end of a socket pair, so that the event loops watch a real socket descriptor.
+// Like pqissl, it only reads complete blocks.
+
+class SocketBin: public BinInterface
+{
+public:
+	SocketBin(int fd,bool limited) : mFd(fd), mLimited(limited) {}
+	virtual ~SocketBin() { ::close(mFd) ; }
+
+	virtual int tick() override { return 0 ; }
+	virtual int senddata(void *data, int len) override { return write(mFd,data,len) ; }
+	virtual int readdata(void *data, int len) override
+	{
+		if(available() < len)
+			return 0 ;
+
+		return read(mFd,data,len) ;
+	}
+	virtual int netstatus() override { return 1 ; }
+	virtual int isactive() override { return 1 ; }
+	virtual bool moretoread(uint32_t) override { return available() > 0 ; }
+	virtual bool cansend(uint32_t) override { return true ; }
+	virtual int close() override { return 0 ; }
+	virtual RsFileHash gethash() override { return RsFileHash() ; }
+	virtual bool bandwidthLimited() override { return mLimited ; }
+	virtual int socketDescriptor() override { return mFd ; }
+
+private:
+	int available()
+	{
+		int n = 0 ;
+		return (ioctl(mFd,FIONREAD,&n) < 0) ? 0 : n ;
+	}
+
+	int mFd ;
+	bool mLimited ;
+};
+
+// Receives the items read by the streamer, from the event loop thread.
+
+class ItemCollector: public PQInterface
+{
+public:
+	ItemCollector() : PQInterface(RsPeerId()), mMtx("ItemCollector") {}
+	virtual ~ItemCollector()
+	{
+		for(uint32_t i=0;i<mItems.size();++i)
+			delete mItems[i] ;
+	}
+
+	virtual int SendItem(RsItem *item) override { delete item ; return 0 ; }
+	virtual RsItem *GetItem() override { return NULL ; }
+	virtual bool RecvItem(RsItem *item) override
+	{
+		RS_STACK_MUTEX(mMtx) ;
+		mItems.push_back(item) ;
+		return true ;
+	}
+
+	uint32_t nbItems()
+	{
+		RS_STACK_MUTEX(mMtx) ;
+		return mItems.size() ;
+	}
+
+	bool waitForItems(uint32_t n)
+	{
+		for(double start = rstime::RsScopeTimer::currentTime();rstime::RsScopeTimer::currentTime() < start + MAX_WAIT;rstime::rs_usleep(1000))
+			if(nbItems() >= n)
+				return true ;
+
+		return false ;
+	}
+
+	RsMutex mMtx ;
+	std::vector<RsItem*> mItems ;
+};
+
+static RsRawItem *makeItem(uint32_t n,uint32_t size)
+{
+	RsRawItem *item = new RsRawItem(TEST_ITEM_TYPE,size) ;
+	uint8_t *data = (uint8_t*)item->getRawData() ;
+
+	setRsItemHeader(data,size,TEST_ITEM_TYPE,size) ;
+
+	for(uint32_t i=8;i<size;++i)
+		data[i] = uint8_t(n + i) ;
+
+	return item ;
+}
+
+static bool sameItem(RsItem *item,uint32_t n,uint32_t size)
+{
+	RsRawItem *raw = dynamic_cast<RsRawItem*>(item) ;
+
+	if(!raw || raw->getRawLength() != size)
+		return false ;
+
+	RsRawItem *ref = makeItem(n,size) ;
+	bool same = !memcmp(ref->getRawData(),raw->getRawData(),size) ;
+	delete ref ;
+
+	return same ;
+}
+
+static pqithreadstreamer *startStreamer(ItemCollector& parent,int fd,bool limited)
+{
+	RsSerialiser *rss = new RsSerialiser ;
+	rss->addSerialType(new RsRawSerialiser()) ;
+
+	pqithreadstreamer *streamer = new pqithreadstreamer(&parent,rss,RsPeerId(),new SocketBin(fd,limited),0) ;
+	streamer->startStreaming("test streamer") ;
+
+	return streamer ;
+}
+
+TEST(libretroshare_pqi, ReactorStreamers)
+{
+	static const uint32_t NB_ITEMS  = 50 ;
+	static const uint32_t ITEM_SIZE = 500 ;
+
+	ASSERT_TRUE(pqiReactor::init(1)) ;
+
+	int fds[2] ;
+	ASSERT_EQ(0, socketpair(AF_UNIX,SOCK_STREAM,0,fds)) ;
+	fcntl(fds[0],F_SETFL,O_NONBLOCK) ;
+	fcntl(fds[1],F_SETFL,O_NONBLOCK) ;
+
+	ItemCollector parent ;
+	pqithreadstreamer *streamer = startStreamer(parent,fds[0],false) ;
+
+	EXPECT_FALSE(streamer->isRunning()) ;	// ticked by the event loop, not by its own thread
+
+	// Read: data written on the socket wakes up the event loop, which reads it all.
+
+	std::vector<uint8_t> wire ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+	{
+		RsRawItem *item = makeItem(i,ITEM_SIZE) ;
+		wire.insert(wire.end(),(uint8_t*)item->getRawData(),(uint8_t*)item->getRawData() + ITEM_SIZE) ;
+		delete item ;
+	}
+	ASSERT_EQ((ssize_t)wire.size(), write(fds[1],wire.data(),wire.size())) ;
+
+	ASSERT_TRUE(parent.waitForItems(NB_ITEMS)) ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+		EXPECT_TRUE(sameItem(parent.mItems[i],i,ITEM_SIZE)) ;
+
+	// Write: queued items wake up the event loop, which sends them.
+
+	uint32_t size = 0 ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+		EXPECT_EQ(1, streamer->SendItem(makeItem(i,ITEM_SIZE),size)) ;
+
+	std::vector<uint8_t> received ;
+	std::vector<uint8_t> buf(NB_ITEMS*ITEM_SIZE) ;
+
+	for(double start = rstime::RsScopeTimer::currentTime();received.size() < NB_ITEMS*ITEM_SIZE + 8 && rstime::RsScopeTimer::currentTime() < start + MAX_WAIT;rstime::rs_usleep(1000))
+	{
+		ssize_t n = read(fds[1],buf.data(),buf.size()) ;
+
+		if(n > 0)
+			received.insert(received.end(),buf.begin(),buf.begin()+n) ;
+	}
+
+	// The first write starts with a packet slicing probe.
+
+	ASSERT_EQ(NB_ITEMS*ITEM_SIZE + 8, received.size()) ;
+	EXPECT_EQ(8u, getRsItemSize(received.data())) ;
+	EXPECT_TRUE(std::vector<uint8_t>(received.begin()+8,received.end()) == wire) ;
+
+	streamer->fullstopStreaming() ;
+	delete streamer ;
+	close(fds[1]) ;
+
+	// Limited read: the bandwidth limit stops each read after one item. The socket is not drained, but gets no
+	// new event, so that the event loop must read it again by itself.
+
+	ASSERT_EQ(0, socketpair(AF_UNIX,SOCK_STREAM,0,fds)) ;
+	fcntl(fds[0],F_SETFL,O_NONBLOCK) ;
+
+	ItemCollector limited_parent ;
+	streamer = startStreamer(limited_parent,fds[0],true) ;
+
+	ASSERT_EQ((ssize_t)wire.size(), write(fds[1],wire.data(),wire.size())) ;
+	ASSERT_TRUE(limited_parent.waitForItems(NB_ITEMS)) ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+		EXPECT_TRUE(sameItem(limited_parent.mItems[i],i,ITEM_SIZE)) ;
+
+	streamer->fullstopStreaming() ;
+	delete streamer ;
+	close(fds[1]) ;
+
+	pqiReactor::shutdown() ;
+}
+
+#endif
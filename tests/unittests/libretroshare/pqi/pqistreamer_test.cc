@@ -0,0 +1,251 @@
+/*******************************************************************************
+ * unittests/libretroshare/pqi/pqistreamer_test.cc                             *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+// from libretroshare
+
+#include "pqi/pqiqosstreamer.h"
+#include "rsitems/rsitem.h"
+#include "serialiser/rsserializer.h"
+
+static const uint32_t TEST_ITEM_TYPE = 0x02123400 ;	// service packet, so that RsRawSerialiser handles it
+static const uint8_t  SLICING_PROBE[8] = { 0x02, 0xaa, 0xbb, 0xcc, 0x00, 0x00, 0x00, 0x08 } ;
+
+// BinInterface that writes into memory, and behaves like SSL_write() on a slow socket: every few calls, it only takes
+// part of the data and returns -1. The next call must then pass exactly the same data, which it takes entirely.
+
+class ShortWriteBin: public BinInterface
+{
+public:
+	ShortWriteBin(uint32_t short_write_period) : mShortWritePeriod(short_write_period), mNbCalls(0), mBadRetries(0), mPendingBytes(0) {}
+
+	virtual int tick() override { return 0 ; }
+	virtual int senddata(void *data, int len) override
+	{
+		++mNbCalls ;
+
+		if(!mRetry.empty())
+		{
+			if(mRetry.size() != (uint32_t)len || memcmp(mRetry.data(),data,len))
+				++mBadRetries ;
+
+			mRetry.clear() ;
+		}
+		else if(len > 1 && mNbCalls % mShortWritePeriod == 0)
+		{
+			mRetry.assign((uint8_t*)data,(uint8_t*)data + len) ;
+			mWire.insert(mWire.end(),(uint8_t*)data,(uint8_t*)data + len/2) ;
+			mPendingBytes = len - len/2 ;
+			return -1 ;
+		}
+		else
+			mPendingBytes = len ;
+
+		mWire.insert(mWire.end(),(uint8_t*)data + len - mPendingBytes,(uint8_t*)data + len) ;
+		mWrites.push_back(len) ;
+
+		return len ;
+	}
+	virtual int readdata(void *data, int len) override
+	{
+		if(mIn.size() < (uint32_t)len)
+			return 0 ;
+
+		memcpy(data,mIn.data(),len) ;
+		mIn.erase(mIn.begin(),mIn.begin() + len) ;
+
+		return len ;
+	}
+	virtual int netstatus() override { return 1 ; }
+	virtual int isactive() override { return 1 ; }
+	virtual bool moretoread(uint32_t) override { return !mIn.empty() ; }
+	virtual bool cansend(uint32_t) override { return true ; }
+	virtual int close() override { return 0 ; }
+	virtual RsFileHash gethash() override { return RsFileHash() ; }
+	virtual bool bandwidthLimited() override { return false ; }
+
+	uint32_t mShortWritePeriod ;
+	uint32_t mNbCalls ;
+	uint32_t mBadRetries ;
+	uint32_t mPendingBytes ;
+
+	std::vector<uint8_t> mRetry ;
+	std::vector<uint8_t> mWire ;	// bytes written so far
+	std::vector<uint8_t> mIn ;	// bytes to read
+	std::vector<int> mWrites ;	// sizes of the completed writes
+};
+
+// Gives access to the ticks and counters of the streamer, which are otherwise called by the event loop.
+// pqiQoSstreamer is the one that slices packets.
+
+class TestStreamer: public pqiQoSstreamer
+{
+public:
+	TestStreamer(ShortWriteBin *bio) : pqiQoSstreamer(NULL,makeSerialiser(),RsPeerId(),bio,0), mTestBio(bio) {}
+
+	static RsSerialiser *makeSerialiser()
+	{
+		RsSerialiser *rss = new RsSerialiser ;
+		rss->addSerialType(new RsRawSerialiser()) ;
+		return rss ;
+	}
+
+	void receive()
+	{
+		while(mTestBio->moretoread(0))
+			if(tick_recv(0) <= 0)
+				break ;
+	}
+
+	bool sendAll()
+	{
+		for(int i=0;i<100000 && hasPendingOutgoingData();++i)
+			tick_send(0) ;
+
+		return !hasPendingOutgoingData() ;
+	}
+
+	uint64_t writeCount() const { return mOutWriteCount ; }
+	uint64_t allocCount() const { return mOutAllocCount ; }
+
+	ShortWriteBin *mTestBio ;
+};
+
+static RsRawItem *makeItem(uint32_t n,uint32_t size)
+{
+	RsRawItem *item = new RsRawItem(TEST_ITEM_TYPE,size) ;
+	uint8_t *data = (uint8_t*)item->getRawData() ;
+
+	setRsItemHeader(data,size,TEST_ITEM_TYPE,size) ;
+
+	for(uint32_t i=8;i<size;++i)
+		data[i] = uint8_t(n + i) ;
+
+	return item ;
+}
+
+static bool sameItem(RsItem *item,uint32_t n,uint32_t size)
+{
+	RsRawItem *raw = dynamic_cast<RsRawItem*>(item) ;
+
+	if(!raw || raw->getRawLength() != size)
+		return false ;
+
+	RsRawItem *ref = makeItem(n,size) ;
+	bool same = !memcmp(ref->getRawData(),raw->getRawData(),size) ;
+	delete ref ;
+
+	return same ;
+}
+
+static uint32_t itemSize(uint32_t n) { return 8 + (n * 397) % 3000 ; }
+
+TEST(libretroshare_pqi, StreamerShortWrites)
+{
+	static const uint32_t NB_ITEMS = 200 ;
+
+	ShortWriteBin *bio = new ShortWriteBin(3) ;
+	TestStreamer streamer(bio) ;
+
+	std::vector<uint8_t> expected(SLICING_PROBE,SLICING_PROBE + 8) ;	// the first write starts with a packet slicing probe
+	uint32_t size ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+	{
+		RsRawItem *item = makeItem(i,itemSize(i)) ;
+		expected.insert(expected.end(),(uint8_t*)item->getRawData(),(uint8_t*)item->getRawData() + itemSize(i)) ;
+
+		EXPECT_EQ(1, streamer.SendItem(item,size)) ;
+	}
+
+	ASSERT_TRUE(streamer.sendAll()) ;
+
+	// Writes are retried with the same data, and packets are sent whole and in order, grouped up to the optimal
+	// packet size since the peer did not tell that it accepts packet slicing.
+
+	EXPECT_EQ(0u, bio->mBadRetries) ;
+	EXPECT_GT(bio->mNbCalls, bio->mWrites.size()) ;
+	EXPECT_EQ(bio->mNbCalls, streamer.writeCount()) ;
+	EXPECT_LT(bio->mWrites.size(), NB_ITEMS) ;
+	EXPECT_TRUE(bio->mWire == expected) ;
+}
+
+TEST(libretroshare_pqi, StreamerGroupsBulkSlices)
+{
+	static const uint32_t NB_ITEMS  = 200 ;
+	static const uint32_t ITEM_SIZE = 5000 ;
+
+	ShortWriteBin *bio = new ShortWriteBin(4) ;
+	TestStreamer streamer(bio) ;
+
+	// The peer accepts packet slicing.
+
+	bio->mIn.assign(SLICING_PROBE,SLICING_PROBE + 8) ;
+	streamer.receive() ;
+
+	uint32_t size ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+		EXPECT_EQ(1, streamer.SendItem(makeItem(i,ITEM_SIZE),size)) ;
+
+	ASSERT_TRUE(streamer.sendAll()) ;
+
+	EXPECT_EQ(0u, bio->mBadRetries) ;
+
+	// While the queue holds more than a full write, slices are grouped up to 16 KB. The write buffer is reused.
+
+	uint32_t nb_bulk_writes = 0 ;
+
+	for(uint32_t i=0;i<bio->mWrites.size();++i)
+	{
+		EXPECT_LE(bio->mWrites[i], 16384) ;
+
+		if(bio->mWrites[i] > 8192)
+			++nb_bulk_writes ;
+	}
+
+	EXPECT_GT(nb_bulk_writes, 0u) ;
+	EXPECT_LT(bio->mWrites.size(), NB_ITEMS*ITEM_SIZE/4096) ;
+	EXPECT_LT(streamer.allocCount(), NB_ITEMS + 10) ;	// one free per item
+
+	// The slices are put back together by the receiving side.
+
+	ShortWriteBin *peer_bio = new ShortWriteBin(1) ;
+	TestStreamer peer(peer_bio) ;
+
+	peer_bio->mIn = bio->mWire ;
+	peer.receive() ;
+
+	EXPECT_TRUE(peer_bio->mIn.empty()) ;
+
+	for(uint32_t i=0;i<NB_ITEMS;++i)
+	{
+		RsItem *item = peer.GetItem() ;
+
+		ASSERT_TRUE(item != NULL) ;
+		EXPECT_TRUE(sameItem(item,i,ITEM_SIZE)) ;
+		delete item ;
+	}
+
+	EXPECT_TRUE(peer.GetItem() == NULL) ;
+}
@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * unittests/libretroshare/serialiser/smallobject_bench_test.cc                *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+// from libretroshare
+
+#include "util/smallobject.h"
+#include "util/rstime.h"
+
+// Allocation throughput of RsItem sized objects, when each thread frees its
+// own objects, and when objects are freed by another thread (as items
+// allocated by a streamer thread and deleted by a service thread).
+
+static const uint32_t BENCH_NB_ALLOCS = 1000000 ;
+static const uint32_t BENCH_BATCH     = 64 ;
+
+template<int N> class BenchObject: public RsMemoryManagement::SmallObject
+{
+public:
+	BenchObject() { memset(mData,N,N) ; }
+	bool check() const { for(int i=0;i<N;++i) if(mData[i] != (unsigned char)N) return false ; return true ; }
+
+	unsigned char mData[N] ;
+};
+
+static RsMemoryManagement::SmallObject *newObject(uint32_t i)
+{
+	switch(i & 3)
+	{
+	case 0: return new BenchObject<24>() ;
+	case 1: return new BenchObject<48>() ;
+	case 2: return new BenchObject<100>() ;
+	default: return new BenchObject<120>() ;
+	}
+}
+
+// Each thread allocates batches of objects and frees them. When cross_thread
+// is true, thread t frees the batches allocated by thread t+1.
+
+static double runBench(uint32_t nb_threads, bool cross_thread)
+{
+	std::vector<std::vector<RsMemoryManagement::SmallObject*> > batches(nb_threads) ;
+	std::vector<std::atomic<int> > ready(nb_threads) ;
+	std::vector<std::thread> threads ;
+
+	for(uint32_t t=0;t<nb_threads;++t)
+		ready[t] = 0 ;
+
+	double start = rstime::RsScopeTimer::currentTime() ;
+
+	for(uint32_t t=0;t<nb_threads;++t)
+		threads.push_back(std::thread([&,t]()
+		{
+			uint32_t peer = cross_thread ? (t+1)%nb_threads : t ;
+
+			for(uint32_t n=0;n<BENCH_NB_ALLOCS/BENCH_BATCH;++n)
+			{
+				// wait until the previous batch was consumed
+
+				while(ready[t].load() != 0)
+					std::this_thread::yield() ;
+
+				batches[t].clear() ;
+
+				for(uint32_t i=0;i<BENCH_BATCH;++i)
+					batches[t].push_back(newObject(i)) ;
+
+				ready[t] = 1 ;
+
+				if(peer == t)
+				{
+					for(uint32_t i=0;i<BENCH_BATCH;++i)
+						delete batches[t][i] ;
+
+					ready[t] = 0 ;
+				}
+				else
+				{
+					while(ready[peer].load() != 1)
+						std::this_thread::yield() ;
+
+					for(uint32_t i=0;i<BENCH_BATCH;++i)
+						delete batches[peer][i] ;
+
+					ready[peer] = 0 ;
+				}
+			}
+		}));
+
+	for(uint32_t t=0;t<threads.size();++t)
+		threads[t].join() ;
+
+	return rstime::RsScopeTimer::currentTime() - start ;
+}
+
+// Timing only, 1M allocations per thread: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_serialiser, DISABLED_SmallObjectAllocationThroughput)
+{
+	uint32_t nb_cores = std::max(1u,std::thread::hardware_concurrency()) ;
+
+	for(uint32_t n=1;n<=std::min(8u,nb_cores);n*=2)
+	{
+		double t_local = runBench(n,false) ;
+
+		std::cerr << "  " << n << " thread(s), local frees        : " << n*BENCH_NB_ALLOCS/t_local/1e6 << " M alloc+free/s" << std::endl;
+
+		if(n > 1)
+		{
+			double t_cross = runBench(n,true) ;
+			std::cerr << "  " << n << " thread(s), cross-thread frees : " << n*BENCH_NB_ALLOCS/t_cross/1e6 << " M alloc+free/s" << std::endl;
+		}
+	}
+
+	RsMemoryManagement::printStatistics() ;
+}
+
+TEST(libretroshare_serialiser, SmallObjectCrossThreadFree)
+{
+	std::vector<RsMemoryManagement::SmallObject*> objs ;
+
+	// allocated by a thread that exits before the objects are freed
+
+	std::thread([&objs]()
+	{
+		for(uint32_t i=0;i<10000;++i)
+			objs.push_back(new BenchObject<48>()) ;
+	}).join() ;
+
+	// new allocations must not reuse the memory of living objects
+
+	std::vector<RsMemoryManagement::SmallObject*> objs2 ;
+
+	for(uint32_t i=0;i<10000;++i)
+		objs2.push_back(new BenchObject<48>()) ;
+
+	for(uint32_t i=0;i<objs.size();++i)
+	{
+		EXPECT_TRUE(static_cast<BenchObject<48>*>(objs[i])->check()) ;
+		delete objs[i] ;
+	}
+	for(uint32_t i=0;i<objs2.size();++i)
+	{
+		EXPECT_TRUE(static_cast<BenchObject<48>*>(objs2[i])->check()) ;
+		delete objs2[i] ;
+	}
+}
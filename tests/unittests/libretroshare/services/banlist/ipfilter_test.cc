@@ -0,0 +1,203 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/banlist/ipfilter_test.cc                   *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+
+// from libretroshare
+
+#include "services/p3banlist.h"
+
+// Imported IP lists come in several formats. Each line is parsed into prefixes
+// of a RsIpPrefixTrie.
+
+static bool contains(const RsIpPrefixTrie& filter, const std::string& ip)
+{
+	sockaddr_storage addr ;
+	uint32_t value ;
+
+	return RsIpPrefixTrie::parseAddress(ip, addr) && filter.lookup(addr, value) ;
+}
+
+TEST(libretroshare_services, IpListLineFormats)
+{
+	RsIpPrefixTrie filter ;
+	bool ipv6 ;
+
+	// CIDR prefix and single address, with trailing comments
+
+	EXPECT_EQ(p3BanList::parseIpListLine("10.1.0.0/16", filter, ipv6), 1) ;
+	EXPECT_FALSE(ipv6) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("  192.168.3.4 # home \r", filter, ipv6), 1) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("172.16.0.0/12;spamhaus", filter, ipv6), 1) ;
+
+	EXPECT_TRUE(contains(filter, "10.1.200.3")) ;
+	EXPECT_TRUE(contains(filter, "192.168.3.4")) ;
+	EXPECT_FALSE(contains(filter, "192.168.3.5")) ;
+	EXPECT_TRUE(contains(filter, "172.31.255.255")) ;
+	EXPECT_FALSE(contains(filter, "10.2.0.1")) ;
+
+	// ipfilter.dat: "first - last , level , name". Levels above 127 are not blocked.
+
+	EXPECT_EQ(p3BanList::parseIpListLine("001.002.004.000 - 001.002.004.255 , 000 , Bad range", filter, ipv6), 1) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("003.000.000.000 - 003.000.000.255 , 200 , Allowed range", filter, ipv6), 0) ;
+
+	EXPECT_TRUE(contains(filter, "1.2.4.77")) ;
+	EXPECT_FALSE(contains(filter, "3.0.0.1")) ;
+
+	// P2P format: "name:first-last". The name may contain ':'.
+
+	EXPECT_EQ(p3BanList::parseIpListLine("Some: org:5.6.7.0-5.6.7.127", filter, ipv6), 1) ;
+	EXPECT_TRUE(contains(filter, "5.6.7.100")) ;
+	EXPECT_FALSE(contains(filter, "5.6.7.128")) ;
+
+	// Ranges that are not aligned on a prefix give several prefixes.
+
+	EXPECT_EQ(p3BanList::parseIpListLine("8.8.8.1 - 8.8.8.6", filter, ipv6), 4) ;
+	EXPECT_TRUE(contains(filter, "8.8.8.1")) ;
+	EXPECT_TRUE(contains(filter, "8.8.8.6")) ;
+	EXPECT_FALSE(contains(filter, "8.8.8.7")) ;
+
+	// IPv6
+
+	EXPECT_EQ(p3BanList::parseIpListLine("2001:db8::/32", filter, ipv6), 1) ;
+	EXPECT_TRUE(ipv6) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("2001:db9::1 - 2001:db9::2", filter, ipv6), 2) ;
+	EXPECT_TRUE(ipv6) ;
+	EXPECT_TRUE(contains(filter, "2001:db8:1234::5")) ;
+	EXPECT_TRUE(contains(filter, "2001:db9::2")) ;
+	EXPECT_FALSE(contains(filter, "2001:db9::3")) ;
+
+	// Ignored and bad lines
+
+	uint32_t size = filter.size() ;
+
+	EXPECT_EQ(p3BanList::parseIpListLine("", filter, ipv6), 0) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("   \t", filter, ipv6), 0) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("# 1.2.3.4", filter, ipv6), 0) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("not an address", filter, ipv6), -1) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("10.1.0/16", filter, ipv6), -1) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("1.2.3.4 - garbage", filter, ipv6), -1) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("name:1.2.3.x-1.2.3.9", filter, ipv6), -1) ;
+	EXPECT_EQ(p3BanList::parseIpListLine("9.9.9.9 - 9.9.9.1", filter, ipv6), -1) ;
+
+	EXPECT_EQ(filter.size(), size) ;
+}
+
+TEST(libretroshare_services, IpListFile)
+{
+	char fname[] = "/tmp/rs_ip_list_XXXXXX" ;
+	int fd = mkstemp(fname) ;
+	ASSERT_GE(fd, 0) ;
+	close(fd) ;
+
+	std::string path(fname) ;
+
+	{
+		std::ofstream out(path.c_str()) ;
+
+		out << "# test list\n" ;
+		out << "10.0.0.0/8\n" ;
+		out << "garbage line\n" ;
+		out << "001.002.003.000 - 001.002.003.255 , 100 , Some range\r\n" ;
+		out << "2001:db8::/32\n" ;
+		out << "\n" ;
+	}
+
+	ImportedIpList list ;
+
+	EXPECT_TRUE(p3BanList::parseIpListFile(path, list)) ;
+	EXPECT_EQ(list.mNbRanges, 3u) ;
+	EXPECT_EQ(list.mNbIpv6Ranges, 1u) ;
+	EXPECT_TRUE(contains(list.mFilter, "10.20.30.40")) ;
+	EXPECT_TRUE(contains(list.mFilter, "1.2.3.4")) ;
+	EXPECT_TRUE(contains(list.mFilter, "2001:db8::1")) ;
+	EXPECT_FALSE(contains(list.mFilter, "11.0.0.1")) ;
+
+	// A file without any prefix is not imported.
+
+	{
+		std::ofstream out(path.c_str()) ;
+		out << "# nothing here\n" ;
+	}
+
+	ImportedIpList empty_list ;
+
+	EXPECT_FALSE(p3BanList::parseIpListFile(path, empty_list)) ;
+	EXPECT_EQ(empty_list.mNbRanges, 0u) ;
+
+	remove(path.c_str()) ;
+
+	EXPECT_FALSE(p3BanList::parseIpListFile(path, empty_list)) ;
+}
+
+TEST(libretroshare_services, IpListWhiteListIpv6)
+{
+	char fname[] = "/tmp/rs_ip_white_list_XXXXXX" ;
+	int fd = mkstemp(fname) ;
+	ASSERT_GE(fd, 0) ;
+	close(fd) ;
+
+	{
+		std::ofstream out(fname) ;
+		out << "10.0.0.0/8\n" ;
+	}
+
+	p3BanList banlist(nullptr, nullptr) ;
+	sockaddr_storage addr ;
+	uint32_t check_result ;
+
+	EXPECT_TRUE(banlist.importIpList(fname, RSBANLIST_TYPE_WHITELIST)) ;
+
+	// IPv4, also when mapped in IPv6, has to be whitelisted.
+
+	ASSERT_TRUE(RsIpPrefixTrie::parseAddress("10.1.2.3", addr)) ;
+	EXPECT_TRUE(banlist.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_WHITELIST, check_result)) ;
+	ASSERT_TRUE(RsIpPrefixTrie::parseAddress("11.1.2.3", addr)) ;
+	EXPECT_FALSE(banlist.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_WHITELIST, check_result)) ;
+	EXPECT_EQ(check_result, RSBANLIST_CHECK_RESULT_NOT_WHITELISTED) ;
+	ASSERT_TRUE(RsIpPrefixTrie::parseAddress("::ffff:11.1.2.3", addr)) ;
+	EXPECT_FALSE(banlist.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_WHITELIST, check_result)) ;
+
+	// Native IPv6 cannot be whitelisted by hand, so it is accepted as long as
+	// no imported whitelist holds IPv6 ranges.
+
+	ASSERT_TRUE(RsIpPrefixTrie::parseAddress("2001:db8::1", addr)) ;
+	EXPECT_TRUE(banlist.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_WHITELIST, check_result)) ;
+
+	{
+		std::ofstream out(fname) ;
+		out << "2001:db8::/32\n" ;
+	}
+	EXPECT_TRUE(banlist.importIpList(fname, RSBANLIST_TYPE_WHITELIST)) ;
+
+	EXPECT_TRUE(banlist.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_WHITELIST, check_result)) ;
+	ASSERT_TRUE(RsIpPrefixTrie::parseAddress("2001:db9::1", addr)) ;
+	EXPECT_FALSE(banlist.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_WHITELIST, check_result)) ;
+
+	banlist.clearImportedIpLists(RSBANLIST_TYPE_WHITELIST) ;
+	EXPECT_TRUE(banlist.isAddressAccepted(addr, RSBANLIST_CHECKING_FLAGS_WHITELIST, check_result)) ;
+
+	remove(fname) ;
+}
@@ -0,0 +1,280 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/banlist/iptrie_test.cc                     *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <vector>
+
+// from libretroshare
+
+#include "util/rsiptrie.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+
+// The ban list checks each incoming connection and DHT contact against its
+// ranges. RsIpPrefixTrie replaces the /16, /24 and /32 map lookups.
+
+static sockaddr_storage ipv4(uint32_t ip)
+{
+	sockaddr_storage addr ;
+	sockaddr_storage_clear(addr) ;
+
+	sockaddr_in *a = (sockaddr_in*)&addr ;
+	a->sin_family = AF_INET ;
+	a->sin_addr.s_addr = htonl(ip) ;
+
+	return addr ;
+}
+
+static sockaddr_storage ipv6(uint64_t hi, uint64_t lo)
+{
+	sockaddr_storage addr ;
+	sockaddr_storage_clear(addr) ;
+
+	sockaddr_in6 *a = (sockaddr_in6*)&addr ;
+	a->sin6_family = AF_INET6 ;
+
+	for(int i=0;i<8;++i)
+	{
+		a->sin6_addr.s6_addr[i]   = hi >> (56 - 8*i) ;
+		a->sin6_addr.s6_addr[i+8] = lo >> (56 - 8*i) ;
+	}
+	return addr ;
+}
+
+static uint32_t mask4(uint32_t len) { return (len == 0) ? 0 : (0xffffffffu << (32 - len)) ; }
+
+struct RefPrefix
+{
+	uint32_t ip ;
+	uint32_t len ;
+	uint32_t value ;
+};
+
+// brute force longest prefix match
+
+static bool refLookup(const std::vector<RefPrefix>& prefixes, uint32_t ip, uint32_t& value, uint32_t& len)
+{
+	bool found = false ;
+
+	for(uint32_t i=0;i<prefixes.size();++i)
+		if((ip & mask4(prefixes[i].len)) == prefixes[i].ip && (!found || prefixes[i].len > len))
+		{
+			found = true ;
+			len = prefixes[i].len ;
+			value = prefixes[i].value ;
+		}
+
+	return found ;
+}
+
+TEST(libretroshare_services, IpTrieLongestPrefixMatch)
+{
+	RsIpPrefixTrie trie ;
+	std::vector<RefPrefix> prefixes ;
+
+	// prefixes concentrated in a few /8, so that they nest. Removing half of
+	// them brings the trie below the size for which it indexes IPv4 /16.
+
+	for(uint32_t i=0;i<6000;++i)
+	{
+		RefPrefix p ;
+		p.len = 8 + RsRandom::random_u32() % 25 ;
+		p.ip = ((10 + RsRandom::random_u32() % 4) << 24 | (RsRandom::random_u32() & 0x00ffffff)) & mask4(p.len) ;
+		p.value = i ;
+
+		for(uint32_t j=0;j<prefixes.size();++j)
+			if(prefixes[j].ip == p.ip && prefixes[j].len == p.len)
+			{
+				prefixes.erase(prefixes.begin()+j) ;
+				break ;
+			}
+
+		prefixes.push_back(p) ;
+		EXPECT_TRUE(trie.insert(ipv4(p.ip | (~mask4(p.len) & RsRandom::random_u32())), p.len, p.value)) ;
+	}
+	EXPECT_EQ(trie.size(), prefixes.size()) ;
+
+	for(int pass=0;pass<2;++pass)
+	{
+		for(uint32_t i=0;i<20000;++i)
+		{
+			uint32_t ip = (10 + RsRandom::random_u32() % 5) << 24 | (RsRandom::random_u32() & 0x00ffffff) ;
+			uint32_t v1=0, l1=0, v2=0, l2=0 ;
+
+			bool f1 = refLookup(prefixes, ip, v1, l1) ;
+			bool f2 = trie.lookup(ipv4(ip), v2, &l2) ;
+
+			ASSERT_EQ(f1, f2) ;
+
+			if(f1)
+			{
+				EXPECT_EQ(v1, v2) ;
+				EXPECT_EQ(l1, l2) ;
+			}
+		}
+
+		// remove half of the prefixes, and check again
+
+		for(uint32_t i=0;i<prefixes.size();)
+			if(pass == 0 && (RsRandom::random_u32() & 1))
+			{
+				EXPECT_TRUE(trie.remove(ipv4(prefixes[i].ip), prefixes[i].len)) ;
+				EXPECT_FALSE(trie.remove(ipv4(prefixes[i].ip), prefixes[i].len)) ;
+				prefixes.erase(prefixes.begin()+i) ;
+			}
+			else
+				++i ;
+
+		EXPECT_EQ(trie.size(), prefixes.size()) ;
+	}
+
+	// removing everything leaves the root only
+
+	for(uint32_t i=0;i<prefixes.size();++i)
+		EXPECT_TRUE(trie.remove(ipv4(prefixes[i].ip), prefixes[i].len)) ;
+
+	uint32_t v ;
+	EXPECT_EQ(trie.size(), 0u) ;
+	EXPECT_FALSE(trie.lookup(ipv4(0x0a000001), v)) ;
+}
+
+TEST(libretroshare_services, IpTrieIpv6AndRanges)
+{
+	RsIpPrefixTrie trie ;
+	uint32_t v = 0, len = 0 ;
+
+	EXPECT_TRUE(trie.insert(ipv6(0x20010db800000000ull, 0), 32, 1)) ;
+	EXPECT_TRUE(trie.insert(ipv6(0x20010db812340000ull, 0), 48, 2)) ;
+	EXPECT_FALSE(trie.insert(ipv6(0, 0), 129, 3)) ;
+	EXPECT_FALSE(trie.insert(ipv4(0), 33, 3)) ;
+
+	EXPECT_TRUE(trie.lookup(ipv6(0x20010db812345678ull, 1), v, &len)) ;
+	EXPECT_EQ(v, 2u) ;
+	EXPECT_EQ(len, 48u) ;
+	EXPECT_TRUE(trie.lookup(ipv6(0x20010db8ffff0000ull, 1), v, &len)) ;
+	EXPECT_EQ(v, 1u) ;
+	EXPECT_EQ(len, 32u) ;
+	EXPECT_FALSE(trie.lookup(ipv6(0x20010db900000000ull, 1), v)) ;
+
+	// IPv4 and IPv4-mapped IPv6 addresses are the same
+
+	EXPECT_TRUE(trie.insert(ipv4(0xc0a80000), 16, 4)) ;
+	EXPECT_TRUE(trie.lookup(ipv6(0, 0x0000ffffc0a80101ull), v, &len)) ;
+	EXPECT_EQ(v, 4u) ;
+	EXPECT_EQ(len, 112u) ;
+	EXPECT_TRUE(trie.lookup(ipv4(0xc0a8ffff), v, &len)) ;
+	EXPECT_EQ(len, 16u) ;
+	EXPECT_FALSE(trie.lookup(ipv4(0xc0a90000), v)) ;
+
+	// 1.2.3.4 - 1.2.5.10 is 1.2.3.4/30, 1.2.3.8/29, 1.2.3.16/28, 1.2.3.32/27, 1.2.3.64/26, 1.2.3.128/25, 1.2.4.0/24, 1.2.5.0/29, 1.2.5.8/31, 1.2.5.10/32
+
+	RsIpPrefixTrie ranges ;
+	EXPECT_EQ(ranges.insertRange(ipv4(0x01020304), ipv4(0x0102050a), 7), 10u) ;
+	EXPECT_EQ(ranges.size(), 10u) ;
+
+	EXPECT_FALSE(ranges.lookup(ipv4(0x01020303), v)) ;
+	EXPECT_FALSE(ranges.lookup(ipv4(0x0102050b), v)) ;
+
+	for(uint32_t ip=0x01020304;ip<=0x0102050a;++ip)
+		EXPECT_TRUE(ranges.lookup(ipv4(ip), v)) ;
+
+	EXPECT_EQ(ranges.insertRange(ipv4(0), ipv4(0xffffffff), 8), 1u) ;
+	EXPECT_EQ(ranges.insertRange(ipv4(2), ipv4(1), 8), 0u) ;
+	EXPECT_EQ(ranges.insertRange(ipv6(0,0), ipv6(~0ull,~0ull), 9), 1u) ;
+	EXPECT_EQ(ranges.insertRange(ipv4(0), ipv6(0,1), 9), 0u) ;
+
+	sockaddr_storage addr ;
+
+	EXPECT_TRUE(RsIpPrefixTrie::parsePrefix("10.1.0.0/16", addr, len)) ;
+	EXPECT_EQ(len, 16u) ;
+	EXPECT_EQ(addr.ss_family, AF_INET) ;
+	EXPECT_TRUE(RsIpPrefixTrie::parsePrefix("001.002.003.004", addr, len)) ;
+	EXPECT_EQ(len, 32u) ;
+	EXPECT_TRUE(RsIpPrefixTrie::parsePrefix("2001:db8::/32", addr, len)) ;
+	EXPECT_EQ(len, 32u) ;
+	EXPECT_EQ(addr.ss_family, AF_INET6) ;
+	EXPECT_FALSE(RsIpPrefixTrie::parsePrefix("10.1.0.0/33", addr, len)) ;
+	EXPECT_FALSE(RsIpPrefixTrie::parsePrefix("10.1.0/16", addr, len)) ;
+	EXPECT_FALSE(RsIpPrefixTrie::parsePrefix("10.1.0.0/", addr, len)) ;
+	EXPECT_FALSE(RsIpPrefixTrie::parsePrefix("256.1.0.0", addr, len)) ;
+}
+
+// Lookup throughput with the size of a public blocklist, compared to the
+// previous storage: one map for the ranges, looked up for /16, /24 and /32.
+// Timing only: run with --gtest_also_run_disabled_tests
+
+static const uint32_t BENCH_NB_RANGES  = 300000 ;
+static const uint32_t BENCH_NB_LOOKUPS = 2000000 ;
+
+TEST(libretroshare_services, DISABLED_IpTrieLookupThroughput)
+{
+	RsIpPrefixTrie trie ;
+	std::map<sockaddr_storage,uint32_t> ranges ;
+
+	static const uint32_t lens[3] = { 16, 24, 32 } ;
+
+	for(uint32_t i=0;i<BENCH_NB_RANGES;++i)
+	{
+		uint32_t len = lens[RsRandom::random_u32() % 3] ;
+		uint32_t ip = RsRandom::random_u32() & mask4(len) ;
+
+		// the map keys of a.b.255.0/24 and a.b.0.0/16 are the same, as for a.b.c.255/32 and a.b.c.0/24
+
+		if((len == 24 && (ip & 0xff00) == 0xff00) || (len == 32 && (ip & 0xff) == 0xff))
+			continue ;
+
+		trie.insert(ipv4(ip), len, i) ;
+		ranges[ipv4(ip | ~mask4(len))] = i ;
+	}
+
+	std::vector<sockaddr_storage> addrs ;
+
+	for(uint32_t i=0;i<BENCH_NB_LOOKUPS;++i)
+		addrs.push_back(ipv4(RsRandom::random_u32())) ;
+
+	uint32_t v, n_map = 0, n_trie = 0 ;
+
+	double start = rstime::RsScopeTimer::currentTime() ;
+
+	for(uint32_t i=0;i<addrs.size();++i)
+	{
+		uint32_t ip = ntohl(((sockaddr_in*)&addrs[i])->sin_addr.s_addr) ;
+
+		n_map += ranges.find(ipv4(ip | 0xffff)) != ranges.end()
+		      || ranges.find(ipv4(ip | 0xff)) != ranges.end()
+		      || ranges.find(ipv4(ip)) != ranges.end() ;
+	}
+	double t_map = rstime::RsScopeTimer::currentTime() - start ;
+
+	start = rstime::RsScopeTimer::currentTime() ;
+
+	for(uint32_t i=0;i<addrs.size();++i)
+		n_trie += trie.lookup(addrs[i], v) ;
+
+	double t_trie = rstime::RsScopeTimer::currentTime() - start ;
+
+	std::cerr << "  " << BENCH_NB_RANGES << " ranges, trie uses " << trie.memoryUsage()/1024 << " KB" << std::endl;
+	std::cerr << "  3 map lookups : " << BENCH_NB_LOOKUPS / t_map / 1e6 << " M lookups/s" << std::endl;
+	std::cerr << "  trie lookup   : " << BENCH_NB_LOOKUPS / t_trie / 1e6 << " M lookups/s" << std::endl;
+
+	EXPECT_EQ(n_map, n_trie) ;
+}
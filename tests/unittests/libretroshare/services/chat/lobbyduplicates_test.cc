@@ -0,0 +1,329 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/chat/lobbyduplicates_test.cc               *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+// from librssimulator
+#include "peer/PeerNode.h"
+
+// from libretroshare
+#include "chat/distributedchat.h"
+#include "chat/rschatitems.h"
+#include "gxs/rsgixs.h"
+#include "services/p3service.h"
+#include "services/rseventsservice.h"
+#include "retroshare/rsreputations.h"
+#include "retroshare/rsgrouter.h"
+
+// Identity service that accepts all signatures, and counts how many it was asked to verify.
+
+class LobbyTestGixs: public RsGixs
+{
+public:
+	LobbyTestGixs() : mValidations(0) {}
+
+	virtual bool signData(const uint8_t *,uint32_t,const RsGxsId&,RsTlvKeySignature&,uint32_t&) { return false ; }
+	virtual bool validateData(const uint8_t *,uint32_t,const RsTlvKeySignature&,bool,const RsIdentityUsage&,uint32_t&) { ++mValidations ; return true ; }
+
+	virtual bool encryptData(const uint8_t *,uint32_t,uint8_t *&,uint32_t&,const RsGxsId&,uint32_t&,bool) { return false ; }
+	virtual bool decryptData(const uint8_t *,uint32_t,uint8_t *&,uint32_t&,const RsGxsId&,uint32_t&,bool) { return false ; }
+
+	virtual bool getOwnIds(std::list<RsGxsId>&,bool) { return false ; }
+	virtual bool isOwnId(const RsGxsId&) { return false ; }
+	virtual void timeStampKey(const RsGxsId&,const RsIdentityUsage&) {}
+	virtual bool haveKey(const RsGxsId&) { return true ; }
+	virtual bool havePrivateKey(const RsGxsId&) { return false ; }
+	virtual bool requestKey(const RsGxsId&,const std::list<RsPeerId>&,const RsIdentityUsage&) { return true ; }
+	virtual bool requestPrivateKey(const RsGxsId&) { return false ; }
+	virtual bool receiveNewIdentity(RsNxsGrp *) { return false ; }
+	virtual bool retrieveNxsIdentity(const RsGxsId&,RsNxsGrp *&) { return false ; }
+	virtual bool getKey(const RsGxsId&,RsTlvPublicRSAKey&) { return false ; }
+	virtual bool getPrivateKey(const RsGxsId&,RsTlvPrivateRSAKey&) { return false ; }
+	virtual bool getIdDetails(const RsGxsId&,RsIdentityDetails&) { return false ; }
+
+	uint32_t mValidations ;
+};
+
+class LobbyTestReputations: public RsReputations
+{
+public:
+	virtual bool setOwnOpinion(const RsGxsId&,RsOpinion) { return false ; }
+	virtual bool getOwnOpinion(const RsGxsId&,RsOpinion&) { return false ; }
+	virtual bool getReputationInfo(const RsGxsId&,const RsPgpId&,RsReputationInfo&,bool) { return false ; }
+	virtual RsReputationLevel overallReputationLevel(const RsGxsId&) { return RsReputationLevel::NEUTRAL ; }
+	virtual void setAutoPositiveOpinionForContacts(bool) {}
+	virtual bool autoPositiveOpinionForContacts() { return false ; }
+	virtual void setThresholdForRemotelyNegativeReputation(uint32_t) {}
+	virtual uint32_t thresholdForRemotelyNegativeReputation() { return 0 ; }
+	virtual void setThresholdForRemotelyPositiveReputation(uint32_t) {}
+	virtual uint32_t thresholdForRemotelyPositiveReputation() { return 0 ; }
+	virtual uint32_t rememberBannedIdThreshold() { return 0 ; }
+	virtual void setRememberBannedIdThreshold(uint32_t) {}
+	virtual bool isIdentityBanned(const RsGxsId&) { return false ; }
+	virtual bool isNodeBanned(const RsPgpId&) { return false ; }
+	virtual void banNode(const RsPgpId&,bool) {}
+	virtual RsReputationLevel overallReputationLevel(const RsGxsId&,uint32_t *) { return RsReputationLevel::NEUTRAL ; }
+};
+
+class LobbyTestGRouter: public RsGRouter
+{
+public:
+	virtual bool getRoutingCacheInfo(std::vector<GRouterRoutingCacheInfo>&) { return false ; }
+	virtual bool getRoutingMatrixInfo(GRouterRoutingMatrixInfo&) { return false ; }
+	virtual bool sendData(const RsGxsId&,const GRouterServiceId&,const uint8_t *,uint32_t,const RsGxsId&,GRouterMsgPropagationId&) { return false ; }
+	virtual bool cancel(GRouterMsgPropagationId) { return false ; }
+	virtual bool registerKey(const RsGxsId&,const GRouterServiceId&,const std::string&) { return false ; }
+	virtual void addRoutingClue(const GRouterKeyId&,const RsPeerId&) {}
+};
+
+// The lobby part of the chat service, on top of a simulated peer.
+
+class LobbyTestService: public p3Service, public DistributedChatService
+{
+public:
+	LobbyTestService(p3ServiceControl *sc,RsGixs *gixs)
+		: DistributedChatService(RS_SERVICE_TYPE_CHAT,sc,NULL,gixs), mAccepted(0)
+	{
+		addSerialType(new RsChatSerialiser()) ;
+	}
+
+	virtual RsServiceInfo getServiceInfo() { return RsServiceInfo(RS_SERVICE_TYPE_CHAT, "chat", 1, 0, 1, 0); }
+
+	virtual int tick()
+	{
+		RsItem *item ;
+
+		while(NULL != (item=recvItem()))
+		{
+			RsChatMsgItem *ci = dynamic_cast<RsChatMsgItem*>(item) ;
+
+			if(ci != NULL && handleRecvChatLobbyMsgItem(ci))
+				++mAccepted ;
+
+			delete item ;
+		}
+		return 0 ;
+	}
+
+	// Subscribes to a lobby, as when loading the config at start.
+
+	void subscribeLobby(ChatLobbyId lobby_id,const std::set<RsPeerId>& friends)
+	{
+		RsSubscribedChatLobbyConfigItem item ;
+
+		item.info.lobby_id = lobby_id ;
+		item.info.lobby_name = "test lobby" ;
+		item.info.participating_friends = friends ;
+		item.info.gxs_id = RsGxsId::random() ;
+		item.info.lobby_flags = RS_CHAT_LOBBY_FLAGS_PUBLIC ;
+		item.info.last_activity = time(NULL) ;
+
+		processLoadListItem(&item) ;
+	}
+
+	void sendToPeer(const RsChatLobbyMsgItem& msg,const RsPeerId& peer_id)
+	{
+		RsChatLobbyMsgItem *item = new RsChatLobbyMsgItem(msg) ;
+		item->PeerId(peer_id) ;
+		sendChatItem(item) ;
+	}
+
+	uint32_t mAccepted ;
+
+protected:
+	virtual void sendChatItem(RsChatItem *item) { sendItem(item) ; }
+	virtual void sendChatItemToPeers(RsChatItem *item,const std::set<RsPeerId>& peers) { sendItemToPeers(item,peers) ; }
+	virtual void locked_storeIncomingMsg(RsChatMsgItem *item) { delete item ; }
+	virtual void triggerConfigSave() {}
+};
+
+// Peer B is in a lobby with its friends A and C. A and C both send B the same lobby message, as it happens when
+// a message reaches B through several routes.
+
+class LobbyTriangle
+{
+public:
+	LobbyTriangle() : mIdA(RsPeerId::random()), mIdB(RsPeerId::random()), mIdC(RsPeerId::random())
+	{
+		std::list<RsPeerId> friends_b ;
+		friends_b.push_back(mIdA) ;
+		friends_b.push_back(mIdC) ;
+
+		mNodeA = addNode(mIdA,std::list<RsPeerId>(1,mIdB),mServiceA,mGixsA) ;
+		mNodeB = addNode(mIdB,friends_b,mServiceB,mGixsB) ;
+		mNodeC = addNode(mIdC,std::list<RsPeerId>(1,mIdB),mServiceC,mGixsC) ;
+	}
+
+	~LobbyTriangle()
+	{
+		for(std::map<RsPeerId,PeerNode*>::iterator it(mNodes.begin());it!=mNodes.end();++it)
+			delete it->second ;
+
+		delete mServiceA ;
+		delete mServiceB ;
+		delete mServiceC ;
+	}
+
+	// Sends the packets of the given node to their destination. Returns the number of packets sent.
+
+	uint32_t deliverOutgoing(PeerNode *node)
+	{
+		uint32_t n = 0 ;
+
+		while(node->haveOutgoingPackets())
+		{
+			RsRawItem *item = node->outgoing() ;
+			PeerNode *dest = mNodes[item->PeerId()] ;
+
+			item->PeerId(node->id()) ;
+			dest->incoming(item) ;
+			++n ;
+		}
+		return n ;
+	}
+
+	void tickAll(int nb_ticks)
+	{
+		for(int i=0;i<nb_ticks;++i)
+			for(std::map<RsPeerId,PeerNode*>::iterator it(mNodes.begin());it!=mNodes.end();++it)
+				it->second->tick() ;
+	}
+
+	RsPeerId mIdA,mIdB,mIdC ;
+	PeerNode *mNodeA,*mNodeB,*mNodeC ;
+	LobbyTestService *mServiceA,*mServiceB,*mServiceC ;
+	LobbyTestGixs mGixsA,mGixsB,mGixsC ;
+
+private:
+	PeerNode *addNode(const RsPeerId& id,const std::list<RsPeerId>& friends,LobbyTestService *& service,LobbyTestGixs& gixs)
+	{
+		PeerNode *node = new PeerNode(id,friends,true) ;
+
+		service = new LobbyTestService(node->getServiceControl(),&gixs) ;
+		node->AddService(service) ;
+
+		mNodes[id] = node ;
+		return node ;
+	}
+
+	std::map<RsPeerId,PeerNode*> mNodes ;
+};
+
+static void test_lobbyDuplicates() ;
+
+TEST(libretroshare_services, ChatLobby_DropDuplicates)
+{
+	// The lobby code reaches the reputation and routing services, and posts events, through global pointers.
+
+	LobbyTestReputations reputations ;
+	LobbyTestGRouter grouter ;
+	RsEventsService events ;
+
+	RsReputations *old_reputations = rsReputations ;
+	RsGRouter *old_grouter = rsGRouter ;
+	RsEvents *old_events = rsEvents ;
+
+	rsReputations = &reputations ;
+	rsGRouter = &grouter ;
+	rsEvents = &events ;
+
+	test_lobbyDuplicates() ;
+
+	rsReputations = old_reputations ;
+	rsGRouter = old_grouter ;
+	rsEvents = old_events ;
+}
+
+static void test_lobbyDuplicates()
+{
+	LobbyTriangle peers ;
+	peers.tickAll(2) ;
+
+	ChatLobbyId lobby_id = RSRandom::random_u64() ;
+
+	std::set<RsPeerId> friends ;
+	friends.insert(peers.mIdA) ;
+	friends.insert(peers.mIdC) ;
+	peers.mServiceB->subscribeLobby(lobby_id,friends) ;
+
+	RsChatLobbyMsgItem msg ;
+	msg.lobby_id = lobby_id ;
+	msg.msg_id = RSRandom::random_u64() ;
+	msg.parent_msg_id = 0 ;
+	msg.nick = "author" ;
+	msg.chatFlags = RS_CHAT_FLAG_PRIVATE | RS_CHAT_FLAG_LOBBY ;
+	msg.sendTime = time(NULL) ;
+	msg.recvTime = msg.sendTime ;
+	msg.message = "hello" ;
+	msg.signature.keyId = RsGxsId::random() ;
+	msg.signature.signData.setBinData("signature",9) ;
+
+	// The first copy is checked and accepted.
+
+	peers.mServiceA->sendToPeer(msg,peers.mIdB) ;
+	EXPECT_EQ(peers.deliverOutgoing(peers.mNodeA),1u) ;
+	peers.mNodeB->tick() ;
+
+	EXPECT_EQ(peers.mServiceB->mAccepted,1u) ;
+	EXPECT_EQ(peers.mGixsB.mValidations,1u) ;
+
+	uint64_t duplicates_dropped, verifications_saved ;
+	peers.mServiceB->getLobbyBouncingStatistics(duplicates_dropped,verifications_saved) ;
+	EXPECT_EQ(duplicates_dropped,0u) ;
+
+	// B forwards it to C only, since it comes from A.
+
+	uint32_t nb_forwarded = 0 ;
+
+	while(peers.mNodeB->haveOutgoingPackets())
+	{
+		RsRawItem *item = peers.mNodeB->outgoing() ;
+		EXPECT_TRUE(item->PeerId() == peers.mIdC) ;
+		++nb_forwarded ;
+		delete item ;
+	}
+	EXPECT_EQ(nb_forwarded,1u) ;
+
+	// The copies sent by C and A are dropped before checking their signature, and are not forwarded again.
+
+	peers.mServiceC->sendToPeer(msg,peers.mIdB) ;
+	peers.mServiceA->sendToPeer(msg,peers.mIdB) ;
+	peers.deliverOutgoing(peers.mNodeC) ;
+	peers.deliverOutgoing(peers.mNodeA) ;
+	peers.mNodeB->tick() ;
+
+	EXPECT_EQ(peers.mServiceB->mAccepted,1u) ;
+	EXPECT_EQ(peers.mGixsB.mValidations,1u) ;
+	EXPECT_FALSE(peers.mNodeB->haveOutgoingPackets()) ;
+
+	peers.mServiceB->getLobbyBouncingStatistics(duplicates_dropped,verifications_saved) ;
+	EXPECT_EQ(duplicates_dropped,2u) ;
+	EXPECT_EQ(verifications_saved,2u) ;
+
+	// A message with a different id is still checked.
+
+	msg.msg_id = RSRandom::random_u64() ;
+	peers.mServiceC->sendToPeer(msg,peers.mIdB) ;
+	peers.deliverOutgoing(peers.mNodeC) ;
+	peers.mNodeB->tick() ;
+
+	EXPECT_EQ(peers.mServiceB->mAccepted,2u) ;
+	EXPECT_EQ(peers.mGixsB.mValidations,2u) ;
+}
@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/core/servicelatency_test.cc                *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+// from libretroshare
+
+#include "services/p3service.h"
+#include "retroshare/rsconfig.h"
+#include "util/rswakeupsignal.h"
+#include "util/rstime.h"
+
+// Services that are ticked by the core loop wake it up when they receive an item, so
+// that the item does not wait for the next fixed interval tick of RsServer::threadTick().
+
+static const uint32_t TEST_NB_ITEMS      = 100 ;
+static const uint32_t TEST_ITEM_INTERVAL = 1000 ;	// microseconds between two incoming items
+static const double   MAX_WAIT           = 10.0 ;
+
+class LatencyTestService: public p3Service
+{
+public:
+	RsServiceInfo getServiceInfo() override { return RsServiceInfo(); }
+
+	uint32_t handleItems()
+	{
+		uint32_t n = 0 ;
+		RsItem *item ;
+
+		while(NULL != (item = recvItem()))
+		{
+			delete item ;
+			++n ;
+		}
+		return n ;
+	}
+};
+
+// Services with their own thread poll their queue themselves. They must not wake up the core loop.
+
+class ThreadedTestService: public LatencyTestService, public RsTickingThread
+{
+public:
+	void threadTick() override {}
+};
+
+TEST(libretroshare_services, ServiceItemWakesUpCoreLoop)
+{
+	LatencyTestService service ;
+	ThreadedTestService threaded_service ;
+
+	RsWakeupSignal::coreLoop().wait(0) ;	// forget earlier notifications
+
+	service.recvItem(new RsRawItem(0x02000000,8)) ;
+	EXPECT_TRUE(RsWakeupSignal::coreLoop().wait(0)) ;
+	EXPECT_FALSE(RsWakeupSignal::coreLoop().wait(0)) ;
+
+	threaded_service.recvItem(new RsRawItem(0x02000000,8)) ;
+	EXPECT_FALSE(RsWakeupSignal::coreLoop().wait(0)) ;
+
+	EXPECT_EQ(1u, service.handleItems()) ;
+	EXPECT_EQ(1u, threaded_service.handleItems()) ;
+}
+
+TEST(libretroshare_services, ServiceItemLatencyStatistics)
+{
+	LatencyTestService service ;
+	std::atomic<uint32_t> received(0) ;
+
+	p3Service::clearItemLatencyStatistics() ;
+
+	// The core loop only wakes up when notified. Items must not be left in the queue.
+
+	std::thread core([&]()
+	{
+		double start = rstime::RsScopeTimer::currentTime() ;
+
+		while(received < TEST_NB_ITEMS && rstime::RsScopeTimer::currentTime() < start + MAX_WAIT)
+		{
+			RsWakeupSignal::coreLoop().wait(MAX_WAIT) ;
+			received += service.handleItems() ;
+		}
+	});
+
+	// the items arrive from a different thread, as from a pqistreamer thread
+
+	for(uint32_t i=0;i<TEST_NB_ITEMS;++i)
+	{
+		service.recvItem(new RsRawItem(0x02000000,8)) ;
+		rstime::rs_usleep(TEST_ITEM_INTERVAL) ;
+	}
+
+	core.join() ;
+
+	RsServiceItemLatencyStats stats ;
+	p3Service::getItemLatencyStatistics(stats) ;
+
+	EXPECT_EQ(TEST_NB_ITEMS, received) ;
+	EXPECT_EQ(TEST_NB_ITEMS, stats.nbItems) ;
+	EXPECT_EQ(stats.below1ms + stats.below10ms + stats.below50ms + stats.below200ms + stats.above200ms, TEST_NB_ITEMS) ;
+	EXPECT_LE(stats.averageLatency, stats.maxLatency) ;
+}
+
+TEST(libretroshare_services, WakeupSignal)
+{
+	RsWakeupSignal signal ;
+
+	EXPECT_FALSE(signal.wait(0.01)) ;
+
+	// notifications before the wait are not lost, and are not counted
+	signal.notify() ;
+	signal.notify() ;
+	EXPECT_TRUE(signal.wait(1.0)) ;
+	EXPECT_FALSE(signal.wait(0)) ;
+
+	std::thread t([&signal]() { rstime::rs_usleep(10000) ; signal.notify() ; }) ;
+
+	double start = rstime::RsScopeTimer::currentTime() ;
+	EXPECT_TRUE(signal.wait(10.0)) ;
+	EXPECT_LT(rstime::RsScopeTimer::currentTime() - start, 5.0) ;
+
+	t.join() ;
+}
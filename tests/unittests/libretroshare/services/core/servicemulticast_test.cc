@@ -0,0 +1,181 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/core/servicemulticast_test.cc              *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+// from libretroshare
+
+#include "services/p3service.h"
+#include "pqi/pqiservice.h"
+#include "turtle/rsturtleitem.h"
+#include "util/rstime.h"
+
+// Compares sending the same item to many friends one copy at a time, as
+// chat lobbies and turtle forwarding did, and with sendItemToPeers(), that
+// serialises the item once and shares the serialised data.
+
+static const uint32_t BENCH_NB_ITEMS = 20000 ;
+static const uint32_t BENCH_NB_PEERS = 16 ;
+
+// Keeps the raw items that services send, instead of sending them to the network.
+
+class MulticastTestServer: public p3ServiceServerIface
+{
+public:
+	~MulticastTestServer() { clear() ; }
+
+	bool recvItem(RsRawItem *item) override { delete item ; return false ; }
+	bool sendItem(RsRawItem *item) override { mSent.push_back(item) ; return true ; }
+	bool getServiceItemNames(uint32_t /*service_type*/, std::map<uint8_t,std::string>& /*names*/) override { return false ; }
+
+	void clear()
+	{
+		for(uint32_t i=0;i<mSent.size();++i)
+			delete mSent[i] ;
+
+		mSent.clear() ;
+	}
+
+	std::vector<RsRawItem*> mSent ;
+};
+
+class MulticastTestService: public p3Service
+{
+public:
+	MulticastTestService() { addSerialType(new RsTurtleSerialiser()) ; }
+
+	RsServiceInfo getServiceInfo() override { return RsServiceInfo(); }
+	bool recvItem(RsItem *item) override { delete item ; return true ; }
+};
+
+static RsTurtleStringSearchRequestItem *makeSearchItem(uint32_t request_id)
+{
+	RsTurtleStringSearchRequestItem *item = new RsTurtleStringSearchRequestItem ;
+
+	item->request_id = request_id ;
+	item->depth = 2 ;
+	item->match_string = std::string(200,'a') ;
+
+	return item ;
+}
+
+static std::set<RsPeerId> makePeers()
+{
+	std::set<RsPeerId> peers ;
+
+	for(uint32_t i=0;i<BENCH_NB_PEERS;++i)
+		peers.insert(RsPeerId::random()) ;
+
+	return peers ;
+}
+
+TEST(libretroshare_services, ServiceMulticast)
+{
+	MulticastTestServer server ;
+	MulticastTestService service ;
+	service.setServiceServer(&server) ;
+
+	std::set<RsPeerId> peers = makePeers() ;
+
+	// Every peer gets the same data, with its own peer id and the priority of the item.
+
+	EXPECT_EQ(service.sendItemToPeers(makeSearchItem(1),peers),1) ;
+	ASSERT_EQ(server.mSent.size(),peers.size()) ;
+
+	std::set<RsPeerId> dest_peers ;
+
+	for(uint32_t i=0;i<server.mSent.size();++i)
+	{
+		dest_peers.insert(server.mSent[i]->PeerId()) ;
+
+		EXPECT_EQ(server.mSent[i]->priority_level(),QOS_PRIORITY_RS_TURTLE_SEARCH_REQUEST) ;
+		EXPECT_EQ(server.mSent[i]->getRawData(),server.mSent[0]->getRawData()) ;
+	}
+	EXPECT_TRUE(dest_peers == peers) ;
+
+	// The data is the same as when the item is sent alone.
+
+	RsTurtleStringSearchRequestItem *item = makeSearchItem(1) ;
+	item->PeerId(*peers.begin()) ;
+	service.sendItem(item) ;
+
+	ASSERT_EQ(server.mSent.size(),peers.size()+1) ;
+	ASSERT_EQ(server.mSent.back()->getRawLength(),server.mSent[0]->getRawLength()) ;
+	EXPECT_EQ(memcmp(server.mSent.back()->getRawData(),server.mSent[0]->getRawData(),server.mSent[0]->getRawLength()),0) ;
+
+	// Shared data stays valid until the last item is deleted.
+
+	std::vector<unsigned char> data((unsigned char*)server.mSent.back()->getRawData(),(unsigned char*)server.mSent.back()->getRawData()+server.mSent.back()->getRawLength()) ;
+
+	for(uint32_t i=1;i<server.mSent.size();++i)
+		delete server.mSent[i] ;
+
+	server.mSent.resize(1) ;
+	EXPECT_EQ(memcmp(server.mSent[0]->getRawData(),data.data(),data.size()),0) ;
+
+	server.clear() ;
+}
+
+// Times both ways of sending many items: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_services, DISABLED_ServiceMulticast_Bench)
+{
+	MulticastTestServer server ;
+	MulticastTestService service ;
+	service.setServiceServer(&server) ;
+
+	std::set<RsPeerId> peers = makePeers() ;
+
+	double copy_time,multicast_time ;
+	{
+		rstime::RsScopeTimer timer("") ;
+
+		for(uint32_t i=0;i<BENCH_NB_ITEMS;++i)
+		{
+			RsTurtleStringSearchRequestItem *item = makeSearchItem(i) ;
+
+			for(std::set<RsPeerId>::const_iterator it(peers.begin());it!=peers.end();++it)
+			{
+				RsTurtleSearchRequestItem *fwd_item = item->clone() ;
+				fwd_item->PeerId(*it) ;
+				service.sendItem(fwd_item) ;
+			}
+			delete item ;
+		}
+		copy_time = timer.duration() ;
+	}
+	EXPECT_EQ(server.mSent.size(),BENCH_NB_ITEMS*BENCH_NB_PEERS) ;
+	server.clear() ;
+	{
+		rstime::RsScopeTimer timer("") ;
+
+		for(uint32_t i=0;i<BENCH_NB_ITEMS;++i)
+			service.sendItemToPeers(makeSearchItem(i),peers) ;
+
+		multicast_time = timer.duration() ;
+	}
+	EXPECT_EQ(server.mSent.size(),BENCH_NB_ITEMS*BENCH_NB_PEERS) ;
+	server.clear() ;
+
+	std::cerr << "  " << BENCH_NB_ITEMS << " items sent to " << BENCH_NB_PEERS << " peers" << std::endl;
+	std::cerr << "  one copy per peer : " << copy_time << " s" << std::endl;
+	std::cerr << "  serialised once   : " << multicast_time << " s" << std::endl;
+}
@@ -0,0 +1,264 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/grouter/groutermatrix_test.cc              *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <malloc.h>
+
+// from libretroshare
+
+#include "grouter/groutermatrix.h"
+#include "grouter/grouteritems.h"
+#include "util/rsrandom.h"
+#include "util/rstime.h"
+
+static std::vector<RsPeerId> makeFriends(uint32_t n)
+{
+	std::vector<RsPeerId> friends ;
+
+	for(uint32_t i=0;i<n;++i)
+		friends.push_back(RsPeerId::random()) ;
+
+	return friends ;
+}
+
+static void freeItems(std::list<RsItem*>& items)
+{
+	for(std::list<RsItem*>::iterator it(items.begin());it!=items.end();++it)
+		delete *it ;
+
+	items.clear() ;
+}
+
+TEST(libretroshare_services, GRouterMatrix_Probabilities)
+{
+	GRouterMatrix matrix ;
+	std::vector<RsPeerId> friends = makeFriends(3) ;
+	GRouterKeyId key = GRouterKeyId::random() ;
+
+	std::vector<float> probas ;
+	float maximum = 0.0f ;
+
+	EXPECT_FALSE(matrix.computeRoutingProbabilities(key,friends,probas,maximum)) ;
+	ASSERT_EQ(probas.size(),3u) ;
+	EXPECT_EQ(probas[0],0.0f) ;
+
+	EXPECT_TRUE(matrix.addRoutingClue(key,friends[0],1.0f)) ;
+	EXPECT_TRUE(matrix.addRoutingClue(key,friends[1],0.1f)) ;
+	EXPECT_FALSE(matrix.addRoutingClue(key,friends[0],1.0f)) ;	// flooding
+
+	EXPECT_TRUE(matrix.computeRoutingProbabilities(key,friends,probas,maximum)) ;
+	EXPECT_NEAR(maximum,1.0f,1e-4) ;
+	EXPECT_NEAR(probas[0],1.0f/1.1f,1e-4) ;
+	EXPECT_NEAR(probas[1],0.1f/1.1f,1e-4) ;
+	EXPECT_EQ(probas[2],0.0f) ;
+
+	// Decaying the matrix does not change the probabilities
+
+	matrix.updateRoutingProbabilities() ;
+
+	std::vector<float> probas2 ;
+	EXPECT_TRUE(matrix.computeRoutingProbabilities(key,friends,probas2,maximum)) ;
+	EXPECT_NEAR(probas2[0],probas[0],1e-4) ;
+	EXPECT_NEAR(probas2[1],probas[1],1e-4) ;
+
+	// Many friends, so that the matrix needs to grow
+
+	std::vector<RsPeerId> more_friends = makeFriends(40) ;
+	GRouterKeyId key2 = GRouterKeyId::random() ;
+
+	for(uint32_t i=0;i<more_friends.size();++i)
+		EXPECT_TRUE(matrix.addRoutingClue(key2,more_friends[i],1.0f+i)) ;
+
+	EXPECT_TRUE(matrix.computeRoutingProbabilities(key2,more_friends,probas,maximum)) ;
+	EXPECT_NEAR(maximum,40.0f,1e-3) ;
+
+	for(uint32_t i=1;i<more_friends.size();++i)
+		EXPECT_NEAR(probas[i]/probas[0],1.0f+i,1e-3) ;
+
+	EXPECT_TRUE(matrix.computeRoutingProbabilities(key,friends,probas2,maximum)) ;	// first key unchanged
+	EXPECT_NEAR(probas2[0],1.0f/1.1f,1e-4) ;
+
+	std::vector<GRouterKeyId> keys ;
+	matrix.getListOfKnownKeys(keys) ;
+	EXPECT_EQ(keys.size(),2u) ;
+}
+
+TEST(libretroshare_services, GRouterMatrix_SaveLoad)
+{
+	GRouterMatrix matrix ;
+	std::vector<RsPeerId> friends = makeFriends(12) ;
+	std::vector<GRouterKeyId> keys ;
+
+	for(uint32_t k=0;k<100;++k)
+	{
+		keys.push_back(GRouterKeyId::random()) ;
+
+		for(uint32_t i=0;i<friends.size();++i)
+			if(RSRandom::random_u32() % 3 == 0)
+				matrix.addRoutingClue(keys.back(),friends[i],RSRandom::random_f32()) ;
+	}
+
+	std::list<RsItem*> items ;
+	matrix.saveList(items) ;
+
+	GRouterMatrix matrix2 ;
+	matrix2.loadList(items) ;
+	freeItems(items) ;
+
+	for(uint32_t k=0;k<keys.size();++k)
+	{
+		std::vector<float> probas,probas2 ;
+		float maximum,maximum2 ;
+
+		EXPECT_EQ(matrix.computeRoutingProbabilities(keys[k],friends,probas,maximum),matrix2.computeRoutingProbabilities(keys[k],friends,probas2,maximum2)) ;
+
+		for(uint32_t i=0;i<friends.size();++i)
+			EXPECT_NEAR(probas[i],probas2[i],1e-4) ;
+	}
+}
+
+// Lists of clues saved by previous versions hold up to RS_GROUTER_MATRIX_MAX_HIT_ENTRIES time stamped clues per key.
+
+TEST(libretroshare_services, GRouterMatrix_LoadClues)
+{
+	std::vector<RsPeerId> friends = makeFriends(2) ;
+	GRouterKeyId recent_key = GRouterKeyId::random() ;
+	GRouterKeyId old_key = GRouterKeyId::random() ;
+	rstime_t now = time(NULL) ;
+
+	RsGRouterMatrixFriendListItem *friend_list = new RsGRouterMatrixFriendListItem ;
+	friend_list->reverse_friend_indices = friends ;
+
+	RsGRouterMatrixCluesItem *recent_clues = new RsGRouterMatrixCluesItem ;
+	recent_clues->destination_key = recent_key ;
+
+	RoutingMatrixHitEntry rc ;
+	rc.friend_id = 0 ; rc.weight = 1.0f ; rc.time_stamp = now ;
+	recent_clues->clues.push_back(rc) ;
+	rc.friend_id = 1 ; rc.weight = 1.0f ; rc.time_stamp = now - RS_GROUTER_MATRIX_HALF_LIFE ;	// weighs half
+	recent_clues->clues.push_back(rc) ;
+	rc.friend_id = 1 ; rc.weight = 1.0f ; rc.time_stamp = now - 2*RS_GROUTER_MATRIX_HALF_LIFE ;	// weighs a quarter
+	recent_clues->clues.push_back(rc) ;
+
+	RsGRouterMatrixCluesItem *old_clues = new RsGRouterMatrixCluesItem ;
+	old_clues->destination_key = old_key ;
+	rc.friend_id = 0 ; rc.weight = 1.0f ; rc.time_stamp = now - 20*RS_GROUTER_MATRIX_HALF_LIFE ;
+	old_clues->clues.push_back(rc) ;
+
+	std::list<RsItem*> items ;
+	items.push_back(recent_clues) ;		// clues before the friend list
+	items.push_back(old_clues) ;
+	items.push_back(friend_list) ;
+
+	GRouterMatrix matrix ;
+	matrix.loadList(items) ;
+	freeItems(items) ;
+
+	std::vector<float> probas ;
+	float maximum ;
+
+	EXPECT_TRUE(matrix.computeRoutingProbabilities(recent_key,friends,probas,maximum)) ;
+	EXPECT_NEAR(probas[0],1.0f/1.75f,1e-3) ;
+	EXPECT_NEAR(probas[1],0.75f/1.75f,1e-3) ;
+
+	// keys without significant weight are forgotten
+
+	EXPECT_TRUE(matrix.computeRoutingProbabilities(old_key,friends,probas,maximum)) ;
+	matrix.updateRoutingProbabilities() ;
+	EXPECT_FALSE(matrix.computeRoutingProbabilities(old_key,friends,probas,maximum)) ;
+	EXPECT_TRUE(matrix.computeRoutingProbabilities(recent_key,friends,probas,maximum)) ;
+}
+
+// Heap currently in use, or 0 when the C library cannot tell.
+
+static uint64_t heapUsage()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 mi = mallinfo2() ;
+	return mi.uordblks + mi.hblkhd ;
+#else
+	return 0 ;
+#endif
+}
+
+// A node that routes mail for many GXS ids. Routing probabilities are computed for each routed message, and
+// the matrix is updated every RS_GROUTER_MATRIX_UPDATE_PERIOD.
+// 20k keys and 200k routed messages: run with --gtest_also_run_disabled_tests
+
+TEST(libretroshare_services, DISABLED_GRouterMatrix_Bench)
+{
+	const uint32_t NB_KEYS = 20000 ;
+	const uint32_t NB_FRIENDS = 30 ;
+	const uint32_t NB_ROUTED = 200000 ;
+
+	GRouterMatrix matrix ;
+	std::vector<RsPeerId> friends = makeFriends(NB_FRIENDS) ;
+	std::vector<GRouterKeyId> keys ;
+	keys.reserve(NB_KEYS) ;
+
+	uint64_t heap_before = heapUsage() ;
+	rstime::RsScopeTimer timer("") ;
+	double t0 = timer.duration() ;
+
+	for(uint32_t k=0;k<NB_KEYS;++k)
+	{
+		keys.push_back(GRouterKeyId::random()) ;
+
+		for(uint32_t i=0;i<NB_FRIENDS;i+=3)
+			matrix.addRoutingClue(keys.back(),friends[(i+k) % NB_FRIENDS],0.1f) ;
+	}
+
+	double t1 = timer.duration() ;
+	matrix.updateRoutingProbabilities() ;
+	double t2 = timer.duration() ;
+	uint64_t heap_after = heapUsage() ;
+
+	std::vector<float> probas ;
+	float maximum ;
+	uint32_t nb_known = 0 ;
+
+	for(uint32_t i=0;i<NB_ROUTED;++i)
+		if(matrix.computeRoutingProbabilities(keys[(i*7919) % NB_KEYS],friends,probas,maximum))
+			++nb_known ;
+
+	double t3 = timer.duration() ;
+
+	std::list<RsItem*> items ;
+	matrix.saveList(items) ;
+	uint32_t nb_clues = 0 ;
+
+	for(std::list<RsItem*>::const_iterator it(items.begin());it!=items.end();++it)
+		if(dynamic_cast<RsGRouterMatrixCluesItem*>(*it))
+			nb_clues += dynamic_cast<RsGRouterMatrixCluesItem*>(*it)->clues.size() ;
+
+	double t4 = timer.duration() ;
+	freeItems(items) ;
+
+	std::cerr << "  " << NB_KEYS << " keys, " << NB_FRIENDS << " friends" << std::endl;
+	if(heap_after > 0)
+		std::cerr << "  memory            : " << (heap_after - heap_before)/NB_KEYS << " bytes per key" << std::endl;
+	std::cerr << "  add clues         : " << 1000*(t1-t0) << " ms" << std::endl;
+	std::cerr << "  update matrix     : " << 1000*(t2-t1) << " ms" << std::endl;
+	std::cerr << "  routing probas    : " << 1e6*(t3-t2)/NB_ROUTED << " us per message" << std::endl;
+	std::cerr << "  save              : " << 1000*(t4-t3) << " ms, " << nb_clues << " clues" << std::endl;
+
+	EXPECT_EQ(nb_known,NB_ROUTED) ;
+}
@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/identity/pgphashmatcher_test.cc            *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <openssl/sha.h>
+
+// from libretroshare
+
+#include "util/rspgphashmatcher.h"
+
+static void buildKeys(uint32_t n, std::map<RsPgpId,RsPgpFingerprint>& keys)
+{
+	while(keys.size() < n)
+		keys[RsPgpId::random()] = RsPgpFingerprint::random();
+}
+
+TEST(libretroshare_services, PgpHashMatcherComputeHash)
+{
+	RsGxsId id = RsGxsId::random();
+	RsPgpFingerprint fp = RsPgpFingerprint::random();
+
+	std::string data = id.toStdString() + std::string((const char *)fp.toByteArray(), fp.SIZE_IN_BYTES);
+	unsigned char digest[SHA_DIGEST_LENGTH];
+	SHA1((const unsigned char *)data.c_str(), data.length(), digest);
+
+	Sha1CheckSum hash;
+	RsPgpHashMatcher::computeHash(id, fp, hash);
+
+	EXPECT_EQ(hash, Sha1CheckSum(digest));
+}
+
+TEST(libretroshare_services, PgpHashMatcherMatch)
+{
+	// 37 keys, so that the last group of lanes is incomplete
+
+	std::map<RsPgpId,RsPgpFingerprint> keys;
+	buildKeys(37, keys);
+
+	RsPgpHashMatcher matcher(keys);
+	EXPECT_EQ(matcher.size(), 37u);
+
+	std::vector<RsPgpHashMatcher::Request> requests;
+	std::vector<RsPgpId> expected;
+
+	for(auto it(keys.begin());it!=keys.end();++it)
+	{
+		RsPgpHashMatcher::Request req;
+		req.id = RsGxsId::random();
+		RsPgpHashMatcher::computeHash(req.id, it->second, req.pgpHash);
+
+		requests.push_back(req);
+		expected.push_back(it->first);
+
+		// an id signed by an unknown key
+
+		req.id = RsGxsId::random();
+		RsPgpHashMatcher::computeHash(req.id, RsPgpFingerprint::random(), req.pgpHash);
+
+		requests.push_back(req);
+		expected.push_back(RsPgpId());
+	}
+
+	for(uint32_t i=0;i<requests.size();++i)
+		EXPECT_EQ(matcher.match(requests[i]), expected[i]);
+
+	for(uint32_t threads : { 1, 4 })
+	{
+		std::vector<uint32_t> seen(requests.size(), 0);
+
+		matcher.match(requests, [&](uint32_t i, const RsPgpId& pgp_id)
+		{
+			ASSERT_LT(i, requests.size());
+			++seen[i];
+			EXPECT_EQ(pgp_id, expected[i]);
+		}, threads);
+
+		for(uint32_t i=0;i<seen.size();++i)
+			EXPECT_EQ(seen[i], 1u);
+	}
+}
+
+// Timing only, 400k hashes per method: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_services, DISABLED_PgpHashMatcherSpeed)
+{
+	std::map<RsPgpId,RsPgpFingerprint> keys;
+	buildKeys(2000, keys);
+
+	RsPgpHashMatcher matcher(keys);
+	std::vector<RsPgpHashMatcher::Request> requests(200);
+
+	for(uint32_t i=0;i<requests.size();++i)
+	{
+		requests[i].id = RsGxsId::random();
+		requests[i].pgpHash = Sha1CheckSum::random();
+	}
+
+	// one hash at a time, as done before
+
+	auto start = std::chrono::steady_clock::now();
+	uint32_t nb_found = 0;
+
+	for(uint32_t i=0;i<requests.size();++i)
+		for(auto it(keys.begin());it!=keys.end();++it)
+		{
+			Sha1CheckSum hash;
+			RsPgpHashMatcher::computeHash(requests[i].id, it->second, hash);
+			nb_found += (hash == requests[i].pgpHash);
+		}
+
+	double t_single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	for(uint32_t i=0;i<requests.size();++i)
+		nb_found += !matcher.match(requests[i]).isNull();
+
+	double t_lanes = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	matcher.match(requests, [&](uint32_t, const RsPgpId& pgp_id) { nb_found += !pgp_id.isNull(); });
+
+	double t_threads = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	EXPECT_EQ(nb_found, 0u);
+
+	double nb_hashes = double(requests.size()) * keys.size();
+
+	std::cerr << "  single hashes:   " << nb_hashes / t_single  / 1e6 << " Mhash/s" << std::endl;
+	std::cerr << "  lanes:           " << nb_hashes / t_lanes   / 1e6 << " Mhash/s" << std::endl;
+	std::cerr << "  lanes + threads: " << nb_hashes / t_threads / 1e6 << " Mhash/s" << std::endl;
+}
@@ -0,0 +1,288 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/turtle/turtlerelay_test.cc                 *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <retroshare.team@gmailcom>              *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+// from librssimulator
+#include "peer/PeerNode.h"
+
+// from libretroshare
+#include "turtle/p3turtle.h"
+#include "turtle/rsturtleitem.h"
+#include "serialiser/rsserial.h"
+#include "util/rstime.h"
+
+static const uint16_t RELAY_TEST_SERVICE_ID = 0xf0f0 ;
+
+// Turtle client that provides (or asks for) a single hash, and counts the data it receives.
+
+class RelayTestClient: public RsTurtleClientService
+{
+public:
+	RelayTestClient(const RsFileHash& hash,bool provides) : mHash(hash), mProvides(provides), mTurtle(NULL), mReceivedItems(0), mReceivedBytes(0) {}
+
+	virtual uint16_t serviceId() const { return RELAY_TEST_SERVICE_ID ; }
+	virtual void connectToTurtleRouter(p3turtle *turtle) { mTurtle = turtle ; turtle->registerTunnelService(this) ; }
+
+	virtual bool handleTunnelRequest(const RsFileHash& hash,const RsPeerId& /*peer_id*/) { return mProvides && hash == mHash ; }
+
+	virtual void receiveTurtleData(const RsTurtleGenericTunnelItem *item,const RsFileHash& /*hash*/,const RsPeerId& /*virtual_peer_id*/,RsTurtleGenericTunnelItem::Direction /*direction*/)
+	{
+		const RsTurtleGenericDataItem *data_item = dynamic_cast<const RsTurtleGenericDataItem*>(item) ;
+
+		if(data_item)
+		{
+			++mReceivedItems ;
+			mReceivedBytes += data_item->data_size ;
+		}
+	}
+
+	virtual void addVirtualPeer(const TurtleFileHash& /*hash*/,const TurtleVirtualPeerId& virtual_peer_id,RsTurtleGenericTunnelItem::Direction /*dir*/) { mVirtualPeers.push_back(virtual_peer_id) ; }
+	virtual void removeVirtualPeer(const TurtleFileHash& /*hash*/,const TurtleVirtualPeerId& /*virtual_peer_id*/) {}
+
+	RsFileHash mHash ;
+	bool mProvides ;
+	p3turtle *mTurtle ;
+
+	std::vector<TurtleVirtualPeerId> mVirtualPeers ;
+	uint32_t mReceivedItems ;
+	uint64_t mReceivedBytes ;
+};
+
+// Three peers in a row: the client A and the server B are only connected through the relay R.
+
+class TurtleRelayChain
+{
+public:
+	TurtleRelayChain(const RsFileHash& hash)
+		: mIdA(RsPeerId::random()), mIdR(RsPeerId::random()), mIdB(RsPeerId::random()), mClientA(hash,false), mClientB(hash,true)
+	{
+		mNodeA = addNode(mIdA,std::list<RsPeerId>(1,mIdR),mTurtleA) ;
+		mNodeB = addNode(mIdB,std::list<RsPeerId>(1,mIdR),mTurtleB) ;
+
+		std::list<RsPeerId> relay_friends ;
+		relay_friends.push_back(mIdA) ;
+		relay_friends.push_back(mIdB) ;
+
+		mNodeR = addNode(mIdR,relay_friends,mTurtleR) ;
+
+		mClientA.connectToTurtleRouter(mTurtleA) ;
+		mClientB.connectToTurtleRouter(mTurtleB) ;
+	}
+
+	~TurtleRelayChain()
+	{
+		for(std::map<RsPeerId,PeerNode*>::iterator it(mNodes.begin());it!=mNodes.end();++it)
+			delete it->second ;
+	}
+
+	// Sends the packets of the given node to their destination. Returns the number of packets sent.
+
+	uint32_t deliverOutgoing(PeerNode *node)
+	{
+		uint32_t n = 0 ;
+
+		while(node->haveOutgoingPackets())
+		{
+			RsRawItem *item = node->outgoing() ;
+			PeerNode *dest = mNodes[item->PeerId()] ;
+
+			item->PeerId(node->id()) ;
+			dest->incoming(item) ;
+			++n ;
+		}
+		return n ;
+	}
+
+	void tickAll(int nb_ticks)
+	{
+		for(int i=0;i<nb_ticks;++i)
+			for(std::map<RsPeerId,PeerNode*>::iterator it(mNodes.begin());it!=mNodes.end();++it)
+			{
+				it->second->tick() ;
+				deliverOutgoing(it->second) ;
+			}
+	}
+
+	RsPeerId mIdA,mIdR,mIdB ;
+	PeerNode *mNodeA,*mNodeR,*mNodeB ;
+	p3turtle *mTurtleA,*mTurtleR,*mTurtleB ;
+	RelayTestClient mClientA,mClientB ;
+
+private:
+	PeerNode *addNode(const RsPeerId& id,const std::list<RsPeerId>& friends,p3turtle *& turtle)
+	{
+		PeerNode *node = new PeerNode(id,friends,true) ;
+
+		turtle = new p3turtle(node->getServiceControl(),node->getLinkMgr()) ;
+		node->AddService(turtle) ;
+
+		mNodes[id] = node ;
+		return node ;
+	}
+
+	std::map<RsPeerId,PeerNode*> mNodes ;
+};
+
+static RsTurtleGenericDataItem *makeDataItem(uint32_t size)
+{
+	RsTurtleGenericDataItem *item = new RsTurtleGenericDataItem ;
+
+	item->data_size = size ;
+	item->data_bytes = rs_malloc(size) ;
+	memset(item->data_bytes,0x5a,size) ;
+
+	return item ;
+}
+
+// Digs a tunnel from A to B through R, and makes A send data to B. Returns the packets that go to R.
+
+static void sendThroughTunnel(TurtleRelayChain& chain,uint32_t nb_items,uint32_t item_size,std::vector<RsRawItem*>& packets)
+{
+	chain.mTurtleA->monitorTunnels(chain.mClientA.mHash,&chain.mClientA,false) ;
+	chain.tickAll(5) ;
+
+	ASSERT_EQ(chain.mClientA.mVirtualPeers.size(),1u) ;
+	ASSERT_EQ(chain.mClientB.mVirtualPeers.size(),1u) ;
+
+	for(uint32_t i=0;i<nb_items;++i)
+		chain.mTurtleA->sendTurtleData(chain.mClientA.mVirtualPeers[0],makeDataItem(item_size)) ;
+
+	while(chain.mNodeA->haveOutgoingPackets())
+	{
+		RsRawItem *item = chain.mNodeA->outgoing() ;
+		item->PeerId(chain.mIdA) ;
+		packets.push_back(item) ;
+	}
+	ASSERT_EQ(packets.size(),nb_items) ;
+}
+
+// Makes R relay the packets. Each round sends the packets relayed by the previous one again, as if they went through R back and forth.
+
+static void relay(TurtleRelayChain& chain,std::vector<RsRawItem*>& packets,uint32_t nb_rounds,std::vector<RsRawItem*>& relayed)
+{
+	for(uint32_t n=0;n<nb_rounds;++n)
+	{
+		if(n > 0)
+		{
+			packets.swap(relayed) ;
+			relayed.clear() ;
+
+			for(uint32_t i=0;i<packets.size();++i)
+				packets[i]->PeerId(chain.mIdA) ;
+		}
+
+		for(uint32_t i=0;i<packets.size();++i)
+			chain.mNodeR->incoming(packets[i]) ;
+
+		chain.mNodeR->tick() ;
+
+		while(chain.mNodeR->haveOutgoingPackets())
+			relayed.push_back(chain.mNodeR->outgoing()) ;
+	}
+}
+
+static void deliverToB(TurtleRelayChain& chain,std::vector<RsRawItem*>& relayed)
+{
+	for(uint32_t i=0;i<relayed.size();++i)
+	{
+		relayed[i]->PeerId(chain.mIdR) ;
+		chain.mNodeB->incoming(relayed[i]) ;
+	}
+	chain.mNodeB->tick() ;
+}
+
+TEST(libretroshare_services, TurtleRelayForwarding)
+{
+	const uint32_t NB_ITEMS = 50 ;
+	const uint32_t ITEM_SIZE = 8*1024 ;
+
+	TurtleRelayChain chain(RsFileHash::random()) ;
+
+	std::vector<RsRawItem*> packets ;
+	ASSERT_NO_FATAL_FAILURE(sendThroughTunnel(chain,NB_ITEMS,ITEM_SIZE,packets)) ;
+
+	std::vector<std::vector<unsigned char> > sent ;
+
+	for(uint32_t i=0;i<packets.size();++i)
+		sent.push_back(std::vector<unsigned char>((unsigned char*)packets[i]->getRawData(),(unsigned char*)packets[i]->getRawData()+packets[i]->getRawLength())) ;
+
+	std::vector<RsRawItem*> relayed ;
+	relay(chain,packets,1,relayed) ;
+
+	ASSERT_EQ(relayed.size(),NB_ITEMS) ;
+
+	// Relayed packets are the packets sent by A, unchanged and in order, sent to B with the priority of the data items.
+
+	for(uint32_t i=0;i<relayed.size();++i)
+	{
+		EXPECT_TRUE(relayed[i]->PeerId() == chain.mIdB) ;
+		EXPECT_EQ(relayed[i]->priority_level(),QOS_PRIORITY_RS_TURTLE_GENERIC_DATA) ;
+		ASSERT_EQ(relayed[i]->getRawLength(),sent[i].size()) ;
+		EXPECT_EQ(memcmp(relayed[i]->getRawData(),sent[i].data(),sent[i].size()),0) ;
+	}
+
+	// All data reaches B
+
+	deliverToB(chain,relayed) ;
+
+	EXPECT_EQ(chain.mClientB.mReceivedItems,NB_ITEMS) ;
+	EXPECT_EQ(chain.mClientB.mReceivedBytes,NB_ITEMS*(uint64_t)ITEM_SIZE) ;
+
+	// Data sent back by B goes through the tunnel the other way
+
+	chain.mTurtleB->sendTurtleData(chain.mClientB.mVirtualPeers[0],makeDataItem(ITEM_SIZE)) ;
+	chain.tickAll(3) ;	// B, R and A, whatever the order of the ticks
+
+	EXPECT_EQ(chain.mClientA.mReceivedItems,1u) ;
+}
+
+// 200k relayed items of 8 KB: run with --gtest_also_run_disabled_tests
+TEST(libretroshare_services, DISABLED_TurtleRelay_Bench)
+{
+	const uint32_t NB_ITEMS = 10000 ;
+	const uint32_t NB_ROUNDS = 20 ;
+	const uint32_t ITEM_SIZE = 8*1024 ;
+
+	TurtleRelayChain chain(RsFileHash::random()) ;
+
+	std::vector<RsRawItem*> packets ;
+	ASSERT_NO_FATAL_FAILURE(sendThroughTunnel(chain,NB_ITEMS,ITEM_SIZE,packets)) ;
+
+	std::vector<RsRawItem*> relayed ;
+	double relay_time ;
+	{
+		rstime::RsScopeTimer timer("") ;
+		relay(chain,packets,NB_ROUNDS,relayed) ;
+		relay_time = timer.duration() ;
+	}
+	ASSERT_EQ(relayed.size(),NB_ITEMS) ;
+
+	double nb_relayed = NB_ROUNDS*(double)NB_ITEMS ;
+
+	std::cerr << "  relayed " << nb_relayed << " items of " << ITEM_SIZE << " bytes in " << relay_time << " s: "
+	          << nb_relayed/relay_time << " items/s, " << nb_relayed*ITEM_SIZE/relay_time/(1024*1024) << " MB/s" << std::endl;
+
+	deliverToB(chain,relayed) ;
+
+	EXPECT_EQ(chain.mClientB.mReceivedItems,NB_ITEMS) ;
+}
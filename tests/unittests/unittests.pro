@@ -294,6 +294,21 @@ SOURCES +=  unittests.cc \
 
 SOURCES += libretroshare/crypto/chacha20_test.cc
 
+############################### File sharing ###############################
+
+SOURCES += libretroshare/file_sharing/hashstorage_bench_test.cc
+SOURCES += libretroshare/file_sharing/ftdatamultiplex_bench_test.cc
+SOURCES += libretroshare/file_sharing/ftratecontrol_test.cc
+SOURCES += libretroshare/file_sharing/filesearchindex_test.cc
+SOURCES += libretroshare/file_sharing/directorywatcher_test.cc
+SOURCES += libretroshare/file_sharing/compactfilelist_test.cc
+SOURCES += libretroshare/file_sharing/dirhierarchy_test.cc
+
+################################### PQI ####################################
+
+SOURCES += libretroshare/pqi/pqireactor_test.cc \
+	libretroshare/pqi/pqistreamer_test.cc
+
 ################################ Serialiser ################################
 HEADERS +=  libretroshare/serialiser/support.h \
 	libretroshare/serialiser/rstlvutil.h \
@@ -314,6 +329,7 @@ SOURCES +=  libretroshare/serialiser/rsturtleitem_test.cc \
 #		libretroshare/serialiser/rsgrouteritem_test.cc \
 		libretroshare/serialiser/tlvtypes_test.cc \
 		libretroshare/serialiser/tlvkey_test.cc \
+		libretroshare/serialiser/smallobject_bench_test.cc \
 		libretroshare/serialiser/support.cc \
 		libretroshare/serialiser/rstlvutil.cc \
 
@@ -344,7 +360,9 @@ SOURCES +=  libretroshare/gxs/nxs_test/nxsdummyservices.cc \
 	libretroshare/gxs/nxs_test/rsgxsnetservice_test.cc \
 	libretroshare/gxs/nxs_test/nxsmsgsync_test.cc \
 	libretroshare/gxs/nxs_test/nxsgrpsync_test.cc \ 
-	libretroshare/gxs/nxs_test/nxsgrpsyncdelayed.cc
+	libretroshare/gxs/nxs_test/nxsgrpsyncdelayed.cc \
+	libretroshare/gxs/nxs_test/msgidiblt_test.cc \
+	libretroshare/gxs/nxs_test/msgrequestpipeline_test.cc
 	
 HEADERS += libretroshare/gxs/gen_exchange/genexchangetester.h \
 	libretroshare/gxs/gen_exchange/gxspublishmsgtest.h \
@@ -371,10 +389,13 @@ HEADERS += libretroshare/gxs/data_service/rsdataservice_test.h \
 
 SOURCES += libretroshare/gxs/data_service/rsdataservice_test.cc \
 	libretroshare/gxs/data_service/rsgxsdata_test.cc \
+	libretroshare/gxs/data_service/rsthreadindex_test.cc \
 
 
 ################################ dbase #####################################
 
+SOURCES += libretroshare/dbase/retrodb_bench_test.cc \
+
 
 #SOURCES += libretroshare/dbase/fisavetest.cc \
 #	libretroshare/dbase/fitest2.cc \
@@ -387,6 +408,14 @@ SOURCES += libretroshare/gxs/data_service/rsdataservice_test.cc \
 ############################### services ###################################
 
 SOURCES += libretroshare/services/status/status_test.cc \
+	libretroshare/services/core/servicelatency_test.cc \
+	libretroshare/services/core/servicemulticast_test.cc \
+	libretroshare/services/banlist/iptrie_test.cc \
+	libretroshare/services/banlist/ipfilter_test.cc \
+	libretroshare/services/identity/pgphashmatcher_test.cc \
+	libretroshare/services/grouter/groutermatrix_test.cc \
+	libretroshare/services/turtle/turtlerelay_test.cc \
+	libretroshare/services/chat/lobbyduplicates_test.cc \
 
 ############################### gxs ########################################
 